@@ -0,0 +1,188 @@
+/*
+ * eventbatch.c: filtering and coalescing domain events for remote clients
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <config.h>
+
+#include <string.h>
+
+#include "eventbatch.h"
+#include "viralloc.h"
+#include "virlog.h"
+#include "virerror.h"
+#include "viruuid.h"
+#include "rpc/virnetprotocol.h"
+
+#define VIR_FROM_THIS VIR_FROM_RPC
+
+/* Events coalesced into one batch message are capped to half a
+ * message, as with paged list replies */
+#define DAEMON_EVENT_BATCH_BYTES (VIR_NET_MESSAGE_MAX / 2)
+
+
+/* Send the events in @batch, if any, as one message */
+void
+daemonEventBatchFlush(daemonEventBatchPtr batch,
+                      daemonEventBatchSendFunc send,
+                      void *opaque)
+{
+    if (!batch->msg.events.events_len)
+        return;
+
+    VIR_DEBUG("Sending batch of %u events", batch->msg.events.events_len);
+    send(REMOTE_PROC_DOMAIN_EVENT_BATCH,
+         (xdrproc_t)xdr_remote_domain_event_batch_msg,
+         &batch->msg, opaque);
+    memset(&batch->msg, 0, sizeof(batch->msg));
+    batch->size = 0;
+}
+
+
+/* Drop the events in @batch without sending them */
+void
+daemonEventBatchClear(daemonEventBatchPtr batch)
+{
+    xdr_free((xdrproc_t)xdr_remote_domain_event_batch_msg,
+             (char *) &batch->msg);
+    memset(&batch->msg, 0, sizeof(batch->msg));
+    batch->size = 0;
+}
+
+
+static int
+daemonEventBatchAppend(daemonEventBatchPtr batch,
+                       int procnr,
+                       xdrproc_t proc,
+                       void *data,
+                       daemonEventBatchSendFunc send,
+                       void *opaque)
+{
+    remote_domain_event_batch_entry *entry;
+    char *buf = NULL;
+    unsigned int len;
+    XDR xdr;
+
+    if (VIR_ALLOC_N(buf, REMOTE_DOMAIN_EVENT_BATCH_DATA_MAX) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    xdrmem_create(&xdr, buf, REMOTE_DOMAIN_EVENT_BATCH_DATA_MAX, XDR_ENCODE);
+    if (!(*proc)(&xdr, data)) {
+        VIR_DEBUG("Event %d too large to batch", procnr);
+        xdr_destroy(&xdr);
+        VIR_FREE(buf);
+        return -1;
+    }
+    len = xdr_getpos(&xdr);
+    xdr_destroy(&xdr);
+
+    /* Failure to reduce memory allocation isn't fatal */
+    ignore_value(VIR_REALLOC_N(buf, len ? len : 1));
+
+    if (batch->msg.events.events_len == REMOTE_DOMAIN_EVENT_BATCH_MAX ||
+        batch->size + len > DAEMON_EVENT_BATCH_BYTES)
+        daemonEventBatchFlush(batch, send, opaque);
+
+    if (VIR_REALLOC_N(batch->msg.events.events_val,
+                      batch->msg.events.events_len + 1) < 0) {
+        virReportOOMError();
+        VIR_FREE(buf);
+        return -1;
+    }
+
+    entry = batch->msg.events.events_val + batch->msg.events.events_len++;
+    entry->procedure = procnr;
+    entry->data.data_val = buf;
+    entry->data.data_len = len;
+    /* procedure, length and padding */
+    batch->size += len + 12;
+
+    return 0;
+}
+
+
+/*
+ * Add an event to @batch, so that a burst of events costs one
+ * message rather than one each. An event which can't be batched is
+ * sent alone, but only after the events already in @batch, so that
+ * the client gets them in the order they happened. Either way @data
+ * is freed with @proc.
+ *
+ * Returns 1 if the event was batched, 0 if it was sent
+ */
+int
+daemonEventBatchQueue(daemonEventBatchPtr batch,
+                      int procnr,
+                      xdrproc_t proc,
+                      void *data,
+                      daemonEventBatchSendFunc send,
+                      void *opaque)
+{
+    if (daemonEventBatchAppend(batch, procnr, proc, data, send, opaque) < 0) {
+        daemonEventBatchFlush(batch, send, opaque);
+        send(procnr, proc, data, opaque);
+        return 0;
+    }
+
+    xdr_free(proc, data);
+    return 1;
+}
+
+
+/* The set of domains in @doms, for daemonEventFilterWanted */
+virHashTablePtr
+daemonEventFilterNew(const remote_uuid *doms,
+                     size_t ndoms)
+{
+    virHashTablePtr filter;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    size_t i;
+
+    if (!(filter = virHashCreate(ndoms + 1, NULL)))
+        return NULL;
+
+    for (i = 0; i < ndoms; i++) {
+        virUUIDFormat((unsigned char *) doms[i], uuidstr);
+        if (virHashUpdateEntry(filter, uuidstr, (void *) 1) < 0) {
+            virHashFree(filter);
+            return NULL;
+        }
+    }
+
+    return filter;
+}
+
+
+/* Whether events about the domain @uuid pass @filter. Without a
+ * filter, every domain does. */
+bool
+daemonEventFilterWanted(virHashTablePtr filter,
+                        const unsigned char *uuid)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (!filter)
+        return true;
+
+    virUUIDFormat(uuid, uuidstr);
+    return virHashLookup(filter, uuidstr) != NULL;
+}
@@ -0,0 +1,65 @@
+/*
+ * eventbatch.h: filtering and coalescing domain events for remote clients
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef __LIBVIRTD_EVENTBATCH_H__
+# define __LIBVIRTD_EVENTBATCH_H__
+
+# include "internal.h"
+# include "virhash.h"
+# include "remote/remote_protocol.h"
+
+/*
+ * Send the event @procnr, encoded by @proc from @data, which must be
+ * freed with @proc afterwards
+ */
+typedef void (*daemonEventBatchSendFunc)(int procnr,
+                                         xdrproc_t proc,
+                                         void *data,
+                                         void *opaque);
+
+typedef struct _daemonEventBatch daemonEventBatch;
+typedef daemonEventBatch *daemonEventBatchPtr;
+struct _daemonEventBatch {
+    remote_domain_event_batch_msg msg;
+    size_t size;            /* bytes @msg takes up on the wire */
+};
+
+int daemonEventBatchQueue(daemonEventBatchPtr batch,
+                          int procnr,
+                          xdrproc_t proc,
+                          void *data,
+                          daemonEventBatchSendFunc send,
+                          void *opaque);
+
+void daemonEventBatchFlush(daemonEventBatchPtr batch,
+                           daemonEventBatchSendFunc send,
+                           void *opaque);
+
+void daemonEventBatchClear(daemonEventBatchPtr batch);
+
+virHashTablePtr daemonEventFilterNew(const remote_uuid *doms,
+                                     size_t ndoms);
+
+bool daemonEventFilterWanted(virHashTablePtr filter,
+                             const unsigned char *uuid);
+
+#endif /* __LIBVIRTD_EVENTBATCH_H__ */
@@ -277,6 +277,7 @@ daemonConfigNew(bool privileged ATTRIBUTE_UNUSED)
     data->max_clients = 20;
 
     data->prio_workers = 5;
+    data->io_threads = 0;
 
     data->max_requests = 20;
     data->max_client_requests = 5;
@@ -355,6 +356,7 @@ daemonConfigFree(struct daemonConfig *data)
     VIR_FREE(data->crl_file);
 
     VIR_FREE(data->host_uuid);
+    VIR_FREE(data->event_loop);
     VIR_FREE(data->log_filters);
     VIR_FREE(data->log_outputs);
 
@@ -425,10 +427,18 @@ daemonConfigLoadOptions(struct daemonConfig *data,
     GET_CONF_INT(conf, filename, max_clients);
 
     GET_CONF_INT(conf, filename, prio_workers);
+    GET_CONF_INT(conf, filename, io_threads);
+    if (data->io_threads < 0) {
+        virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
+                       _("io_threads must not be negative"));
+        goto error;
+    }
 
     GET_CONF_INT(conf, filename, max_requests);
     GET_CONF_INT(conf, filename, max_client_requests);
 
+    GET_CONF_STR(conf, filename, event_loop);
+
     GET_CONF_INT(conf, filename, audit_level);
     GET_CONF_INT(conf, filename, audit_logging);
 
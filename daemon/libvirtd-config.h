@@ -63,10 +63,13 @@ struct daemonConfig {
     int max_clients;
 
     int prio_workers;
+    int io_threads;
 
     int max_requests;
     int max_client_requests;
 
+    char *event_loop;
+
     int log_level;
     char *log_filters;
     char *log_outputs;
@@ -49,6 +49,7 @@
 #include "viralloc.h"
 #include "virconf.h"
 #include "virnetlink.h"
+#include "virevent.h"
 #include "virnetserver.h"
 #include "remote.h"
 #include "remote_driver.h"
@@ -1327,9 +1328,21 @@ int main(int argc, char **argv) {
         goto cleanup;
     }
 
+    if (config->event_loop) {
+        int type = virEventImplTypeFromString(config->event_loop);
+        if (type < 0 ||
+            virEventSetDefaultImplType(type) < 0) {
+            VIR_ERROR(_("unknown event loop implementation: %s"),
+                      config->event_loop);
+            ret = VIR_DAEMON_ERR_CONFIG;
+            goto cleanup;
+        }
+    }
+
     if (!(srv = virNetServerNew(config->min_workers,
                                 config->max_workers,
                                 config->prio_workers,
+                                config->io_threads,
                                 config->max_clients,
                                 config->keepalive_interval,
                                 config->keepalive_count,
@@ -36,10 +36,13 @@
 # include "qemu_protocol.h"
 # include "virlog.h"
 # include "virthread.h"
+# include "virhash.h"
 # if WITH_SASL
 #  include "virnetsaslcontext.h"
 # endif
 # include "virnetserverprogram.h"
+# include "listpage.h"
+# include "eventbatch.h"
 
 typedef struct daemonClientStream daemonClientStream;
 typedef daemonClientStream *daemonClientStreamPtr;
@@ -52,6 +55,15 @@ struct daemonClientPrivate {
     virMutex lock;
 
     int domainEventCallbackID[VIR_DOMAIN_EVENT_ID_LAST];
+    /* UUIDs of the domains whose events the client wants, for each
+     * event ID, or NULL if it wants them all */
+    virHashTablePtr domainEventFilter[VIR_DOMAIN_EVENT_ID_LAST];
+
+    /* Events waiting to be sent together, if the client asked for
+     * batches, and the timer which sends them */
+    bool domainEventBatchSupported;
+    daemonEventBatch domainEventBatch;
+    int domainEventBatchTimer;
 
 # if WITH_SASL
     virNetSASLSessionPtr sasl;
@@ -65,6 +77,9 @@ struct daemonClientPrivate {
 
     daemonClientStreamPtr streams;
     bool keepalive_supported;
+
+    /* The listing the client is paging through, if any */
+    daemonListPageSnapshotPtr listSnapshot;
 };
 
 # if WITH_SASL
@@ -72,5 +87,6 @@ extern virNetSASLContextPtr saslCtxt;
 # endif
 extern virNetServerProgramPtr remoteProgram;
 extern virNetServerProgramPtr qemuProgram;
+extern virNetServerProgramPtr lxcProgram;
 
 #endif
@@ -0,0 +1,236 @@
+/*
+ * listpage.c: paging through object lists for remote clients
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "listpage.h"
+#include "viralloc.h"
+#include "virobject.h"
+#include "virerror.h"
+
+#define VIR_FROM_THIS VIR_FROM_RPC
+
+typedef struct _daemonListPageEntry daemonListPageEntry;
+typedef daemonListPageEntry *daemonListPageEntryPtr;
+struct _daemonListPageEntry {
+    void *obj;
+    const char *key;    /* NULL if the key is @buf */
+    size_t size;        /* bytes the object takes in a reply */
+    char buf[DAEMON_LIST_PAGE_KEY_BUFLEN];
+};
+
+/*
+ * The sorted result of one listing, kept while a client pages
+ * through it so that the objects are only fetched and sorted once
+ */
+struct _daemonListPageSnapshot {
+    const daemonListPageOps *ops;
+    char *parentKey;
+    unsigned int flags;
+
+    daemonListPageEntryPtr entries;
+    void **objs;        /* The objects of @entries, in the same order */
+    size_t nobjs;
+    size_t next;        /* First object of the next page */
+};
+
+
+static const char *
+daemonListPageEntryKey(const daemonListPageEntry *entry)
+{
+    return entry->key ? entry->key : entry->buf;
+}
+
+static int
+daemonListPageEntryCompare(const void *a, const void *b)
+{
+    const daemonListPageEntry *ea = a;
+    const daemonListPageEntry *eb = b;
+
+    return strcmp(daemonListPageEntryKey(ea), daemonListPageEntryKey(eb));
+}
+
+
+void
+daemonListPageSnapshotFree(daemonListPageSnapshotPtr snapshot)
+{
+    size_t i;
+
+    if (!snapshot)
+        return;
+
+    for (i = 0 ; i < snapshot->nobjs ; i++)
+        virObjectUnref(snapshot->entries[i].obj);
+    VIR_FREE(snapshot->entries);
+    VIR_FREE(snapshot->objs);
+    VIR_FREE(snapshot->parentKey);
+    VIR_FREE(snapshot);
+}
+
+
+static daemonListPageSnapshotPtr
+daemonListPageSnapshotNew(const daemonListPageOps *ops,
+                          void *parent,
+                          const char *parentKey,
+                          unsigned int flags)
+{
+    daemonListPageSnapshotPtr snapshot;
+    void **objs = NULL;
+    int nobjs;
+    size_t i;
+
+    if ((nobjs = ops->list(parent, &objs, flags)) < 0)
+        return NULL;
+
+    if (VIR_ALLOC(snapshot) < 0 ||
+        (parentKey && !(snapshot->parentKey = strdup(parentKey))) ||
+        (nobjs && (VIR_ALLOC_N(snapshot->entries, nobjs) < 0 ||
+                   VIR_ALLOC_N(snapshot->objs, nobjs) < 0))) {
+        virReportOOMError();
+        for (i = 0 ; i < nobjs ; i++)
+            virObjectUnref(objs[i]);
+        VIR_FREE(objs);
+        daemonListPageSnapshotFree(snapshot);
+        return NULL;
+    }
+
+    snapshot->ops = ops;
+    snapshot->flags = flags;
+    snapshot->nobjs = nobjs;
+
+    for (i = 0 ; i < nobjs ; i++) {
+        daemonListPageEntryPtr entry = &snapshot->entries[i];
+
+        entry->obj = objs[i];
+        entry->key = ops->key(entry->obj, entry->buf, &entry->size);
+        /* The entries move around while being sorted */
+        if (entry->key == entry->buf)
+            entry->key = NULL;
+    }
+    VIR_FREE(objs);
+
+    if (nobjs)
+        qsort(snapshot->entries, nobjs, sizeof(*snapshot->entries),
+              daemonListPageEntryCompare);
+
+    for (i = 0 ; i < nobjs ; i++)
+        snapshot->objs[i] = snapshot->entries[i].obj;
+
+    return snapshot;
+}
+
+
+/* Whether @snapshot is the listing the page after @start belongs to */
+static bool
+daemonListPageSnapshotMatch(daemonListPageSnapshotPtr snapshot,
+                            const daemonListPageOps *ops,
+                            const char *parentKey,
+                            unsigned int flags,
+                            const char *start)
+{
+    return snapshot->ops == ops &&
+        STREQ_NULLABLE(snapshot->parentKey, parentKey) &&
+        snapshot->flags == flags &&
+        start && snapshot->next > 0 &&
+        STREQ(daemonListPageEntryKey(&snapshot->entries[snapshot->next - 1]),
+              start);
+}
+
+
+/*
+ * Find the page of the objects below @parent that follows the one
+ * ending with the key @start, or the first page if @start is NULL.
+ * The page holds at most @max objects and no more than @maxBytes of
+ * data, but always at least one object if any remain, so that a
+ * client makes progress whatever their sizes.
+ *
+ * When @start is where the previous page in *@snapshot ended, the
+ * objects are taken from there, otherwise they are listed again
+ * and *@snapshot is replaced. The objects returned in @objs remain
+ * owned by *@snapshot, so are only valid until it is passed in
+ * again or freed.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int
+daemonListPage(daemonListPageSnapshotPtr *snapshot,
+               const daemonListPageOps *ops,
+               void *parent,
+               const char *parentKey,
+               unsigned int flags,
+               const char *start,
+               size_t max,
+               size_t maxBytes,
+               void ***objs,
+               size_t *nobjs,
+               bool *more)
+{
+    daemonListPageSnapshotPtr snap = *snapshot;
+    size_t first;
+    size_t bytes = 0;
+    size_t n = 0;
+
+    if (snap && daemonListPageSnapshotMatch(snap, ops, parentKey,
+                                            flags, start)) {
+        first = snap->next;
+    } else {
+        size_t hi;
+
+        daemonListPageSnapshotFree(snap);
+        *snapshot = NULL;
+        if (!(snap = daemonListPageSnapshotNew(ops, parent,
+                                               parentKey, flags)))
+            return -1;
+        *snapshot = snap;
+
+        /* The first object sorting strictly after @start */
+        first = 0;
+        hi = snap->nobjs;
+        if (start) {
+            while (first < hi) {
+                size_t mid = first + (hi - first) / 2;
+
+                if (strcmp(daemonListPageEntryKey(&snap->entries[mid]),
+                           start) <= 0)
+                    first = mid + 1;
+                else
+                    hi = mid;
+            }
+        }
+    }
+
+    while (first + n < snap->nobjs && n < max) {
+        if (n && bytes + snap->entries[first + n].size > maxBytes)
+            break;
+        bytes += snap->entries[first + n].size;
+        n++;
+    }
+
+    snap->next = first + n;
+    *objs = snap->objs + first;
+    *nobjs = n;
+    *more = snap->next < snap->nobjs;
+    return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * listpage.h: paging through object lists for remote clients
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef __LIBVIRTD_LISTPAGE_H__
+# define __LIBVIRTD_LISTPAGE_H__
+
+# include "internal.h"
+
+/* Longest key a daemonListPageKeyFunc may format in its buffer */
+# define DAEMON_LIST_PAGE_KEY_BUFLEN VIR_UUID_STRING_BUFLEN
+
+/*
+ * Fetch every object below @parent, in the manner of
+ * virConnectListAllDomains. The objects must be virObjects.
+ */
+typedef int (*daemonListPageListFunc)(void *parent,
+                                      void ***objs,
+                                      unsigned int flags);
+
+/*
+ * Return the key @obj is ordered by, which is either a string
+ * owned by @obj or formatted into @buf, and set @size to the bytes
+ * @obj takes up in a reply.
+ */
+typedef const char *(*daemonListPageKeyFunc)(void *obj,
+                                             char *buf,
+                                             size_t *size);
+
+typedef struct _daemonListPageOps daemonListPageOps;
+struct _daemonListPageOps {
+    daemonListPageListFunc list;
+    daemonListPageKeyFunc key;
+};
+
+typedef struct _daemonListPageSnapshot daemonListPageSnapshot;
+typedef daemonListPageSnapshot *daemonListPageSnapshotPtr;
+
+int daemonListPage(daemonListPageSnapshotPtr *snapshot,
+                   const daemonListPageOps *ops,
+                   void *parent,
+                   const char *parentKey,
+                   unsigned int flags,
+                   const char *start,
+                   size_t max,
+                   size_t maxBytes,
+                   void ***objs,
+                   size_t *nobjs,
+                   bool *more);
+
+void daemonListPageSnapshotFree(daemonListPageSnapshotPtr snapshot);
+
+#endif /* __LIBVIRTD_LISTPAGE_H__ */
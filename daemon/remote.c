@@ -117,6 +117,26 @@ remoteDispatchDomainEventSend(virNetServerClientPtr client,
                               xdrproc_t proc,
                               void *data);
 
+/*
+ * Whether the client asked for events of type @eventID about @dom,
+ * so that those of domains it doesn't watch aren't sent at all.
+ */
+static bool
+remoteRelayDomainEventWanted(virNetServerClientPtr client,
+                             int eventID,
+                             virDomainPtr dom)
+{
+    struct daemonClientPrivate *priv =
+        virNetServerClientGetPrivateData(client);
+    bool ret;
+
+    virMutexLock(&priv->lock);
+    ret = daemonEventFilterWanted(priv->domainEventFilter[eventID], dom->uuid);
+    virMutexUnlock(&priv->lock);
+
+    return ret;
+}
+
 static int remoteRelayDomainEventLifecycle(virConnectPtr conn ATTRIBUTE_UNUSED,
                                            virDomainPtr dom,
                                            int event,
@@ -129,6 +149,9 @@ static int remoteRelayDomainEventLifecycle(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_LIFECYCLE, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain lifecycle event %d %d", event, detail);
 
     /* build return data */
@@ -154,6 +177,9 @@ static int remoteRelayDomainEventReboot(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_REBOOT, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain reboot event %s %d", dom->name, dom->id);
 
     /* build return data */
@@ -179,6 +205,9 @@ static int remoteRelayDomainEventRTCChange(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_RTC_CHANGE, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain rtc change event %s %d %lld", dom->name, dom->id, offset);
 
     /* build return data */
@@ -205,6 +234,9 @@ static int remoteRelayDomainEventWatchdog(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_WATCHDOG, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain watchdog event %s %d %d", dom->name, dom->id, action);
 
     /* build return data */
@@ -233,6 +265,9 @@ static int remoteRelayDomainEventIOError(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_IO_ERROR, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain io error %s %d %s %s %d", dom->name, dom->id, srcPath, devAlias, action);
 
     /* build return data */
@@ -273,6 +308,9 @@ static int remoteRelayDomainEventIOErrorReason(virConnectPtr conn ATTRIBUTE_UNUS
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_IO_ERROR_REASON, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain io error %s %d %s %s %d %s",
               dom->name, dom->id, srcPath, devAlias, action, reason);
 
@@ -322,6 +360,9 @@ static int remoteRelayDomainEventGraphics(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_GRAPHICS, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain graphics event %s %d %d - %d %s %s  - %d %s %s - %s", dom->name, dom->id, phase,
               local->family, local->service, local->node,
               remote->family, remote->service, remote->node,
@@ -405,6 +446,9 @@ static int remoteRelayDomainEventBlockJob(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_BLOCK_JOB, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain block job event %s %d %s %i, %i",
               dom->name, dom->id, path, type, status);
 
@@ -440,6 +484,9 @@ static int remoteRelayDomainEventControlError(virConnectPtr conn ATTRIBUTE_UNUSE
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_CONTROL_ERROR, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain control error %s %d", dom->name, dom->id);
 
     /* build return data */
@@ -469,6 +516,9 @@ static int remoteRelayDomainEventDiskChange(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_DISK_CHANGE, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain %s %d disk change %s %s %s %d",
               dom->name, dom->id, oldSrcPath, newSrcPath, devAlias, reason);
 
@@ -517,6 +567,9 @@ static int remoteRelayDomainEventTrayChange(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_TRAY_CHANGE, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain %s %d tray change devAlias: %s reason: %d",
               dom->name, dom->id, devAlias, reason);
 
@@ -548,6 +601,9 @@ static int remoteRelayDomainEventPMWakeup(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_PMWAKEUP, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain %s %d system pmwakeup", dom->name, dom->id);
 
     /* build return data */
@@ -571,6 +627,9 @@ static int remoteRelayDomainEventPMSuspend(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_PMSUSPEND, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain %s %d system pmsuspend", dom->name, dom->id);
 
     /* build return data */
@@ -596,6 +655,9 @@ remoteRelayDomainEventBalloonChange(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_BALLOON_CHANGE, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain balloon change event %s %d %lld", dom->name, dom->id, actual);
 
     /* build return data */
@@ -621,6 +683,9 @@ static int remoteRelayDomainEventPMSuspendDisk(virConnectPtr conn ATTRIBUTE_UNUS
     if (!client)
         return -1;
 
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_PMSUSPEND_DISK, dom))
+        return 0;
+
     VIR_DEBUG("Relaying domain %s %d system pmsuspend-disk", dom->name, dom->id);
 
     /* build return data */
@@ -634,6 +699,41 @@ static int remoteRelayDomainEventPMSuspendDisk(virConnectPtr conn ATTRIBUTE_UNUS
     return 0;
 }
 
+static int
+remoteRelayDomainEventMigrationStalled(virConnectPtr conn ATTRIBUTE_UNUSED,
+                                       virDomainPtr dom,
+                                       unsigned long long iteration,
+                                       unsigned long long dirtyRate,
+                                       unsigned long long bandwidth,
+                                       void *opaque)
+{
+    virNetServerClientPtr client = opaque;
+    remote_domain_event_migration_stalled_msg data;
+
+    if (!client)
+        return -1;
+
+    if (!remoteRelayDomainEventWanted(client, VIR_DOMAIN_EVENT_ID_MIGRATION_STALLED, dom))
+        return 0;
+
+    VIR_DEBUG("Relaying domain migration stalled event %s %d %llu %llu %llu",
+              dom->name, dom->id, iteration, dirtyRate, bandwidth);
+
+    /* build return data */
+    memset(&data, 0, sizeof(data));
+    make_nonnull_domain(&data.dom, dom);
+    data.iteration = iteration;
+    data.dirtyRate = dirtyRate;
+    data.bandwidth = bandwidth;
+
+    remoteDispatchDomainEventSend(client, remoteProgram,
+                                  REMOTE_PROC_DOMAIN_EVENT_MIGRATION_STALLED,
+                                  (xdrproc_t)xdr_remote_domain_event_migration_stalled_msg, &data);
+
+    return 0;
+}
+
+
 
 static virConnectDomainEventGenericCallback domainEventCallbacks[] = {
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventLifecycle),
@@ -651,6 +751,7 @@ static virConnectDomainEventGenericCallback domainEventCallbacks[] = {
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventPMSuspend),
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventBalloonChange),
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventPMSuspendDisk),
+    VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventMigrationStalled),
 };
 
 verify(ARRAY_CARDINALITY(domainEventCallbacks) == VIR_DOMAIN_EVENT_ID_LAST);
@@ -665,10 +766,14 @@ verify(ARRAY_CARDINALITY(domainEventCallbacks) == VIR_DOMAIN_EVENT_ID_LAST);
 void remoteClientFreeFunc(void *data)
 {
     struct daemonClientPrivate *priv = data;
+    int i;
+
+    /* The listed objects hold references on the connection */
+    daemonListPageSnapshotFree(priv->listSnapshot);
+    priv->listSnapshot = NULL;
 
     /* Deregister event delivery callback */
     if (priv->conn) {
-        int i;
 
         for (i = 0 ; i < VIR_DOMAIN_EVENT_ID_LAST ; i++) {
             if (priv->domainEventCallbackID[i] != -1) {
@@ -682,6 +787,10 @@ void remoteClientFreeFunc(void *data)
         virConnectClose(priv->conn);
     }
 
+    for (i = 0 ; i < VIR_DOMAIN_EVENT_ID_LAST ; i++)
+        virHashFree(priv->domainEventFilter[i]);
+    daemonEventBatchClear(&priv->domainEventBatch);
+
     VIR_FREE(priv);
 }
 
@@ -713,6 +822,7 @@ void *remoteClientInitHook(virNetServerClientPtr client,
 
     for (i = 0 ; i < VIR_DOMAIN_EVENT_ID_LAST ; i++)
         priv->domainEventCallbackID[i] = -1;
+    priv->domainEventBatchTimer = -1;
 
     virNetServerClientSetCloseHook(client, remoteClientCloseFunc);
     return priv;
@@ -2358,6 +2468,57 @@ cleanup:
     return rv;
 }
 
+static int
+remoteDispatchDomainGetJobStats(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                virNetServerClientPtr client,
+                                virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                virNetMessageErrorPtr rerr,
+                                remote_domain_get_job_stats_args *args,
+                                remote_domain_get_job_stats_ret *ret)
+{
+    virDomainPtr dom = NULL;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    int rv = -1;
+    struct daemonClientPrivate *priv =
+        virNetServerClientGetPrivateData(client);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto cleanup;
+    }
+
+    if (!(dom = get_nonnull_domain(priv->conn, args->dom)))
+        goto cleanup;
+
+    if (virDomainGetJobStats(dom, &ret->type, &params,
+                             &nparams, args->flags) < 0)
+        goto cleanup;
+
+    if (nparams > REMOTE_DOMAIN_JOB_STATS_MAX) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Too many job stats '%d' for limit '%d'"),
+                       nparams, REMOTE_DOMAIN_JOB_STATS_MAX);
+        goto cleanup;
+    }
+
+    if (remoteSerializeTypedParameters(params, nparams,
+                                       &ret->params.params_val,
+                                       &ret->params.params_len,
+                                       VIR_TYPED_PARAM_STRING_OKAY) < 0)
+        goto cleanup;
+
+    rv = 0;
+
+cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    virTypedParamsFree(params, nparams);
+    if (dom)
+        virDomainFree(dom);
+    return rv;
+}
+
 /*-------------------------------------------------------------*/
 
 static int
@@ -3199,6 +3360,8 @@ remoteDispatchDomainEventsDeregister(virNetServerPtr server ATTRIBUTE_UNUSED,
         goto cleanup;
 
     priv->domainEventCallbackID[VIR_DOMAIN_EVENT_ID_LIFECYCLE] = -1;
+    virHashFree(priv->domainEventFilter[VIR_DOMAIN_EVENT_ID_LIFECYCLE]);
+    priv->domainEventFilter[VIR_DOMAIN_EVENT_ID_LIFECYCLE] = NULL;
 
     rv = 0;
 
@@ -3210,11 +3373,11 @@ cleanup:
 }
 
 static void
-remoteDispatchDomainEventSend(virNetServerClientPtr client,
-                              virNetServerProgramPtr program,
-                              int procnr,
-                              xdrproc_t proc,
-                              void *data)
+remoteDispatchDomainEventSendMessage(virNetServerClientPtr client,
+                                     virNetServerProgramPtr program,
+                                     int procnr,
+                                     xdrproc_t proc,
+                                     void *data)
 {
     virNetMessagePtr msg;
 
@@ -3245,6 +3408,77 @@ cleanup:
     xdr_free(proc, data);
 }
 
+static void
+remoteDomainEventBatchSend(int procnr,
+                           xdrproc_t proc,
+                           void *data,
+                           void *opaque)
+{
+    remoteDispatchDomainEventSendMessage(opaque, remoteProgram,
+                                         procnr, proc, data);
+}
+
+static void
+remoteDomainEventBatchTimer(int timer ATTRIBUTE_UNUSED,
+                            void *opaque)
+{
+    virNetServerClientPtr client = opaque;
+    struct daemonClientPrivate *priv =
+        virNetServerClientGetPrivateData(client);
+
+    virMutexLock(&priv->lock);
+    daemonEventBatchFlush(&priv->domainEventBatch,
+                          remoteDomainEventBatchSend, client);
+    virEventRemoveTimeout(priv->domainEventBatchTimer);
+    priv->domainEventBatchTimer = -1;
+    virMutexUnlock(&priv->lock);
+}
+
+static void
+remoteDispatchDomainEventSend(virNetServerClientPtr client,
+                              virNetServerProgramPtr program,
+                              int procnr,
+                              xdrproc_t proc,
+                              void *data)
+{
+    struct daemonClientPrivate *priv =
+        virNetServerClientGetPrivateData(client);
+
+    if (program != remoteProgram) {
+        remoteDispatchDomainEventSendMessage(client, program,
+                                             procnr, proc, data);
+        return;
+    }
+
+    /* Held while sending too, so that no other event can get in
+     * between a batch and an event sent after it */
+    virMutexLock(&priv->lock);
+
+    if (!priv->domainEventBatchSupported) {
+        remoteDispatchDomainEventSendMessage(client, program,
+                                             procnr, proc, data);
+        goto cleanup;
+    }
+
+    /* The batch is sent once the current round of event dispatching
+     * is over */
+    if (daemonEventBatchQueue(&priv->domainEventBatch, procnr, proc, data,
+                              remoteDomainEventBatchSend, client) > 0 &&
+        priv->domainEventBatchTimer < 0) {
+        virObjectRef(client);
+        if ((priv->domainEventBatchTimer =
+             virEventAddTimeout(0, remoteDomainEventBatchTimer,
+                                client, virObjectFreeCallback)) < 0) {
+            virObjectUnref(client);
+            daemonEventBatchFlush(&priv->domainEventBatch,
+                                  remoteDomainEventBatchSend, client);
+        }
+    }
+
+cleanup:
+    virMutexUnlock(&priv->lock);
+}
+
 static int
 remoteDispatchSecretGetValue(virNetServerPtr server ATTRIBUTE_UNUSED,
                              virNetServerClientPtr client ATTRIBUTE_UNUSED,
@@ -3402,16 +3636,89 @@ remoteDispatchDomainEventsDeregisterAny(virNetServerPtr server ATTRIBUTE_UNUSED,
         goto cleanup;
 
     priv->domainEventCallbackID[args->eventID] = -1;
+    virHashFree(priv->domainEventFilter[args->eventID]);
+    priv->domainEventFilter[args->eventID] = NULL;
+
+    rv = 0;
+
+cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    virMutexUnlock(&priv->lock);
+    return rv;
+}
+
+static int
+remoteDispatchDomainEventsFilter(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                 virNetServerClientPtr client,
+                                 virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                 virNetMessageErrorPtr rerr,
+                                 remote_domain_events_filter_args *args)
+{
+    virHashTablePtr filter = NULL;
+    int rv = -1;
+    struct daemonClientPrivate *priv =
+        virNetServerClientGetPrivateData(client);
+
+    virMutexLock(&priv->lock);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto cleanup;
+    }
+
+    if (args->eventID >= VIR_DOMAIN_EVENT_ID_LAST ||
+        args->eventID < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, _("unsupported event ID %d"), args->eventID);
+        goto cleanup;
+    }
+
+    if (!args->all &&
+        !(filter = daemonEventFilterNew(args->doms.doms_val,
+                                        args->doms.doms_len)))
+        goto cleanup;
+
+    VIR_DEBUG("Filtering event %d by %u domains",
+              args->eventID, args->all ? 0 : args->doms.doms_len);
+
+    virHashFree(priv->domainEventFilter[args->eventID]);
+    priv->domainEventFilter[args->eventID] = filter;
+    filter = NULL;
 
     rv = 0;
 
 cleanup:
     if (rv < 0)
         virNetMessageSaveError(rerr);
+    virHashFree(filter);
     virMutexUnlock(&priv->lock);
     return rv;
 }
 
+static int
+remoteDispatchDomainEventsBatch(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                virNetServerClientPtr client,
+                                virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                virNetMessageErrorPtr rerr ATTRIBUTE_UNUSED,
+                                remote_domain_events_batch_args *args)
+{
+    struct daemonClientPrivate *priv =
+        virNetServerClientGetPrivateData(client);
+
+    virMutexLock(&priv->lock);
+
+    VIR_DEBUG("%s event batches", args->enable ? "Enabling" : "Disabling");
+
+    /* What is already batched still goes out as a batch */
+    if (!args->enable)
+        daemonEventBatchFlush(&priv->domainEventBatch,
+                              remoteDomainEventBatchSend, client);
+    priv->domainEventBatchSupported = !!args->enable;
+
+    virMutexUnlock(&priv->lock);
+    return 0;
+}
+
 static int
 qemuDispatchMonitorCommand(virNetServerPtr server ATTRIBUTE_UNUSED,
                            virNetServerClientPtr client ATTRIBUTE_UNUSED,
@@ -3728,6 +4035,18 @@ static int remoteDispatchSupportsFeature(
         goto done;
     }
 
+    if (args->feature == VIR_DRV_FEATURE_PROGRAM_STREAM_ENCODING) {
+        supported = virNetMessageStreamEncodings();
+        goto done;
+    }
+
+    if (args->feature == VIR_DRV_FEATURE_PROGRAM_LIST_PAGES ||
+        args->feature == VIR_DRV_FEATURE_PROGRAM_DOMAIN_EVENT_FILTER ||
+        args->feature == VIR_DRV_FEATURE_PROGRAM_DOMAIN_EVENT_BATCH) {
+        supported = 1;
+        goto done;
+    }
+
     if (!priv->conn) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
         goto cleanup;
@@ -4506,63 +4825,619 @@ cleanup:
     return rv;
 }
 
-static int
-remoteDispatchNodeGetMemoryParameters(virNetServerPtr server ATTRIBUTE_UNUSED,
-                                      virNetServerClientPtr client ATTRIBUTE_UNUSED,
-                                      virNetMessagePtr msg ATTRIBUTE_UNUSED,
-                                      virNetMessageErrorPtr rerr,
-                                      remote_node_get_memory_parameters_args *args,
-                                      remote_node_get_memory_parameters_ret *ret)
-{
-    virTypedParameterPtr params = NULL;
-    int nparams = args->nparams;
-    unsigned int flags;
-    int rv = -1;
-    struct daemonClientPrivate *priv =
-        virNetServerClientGetPrivateData(client);
+/* Paged list replies are kept to half a message so that the
+ * remaining header and padding can never push them over the limit */
+#define REMOTE_LIST_PAGE_BYTES (VIR_NET_MESSAGE_MAX / 2)
 
-    if (!priv->conn) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
-        goto cleanup;
-    }
+/* How the objects of one paged list call are fetched and encoded */
+typedef struct _remoteListPageType remoteListPageType;
+struct _remoteListPageType {
+    daemonListPageOps ops;
+    size_t objsize;                 /* sizeof the remote_nonnull_* */
+    void (*make)(void *dst, void *obj);
+};
 
-    flags = args->flags;
+static size_t
+remoteListPageStringSize(const char *str)
+{
+    return 4 + VIR_DIV_UP(strlen(str), 4) * 4;
+}
 
-    if (nparams > REMOTE_NODE_MEMORY_PARAMETERS_MAX) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("nparams too large"));
-        goto cleanup;
-    }
-    if (nparams && VIR_ALLOC_N(params, nparams) < 0) {
-        virReportOOMError();
-        goto cleanup;
-    }
+static int
+remoteListPageDomains(void *parent, void ***objs, unsigned int flags)
+{
+    return virConnectListAllDomains(parent, (virDomainPtr **) objs, flags);
+}
 
+static const char *
+remoteListPageDomainKey(void *obj, char *buf ATTRIBUTE_UNUSED, size_t *size)
+{
+    virDomainPtr dom = obj;
 
-    if (virNodeGetMemoryParameters(priv->conn, params, &nparams, flags) < 0)
-        goto cleanup;
+    *size = remoteListPageStringSize(dom->name) + VIR_UUID_BUFLEN + 4;
+    return dom->name;
+}
 
-    /* In this case, we need to send back the number of parameters
-     * supported
-     */
-    if (args->nparams == 0) {
-        ret->nparams = nparams;
-        goto success;
-    }
+static void
+remoteListPageDomainMake(void *dst, void *obj)
+{
+    make_nonnull_domain(dst, obj);
+}
 
-    if (remoteSerializeTypedParameters(params, nparams,
-                                       &ret->params.params_val,
-                                       &ret->params.params_len,
-                                       args->flags) < 0)
-        goto cleanup;
+static const remoteListPageType remoteListPageDomainType = {
+    { remoteListPageDomains, remoteListPageDomainKey },
+    sizeof(remote_nonnull_domain), remoteListPageDomainMake,
+};
 
-success:
-    rv = 0;
+static int
+remoteListPageStoragePools(void *parent, void ***objs, unsigned int flags)
+{
+    return virConnectListAllStoragePools(parent, (virStoragePoolPtr **) objs,
+                                         flags);
+}
 
-cleanup:
-    if (rv < 0)
-        virNetMessageSaveError(rerr);
-    virTypedParamsFree(params, nparams);
-    return rv;
+static const char *
+remoteListPageStoragePoolKey(void *obj, char *buf ATTRIBUTE_UNUSED,
+                             size_t *size)
+{
+    virStoragePoolPtr pool = obj;
+
+    *size = remoteListPageStringSize(pool->name) + VIR_UUID_BUFLEN;
+    return pool->name;
+}
+
+static void
+remoteListPageStoragePoolMake(void *dst, void *obj)
+{
+    make_nonnull_storage_pool(dst, obj);
+}
+
+static const remoteListPageType remoteListPageStoragePoolType = {
+    { remoteListPageStoragePools, remoteListPageStoragePoolKey },
+    sizeof(remote_nonnull_storage_pool), remoteListPageStoragePoolMake,
+};
+
+static int
+remoteListPageStorageVols(void *parent, void ***objs, unsigned int flags)
+{
+    return virStoragePoolListAllVolumes(parent, (virStorageVolPtr **) objs,
+                                        flags);
+}
+
+static const char *
+remoteListPageStorageVolKey(void *obj, char *buf ATTRIBUTE_UNUSED,
+                            size_t *size)
+{
+    virStorageVolPtr vol = obj;
+
+    *size = remoteListPageStringSize(vol->pool) +
+        remoteListPageStringSize(vol->name) +
+        remoteListPageStringSize(vol->key);
+    return vol->name;
+}
+
+static void
+remoteListPageStorageVolMake(void *dst, void *obj)
+{
+    make_nonnull_storage_vol(dst, obj);
+}
+
+static const remoteListPageType remoteListPageStorageVolType = {
+    { remoteListPageStorageVols, remoteListPageStorageVolKey },
+    sizeof(remote_nonnull_storage_vol), remoteListPageStorageVolMake,
+};
+
+static int
+remoteListPageNetworks(void *parent, void ***objs, unsigned int flags)
+{
+    return virConnectListAllNetworks(parent, (virNetworkPtr **) objs, flags);
+}
+
+static const char *
+remoteListPageNetworkKey(void *obj, char *buf ATTRIBUTE_UNUSED, size_t *size)
+{
+    virNetworkPtr net = obj;
+
+    *size = remoteListPageStringSize(net->name) + VIR_UUID_BUFLEN;
+    return net->name;
+}
+
+static void
+remoteListPageNetworkMake(void *dst, void *obj)
+{
+    make_nonnull_network(dst, obj);
+}
+
+static const remoteListPageType remoteListPageNetworkType = {
+    { remoteListPageNetworks, remoteListPageNetworkKey },
+    sizeof(remote_nonnull_network), remoteListPageNetworkMake,
+};
+
+static int
+remoteListPageInterfaces(void *parent, void ***objs, unsigned int flags)
+{
+    return virConnectListAllInterfaces(parent, (virInterfacePtr **) objs,
+                                       flags);
+}
+
+static const char *
+remoteListPageInterfaceKey(void *obj, char *buf ATTRIBUTE_UNUSED,
+                           size_t *size)
+{
+    virInterfacePtr iface = obj;
+
+    *size = remoteListPageStringSize(iface->name) +
+        remoteListPageStringSize(iface->mac);
+    return iface->name;
+}
+
+static void
+remoteListPageInterfaceMake(void *dst, void *obj)
+{
+    make_nonnull_interface(dst, obj);
+}
+
+static const remoteListPageType remoteListPageInterfaceType = {
+    { remoteListPageInterfaces, remoteListPageInterfaceKey },
+    sizeof(remote_nonnull_interface), remoteListPageInterfaceMake,
+};
+
+static int
+remoteListPageNodeDevices(void *parent, void ***objs, unsigned int flags)
+{
+    return virConnectListAllNodeDevices(parent, (virNodeDevicePtr **) objs,
+                                        flags);
+}
+
+static const char *
+remoteListPageNodeDeviceKey(void *obj, char *buf ATTRIBUTE_UNUSED,
+                            size_t *size)
+{
+    virNodeDevicePtr dev = obj;
+
+    *size = remoteListPageStringSize(dev->name);
+    return dev->name;
+}
+
+static void
+remoteListPageNodeDeviceMake(void *dst, void *obj)
+{
+    make_nonnull_node_device(dst, obj);
+}
+
+static const remoteListPageType remoteListPageNodeDeviceType = {
+    { remoteListPageNodeDevices, remoteListPageNodeDeviceKey },
+    sizeof(remote_nonnull_node_device), remoteListPageNodeDeviceMake,
+};
+
+static int
+remoteListPageNWFilters(void *parent, void ***objs, unsigned int flags)
+{
+    return virConnectListAllNWFilters(parent, (virNWFilterPtr **) objs, flags);
+}
+
+static const char *
+remoteListPageNWFilterKey(void *obj, char *buf ATTRIBUTE_UNUSED,
+                          size_t *size)
+{
+    virNWFilterPtr nwfilter = obj;
+
+    *size = remoteListPageStringSize(nwfilter->name) + VIR_UUID_BUFLEN;
+    return nwfilter->name;
+}
+
+static void
+remoteListPageNWFilterMake(void *dst, void *obj)
+{
+    make_nonnull_nwfilter(dst, obj);
+}
+
+static const remoteListPageType remoteListPageNWFilterType = {
+    { remoteListPageNWFilters, remoteListPageNWFilterKey },
+    sizeof(remote_nonnull_nwfilter), remoteListPageNWFilterMake,
+};
+
+static int
+remoteListPageSecrets(void *parent, void ***objs, unsigned int flags)
+{
+    return virConnectListAllSecrets(parent, (virSecretPtr **) objs, flags);
+}
+
+/* Secrets have no name, so are ordered by UUID */
+static const char *
+remoteListPageSecretKey(void *obj, char *buf, size_t *size)
+{
+    virSecretPtr secret = obj;
+
+    *size = VIR_UUID_BUFLEN + 4 + remoteListPageStringSize(secret->usageID);
+    return virUUIDFormat(secret->uuid, buf);
+}
+
+static void
+remoteListPageSecretMake(void *dst, void *obj)
+{
+    make_nonnull_secret(dst, obj);
+}
+
+static const remoteListPageType remoteListPageSecretType = {
+    { remoteListPageSecrets, remoteListPageSecretKey },
+    sizeof(remote_nonnull_secret), remoteListPageSecretMake,
+};
+
+/*
+ * Fill @val and @len with the page of the objects of @type below
+ * @parent which follows @start, setting @more if pages remain. The
+ * sorted listing is kept in @priv between the pages of one client,
+ * so paging through N objects only lists them once rather than once
+ * per page.
+ */
+static int
+remoteDispatchListPage(struct daemonClientPrivate *priv,
+                       const remoteListPageType *type,
+                       void *parent,
+                       const char *parentKey,
+                       char **start,
+                       unsigned int max,
+                       unsigned int flags,
+                       void **val,
+                       u_int *len,
+                       int *more)
+{
+    daemonListPageSnapshotPtr snapshot;
+    void **objs;
+    size_t nobjs;
+    bool hasMore = false;
+    size_t i;
+    int rv = -1;
+
+    if (max == 0 || max > REMOTE_LIST_PAGE_MAX)
+        max = REMOTE_LIST_PAGE_MAX;
+
+    /* Listing may take a while, so don't hold the lock meanwhile */
+    virMutexLock(&priv->lock);
+    snapshot = priv->listSnapshot;
+    priv->listSnapshot = NULL;
+    virMutexUnlock(&priv->lock);
+
+    if (daemonListPage(&snapshot, &type->ops, parent, parentKey, flags,
+                       start ? *start : NULL, max, REMOTE_LIST_PAGE_BYTES,
+                       &objs, &nobjs, &hasMore) < 0)
+        goto cleanup;
+
+    if (nobjs) {
+        if (virAllocN(val, type->objsize, nobjs) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+
+        for (i = 0; i < nobjs; i++)
+            type->make((char *) *val + i * type->objsize, objs[i]);
+    }
+
+    *len = nobjs;
+    *more = hasMore;
+    rv = 0;
+
+cleanup:
+    /* Nothing left to page through */
+    if (rv < 0 || !hasMore) {
+        daemonListPageSnapshotFree(snapshot);
+        snapshot = NULL;
+    }
+
+    virMutexLock(&priv->lock);
+    daemonListPageSnapshotFree(priv->listSnapshot);
+    priv->listSnapshot = snapshot;
+    virMutexUnlock(&priv->lock);
+    return rv;
+}
+
+static int
+remoteDispatchConnectListAllDomainsPaged(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                         virNetServerClientPtr client,
+                                         virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                         virNetMessageErrorPtr rerr,
+                                         remote_connect_list_all_domains_paged_args *args,
+                                         remote_connect_list_all_domains_paged_ret *ret)
+{
+    void *val = NULL;
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto error;
+    }
+
+    if (remoteDispatchListPage(priv, &remoteListPageDomainType, priv->conn,
+                               NULL, args->start, args->max, args->flags,
+                               &val, &ret->domains.domains_len,
+                               &ret->more) < 0)
+        goto error;
+
+    ret->domains.domains_val = val;
+    return 0;
+
+error:
+    virNetMessageSaveError(rerr);
+    return -1;
+}
+
+static int
+remoteDispatchConnectListAllStoragePoolsPaged(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                              virNetServerClientPtr client,
+                                              virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                              virNetMessageErrorPtr rerr,
+                                              remote_connect_list_all_storage_pools_paged_args *args,
+                                              remote_connect_list_all_storage_pools_paged_ret *ret)
+{
+    void *val = NULL;
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto error;
+    }
+
+    if (remoteDispatchListPage(priv, &remoteListPageStoragePoolType,
+                               priv->conn, NULL, args->start, args->max,
+                               args->flags, &val, &ret->pools.pools_len,
+                               &ret->more) < 0)
+        goto error;
+
+    ret->pools.pools_val = val;
+    return 0;
+
+error:
+    virNetMessageSaveError(rerr);
+    return -1;
+}
+
+static int
+remoteDispatchStoragePoolListAllVolumesPaged(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                             virNetServerClientPtr client,
+                                             virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                             virNetMessageErrorPtr rerr,
+                                             remote_storage_pool_list_all_volumes_paged_args *args,
+                                             remote_storage_pool_list_all_volumes_paged_ret *ret)
+{
+    virStoragePoolPtr pool = NULL;
+    void *val = NULL;
+    int rv = -1;
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto cleanup;
+    }
+
+    if (!(pool = get_nonnull_storage_pool(priv->conn, args->pool)))
+        goto cleanup;
+
+    /* The pool is looked up afresh on every page, so its listing is
+     * told apart from the other pools' by name */
+    if (remoteDispatchListPage(priv, &remoteListPageStorageVolType, pool,
+                               pool->name, args->start, args->max,
+                               args->flags, &val, &ret->vols.vols_len,
+                               &ret->more) < 0)
+        goto cleanup;
+
+    ret->vols.vols_val = val;
+    rv = 0;
+
+cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    if (pool)
+        virStoragePoolFree(pool);
+    return rv;
+}
+
+static int
+remoteDispatchConnectListAllNetworksPaged(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                          virNetServerClientPtr client,
+                                          virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                          virNetMessageErrorPtr rerr,
+                                          remote_connect_list_all_networks_paged_args *args,
+                                          remote_connect_list_all_networks_paged_ret *ret)
+{
+    void *val = NULL;
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto error;
+    }
+
+    if (remoteDispatchListPage(priv, &remoteListPageNetworkType, priv->conn,
+                               NULL, args->start, args->max, args->flags,
+                               &val, &ret->nets.nets_len, &ret->more) < 0)
+        goto error;
+
+    ret->nets.nets_val = val;
+    return 0;
+
+error:
+    virNetMessageSaveError(rerr);
+    return -1;
+}
+
+static int
+remoteDispatchConnectListAllInterfacesPaged(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                            virNetServerClientPtr client,
+                                            virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                            virNetMessageErrorPtr rerr,
+                                            remote_connect_list_all_interfaces_paged_args *args,
+                                            remote_connect_list_all_interfaces_paged_ret *ret)
+{
+    void *val = NULL;
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto error;
+    }
+
+    if (remoteDispatchListPage(priv, &remoteListPageInterfaceType,
+                               priv->conn, NULL, args->start, args->max,
+                               args->flags, &val, &ret->ifaces.ifaces_len,
+                               &ret->more) < 0)
+        goto error;
+
+    ret->ifaces.ifaces_val = val;
+    return 0;
+
+error:
+    virNetMessageSaveError(rerr);
+    return -1;
+}
+
+static int
+remoteDispatchConnectListAllNodeDevicesPaged(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                             virNetServerClientPtr client,
+                                             virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                             virNetMessageErrorPtr rerr,
+                                             remote_connect_list_all_node_devices_paged_args *args,
+                                             remote_connect_list_all_node_devices_paged_ret *ret)
+{
+    void *val = NULL;
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto error;
+    }
+
+    if (remoteDispatchListPage(priv, &remoteListPageNodeDeviceType,
+                               priv->conn, NULL, args->start, args->max,
+                               args->flags, &val, &ret->devices.devices_len,
+                               &ret->more) < 0)
+        goto error;
+
+    ret->devices.devices_val = val;
+    return 0;
+
+error:
+    virNetMessageSaveError(rerr);
+    return -1;
+}
+
+static int
+remoteDispatchConnectListAllNWFiltersPaged(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                           virNetServerClientPtr client,
+                                           virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                           virNetMessageErrorPtr rerr,
+                                           remote_connect_list_all_nwfilters_paged_args *args,
+                                           remote_connect_list_all_nwfilters_paged_ret *ret)
+{
+    void *val = NULL;
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto error;
+    }
+
+    if (remoteDispatchListPage(priv, &remoteListPageNWFilterType,
+                               priv->conn, NULL, args->start, args->max,
+                               args->flags, &val, &ret->filters.filters_len,
+                               &ret->more) < 0)
+        goto error;
+
+    ret->filters.filters_val = val;
+    return 0;
+
+error:
+    virNetMessageSaveError(rerr);
+    return -1;
+}
+
+static int
+remoteDispatchConnectListAllSecretsPaged(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                         virNetServerClientPtr client,
+                                         virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                         virNetMessageErrorPtr rerr,
+                                         remote_connect_list_all_secrets_paged_args *args,
+                                         remote_connect_list_all_secrets_paged_ret *ret)
+{
+    void *val = NULL;
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto error;
+    }
+
+    if (remoteDispatchListPage(priv, &remoteListPageSecretType, priv->conn,
+                               NULL, args->start, args->max, args->flags,
+                               &val, &ret->secrets.secrets_len,
+                               &ret->more) < 0)
+        goto error;
+
+    ret->secrets.secrets_val = val;
+    return 0;
+
+error:
+    virNetMessageSaveError(rerr);
+    return -1;
+}
+
+static int
+remoteDispatchNodeGetMemoryParameters(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                      virNetServerClientPtr client ATTRIBUTE_UNUSED,
+                                      virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                      virNetMessageErrorPtr rerr,
+                                      remote_node_get_memory_parameters_args *args,
+                                      remote_node_get_memory_parameters_ret *ret)
+{
+    virTypedParameterPtr params = NULL;
+    int nparams = args->nparams;
+    unsigned int flags;
+    int rv = -1;
+    struct daemonClientPrivate *priv =
+        virNetServerClientGetPrivateData(client);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto cleanup;
+    }
+
+    flags = args->flags;
+
+    if (nparams > REMOTE_NODE_MEMORY_PARAMETERS_MAX) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("nparams too large"));
+        goto cleanup;
+    }
+    if (nparams && VIR_ALLOC_N(params, nparams) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+
+    if (virNodeGetMemoryParameters(priv->conn, params, &nparams, flags) < 0)
+        goto cleanup;
+
+    /* In this case, we need to send back the number of parameters
+     * supported
+     */
+    if (args->nparams == 0) {
+        ret->nparams = nparams;
+        goto success;
+    }
+
+    if (remoteSerializeTypedParameters(params, nparams,
+                                       &ret->params.params_val,
+                                       &ret->params.params_len,
+                                       args->flags) < 0)
+        goto cleanup;
+
+success:
+    rv = 0;
+
+cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    virTypedParamsFree(params, nparams);
+    return rv;
 }
 
 static int
@@ -4612,6 +5487,221 @@ cleanup:
     return rv;
 }
 
+static int
+remoteDispatchConnectGetAllDomainStats(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                       virNetServerClientPtr client,
+                                       virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                       virNetMessageErrorPtr rerr,
+                                       remote_connect_get_all_domain_stats_args *args,
+                                       remote_connect_get_all_domain_stats_ret *ret)
+{
+    int rv = -1;
+    int i;
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+    virDomainStatsRecordPtr *retStats = NULL;
+    int nrecords = 0;
+    virDomainPtr *doms = NULL;
+    unsigned int ndoms = 0;
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto cleanup;
+    }
+
+    if (args->doms.doms_len) {
+        /* NULL terminated, as virDomainListGetStats expects */
+        if (VIR_ALLOC_N(doms, args->doms.doms_len + 1) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+
+        for (ndoms = 0; ndoms < args->doms.doms_len; ndoms++) {
+            if (!(doms[ndoms] = get_nonnull_domain(priv->conn,
+                                                   args->doms.doms_val[ndoms])))
+                goto cleanup;
+        }
+
+        if ((nrecords = virDomainListGetStats(doms,
+                                              args->stats,
+                                              &retStats,
+                                              args->flags)) < 0)
+            goto cleanup;
+    } else {
+        if ((nrecords = virConnectGetAllDomainStats(priv->conn,
+                                                    args->stats,
+                                                    &retStats,
+                                                    args->flags)) < 0)
+            goto cleanup;
+    }
+
+    if (nrecords > REMOTE_DOMAIN_LIST_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("Too many domain stats records '%d' for limit '%d'"),
+                       nrecords, REMOTE_DOMAIN_LIST_MAX);
+        goto cleanup;
+    }
+
+    if (nrecords) {
+        if (VIR_ALLOC_N(ret->retStats.retStats_val, nrecords) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+
+        ret->retStats.retStats_len = nrecords;
+
+        for (i = 0; i < nrecords; i++) {
+            remote_domain_stats_record *dst = ret->retStats.retStats_val + i;
+
+            make_nonnull_domain(&dst->dom, retStats[i]->dom);
+
+            if (retStats[i]->nparams > REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX) {
+                virReportError(VIR_ERR_RPC,
+                               _("Too many stats '%d' for limit '%d'"),
+                               retStats[i]->nparams,
+                               REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX);
+                goto cleanup;
+            }
+
+            if (remoteSerializeTypedParameters(retStats[i]->params,
+                                               retStats[i]->nparams,
+                                               &dst->params.params_val,
+                                               &dst->params.params_len,
+                                               VIR_TYPED_PARAM_STRING_OKAY) < 0)
+                goto cleanup;
+        }
+    } else {
+        ret->retStats.retStats_len = 0;
+        ret->retStats.retStats_val = NULL;
+    }
+
+    rv = 0;
+
+cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+
+    virDomainStatsRecordListFree(retStats);
+    if (doms) {
+        for (i = 0; i < ndoms; i++)
+            virDomainFree(doms[i]);
+        VIR_FREE(doms);
+    }
+
+    return rv;
+}
+
+/* Append the call statistics of @prog to @params */
+static int
+remoteAddProgramStats(virNetServerProgramPtr prog,
+                      const char *prefix,
+                      virTypedParameterPtr *params,
+                      int *nparams,
+                      int *maxparams)
+{
+    virNetServerProgramProcStatsPtr stats = NULL;
+    size_t nstats = 0;
+    size_t i, j;
+    int ret = -1;
+
+    if (!prog)
+        return 0;
+
+    if (virNetServerProgramGetStats(prog, &stats, &nstats) < 0)
+        return -1;
+
+#define ADD_STAT(field, value)                                          \
+    do {                                                                \
+        char name[VIR_TYPED_PARAM_FIELD_LENGTH];                        \
+        snprintf(name, sizeof(name), "%s.%s.%s", prefix, procname, field); \
+        if (virTypedParamsAddULLong(params, nparams, maxparams,         \
+                                    name, value) < 0)                   \
+            goto cleanup;                                               \
+    } while (0)
+
+    for (i = 0; i < nstats; i++) {
+        const char *procname = virNetServerProgramGetProcName(prog, i);
+        unsigned long long limit = 10;
+
+        if (!procname || !stats[i].calls)
+            continue;
+
+        ADD_STAT("calls", stats[i].calls);
+        ADD_STAT("errors", stats[i].errors);
+        ADD_STAT("wait.total", stats[i].waitTotal);
+        ADD_STAT("wait.max", stats[i].waitMax);
+        ADD_STAT("exec.total", stats[i].execTotal);
+        ADD_STAT("exec.max", stats[i].execMax);
+
+        for (j = 0; j < VIR_NET_SERVER_PROGRAM_HIST_BUCKETS; j++) {
+            char field[32];
+
+            if (j == VIR_NET_SERVER_PROGRAM_HIST_BUCKETS - 1)
+                snprintf(field, sizeof(field), "exec.hist.inf");
+            else
+                snprintf(field, sizeof(field), "exec.hist.%llu", limit);
+            ADD_STAT(field, stats[i].execHist[j]);
+            limit *= 10;
+        }
+
+        ADD_STAT("reply.bytes", stats[i].replyBytes);
+        ADD_STAT("reply.max", stats[i].replyBytesMax);
+    }
+
+#undef ADD_STAT
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(stats);
+    return ret;
+}
+
+static int
+remoteDispatchConnectGetRPCStats(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                 virNetServerClientPtr client ATTRIBUTE_UNUSED,
+                                 virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                 virNetMessageErrorPtr rerr,
+                                 remote_connect_get_rpc_stats_args *args,
+                                 remote_connect_get_rpc_stats_ret *ret)
+{
+    int rv = -1;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    int maxparams = 0;
+    unsigned int flags = args->flags;
+
+    virCheckFlagsGoto(0, cleanup);
+
+    if (remoteAddProgramStats(remoteProgram, "remote",
+                              &params, &nparams, &maxparams) < 0 ||
+        remoteAddProgramStats(qemuProgram, "qemu",
+                              &params, &nparams, &maxparams) < 0 ||
+        remoteAddProgramStats(lxcProgram, "lxc",
+                              &params, &nparams, &maxparams) < 0)
+        goto cleanup;
+
+    if (nparams > REMOTE_CONNECT_GET_RPC_STATS_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("Too many RPC stats '%d' for limit '%d'"),
+                       nparams, REMOTE_CONNECT_GET_RPC_STATS_MAX);
+        goto cleanup;
+    }
+
+    if (remoteSerializeTypedParameters(params, nparams,
+                                       &ret->params.params_val,
+                                       &ret->params.params_len,
+                                       0) < 0)
+        goto cleanup;
+
+    rv = 0;
+
+cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    virTypedParamsFree(params, nparams);
+    return rv;
+}
+
 static int
 lxcDispatchDomainOpenNamespace(virNetServerPtr server ATTRIBUTE_UNUSED,
                                virNetServerClientPtr client ATTRIBUTE_UNUSED,
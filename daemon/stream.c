@@ -29,6 +29,7 @@
 #include "virlog.h"
 #include "virnetserverclient.h"
 #include "virerror.h"
+#include "fdstream.h"
 
 #define VIR_FROM_THIS VIR_FROM_STREAMS
 
@@ -50,6 +51,9 @@ struct daemonClientStream {
     virNetMessagePtr rx;
     int tx;
 
+    /* Encodes the data sent to the client, if it asked for it */
+    virNetMessageStreamCodecPtr codec;
+
     daemonClientStreamPtr next;
 };
 
@@ -64,6 +68,10 @@ daemonStreamHandleFinish(virNetServerClientPtr client,
                          daemonClientStream *stream,
                          virNetMessagePtr msg);
 static int
+daemonStreamHandleEncoding(virNetServerClientPtr client,
+                           daemonClientStream *stream,
+                           virNetMessagePtr msg);
+static int
 daemonStreamHandleAbort(virNetServerClientPtr client,
                         daemonClientStream *stream,
                         virNetMessagePtr msg);
@@ -153,13 +161,18 @@ daemonStreamEvent(virStreamPtr st, int events, void *opaque)
     /* If we have a completion/abort message, always process it */
     if (stream->rx) {
         virNetMessagePtr msg = stream->rx;
+        int ret;
         switch (msg->header.status) {
         case VIR_NET_CONTINUE:
             /* nada */
             break;
         case VIR_NET_OK:
             virNetMessageQueueServe(&stream->rx);
-            if (daemonStreamHandleFinish(client, stream, msg) < 0) {
+            if (msg->header.type == VIR_NET_STREAM_ENCODED)
+                ret = daemonStreamHandleEncoding(client, stream, msg);
+            else
+                ret = daemonStreamHandleFinish(client, stream, msg);
+            if (ret < 0) {
                 virNetMessageFree(msg);
                 daemonRemoveClientStream(client, stream);
                 virNetServerClientClose(client);
@@ -202,7 +215,7 @@ daemonStreamEvent(virStreamPtr st, int events, void *opaque)
                                               msg,
                                               stream->procedure,
                                               stream->serial,
-                                              "", 0) < 0) {
+                                              NULL, "", 0) < 0) {
             virNetMessageFree(msg);
             daemonRemoveClientStream(client, stream);
             virNetServerClientClose(client);
@@ -273,7 +286,8 @@ daemonStreamFilter(virNetServerClientPtr client ATTRIBUTE_UNUSED,
 
     virMutexLock(&stream->priv->lock);
 
-    if (msg->header.type != VIR_NET_STREAM)
+    if (msg->header.type != VIR_NET_STREAM &&
+        msg->header.type != VIR_NET_STREAM_ENCODED)
         goto cleanup;
 
     if (!virNetServerProgramMatches(stream->prog, msg))
@@ -375,6 +389,7 @@ int daemonFreeClientStream(virNetServerClientPtr client,
         msg = tmp;
     }
 
+    virNetMessageStreamCodecFree(stream->codec);
     virStreamFree(stream->st);
     VIR_FREE(stream);
 
@@ -511,9 +526,14 @@ daemonStreamHandleWriteData(virNetServerClientPtr client,
               client, stream, msg->header.proc, msg->header.serial,
               msg->bufferLength, msg->bufferOffset);
 
-    ret = virStreamSend(stream->st,
-                        msg->buffer + msg->bufferOffset,
-                        msg->bufferLength - msg->bufferOffset);
+    /* Encoded data is decoded in place the first time round */
+    if (msg->header.type == VIR_NET_STREAM_ENCODED &&
+        virNetMessageDecodeStreamData(msg) < 0)
+        ret = -1;
+    else
+        ret = virStreamSend(stream->st,
+                            msg->buffer + msg->bufferOffset,
+                            msg->bufferLength - msg->bufferOffset);
 
     if (ret > 0) {
         msg->bufferOffset += ret;
@@ -579,11 +599,50 @@ daemonStreamHandleFinish(virNetServerClientPtr client,
                                                  msg,
                                                  stream->procedure,
                                                  stream->serial,
-                                                 NULL, 0);
+                                                 NULL, NULL, 0);
     }
 }
 
 
+/*
+ * Process a request from the client to encode the data we send
+ * on the stream. Failing to set up the encoding is not an error,
+ * the data is then sent raw, which the client always accepts.
+ *
+ * Returns 0 if the message was released, -1 upon fatal error
+ */
+static int
+daemonStreamHandleEncoding(virNetServerClientPtr client,
+                           daemonClientStream *stream,
+                           virNetMessagePtr msg)
+{
+    virNetStreamEncodingRequest req;
+    virNetMessageStreamCodecPtr codec = NULL;
+
+    VIR_DEBUG("client=%p, stream=%p, proc=%d, serial=%d",
+              client, stream, msg->header.proc, msg->header.serial);
+
+    memset(&req, 0, sizeof(req));
+    if (virNetMessageDecodePayload(msg,
+                                   (xdrproc_t)xdr_virNetStreamEncodingRequest,
+                                   &req) < 0 ||
+        !(codec = virNetMessageStreamCodecNew(req.encoding, req.level))) {
+        virErrorPtr err = virGetLastError();
+        VIR_WARN("Sending raw stream data: %s",
+                 err && err->message ? err->message : _("unknown error"));
+        virResetLastError();
+    } else {
+        virNetMessageStreamCodecFree(stream->codec);
+        stream->codec = codec;
+    }
+
+    /* Send a dummy reply to free up 'msg' & unblock client rx */
+    virNetMessageClear(msg);
+    msg->header.type = VIR_NET_REPLY;
+    return virNetServerClientSendMessage(client, msg);
+}
+
+
 /*
  * Process an abort request from the client.
  *
@@ -642,7 +701,10 @@ daemonStreamHandleWrite(virNetServerClientPtr client,
 
         switch (msg->header.status) {
         case VIR_NET_OK:
-            ret = daemonStreamHandleFinish(client, stream, msg);
+            if (msg->header.type == VIR_NET_STREAM_ENCODED)
+                ret = daemonStreamHandleEncoding(client, stream, msg);
+            else
+                ret = daemonStreamHandleFinish(client, stream, msg);
             break;
 
         case VIR_NET_CONTINUE:
@@ -701,9 +763,11 @@ static int
 daemonStreamHandleRead(virNetServerClientPtr client,
                        daemonClientStream *stream)
 {
-    char *buffer;
+    virNetMessagePtr msg;
+    char *buffer = NULL;
     size_t bufferLen = VIR_NET_MESSAGE_PAYLOAD_MAX;
-    int ret;
+    int spliceFd = -1;
+    int ret = 0;
 
     VIR_DEBUG("client=%p, stream=%p tx=%d closed=%d",
               client, stream, stream->tx, stream->closed);
@@ -720,50 +784,67 @@ daemonStreamHandleRead(virNetServerClientPtr client,
     if (!stream->tx)
         return 0;
 
-    if (VIR_ALLOC_N(buffer, bufferLen) < 0)
+    if (!(msg = virNetMessageNew(false)))
         return -1;
 
-    ret = virStreamRecv(stream->st, buffer, bufferLen);
+    /* On a plain socket, data the stream has waiting in a pipe
+     * goes from there to the client without being read in here */
+    if (!stream->codec &&
+        virNetServerClientCanSplice(client))
+        ret = virFDStreamSpliceSource(stream->st, bufferLen, &spliceFd);
+
+    if (ret == 0) {
+        /* Read straight into the message, so the data is sent
+         * from where the stream put it */
+        if (!(buffer = virNetMessageReservePayload(msg, bufferLen))) {
+            virNetMessageFree(msg);
+            return -1;
+        }
+
+        ret = virStreamRecv(stream->st, buffer, bufferLen);
+    }
+
     if (ret == -2) {
         /* Should never get this, since we're only called when we know
          * we're readable, but hey things change... */
         ret = 0;
+        virNetMessageFree(msg);
     } else if (ret < 0) {
-        virNetMessagePtr msg;
         virNetMessageError rerr;
 
         memset(&rerr, 0, sizeof(rerr));
 
-        if (!(msg = virNetMessageNew(false)))
-            ret = -1;
-        else
-            ret = virNetServerProgramSendStreamError(remoteProgram,
-                                                     client,
-                                                     msg,
-                                                     &rerr,
-                                                     stream->procedure,
-                                                     stream->serial);
+        virNetMessageClear(msg);
+        ret = virNetServerProgramSendStreamError(remoteProgram,
+                                                 client,
+                                                 msg,
+                                                 &rerr,
+                                                 stream->procedure,
+                                                 stream->serial);
     } else {
-        virNetMessagePtr msg;
         stream->tx = 0;
         if (ret == 0)
             stream->recvEOF = 1;
-        if (!(msg = virNetMessageNew(false)))
-            ret = -1;
 
-        if (msg) {
-            msg->cb = daemonStreamMessageFinished;
-            msg->opaque = stream;
-            stream->refs++;
+        msg->cb = daemonStreamMessageFinished;
+        msg->opaque = stream;
+        stream->refs++;
+        if (spliceFd >= 0)
+            ret = virNetServerProgramSendStreamSplice(remoteProgram,
+                                                      client,
+                                                      msg,
+                                                      stream->procedure,
+                                                      stream->serial,
+                                                      spliceFd, ret);
+        else
             ret = virNetServerProgramSendStreamData(remoteProgram,
                                                     client,
                                                     msg,
                                                     stream->procedure,
                                                     stream->serial,
+                                                    stream->codec,
                                                     buffer, ret);
-        }
     }
 
-    VIR_FREE(buffer);
     return ret;
 }
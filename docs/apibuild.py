@@ -62,6 +62,7 @@ ignored_functions = {
   "virDomainMigratePrepare3": "private function for migration",
   "virDomainMigrateConfirm3": "private function for migration",
   "virDomainMigratePrepareTunnel3": "private function for tunnelled migration",
+  "virDomainMigratePrepareTunnelStream": "private function for tunnelled migration",
   "virDrvSupportsFeature": "private function for remote access",
   "DllMain": "specific function for Win32",
   "virEventAddHandle": "internal function in virevent.c",
@@ -2065,10 +2066,11 @@ class docBuilder:
             info = id.info
             if info[0] != None and info[0] != '':
                 try:
-                    val = eval(info[0])
+                    # Python has no unsigned suffix, as in 1U << 31
+                    val = eval(re.sub(r"\b(\d+)U\b", r"\1", info[0]))
                 except:
                     val = info[0]
-                output.write(" value='%s'" % (val));
+                output.write(" value='%s'" % escape(str(val)));
             if info[2] != None and info[2] != '':
                 output.write(" type='%s'" % info[2]);
             if info[1] != None and info[1] != '':
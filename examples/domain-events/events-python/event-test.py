@@ -495,6 +495,9 @@ def myDomainEventBalloonChangeCallback(conn, dom, actual, opaque):
 def myDomainEventPMSuspendDiskCallback(conn, dom, reason, opaque):
     print "myDomainEventPMSuspendDiskCallback: Domain %s(%s) system pmsuspend_disk" % (
             dom.name(), dom.ID())
+def myDomainEventMigrationStalledCallback(conn, dom, iteration, dirtyRate, bandwidth, opaque):
+    print "myDomainEventMigrationStalledCallback: Domain %s(%s) iteration %d dirty rate %d bandwidth %d" % (
+            dom.name(), dom.ID(), iteration, dirtyRate, bandwidth)
 
 run = True
 
@@ -570,6 +573,7 @@ def main():
     vc.domainEventRegisterAny(None, libvirt.VIR_DOMAIN_EVENT_ID_PMSUSPEND, myDomainEventPMSuspendCallback, None)
     vc.domainEventRegisterAny(None, libvirt.VIR_DOMAIN_EVENT_ID_BALLOON_CHANGE, myDomainEventBalloonChangeCallback, None)
     vc.domainEventRegisterAny(None, libvirt.VIR_DOMAIN_EVENT_ID_PMSUSPEND_DISK, myDomainEventPMSuspendDiskCallback, None)
+    vc.domainEventRegisterAny(None, libvirt.VIR_DOMAIN_EVENT_ID_MIGRATION_STALLED, myDomainEventMigrationStalledCallback, None)
 
     vc.setKeepAlive(5, 3)
 
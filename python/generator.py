@@ -454,6 +454,8 @@ skip_impl = (
     'virNodeGetMemoryParameters',
     'virNodeSetMemoryParameters',
     'virNodeGetCPUMap',
+    'virConnectGetRPCStats',
+    'virDomainGetJobStats',
 )
 
 lxc_skip_impl = (
@@ -498,6 +500,12 @@ skip_function = (
     'virConnectListAllNodeDevices', # overridden in virConnect.py
     'virConnectListAllNWFilters', # overridden in virConnect.py
     'virConnectListAllSecrets', # overridden in virConnect.py
+    'virConnectGetAllDomainStats', # overridden in virConnect.py
+    'virDomainListGetStats', # overridden in virConnect.py
+    'virDomainStatsRecordListFree', # only useful in C, python uses lists
+    'virDomainGetInfoAsync', # overridden in virDomain.py
+    'virDomainBlockStatsAsync', # overridden in virDomain.py
+    'virDomainInterfaceStatsAsync', # overridden in virDomain.py
 
     'virStreamRecvAll', # Pure python libvirt-override-virStream.py
     'virStreamSendAll', # Pure python libvirt-override-virStream.py
@@ -1717,6 +1725,19 @@ def buildWrappers(module):
             except:
                 pass
 
+    #
+    # Resolve enum constants defined as another constant, such as
+    # VIR_CONNECT_GET_ALL_DOMAINS_STATS_ACTIVE
+    #
+    values = {}
+    for enum in enums.values():
+        values.update(enum)
+    for enum in enums.values():
+        for name,value in enum.items():
+            while values.has_key(value):
+                value = values[value]
+            enum[name] = value
+
     #
     # Generate enum constants
     #
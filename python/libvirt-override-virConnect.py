@@ -179,6 +179,15 @@
         cb(self, virDomain(self, _obj=dom), reason, opaque)
         return 0;
 
+    def _dispatchDomainEventMigrationStalledCallback(self, dom, iteration, dirtyRate, bandwidth, cbData):
+        """Dispatches events to python user domain migration stalled event callbacks
+        """
+        cb = cbData["cb"]
+        opaque = cbData["opaque"]
+
+        cb(self, virDomain(self, _obj=dom), iteration, dirtyRate, bandwidth, opaque)
+        return 0
+
     def domainEventDeregisterAny(self, callbackID):
         """Removes a Domain Event Callback. De-registering for a
            domain callback will disable delivery of this event type """
@@ -288,6 +297,39 @@
 
         return retlist
 
+    def getAllDomainStats(self, stats = 0, flags = 0):
+        """Query statistics for all domains on a given connection.
+           Returns a list of (domain object, dictionary of stats) tuples"""
+        ret = libvirtmod.virConnectGetAllDomainStats(self._o, stats, flags)
+        if ret is None:
+            raise libvirtError("virConnectGetAllDomainStats() failed", conn=self)
+
+        retlist = list()
+        for elem in ret:
+            retlist.append((virDomain(self, _obj=elem[0]), elem[1]))
+
+        return retlist
+
+    def domainListGetStats(self, doms, stats = 0, flags = 0):
+        """Query statistics for the given list of domain objects.
+           Returns a list of (domain object, dictionary of stats) tuples"""
+        domlist = list()
+        for dom in doms:
+            if not isinstance(dom, virDomain):
+                raise libvirtError("domain list contains non-domain elements", conn=self)
+
+            domlist.append(dom._o)
+
+        ret = libvirtmod.virDomainListGetStats(domlist, stats, flags)
+        if ret is None:
+            raise libvirtError("virDomainListGetStats() failed", conn=self)
+
+        retlist = list()
+        for elem in ret:
+            retlist.append((virDomain(self, _obj=elem[0]), elem[1]))
+
+        return retlist
+
     def _dispatchCloseCallback(self, reason, cbData):
         """Dispatches events to python user close callback"""
         cb = cbData["cb"]
@@ -9,3 +9,38 @@
             retlist.append(virDomainSnapshot(self, _obj=snapptr))
 
         return retlist
+
+    def _dispatchAsyncCallback(self, ret, result, cbData):
+        """Dispatches the reply of an asynchronous call to the python
+           user callback"""
+        cb = cbData["cb"]
+        opaque = cbData["opaque"]
+
+        cb(self, ret, result, opaque)
+        return 0
+
+    def infoAsync(self, cb, opaque, flags = 0):
+        """Asynchronous version of info(). Once the reply has arrived,
+           cb(dom, ret, info, opaque) is invoked, where ret is 0 and
+           info the list info() would return, or ret is -1 and info is
+           None on failure. The callback is invoked from whichever thread
+           processes the connection, see virConnect.waitAsync()"""
+        cbData = {"dom": self, "cb": cb, "opaque": opaque}
+        ret = libvirtmod.virDomainGetInfoAsync(self._o, cbData, flags)
+        if ret == -1: raise libvirtError ('virDomainGetInfoAsync() failed', dom=self)
+
+    def blockStatsAsync(self, path, cb, opaque, flags = 0):
+        """Asynchronous version of blockStats(). The callback is invoked
+           like for infoAsync(), with the tuple blockStats() would
+           return"""
+        cbData = {"dom": self, "cb": cb, "opaque": opaque}
+        ret = libvirtmod.virDomainBlockStatsAsync(self._o, path, cbData, flags)
+        if ret == -1: raise libvirtError ('virDomainBlockStatsAsync() failed', dom=self)
+
+    def interfaceStatsAsync(self, path, cb, opaque, flags = 0):
+        """Asynchronous version of interfaceStats(). The callback is
+           invoked like for infoAsync(), with the tuple interfaceStats()
+           would return"""
+        cbData = {"dom": self, "cb": cb, "opaque": opaque}
+        ret = libvirtmod.virDomainInterfaceStatsAsync(self._o, path, cbData, flags)
+        if ret == -1: raise libvirtError ('virDomainInterfaceStatsAsync() failed', dom=self)
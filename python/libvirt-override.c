@@ -292,6 +292,57 @@ cleanup:
  *									*
  ************************************************************************/
 
+/* Convert to a Python tuple of long objects, shared by the
+ * synchronous and asynchronous calls */
+static PyObject *
+convertBlockStats(virDomainBlockStatsPtr stats)
+{
+    PyObject *info;
+
+    if ((info = PyTuple_New(5)) == NULL)
+        return VIR_PY_NONE;
+    PyTuple_SetItem(info, 0, PyLong_FromLongLong(stats->rd_req));
+    PyTuple_SetItem(info, 1, PyLong_FromLongLong(stats->rd_bytes));
+    PyTuple_SetItem(info, 2, PyLong_FromLongLong(stats->wr_req));
+    PyTuple_SetItem(info, 3, PyLong_FromLongLong(stats->wr_bytes));
+    PyTuple_SetItem(info, 4, PyLong_FromLongLong(stats->errs));
+    return info;
+}
+
+static PyObject *
+convertInterfaceStats(virDomainInterfaceStatsPtr stats)
+{
+    PyObject *info;
+
+    if ((info = PyTuple_New(8)) == NULL)
+        return VIR_PY_NONE;
+    PyTuple_SetItem(info, 0, PyLong_FromLongLong(stats->rx_bytes));
+    PyTuple_SetItem(info, 1, PyLong_FromLongLong(stats->rx_packets));
+    PyTuple_SetItem(info, 2, PyLong_FromLongLong(stats->rx_errs));
+    PyTuple_SetItem(info, 3, PyLong_FromLongLong(stats->rx_drop));
+    PyTuple_SetItem(info, 4, PyLong_FromLongLong(stats->tx_bytes));
+    PyTuple_SetItem(info, 5, PyLong_FromLongLong(stats->tx_packets));
+    PyTuple_SetItem(info, 6, PyLong_FromLongLong(stats->tx_errs));
+    PyTuple_SetItem(info, 7, PyLong_FromLongLong(stats->tx_drop));
+    return info;
+}
+
+static PyObject *
+convertDomainInfo(virDomainInfoPtr info)
+{
+    PyObject *py_retval;
+
+    if ((py_retval = PyList_New(5)) == NULL)
+        return VIR_PY_NONE;
+    PyList_SetItem(py_retval, 0, libvirt_intWrap((int) info->state));
+    PyList_SetItem(py_retval, 1, libvirt_ulongWrap(info->maxMem));
+    PyList_SetItem(py_retval, 2, libvirt_ulongWrap(info->memory));
+    PyList_SetItem(py_retval, 3, libvirt_intWrap((int) info->nrVirtCpu));
+    PyList_SetItem(py_retval, 4,
+                   libvirt_longlongWrap((unsigned long long) info->cpuTime));
+    return py_retval;
+}
+
 static PyObject *
 libvirt_virDomainBlockStats(PyObject *self ATTRIBUTE_UNUSED, PyObject *args) {
     virDomainPtr domain;
@@ -299,7 +350,6 @@ libvirt_virDomainBlockStats(PyObject *self ATTRIBUTE_UNUSED, PyObject *args) {
     char * path;
     int c_retval;
     virDomainBlockStatsStruct stats;
-    PyObject *info;
 
     if (!PyArg_ParseTuple(args, (char *)"Oz:virDomainBlockStats",
         &pyobj_domain,&path))
@@ -313,15 +363,7 @@ libvirt_virDomainBlockStats(PyObject *self ATTRIBUTE_UNUSED, PyObject *args) {
     if (c_retval < 0)
         return VIR_PY_NONE;
 
-    /* convert to a Python tuple of long objects */
-    if ((info = PyTuple_New(5)) == NULL)
-        return VIR_PY_NONE;
-    PyTuple_SetItem(info, 0, PyLong_FromLongLong(stats.rd_req));
-    PyTuple_SetItem(info, 1, PyLong_FromLongLong(stats.rd_bytes));
-    PyTuple_SetItem(info, 2, PyLong_FromLongLong(stats.wr_req));
-    PyTuple_SetItem(info, 3, PyLong_FromLongLong(stats.wr_bytes));
-    PyTuple_SetItem(info, 4, PyLong_FromLongLong(stats.errs));
-    return info;
+    return convertBlockStats(&stats);
 }
 
 static PyObject *
@@ -513,7 +555,6 @@ libvirt_virDomainInterfaceStats(PyObject *self ATTRIBUTE_UNUSED, PyObject *args)
     char * path;
     int c_retval;
     virDomainInterfaceStatsStruct stats;
-    PyObject *info;
 
     if (!PyArg_ParseTuple(args, (char *)"Oz:virDomainInterfaceStats",
         &pyobj_domain,&path))
@@ -527,18 +568,7 @@ libvirt_virDomainInterfaceStats(PyObject *self ATTRIBUTE_UNUSED, PyObject *args)
     if (c_retval < 0)
         return VIR_PY_NONE;
 
-    /* convert to a Python tuple of long objects */
-    if ((info = PyTuple_New(8)) == NULL)
-        return VIR_PY_NONE;
-    PyTuple_SetItem(info, 0, PyLong_FromLongLong(stats.rx_bytes));
-    PyTuple_SetItem(info, 1, PyLong_FromLongLong(stats.rx_packets));
-    PyTuple_SetItem(info, 2, PyLong_FromLongLong(stats.rx_errs));
-    PyTuple_SetItem(info, 3, PyLong_FromLongLong(stats.rx_drop));
-    PyTuple_SetItem(info, 4, PyLong_FromLongLong(stats.tx_bytes));
-    PyTuple_SetItem(info, 5, PyLong_FromLongLong(stats.tx_packets));
-    PyTuple_SetItem(info, 6, PyLong_FromLongLong(stats.tx_errs));
-    PyTuple_SetItem(info, 7, PyLong_FromLongLong(stats.tx_drop));
-    return info;
+    return convertInterfaceStats(&stats);
 }
 
 static PyObject *
@@ -2379,7 +2409,6 @@ libvirt_virDomainRevertToSnapshot(PyObject *self ATTRIBUTE_UNUSED,
 
 static PyObject *
 libvirt_virDomainGetInfo(PyObject *self ATTRIBUTE_UNUSED, PyObject *args) {
-    PyObject *py_retval;
     int c_retval;
     virDomainPtr domain;
     PyObject *pyobj_domain;
@@ -2394,14 +2423,7 @@ libvirt_virDomainGetInfo(PyObject *self ATTRIBUTE_UNUSED, PyObject *args) {
     LIBVIRT_END_ALLOW_THREADS;
     if (c_retval < 0)
         return VIR_PY_NONE;
-    py_retval = PyList_New(5);
-    PyList_SetItem(py_retval, 0, libvirt_intWrap((int) info.state));
-    PyList_SetItem(py_retval, 1, libvirt_ulongWrap(info.maxMem));
-    PyList_SetItem(py_retval, 2, libvirt_ulongWrap(info.memory));
-    PyList_SetItem(py_retval, 3, libvirt_intWrap((int) info.nrVirtCpu));
-    PyList_SetItem(py_retval, 4,
-                   libvirt_longlongWrap((unsigned long long) info.cpuTime));
-    return py_retval;
+    return convertDomainInfo(&info);
 }
 
 static PyObject *
@@ -4182,6 +4204,51 @@ libvirt_virDomainGetJobInfo(PyObject *self ATTRIBUTE_UNUSED, PyObject *args) {
     return py_retval;
 }
 
+static PyObject *
+libvirt_virDomainGetJobStats(PyObject *self ATTRIBUTE_UNUSED,
+                             PyObject *args)
+{
+    PyObject *pyobj_domain;
+    PyObject *dict = NULL;
+    PyObject *key = NULL;
+    PyObject *value = NULL;
+    virDomainPtr domain;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    int type;
+    unsigned int flags;
+    int c_retval;
+
+    if (!PyArg_ParseTuple(args, (char *)"Oi:virDomainGetJobStats",
+                          &pyobj_domain, &flags))
+        return NULL;
+    domain = (virDomainPtr) PyvirDomain_Get(pyobj_domain);
+
+    LIBVIRT_BEGIN_ALLOW_THREADS;
+    c_retval = virDomainGetJobStats(domain, &type, &params, &nparams, flags);
+    LIBVIRT_END_ALLOW_THREADS;
+
+    if (c_retval < 0)
+        return VIR_PY_NONE;
+
+    if (!(dict = getPyVirTypedParameter(params, nparams)))
+        goto cleanup;
+
+    /* The job type is reported as one more item of the dictionary */
+    if (!(key = libvirt_constcharPtrWrap("type")) ||
+        !(value = libvirt_intWrap(type)) ||
+        PyDict_SetItem(dict, key, value) < 0) {
+        Py_DECREF(dict);
+        dict = NULL;
+    }
+
+cleanup:
+    Py_XDECREF(key);
+    Py_XDECREF(value);
+    virTypedParamsFree(params, nparams);
+    return dict;
+}
+
 static PyObject *
 libvirt_virDomainGetBlockJobInfo(PyObject *self ATTRIBUTE_UNUSED,
                                  PyObject *args)
@@ -5859,6 +5926,57 @@ libvirt_virConnectDomainEventPMSuspendDiskCallback(virConnectPtr conn ATTRIBUTE_
     return ret;
 }
 
+static int
+libvirt_virConnectDomainEventMigrationStalledCallback(virConnectPtr conn ATTRIBUTE_UNUSED,
+                                                      virDomainPtr dom,
+                                                      unsigned long long iteration,
+                                                      unsigned long long dirtyRate,
+                                                      unsigned long long bandwidth,
+                                                      void *opaque)
+{
+    PyObject *pyobj_cbData = (PyObject*)opaque;
+    PyObject *pyobj_dom;
+    PyObject *pyobj_ret;
+    PyObject *pyobj_conn;
+    PyObject *dictKey;
+    int ret = -1;
+
+    LIBVIRT_ENSURE_THREAD_STATE;
+
+    /* Create a python instance of this virDomainPtr */
+    virDomainRef(dom);
+    pyobj_dom = libvirt_virDomainPtrWrap(dom);
+    Py_INCREF(pyobj_cbData);
+
+    dictKey = libvirt_constcharPtrWrap("conn");
+    pyobj_conn = PyDict_GetItem(pyobj_cbData, dictKey);
+    Py_DECREF(dictKey);
+
+    /* Call the Callback Dispatcher */
+    pyobj_ret = PyObject_CallMethod(pyobj_conn,
+                                    (char*)"_dispatchDomainEventMigrationStalledCallback",
+                                    (char*)"OLLLO",
+                                    pyobj_dom,
+                                    (PY_LONG_LONG)iteration,
+                                    (PY_LONG_LONG)dirtyRate,
+                                    (PY_LONG_LONG)bandwidth,
+                                    pyobj_cbData);
+
+    Py_DECREF(pyobj_cbData);
+    Py_DECREF(pyobj_dom);
+
+    if (!pyobj_ret) {
+        DEBUG("%s - ret:%p\n", __FUNCTION__, pyobj_ret);
+        PyErr_Print();
+    } else {
+        Py_DECREF(pyobj_ret);
+        ret = 0;
+    }
+
+    LIBVIRT_RELEASE_THREAD_STATE;
+    return ret;
+}
+
 static PyObject *
 libvirt_virConnectDomainEventRegisterAny(ATTRIBUTE_UNUSED PyObject * self,
                                          PyObject * args)
@@ -5934,6 +6052,9 @@ libvirt_virConnectDomainEventRegisterAny(ATTRIBUTE_UNUSED PyObject * self,
     case VIR_DOMAIN_EVENT_ID_PMSUSPEND_DISK:
         cb = VIR_DOMAIN_EVENT_CALLBACK(libvirt_virConnectDomainEventPMSuspendDiskCallback);
         break;
+    case VIR_DOMAIN_EVENT_ID_MIGRATION_STALLED:
+        cb = VIR_DOMAIN_EVENT_CALLBACK(libvirt_virConnectDomainEventMigrationStalledCallback);
+        break;
     }
 
     if (!cb) {
@@ -6089,6 +6210,205 @@ libvirt_virConnectUnregisterCloseCallback(ATTRIBUTE_UNUSED PyObject * self,
     return py_retval;
 }
 
+typedef enum {
+    LIBVIRT_ASYNC_DOMAIN_INFO,
+    LIBVIRT_ASYNC_BLOCK_STATS,
+    LIBVIRT_ASYNC_INTERFACE_STATS,
+} libvirtAsyncCallType;
+
+/* State of one asynchronous call, from the moment it is sent until
+ * its callback has run */
+typedef struct _libvirtAsyncCall libvirtAsyncCall;
+typedef libvirtAsyncCall *libvirtAsyncCallPtr;
+struct _libvirtAsyncCall {
+    libvirtAsyncCallType type;
+    PyObject *cbData;           /* hash of callback data */
+    union {
+        virDomainInfo info;
+        virDomainBlockStatsStruct block;
+        virDomainInterfaceStatsStruct iface;
+    } data;                     /* filled in by the reply */
+};
+
+static libvirtAsyncCallPtr
+libvirtAsyncCallNew(libvirtAsyncCallType type,
+                    PyObject *pyobj_cbData)
+{
+    libvirtAsyncCallPtr call;
+
+    if (VIR_ALLOC(call) < 0)
+        return NULL;
+
+    call->type = type;
+    call->cbData = pyobj_cbData;
+    Py_INCREF(pyobj_cbData);
+    return call;
+}
+
+/* Must be called with the GIL held */
+static void
+libvirtAsyncCallFree(libvirtAsyncCallPtr call)
+{
+    Py_DECREF(call->cbData);
+    VIR_FREE(call);
+}
+
+static void
+libvirt_virConnectAsyncCallback(virConnectPtr conn ATTRIBUTE_UNUSED,
+                                int ret,
+                                void *opaque)
+{
+    libvirtAsyncCallPtr call = opaque;
+    PyObject *pyobj_dom;
+    PyObject *pyobj_result;
+    PyObject *pyobj_ret;
+    PyObject *dictKey;
+
+    LIBVIRT_ENSURE_THREAD_STATE;
+
+    if (ret < 0) {
+        pyobj_result = VIR_PY_NONE;
+    } else {
+        switch (call->type) {
+        case LIBVIRT_ASYNC_DOMAIN_INFO:
+            pyobj_result = convertDomainInfo(&call->data.info);
+            break;
+        case LIBVIRT_ASYNC_BLOCK_STATS:
+            pyobj_result = convertBlockStats(&call->data.block);
+            break;
+        case LIBVIRT_ASYNC_INTERFACE_STATS:
+        default:
+            pyobj_result = convertInterfaceStats(&call->data.iface);
+            break;
+        }
+    }
+
+    dictKey = libvirt_constcharPtrWrap("dom");
+    pyobj_dom = PyDict_GetItem(call->cbData, dictKey);
+    Py_DECREF(dictKey);
+
+    /* Call the pure python dispatcher */
+    pyobj_ret = PyObject_CallMethod(pyobj_dom,
+                                    (char *)"_dispatchAsyncCallback",
+                                    (char *)"iOO",
+                                    ret, pyobj_result, call->cbData);
+
+    Py_DECREF(pyobj_result);
+
+    if (!pyobj_ret) {
+        DEBUG("%s - ret:%p\n", __FUNCTION__, pyobj_ret);
+        PyErr_Print();
+    } else {
+        Py_DECREF(pyobj_ret);
+    }
+
+    libvirtAsyncCallFree(call);
+
+    LIBVIRT_RELEASE_THREAD_STATE;
+}
+
+static PyObject *
+libvirt_virDomainGetInfoAsync(PyObject *self ATTRIBUTE_UNUSED,
+                              PyObject *args)
+{
+    PyObject *pyobj_domain;
+    PyObject *pyobj_cbData;
+    virDomainPtr domain;
+    libvirtAsyncCallPtr call;
+    unsigned int flags;
+    int c_retval;
+
+    if (!PyArg_ParseTuple(args, (char *)"OOi:virDomainGetInfoAsync",
+                          &pyobj_domain, &pyobj_cbData, &flags))
+        return NULL;
+    domain = (virDomainPtr) PyvirDomain_Get(pyobj_domain);
+
+    if (!(call = libvirtAsyncCallNew(LIBVIRT_ASYNC_DOMAIN_INFO,
+                                     pyobj_cbData)))
+        return PyErr_NoMemory();
+
+    /* The callback may run before this returns, so the GIL must
+     * not be held */
+    LIBVIRT_BEGIN_ALLOW_THREADS;
+    c_retval = virDomainGetInfoAsync(domain, &call->data.info,
+                                     libvirt_virConnectAsyncCallback,
+                                     call, flags);
+    LIBVIRT_END_ALLOW_THREADS;
+
+    if (c_retval < 0)
+        libvirtAsyncCallFree(call);
+
+    return libvirt_intWrap(c_retval);
+}
+
+static PyObject *
+libvirt_virDomainBlockStatsAsync(PyObject *self ATTRIBUTE_UNUSED,
+                                 PyObject *args)
+{
+    PyObject *pyobj_domain;
+    PyObject *pyobj_cbData;
+    virDomainPtr domain;
+    libvirtAsyncCallPtr call;
+    char *path;
+    unsigned int flags;
+    int c_retval;
+
+    if (!PyArg_ParseTuple(args, (char *)"OzOi:virDomainBlockStatsAsync",
+                          &pyobj_domain, &path, &pyobj_cbData, &flags))
+        return NULL;
+    domain = (virDomainPtr) PyvirDomain_Get(pyobj_domain);
+
+    if (!(call = libvirtAsyncCallNew(LIBVIRT_ASYNC_BLOCK_STATS,
+                                     pyobj_cbData)))
+        return PyErr_NoMemory();
+
+    LIBVIRT_BEGIN_ALLOW_THREADS;
+    c_retval = virDomainBlockStatsAsync(domain, path, &call->data.block,
+                                        sizeof(call->data.block),
+                                        libvirt_virConnectAsyncCallback,
+                                        call, flags);
+    LIBVIRT_END_ALLOW_THREADS;
+
+    if (c_retval < 0)
+        libvirtAsyncCallFree(call);
+
+    return libvirt_intWrap(c_retval);
+}
+
+static PyObject *
+libvirt_virDomainInterfaceStatsAsync(PyObject *self ATTRIBUTE_UNUSED,
+                                     PyObject *args)
+{
+    PyObject *pyobj_domain;
+    PyObject *pyobj_cbData;
+    virDomainPtr domain;
+    libvirtAsyncCallPtr call;
+    char *path;
+    unsigned int flags;
+    int c_retval;
+
+    if (!PyArg_ParseTuple(args, (char *)"OzOi:virDomainInterfaceStatsAsync",
+                          &pyobj_domain, &path, &pyobj_cbData, &flags))
+        return NULL;
+    domain = (virDomainPtr) PyvirDomain_Get(pyobj_domain);
+
+    if (!(call = libvirtAsyncCallNew(LIBVIRT_ASYNC_INTERFACE_STATS,
+                                     pyobj_cbData)))
+        return PyErr_NoMemory();
+
+    LIBVIRT_BEGIN_ALLOW_THREADS;
+    c_retval = virDomainInterfaceStatsAsync(domain, path, &call->data.iface,
+                                            sizeof(call->data.iface),
+                                            libvirt_virConnectAsyncCallback,
+                                            call, flags);
+    LIBVIRT_END_ALLOW_THREADS;
+
+    if (c_retval < 0)
+        libvirtAsyncCallFree(call);
+
+    return libvirt_intWrap(c_retval);
+}
+
 static void
 libvirt_virStreamEventFreeFunc(void *opaque)
 {
@@ -6570,6 +6890,158 @@ error:
 }
 
 
+static PyObject *
+libvirt_virConnectGetRPCStats(PyObject *self ATTRIBUTE_UNUSED,
+                              PyObject *args)
+{
+    virConnectPtr conn;
+    PyObject *pyobj_conn;
+    PyObject *ret = NULL;
+    int i_retval;
+    int nparams = 0;
+    unsigned int flags;
+    virTypedParameterPtr params = NULL;
+
+    if (!PyArg_ParseTuple(args, (char *)"Oi:virConnectGetRPCStats",
+                          &pyobj_conn, &flags))
+        return NULL;
+    conn = (virConnectPtr) PyvirConnect_Get(pyobj_conn);
+
+    LIBVIRT_BEGIN_ALLOW_THREADS;
+    i_retval = virConnectGetRPCStats(conn, &params, &nparams, flags);
+    LIBVIRT_END_ALLOW_THREADS;
+
+    if (i_retval < 0)
+        return VIR_PY_NONE;
+
+    ret = getPyVirTypedParameter(params, nparams);
+
+    virTypedParamsFree(params, nparams);
+    return ret;
+}
+
+/* Convert @records into a list of (domain, stats dict) tuples */
+static PyObject *
+convertDomainStatsRecord(virDomainStatsRecordPtr *records,
+                         int nrecords)
+{
+    PyObject *py_retval;
+    PyObject *py_record;
+    PyObject *py_record_domain = NULL;
+    PyObject *py_record_stats = NULL;
+    int i;
+
+    if (!(py_retval = PyList_New(nrecords)))
+        return NULL;
+
+    for (i = 0; i < nrecords; i++) {
+        if (!(py_record = PyTuple_New(2)))
+            goto error;
+
+        /* PyList_SetItem steals the reference */
+        PyList_SetItem(py_retval, i, py_record);
+
+        /* libvirt_virDomainPtrWrap steals the reference */
+        virDomainRef(records[i]->dom);
+        if (!(py_record_domain = libvirt_virDomainPtrWrap(records[i]->dom))) {
+            virDomainFree(records[i]->dom);
+            goto error;
+        }
+        PyTuple_SetItem(py_record, 0, py_record_domain);
+
+        if (!(py_record_stats = getPyVirTypedParameter(records[i]->params,
+                                                       records[i]->nparams)))
+            goto error;
+        PyTuple_SetItem(py_record, 1, py_record_stats);
+    }
+
+    return py_retval;
+
+error:
+    Py_DECREF(py_retval);
+    return NULL;
+}
+
+static PyObject *
+libvirt_virConnectGetAllDomainStats(PyObject *self ATTRIBUTE_UNUSED,
+                                    PyObject *args)
+{
+    PyObject *pyobj_conn;
+    PyObject *py_retval;
+    virConnectPtr conn;
+    virDomainStatsRecordPtr *records;
+    int nrecords;
+    unsigned int flags;
+    unsigned int stats;
+
+    if (!PyArg_ParseTuple(args, (char *)"Oii:virConnectGetAllDomainStats",
+                          &pyobj_conn, &stats, &flags))
+        return NULL;
+    conn = (virConnectPtr) PyvirConnect_Get(pyobj_conn);
+
+    LIBVIRT_BEGIN_ALLOW_THREADS;
+    nrecords = virConnectGetAllDomainStats(conn, stats, &records, flags);
+    LIBVIRT_END_ALLOW_THREADS;
+
+    if (nrecords < 0)
+        return VIR_PY_NONE;
+
+    if (!(py_retval = convertDomainStatsRecord(records, nrecords)))
+        py_retval = VIR_PY_NONE;
+
+    virDomainStatsRecordListFree(records);
+    return py_retval;
+}
+
+static PyObject *
+libvirt_virDomainListGetStats(PyObject *self ATTRIBUTE_UNUSED,
+                              PyObject *args)
+{
+    PyObject *py_retval;
+    PyObject *py_domlist;
+    virDomainStatsRecordPtr *records = NULL;
+    virDomainPtr *doms = NULL;
+    int nrecords;
+    int ndoms;
+    int i;
+    unsigned int flags;
+    unsigned int stats;
+
+    if (!PyArg_ParseTuple(args, (char *)"Oii:virDomainListGetStats",
+                          &py_domlist, &stats, &flags))
+        return NULL;
+
+    if (!PyList_Check(py_domlist))
+        return VIR_PY_NONE;
+
+    ndoms = PyList_Size(py_domlist);
+
+    /* The list is NULL terminated */
+    if (VIR_ALLOC_N(doms, ndoms + 1) < 0)
+        return PyErr_NoMemory();
+
+    for (i = 0; i < ndoms; i++)
+        doms[i] = PyvirDomain_Get(PyList_GetItem(py_domlist, i));
+
+    LIBVIRT_BEGIN_ALLOW_THREADS;
+    nrecords = virDomainListGetStats(doms, stats, &records, flags);
+    LIBVIRT_END_ALLOW_THREADS;
+
+    if (nrecords < 0) {
+        py_retval = VIR_PY_NONE;
+        goto cleanup;
+    }
+
+    if (!(py_retval = convertDomainStatsRecord(records, nrecords)))
+        py_retval = VIR_PY_NONE;
+
+cleanup:
+    virDomainStatsRecordListFree(records);
+    VIR_FREE(doms);
+    return py_retval;
+}
+
+
 /************************************************************************
  *									*
  *			The registration stuff				*
@@ -6689,6 +7161,13 @@ static PyMethodDef libvirtMethods[] = {
     {(char *) "virNodeGetMemoryParameters", libvirt_virNodeGetMemoryParameters, METH_VARARGS, NULL},
     {(char *) "virNodeSetMemoryParameters", libvirt_virNodeSetMemoryParameters, METH_VARARGS, NULL},
     {(char *) "virNodeGetCPUMap", libvirt_virNodeGetCPUMap, METH_VARARGS, NULL},
+    {(char *) "virConnectGetAllDomainStats", libvirt_virConnectGetAllDomainStats, METH_VARARGS, NULL},
+    {(char *) "virDomainListGetStats", libvirt_virDomainListGetStats, METH_VARARGS, NULL},
+    {(char *) "virConnectGetRPCStats", libvirt_virConnectGetRPCStats, METH_VARARGS, NULL},
+    {(char *) "virDomainGetInfoAsync", libvirt_virDomainGetInfoAsync, METH_VARARGS, NULL},
+    {(char *) "virDomainBlockStatsAsync", libvirt_virDomainBlockStatsAsync, METH_VARARGS, NULL},
+    {(char *) "virDomainInterfaceStatsAsync", libvirt_virDomainInterfaceStatsAsync, METH_VARARGS, NULL},
+    {(char *) "virDomainGetJobStats", libvirt_virDomainGetJobStats, METH_VARARGS, NULL},
     {NULL, NULL, 0, NULL}
 };
 
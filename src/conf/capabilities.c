@@ -40,13 +40,31 @@ VIR_ENUM_DECL(virCapsHostPMTarget)
 VIR_ENUM_IMPL(virCapsHostPMTarget, VIR_NODE_SUSPEND_TARGET_LAST,
               "suspend_mem", "suspend_disk", "suspend_hybrid");
 
+static virClassPtr virCapsClass;
+static void virCapabilitiesDispose(void *obj);
+
+static int virCapabilitiesOnceInit(void)
+{
+    if (!(virCapsClass = virClassNew(virClassForObject(),
+                                     "virCaps",
+                                     sizeof(virCaps),
+                                     virCapabilitiesDispose)))
+        return -1;
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virCapabilities)
+
 /**
  * virCapabilitiesNew:
  * @hostarch: host machine architecture
  * @offlineMigrate: non-zero if offline migration is available
  * @liveMigrate: non-zero if live migration is available
  *
- * Allocate a new capabilities object
+ * Allocate a new capabilities object. The object is reference
+ * counted, so that it can be shared by threads which need a stable
+ * snapshot while a driver replaces its own copy
  */
 virCapsPtr
 virCapabilitiesNew(virArch hostarch,
@@ -55,7 +73,10 @@ virCapabilitiesNew(virArch hostarch,
 {
     virCapsPtr caps;
 
-    if (VIR_ALLOC(caps) < 0)
+    if (virCapabilitiesInitialize() < 0)
+        return NULL;
+
+    if (!(caps = virObjectNew(virCapsClass)))
         return NULL;
 
     caps->host.arch = hostarch;
@@ -169,13 +190,19 @@ virCapabilitiesFreeNUMAInfo(virCapsPtr caps)
  * virCapabilitiesFree:
  * @caps: object to free
  *
- * Free all memory associated with capabilities
+ * Release a reference on the capabilities, freeing all memory
+ * associated with them once the last reference is gone
  */
 void
 virCapabilitiesFree(virCapsPtr caps) {
+    virObjectUnref(caps);
+}
+
+static void
+virCapabilitiesDispose(void *object)
+{
+    virCapsPtr caps = object;
     int i;
-    if (caps == NULL)
-        return;
 
     for (i = 0 ; i < caps->nguests ; i++)
         virCapabilitiesFreeGuest(caps->guests[i]);
@@ -198,8 +225,6 @@ virCapabilitiesFree(virCapsPtr caps) {
     VIR_FREE(caps->host.secModels);
 
     virCPUDefFree(caps->host.cpu);
-
-    VIR_FREE(caps);
 }
 
 
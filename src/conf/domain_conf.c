@@ -36,6 +36,7 @@
 #include "snapshot_conf.h"
 #include "viralloc.h"
 #include "verify.h"
+#include "virhashcode.h"
 #include "virxml.h"
 #include "viruuid.h"
 #include "virutil.h"
@@ -776,50 +777,188 @@ virDomainObjListDataFree(void *payload, const void *name ATTRIBUTE_UNUSED)
     virObjectUnref(obj);
 }
 
+/* Domain IDs are used directly as keys of the ID index, offset by
+ * one since 0 is a valid ID but not a valid key */
+#define VIR_DOMAIN_ID_KEY(id) ((void *)(intptr_t)((id) + 1))
+
+static uint32_t virDomainObjListIDCode(const void *name, uint32_t seed)
+{
+    unsigned long value = (unsigned long)(intptr_t)name;
+    return virHashCodeGen(&value, sizeof(value), seed);
+}
+static bool virDomainObjListIDEqual(const void *namea, const void *nameb)
+{
+    return namea == nameb;
+}
+static void *virDomainObjListIDCopy(const void *name)
+{
+    return (void *)name;
+}
+
 int virDomainObjListInit(virDomainObjListPtr doms)
 {
+    if (virRWLockInit(&doms->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize domain list lock"));
+        return -1;
+    }
+
+    if (virMutexInit(&doms->idLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize domain list mutex"));
+        virRWLockDestroy(&doms->lock);
+        return -1;
+    }
+
     doms->objs = virHashCreate(50, virDomainObjListDataFree);
-    if (!doms->objs)
+    doms->objsName = virHashCreate(50, NULL);
+    doms->objsID = virHashCreateFull(50, NULL,
+                                     virDomainObjListIDCode,
+                                     virDomainObjListIDEqual,
+                                     virDomainObjListIDCopy,
+                                     NULL);
+    if (!doms->objs || !doms->objsName || !doms->objsID) {
+        virDomainObjListDeinit(doms);
         return -1;
+    }
     return 0;
 }
 
 
 void virDomainObjListDeinit(virDomainObjListPtr doms)
 {
+    virHashFree(doms->objsID);
+    virHashFree(doms->objsName);
     virHashFree(doms->objs);
+    doms->objsID = doms->objsName = doms->objs = NULL;
+    virMutexDestroy(&doms->idLock);
+    virRWLockDestroy(&doms->lock);
 }
 
 
-static int virDomainObjListSearchID(const void *payload,
-                                    const void *name ATTRIBUTE_UNUSED,
-                                    const void *data)
+static int virDomainObjListSearchObj(const void *payload,
+                                     const void *name ATTRIBUTE_UNUSED,
+                                     const void *data)
 {
-    virDomainObjPtr obj = (virDomainObjPtr)payload;
-    const int *id = data;
-    int want = 0;
+    return payload == data;
+}
 
-    virObjectLock(obj);
-    if (virDomainObjIsActive(obj) &&
-        obj->def->id == *id)
-        want = 1;
-    virObjectUnlock(obj);
-    return want;
+/*
+ * Move @dom from @oldid to @newid in the ID index. Either may be -1
+ * for an inactive domain. Unless @replace is set, an entry already
+ * held by another domain is left alone, since IDs that merely came
+ * with a parsed XML document are not authoritative. Only the index
+ * lock is taken, so this may be called with just @dom locked.
+ */
+static void
+virDomainObjListUpdateID(virDomainObjListPtr doms,
+                         virDomainObjPtr dom,
+                         int oldid,
+                         int newid,
+                         bool replace)
+{
+    virMutexLock(&doms->idLock);
+    if (oldid >= 0 &&
+        virHashLookup(doms->objsID, VIR_DOMAIN_ID_KEY(oldid)) == dom)
+        virHashRemoveEntry(doms->objsID, VIR_DOMAIN_ID_KEY(oldid));
+    if (newid >= 0 &&
+        (replace || !virHashLookup(doms->objsID, VIR_DOMAIN_ID_KEY(newid))))
+        ignore_value(virHashUpdateEntry(doms->objsID,
+                                        VIR_DOMAIN_ID_KEY(newid), dom));
+    virMutexUnlock(&doms->idLock);
+}
+
+/**
+ * virDomainObjListSetID:
+ * @doms: the list containing @dom
+ * @dom: the locked domain object
+ * @id: the new domain ID, or -1 once the domain is no longer running
+ *
+ * Change the ID of @dom, keeping the list's ID index up to date.
+ * Drivers must use this, rather than setting dom->def->id directly,
+ * on any domain that is in a list, or virDomainFindByID will not
+ * find it.
+ */
+void virDomainObjListSetID(virDomainObjListPtr doms,
+                           virDomainObjPtr dom,
+                           int id)
+{
+    virDomainObjListUpdateID(doms, dom, dom->def->id, id, true);
+    dom->def->id = id;
+}
+
+/*
+ * Add @dom to the list and its indexes. Must be called with the list
+ * locked for writing.
+ */
+static int
+virDomainObjListAddLocked(virDomainObjListPtr doms,
+                          const char *uuidstr,
+                          virDomainObjPtr dom)
+{
+    if (virHashAddEntry(doms->objs, uuidstr, dom) < 0)
+        return -1;
+
+    if (virHashUpdateEntry(doms->objsName, dom->def->name, dom) < 0) {
+        virHashSteal(doms->objs, uuidstr);
+        return -1;
+    }
+
+    virDomainObjListUpdateID(doms, dom, -1, dom->def->id, false);
+    return 0;
 }
 
+/*
+ * Drop every index entry referring to @dom. They are normally keyed
+ * by its current name and ID, but fall back to a full scan in case
+ * either was changed behind the list's back. Must be called with the
+ * list locked for writing.
+ */
+static void
+virDomainObjListUnindexLocked(virDomainObjListPtr doms,
+                              virDomainObjPtr dom)
+{
+    if (virHashLookup(doms->objsName, dom->def->name) == dom)
+        virHashRemoveEntry(doms->objsName, dom->def->name);
+    else
+        virHashRemoveSet(doms->objsName, virDomainObjListSearchObj, dom);
+
+    virMutexLock(&doms->idLock);
+    virHashRemoveSet(doms->objsID, virDomainObjListSearchObj, dom);
+    virMutexUnlock(&doms->idLock);
+}
+
+
 virDomainObjPtr virDomainFindByID(const virDomainObjListPtr doms,
                                   int id)
 {
-    virDomainObjPtr obj;
-    obj = virHashSearch(doms->objs, virDomainObjListSearchID, &id);
-    if (obj)
+    virDomainObjPtr obj = NULL;
+
+    if (id < 0)
+        return NULL;
+
+    virRWLockRead(&doms->lock);
+    virMutexLock(&doms->idLock);
+    obj = virHashLookup(doms->objsID, VIR_DOMAIN_ID_KEY(id));
+    virMutexUnlock(&doms->idLock);
+
+    if (obj) {
         virObjectLock(obj);
+        /* The ID may have changed while we waited for the lock */
+        if (!virDomainObjIsActive(obj) ||
+            obj->def->id != id) {
+            virObjectUnlock(obj);
+            obj = NULL;
+        }
+    }
+    virRWLockUnlock(&doms->lock);
     return obj;
 }
 
 
-virDomainObjPtr virDomainFindByUUID(const virDomainObjListPtr doms,
-                                    const unsigned char *uuid)
+static virDomainObjPtr
+virDomainFindByUUIDLocked(const virDomainObjListPtr doms,
+                          const unsigned char *uuid)
 {
     char uuidstr[VIR_UUID_STRING_BUFLEN];
     virDomainObjPtr obj;
@@ -832,31 +971,103 @@ virDomainObjPtr virDomainFindByUUID(const virDomainObjListPtr doms,
     return obj;
 }
 
-static int virDomainObjListSearchName(const void *payload,
-                                      const void *name ATTRIBUTE_UNUSED,
-                                      const void *data)
+virDomainObjPtr virDomainFindByUUID(const virDomainObjListPtr doms,
+                                    const unsigned char *uuid)
 {
-    virDomainObjPtr obj = (virDomainObjPtr)payload;
-    int want = 0;
+    virDomainObjPtr obj;
 
-    virObjectLock(obj);
-    if (STREQ(obj->def->name, (const char *)data))
-        want = 1;
-    virObjectUnlock(obj);
-    return want;
+    virRWLockRead(&doms->lock);
+    obj = virDomainFindByUUIDLocked(doms, uuid);
+    virRWLockUnlock(&doms->lock);
+    return obj;
 }
 
 virDomainObjPtr virDomainFindByName(const virDomainObjListPtr doms,
                                     const char *name)
 {
     virDomainObjPtr obj;
-    obj = virHashSearch(doms->objs, virDomainObjListSearchName, name);
-    if (obj)
+
+    virRWLockRead(&doms->lock);
+    obj = virHashLookup(doms->objsName, name);
+    if (obj) {
         virObjectLock(obj);
+        if (STRNEQ(obj->def->name, name)) {
+            virObjectUnlock(obj);
+            obj = NULL;
+        }
+    }
+    virRWLockUnlock(&doms->lock);
     return obj;
 }
 
 
+/*
+ * Run @iter over every domain in the list. The list lock is only
+ * held while taking a reference on each domain (for writing, since
+ * iterating over a hash table is not safe for concurrent readers),
+ * so the callback
+ * runs without it and is free to lock the domain it is given, to
+ * call back into the list, and to remove the domain. The domain
+ * objects are passed unlocked.
+ *
+ * Returns 0 on success, -1 on allocation failure
+ */
+int virDomainObjListForEach(virDomainObjListPtr doms,
+                            virHashIterator iter,
+                            void *opaque)
+{
+    virHashKeyValuePairPtr items = NULL;
+    virDomainObjPtr *objs = NULL;
+    char (*uuids)[VIR_UUID_STRING_BUFLEN] = NULL;
+    size_t nobjs = 0;
+    size_t i;
+    int ret = -1;
+
+    virRWLockWrite(&doms->lock);
+    if (!(items = virHashGetItems(doms->objs, NULL))) {
+        virRWLockUnlock(&doms->lock);
+        return -1;
+    }
+
+    for (nobjs = 0; items[nobjs].key; nobjs++)
+        ;
+
+    if (nobjs == 0) {
+        virRWLockUnlock(&doms->lock);
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (VIR_ALLOC_N(objs, nobjs) < 0 ||
+        VIR_ALLOC_N(uuids, nobjs) < 0) {
+        virRWLockUnlock(&doms->lock);
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    for (i = 0; i < nobjs; i++) {
+        objs[i] = virObjectRef((void *)items[i].value);
+        ignore_value(virStrcpyStatic(uuids[i], items[i].key));
+    }
+    virRWLockUnlock(&doms->lock);
+
+    for (i = 0; i < nobjs; i++)
+        iter(objs[i], uuids[i], opaque);
+
+    ret = 0;
+
+cleanup:
+    if (objs) {
+        for (i = 0; i < nobjs; i++)
+            virObjectUnref(objs[i]);
+    }
+    VIR_FREE(objs);
+    VIR_FREE(uuids);
+    VIR_FREE(items);
+    return ret;
+}
+
+
 bool virDomainObjTaint(virDomainObjPtr obj,
                        enum virDomainTaintFlags taint)
 {
@@ -1850,21 +2061,32 @@ virDomainObjPtr virDomainAssignDef(virCapsPtr caps,
     virDomainObjPtr domain;
     char uuidstr[VIR_UUID_STRING_BUFLEN];
 
-    if ((domain = virDomainFindByUUID(doms, def->uuid))) {
+    virRWLockWrite(&doms->lock);
+    if ((domain = virDomainFindByUUIDLocked(doms, def->uuid))) {
+        int oldid = domain->def->id;
+
         virDomainObjAssignDef(domain, def, live);
-        return domain;
+        if (domain->def->id != oldid)
+            virDomainObjListUpdateID(doms, domain, oldid,
+                                     domain->def->id, false);
+        goto cleanup;
     }
 
     if (!(domain = virDomainObjNew(caps)))
-        return NULL;
+        goto cleanup;
     domain->def = def;
 
     virUUIDFormat(def->uuid, uuidstr);
-    if (virHashAddEntry(doms->objs, uuidstr, domain) < 0) {
-        VIR_FREE(domain);
-        return NULL;
+    if (virDomainObjListAddLocked(doms, uuidstr, domain) < 0) {
+        domain->def = NULL;
+        virObjectUnlock(domain);
+        virObjectUnref(domain);
+        domain = NULL;
+        goto cleanup;
     }
 
+cleanup:
+    virRWLockUnlock(&doms->lock);
     return domain;
 }
 
@@ -1978,9 +2200,10 @@ cleanup:
 }
 
 /*
- * The caller must hold a lock on the driver owning 'doms',
- * and must also have locked 'dom', to ensure no one else
- * is either waiting for 'dom' or still using it
+ * The caller must have locked 'dom', to ensure no one else
+ * is either waiting for 'dom' or still using it. Since the
+ * list lock must be acquired before that of 'dom', 'dom' is
+ * unlocked and relocked around acquiring it.
  */
 void virDomainRemoveInactive(virDomainObjListPtr doms,
                              virDomainObjPtr dom)
@@ -1988,9 +2211,16 @@ void virDomainRemoveInactive(virDomainObjListPtr doms,
     char uuidstr[VIR_UUID_STRING_BUFLEN];
     virUUIDFormat(dom->def->uuid, uuidstr);
 
+    virObjectRef(dom);
     virObjectUnlock(dom);
 
+    virRWLockWrite(&doms->lock);
+    virObjectLock(dom);
+    virDomainObjListUnindexLocked(doms, dom);
     virHashRemoveEntry(doms->objs, uuidstr);
+    virObjectUnlock(dom);
+    virObjectUnref(dom);
+    virRWLockUnlock(&doms->lock);
 }
 
 
@@ -14862,15 +15092,20 @@ static virDomainObjPtr virDomainLoadStatus(virCapsPtr caps,
 
     virUUIDFormat(obj->def->uuid, uuidstr);
 
+    virRWLockWrite(&doms->lock);
     if (virHashLookup(doms->objs, uuidstr) != NULL) {
+        virRWLockUnlock(&doms->lock);
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("unexpected domain %s already exists"),
                        obj->def->name);
         goto error;
     }
 
-    if (virHashAddEntry(doms->objs, uuidstr, obj) < 0)
+    if (virDomainObjListAddLocked(doms, uuidstr, obj) < 0) {
+        virRWLockUnlock(&doms->lock);
         goto error;
+    }
+    virRWLockUnlock(&doms->lock);
 
     if (notify)
         (*notify)(obj, 1, opaque);
@@ -15132,10 +15367,14 @@ static void virDomainObjListCountInactive(void *payload, const void *name ATTRIB
 int virDomainObjListNumOfDomains(virDomainObjListPtr doms, int active)
 {
     int count = 0;
+    /* Iterating over a hash table is not safe for concurrent readers,
+     * so walking the list needs it locked for writing */
+    virRWLockWrite(&doms->lock);
     if (active)
         virHashForEach(doms->objs, virDomainObjListCountActive, &count);
     else
         virHashForEach(doms->objs, virDomainObjListCountInactive, &count);
+    virRWLockUnlock(&doms->lock);
     return count;
 }
 
@@ -15160,7 +15399,9 @@ int virDomainObjListGetActiveIDs(virDomainObjListPtr doms,
                                  int maxids)
 {
     struct virDomainIDData data = { 0, maxids, ids };
+    virRWLockWrite(&doms->lock);
     virHashForEach(doms->objs, virDomainObjListCopyActiveIDs, &data);
+    virRWLockUnlock(&doms->lock);
     return data.numids;
 }
 
@@ -15196,7 +15437,9 @@ int virDomainObjListGetInactiveNames(virDomainObjListPtr doms,
 {
     struct virDomainNameData data = { 0, 0, maxnames, names };
     int i;
+    virRWLockWrite(&doms->lock);
     virHashForEach(doms->objs, virDomainObjListCopyInactiveNames, &data);
+    virRWLockUnlock(&doms->lock);
     if (data.oom) {
         virReportOOMError();
         goto cleanup;
@@ -15967,7 +16210,7 @@ cleanup:
 
 int
 virDomainList(virConnectPtr conn,
-              virHashTablePtr domobjs,
+              virDomainObjListPtr doms,
               virDomainPtr **domains,
               unsigned int flags)
 {
@@ -15976,14 +16219,15 @@ virDomainList(virConnectPtr conn,
 
     struct virDomainListData data = { conn, NULL, flags, 0, false };
 
+    virRWLockWrite(&doms->lock);
     if (domains) {
-        if (VIR_ALLOC_N(data.domains, virHashSize(domobjs) + 1) < 0) {
+        if (VIR_ALLOC_N(data.domains, virHashSize(doms->objs) + 1) < 0) {
             virReportOOMError();
             goto cleanup;
         }
     }
 
-    virHashForEach(domobjs, virDomainListPopulate, &data);
+    virHashForEach(doms->objs, virDomainListPopulate, &data);
 
     if (data.error)
         goto cleanup;
@@ -15999,12 +16243,12 @@ virDomainList(virConnectPtr conn,
 
 cleanup:
     if (data.domains) {
-        int count = virHashSize(domobjs);
-        for (i = 0; i < count; i++)
+        for (i = 0; i < data.ndomains; i++)
             virObjectUnref(data.domains[i]);
     }
 
     VIR_FREE(data.domains);
+    virRWLockUnlock(&doms->lock);
     return ret;
 }
 
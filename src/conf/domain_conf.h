@@ -1894,9 +1894,27 @@ struct _virDomainObj {
 typedef struct _virDomainObjList virDomainObjList;
 typedef virDomainObjList *virDomainObjListPtr;
 struct _virDomainObjList {
+    /* Protects objs and objsName. Lookups only take it for reading.
+     * When both are needed, this lock must be acquired before that
+     * of any virDomainObj it contains, and after any driver-wide
+     * lock */
+    virRWLock lock;
+
     /* uuid string -> virDomainObj  mapping
      * for O(1), lockless lookup-by-uuid */
     virHashTable *objs;
+
+    /* name -> virDomainObj mapping for O(1) lookup-by-name */
+    virHashTable *objsName;
+
+    /* Protects objsID. IDs change while only the domain is locked,
+     * so this is a leaf lock: nothing else may be acquired while
+     * holding it */
+    virMutex idLock;
+
+    /* id -> virDomainObj mapping of running domains for O(1)
+     * lookup-by-id, kept up to date by virDomainObjListSetID */
+    virHashTable *objsID;
 };
 
 static inline bool
@@ -1917,6 +1935,14 @@ virDomainObjPtr virDomainFindByUUID(const virDomainObjListPtr doms,
 virDomainObjPtr virDomainFindByName(const virDomainObjListPtr doms,
                                     const char *name);
 
+int virDomainObjListForEach(virDomainObjListPtr doms,
+                            virHashIterator iter,
+                            void *opaque);
+
+void virDomainObjListSetID(virDomainObjListPtr doms,
+                           virDomainObjPtr dom,
+                           int id);
+
 bool virDomainObjTaint(virDomainObjPtr obj,
                        enum virDomainTaintFlags taint);
 
@@ -2366,7 +2392,7 @@ VIR_ENUM_DECL(virDomainStartupPolicy)
                  VIR_CONNECT_LIST_DOMAINS_FILTERS_AUTOSTART   | \
                  VIR_CONNECT_LIST_DOMAINS_FILTERS_SNAPSHOT)
 
-int virDomainList(virConnectPtr conn, virHashTablePtr domobjs,
+int virDomainList(virConnectPtr conn, virDomainObjListPtr doms,
                   virDomainPtr **domains, unsigned int flags);
 
 virDomainVcpuPinDefPtr virDomainLookupVcpuPin(virDomainDefPtr def,
@@ -43,6 +43,13 @@ struct _virDomainEventCallbackList {
     unsigned int nextID;
     unsigned int count;
     virDomainEventCallbackPtr *callbacks;
+
+    /* The callbacks grouped by event ID, so dispatching an event
+     * doesn't have to walk the callbacks of every other type. It
+     * is rebuilt before dispatching if the list changed since. */
+    bool indexDirty;
+    virDomainEventCallbackPtr *index[VIR_DOMAIN_EVENT_ID_LAST];
+    size_t nindex[VIR_DOMAIN_EVENT_ID_LAST];
 };
 
 struct _virDomainEventQueue {
@@ -121,6 +128,11 @@ struct _virDomainEvent {
             /* In unit of 1024 bytes */
             unsigned long long actual;
         } balloonChange;
+        struct {
+            unsigned long long iteration;
+            unsigned long long dirtyRate;
+            unsigned long long bandwidth;
+        } migrationStalled;
     } data;
 };
 
@@ -143,6 +155,8 @@ virDomainEventCallbackListFree(virDomainEventCallbackListPtr list)
             (*freecb)(list->callbacks[i]->opaque);
         VIR_FREE(list->callbacks[i]);
     }
+    for (i = 0; i < VIR_DOMAIN_EVENT_ID_LAST; i++)
+        VIR_FREE(list->index[i]);
     VIR_FREE(list);
 }
 
@@ -183,6 +197,7 @@ virDomainEventCallbackListRemove(virConnectPtr conn,
                 ; /* Failure to reduce memory allocation isn't fatal */
             }
             cbList->count--;
+            cbList->indexDirty = true;
 
             for (i = 0 ; i < cbList->count ; i++) {
                 if (!cbList->callbacks[i]->deleted)
@@ -233,6 +248,7 @@ virDomainEventCallbackListRemoveID(virConnectPtr conn,
                 ; /* Failure to reduce memory allocation isn't fatal */
             }
             cbList->count--;
+            cbList->indexDirty = true;
 
             for (i = 0 ; i < cbList->count ; i++) {
                 if (!cbList->callbacks[i]->deleted)
@@ -321,14 +337,54 @@ virDomainEventCallbackListPurgeMarked(virDomainEventCallbackListPtr cbList)
             i--;
         }
     }
-    if (cbList->count < old_count &&
-        VIR_REALLOC_N(cbList->callbacks, cbList->count) < 0) {
-        ; /* Failure to reduce memory allocation isn't fatal */
+    if (cbList->count < old_count) {
+        cbList->indexDirty = true;
+        if (VIR_REALLOC_N(cbList->callbacks, cbList->count) < 0) {
+            ; /* Failure to reduce memory allocation isn't fatal */
+        }
     }
     return 0;
 }
 
 
+/*
+ * Regroup the callbacks by event ID. Must not be called while
+ * dispatching, since the dispatcher walks the old index with the
+ * lock dropped.
+ */
+static int
+virDomainEventCallbackListIndex(virDomainEventCallbackListPtr cbList)
+{
+    int i;
+
+    if (!cbList->indexDirty)
+        return 0;
+
+    for (i = 0 ; i < VIR_DOMAIN_EVENT_ID_LAST ; i++) {
+        VIR_FREE(cbList->index[i]);
+        cbList->nindex[i] = 0;
+    }
+
+    for (i = 0 ; i < cbList->count ; i++) {
+        virDomainEventCallbackPtr cb = cbList->callbacks[i];
+
+        if (cb->deleted ||
+            cb->eventID < 0 || cb->eventID >= VIR_DOMAIN_EVENT_ID_LAST)
+            continue;
+
+        if (VIR_EXPAND_N(cbList->index[cb->eventID],
+                         cbList->nindex[cb->eventID], 1) < 0) {
+            virReportOOMError();
+            return -1;
+        }
+        cbList->index[cb->eventID][cbList->nindex[cb->eventID] - 1] = cb;
+    }
+
+    cbList->indexDirty = false;
+    return 0;
+}
+
+
 /**
  * virDomainEventCallbackListAddID:
  * @conn: pointer to the connection
@@ -399,6 +455,7 @@ virDomainEventCallbackListAddID(virConnectPtr conn,
 
     cbList->callbacks[cbList->count] = event;
     cbList->count++;
+    cbList->indexDirty = true;
 
     event->callbackID = cbList->nextID++;
 
@@ -1174,6 +1231,48 @@ virDomainEventPtr virDomainEventBalloonChangeNewFromObj(virDomainObjPtr obj,
     return ev;
 }
 
+static virDomainEventPtr
+virDomainEventMigrationStalledNew(int id, const char *name,
+                                  unsigned char *uuid,
+                                  unsigned long long iteration,
+                                  unsigned long long dirtyRate,
+                                  unsigned long long bandwidth)
+{
+    virDomainEventPtr ev =
+        virDomainEventNewInternal(VIR_DOMAIN_EVENT_ID_MIGRATION_STALLED,
+                                  id, name, uuid);
+
+    if (ev) {
+        ev->data.migrationStalled.iteration = iteration;
+        ev->data.migrationStalled.dirtyRate = dirtyRate;
+        ev->data.migrationStalled.bandwidth = bandwidth;
+    }
+
+    return ev;
+}
+
+virDomainEventPtr
+virDomainEventMigrationStalledNewFromObj(virDomainObjPtr obj,
+                                         unsigned long long iteration,
+                                         unsigned long long dirtyRate,
+                                         unsigned long long bandwidth)
+{
+    return virDomainEventMigrationStalledNew(obj->def->id,
+                                             obj->def->name,
+                                             obj->def->uuid,
+                                             iteration, dirtyRate, bandwidth);
+}
+
+virDomainEventPtr
+virDomainEventMigrationStalledNewFromDom(virDomainPtr dom,
+                                         unsigned long long iteration,
+                                         unsigned long long dirtyRate,
+                                         unsigned long long bandwidth)
+{
+    return virDomainEventMigrationStalledNew(dom->id, dom->name, dom->uuid,
+                                             iteration, dirtyRate, bandwidth);
+}
+
 /**
  * virDomainEventQueuePush:
  * @evtQueue: the dom event queue
@@ -1322,6 +1421,14 @@ virDomainEventDispatchDefaultFunc(virConnectPtr conn,
         ((virConnectDomainEventPMSuspendDiskCallback)cb)(conn, dom, 0, cbopaque);
         break;
 
+    case VIR_DOMAIN_EVENT_ID_MIGRATION_STALLED:
+        ((virConnectDomainEventMigrationStalledCallback)cb)(conn, dom,
+                                                            event->data.migrationStalled.iteration,
+                                                            event->data.migrationStalled.dirtyRate,
+                                                            event->data.migrationStalled.bandwidth,
+                                                            cbopaque);
+        break;
+
     default:
         VIR_WARN("Unexpected event ID %d", event->eventID);
         break;
@@ -1365,19 +1472,27 @@ virDomainEventDispatch(virDomainEventPtr event,
                        void *opaque)
 {
     int i;
+    virDomainEventCallbackPtr *cbs;
+    size_t cbCount;
+
+    if (event->eventID < 0 || event->eventID >= VIR_DOMAIN_EVENT_ID_LAST)
+        return;
+
     /* Cache this now, since we may be dropping the lock,
        and have more callbacks added. We're guaranteed not
-       to have any removed */
-    int cbCount = callbacks->count;
+       to have any removed, and callbacks added meanwhile only
+       mark the index dirty rather than rebuilding it */
+    cbs = callbacks->index[event->eventID];
+    cbCount = callbacks->nindex[event->eventID];
 
     for (i = 0 ; i < cbCount ; i++) {
-        if (!virDomainEventDispatchMatchCallback(event, callbacks->callbacks[i]))
+        if (!virDomainEventDispatchMatchCallback(event, cbs[i]))
             continue;
 
-        (*dispatch)(callbacks->callbacks[i]->conn,
+        (*dispatch)(cbs[i]->conn,
                     event,
-                    callbacks->callbacks[i]->cb,
-                    callbacks->callbacks[i]->opaque,
+                    cbs[i]->cb,
+                    cbs[i]->opaque,
                     opaque);
     }
 }
@@ -1453,11 +1568,18 @@ virDomainEventStateFlush(virDomainEventStatePtr state)
     state->queue->events = NULL;
     virEventUpdateTimeout(state->timer, -1);
 
+    if (virDomainEventCallbackListIndex(state->callbacks) < 0) {
+        VIR_DEBUG("Error indexing callbacks, dropping events");
+        virDomainEventQueueClear(&tempQueue);
+        goto cleanup;
+    }
+
     virDomainEventQueueDispatch(&tempQueue,
                                 state->callbacks,
                                 virDomainEventStateDispatchFunc,
                                 state);
 
+cleanup:
     /* Purge any deleted callbacks */
     virDomainEventCallbackListPurgeMarked(state->callbacks);
 
@@ -1673,3 +1795,68 @@ virDomainEventStateEventID(virConnectPtr conn,
     virDomainEventStateUnlock(state);
     return ret;
 }
+
+
+/**
+ * virDomainEventStateDomainFilter:
+ * @conn: connection associated with the callbacks
+ * @state: domain event state
+ * @eventID: the event type
+ * @uuids: filled with the UUIDs of the domains being watched
+ * @nuuids: filled with the number of UUIDs in @uuids
+ *
+ * Work out which domains the callbacks of connection @conn for
+ * events of type @eventID are watching, so that the source of the
+ * events can skip the others. @uuids holds @nuuids UUIDs of
+ * VIR_UUID_BUFLEN bytes each and must be freed by the caller.
+ *
+ * Returns 1 if the callbacks only watch the domains in @uuids,
+ * 0 if one of them watches every domain, -1 on error
+ */
+int
+virDomainEventStateDomainFilter(virConnectPtr conn,
+                                virDomainEventStatePtr state,
+                                int eventID,
+                                unsigned char **uuids,
+                                size_t *nuuids)
+{
+    virDomainEventCallbackListPtr cbList = state->callbacks;
+    unsigned char *tmp = NULL;
+    size_t ntmp = 0;
+    int ret = -1;
+    int i;
+
+    *uuids = NULL;
+    *nuuids = 0;
+
+    virDomainEventStateLock(state);
+
+    for (i = 0 ; i < cbList->count ; i++) {
+        virDomainEventCallbackPtr cb = cbList->callbacks[i];
+
+        if (cb->deleted || cb->eventID != eventID || cb->conn != conn)
+            continue;
+
+        if (!cb->dom) {
+            ret = 0;
+            goto cleanup;
+        }
+
+        if (VIR_REALLOC_N(tmp, (ntmp + 1) * VIR_UUID_BUFLEN) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+        memcpy(tmp + ntmp * VIR_UUID_BUFLEN, cb->dom->uuid, VIR_UUID_BUFLEN);
+        ntmp++;
+    }
+
+    *uuids = tmp;
+    *nuuids = ntmp;
+    tmp = NULL;
+    ret = 1;
+
+cleanup:
+    virDomainEventStateUnlock(state);
+    VIR_FREE(tmp);
+    return ret;
+}
@@ -132,6 +132,15 @@ virDomainEventPtr virDomainEventBalloonChangeNewFromObj(virDomainObjPtr obj, uns
 virDomainEventPtr virDomainEventPMSuspendDiskNewFromObj(virDomainObjPtr obj);
 virDomainEventPtr virDomainEventPMSuspendDiskNewFromDom(virDomainPtr dom);
 
+virDomainEventPtr virDomainEventMigrationStalledNewFromObj(virDomainObjPtr obj,
+                                                          unsigned long long iteration,
+                                                          unsigned long long dirtyRate,
+                                                          unsigned long long bandwidth);
+virDomainEventPtr virDomainEventMigrationStalledNewFromDom(virDomainPtr dom,
+                                                          unsigned long long iteration,
+                                                          unsigned long long dirtyRate,
+                                                          unsigned long long bandwidth);
+
 void virDomainEventFree(virDomainEventPtr event);
 
 void virDomainEventStateFree(virDomainEventStatePtr state);
@@ -172,5 +181,13 @@ virDomainEventStateEventID(virConnectPtr conn,
                            virDomainEventStatePtr state,
                            int callbackID)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+int
+virDomainEventStateDomainFilter(virConnectPtr conn,
+                                virDomainEventStatePtr state,
+                                int eventID,
+                                unsigned char **uuids,
+                                size_t *nuuids)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(4)
+    ATTRIBUTE_NONNULL(5);
 
 #endif
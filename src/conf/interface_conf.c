@@ -1199,20 +1199,17 @@ int virInterfaceFindByMACString(const virInterfaceObjListPtr interfaces,
     return matchct;
 }
 
+static void
+virInterfaceObjIndexLock(void *obj)
+{
+    virInterfaceObjLock(obj);
+}
+
 virInterfaceObjPtr virInterfaceFindByName(const virInterfaceObjListPtr
                                           interfaces,
                                           const char *name)
 {
-    unsigned int i;
-
-    for (i = 0 ; i < interfaces->count ; i++) {
-        virInterfaceObjLock(interfaces->objs[i]);
-        if (STREQ(interfaces->objs[i]->def->name, name))
-            return interfaces->objs[i];
-        virInterfaceObjUnlock(interfaces->objs[i]);
-    }
-
-    return NULL;
+    return virObjectIndexLookupName(interfaces->index, name);
 }
 
 void virInterfaceObjListFree(virInterfaceObjListPtr interfaces)
@@ -1224,6 +1221,8 @@ void virInterfaceObjListFree(virInterfaceObjListPtr interfaces)
 
     VIR_FREE(interfaces->objs);
     interfaces->count = 0;
+    virObjectIndexFree(interfaces->index);
+    interfaces->index = NULL;
 }
 
 int virInterfaceObjListClone(virInterfaceObjListPtr src,
@@ -1289,17 +1288,28 @@ virInterfaceObjPtr virInterfaceAssignDef(virInterfaceObjListPtr interfaces,
     virInterfaceObjLock(iface);
     iface->def = def;
 
+    if (!interfaces->index &&
+        !(interfaces->index = virObjectIndexNew(virInterfaceObjIndexLock)))
+        goto error;
+
     if (VIR_REALLOC_N(interfaces->objs, interfaces->count + 1) < 0) {
         virReportOOMError();
-        VIR_FREE(iface);
-        return NULL;
+        goto error;
     }
 
+    if (virObjectIndexAdd(interfaces->index, NULL, def->name, iface) < 0)
+        goto error;
+
     interfaces->objs[interfaces->count] = iface;
     interfaces->count++;
 
     return iface;
 
+error:
+    iface->def = NULL;
+    virInterfaceObjUnlock(iface);
+    virInterfaceObjFree(iface);
+    return NULL;
 }
 
 void virInterfaceRemove(virInterfaceObjListPtr interfaces,
@@ -1308,6 +1318,8 @@ void virInterfaceRemove(virInterfaceObjListPtr interfaces,
     unsigned int i;
 
     virInterfaceObjUnlock(iface);
+    virObjectIndexRemove(interfaces->index, NULL,
+                         iface->def->name, iface);
     for (i = 0 ; i < interfaces->count ; i++) {
         virInterfaceObjLock(interfaces->objs[i]);
         if (interfaces->objs[i] == iface) {
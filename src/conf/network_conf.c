@@ -60,34 +60,22 @@ VIR_ENUM_IMPL(virNetworkForwardHostdevDevice,
               VIR_NETWORK_FORWARD_HOSTDEV_DEVICE_LAST,
               "none", "pci", "netdev")
 
+static void
+virNetworkObjIndexLock(void *obj)
+{
+    virNetworkObjLock(obj);
+}
+
 virNetworkObjPtr virNetworkFindByUUID(const virNetworkObjListPtr nets,
                                       const unsigned char *uuid)
 {
-    unsigned int i;
-
-    for (i = 0 ; i < nets->count ; i++) {
-        virNetworkObjLock(nets->objs[i]);
-        if (!memcmp(nets->objs[i]->def->uuid, uuid, VIR_UUID_BUFLEN))
-            return nets->objs[i];
-        virNetworkObjUnlock(nets->objs[i]);
-    }
-
-    return NULL;
+    return virObjectIndexLookupUUID(nets->index, uuid);
 }
 
 virNetworkObjPtr virNetworkFindByName(const virNetworkObjListPtr nets,
                                       const char *name)
 {
-    unsigned int i;
-
-    for (i = 0 ; i < nets->count ; i++) {
-        virNetworkObjLock(nets->objs[i]);
-        if (STREQ(nets->objs[i]->def->name, name))
-            return nets->objs[i];
-        virNetworkObjUnlock(nets->objs[i]);
-    }
-
-    return NULL;
+    return virObjectIndexLookupName(nets->index, name);
 }
 
 
@@ -251,6 +239,8 @@ void virNetworkObjListFree(virNetworkObjListPtr nets)
 
     VIR_FREE(nets->objs);
     nets->count = 0;
+    virObjectIndexFree(nets->index);
+    nets->index = NULL;
 }
 
 /*
@@ -326,6 +316,10 @@ virNetworkAssignDef(virNetworkObjListPtr nets,
         return network;
     }
 
+    if (!nets->index &&
+        !(nets->index = virObjectIndexNew(virNetworkObjIndexLock)))
+        return NULL;
+
     if (VIR_REALLOC_N(nets->objs, nets->count + 1) < 0) {
         virReportOOMError();
         return NULL;
@@ -355,11 +349,16 @@ virNetworkAssignDef(virNetworkObjListPtr nets,
     ignore_value(virBitmapSetBit(network->class_id, 2));
 
     network->def = def;
+
+    if (virObjectIndexAdd(nets->index, def->uuid, def->name, network) < 0)
+        goto error;
+
     nets->objs[nets->count] = network;
     nets->count++;
 
     return network;
 error:
+    network->def = NULL;
     virNetworkObjUnlock(network);
     virNetworkObjFree(network);
     return NULL;
@@ -530,6 +529,8 @@ void virNetworkRemoveInactive(virNetworkObjListPtr nets,
     unsigned int i;
 
     virNetworkObjUnlock(net);
+    virObjectIndexRemove(nets->index, net->def->uuid,
+                         net->def->name, net);
     for (i = 0 ; i < nets->count ; i++) {
         virNetworkObjLock(nets->objs[i]);
         if (nets->objs[i] == net) {
@@ -32,6 +32,7 @@
 
 # include "internal.h"
 # include "virthread.h"
+# include "virobjectindex.h"
 # include "virsocketaddr.h"
 # include "virnetdevbandwidth.h"
 # include "virnetdevvportprofile.h"
@@ -243,6 +244,9 @@ typedef virNetworkObjList *virNetworkObjListPtr;
 struct _virNetworkObjList {
     unsigned int count;
     virNetworkObjPtr *objs;
+
+    /* name and UUID -> network, created along with the first network */
+    virObjectIndexPtr index;
 };
 
 static inline int
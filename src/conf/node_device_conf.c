@@ -87,38 +87,34 @@ int virNodeDeviceHasCap(const virNodeDeviceObjPtr dev, const char *cap)
 }
 
 
+static void
+virNodeDeviceObjIndexLock(void *obj)
+{
+    virNodeDeviceObjLock(obj);
+}
+
 virNodeDeviceObjPtr
 virNodeDeviceFindBySysfsPath(const virNodeDeviceObjListPtr devs,
                              const char *sysfs_path)
 {
-    unsigned int i;
+    virNodeDeviceObjPtr dev;
 
-    for (i = 0; i < devs->count; i++) {
-        virNodeDeviceObjLock(devs->objs[i]);
-        if ((devs->objs[i]->def->sysfs_path != NULL) &&
-            (STREQ(devs->objs[i]->def->sysfs_path, sysfs_path))) {
-            return devs->objs[i];
+    if ((dev = virObjectIndexLookupName(devs->sysfsIndex, sysfs_path))) {
+        if (!dev->def->sysfs_path ||
+            STRNEQ(dev->def->sysfs_path, sysfs_path)) {
+            virNodeDeviceObjUnlock(dev);
+            dev = NULL;
         }
-        virNodeDeviceObjUnlock(devs->objs[i]);
     }
 
-    return NULL;
+    return dev;
 }
 
 
 virNodeDeviceObjPtr virNodeDeviceFindByName(const virNodeDeviceObjListPtr devs,
                                             const char *name)
 {
-    unsigned int i;
-
-    for (i = 0; i < devs->count; i++) {
-        virNodeDeviceObjLock(devs->objs[i]);
-        if (STREQ(devs->objs[i]->def->name, name))
-            return devs->objs[i];
-        virNodeDeviceObjUnlock(devs->objs[i]);
-    }
-
-    return NULL;
+    return virObjectIndexLookupName(devs->index, name);
 }
 
 
@@ -166,6 +162,9 @@ void virNodeDeviceObjListFree(virNodeDeviceObjListPtr devs)
         virNodeDeviceObjFree(devs->objs[i]);
     VIR_FREE(devs->objs);
     devs->count = 0;
+    virObjectIndexFree(devs->index);
+    virObjectIndexFree(devs->sysfsIndex);
+    devs->index = devs->sysfsIndex = NULL;
 }
 
 virNodeDeviceObjPtr virNodeDeviceAssignDef(virNodeDeviceObjListPtr devs,
@@ -174,6 +173,18 @@ virNodeDeviceObjPtr virNodeDeviceAssignDef(virNodeDeviceObjListPtr devs,
     virNodeDeviceObjPtr device;
 
     if ((device = virNodeDeviceFindByName(devs, def->name))) {
+        /* A lookup could be holding the index while waiting for the
+         * device, so it is only changed with the device unlocked */
+        if (STRNEQ_NULLABLE(device->def->sysfs_path, def->sysfs_path)) {
+            virNodeDeviceObjUnlock(device);
+            virObjectIndexRemove(devs->sysfsIndex, NULL,
+                                 device->def->sysfs_path, device);
+            /* On failure the device merely can't be found by sysfs path */
+            if (def->sysfs_path)
+                ignore_value(virObjectIndexAdd(devs->sysfsIndex, NULL,
+                                               def->sysfs_path, device));
+            virNodeDeviceObjLock(device);
+        }
         virNodeDeviceDefFree(device->def);
         device->def = def;
         return device;
@@ -193,17 +204,39 @@ virNodeDeviceObjPtr virNodeDeviceAssignDef(virNodeDeviceObjListPtr devs,
     virNodeDeviceObjLock(device);
     device->def = def;
 
+    if ((!devs->index &&
+         !(devs->index = virObjectIndexNew(virNodeDeviceObjIndexLock))) ||
+        (!devs->sysfsIndex &&
+         !(devs->sysfsIndex =
+           virObjectIndexNew(virNodeDeviceObjIndexLock))))
+        goto error;
+
     if (VIR_REALLOC_N(devs->objs, devs->count+1) < 0) {
-        device->def = NULL;
-        virNodeDeviceObjUnlock(device);
-        virNodeDeviceObjFree(device);
         virReportOOMError();
-        return NULL;
+        goto error;
+    }
+
+    if (virObjectIndexAdd(devs->index, NULL, def->name, device) < 0)
+        goto error;
+    if (def->sysfs_path &&
+        virObjectIndexAdd(devs->sysfsIndex, NULL,
+                          def->sysfs_path, device) < 0) {
+        virNodeDeviceObjUnlock(device);
+        virObjectIndexRemove(devs->index, NULL, def->name, device);
+        virNodeDeviceObjLock(device);
+        goto error;
     }
+
     devs->objs[devs->count++] = device;
 
     return device;
 
+error:
+    device->def = NULL;
+    virNodeDeviceObjUnlock(device);
+    virNodeDeviceObjFree(device);
+    return NULL;
+
 }
 
 void virNodeDeviceObjRemove(virNodeDeviceObjListPtr devs,
@@ -212,6 +245,9 @@ void virNodeDeviceObjRemove(virNodeDeviceObjListPtr devs,
     unsigned int i;
 
     virNodeDeviceObjUnlock(dev);
+    virObjectIndexRemove(devs->index, NULL, dev->def->name, dev);
+    virObjectIndexRemove(devs->sysfsIndex, NULL,
+                         dev->def->sysfs_path, dev);
 
     for (i = 0; i < devs->count; i++) {
         virNodeDeviceObjLock(dev);
@@ -28,6 +28,7 @@
 # include "internal.h"
 # include "virutil.h"
 # include "virthread.h"
+# include "virobjectindex.h"
 
 # include <libxml/tree.h>
 
@@ -201,6 +202,11 @@ typedef virNodeDeviceObjList *virNodeDeviceObjListPtr;
 struct _virNodeDeviceObjList {
     unsigned int count;
     virNodeDeviceObjPtr *objs;
+
+    /* name -> device, created along with the first device */
+    virObjectIndexPtr index;
+    /* sysfs path -> device, for the devices which have one */
+    virObjectIndexPtr sysfsIndex;
 };
 
 typedef struct _virDeviceMonitorState virDeviceMonitorState;
@@ -353,6 +353,8 @@ virNWFilterObjListFree(virNWFilterObjListPtr nwfilters)
         virNWFilterObjFree(nwfilters->objs[i]);
     VIR_FREE(nwfilters->objs);
     nwfilters->count = 0;
+    virObjectIndexFree(nwfilters->index);
+    nwfilters->index = NULL;
 }
 
 
@@ -420,6 +422,8 @@ virNWFilterObjRemove(virNWFilterObjListPtr nwfilters,
     unsigned int i;
 
     virNWFilterObjUnlock(nwfilter);
+    virObjectIndexRemove(nwfilters->index, nwfilter->def->uuid,
+                         nwfilter->def->name, nwfilter);
 
     for (i = 0 ; i < nwfilters->count ; i++) {
         virNWFilterObjLock(nwfilters->objs[i]);
@@ -2680,36 +2684,24 @@ virNWFilterDefParseFile(virConnectPtr conn,
 }
 
 
+static void
+virNWFilterObjIndexLock(void *obj)
+{
+    virNWFilterObjLock(obj);
+}
+
 virNWFilterObjPtr
 virNWFilterObjFindByUUID(virNWFilterObjListPtr nwfilters,
                          const unsigned char *uuid)
 {
-    unsigned int i;
-
-    for (i = 0 ; i < nwfilters->count ; i++) {
-        virNWFilterObjLock(nwfilters->objs[i]);
-        if (!memcmp(nwfilters->objs[i]->def->uuid, uuid, VIR_UUID_BUFLEN))
-            return nwfilters->objs[i];
-        virNWFilterObjUnlock(nwfilters->objs[i]);
-    }
-
-    return NULL;
+    return virObjectIndexLookupUUID(nwfilters->index, uuid);
 }
 
 
 virNWFilterObjPtr
 virNWFilterObjFindByName(virNWFilterObjListPtr nwfilters, const char *name)
 {
-    unsigned int i;
-
-    for (i = 0 ; i < nwfilters->count ; i++) {
-        virNWFilterObjLock(nwfilters->objs[i]);
-        if (STREQ(nwfilters->objs[i]->def->name, name))
-            return nwfilters->objs[i];
-        virNWFilterObjUnlock(nwfilters->objs[i]);
-    }
-
-    return NULL;
+    return virObjectIndexLookupName(nwfilters->index, name);
 }
 
 
@@ -2985,6 +2977,30 @@ cleanup:
     return ret;
 }
 
+/*
+ * Filters are matched up by name when they are redefined, so the new
+ * definition may come with a different UUID. The index is only
+ * changed with @nwfilter unlocked, as a lookup could be holding the
+ * index while waiting for it.
+ */
+static void
+virNWFilterObjReplaceDef(virNWFilterObjListPtr nwfilters,
+                         virNWFilterObjPtr nwfilter,
+                         virNWFilterDefPtr def)
+{
+    if (memcmp(nwfilter->def->uuid, def->uuid, VIR_UUID_BUFLEN) != 0) {
+        virNWFilterObjUnlock(nwfilter);
+        virObjectIndexRemove(nwfilters->index, nwfilter->def->uuid,
+                             NULL, nwfilter);
+        /* On failure the filter merely can't be found by UUID */
+        ignore_value(virObjectIndexAdd(nwfilters->index, def->uuid,
+                                       NULL, nwfilter));
+        virNWFilterObjLock(nwfilter);
+    }
+    virNWFilterDefFree(nwfilter->def);
+    nwfilter->def = def;
+}
+
 virNWFilterObjPtr
 virNWFilterObjAssignDef(virConnectPtr conn,
                         virNWFilterObjListPtr nwfilters,
@@ -3017,8 +3033,7 @@ virNWFilterObjAssignDef(virConnectPtr conn,
     if ((nwfilter = virNWFilterObjFindByName(nwfilters, def->name))) {
 
         if (virNWFilterDefEqual(def, nwfilter->def, false)) {
-            virNWFilterDefFree(nwfilter->def);
-            nwfilter->def = def;
+            virNWFilterObjReplaceDef(nwfilters, nwfilter, def);
             virNWFilterUnlockFilterUpdates();
             return nwfilter;
         }
@@ -3032,8 +3047,7 @@ virNWFilterObjAssignDef(virConnectPtr conn,
             return NULL;
         }
 
-        virNWFilterDefFree(nwfilter->def);
-        nwfilter->def = def;
+        virNWFilterObjReplaceDef(nwfilters, nwfilter, def);
         nwfilter->newDef = NULL;
         virNWFilterUnlockFilterUpdates();
         return nwfilter;
@@ -3056,16 +3070,28 @@ virNWFilterObjAssignDef(virConnectPtr conn,
     nwfilter->active = 0;
     nwfilter->def = def;
 
+    if (!nwfilters->index &&
+        !(nwfilters->index = virObjectIndexNew(virNWFilterObjIndexLock)))
+        goto error;
+
     if (VIR_REALLOC_N(nwfilters->objs, nwfilters->count + 1) < 0) {
-        nwfilter->def = NULL;
-        virNWFilterObjUnlock(nwfilter);
-        virNWFilterObjFree(nwfilter);
         virReportOOMError();
-        return NULL;
+        goto error;
     }
+
+    if (virObjectIndexAdd(nwfilters->index, def->uuid,
+                          def->name, nwfilter) < 0)
+        goto error;
+
     nwfilters->objs[nwfilters->count++] = nwfilter;
 
     return nwfilter;
+
+error:
+    nwfilter->def = NULL;
+    virNWFilterObjUnlock(nwfilter);
+    virNWFilterObjFree(nwfilter);
+    return NULL;
 }
 
 
@@ -30,6 +30,7 @@
 
 # include "virutil.h"
 # include "virhash.h"
+# include "virobjectindex.h"
 # include "virxml.h"
 # include "virbuffer.h"
 # include "virsocketaddr.h"
@@ -549,6 +550,9 @@ typedef virNWFilterObjList *virNWFilterObjListPtr;
 struct _virNWFilterObjList {
     unsigned int count;
     virNWFilterObjPtr *objs;
+
+    /* name and UUID -> filter, created along with the first filter */
+    virObjectIndexPtr index;
 };
 
 
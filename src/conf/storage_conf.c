@@ -387,6 +387,8 @@ void virStoragePoolObjListFree(virStoragePoolObjListPtr pools)
         virStoragePoolObjFree(pools->objs[i]);
     VIR_FREE(pools->objs);
     pools->count = 0;
+    virObjectIndexFree(pools->index);
+    pools->index = NULL;
 }
 
 void
@@ -396,6 +398,8 @@ virStoragePoolObjRemove(virStoragePoolObjListPtr pools,
     unsigned int i;
 
     virStoragePoolObjUnlock(pool);
+    virObjectIndexRemove(pools->index, pool->def->uuid,
+                         pool->def->name, pool);
 
     for (i = 0 ; i < pools->count ; i++) {
         virStoragePoolObjLock(pools->objs[i]);
@@ -852,6 +856,9 @@ virStoragePoolDefParseXML(xmlXPathContextPtr ctxt) {
                                     "./target/permissions",
                                     DEFAULT_POOL_PERM_MODE) < 0)
             goto cleanup;
+
+        ret->target.watch = virXPathBoolean("boolean(./target/watch)",
+                                            ctxt) == 1;
     }
 
     return ret;
@@ -1070,6 +1077,8 @@ virStoragePoolDefFormat(virStoragePoolDefPtr def) {
                             def->target.perms.label);
 
         virBufferAddLit(&buf,"    </permissions>\n");
+        if (def->target.watch)
+            virBufferAddLit(&buf,"    <watch/>\n");
         virBufferAddLit(&buf,"  </target>\n");
     }
     virBufferAddLit(&buf,"</pool>\n");
@@ -1414,34 +1423,22 @@ virStorageVolDefFormat(virStoragePoolDefPtr pool,
 }
 
 
+static void
+virStoragePoolObjIndexLock(void *obj)
+{
+    virStoragePoolObjLock(obj);
+}
+
 virStoragePoolObjPtr
 virStoragePoolObjFindByUUID(virStoragePoolObjListPtr pools,
                             const unsigned char *uuid) {
-    unsigned int i;
-
-    for (i = 0 ; i < pools->count ; i++) {
-        virStoragePoolObjLock(pools->objs[i]);
-        if (!memcmp(pools->objs[i]->def->uuid, uuid, VIR_UUID_BUFLEN))
-            return pools->objs[i];
-        virStoragePoolObjUnlock(pools->objs[i]);
-    }
-
-    return NULL;
+    return virObjectIndexLookupUUID(pools->index, uuid);
 }
 
 virStoragePoolObjPtr
 virStoragePoolObjFindByName(virStoragePoolObjListPtr pools,
                             const char *name) {
-    unsigned int i;
-
-    for (i = 0 ; i < pools->count ; i++) {
-        virStoragePoolObjLock(pools->objs[i]);
-        if (STREQ(pools->objs[i]->def->name, name))
-            return pools->objs[i];
-        virStoragePoolObjUnlock(pools->objs[i]);
-    }
-
-    return NULL;
+    return virObjectIndexLookupName(pools->index, name);
 }
 
 virStoragePoolObjPtr
@@ -1459,6 +1456,135 @@ virStoragePoolSourceFindDuplicateDevices(virStoragePoolObjPtr pool,
     return NULL;
 }
 
+/* Make @vol findable by @key in *@table, unless another volume
+ * already is: lookups return the first volume added, just like a
+ * walk of the list would */
+static int
+virStorageVolDefListIndex(virHashTablePtr *table,
+                          const char *key,
+                          virStorageVolDefPtr vol)
+{
+    if (!key)
+        return 0;
+
+    if (!*table && !(*table = virHashCreate(32, NULL)))
+        return -1;
+
+    if (virHashLookup(*table, key))
+        return 0;
+
+    return virHashAddEntry(*table, key, vol);
+}
+
+static void
+virStorageVolDefListUnindex(virHashTablePtr table,
+                            const char *key,
+                            virStorageVolDefPtr vol)
+{
+    if (virHashLookup(table, key) == vol)
+        virHashRemoveEntry(table, key);
+}
+
+/**
+ * virStoragePoolObjAddVol:
+ * @pool: locked pool object
+ * @vol: the volume to add, with its name, key and target path filled in
+ *
+ * Append @vol to the volumes of @pool, which takes ownership of it on
+ * success.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+virStoragePoolObjAddVol(virStoragePoolObjPtr pool,
+                        virStorageVolDefPtr vol)
+{
+    virStorageVolDefListPtr vols = &pool->volumes;
+
+    if (VIR_REALLOC_N(vols->objs, vols->count + 1) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    if (virStorageVolDefListIndex(&vols->byName, vol->name, vol) < 0 ||
+        virStorageVolDefListIndex(&vols->byKey, vol->key, vol) < 0 ||
+        virStorageVolDefListIndex(&vols->byPath, vol->target.path, vol) < 0) {
+        virStorageVolDefListUnindex(vols->byName, vol->name, vol);
+        virStorageVolDefListUnindex(vols->byKey, vol->key, vol);
+        virStorageVolDefListUnindex(vols->byPath, vol->target.path, vol);
+        return -1;
+    }
+
+    vols->objs[vols->count++] = vol;
+    return 0;
+}
+
+/**
+ * virStoragePoolObjRemoveVol:
+ * @pool: locked pool object
+ * @vol: the volume to remove
+ *
+ * Remove @vol from the volumes of @pool, handing ownership of it back
+ * to the caller.
+ */
+void
+virStoragePoolObjRemoveVol(virStoragePoolObjPtr pool,
+                           virStorageVolDefPtr vol)
+{
+    virStorageVolDefListPtr vols = &pool->volumes;
+    bool byName, byKey, byPath;
+    unsigned int i;
+
+    for (i = 0 ; i < vols->count ; i++) {
+        if (vols->objs[i] == vol)
+            break;
+    }
+    if (i == vols->count)
+        return;
+
+    if (i < (vols->count - 1))
+        memmove(vols->objs + i, vols->objs + i + 1,
+                sizeof(*(vols->objs)) * (vols->count - (i + 1)));
+
+    if (VIR_REALLOC_N(vols->objs, vols->count - 1) < 0) {
+        ; /* Failure to reduce memory allocation isn't fatal */
+    }
+    vols->count--;
+
+    /* Hand the entries of @vol over to the next volume with the same
+     * name, key or path, if any. Updating an existing entry doesn't
+     * allocate, so this cannot fail */
+    byName = vol->name && virHashLookup(vols->byName, vol->name) == vol;
+    byKey = vol->key && virHashLookup(vols->byKey, vol->key) == vol;
+    byPath = vol->target.path &&
+        virHashLookup(vols->byPath, vol->target.path) == vol;
+
+    for (i = 0 ; i < vols->count && (byName || byKey || byPath) ; i++) {
+        virStorageVolDefPtr other = vols->objs[i];
+
+        if (byName && STREQ_NULLABLE(other->name, vol->name)) {
+            ignore_value(virHashUpdateEntry(vols->byName, vol->name, other));
+            byName = false;
+        }
+        if (byKey && STREQ_NULLABLE(other->key, vol->key)) {
+            ignore_value(virHashUpdateEntry(vols->byKey, vol->key, other));
+            byKey = false;
+        }
+        if (byPath && STREQ_NULLABLE(other->target.path, vol->target.path)) {
+            ignore_value(virHashUpdateEntry(vols->byPath,
+                                            vol->target.path, other));
+            byPath = false;
+        }
+    }
+
+    if (byName)
+        virHashRemoveEntry(vols->byName, vol->name);
+    if (byKey)
+        virHashRemoveEntry(vols->byKey, vol->key);
+    if (byPath)
+        virHashRemoveEntry(vols->byPath, vol->target.path);
+}
+
 void
 virStoragePoolObjClearVols(virStoragePoolObjPtr pool)
 {
@@ -1468,42 +1594,36 @@ virStoragePoolObjClearVols(virStoragePoolObjPtr pool)
 
     VIR_FREE(pool->volumes.objs);
     pool->volumes.count = 0;
+
+    virHashFree(pool->volumes.byName);
+    virHashFree(pool->volumes.byKey);
+    virHashFree(pool->volumes.byPath);
+    pool->volumes.byName = NULL;
+    pool->volumes.byKey = NULL;
+    pool->volumes.byPath = NULL;
+
+    if (pool->volumes.privateDataFreeFunc)
+        (pool->volumes.privateDataFreeFunc)(pool->volumes.privateData);
+    pool->volumes.privateData = NULL;
+    pool->volumes.privateDataFreeFunc = NULL;
 }
 
 virStorageVolDefPtr
 virStorageVolDefFindByKey(virStoragePoolObjPtr pool,
                           const char *key) {
-    unsigned int i;
-
-    for (i = 0 ; i < pool->volumes.count ; i++)
-        if (STREQ(pool->volumes.objs[i]->key, key))
-            return pool->volumes.objs[i];
-
-    return NULL;
+    return virHashLookup(pool->volumes.byKey, key);
 }
 
 virStorageVolDefPtr
 virStorageVolDefFindByPath(virStoragePoolObjPtr pool,
                            const char *path) {
-    unsigned int i;
-
-    for (i = 0 ; i < pool->volumes.count ; i++)
-        if (STREQ(pool->volumes.objs[i]->target.path, path))
-            return pool->volumes.objs[i];
-
-    return NULL;
+    return virHashLookup(pool->volumes.byPath, path);
 }
 
 virStorageVolDefPtr
 virStorageVolDefFindByName(virStoragePoolObjPtr pool,
                            const char *name) {
-    unsigned int i;
-
-    for (i = 0 ; i < pool->volumes.count ; i++)
-        if (STREQ(pool->volumes.objs[i]->name, name))
-            return pool->volumes.objs[i];
-
-    return NULL;
+    return virHashLookup(pool->volumes.byName, name);
 }
 
 virStoragePoolObjPtr
@@ -1537,16 +1657,27 @@ virStoragePoolObjAssignDef(virStoragePoolObjListPtr pools,
     pool->active = 0;
     pool->def = def;
 
+    if (!pools->index &&
+        !(pools->index = virObjectIndexNew(virStoragePoolObjIndexLock)))
+        goto error;
+
     if (VIR_REALLOC_N(pools->objs, pools->count+1) < 0) {
-        pool->def = NULL;
-        virStoragePoolObjUnlock(pool);
-        virStoragePoolObjFree(pool);
         virReportOOMError();
-        return NULL;
+        goto error;
     }
+
+    if (virObjectIndexAdd(pools->index, def->uuid, def->name, pool) < 0)
+        goto error;
+
     pools->objs[pools->count++] = pool;
 
     return pool;
+
+error:
+    pool->def = NULL;
+    virStoragePoolObjUnlock(pool);
+    virStoragePoolObjFree(pool);
+    return NULL;
 }
 
 static virStoragePoolObjPtr
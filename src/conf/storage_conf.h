@@ -28,6 +28,8 @@
 # include "virutil.h"
 # include "storage_encryption_conf.h"
 # include "virthread.h"
+# include "virobjectindex.h"
+# include "virhash.h"
 
 # include <libxml/tree.h>
 
@@ -96,6 +98,19 @@ struct _virStorageVolTarget {
 };
 
 
+/* Identity of the file a volume was last probed from, letting a
+ * backend skip probing files which are unchanged since */
+typedef struct _virStorageVolProbeStamp virStorageVolProbeStamp;
+typedef virStorageVolProbeStamp *virStorageVolProbeStampPtr;
+struct _virStorageVolProbeStamp {
+    bool valid;
+    unsigned long long dev;
+    unsigned long long ino;
+    unsigned long long size;
+    struct timespec mtime;
+    struct timespec ctime;
+};
+
 typedef struct _virStorageVolDef virStorageVolDef;
 typedef virStorageVolDef *virStorageVolDefPtr;
 struct _virStorageVolDef {
@@ -111,6 +126,8 @@ struct _virStorageVolDef {
     virStorageVolSource source;
     virStorageVolTarget target;
     virStorageVolTarget backingStore;
+
+    virStorageVolProbeStamp probed;
 };
 
 typedef struct _virStorageVolDefList virStorageVolDefList;
@@ -118,6 +135,18 @@ typedef virStorageVolDefList *virStorageVolDefListPtr;
 struct _virStorageVolDefList {
     unsigned int count;
     virStorageVolDefPtr *objs;
+
+    /* name, key and target path -> volume. Only maintained by
+     * virStoragePoolObjAddVol/RemoveVol, so volumes must not be
+     * put in objs directly */
+    virHashTablePtr byName;
+    virHashTablePtr byKey;
+    virHashTablePtr byPath;
+
+    /* Backend data tracking how current the list is, such as a
+     * watch on the pool directory. Freed along with the volumes */
+    void *privateData;
+    virFreeCallback privateDataFreeFunc;
 };
 
 
@@ -279,6 +308,7 @@ typedef virStoragePoolTarget *virStoragePoolTargetPtr;
 struct _virStoragePoolTarget {
     char *path;                /* Optional local filesystem mapping */
     virStoragePerms perms;     /* Default permissions for volumes */
+    bool watch;                /* Follow changes to the directory */
 };
 
 
@@ -321,6 +351,9 @@ typedef virStoragePoolObjList *virStoragePoolObjListPtr;
 struct _virStoragePoolObjList {
     unsigned int count;
     virStoragePoolObjPtr *objs;
+
+    /* name and UUID -> pool, created along with the first pool */
+    virObjectIndexPtr index;
 };
 
 
@@ -336,6 +369,14 @@ struct _virStorageDriverState {
 
     char *configDir;
     char *autostartDir;
+
+    /* Volume key and target path -> name of the pool holding the
+     * volume, to save asking every pool in lookups. Only a hint: the
+     * pool is checked before an entry is trusted. volIndexLock may be
+     * taken with a pool locked, so nothing else is locked under it */
+    virMutex volIndexLock;
+    virHashTablePtr volKeys;
+    virHashTablePtr volPaths;
 };
 
 typedef struct _virStoragePoolSourceList virStoragePoolSourceList;
@@ -369,6 +410,11 @@ virStorageVolDefPtr virStorageVolDefFindByPath(virStoragePoolObjPtr pool,
 virStorageVolDefPtr virStorageVolDefFindByName(virStoragePoolObjPtr pool,
                                                const char *name);
 
+int virStoragePoolObjAddVol(virStoragePoolObjPtr pool,
+                            virStorageVolDefPtr vol)
+    ATTRIBUTE_RETURN_CHECK;
+void virStoragePoolObjRemoveVol(virStoragePoolObjPtr pool,
+                                virStorageVolDefPtr vol);
 void virStoragePoolObjClearVols(virStoragePoolObjPtr pool);
 
 virStoragePoolDefPtr virStoragePoolDefParseString(const char *xml);
@@ -926,6 +926,62 @@ typedef int
                                     int **fdlist,
                                     unsigned int flags);
 
+typedef int
+    (*virDrvConnectGetRPCStats)(virConnectPtr conn,
+                                virTypedParameterPtr *params,
+                                int *nparams,
+                                unsigned int flags);
+
+typedef int
+    (*virDrvDomainGetInfoAsync)(virDomainPtr domain,
+                                virDomainInfoPtr info,
+                                virConnectAsyncCallback cb,
+                                void *opaque,
+                                unsigned int flags);
+
+typedef int
+    (*virDrvDomainBlockStatsAsync)(virDomainPtr domain,
+                                   const char *path,
+                                   virDomainBlockStatsPtr stats,
+                                   size_t size,
+                                   virConnectAsyncCallback cb,
+                                   void *opaque,
+                                   unsigned int flags);
+
+typedef int
+    (*virDrvDomainInterfaceStatsAsync)(virDomainPtr domain,
+                                       const char *path,
+                                       virDomainInterfaceStatsPtr stats,
+                                       size_t size,
+                                       virConnectAsyncCallback cb,
+                                       void *opaque,
+                                       unsigned int flags);
+
+typedef int
+    (*virDrvConnectWaitAsync)(virConnectPtr conn,
+                              unsigned int flags);
+
+typedef int
+    (*virDrvDomainMigratePrepareTunnelStream)(virConnectPtr dconn,
+                                              virStreamPtr st,
+                                              const char *dname,
+                                              unsigned int flags);
+
+typedef int
+    (*virDrvDomainGetJobStats)(virDomainPtr domain,
+                               int *type,
+                               virTypedParameterPtr *params,
+                               int *nparams,
+                               unsigned int flags);
+
+typedef int
+    (*virDrvConnectGetAllDomainStats)(virConnectPtr conn,
+                                      virDomainPtr *doms,
+                                      unsigned int ndoms,
+                                      unsigned int stats,
+                                      virDomainStatsRecordPtr **retStats,
+                                      unsigned int flags);
+
 /**
  * _virDriver:
  *
@@ -1120,6 +1176,14 @@ struct _virDriver {
     virDrvDomainFSTrim                  domainFSTrim;
     virDrvDomainSendProcessSignal       domainSendProcessSignal;
     virDrvDomainLxcOpenNamespace        domainLxcOpenNamespace;
+    virDrvConnectGetAllDomainStats      connectGetAllDomainStats;
+    virDrvConnectGetRPCStats            connectGetRPCStats;
+    virDrvDomainGetInfoAsync            domainGetInfoAsync;
+    virDrvDomainBlockStatsAsync         domainBlockStatsAsync;
+    virDrvDomainInterfaceStatsAsync     domainInterfaceStatsAsync;
+    virDrvConnectWaitAsync              connectWaitAsync;
+    virDrvDomainMigratePrepareTunnelStream domainMigratePrepareTunnelStream;
+    virDrvDomainGetJobStats             domainGetJobStats;
 };
 
 typedef int
@@ -27,6 +27,7 @@
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/wait.h>
+#include <sys/ioctl.h>
 #if HAVE_SYS_UN_H
 # include <sys/un.h>
 #endif
@@ -46,6 +47,7 @@
 /* Tunnelled migration stream support */
 struct virFDStreamData {
     int fd;
+    bool isPipe;
     int errfd;
     virCommandPtr cmd;
     unsigned long long offset;
@@ -460,6 +462,70 @@ static virStreamDriver virFDStreamDrv = {
     .streamRemoveCallback = virFDStreamRemoveCallback
 };
 
+/**
+ * virFDStreamSpliceSource:
+ * @st: the stream
+ * @nbytes: maximum number of bytes to take
+ * @fd: filled with a duplicate of the stream's file descriptor
+ *
+ * If @st reads from a pipe, take up to @nbytes of the data already
+ * buffered in it, which the caller then moves to its destination
+ * with splice() through @fd rather than by reading it. The data
+ * counts as read from @st.
+ *
+ * Returns the number of bytes taken, 0 if @st can't be used this
+ * way or has nothing buffered, in which case virStreamRecv must be
+ * used instead, or -1 on error
+ */
+int virFDStreamSpliceSource(virStreamPtr st, size_t nbytes, int *fd)
+{
+    struct virFDStreamData *fdst = st->privateData;
+    int ret = 0;
+#if HAVE_SPLICE && defined(FIONREAD)
+    int avail;
+#endif
+
+    *fd = -1;
+
+    if (st->driver != &virFDStreamDrv || !fdst || !fdst->isPipe)
+        return 0;
+
+#if HAVE_SPLICE && defined(FIONREAD)
+    virMutexLock(&fdst->lock);
+
+    if (fdst->length) {
+        if (fdst->length == fdst->offset)
+            goto cleanup;
+
+        if ((fdst->length - fdst->offset) < nbytes)
+            nbytes = fdst->length - fdst->offset;
+    }
+
+    if (ioctl(fdst->fd, FIONREAD, &avail) < 0 || avail <= 0)
+        goto cleanup;
+    if (avail < nbytes)
+        nbytes = avail;
+    if (nbytes > INT_MAX)
+        nbytes = INT_MAX;
+
+    if ((*fd = dup(fdst->fd)) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to duplicate stream file descriptor"));
+        ret = -1;
+        goto cleanup;
+    }
+
+    if (fdst->length)
+        fdst->offset += nbytes;
+    ret = nbytes;
+
+cleanup:
+    virMutexUnlock(&fdst->lock);
+#endif
+    return ret;
+}
+
+
 static int virFDStreamOpenInternal(virStreamPtr st,
                                    int fd,
                                    virCommandPtr cmd,
@@ -467,6 +533,7 @@ static int virFDStreamOpenInternal(virStreamPtr st,
                                    unsigned long long length)
 {
     struct virFDStreamData *fdst;
+    struct stat sb;
 
     VIR_DEBUG("st=%p fd=%d cmd=%p errfd=%d length=%llu",
               st, fd, cmd, errfd, length);
@@ -481,6 +548,7 @@ static int virFDStreamOpenInternal(virStreamPtr st,
     }
 
     fdst->fd = fd;
+    fdst->isPipe = fstat(fd, &sb) == 0 && S_ISFIFO(sb.st_mode);
     fdst->cmd = cmd;
     fdst->errfd = errfd;
     fdst->length = length;
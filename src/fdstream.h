@@ -52,6 +52,10 @@ int virFDStreamCreateFile(virStreamPtr st,
                           int oflags,
                           mode_t mode);
 
+int virFDStreamSpliceSource(virStreamPtr st,
+                            size_t nbytes,
+                            int *fd);
+
 int virFDStreamSetInternalCloseCb(virStreamPtr st,
                                   virFDStreamInternalCloseCb cb,
                                   void *opaque,
@@ -5139,6 +5139,13 @@ virDomainMigrateDirect(virDomainPtr domain,
  *                                 automatically when supported).
  *   VIR_MIGRATE_UNSAFE    Force migration even if it is considered unsafe.
  *   VIR_MIGRATE_OFFLINE Migrate offline
+ *   VIR_MIGRATE_COMPRESSED Compress the data of a tunnelled migration.
+ *   VIR_MIGRATE_PARALLEL  Send the data of a tunnelled migration over
+ *                         several connections.
+ *   VIR_MIGRATE_AUTO_CONVERGE Raise the migration speed and the allowed
+ *                         downtime step by step, within the limits set by
+ *                         the hypervisor configuration, whenever the
+ *                         migration stops making progress.
  *
  * VIR_MIGRATE_TUNNELLED requires that VIR_MIGRATE_PEER2PEER be set.
  * Applications using the VIR_MIGRATE_PEER2PEER flag will probably
@@ -5353,6 +5360,13 @@ error:
  *                                 automatically when supported).
  *   VIR_MIGRATE_UNSAFE    Force migration even if it is considered unsafe.
  *   VIR_MIGRATE_OFFLINE Migrate offline
+ *   VIR_MIGRATE_COMPRESSED Compress the data of a tunnelled migration.
+ *   VIR_MIGRATE_PARALLEL  Send the data of a tunnelled migration over
+ *                         several connections.
+ *   VIR_MIGRATE_AUTO_CONVERGE Raise the migration speed and the allowed
+ *                         downtime step by step, within the limits set by
+ *                         the hypervisor configuration, whenever the
+ *                         migration stops making progress.
  *
  * VIR_MIGRATE_TUNNELLED requires that VIR_MIGRATE_PEER2PEER be set.
  * Applications using the VIR_MIGRATE_PEER2PEER flag will probably
@@ -5585,6 +5599,13 @@ error:
  *                                 automatically when supported).
  *   VIR_MIGRATE_UNSAFE    Force migration even if it is considered unsafe.
  *   VIR_MIGRATE_OFFLINE Migrate offline
+ *   VIR_MIGRATE_COMPRESSED Compress the data of a tunnelled migration.
+ *   VIR_MIGRATE_PARALLEL  Send the data of a tunnelled migration over
+ *                         several connections.
+ *   VIR_MIGRATE_AUTO_CONVERGE Raise the migration speed and the allowed
+ *                         downtime step by step, within the limits set by
+ *                         the hypervisor configuration, whenever the
+ *                         migration stops making progress.
  *
  * The operation of this API hinges on the VIR_MIGRATE_PEER2PEER flag.
  * If the VIR_MIGRATE_PEER2PEER flag is NOT set, the duri parameter
@@ -5724,6 +5745,13 @@ error:
  *                                 automatically when supported).
  *   VIR_MIGRATE_UNSAFE    Force migration even if it is considered unsafe.
  *   VIR_MIGRATE_OFFLINE Migrate offline
+ *   VIR_MIGRATE_COMPRESSED Compress the data of a tunnelled migration.
+ *   VIR_MIGRATE_PARALLEL  Send the data of a tunnelled migration over
+ *                         several connections.
+ *   VIR_MIGRATE_AUTO_CONVERGE Raise the migration speed and the allowed
+ *                         downtime step by step, within the limits set by
+ *                         the hypervisor configuration, whenever the
+ *                         migration stops making progress.
  *
  * The operation of this API hinges on the VIR_MIGRATE_PEER2PEER flag.
  *
@@ -6303,6 +6331,61 @@ error:
 }
 
 
+/*
+ * Not for public use.  This function is part of the internal
+ * implementation of migration in the remote case.
+ *
+ * Attaches @st as one more stream carrying the data of the
+ * VIR_MIGRATE_PARALLEL tunnelled migration of domain @dname,
+ * which virDomainMigratePrepareTunnel3 already set up.
+ */
+int
+virDomainMigratePrepareTunnelStream(virConnectPtr conn,
+                                    virStreamPtr st,
+                                    const char *dname,
+                                    unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, stream=%p, dname=%s, flags=%x",
+              conn, st, NULLSTR(dname), flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECT(conn)) {
+        virLibConnError(VIR_ERR_INVALID_CONN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+
+    if (conn->flags & VIR_CONNECT_RO) {
+        virLibConnError(VIR_ERR_OPERATION_DENIED, __FUNCTION__);
+        goto error;
+    }
+
+    virCheckNonNullArgGoto(dname, error);
+
+    if (conn != st->conn) {
+        virReportInvalidArg(conn,
+                            _("conn in %s must match stream connection"),
+                            __FUNCTION__);
+        goto error;
+    }
+
+    if (conn->driver->domainMigratePrepareTunnelStream) {
+        int rv = conn->driver->domainMigratePrepareTunnelStream(conn, st,
+                                                                dname, flags);
+        if (rv < 0)
+            goto error;
+        return rv;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(conn);
+    return -1;
+}
+
+
 /*
  * Not for public use.  This function is part of the internal
  * implementation of migration in the remote case.
@@ -7473,6 +7556,245 @@ error:
     return -1;
 }
 
+
+/**
+ * virDomainGetInfoAsync:
+ * @domain: a domain object
+ * @info: pointer to a virDomainInfo structure allocated by the user
+ * @cb: callback to invoke once @info has been filled in
+ * @opaque: user data to pass to @cb
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Asynchronous version of virDomainGetInfo(). The call is sent and
+ * this function returns without waiting for the reply, so that many
+ * calls can be in flight on the same connection at once. @info must
+ * stay valid until @cb has been invoked.
+ *
+ * @cb runs in whichever thread happens to process the connection's
+ * I/O when the reply arrives: a thread making a synchronous API call,
+ * the event loop if one is registered, or a thread blocked in
+ * virConnectWaitAsync(). It may also run before this function
+ * returns.
+ *
+ * Returns 0 if the call was sent, in which case @cb will be invoked
+ * exactly once, or -1 on failure, in which case @cb is never invoked.
+ */
+int
+virDomainGetInfoAsync(virDomainPtr domain,
+                      virDomainInfoPtr info,
+                      virConnectAsyncCallback cb,
+                      void *opaque,
+                      unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(domain, "info=%p, cb=%p, opaque=%p, flags=%x",
+                     info, cb, opaque, flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECTED_DOMAIN(domain)) {
+        virLibDomainError(VIR_ERR_INVALID_DOMAIN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+    virCheckNonNullArgGoto(info, error);
+    virCheckNonNullArgGoto(cb, error);
+
+    memset(info, 0, sizeof(virDomainInfo));
+
+    conn = domain->conn;
+
+    if (conn->driver->domainGetInfoAsync) {
+        int ret;
+        ret = conn->driver->domainGetInfoAsync(domain, info, cb, opaque, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(domain->conn);
+    return -1;
+}
+
+
+/**
+ * virDomainBlockStatsAsync:
+ * @dom: pointer to the domain object
+ * @disk: path to the block device, or device shorthand
+ * @stats: block device stats (returned)
+ * @size: size of stats structure
+ * @cb: callback to invoke once @stats has been filled in
+ * @opaque: user data to pass to @cb
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Asynchronous version of virDomainBlockStats(). @stats must stay
+ * valid until @cb has been invoked. See virDomainGetInfoAsync() for
+ * how and when @cb runs.
+ *
+ * Returns 0 if the call was sent, in which case @cb will be invoked
+ * exactly once, or -1 on failure, in which case @cb is never invoked.
+ */
+int
+virDomainBlockStatsAsync(virDomainPtr dom,
+                         const char *disk,
+                         virDomainBlockStatsPtr stats,
+                         size_t size,
+                         virConnectAsyncCallback cb,
+                         void *opaque,
+                         unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(dom, "disk=%s, stats=%p, size=%zi, cb=%p, opaque=%p, flags=%x",
+                     disk, stats, size, cb, opaque, flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECTED_DOMAIN(dom)) {
+        virLibDomainError(VIR_ERR_INVALID_DOMAIN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+    virCheckNonNullArgGoto(disk, error);
+    virCheckNonNullArgGoto(stats, error);
+    virCheckNonNullArgGoto(cb, error);
+    if (size > sizeof(virDomainBlockStatsStruct)) {
+        virReportInvalidArg(size,
+                            _("size in %s must not exceed %zu"),
+                            __FUNCTION__, sizeof(virDomainBlockStatsStruct));
+        goto error;
+    }
+    conn = dom->conn;
+
+    if (conn->driver->domainBlockStatsAsync) {
+        if (conn->driver->domainBlockStatsAsync(dom, disk, stats, size,
+                                                cb, opaque, flags) < 0)
+            goto error;
+        return 0;
+    }
+
+    virLibDomainError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(dom->conn);
+    return -1;
+}
+
+
+/**
+ * virDomainInterfaceStatsAsync:
+ * @dom: pointer to the domain object
+ * @path: path to the interface
+ * @stats: network interface stats (returned)
+ * @size: size of stats structure
+ * @cb: callback to invoke once @stats has been filled in
+ * @opaque: user data to pass to @cb
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Asynchronous version of virDomainInterfaceStats(). @stats must
+ * stay valid until @cb has been invoked. See virDomainGetInfoAsync()
+ * for how and when @cb runs.
+ *
+ * Returns 0 if the call was sent, in which case @cb will be invoked
+ * exactly once, or -1 on failure, in which case @cb is never invoked.
+ */
+int
+virDomainInterfaceStatsAsync(virDomainPtr dom,
+                             const char *path,
+                             virDomainInterfaceStatsPtr stats,
+                             size_t size,
+                             virConnectAsyncCallback cb,
+                             void *opaque,
+                             unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(dom, "path=%s, stats=%p, size=%zi, cb=%p, opaque=%p, flags=%x",
+                     path, stats, size, cb, opaque, flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECTED_DOMAIN(dom)) {
+        virLibDomainError(VIR_ERR_INVALID_DOMAIN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+    virCheckNonNullArgGoto(path, error);
+    virCheckNonNullArgGoto(stats, error);
+    virCheckNonNullArgGoto(cb, error);
+    if (size > sizeof(virDomainInterfaceStatsStruct)) {
+        virReportInvalidArg(size,
+                            _("size in %s must not exceed %zu"),
+                            __FUNCTION__, sizeof(virDomainInterfaceStatsStruct));
+        goto error;
+    }
+
+    conn = dom->conn;
+
+    if (conn->driver->domainInterfaceStatsAsync) {
+        if (conn->driver->domainInterfaceStatsAsync(dom, path, stats, size,
+                                                    cb, opaque, flags) < 0)
+            goto error;
+        return 0;
+    }
+
+    virLibDomainError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(dom->conn);
+    return -1;
+}
+
+
+/**
+ * virConnectWaitAsync:
+ * @conn: pointer to the hypervisor connection
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Process the connection until the callbacks of all asynchronous
+ * calls issued on it, such as virDomainGetInfoAsync(), have been
+ * invoked. Applications which do not run an event loop must use
+ * this to collect the replies. Callbacks are invoked from the
+ * calling thread and may issue further calls on @conn, including
+ * asynchronous ones which this function then waits for as well.
+ *
+ * Returns 0 on success, or -1 if the connection failed, in which
+ * case the callbacks of the outstanding calls have been invoked
+ * with an error.
+ */
+int
+virConnectWaitAsync(virConnectPtr conn,
+                    unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, flags=%x", conn, flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECT(conn)) {
+        virLibConnError(VIR_ERR_INVALID_CONN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+
+    if (conn->driver->connectWaitAsync) {
+        int ret;
+        ret = conn->driver->connectWaitAsync(conn, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(conn);
+    return -1;
+}
+
  /**
  * virDomainSetInterfaceParameters:
  * @domain: pointer to domain object
@@ -15641,6 +15963,13 @@ virSecretFree(virSecretPtr secret)
  * If a non-blocking data stream is required passed
  * VIR_STREAM_NONBLOCK for flags, otherwise pass 0.
  *
+ * With VIR_STREAM_COMPRESS, data going through a remote
+ * connection is compressed when the server supports it, using
+ * fast compression, or the best compression if
+ * VIR_STREAM_COMPRESS_BEST is also passed. Either way, chunks
+ * of zeros, such as the unallocated parts of a disk image,
+ * are sent as a mere length. Local streams ignore these flags.
+ *
  * Returns the new stream, or NULL upon error
  */
 virStreamPtr
@@ -17352,6 +17681,78 @@ error:
 }
 
 
+/**
+ * virDomainGetJobStats:
+ * @domain: a domain object
+ * @type: where to store the job type (one of virDomainJobType)
+ * @params: where to store job statistics
+ * @nparams: number of items in @params
+ * @flags: bitwise-OR of virDomainGetJobStatsFlags
+ *
+ * Extract information about progress of a background job on a domain.
+ * Will return an error if the domain is not active, unless @flags contains
+ * VIR_DOMAIN_JOB_STATS_COMPLETED. The function returns a superset of
+ * progress information provided by virDomainGetJobInfo. Possible fields
+ * returned in @params are defined by VIR_DOMAIN_JOB_* macros and new fields
+ * will likely be introduced in the future so callers may receive fields
+ * that they do not understand in case they talk to a newer server.
+ *
+ * When @flags contains VIR_DOMAIN_JOB_STATS_COMPLETED, the function will
+ * return statistics about a recently completed job. Specifically, this
+ * flag may be used to query statistics of a completed outgoing migration.
+ * Statistics of a completed job are kept until the next job completes and
+ * are also available once the domain is no longer running.
+ *
+ * When no job is running (or no completed job is known when
+ * VIR_DOMAIN_JOB_STATS_COMPLETED is used), @type is set to
+ * VIR_DOMAIN_JOB_NONE and @nparams to 0.
+ *
+ * The caller is responsible for freeing @params using virTypedParamsFree.
+ *
+ * Returns 0 in case of success and -1 in case of failure.
+ */
+int
+virDomainGetJobStats(virDomainPtr domain,
+                     int *type,
+                     virTypedParameterPtr *params,
+                     int *nparams,
+                     unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(domain, "type=%p, params=%p, nparams=%p, flags=%x",
+                     type, params, nparams, flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECTED_DOMAIN(domain)) {
+        virLibDomainError(VIR_ERR_INVALID_DOMAIN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+    virCheckNonNullArgGoto(type, error);
+    virCheckNonNullArgGoto(params, error);
+    virCheckNonNullArgGoto(nparams, error);
+
+    conn = domain->conn;
+
+    if (conn->driver->domainGetJobStats) {
+        int ret;
+        ret = conn->driver->domainGetJobStats(domain, type, params,
+                                              nparams, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(domain->conn);
+    return -1;
+}
+
+
 /**
  * virDomainAbortJob:
  * @domain: a domain object
@@ -19857,6 +20258,79 @@ error:
     return -1;
 }
 
+/**
+ * virConnectGetRPCStats:
+ * @conn: pointer to the connection object
+ * @params: pointer that will be filled with an array of statistics
+ * @nparams: pointer that will be filled with the number of statistics
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Retrieve per-procedure statistics about the RPC calls processed by
+ * the daemon at the other end of @conn, summed over all its clients
+ * since it was started. Only procedures which have been called at
+ * least once are reported.
+ *
+ * The typed parameter keys are in the format
+ * "<program>.<procedure>.<field>", where <program> is one of "remote",
+ * "qemu" or "lxc" and <procedure> is the name of the call, for
+ * example "remote.DomainGetInfo.calls". All times are in microseconds
+ * and all values are unsigned long long. The fields are:
+ *
+ * "calls" - number of calls
+ * "errors" - number of calls which failed
+ * "wait.total" - time calls spent queued before a worker thread picked
+ *                them up
+ * "wait.max" - longest time a single call spent queued
+ * "exec.total" - time spent executing calls
+ * "exec.max" - longest time spent executing a single call
+ * "exec.hist.<limit>" - number of calls which ran for less than <limit>
+ *                       microseconds, but not less than the previous
+ *                       limit; limits go from 10 to 10000000 in powers
+ *                       of ten, and "exec.hist.inf" counts the rest
+ * "reply.bytes" - total size of the replies
+ * "reply.max" - size of the largest reply
+ *
+ * Connections which do not go through a daemon do not support this.
+ *
+ * Returns 0 on success, -1 on error. The caller must free @params
+ * with virTypedParamsFree.
+ */
+int virConnectGetRPCStats(virConnectPtr conn,
+                          virTypedParameterPtr *params,
+                          int *nparams,
+                          unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, params=%p, nparams=%p, flags=%x",
+              conn, params, nparams, flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECT(conn)) {
+        virLibConnError(VIR_ERR_INVALID_CONN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+
+    virCheckNonNullArgGoto(params, error);
+    virCheckNonNullArgGoto(nparams, error);
+    *params = NULL;
+    *nparams = 0;
+
+    if (conn->driver->connectGetRPCStats) {
+        int ret;
+        ret = conn->driver->connectGetRPCStats(conn, params, nparams, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(conn);
+    return -1;
+}
+
 /**
  * virConnectIsAlive:
  * @conn: pointer to the connection object
@@ -20526,3 +21000,282 @@ error:
     virDispatchError(dom->conn);
     return -1;
 }
+
+/**
+ * virConnectGetAllDomainStats:
+ * @conn: pointer to the hypervisor connection
+ * @stats: stats to return, binary-OR of virDomainStatsTypes
+ * @retStats: Pointer that will be filled with the array of returned stats
+ * @flags: extra flags; binary-OR of virConnectGetAllDomainStatsFlags
+ *
+ * Query statistics for all domains on a given connection, in a
+ * single call. This is much cheaper than querying each domain with
+ * the individual statistics APIs, since drivers can batch the
+ * queries they need to make to the hypervisor.
+ *
+ * Report statistics of various parameters for a running VM according to @stats
+ * field. The statistics are returned as an array of structures for each queried
+ * domain. The structure contains an array of typed parameters containing the
+ * individual statistics. The typed parameter name for each statistic field
+ * consists of a dot-separated string containing name of the requested group
+ * followed by a group specific description of the statistic value.
+ *
+ * The statistic groups are enabled using the @stats parameter which is a
+ * binary-OR of enum virDomainStatsTypes. The following groups are available
+ * (although not necessarily implemented for each hypervisor):
+ *
+ * VIR_DOMAIN_STATS_STATE: Return domain state and reason for entering that
+ * state. The typed parameter keys are in this format:
+ * "state.state" - state of the VM, returned as int from virDomainState enum
+ * "state.reason" - reason for entering given state, returned as int from
+ *                  virDomain*Reason enum corresponding to given state.
+ *
+ * VIR_DOMAIN_STATS_CPU_TOTAL: Return CPU statistics and usage information.
+ * The typed parameter keys are in this format:
+ * "cpu.time" - total cpu time spent for this domain in nanoseconds
+ *              as unsigned long long.
+ * "cpu.user" - user cpu time spent in nanoseconds as unsigned long long.
+ * "cpu.system" - system cpu time spent in nanoseconds as unsigned long long.
+ *
+ * VIR_DOMAIN_STATS_BALLOON: Return memory balloon device information.
+ * The typed parameter keys are in this format:
+ * "balloon.current" - the memory in kiB currently used
+ *                     as unsigned long long.
+ * "balloon.maximum" - the maximum memory in kiB allowed
+ *                     as unsigned long long.
+ *
+ * VIR_DOMAIN_STATS_VCPU: Return virtual CPU statistics.
+ * The typed parameter keys are in this format:
+ * "vcpu.current" - current number of online virtual CPUs as unsigned int.
+ * "vcpu.maximum" - maximum number of online virtual CPUs as unsigned int.
+ * "vcpu.<num>.state" - state of the virtual CPU <num>, as int
+ *                      from virVcpuState enum.
+ * "vcpu.<num>.time" - virtual cpu time spent by virtual CPU <num>
+ *                     as unsigned long long.
+ *
+ * VIR_DOMAIN_STATS_INTERFACE: Return network interface statistics.
+ * The typed parameter keys are in this format:
+ * "net.count" - number of network interfaces on this domain which
+ *               have a host side device, as unsigned int.
+ * "net.<num>.name" - name of the interface <num> as string.
+ * "net.<num>.rx.bytes" - bytes received as unsigned long long.
+ * "net.<num>.rx.pkts" - packets received as unsigned long long.
+ * "net.<num>.rx.errs" - receive errors as unsigned long long.
+ * "net.<num>.rx.drop" - receive packets dropped as unsigned long long.
+ * "net.<num>.tx.bytes" - bytes transmitted as unsigned long long.
+ * "net.<num>.tx.pkts" - packets transmitted as unsigned long long.
+ * "net.<num>.tx.errs" - transmission errors as unsigned long long.
+ * "net.<num>.tx.drop" - transmit packets dropped as unsigned long long.
+ *
+ * VIR_DOMAIN_STATS_BLOCK: Return block devices statistics.
+ * The typed parameter keys are in this format:
+ * "block.count" - number of block devices on this domain
+ *                 as unsigned int.
+ * "block.<num>.name" - name of the block device <num> as string.
+ *                      matches the target name (vda/sda/hda) of the
+ *                      block device.
+ * "block.<num>.rd.reqs" - number of read requests as unsigned long long.
+ * "block.<num>.rd.bytes" - number of read bytes as unsigned long long.
+ * "block.<num>.rd.times" - total time (ns) spent on reads as
+ *                          unsigned long long.
+ * "block.<num>.wr.reqs" - number of write requests as unsigned long long.
+ * "block.<num>.wr.bytes" - number of written bytes as unsigned long long.
+ * "block.<num>.wr.times" - total time (ns) spent on writes as
+ *                          unsigned long long.
+ * "block.<num>.fl.reqs" - total flush requests as unsigned long long.
+ * "block.<num>.fl.times" - total time (ns) spent on cache flushing as
+ *                          unsigned long long.
+ * "block.<num>.errs" - number of errors as unsigned long long, only
+ *                      reported by some hypervisors.
+ *
+ * Statistics which cannot be collected at the moment, for example
+ * because the domain is not running or is busy with a job, are
+ * silently omitted.
+ *
+ * Using 0 for @stats returns all stats groups supported by the given
+ * hypervisor.
+ *
+ * Specifying VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS as @flags makes
+ * the function return error in case some of the stat types in @stats were
+ * not recognized by the daemon.
+ *
+ * Similarly to virConnectListAllDomains, @flags can contain various flags to
+ * filter the list of domains to provide stats for.
+ *
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_ACTIVE selects online domains while
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_INACTIVE selects offline ones.
+ *
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_PERSISTENT and
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_TRANSIENT allow to filter the list
+ * according to their persistence.
+ *
+ * To filter the list of VMs by domain state @flags can contain
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_RUNNING,
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_PAUSED,
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_SHUTOFF and/or
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_OTHER for all other states.
+ *
+ * Returns the count of returned statistics structures on success, -1 on error.
+ * The requested data are returned in the @retStats parameter. The returned
+ * array should be freed by the caller. See virDomainStatsRecordListFree.
+ */
+int
+virConnectGetAllDomainStats(virConnectPtr conn,
+                            unsigned int stats,
+                            virDomainStatsRecordPtr **retStats,
+                            unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, stats=0x%x, retStats=%p, flags=0x%x",
+              conn, stats, retStats, flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECT(conn)) {
+        virLibConnError(VIR_ERR_INVALID_CONN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+
+    virCheckNonNullArgGoto(retStats, error);
+    *retStats = NULL;
+
+    if (conn->driver->connectGetAllDomainStats) {
+        int ret;
+        ret = conn->driver->connectGetAllDomainStats(conn, NULL, 0, stats,
+                                                     retStats, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(conn);
+    return -1;
+}
+
+/**
+ * virDomainListGetStats:
+ * @doms: NULL terminated array of domains
+ * @stats: stats to return, binary-OR of virDomainStatsTypes
+ * @retStats: Pointer that will be filled with the array of returned stats
+ * @flags: extra flags; binary-OR of virConnectGetAllDomainStatsFlags
+ *
+ * Query statistics for domains provided by @doms. Note that all domains in
+ * @doms must share the same connection.
+ *
+ * Report statistics of various parameters for a running VM according to @stats
+ * field. The statistics are returned as an array of structures for each queried
+ * domain. The structure contains an array of typed parameters containing the
+ * individual statistics. The typed parameter name for each statistic field
+ * consists of a dot-separated string containing name of the requested group
+ * followed by a group specific description of the statistic value.
+ *
+ * The statistic groups are enabled using the @stats parameter which is a
+ * binary-OR of enum virDomainStatsTypes. The stats groups are documented
+ * in virConnectGetAllDomainStats.
+ *
+ * Using 0 for @stats returns all stats groups supported by the given
+ * hypervisor.
+ *
+ * Specifying VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS as @flags makes
+ * the function return error in case some of the stat types in @stats were
+ * not recognized by the daemon.
+ *
+ * Note that any of the domain list filtering flags in @flags will be rejected
+ * by this function.
+ *
+ * Returns the count of returned statistics structures on success, -1 on error.
+ * The requested data are returned in the @retStats parameter. The returned
+ * array should be freed by the caller. See virDomainStatsRecordListFree.
+ * Note that the count of returned stats may be less than the domain count
+ * provided via @doms.
+ */
+int
+virDomainListGetStats(virDomainPtr *doms,
+                      unsigned int stats,
+                      virDomainStatsRecordPtr **retStats,
+                      unsigned int flags)
+{
+    virConnectPtr conn = NULL;
+    virDomainPtr *nextdom = doms;
+    unsigned int ndoms = 0;
+    int ret = -1;
+
+    VIR_DEBUG("doms=%p, stats=0x%x, retStats=%p, flags=0x%x",
+              doms, stats, retStats, flags);
+
+    virResetLastError();
+
+    virCheckNonNullArgGoto(doms, error);
+    virCheckNonNullArgGoto(retStats, error);
+    *retStats = NULL;
+
+    if (!*doms) {
+        virLibConnError(VIR_ERR_INVALID_ARG,
+                        _("doms array in %s must contain at least one domain"),
+                        __FUNCTION__);
+        goto error;
+    }
+
+    conn = doms[0]->conn;
+
+    if (!VIR_IS_CONNECT(conn)) {
+        virLibConnError(VIR_ERR_INVALID_CONN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+
+    if (!conn->driver->connectGetAllDomainStats) {
+        virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+        goto error;
+    }
+
+    while (*nextdom) {
+        virDomainPtr dom = *nextdom;
+
+        if (!VIR_IS_CONNECTED_DOMAIN(dom) ||
+            dom->conn != conn) {
+            virLibConnError(VIR_ERR_INVALID_ARG, "%s",
+                            _("domains in 'doms' array must belong to a "
+                              "single connection"));
+            goto error;
+        }
+
+        ndoms++;
+        nextdom++;
+    }
+
+    ret = conn->driver->connectGetAllDomainStats(conn, doms, ndoms,
+                                                 stats, retStats, flags);
+
+error:
+    if (ret < 0)
+        virDispatchError(conn);
+    return ret;
+}
+
+/**
+ * virDomainStatsRecordListFree:
+ * @stats: NULL terminated array of virDomainStatsRecords to free
+ *
+ * Convenience function to free a list of domain stats returned by
+ * virDomainListGetStats and virConnectGetAllDomainStats.
+ */
+void
+virDomainStatsRecordListFree(virDomainStatsRecordPtr *stats)
+{
+    virDomainStatsRecordPtr *next;
+
+    if (!stats)
+        return;
+
+    for (next = stats; *next; next++) {
+        virTypedParamsFree((*next)->params, (*next)->nparams);
+        virObjectUnref((*next)->dom);
+        VIR_FREE(*next);
+    }
+
+    VIR_FREE(stats);
+}
@@ -110,6 +110,37 @@ enum {
      * Support for offline migration.
      */
     VIR_DRV_FEATURE_MIGRATION_OFFLINE = 12,
+
+    /*
+     * Encodings of stream data supported by the remote end, as a
+     * bitmask of (1 << virNetStreamEncoding) rather than a boolean
+     */
+    VIR_DRV_FEATURE_PROGRAM_STREAM_ENCODING = 13,
+
+    /*
+     * Remote party can return the results of the ListAll APIs in
+     * several pages, so they are not bounded by the RPC message size
+     */
+    VIR_DRV_FEATURE_PROGRAM_LIST_PAGES = 14,
+
+    /*
+     * Remote party can restrict the domain events it relays to those
+     * of the domains a client watches
+     */
+    VIR_DRV_FEATURE_PROGRAM_DOMAIN_EVENT_FILTER = 15,
+
+    /*
+     * Remote party can send several domain events as one message,
+     * once asked to with REMOTE_PROC_DOMAIN_EVENTS_BATCH.
+     */
+    VIR_DRV_FEATURE_PROGRAM_DOMAIN_EVENT_BATCH = 16,
+
+    /*
+     * Support for VIR_MIGRATE_PARALLEL, i.e. attaching further
+     * streams to a tunnelled migration with
+     * virDomainMigratePrepareTunnelStream
+     */
+    VIR_DRV_FEATURE_MIGRATION_PARALLEL = 17,
 };
 
 
@@ -191,6 +222,11 @@ int virDomainMigratePrepareTunnel3(virConnectPtr dconn,
                                    unsigned long resource,
                                    const char *dom_xml);
 
+int virDomainMigratePrepareTunnelStream(virConnectPtr dconn,
+                                        virStreamPtr st,
+                                        const char *dname,
+                                        unsigned int flags);
+
 
 int virDomainMigratePerform3(virDomainPtr dom,
                              const char *xmlin,
@@ -595,7 +595,7 @@ libxlVmCleanup(libxlDriverPrivatePtr driver,
     }
 
     if (vm->persistent) {
-        vm->def->id = -1;
+        virDomainObjListSetID(&driver->domains, vm, -1);
         virDomainObjSetState(vm, VIR_DOMAIN_SHUTOFF, reason);
     }
 
@@ -943,7 +943,7 @@ libxlVmStart(libxlDriverPrivatePtr driver, virDomainObjPtr vm,
         goto error;
     }
 
-    vm->def->id = domid;
+    virDomainObjListSetID(&driver->domains, vm, domid);
     if ((dom_xml = virDomainDefFormat(vm->def, 0)) == NULL)
         goto error;
 
@@ -989,7 +989,7 @@ libxlVmStart(libxlDriverPrivatePtr driver, virDomainObjPtr vm,
 error:
     if (domid > 0) {
         libxl_domain_destroy(priv->ctx, domid, NULL);
-        vm->def->id = -1;
+        virDomainObjListSetID(&driver->domains, vm, -1);
         virDomainObjSetState(vm, VIR_DOMAIN_SHUTOFF, VIR_DOMAIN_SHUTOFF_FAILED);
     }
     libxl_domain_config_dispose(&d_config);
@@ -1037,7 +1037,7 @@ libxlReconnectDomain(void *payload,
     }
 
     /* Update domid in case it changed (e.g. reboot) while we were gone? */
-    vm->def->id = d_info.domid;
+    virDomainObjListSetID(&driver->domains, vm, d_info.domid);
     virDomainObjSetState(vm, VIR_DOMAIN_RUNNING, VIR_DOMAIN_RUNNING_UNKNOWN);
 
     if (!driver->nactive && driver->inhibitCallback)
@@ -1060,7 +1060,7 @@ out:
 static void
 libxlReconnectDomains(libxlDriverPrivatePtr driver)
 {
-    virHashForEach(driver->domains.objs, libxlReconnectDomain, driver);
+    virDomainObjListForEach(&driver->domains, libxlReconnectDomain, driver);
 }
 
 static int
@@ -1252,11 +1252,11 @@ libxlStartup(bool privileged,
                                 NULL, NULL) < 0)
         goto error;
 
-    virHashForEach(libxl_driver->domains.objs, libxlAutostartDomain,
-                   libxl_driver);
+    virDomainObjListForEach(&libxl_driver->domains, libxlAutostartDomain,
+                            libxl_driver);
 
-    virHashForEach(libxl_driver->domains.objs, libxlDomainManagedSaveLoad,
-                   libxl_driver);
+    virDomainObjListForEach(&libxl_driver->domains, libxlDomainManagedSaveLoad,
+                            libxl_driver);
 
     libxlDriverUnlock(libxl_driver);
 
@@ -1288,8 +1288,8 @@ libxlReload(void)
                             1, 1 << VIR_DOMAIN_VIRT_XEN,
                             NULL, libxl_driver);
 
-    virHashForEach(libxl_driver->domains.objs, libxlAutostartDomain,
-                   libxl_driver);
+    virDomainObjListForEach(&libxl_driver->domains, libxlAutostartDomain,
+                            libxl_driver);
 
     libxlDriverUnlock(libxl_driver);
 
@@ -4135,7 +4135,7 @@ libxlListAllDomains(virConnectPtr conn,
     virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ALL, -1);
 
     libxlDriverLock(driver);
-    ret = virDomainList(conn, driver->domains.objs, domains, flags);
+    ret = virDomainList(conn, &driver->domains, domains, flags);
     libxlDriverUnlock(driver);
 
     return ret;
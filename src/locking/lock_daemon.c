@@ -143,7 +143,7 @@ virLockDaemonNew(bool privileged)
         return NULL;
     }
 
-    if (!(lockd->srv = virNetServerNew(1, 1, 0, 20,
+    if (!(lockd->srv = virNetServerNew(1, 1, 0, 0, 20,
                                        -1, 0,
                                        false, NULL,
                                        virLockDaemonClientNew,
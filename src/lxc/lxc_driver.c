@@ -84,7 +84,7 @@ static int
 lxcVMFilterRebuild(virConnectPtr conn ATTRIBUTE_UNUSED,
                    virHashIterator iter, void *data)
 {
-    virHashForEach(lxc_driver->domains.objs, iter, data);
+    virDomainObjListForEach(&lxc_driver->domains, iter, data);
 
     return 0;
 }
@@ -2747,7 +2747,7 @@ lxcListAllDomains(virConnectPtr conn,
     virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ALL, -1);
 
     lxcDriverLock(driver);
-    ret = virDomainList(conn, driver->domains.objs, domains, flags);
+    ret = virDomainList(conn, &driver->domains, domains, flags);
     lxcDriverUnlock(driver);
 
     return ret;
@@ -843,7 +843,7 @@ parallelsLoadDomain(parallelsConnPtr privconn, virJSONValuePtr jobj)
     if (STREQ(state, "running")) {
         virDomainObjSetState(dom, VIR_DOMAIN_RUNNING,
                              VIR_DOMAIN_RUNNING_BOOTED);
-        def->id = pdom->id;
+        virDomainObjListSetID(&privconn->domains, dom, pdom->id);
     }
 
     if (STREQ(autostart, "on"))
@@ -1106,7 +1106,7 @@ parallelsListAllDomains(virConnectPtr conn,
 
     virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ALL, -1);
     parallelsDriverLock(privconn);
-    ret = virDomainList(conn, privconn->domains.objs, domains, flags);
+    ret = virDomainList(conn, &privconn->domains, domains, flags);
     parallelsDriverUnlock(privconn);
 
     return ret;
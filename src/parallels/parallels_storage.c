@@ -329,10 +329,8 @@ static int parallelsAddDiskVolume(virStoragePoolObjPtr pool,
     if (!(def->key = strdup(def->target.path)))
         goto no_memory;
 
-    if (VIR_REALLOC_N(pool->volumes.objs, pool->volumes.count + 1) < 0)
-        goto no_memory;
-
-    pool->volumes.objs[pool->volumes.count++] = def;
+    if (virStoragePoolObjAddVol(pool, def) < 0)
+        goto error;
 
     return 0;
 no_memory:
@@ -458,7 +456,7 @@ static int parallelsLoadPools(virConnectPtr conn)
 
     data.conn = conn;
     data.failed = false;
-    virHashForEach(privconn->domains.objs, parallelsPoolsAdd, &data);
+    virDomainObjListForEach(&privconn->domains, parallelsPoolsAdd, &data);
 
     if (data.failed)
         goto error;
@@ -1273,11 +1271,6 @@ parallelsStorageVolumeDefine(virStoragePoolObjPtr pool,
         }
     }
 
-    if (VIR_REALLOC_N(pool->volumes.objs, pool->volumes.count + 1) < 0) {
-        virReportOOMError();
-        goto cleanup;
-    }
-
     if (virAsprintf(&privvol->target.path, "%s/%s",
                     pool->def->target.path, privvol->name) < 0) {
         virReportOOMError();
@@ -1306,7 +1299,15 @@ parallelsStorageVolumeDefine(virStoragePoolObjPtr pool,
                                 pool->def->allocation);
     }
 
-    pool->volumes.objs[pool->volumes.count++] = privvol;
+    if (virStoragePoolObjAddVol(pool, privvol) < 0) {
+        if (is_new) {
+            unlink(xml_path);
+            pool->def->allocation -= privvol->allocation;
+            pool->def->available = (pool->def->capacity -
+                                    pool->def->allocation);
+        }
+        goto cleanup;
+    }
 
     ret = privvol;
     privvol = NULL;
@@ -1413,12 +1414,6 @@ parallelsStorageVolumeCreateXMLFrom(virStoragePoolPtr pool,
     privpool->def->available = (privpool->def->capacity -
                                 privpool->def->allocation);
 
-    if (VIR_REALLOC_N(privpool->volumes.objs,
-                      privpool->volumes.count + 1) < 0) {
-        virReportOOMError();
-        goto cleanup;
-    }
-
     if (virAsprintf(&privvol->target.path, "%s/%s",
                     privpool->def->target.path, privvol->name) == -1) {
         virReportOOMError();
@@ -1431,12 +1426,13 @@ parallelsStorageVolumeCreateXMLFrom(virStoragePoolPtr pool,
         goto cleanup;
     }
 
+    if (virStoragePoolObjAddVol(privpool, privvol) < 0)
+        goto cleanup;
+
     privpool->def->allocation += privvol->allocation;
     privpool->def->available = (privpool->def->capacity -
                                 privpool->def->allocation);
 
-    privpool->volumes.objs[privpool->volumes.count++] = privvol;
-
     ret = virGetStorageVol(pool->conn, privpool->def->name,
                            privvol->name, privvol->key,
                            NULL, NULL);
@@ -1454,42 +1450,24 @@ int parallelsStorageVolumeDefRemove(virStoragePoolObjPtr privpool,
 {
     int ret = -1;
     char *xml_path = NULL;
-    size_t i;
 
     privpool->def->allocation -= privvol->allocation;
     privpool->def->available = (privpool->def->capacity -
                                 privpool->def->allocation);
 
-    for (i = 0; i < privpool->volumes.count; i++) {
-        if (privpool->volumes.objs[i] == privvol) {
-            xml_path = parallelsAddFileExt(privvol->target.path, ".xml");
-            if (!xml_path)
-                goto cleanup;
-
-            if (unlink(xml_path)) {
-                virReportError(VIR_ERR_OPERATION_FAILED,
-                               _("Can't remove file '%s'"), xml_path);
-                goto cleanup;
-            }
-
-            virStorageVolDefFree(privvol);
-
-            if (i < (privpool->volumes.count - 1))
-                memmove(privpool->volumes.objs + i,
-                        privpool->volumes.objs + i + 1,
-                        sizeof(*(privpool->volumes.objs)) *
-                        (privpool->volumes.count - (i + 1)));
-
-            if (VIR_REALLOC_N(privpool->volumes.objs,
-                              privpool->volumes.count - 1) < 0) {
-                ;   /* Failure to reduce memory allocation isn't fatal */
-            }
-            privpool->volumes.count--;
+    xml_path = parallelsAddFileExt(privvol->target.path, ".xml");
+    if (!xml_path)
+        goto cleanup;
 
-            break;
-        }
+    if (unlink(xml_path)) {
+        virReportError(VIR_ERR_OPERATION_FAILED,
+                       _("Can't remove file '%s'"), xml_path);
+        goto cleanup;
     }
 
+    virStoragePoolObjRemoveVol(privpool, privvol);
+    virStorageVolDefFree(privvol);
+
     ret = 0;
 cleanup:
     VIR_FREE(xml_path);
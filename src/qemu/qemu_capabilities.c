@@ -37,7 +37,9 @@
 #include "vircommand.h"
 #include "virbitmap.h"
 #include "virnodesuspend.h"
+#include "virxml.h"
 #include "qemu_monitor.h"
+#include "sha256.h"
 
 #include <sys/stat.h>
 #include <unistd.h>
@@ -218,7 +220,9 @@ struct _qemuCaps {
     bool usedQMP;
 
     char *binary;
+    time_t ctime;
     time_t mtime;
+    off_t size;
 
     virBitmapPtr flags;
 
@@ -239,6 +243,7 @@ struct _qemuCapsCache {
     virMutex lock;
     virHashTablePtr binaries;
     char *libDir;
+    char *cacheDir;
     char *runDir;
     uid_t runUid;
     gid_t runGid;
@@ -2516,15 +2521,276 @@ cleanup:
 }
 
 
+static const char hex[] = { '0', '1', '2', '3', '4', '5', '6', '7',
+                            '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+
+/*
+ * The probed capabilities of each binary are saved to
+ * <cacheDir>/<sha256 of binary path>.xml, so that restarting
+ * libvirtd doesn't need to launch every emulator again.
+ */
+static char *
+qemuCapsCacheFile(const char *cacheDir, const char *binary)
+{
+    unsigned char buf[SHA256_DIGEST_SIZE];
+    char hash[(SHA256_DIGEST_SIZE * 2) + 1];
+    char *ret;
+    int i;
+
+    if (!(sha256_buffer(binary, strlen(binary), buf))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to compute sha256 checksum"));
+        return NULL;
+    }
+
+    for (i = 0 ; i < SHA256_DIGEST_SIZE ; i++) {
+        hash[i*2] = hex[(buf[i] >> 4) & 0xf];
+        hash[(i*2)+1] = hex[buf[i] & 0xf];
+    }
+    hash[SHA256_DIGEST_SIZE * 2] = '\0';
+
+    if (virAsprintf(&ret, "%s/%s.xml", cacheDir, hash) < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+
+    return ret;
+}
+
+
+char *
+qemuCapsFormatCache(qemuCapsPtr caps)
+{
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+
+    virBufferAddLit(&buf, "<qemuCaps>\n");
+    virBufferEscapeString(&buf, "  <binary path='%s'", caps->binary);
+    virBufferAsprintf(&buf, " ctime='%llu' mtime='%llu' size='%llu'/>\n",
+                      (unsigned long long) caps->ctime,
+                      (unsigned long long) caps->mtime,
+                      (unsigned long long) caps->size);
+    virBufferAsprintf(&buf, "  <libvirt version='%lu'/>\n",
+                      (unsigned long) LIBVIR_VERSION_NUMBER);
+    virBufferAsprintf(&buf, "  <host kvm='%s'/>\n",
+                      virFileExists("/dev/kvm") ? "yes" : "no");
+
+    if (caps->usedQMP)
+        virBufferAddLit(&buf, "  <usedQMP/>\n");
+    virBufferAsprintf(&buf, "  <version>%u</version>\n", caps->version);
+    virBufferAsprintf(&buf, "  <kvmVersion>%u</kvmVersion>\n",
+                      caps->kvmVersion);
+    virBufferAsprintf(&buf, "  <arch>%s</arch>\n",
+                      virArchToString(caps->arch));
+
+    for (i = 0 ; i < QEMU_CAPS_LAST ; i++) {
+        if (qemuCapsGet(caps, i))
+            virBufferAsprintf(&buf, "  <flag name='%s'/>\n",
+                              qemuCapsTypeToString(i));
+    }
+
+    for (i = 0 ; i < caps->ncpuDefinitions ; i++)
+        virBufferEscapeString(&buf, "  <cpu name='%s'/>\n",
+                              caps->cpuDefinitions[i]);
+
+    for (i = 0 ; i < caps->nmachineTypes ; i++) {
+        virBufferEscapeString(&buf, "  <machine name='%s'",
+                              caps->machineTypes[i]);
+        virBufferEscapeString(&buf, " alias='%s'",
+                              caps->machineAliases[i]);
+        virBufferAddLit(&buf, "/>\n");
+    }
+
+    virBufferAddLit(&buf, "</qemuCaps>\n");
+
+    if (virBufferError(&buf)) {
+        virBufferFreeAndReset(&buf);
+        virReportOOMError();
+        return NULL;
+    }
+
+    return virBufferContentAndReset(&buf);
+}
+
+
+static void
+qemuCapsSaveCache(qemuCapsPtr caps,
+                  const char *cacheDir,
+                  const char *filename)
+{
+    char *xml = NULL;
+
+    if (virFileMakePath(cacheDir) < 0) {
+        char ebuf[1024];
+        VIR_WARN("Unable to create capabilities cache directory %s: %s",
+                 cacheDir, virStrerror(errno, ebuf, sizeof(ebuf)));
+        return;
+    }
+
+    if (!(xml = qemuCapsFormatCache(caps)) ||
+        virXMLSaveFile(filename, NULL, NULL, xml) < 0) {
+        VIR_WARN("Unable to save capabilities of %s to the cache",
+                 caps->binary);
+        virResetLastError();
+    } else {
+        VIR_DEBUG("Saved capabilities of %s to %s", caps->binary, filename);
+    }
+
+    VIR_FREE(xml);
+}
+
+
+/*
+ * Load the capabilities of @binary from the cache @filename, provided
+ * the file was written by this version of libvirt for the binary @sb
+ * describes, on a host with the same KVM availability.
+ *
+ * Returns NULL without reporting an error if the cache can't be
+ * used, in which case the binary has to be probed.
+ */
+qemuCapsPtr
+qemuCapsLoadCache(const char *binary, const char *filename, struct stat *sb)
+{
+    qemuCapsPtr caps = NULL;
+    xmlDocPtr xml = NULL;
+    xmlXPathContextPtr ctxt = NULL;
+    xmlNodePtr *nodes = NULL;
+    char *str = NULL;
+    unsigned long long binCtime;
+    unsigned long long binMtime;
+    unsigned long long binSize;
+    unsigned long version;
+    unsigned int val;
+    bool kvm;
+    int ret = -1;
+    int n;
+    int i;
+
+    if (!virFileExists(filename)) {
+        VIR_DEBUG("No cached capabilities for %s", binary);
+        goto cleanup;
+    }
+
+    if (!(xml = virXMLParseFileCtxt(filename, &ctxt)))
+        goto cleanup;
+
+    if (!xmlStrEqual(ctxt->node->name, BAD_CAST "qemuCaps"))
+        goto cleanup;
+
+    kvm = virXPathBoolean("count(./host[@kvm='yes']) > 0", ctxt) == 1;
+
+    if (!(str = virXPathString("string(./binary/@path)", ctxt)) ||
+        STRNEQ(str, binary) ||
+        virXPathULongLong("string(./binary/@ctime)", ctxt, &binCtime) < 0 ||
+        binCtime != (unsigned long long) sb->st_ctime ||
+        virXPathULongLong("string(./binary/@mtime)", ctxt, &binMtime) < 0 ||
+        binMtime != (unsigned long long) sb->st_mtime ||
+        virXPathULongLong("string(./binary/@size)", ctxt, &binSize) < 0 ||
+        binSize != (unsigned long long) sb->st_size ||
+        virXPathULong("string(./libvirt/@version)", ctxt, &version) < 0 ||
+        version != LIBVIR_VERSION_NUMBER ||
+        kvm != virFileExists("/dev/kvm")) {
+        VIR_DEBUG("Cached capabilities %s are out of date for %s",
+                  filename, binary);
+        goto cleanup;
+    }
+
+    if (!(caps = qemuCapsNew()))
+        goto cleanup;
+    caps->binary = str;
+    str = NULL;
+    caps->ctime = sb->st_ctime;
+    caps->mtime = sb->st_mtime;
+    caps->size = sb->st_size;
+
+    caps->usedQMP = virXPathBoolean("count(./usedQMP) > 0", ctxt) == 1;
+
+    if (virXPathUInt("string(./version)", ctxt, &val) < 0)
+        goto cleanup;
+    caps->version = val;
+    if (virXPathUInt("string(./kvmVersion)", ctxt, &val) < 0)
+        goto cleanup;
+    caps->kvmVersion = val;
+
+    if (!(str = virXPathString("string(./arch)", ctxt)) ||
+        (caps->arch = virArchFromString(str)) == VIR_ARCH_NONE)
+        goto cleanup;
+    VIR_FREE(str);
+
+    if ((n = virXPathNodeSet("./flag", ctxt, &nodes)) < 0)
+        goto cleanup;
+    for (i = 0 ; i < n ; i++) {
+        int flag;
+
+        if (!(str = virXMLPropString(nodes[i], "name")) ||
+            (flag = qemuCapsTypeFromString(str)) < 0)
+            goto cleanup;
+        VIR_FREE(str);
+        qemuCapsSet(caps, flag);
+    }
+    VIR_FREE(nodes);
+
+    if ((n = virXPathNodeSet("./cpu", ctxt, &nodes)) < 0)
+        goto cleanup;
+    if (n > 0 &&
+        VIR_ALLOC_N(caps->cpuDefinitions, n) < 0)
+        goto no_memory;
+    for (i = 0 ; i < n ; i++) {
+        if (!(caps->cpuDefinitions[i] = virXMLPropString(nodes[i], "name")))
+            goto cleanup;
+        caps->ncpuDefinitions++;
+    }
+    VIR_FREE(nodes);
+
+    if ((n = virXPathNodeSet("./machine", ctxt, &nodes)) < 0)
+        goto cleanup;
+    if (n > 0 &&
+        (VIR_ALLOC_N(caps->machineTypes, n) < 0 ||
+         VIR_ALLOC_N(caps->machineAliases, n) < 0))
+        goto no_memory;
+    for (i = 0 ; i < n ; i++) {
+        if (!(caps->machineTypes[i] = virXMLPropString(nodes[i], "name")))
+            goto cleanup;
+        caps->machineAliases[i] = virXMLPropString(nodes[i], "alias");
+        caps->nmachineTypes++;
+    }
+
+    VIR_DEBUG("Loaded capabilities of %s from %s", caps->binary, filename);
+    ret = 0;
+
+cleanup:
+    if (ret < 0) {
+        virResetLastError();
+        virObjectUnref(caps);
+        caps = NULL;
+    }
+    VIR_FREE(nodes);
+    VIR_FREE(str);
+    xmlXPathFreeContext(ctxt);
+    xmlFreeDoc(xml);
+    return caps;
+
+no_memory:
+    virReportOOMError();
+    goto cleanup;
+}
+
+
 qemuCapsPtr qemuCapsNewForBinary(const char *binary,
                                  const char *libDir,
+                                 const char *cacheDir,
                                  uid_t runUid,
                                  gid_t runGid)
 {
     qemuCapsPtr caps = qemuCapsNew();
+    qemuCapsPtr cached;
+    char *cacheFile = NULL;
     struct stat sb;
     int rv;
 
+    if (!caps)
+        return NULL;
+
     if (!(caps->binary = strdup(binary)))
         goto no_memory;
 
@@ -2535,7 +2801,9 @@ qemuCapsPtr qemuCapsNewForBinary(const char *binary,
                              binary);
         goto error;
     }
+    caps->ctime = sb.st_ctime;
     caps->mtime = sb.st_mtime;
+    caps->size = sb.st_size;
 
     /* Make sure the binary we are about to try exec'ing exists.
      * Technically we could catch the exec() failure, but that's
@@ -2547,6 +2815,18 @@ qemuCapsPtr qemuCapsNewForBinary(const char *binary,
         goto error;
     }
 
+    /* Without a cache file the binary is simply probed every time */
+    if (cacheDir &&
+        !(cacheFile = qemuCapsCacheFile(cacheDir, binary)))
+        virResetLastError();
+
+    if (cacheFile &&
+        (cached = qemuCapsLoadCache(binary, cacheFile, &sb))) {
+        VIR_FREE(cacheFile);
+        virObjectUnref(caps);
+        return cached;
+    }
+
     if ((rv = qemuCapsInitQMP(caps, libDir, runUid, runGid)) < 0)
         goto error;
 
@@ -2554,11 +2834,16 @@ qemuCapsPtr qemuCapsNewForBinary(const char *binary,
         qemuCapsInitHelp(caps, runUid, runGid) < 0)
         goto error;
 
+    if (cacheFile)
+        qemuCapsSaveCache(caps, cacheDir, cacheFile);
+
+    VIR_FREE(cacheFile);
     return caps;
 
 no_memory:
     virReportOOMError();
 error:
+    VIR_FREE(cacheFile);
     virObjectUnref(caps);
     caps = NULL;
     return NULL;
@@ -2575,7 +2860,9 @@ bool qemuCapsIsValid(qemuCapsPtr caps)
     if (stat(caps->binary, &sb) < 0)
         return false;
 
-    return sb.st_mtime == caps->mtime;
+    return sb.st_ctime == caps->ctime &&
+        sb.st_mtime == caps->mtime &&
+        sb.st_size == caps->size;
 }
 
 
@@ -2588,6 +2875,7 @@ qemuCapsHashDataFree(void *payload, const void *key ATTRIBUTE_UNUSED)
 
 qemuCapsCachePtr
 qemuCapsCacheNew(const char *libDir,
+                 const char *cacheDir,
                  uid_t runUid,
                  gid_t runGid)
 {
@@ -2611,6 +2899,11 @@ qemuCapsCacheNew(const char *libDir,
         virReportOOMError();
         goto error;
     }
+    if (cacheDir &&
+        virAsprintf(&cache->cacheDir, "%s/capabilities", cacheDir) < 0) {
+        virReportOOMError();
+        goto error;
+    }
 
     cache->runUid = runUid;
     cache->runGid = runGid;
@@ -2639,7 +2932,7 @@ qemuCapsCacheLookup(qemuCapsCachePtr cache, const char *binary)
     if (!ret) {
         VIR_DEBUG("Creating capabilities for %s",
                   binary);
-        ret = qemuCapsNewForBinary(binary, cache->libDir,
+        ret = qemuCapsNewForBinary(binary, cache->libDir, cache->cacheDir,
                                    cache->runUid, cache->runGid);
         if (ret) {
             VIR_DEBUG("Caching capabilities %p for %s",
@@ -2679,6 +2972,7 @@ qemuCapsCacheFree(qemuCapsCachePtr cache)
         return;
 
     VIR_FREE(cache->libDir);
+    VIR_FREE(cache->cacheDir);
     virHashFree(cache->binaries);
     virMutexDestroy(&cache->lock);
     VIR_FREE(cache);
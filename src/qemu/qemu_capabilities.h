@@ -24,6 +24,8 @@
 #ifndef __QEMU_CAPABILITIES_H__
 # define __QEMU_CAPABILITIES_H__
 
+# include <sys/stat.h>
+
 # include "virobject.h"
 # include "capabilities.h"
 # include "vircommand.h"
@@ -185,6 +187,7 @@ qemuCapsPtr qemuCapsNew(void);
 qemuCapsPtr qemuCapsNewCopy(qemuCapsPtr caps);
 qemuCapsPtr qemuCapsNewForBinary(const char *binary,
                                  const char *libDir,
+                                 const char *cacheDir,
                                  uid_t runUid,
                                  gid_t runGid);
 
@@ -225,6 +228,7 @@ bool qemuCapsIsValid(qemuCapsPtr caps);
 
 
 qemuCapsCachePtr qemuCapsCacheNew(const char *libDir,
+                                  const char *cacheDir,
                                   uid_t uid, gid_t gid);
 qemuCapsPtr qemuCapsCacheLookup(qemuCapsCachePtr cache, const char *binary);
 qemuCapsPtr qemuCapsCacheLookupCopy(qemuCapsCachePtr cache, const char *binary);
@@ -246,6 +250,12 @@ int qemuCapsParseHelpStr(const char *qemu,
                          bool check_yajl);
 /* Only for use by test suite */
 int qemuCapsParseDeviceStr(qemuCapsPtr caps, const char *str);
+/* Only for use by test suite */
+char *qemuCapsFormatCache(qemuCapsPtr caps);
+/* Only for use by test suite */
+qemuCapsPtr qemuCapsLoadCache(const char *binary,
+                              const char *filename,
+                              struct stat *sb);
 
 VIR_ENUM_DECL(qemuCaps);
 
@@ -54,7 +54,7 @@ bool qemuCgroupControllerActive(virQEMUDriverPtr driver,
         return false;
     if (!virCgroupMounted(driver->cgroup, controller))
         return false;
-    if (driver->cgroupControllers & (1 << controller))
+    if (driver->config->cgroupControllers & (1 << controller))
         return true;
     return false;
 }
@@ -196,8 +196,8 @@ int qemuSetupCgroup(virQEMUDriverPtr driver,
     int rc;
     unsigned int i;
     const char *const *deviceACL =
-        driver->cgroupDeviceACL ?
-        (const char *const *)driver->cgroupDeviceACL :
+        driver->config->cgroupDeviceACL ?
+        (const char *const *)driver->config->cgroupDeviceACL :
         defaultDeviceACL;
 
     if (driver->cgroup == NULL)
@@ -246,7 +246,7 @@ int qemuSetupCgroup(virQEMUDriverPtr driver,
         if (vm->def->nsounds &&
             (!vm->def->ngraphics ||
              ((vm->def->graphics[0]->type == VIR_DOMAIN_GRAPHICS_TYPE_VNC &&
-               driver->vncAllowHostAudio) ||
+               driver->config->vncAllowHostAudio) ||
               (vm->def->graphics[0]->type == VIR_DOMAIN_GRAPHICS_TYPE_SDL)))) {
             rc = virCgroupAllowDeviceMajor(cgroup, 'c', DEVICE_SND_MAJOR,
                                            VIR_CGROUP_DEVICE_RW);
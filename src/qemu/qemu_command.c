@@ -164,7 +164,7 @@ qemuPhysIfaceConnect(virDomainDefPtr def,
         true, vnet_hdr, def->uuid,
         virDomainNetGetActualVirtPortProfile(net),
         &res_ifname,
-        vmop, driver->stateDir,
+        vmop, driver->config->stateDir,
         virDomainNetGetActualBandwidth(net));
     if (rc >= 0) {
         if (virSecurityManagerSetTapFDLabel(driver->securityManager,
@@ -184,7 +184,7 @@ error:
                      virDomainNetGetActualDirectDev(net),
                      virDomainNetGetActualDirectMode(net),
                      virDomainNetGetActualVirtPortProfile(net),
-                     driver->stateDir));
+                     driver->config->stateDir));
     VIR_FREE(res_ifname);
     return -1;
 }
@@ -278,7 +278,7 @@ qemuNetworkIfaceConnect(virDomainDefPtr def,
         tapfd = -1;
     }
 
-    if (driver->macFilter) {
+    if (driver->config->macFilter) {
         if ((err = networkAllowMacOnPort(driver, net->ifname, &net->mac))) {
             virReportSystemError(err,
                  _("failed to add ebtables rule to allow MAC address on '%s'"),
@@ -3298,7 +3298,7 @@ qemuBuildHostNetStr(virDomainNetDefPtr net,
      * through, -net tap,fd
      */
     case VIR_DOMAIN_NET_TYPE_BRIDGE:
-        if (!driver->privileged &&
+        if (!driver->config->privileged &&
             qemuCapsGet(caps, QEMU_CAPS_NETDEV_BRIDGE)) {
             brname = virDomainNetGetActualBridgeName(net);
             virBufferAsprintf(&buf, "bridge%cbr=%s", type_sep, brname);
@@ -4724,11 +4724,11 @@ qemuBuildGraphicsCommandLine(virQEMUDriverPtr driver,
         }
 
         if (graphics->data.vnc.socket ||
-            driver->vncAutoUnixSocket) {
+            driver->config->vncAutoUnixSocket) {
 
             if (!graphics->data.vnc.socket &&
                 virAsprintf(&graphics->data.vnc.socket,
-                            "%s/%s.vnc", driver->libDir, def->name) == -1) {
+                            "%s/%s.vnc", driver->config->libDir, def->name) == -1) {
                 goto no_memory;
             }
 
@@ -4774,7 +4774,7 @@ qemuBuildGraphicsCommandLine(virQEMUDriverPtr driver,
             }
 
             if (!listenAddr)
-                listenAddr = driver->vncListen;
+                listenAddr = driver->config->vncListen;
 
             escapeAddr = strchr(listenAddr, ':') != NULL;
             if (escapeAddr)
@@ -4792,26 +4792,26 @@ qemuBuildGraphicsCommandLine(virQEMUDriverPtr driver,
 
         if (qemuCapsGet(caps, QEMU_CAPS_VNC_COLON)) {
             if (graphics->data.vnc.auth.passwd ||
-                driver->vncPassword)
+                driver->config->vncPassword)
                 virBufferAddLit(&opt, ",password");
 
-            if (driver->vncTLS) {
+            if (driver->config->vncTLS) {
                 virBufferAddLit(&opt, ",tls");
-                if (driver->vncTLSx509verify) {
+                if (driver->config->vncTLSx509verify) {
                     virBufferAsprintf(&opt, ",x509verify=%s",
-                                      driver->vncTLSx509certdir);
+                                      driver->config->vncTLSx509certdir);
                 } else {
                     virBufferAsprintf(&opt, ",x509=%s",
-                                      driver->vncTLSx509certdir);
+                                      driver->config->vncTLSx509certdir);
                 }
             }
 
-            if (driver->vncSASL) {
+            if (driver->config->vncSASL) {
                 virBufferAddLit(&opt, ",sasl");
 
-                if (driver->vncSASLdir)
+                if (driver->config->vncSASLdir)
                     virCommandAddEnvPair(cmd, "SASL_CONF_DIR",
-                                         driver->vncSASLdir);
+                                         driver->config->vncSASLdir);
 
                 /* TODO: Support ACLs later */
             }
@@ -4828,7 +4828,7 @@ qemuBuildGraphicsCommandLine(virQEMUDriverPtr driver,
          * prevent it opening the host OS audio devices, since that causes
          * security issues and might not work when using VNC.
          */
-        if (driver->vncAllowHostAudio) {
+        if (driver->config->vncAllowHostAudio) {
             virCommandAddEnvPass(cmd, "QEMU_AUDIO_DRV");
         } else {
             virCommandAddEnvString(cmd, "QEMU_AUDIO_DRV=none");
@@ -4884,7 +4884,7 @@ qemuBuildGraphicsCommandLine(virQEMUDriverPtr driver,
             virBufferAsprintf(&opt, "port=%u", port);
 
         if (tlsPort > 0) {
-            if (!driver->spiceTLS) {
+            if (!driver->config->spiceTLS) {
                 virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
                                _("spice TLS port set in XML configuration,"
                                  " but TLS is disabled in qemu.conf"));
@@ -4927,7 +4927,7 @@ qemuBuildGraphicsCommandLine(virQEMUDriverPtr driver,
         }
 
         if (!listenAddr)
-            listenAddr = driver->spiceListen;
+            listenAddr = driver->config->spiceListen;
         if (listenAddr)
             virBufferAsprintf(&opt, ",addr=%s", listenAddr);
 
@@ -4951,12 +4951,12 @@ qemuBuildGraphicsCommandLine(virQEMUDriverPtr driver,
          * making it visible on CLI, so there's no use of password=XXX
          * in this bit of the code */
         if (!graphics->data.spice.auth.passwd &&
-            !driver->spicePassword)
+            !driver->config->spicePassword)
             virBufferAddLit(&opt, ",disable-ticketing");
 
-        if (driver->spiceTLS)
+        if (driver->config->spiceTLS)
             virBufferAsprintf(&opt, ",x509-dir=%s",
-                              driver->spiceTLSx509certdir);
+                              driver->config->spiceTLSx509certdir);
 
         switch (defaultMode) {
         case VIR_DOMAIN_GRAPHICS_SPICE_CHANNEL_MODE_SECURE:
@@ -4974,7 +4974,7 @@ qemuBuildGraphicsCommandLine(virQEMUDriverPtr driver,
             int mode = graphics->data.spice.channels[i];
             switch (mode) {
             case VIR_DOMAIN_GRAPHICS_SPICE_CHANNEL_MODE_SECURE:
-                if (!driver->spiceTLS) {
+                if (!driver->config->spiceTLS) {
                     virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
                                    _("spice secure channels set in XML configuration, but TLS is disabled in qemu.conf"));
                     goto error;
@@ -5159,7 +5159,7 @@ qemuBuildCommandLine(virConnectPtr conn,
 
     if (qemuCapsGet(caps, QEMU_CAPS_NAME)) {
         virCommandAddArg(cmd, "-name");
-        if (driver->setProcessName &&
+        if (driver->config->setProcessName &&
             qemuCapsGet(caps, QEMU_CAPS_NAME_PROCESS)) {
             virCommandAddArgFormat(cmd, "%s,process=qemu:%s",
                                    def->name, def->name);
@@ -5208,12 +5208,12 @@ qemuBuildCommandLine(virConnectPtr conn,
     def->mem.max_balloon = VIR_DIV_UP(def->mem.max_balloon, 1024) * 1024;
     virCommandAddArgFormat(cmd, "%llu", def->mem.max_balloon / 1024);
     if (def->mem.hugepage_backed) {
-        if (!driver->hugetlbfs_mount) {
+        if (!driver->config->hugetlbfsMount) {
             virReportError(VIR_ERR_INTERNAL_ERROR,
                            "%s", _("hugetlbfs filesystem is not mounted"));
             goto error;
         }
-        if (!driver->hugepage_path) {
+        if (!driver->config->hugepagePath) {
             virReportError(VIR_ERR_INTERNAL_ERROR,
                            "%s", _("hugepages are disabled by administrator config"));
             goto error;
@@ -5225,7 +5225,7 @@ qemuBuildCommandLine(virConnectPtr conn,
             goto error;
         }
         virCommandAddArgList(cmd, "-mem-prealloc", "-mem-path",
-                             driver->hugepage_path, NULL);
+                             driver->config->hugepagePath, NULL);
     }
 
     virCommandAddArg(cmd, "-smp");
@@ -6108,7 +6108,7 @@ qemuBuildCommandLine(virConnectPtr conn,
                  * supported.
                  */
                 if (actualType == VIR_DOMAIN_NET_TYPE_NETWORK ||
-                    driver->privileged ||
+                    driver->config->privileged ||
                     (!qemuCapsGet(caps, QEMU_CAPS_NETDEV_BRIDGE))) {
                     int tapfd = qemuNetworkIfaceConnect(def, conn, driver, net,
                                                         caps);
@@ -7073,11 +7073,11 @@ qemuBuildCommandLine(virConnectPtr conn,
     }
 
     if (qemuCapsGet(caps, QEMU_CAPS_SECCOMP_SANDBOX)) {
-        if (driver->seccompSandbox == 0)
+        if (driver->config->seccompSandbox == 0)
             virCommandAddArgList(cmd, "-sandbox", "off", NULL);
-        else if (driver->seccompSandbox > 0)
+        else if (driver->config->seccompSandbox > 0)
             virCommandAddArgList(cmd, "-sandbox", "on", NULL);
-    } else if (driver->seccompSandbox > 0) {
+    } else if (driver->config->seccompSandbox > 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
                        _("QEMU does not support seccomp sandboxes"));
         goto error;
@@ -50,14 +50,24 @@
 typedef struct _qemuDriverCloseDef qemuDriverCloseDef;
 typedef qemuDriverCloseDef *qemuDriverCloseDefPtr;
 
-typedef struct _virQEMUDriver virQEMUDriver;
-typedef virQEMUDriver *virQEMUDriverPtr;
-
-/* Main driver state */
-struct _virQEMUDriver {
-    virMutex lock;
-
-    virThreadPoolPtr workerPool;
+typedef struct _virQEMUDriverConfig virQEMUDriverConfig;
+typedef virQEMUDriverConfig *virQEMUDriverConfigPtr;
+
+/* Main driver config. The data in these object
+ * instances is immutable, so can be accessed
+ * without locking. Threads must, however, hold
+ * a valid reference on the object to prevent it
+ * being released while they use it.
+ *
+ * eg
+ *  virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
+ *
+ *  ...do stuff with 'cfg'..
+ *
+ *  virObjectUnref(cfg);
+ */
+struct _virQEMUDriverConfig {
+    virObject parent;
 
     bool privileged;
     const char *uri;
@@ -66,19 +76,9 @@ struct _virQEMUDriver {
     gid_t group;
     int dynamicOwnership;
 
-    unsigned int qemuVersion;
-    int nextvmid;
-
-    virCgroupPtr cgroup;
     int cgroupControllers;
     char **cgroupDeviceACL;
 
-    size_t nactive;
-    virStateInhibitCallback inhibitCallback;
-    void *inhibitOpaque;
-
-    virDomainObjList domains;
-
     /* These five directories are ones libvirtd uses (so must be root:root
      * to avoid security risk from QEMU processes */
     char *configBaseDir;
@@ -92,56 +92,111 @@ struct _virQEMUDriver {
     char *cacheDir;
     char *saveDir;
     char *snapshotDir;
-    char *qemuImgBinary;
-    unsigned int vncAutoUnixSocket : 1;
-    unsigned int vncTLS : 1;
-    unsigned int vncTLSx509verify : 1;
-    unsigned int vncSASL : 1;
+
+    bool vncAutoUnixSocket;
+    bool vncTLS;
+    bool vncTLSx509verify;
+    bool vncSASL;
     char *vncTLSx509certdir;
     char *vncListen;
     char *vncPassword;
     char *vncSASLdir;
-    unsigned int spiceTLS : 1;
+
+    bool spiceTLS;
     char *spiceTLSx509certdir;
     char *spiceListen;
     char *spicePassword;
+
     int remotePortMin;
     int remotePortMax;
-    char *hugetlbfs_mount;
-    char *hugepage_path;
 
-    unsigned int macFilter : 1;
-    ebtablesContext *ebtables;
+    char *hugetlbfsMount;
+    char *hugepagePath;
+
+    bool macFilter;
 
-    unsigned int relaxedACS : 1;
-    unsigned int vncAllowHostAudio : 1;
-    unsigned int clearEmulatorCapabilities : 1;
-    unsigned int allowDiskFormatProbing : 1;
-    unsigned int setProcessName : 1;
+    bool relaxedACS;
+    bool vncAllowHostAudio;
+    bool clearEmulatorCapabilities;
+    bool allowDiskFormatProbing;
+    bool setProcessName;
 
     int maxProcesses;
     int maxFiles;
 
-    int max_queued;
-
-    virCapsPtr caps;
-    qemuCapsCachePtr capsCache;
-
-    virDomainEventStatePtr domainEventState;
+    int maxQueuedJobs;
+    int maxReconnectWorkers;
 
     char **securityDriverNames;
     bool securityDefaultConfined;
     bool securityRequireConfined;
-    virSecurityManagerPtr securityManager;
 
     char *saveImageFormat;
     char *dumpImageFormat;
 
     char *autoDumpPath;
     bool autoDumpBypassCache;
-
     bool autoStartBypassCache;
 
+    char *lockManagerName;
+
+    int keepAliveInterval;
+    unsigned int keepAliveCount;
+
+    int migrationTunnelStreams;
+
+    unsigned long long migrationConvergeMaxDowntime;
+    unsigned long migrationConvergeMaxSpeed;
+
+    int seccompSandbox;
+};
+
+typedef struct _virQEMUDriver virQEMUDriver;
+typedef virQEMUDriver *virQEMUDriverPtr;
+
+/* Main driver state */
+struct _virQEMUDriver {
+    virMutex lock;
+
+    /* Immutable pointer, self-locking APIs */
+    virQEMUDriverConfigPtr config;
+
+    /* Immutable pointer, self-locking APIs */
+    virThreadPoolPtr workerPool;
+
+    /* Immutable pointer, self-locking APIs. Created on startup
+     * to reconnect to the domains which are still running */
+    virThreadPoolPtr reconnectPool;
+
+    unsigned int qemuVersion;
+    int nextvmid;
+
+    virCgroupPtr cgroup;
+
+    size_t nactive;
+    virStateInhibitCallback inhibitCallback;
+    void *inhibitOpaque;
+
+    /* Immutable pointer, self-locking APIs */
+    virDomainObjList domains;
+
+    char *qemuImgBinary;
+
+    ebtablesContext *ebtables;
+
+    /* Replaced while holding both the driver lock and capsLock.
+     * Code holding the driver lock may use the pointer directly,
+     * anything else must get a reference from
+     * virQEMUDriverGetCapabilities */
+    virMutex capsLock;
+    virCapsPtr caps;
+
+    qemuCapsCachePtr capsCache;
+
+    virDomainEventStatePtr domainEventState;
+
+    virSecurityManagerPtr securityManager;
+
     pciDeviceList *activePciHostdevs;
     usbDeviceList *activeUsbHostdevs;
 
@@ -162,10 +217,6 @@ struct _virQEMUDriver {
      * domain or abort a particular job running on it.
      */
     virHashTablePtr closeCallbacks;
-
-    int keepAliveInterval;
-    unsigned int keepAliveCount;
-    int seccompSandbox;
 };
 
 typedef struct _qemuDomainCmdlineDef qemuDomainCmdlineDef;
@@ -183,11 +234,23 @@ struct _qemuDomainCmdlineDef {
 # define QEMUD_MIGRATION_FIRST_PORT 49152
 # define QEMUD_MIGRATION_NUM_PORTS 64
 
+/* Most connections a parallel tunnelled migration may use. */
+# define QEMU_MIGRATION_TUNNEL_STREAMS_MAX 16
+
 
 void qemuDriverLock(virQEMUDriverPtr driver);
 void qemuDriverUnlock(virQEMUDriverPtr driver);
-int qemuLoadDriverConfig(virQEMUDriverPtr driver,
-                         const char *filename);
+
+virQEMUDriverConfigPtr virQEMUDriverConfigNew(bool privileged);
+
+int virQEMUDriverConfigLoadFile(virQEMUDriverConfigPtr cfg,
+                                const char *filename);
+
+virQEMUDriverConfigPtr virQEMUDriverGetConfig(virQEMUDriverPtr driver);
+
+virCapsPtr virQEMUDriverGetCapabilities(virQEMUDriverPtr driver);
+void virQEMUDriverSetCapabilities(virQEMUDriverPtr driver,
+                                  virCapsPtr caps);
 
 struct qemuDomainDiskInfo {
     bool removable;
@@ -161,7 +161,9 @@ qemuDomainObjResetAsyncJob(qemuDomainObjPrivatePtr priv)
     job->start = 0;
     job->dump_memory_only = false;
     job->asyncAbort = false;
+    job->migMaxDowntime = 0;
     memset(&job->info, 0, sizeof(job->info));
+    memset(&job->status, 0, sizeof(job->status));
 }
 
 void
@@ -196,6 +198,7 @@ qemuDomainObjFreeJob(qemuDomainObjPrivatePtr priv)
 {
     ignore_value(virCondDestroy(&priv->job.cond));
     ignore_value(virCondDestroy(&priv->job.asyncCond));
+    VIR_FREE(priv->job.completed);
 }
 
 static bool
@@ -663,14 +666,19 @@ void qemuDomainSetNamespaceHooks(virCapsPtr caps)
 static void
 qemuDomainObjSaveJob(virQEMUDriverPtr driver, virDomainObjPtr obj)
 {
+    virCapsPtr caps;
+
     if (!virDomainObjIsActive(obj)) {
         /* don't write the state file yet, it will be written once the domain
          * gets activated */
         return;
     }
 
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, obj) < 0)
+    /* May be called without the driver lock */
+    caps = virQEMUDriverGetCapabilities(driver);
+    if (virDomainSaveStatus(caps, driver->config->stateDir, obj) < 0)
         VIR_WARN("Failed to save status on vm %s", obj->def->name);
+    virObjectUnref(caps);
 }
 
 void
@@ -755,20 +763,32 @@ qemuDomainJobAllowed(qemuDomainObjPrivatePtr priv, enum qemuDomainJob job)
 
 /*
  * obj must be locked before calling; driver_locked says if qemu_driver is
- * locked or not.
+ * locked or not. internal says the job is started by the driver itself,
+ * eg. to handle a monitor event, rather than on behalf of an API call.
  */
 static int ATTRIBUTE_NONNULL(1)
 qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
                               bool driver_locked,
                               virDomainObjPtr obj,
                               enum qemuDomainJob job,
-                              enum qemuDomainAsyncJob asyncJob)
+                              enum qemuDomainAsyncJob asyncJob,
+                              bool internal)
 {
     qemuDomainObjPrivatePtr priv = obj->privateData;
     unsigned long long now;
     unsigned long long then;
     bool nested = job == QEMU_JOB_ASYNC_NESTED;
 
+    /* The job is held by the reconnect thread, which may be queued
+     * behind many other domains, so don't let API callers wait for
+     * it */
+    if (priv->reconnecting && !internal) {
+        virReportError(VIR_ERR_OPERATION_INVALID,
+                       _("domain '%s' is still being reconnected"),
+                       obj->def->name);
+        return -1;
+    }
+
     priv->jobs_queued++;
 
     if (virTimeMillisNow(&now) < 0)
@@ -779,9 +799,17 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
     if (driver_locked)
         qemuDriverUnlock(driver);
 
+    /* Internal jobs, such as handling a reboot of the guest, must
+     * not be dropped, so they wait for the reconnect however long
+     * it was queued */
+    while (priv->reconnecting) {
+        if (virCondWait(&priv->job.cond, &obj->parent.lock) < 0)
+            goto error;
+    }
+
 retry:
-    if (driver->max_queued &&
-        priv->jobs_queued > driver->max_queued) {
+    if (driver->config->maxQueuedJobs &&
+        priv->jobs_queued > driver->config->maxQueuedJobs) {
         goto error;
     }
 
@@ -841,8 +869,8 @@ error:
     if (errno == ETIMEDOUT)
         virReportError(VIR_ERR_OPERATION_TIMEOUT,
                        "%s", _("cannot acquire state change lock"));
-    else if (driver->max_queued &&
-             priv->jobs_queued > driver->max_queued)
+    else if (driver->config->maxQueuedJobs &&
+             priv->jobs_queued > driver->config->maxQueuedJobs)
         virReportError(VIR_ERR_OPERATION_FAILED,
                        "%s", _("cannot acquire state change lock "
                                "due to max_queued limit"));
@@ -873,7 +901,7 @@ int qemuDomainObjBeginJob(virQEMUDriverPtr driver,
                           enum qemuDomainJob job)
 {
     return qemuDomainObjBeginJobInternal(driver, false, obj, job,
-                                         QEMU_ASYNC_JOB_NONE);
+                                         QEMU_ASYNC_JOB_NONE, false);
 }
 
 int qemuDomainObjBeginAsyncJob(virQEMUDriverPtr driver,
@@ -881,7 +909,7 @@ int qemuDomainObjBeginAsyncJob(virQEMUDriverPtr driver,
                                enum qemuDomainAsyncJob asyncJob)
 {
     return qemuDomainObjBeginJobInternal(driver, false, obj, QEMU_JOB_ASYNC,
-                                         asyncJob);
+                                         asyncJob, false);
 }
 
 /*
@@ -904,7 +932,7 @@ int qemuDomainObjBeginJobWithDriver(virQEMUDriverPtr driver,
     }
 
     return qemuDomainObjBeginJobInternal(driver, true, obj, job,
-                                         QEMU_ASYNC_JOB_NONE);
+                                         QEMU_ASYNC_JOB_NONE, false);
 }
 
 int qemuDomainObjBeginAsyncJobWithDriver(virQEMUDriverPtr driver,
@@ -912,7 +940,37 @@ int qemuDomainObjBeginAsyncJobWithDriver(virQEMUDriverPtr driver,
                                          enum qemuDomainAsyncJob asyncJob)
 {
     return qemuDomainObjBeginJobInternal(driver, true, obj, QEMU_JOB_ASYNC,
-                                         asyncJob);
+                                         asyncJob, false);
+}
+
+/*
+ * obj and driver must be locked before calling.
+ *
+ * Same as qemuDomainObjBeginJobWithDriver, for jobs the driver starts
+ * on its own, eg. to handle an event from the monitor. Unlike API
+ * calls, which fail straight away, these wait while the domain is
+ * still being reconnected after a daemon restart.
+ */
+int qemuDomainObjBeginInternalJobWithDriver(virQEMUDriverPtr driver,
+                                            virDomainObjPtr obj,
+                                            enum qemuDomainJob job)
+{
+    if (job <= QEMU_JOB_NONE || job >= QEMU_JOB_ASYNC) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Attempt to start invalid job"));
+        return -1;
+    }
+
+    return qemuDomainObjBeginJobInternal(driver, true, obj, job,
+                                         QEMU_ASYNC_JOB_NONE, true);
+}
+
+int qemuDomainObjBeginInternalAsyncJobWithDriver(virQEMUDriverPtr driver,
+                                                 virDomainObjPtr obj,
+                                                 enum qemuDomainAsyncJob asyncJob)
+{
+    return qemuDomainObjBeginJobInternal(driver, true, obj, QEMU_JOB_ASYNC,
+                                         asyncJob, true);
 }
 
 /*
@@ -990,7 +1048,7 @@ qemuDomainObjEnterMonitorInternal(virQEMUDriverPtr driver,
                      priv->job.asyncOwner);
         if (qemuDomainObjBeginJobInternal(driver, driver_locked, obj,
                                           QEMU_JOB_ASYNC_NESTED,
-                                          QEMU_ASYNC_JOB_NONE) < 0)
+                                          QEMU_ASYNC_JOB_NONE, false) < 0)
             return -1;
         if (!virDomainObjIsActive(obj)) {
             virReportError(VIR_ERR_OPERATION_FAILED, "%s",
@@ -1238,21 +1296,23 @@ qemuDomainDefFormatBuf(virQEMUDriverPtr driver,
     virCPUDefPtr def_cpu = def->cpu;
     virDomainControllerDefPtr *controllers = NULL;
     int ncontrollers = 0;
+    virCapsPtr caps = NULL;
 
     /* Update guest CPU requirements according to host CPU */
     if ((flags & VIR_DOMAIN_XML_UPDATE_CPU) &&
         def_cpu &&
         (def_cpu->mode != VIR_CPU_MODE_CUSTOM || def_cpu->model)) {
-        if (!driver->caps ||
-            !driver->caps->host.cpu ||
-            !driver->caps->host.cpu->model) {
+        caps = virQEMUDriverGetCapabilities(driver);
+        if (!caps ||
+            !caps->host.cpu ||
+            !caps->host.cpu->model) {
             virReportError(VIR_ERR_OPERATION_FAILED,
                            "%s", _("cannot get host CPU capabilities"));
             goto cleanup;
         }
 
         if (!(cpu = virCPUDefCopy(def_cpu)) ||
-            cpuUpdate(cpu, driver->caps->host.cpu) < 0)
+            cpuUpdate(cpu, caps->host.cpu) < 0)
             goto cleanup;
         def->cpu = cpu;
     }
@@ -1304,6 +1364,7 @@ cleanup:
         def->controllers = controllers;
         def->ncontrollers = ncontrollers;
     }
+    virObjectUnref(caps);
     return ret;
 }
 
@@ -1398,10 +1459,10 @@ void qemuDomainObjCheckTaint(virQEMUDriverPtr driver,
 {
     int i;
 
-    if (driver->privileged &&
-        (!driver->clearEmulatorCapabilities ||
-         driver->user == 0 ||
-         driver->group == 0))
+    if (driver->config->privileged &&
+        (!driver->config->clearEmulatorCapabilities ||
+         driver->config->user == 0 ||
+         driver->config->group == 0))
         qemuDomainObjTaint(driver, obj, VIR_DOMAIN_TAINT_HIGH_PRIVILEGES, logFD);
 
     if (obj->def->namespaceData) {
@@ -1427,7 +1488,7 @@ void qemuDomainObjCheckDiskTaint(virQEMUDriverPtr driver,
                                  int logFD)
 {
     if ((!disk->format || disk->format == VIR_STORAGE_FILE_AUTO) &&
-        driver->allowDiskFormatProbing)
+        driver->config->allowDiskFormatProbing)
         qemuDomainObjTaint(driver, obj, VIR_DOMAIN_TAINT_DISK_PROBING, logFD);
 
     if (disk->rawio == 1)
@@ -1460,7 +1521,7 @@ qemuDomainOpenLogHelper(virQEMUDriverPtr driver,
     int fd = -1;
     bool trunc = false;
 
-    if (virAsprintf(&logfile, "%s/%s.log", driver->logDir, vm->def->name) < 0) {
+    if (virAsprintf(&logfile, "%s/%s.log", driver->config->logDir, vm->def->name) < 0) {
         virReportOOMError();
         return -1;
     }
@@ -1507,7 +1568,7 @@ qemuDomainCreateLog(virQEMUDriverPtr driver, virDomainObjPtr vm,
 
     oflags = O_CREAT | O_WRONLY;
     /* Only logrotate files in /var/log, so only append if running privileged */
-    if (driver->privileged || append)
+    if (driver->config->privileged || append)
         oflags |= O_APPEND;
     else
         oflags |= O_TRUNC;
@@ -1764,7 +1825,7 @@ qemuDomainSnapshotDiscard(virQEMUDriverPtr driver,
         }
     }
 
-    if (virAsprintf(&snapFile, "%s/%s/%s.xml", driver->snapshotDir,
+    if (virAsprintf(&snapFile, "%s/%s/%s.xml", driver->config->snapshotDir,
                     vm->def->name, snap->def->name) < 0) {
         virReportOOMError();
         goto cleanup;
@@ -1780,7 +1841,7 @@ qemuDomainSnapshotDiscard(virQEMUDriverPtr driver,
             } else {
                 parentsnap->def->current = true;
                 if (qemuDomainSnapshotWriteMetadata(vm, parentsnap,
-                                                    driver->snapshotDir) < 0) {
+                                                    driver->config->snapshotDir) < 0) {
                     VIR_WARN("failed to set parent snapshot '%s' as current",
                              snap->def->parent);
                     parentsnap->def->current = false;
@@ -1851,10 +1912,10 @@ qemuDomainRemoveInactive(virQEMUDriverPtr driver,
         VIR_WARN("unable to remove all snapshots for domain %s",
                  vm->def->name);
     }
-    else if (virAsprintf(&snapDir, "%s/%s", driver->snapshotDir,
+    else if (virAsprintf(&snapDir, "%s/%s", driver->config->snapshotDir,
                          vm->def->name) < 0) {
         VIR_WARN("unable to remove snapshot directory %s/%s",
-                 driver->snapshotDir, vm->def->name);
+                 driver->config->snapshotDir, vm->def->name);
     } else {
         if (rmdir(snapDir) < 0 && errno != ENOENT)
             VIR_WARN("unable to remove snapshot directory %s", snapDir);
@@ -1875,7 +1936,7 @@ qemuDomainSetFakeReboot(virQEMUDriverPtr driver,
 
     priv->fakeReboot = value;
 
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
+    if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0)
         VIR_WARN("Failed to save status on vm %s", vm->def->name);
 }
 
@@ -1899,8 +1960,8 @@ qemuDomainCheckDiskPresence(virQEMUDriverPtr driver,
             continue;
 
         if (virFileAccessibleAs(disk->src, F_OK,
-                                driver->user,
-                                driver->group) >= 0) {
+                                driver->config->user,
+                                driver->config->group) >= 0) {
             /* disk accessible */
             continue;
         }
@@ -2026,7 +2087,7 @@ qemuDomainDetermineDiskChain(virQEMUDriverPtr driver,
                              virDomainDiskDefPtr disk,
                              bool force)
 {
-    bool probe = driver->allowDiskFormatProbing;
+    bool probe = driver->config->allowDiskFormatProbing;
 
     if (!disk->src || disk->type == VIR_DOMAIN_DISK_TYPE_NETWORK)
         return 0;
@@ -2040,7 +2101,7 @@ qemuDomainDetermineDiskChain(virQEMUDriverPtr driver,
         }
     }
     disk->backingChain = virStorageFileGetMetadata(disk->src, disk->format,
-                                                   driver->user, driver->group,
+                                                   driver->config->user, driver->config->group,
                                                    probe);
     if (!disk->backingChain)
         return -1;
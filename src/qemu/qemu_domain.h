@@ -98,6 +98,13 @@ enum qemuDomainAsyncJob {
 };
 VIR_ENUM_DECL(qemuDomainAsyncJob)
 
+typedef struct _qemuDomainJobInfo qemuDomainJobInfo;
+typedef qemuDomainJobInfo *qemuDomainJobInfoPtr;
+struct _qemuDomainJobInfo {
+    virDomainJobInfo info;              /* Coarse progress data */
+    qemuMonitorMigrationStatus status;  /* Detailed migration statistics */
+};
+
 struct qemuDomainJobObj {
     virCond cond;                       /* Use to coordinate jobs */
     enum qemuDomainJob active;          /* Currently running job */
@@ -111,7 +118,12 @@ struct qemuDomainJobObj {
     unsigned long long start;           /* When the async job started */
     bool dump_memory_only;              /* use dump-guest-memory to do dump */
     virDomainJobInfo info;              /* Async job progress data */
+    qemuMonitorMigrationStatus status;  /* Detailed async job progress */
+    qemuDomainJobInfoPtr completed;     /* Statistics of the last finished
+                                           async job, kept after it ends */
     bool asyncAbort;                    /* abort of async job requested */
+    unsigned long long migMaxDowntime;  /* ms set by the user during
+                                           migration, 0 if not */
 };
 
 typedef struct _qemuDomainPCIAddressSet qemuDomainPCIAddressSet;
@@ -120,6 +132,9 @@ typedef qemuDomainPCIAddressSet *qemuDomainPCIAddressSetPtr;
 typedef void (*qemuDomainCleanupCallback)(virQEMUDriverPtr driver,
                                           virDomainObjPtr vm);
 
+typedef struct _qemuMigrationTunnelIn qemuMigrationTunnelIn;
+typedef qemuMigrationTunnelIn *qemuMigrationTunnelInPtr;
+
 typedef struct _qemuDomainObjPrivate qemuDomainObjPrivate;
 typedef qemuDomainObjPrivate *qemuDomainObjPrivatePtr;
 struct _qemuDomainObjPrivate {
@@ -137,6 +152,9 @@ struct _qemuDomainObjPrivate {
 
     bool gotShutdown;
     bool beingDestroyed;
+    /* Set from daemon startup until the monitor has been reconnected,
+     * makes jobs started by APIs fail rather than wait */
+    bool reconnecting;
     char *pidfile;
 
     int nvcpupids;
@@ -154,6 +172,8 @@ struct _qemuDomainObjPrivate {
 
     unsigned long migMaxBandwidth;
     char *origname;
+    /* Reassembles the data of an incoming parallel tunnelled migration */
+    qemuMigrationTunnelInPtr migTunnel;
 
     virChrdevsPtr devs;
 
@@ -198,6 +218,14 @@ int qemuDomainObjBeginAsyncJobWithDriver(virQEMUDriverPtr driver,
                                          virDomainObjPtr obj,
                                          enum qemuDomainAsyncJob asyncJob)
     ATTRIBUTE_RETURN_CHECK;
+int qemuDomainObjBeginInternalJobWithDriver(virQEMUDriverPtr driver,
+                                            virDomainObjPtr obj,
+                                            enum qemuDomainJob job)
+    ATTRIBUTE_RETURN_CHECK;
+int qemuDomainObjBeginInternalAsyncJobWithDriver(virQEMUDriverPtr driver,
+                                                 virDomainObjPtr obj,
+                                                 enum qemuDomainAsyncJob asyncJob)
+    ATTRIBUTE_RETURN_CHECK;
 
 bool qemuDomainObjEndJob(virQEMUDriverPtr driver,
                          virDomainObjPtr obj)
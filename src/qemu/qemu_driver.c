@@ -168,7 +168,7 @@ static int
 qemuVMFilterRebuild(virConnectPtr conn ATTRIBUTE_UNUSED,
                     virHashIterator iter, void *data)
 {
-    virHashForEach(qemu_driver->domains.objs, iter, data);
+    virDomainObjListForEach(&qemu_driver->domains, iter, data);
 
     return 0;
 }
@@ -225,21 +225,26 @@ qemuDomObjFromDomainDriver(virDomainPtr domain, virQEMUDriverPtr *drv)
  * @domain: Domain pointer that has to be looked up
  *
  * This function looks up @domain and returns the appropriate
- * virDomainObjPtr. The driver is unlocked after the call.
+ * virDomainObjPtr. The domain list is self-locking, so the driver
+ * lock is not needed, and is not held by the caller on return.
  *
  * Returns the domain object which is locked on success, NULL
- * otherwise. The driver remains unlocked after the call.
+ * otherwise.
  */
 static virDomainObjPtr
 qemuDomObjFromDomain(virDomainPtr domain)
 {
+    virQEMUDriverPtr driver = domain->conn->privateData;
     virDomainObjPtr vm;
-    virQEMUDriverPtr driver;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
 
-    if (!(vm = qemuDomObjFromDomainDriver(domain, &driver)))
+    vm = virDomainFindByUUID(&driver->domains, domain->uuid);
+    if (!vm) {
+        virUUIDFormat(domain->uuid, uuidstr);
+        virReportError(VIR_ERR_NO_DOMAIN,
+                       _("no domain with matching uuid '%s'"), uuidstr);
         return NULL;
-
-    qemuDriverUnlock(driver);
+    }
 
     return vm;
 }
@@ -287,7 +292,7 @@ qemuAutostartDomain(void *payload, const void *name ATTRIBUTE_UNUSED,
     virErrorPtr err;
     int flags = 0;
 
-    if (data->driver->autoStartBypassCache)
+    if (data->driver->config->autoStartBypassCache)
         flags |= VIR_DOMAIN_START_BYPASS_CACHE;
 
     virObjectLock(vm);
@@ -328,14 +333,14 @@ qemuAutostartDomains(virQEMUDriverPtr driver)
      * to lookup the bridge associated with a virtual
      * network
      */
-    virConnectPtr conn = virConnectOpen(driver->privileged ?
+    virConnectPtr conn = virConnectOpen(driver->config->privileged ?
                                         "qemu:///system" :
                                         "qemu:///session");
     /* Ignoring NULL conn which is mostly harmless here */
     struct qemuAutostartData data = { driver, conn };
 
     qemuDriverLock(driver);
-    virHashForEach(driver->domains.objs, qemuAutostartDomain, &data);
+    virDomainObjListForEach(&driver->domains, qemuAutostartDomain, &data);
     qemuDriverUnlock(driver);
 
     if (conn)
@@ -349,15 +354,15 @@ qemuSecurityInit(virQEMUDriverPtr driver)
     virSecurityManagerPtr mgr = NULL;
     virSecurityManagerPtr stack = NULL;
 
-    if (driver->securityDriverNames &&
-        driver->securityDriverNames[0]) {
-        names = driver->securityDriverNames;
+    if (driver->config->securityDriverNames &&
+        driver->config->securityDriverNames[0]) {
+        names = driver->config->securityDriverNames;
         while (names && *names) {
             if (!(mgr = virSecurityManagerNew(*names,
                                               QEMU_DRIVER_NAME,
-                                              driver->allowDiskFormatProbing,
-                                              driver->securityDefaultConfined,
-                                              driver->securityRequireConfined)))
+                                              driver->config->allowDiskFormatProbing,
+                                              driver->config->securityDefaultConfined,
+                                              driver->config->securityRequireConfined)))
                 goto error;
             if (!stack) {
                 if (!(stack = virSecurityManagerNewStack(mgr)))
@@ -372,23 +377,23 @@ qemuSecurityInit(virQEMUDriverPtr driver)
     } else {
         if (!(mgr = virSecurityManagerNew(NULL,
                                           QEMU_DRIVER_NAME,
-                                          driver->allowDiskFormatProbing,
-                                          driver->securityDefaultConfined,
-                                          driver->securityRequireConfined)))
+                                          driver->config->allowDiskFormatProbing,
+                                          driver->config->securityDefaultConfined,
+                                          driver->config->securityRequireConfined)))
             goto error;
         if (!(stack = virSecurityManagerNewStack(mgr)))
             goto error;
         mgr = NULL;
     }
 
-    if (driver->privileged) {
+    if (driver->config->privileged) {
         if (!(mgr = virSecurityManagerNewDAC(QEMU_DRIVER_NAME,
-                                             driver->user,
-                                             driver->group,
-                                             driver->allowDiskFormatProbing,
-                                             driver->securityDefaultConfined,
-                                             driver->securityRequireConfined,
-                                             driver->dynamicOwnership)))
+                                             driver->config->user,
+                                             driver->config->group,
+                                             driver->config->allowDiskFormatProbing,
+                                             driver->config->securityDefaultConfined,
+                                             driver->config->securityRequireConfined,
+                                             driver->config->dynamicOwnership)))
             goto error;
         if (!stack) {
             if (!(stack = virSecurityManagerNewStack(mgr)))
@@ -426,7 +431,7 @@ qemuCreateCapabilities(virQEMUDriverPtr driver)
         return NULL;
     }
 
-    if (driver->allowDiskFormatProbing) {
+    if (driver->config->allowDiskFormatProbing) {
         caps->defaultDiskDriverName = NULL;
         caps->defaultDiskDriverType = VIR_STORAGE_FILE_AUTO;
     } else {
@@ -648,13 +653,13 @@ qemuStartup(bool privileged,
             virStateInhibitCallback callback,
             void *opaque)
 {
-    char *base;
     char *driverConf = NULL;
     int rc;
     virConnectPtr conn = NULL;
     char ebuf[1024];
     char *membase = NULL;
     char *mempath = NULL;
+    virQEMUDriverConfigPtr cfg;
 
     if (VIR_ALLOC(qemu_driver) < 0)
         return -1;
@@ -664,10 +669,14 @@ qemuStartup(bool privileged,
         VIR_FREE(qemu_driver);
         return -1;
     }
+    if (virMutexInit(&qemu_driver->capsLock) < 0) {
+        VIR_ERROR(_("cannot initialize mutex"));
+        virMutexDestroy(&qemu_driver->lock);
+        VIR_FREE(qemu_driver);
+        return -1;
+    }
     qemuDriverLock(qemu_driver);
 
-    qemu_driver->privileged = privileged;
-    qemu_driver->uri = privileged ? "qemu:///system" : "qemu:///session";
     qemu_driver->inhibitCallback = callback;
     qemu_driver->inhibitOpaque = opaque;
 
@@ -686,134 +695,89 @@ qemuStartup(bool privileged,
     if (privileged)
         qemu_driver->hostsysinfo = virSysinfoRead();
 
-    if (privileged) {
-        if (virAsprintf(&qemu_driver->logDir,
-                        "%s/log/libvirt/qemu", LOCALSTATEDIR) == -1)
-            goto out_of_memory;
-
-        if ((qemu_driver->configBaseDir = strdup(SYSCONFDIR "/libvirt")) == NULL)
-            goto out_of_memory;
-        base = qemu_driver->configBaseDir;
-
-        if (virAsprintf(&qemu_driver->stateDir,
-                      "%s/run/libvirt/qemu", LOCALSTATEDIR) == -1)
-            goto out_of_memory;
-
-        if (virAsprintf(&qemu_driver->libDir,
-                      "%s/lib/libvirt/qemu", LOCALSTATEDIR) == -1)
-            goto out_of_memory;
-
-        if (virAsprintf(&qemu_driver->cacheDir,
-                      "%s/cache/libvirt/qemu", LOCALSTATEDIR) == -1)
-            goto out_of_memory;
-        if (virAsprintf(&qemu_driver->saveDir,
-                      "%s/lib/libvirt/qemu/save", LOCALSTATEDIR) == -1)
-            goto out_of_memory;
-        if (virAsprintf(&qemu_driver->snapshotDir,
-                        "%s/lib/libvirt/qemu/snapshot", LOCALSTATEDIR) == -1)
-            goto out_of_memory;
-        if (virAsprintf(&qemu_driver->autoDumpPath,
-                        "%s/lib/libvirt/qemu/dump", LOCALSTATEDIR) == -1)
-            goto out_of_memory;
-    } else {
-        char *rundir;
-        char *cachedir;
-
-        cachedir = virGetUserCacheDirectory();
-        if (!cachedir)
-            goto error;
-
-        if (virAsprintf(&qemu_driver->logDir,
-                        "%s/qemu/log", cachedir) == -1) {
-            VIR_FREE(cachedir);
-            goto out_of_memory;
-        }
-        if (virAsprintf(&qemu_driver->cacheDir, "%s/qemu/cache", cachedir) == -1) {
-            VIR_FREE(cachedir);
-            goto out_of_memory;
-        }
-        VIR_FREE(cachedir);
+    if (!(qemu_driver->config = cfg = virQEMUDriverConfigNew(privileged)))
+        goto error;
 
-        rundir = virGetUserRuntimeDirectory();
-        if (!rundir)
-            goto error;
-        if (virAsprintf(&qemu_driver->stateDir, "%s/qemu/run", rundir) == -1) {
-            VIR_FREE(rundir);
-            goto out_of_memory;
-        }
-        VIR_FREE(rundir);
+    if (virAsprintf(&driverConf, "%s/qemu.conf", cfg->configBaseDir) < 0)
+        goto out_of_memory;
 
-        if (!(qemu_driver->configBaseDir = virGetUserConfigDirectory()))
-            goto error;
-        base = qemu_driver->configBaseDir;
-        if (virAsprintf(&qemu_driver->libDir, "%s/qemu/lib", base) == -1)
-            goto out_of_memory;
-        if (virAsprintf(&qemu_driver->saveDir, "%s/qemu/save", base) == -1)
-            goto out_of_memory;
-        if (virAsprintf(&qemu_driver->snapshotDir, "%s/qemu/snapshot", base) == -1)
-            goto out_of_memory;
-        if (virAsprintf(&qemu_driver->autoDumpPath, "%s/qemu/dump", base) == -1)
-            goto out_of_memory;
-    }
+    if (virQEMUDriverConfigLoadFile(cfg, driverConf) < 0)
+        goto error;
+    VIR_FREE(driverConf);
 
-    if (virFileMakePath(qemu_driver->stateDir) < 0) {
+    if (virFileMakePath(cfg->stateDir) < 0) {
         VIR_ERROR(_("Failed to create state dir '%s': %s"),
-                  qemu_driver->stateDir, virStrerror(errno, ebuf, sizeof(ebuf)));
+                  cfg->stateDir, virStrerror(errno, ebuf, sizeof(ebuf)));
         goto error;
     }
-    if (virFileMakePath(qemu_driver->libDir) < 0) {
+    if (virFileMakePath(cfg->libDir) < 0) {
         VIR_ERROR(_("Failed to create lib dir '%s': %s"),
-                  qemu_driver->libDir, virStrerror(errno, ebuf, sizeof(ebuf)));
+                  cfg->libDir, virStrerror(errno, ebuf, sizeof(ebuf)));
         goto error;
     }
-    if (virFileMakePath(qemu_driver->cacheDir) < 0) {
+    if (virFileMakePath(cfg->cacheDir) < 0) {
         VIR_ERROR(_("Failed to create cache dir '%s': %s"),
-                  qemu_driver->cacheDir, virStrerror(errno, ebuf, sizeof(ebuf)));
+                  cfg->cacheDir, virStrerror(errno, ebuf, sizeof(ebuf)));
         goto error;
     }
-    if (virFileMakePath(qemu_driver->saveDir) < 0) {
+    if (virFileMakePath(cfg->saveDir) < 0) {
         VIR_ERROR(_("Failed to create save dir '%s': %s"),
-                  qemu_driver->saveDir, virStrerror(errno, ebuf, sizeof(ebuf)));
+                  cfg->saveDir, virStrerror(errno, ebuf, sizeof(ebuf)));
         goto error;
     }
-    if (virFileMakePath(qemu_driver->snapshotDir) < 0) {
+    if (virFileMakePath(cfg->snapshotDir) < 0) {
         VIR_ERROR(_("Failed to create save dir '%s': %s"),
-                  qemu_driver->snapshotDir, virStrerror(errno, ebuf, sizeof(ebuf)));
+                  cfg->snapshotDir, virStrerror(errno, ebuf, sizeof(ebuf)));
         goto error;
     }
-    if (virFileMakePath(qemu_driver->autoDumpPath) < 0) {
+    if (virFileMakePath(cfg->autoDumpPath) < 0) {
         VIR_ERROR(_("Failed to create dump dir '%s': %s"),
-                  qemu_driver->autoDumpPath, virStrerror(errno, ebuf, sizeof(ebuf)));
+                  cfg->autoDumpPath, virStrerror(errno, ebuf, sizeof(ebuf)));
         goto error;
     }
 
-    /* Configuration paths are either ~/.libvirt/qemu/... (session) or
-     * /etc/libvirt/qemu/... (system).
-     */
-    if (virAsprintf(&driverConf, "%s/qemu.conf", base) < 0 ||
-        virAsprintf(&qemu_driver->configDir, "%s/qemu", base) < 0 ||
-        virAsprintf(&qemu_driver->autostartDir, "%s/qemu/autostart", base) < 0)
-        goto out_of_memory;
-
     rc = virCgroupForDriver("qemu", &qemu_driver->cgroup, privileged, 1);
     if (rc < 0) {
         VIR_INFO("Unable to create cgroup for driver: %s",
                  virStrerror(-rc, ebuf, sizeof(ebuf)));
     }
 
-    if (qemuLoadDriverConfig(qemu_driver, driverConf) < 0) {
-        goto error;
+    if (cfg->macFilter) {
+        if (!(qemu_driver->ebtables = ebtablesContextNew("qemu"))) {
+            virReportSystemError(errno,
+                                 _("failed to enable mac filter in '%s'"),
+                                 __FILE__);
+            goto error;
+        }
+
+        if ((errno = networkDisableAllFrames(qemu_driver))) {
+            virReportSystemError(errno,
+                         _("failed to add rule to drop all frames in '%s'"),
+                                 __FILE__);
+            goto error;
+        }
     }
-    VIR_FREE(driverConf);
 
     /* Allocate bitmap for remote display port reservations. We cannot
      * do this before the config is loaded properly, since the port
      * numbers are configurable now */
     if ((qemu_driver->remotePorts =
-         virPortAllocatorNew(qemu_driver->remotePortMin,
-                             qemu_driver->remotePortMax)) == NULL)
+         virPortAllocatorNew(cfg->remotePortMin,
+                             cfg->remotePortMax)) == NULL)
         goto error;
 
+    if (cfg->lockManagerName) {
+        if (!(qemu_driver->lockManager =
+              virLockManagerPluginNew(cfg->lockManagerName, "qemu",
+                                      cfg->configBaseDir, 0)))
+            VIR_ERROR(_("Failed to load lock manager %s"),
+                      cfg->lockManagerName);
+    } else {
+        qemu_driver->lockManager = virLockManagerPluginNew("nop", "qemu",
+                                                           cfg->configBaseDir,
+                                                           0);
+    }
+
     /* We should always at least have the 'nop' manager, so
      * NULLs here are a fatal error
      */
@@ -838,35 +802,36 @@ qemuStartup(bool privileged,
         goto error;
 
     if (privileged) {
-        if (chown(qemu_driver->libDir, qemu_driver->user, qemu_driver->group) < 0) {
+        if (chown(cfg->libDir, cfg->user, cfg->group) < 0) {
             virReportSystemError(errno,
                                  _("unable to set ownership of '%s' to user %d:%d"),
-                                 qemu_driver->libDir, qemu_driver->user, qemu_driver->group);
+                                 cfg->libDir, cfg->user, cfg->group);
             goto error;
         }
-        if (chown(qemu_driver->cacheDir, qemu_driver->user, qemu_driver->group) < 0) {
+        if (chown(cfg->cacheDir, cfg->user, cfg->group) < 0) {
             virReportSystemError(errno,
                                  _("unable to set ownership of '%s' to %d:%d"),
-                                 qemu_driver->cacheDir, qemu_driver->user, qemu_driver->group);
+                                 cfg->cacheDir, cfg->user, cfg->group);
             goto error;
         }
-        if (chown(qemu_driver->saveDir, qemu_driver->user, qemu_driver->group) < 0) {
+        if (chown(cfg->saveDir, cfg->user, cfg->group) < 0) {
             virReportSystemError(errno,
                                  _("unable to set ownership of '%s' to %d:%d"),
-                                 qemu_driver->saveDir, qemu_driver->user, qemu_driver->group);
+                                 cfg->saveDir, cfg->user, cfg->group);
             goto error;
         }
-        if (chown(qemu_driver->snapshotDir, qemu_driver->user, qemu_driver->group) < 0) {
+        if (chown(cfg->snapshotDir, cfg->user, cfg->group) < 0) {
             virReportSystemError(errno,
                                  _("unable to set ownership of '%s' to %d:%d"),
-                                 qemu_driver->snapshotDir, qemu_driver->user, qemu_driver->group);
+                                 cfg->snapshotDir, cfg->user, cfg->group);
             goto error;
         }
     }
 
-    qemu_driver->capsCache = qemuCapsCacheNew(qemu_driver->libDir,
-                                              qemu_driver->user,
-                                              qemu_driver->group);
+    qemu_driver->capsCache = qemuCapsCacheNew(cfg->libDir,
+                                              cfg->cacheDir,
+                                              cfg->user,
+                                              cfg->group);
     if (!qemu_driver->capsCache)
         goto error;
 
@@ -880,10 +845,10 @@ qemuStartup(bool privileged,
      * NB the check for '/', since user may config "" to disable hugepages
      * even when mounted
      */
-    if (qemu_driver->hugetlbfs_mount &&
-        qemu_driver->hugetlbfs_mount[0] == '/') {
+    if (cfg->hugetlbfsMount &&
+        cfg->hugetlbfsMount[0] == '/') {
         if (virAsprintf(&membase, "%s/libvirt",
-                        qemu_driver->hugetlbfs_mount) < 0 ||
+                        cfg->hugetlbfsMount) < 0 ||
             virAsprintf(&mempath, "%s/qemu", membase) < 0)
             goto out_of_memory;
 
@@ -892,20 +857,21 @@ qemuStartup(bool privileged,
                                  _("unable to create hugepage path %s"), mempath);
             goto error;
         }
-        if (qemu_driver->privileged) {
+        if (cfg->privileged) {
             if (virFileUpdatePerm(membase, 0, S_IXGRP | S_IXOTH) < 0)
                 goto error;
-            if (chown(mempath, qemu_driver->user, qemu_driver->group) < 0) {
+            if (chown(mempath, cfg->user, cfg->group) < 0) {
                 virReportSystemError(errno,
                                      _("unable to set ownership on %s to %d:%d"),
-                                     mempath, qemu_driver->user,
-                                     qemu_driver->group);
+                                     mempath, cfg->user,
+                                     cfg->group);
                 goto error;
             }
         }
         VIR_FREE(membase);
 
-        qemu_driver->hugepage_path = mempath;
+        cfg->hugepagePath = mempath;
+        mempath = NULL;
     }
 
     if (qemuDriverCloseCallbackInit(qemu_driver) < 0)
@@ -914,7 +880,7 @@ qemuStartup(bool privileged,
     /* Get all the running persistent or transient configs first */
     if (virDomainLoadAllConfigs(qemu_driver->caps,
                                 &qemu_driver->domains,
-                                qemu_driver->stateDir,
+                                cfg->stateDir,
                                 NULL,
                                 1, QEMU_EXPECTED_VIRT_TYPES,
                                 NULL, NULL) < 0)
@@ -923,31 +889,31 @@ qemuStartup(bool privileged,
     /* find the maximum ID from active and transient configs to initialize
      * the driver with. This is to avoid race between autostart and reconnect
      * threads */
-    virHashForEach(qemu_driver->domains.objs,
-                   qemuDomainFindMaxID,
-                   &qemu_driver->nextvmid);
+    virDomainObjListForEach(&qemu_driver->domains,
+                            qemuDomainFindMaxID,
+                            &qemu_driver->nextvmid);
 
-    virHashForEach(qemu_driver->domains.objs, qemuDomainNetsRestart, NULL);
+    virDomainObjListForEach(&qemu_driver->domains, qemuDomainNetsRestart, NULL);
 
-    conn = virConnectOpen(qemu_driver->uri);
+    conn = virConnectOpen(cfg->uri);
 
     qemuProcessReconnectAll(conn, qemu_driver);
 
     /* Then inactive persistent configs */
     if (virDomainLoadAllConfigs(qemu_driver->caps,
                                 &qemu_driver->domains,
-                                qemu_driver->configDir,
-                                qemu_driver->autostartDir,
+                                cfg->configDir,
+                                cfg->autostartDir,
                                 0, QEMU_EXPECTED_VIRT_TYPES,
                                 NULL, NULL) < 0)
         goto error;
 
 
-    virHashForEach(qemu_driver->domains.objs, qemuDomainSnapshotLoad,
-                   qemu_driver->snapshotDir);
+    virDomainObjListForEach(&qemu_driver->domains, qemuDomainSnapshotLoad,
+                            cfg->snapshotDir);
 
-    virHashForEach(qemu_driver->domains.objs, qemuDomainManagedSaveLoad,
-                   qemu_driver);
+    virDomainObjListForEach(&qemu_driver->domains, qemuDomainManagedSaveLoad,
+                            qemu_driver);
 
     qemu_driver->workerPool = virThreadPoolNew(0, 1, 0, processWatchdogEvent, qemu_driver);
     if (!qemu_driver->workerPool)
@@ -1005,8 +971,8 @@ qemuReload(void) {
     qemuDriverLock(qemu_driver);
     virDomainLoadAllConfigs(qemu_driver->caps,
                             &qemu_driver->domains,
-                            qemu_driver->configDir,
-                            qemu_driver->autostartDir,
+                            qemu_driver->config->configDir,
+                            qemu_driver->config->autostartDir,
                             0, QEMU_EXPECTED_VIRT_TYPES,
                             qemuNotifyLoadDomain, qemu_driver);
     qemuDriverUnlock(qemu_driver);
@@ -1033,7 +999,7 @@ qemuStop(void) {
     unsigned int *flags = NULL;
 
     qemuDriverLock(qemu_driver);
-    uri = qemu_driver->privileged ?
+    uri = qemu_driver->config->privileged ?
         "qemu:///system" :
         "qemu:///session";
     qemuDriverUnlock(qemu_driver);
@@ -1089,11 +1055,17 @@ qemuStop(void) {
  */
 static int
 qemuShutdown(void) {
-    int i;
-
     if (!qemu_driver)
         return -1;
 
+    /* Reconnect workers take the driver lock, so wait for them
+     * before grabbing it. Each queued reconnect holds a job and a
+     * connection reference, so let them all run rather than have
+     * virThreadPoolFree drop them */
+    if (qemu_driver->reconnectPool)
+        virThreadPoolDrain(qemu_driver->reconnectPool);
+    virThreadPoolFree(qemu_driver->reconnectPool);
+
     qemuDriverLock(qemu_driver);
     virNWFilterUnRegisterCallbackDriver(&qemuCallbackDriver);
     pciDeviceListFree(qemu_driver->activePciHostdevs);
@@ -1110,43 +1082,12 @@ qemuShutdown(void) {
 
     qemuDriverCloseCallbackShutdown(qemu_driver);
 
-    VIR_FREE(qemu_driver->configBaseDir);
-    VIR_FREE(qemu_driver->configDir);
-    VIR_FREE(qemu_driver->autostartDir);
-    VIR_FREE(qemu_driver->logDir);
-    VIR_FREE(qemu_driver->stateDir);
-    VIR_FREE(qemu_driver->libDir);
-    VIR_FREE(qemu_driver->cacheDir);
-    VIR_FREE(qemu_driver->saveDir);
-    VIR_FREE(qemu_driver->snapshotDir);
     VIR_FREE(qemu_driver->qemuImgBinary);
-    VIR_FREE(qemu_driver->autoDumpPath);
-    VIR_FREE(qemu_driver->vncTLSx509certdir);
-    VIR_FREE(qemu_driver->vncListen);
-    VIR_FREE(qemu_driver->vncPassword);
-    VIR_FREE(qemu_driver->vncSASLdir);
-    VIR_FREE(qemu_driver->spiceTLSx509certdir);
-    VIR_FREE(qemu_driver->spiceListen);
-    VIR_FREE(qemu_driver->spicePassword);
-    VIR_FREE(qemu_driver->hugetlbfs_mount);
-    VIR_FREE(qemu_driver->hugepage_path);
-    VIR_FREE(qemu_driver->saveImageFormat);
-    VIR_FREE(qemu_driver->dumpImageFormat);
-
-    for (i = 0 ; (qemu_driver->securityDriverNames != NULL &&
-                  qemu_driver->securityDriverNames[i] != NULL) ; i++)
-        VIR_FREE(qemu_driver->securityDriverNames[i]);
-    VIR_FREE(qemu_driver->securityDriverNames);
+
     virSecurityManagerFree(qemu_driver->securityManager);
 
     ebtablesContextFree(qemu_driver->ebtables);
 
-    if (qemu_driver->cgroupDeviceACL) {
-        for (i = 0 ; qemu_driver->cgroupDeviceACL[i] != NULL ; i++)
-            VIR_FREE(qemu_driver->cgroupDeviceACL[i]);
-        VIR_FREE(qemu_driver->cgroupDeviceACL);
-    }
-
     /* Free domain callback list */
     virDomainEventStateFree(qemu_driver->domainEventState);
 
@@ -1154,7 +1095,10 @@ qemuShutdown(void) {
 
     virLockManagerPluginUnref(qemu_driver->lockManager);
 
+    virObjectUnref(qemu_driver->config);
+
     qemuDriverUnlock(qemu_driver);
+    virMutexDestroy(&qemu_driver->capsLock);
     virMutexDestroy(&qemu_driver->lock);
     virThreadPoolFree(qemu_driver->workerPool);
     VIR_FREE(qemu_driver);
@@ -1173,7 +1117,7 @@ static virDrvOpenStatus qemuOpen(virConnectPtr conn,
         if (qemu_driver == NULL)
             return VIR_DRV_OPEN_DECLINED;
 
-        if (!(conn->uri = virURIParse(qemu_driver->privileged ?
+        if (!(conn->uri = virURIParse(qemu_driver->config->privileged ?
                                       "qemu:///system" :
                                       "qemu:///session")))
             return VIR_DRV_OPEN_ERROR;
@@ -1196,13 +1140,13 @@ static virDrvOpenStatus qemuOpen(virConnectPtr conn,
         if (conn->uri->path == NULL) {
             virReportError(VIR_ERR_INTERNAL_ERROR,
                            _("no QEMU URI path given, try %s"),
-                           qemu_driver->privileged
+                           qemu_driver->config->privileged
                            ? "qemu:///system"
                            : "qemu:///session");
                 return VIR_DRV_OPEN_ERROR;
         }
 
-        if (qemu_driver->privileged) {
+        if (qemu_driver->config->privileged) {
             if (STRNEQ(conn->uri->path, "/system") &&
                 STRNEQ(conn->uri->path, "/session")) {
                 virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -1250,6 +1194,7 @@ qemuSupportsFeature(virConnectPtr conn ATTRIBUTE_UNUSED, int feature)
     case VIR_DRV_FEATURE_TYPED_PARAM_STRING:
     case VIR_DRV_FEATURE_XML_MIGRATABLE:
     case VIR_DRV_FEATURE_MIGRATION_OFFLINE:
+    case VIR_DRV_FEATURE_MIGRATION_PARALLEL:
         return 1;
     default:
         return 0;
@@ -1348,15 +1293,12 @@ static char *qemuGetCapabilities(virConnectPtr conn) {
 
     qemuDriverLock(driver);
 
-    if ((caps = qemuCreateCapabilities(qemu_driver)) == NULL) {
-        virCapabilitiesFree(caps);
+    if ((caps = qemuCreateCapabilities(qemu_driver)) == NULL)
         goto cleanup;
-    }
 
-    virCapabilitiesFree(qemu_driver->caps);
-    qemu_driver->caps = caps;
+    virQEMUDriverSetCapabilities(driver, caps);
 
-    if ((xml = virCapabilitiesFormatXML(driver->caps)) == NULL)
+    if ((xml = virCapabilitiesFormatXML(caps)) == NULL)
         virReportOOMError();
 
 cleanup:
@@ -1448,9 +1390,7 @@ static virDomainPtr qemuDomainLookupByID(virConnectPtr conn,
     virDomainObjPtr vm;
     virDomainPtr dom = NULL;
 
-    qemuDriverLock(driver);
-    vm  = virDomainFindByID(&driver->domains, id);
-    qemuDriverUnlock(driver);
+    vm = virDomainFindByID(&driver->domains, id);
 
     if (!vm) {
         virReportError(VIR_ERR_NO_DOMAIN,
@@ -1473,9 +1413,7 @@ static virDomainPtr qemuDomainLookupByUUID(virConnectPtr conn,
     virDomainObjPtr vm;
     virDomainPtr dom = NULL;
 
-    qemuDriverLock(driver);
     vm = virDomainFindByUUID(&driver->domains, uuid);
-    qemuDriverUnlock(driver);
 
     if (!vm) {
         char uuidstr[VIR_UUID_STRING_BUFLEN];
@@ -1500,9 +1438,7 @@ static virDomainPtr qemuDomainLookupByName(virConnectPtr conn,
     virDomainObjPtr vm;
     virDomainPtr dom = NULL;
 
-    qemuDriverLock(driver);
     vm = virDomainFindByName(&driver->domains, name);
-    qemuDriverUnlock(driver);
 
     if (!vm) {
         virReportError(VIR_ERR_NO_DOMAIN,
@@ -1590,9 +1526,7 @@ static int qemuListDomains(virConnectPtr conn, int *ids, int nids) {
     virQEMUDriverPtr driver = conn->privateData;
     int n;
 
-    qemuDriverLock(driver);
     n = virDomainObjListGetActiveIDs(&driver->domains, ids, nids);
-    qemuDriverUnlock(driver);
 
     return n;
 }
@@ -1601,9 +1535,7 @@ static int qemuNumDomains(virConnectPtr conn) {
     virQEMUDriverPtr driver = conn->privateData;
     int n;
 
-    qemuDriverLock(driver);
     n = virDomainObjListNumOfDomains(&driver->domains, 1);
-    qemuDriverUnlock(driver);
 
     return n;
 }
@@ -1792,7 +1724,7 @@ static int qemuDomainSuspend(virDomainPtr dom) {
                                              eventDetail);
         }
     }
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
+    if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0)
         goto endjob;
     ret = 0;
 
@@ -1856,7 +1788,7 @@ static int qemuDomainResume(virDomainPtr dom) {
                                          VIR_DOMAIN_EVENT_RESUMED,
                                          VIR_DOMAIN_EVENT_RESUMED_UNPAUSED);
     }
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
+    if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0)
         goto endjob;
     ret = 0;
 
@@ -2263,7 +2195,7 @@ static int qemuDomainSetMemoryFlags(virDomainPtr dom, unsigned long newmem,
             persistentDef->mem.max_balloon = newmem;
             if (persistentDef->mem.cur_balloon > newmem)
                 persistentDef->mem.cur_balloon = newmem;
-            ret = virDomainSaveConfig(driver->configDir, persistentDef);
+            ret = virDomainSaveConfig(driver->config->configDir, persistentDef);
             goto endjob;
         }
 
@@ -2298,7 +2230,7 @@ static int qemuDomainSetMemoryFlags(virDomainPtr dom, unsigned long newmem,
         if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
             sa_assert(persistentDef);
             persistentDef->mem.cur_balloon = newmem;
-            ret = virDomainSaveConfig(driver->configDir, persistentDef);
+            ret = virDomainSaveConfig(driver->config->configDir, persistentDef);
             goto endjob;
         }
     }
@@ -2701,7 +2633,7 @@ qemuOpenFile(virQEMUDriverPtr driver, const char *path, int oflags,
 
         /* Don't force chown on network-shared FS
          * as it is likely to fail. */
-        if (path_shared <= 0 || driver->dynamicOwnership)
+        if (path_shared <= 0 || driver->config->dynamicOwnership)
             vfoflags |= VIR_FILE_OPEN_FORCE_OWNER;
 
         if (stat(path, &sb) == 0) {
@@ -2709,7 +2641,7 @@ qemuOpenFile(virQEMUDriverPtr driver, const char *path, int oflags,
             /* If the path is regular file which exists
              * already and dynamic_ownership is off, we don't
              * want to change it's ownership, just open it as-is */
-            if (is_reg && !driver->dynamicOwnership) {
+            if (is_reg && !driver->config->dynamicOwnership) {
                 uid = sb.st_uid;
                 gid = sb.st_gid;
             }
@@ -2729,11 +2661,11 @@ qemuOpenFile(virQEMUDriverPtr driver, const char *path, int oflags,
             /* If we failed as root, and the error was permission-denied
                (EACCES or EPERM), assume it's on a network-connected share
                where root access is restricted (eg, root-squashed NFS). If the
-               qemu user (driver->user) is non-root, just set a flag to
+               qemu user (driver->config->user) is non-root, just set a flag to
                bypass security driver shenanigans, and retry the operation
                after doing setuid to qemu user */
             if ((fd != -EACCES && fd != -EPERM) ||
-                driver->user == getuid()) {
+                driver->config->user == getuid()) {
                 virReportSystemError(-fd,
                                      _("Failed to create file '%s'"),
                                      path);
@@ -2764,11 +2696,11 @@ qemuOpenFile(virQEMUDriverPtr driver, const char *path, int oflags,
                    goto cleanup;
             }
 
-            /* Retry creating the file as driver->user */
+            /* Retry creating the file as driver->config->user */
 
             if ((fd = virFileOpenAs(path, oflags,
                                     S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP,
-                                    driver->user, driver->group,
+                                    driver->config->user, driver->config->group,
                                     vfoflags | VIR_FILE_OPEN_FORK)) < 0) {
                 virReportSystemError(-fd,
                                    _("Error from child process creating '%s'"),
@@ -3069,10 +3001,10 @@ qemuDomainSaveFlags(virDomainPtr dom, const char *path, const char *dxml,
 
     qemuDriverLock(driver);
 
-    if (driver->saveImageFormat == NULL)
+    if (driver->config->saveImageFormat == NULL)
         compressed = QEMU_SAVE_FORMAT_RAW;
     else {
-        compressed = qemuSaveCompressionTypeFromString(driver->saveImageFormat);
+        compressed = qemuSaveCompressionTypeFromString(driver->config->saveImageFormat);
         if (compressed < 0) {
             virReportError(VIR_ERR_OPERATION_FAILED,
                            "%s", _("Invalid save image format specified "
@@ -3125,7 +3057,7 @@ qemuDomainManagedSavePath(virQEMUDriverPtr driver, virDomainObjPtr vm)
 {
     char *ret;
 
-    if (virAsprintf(&ret, "%s/%s.save", driver->saveDir, vm->def->name) < 0) {
+    if (virAsprintf(&ret, "%s/%s.save", driver->config->saveDir, vm->def->name) < 0) {
         virReportOOMError();
         return NULL;
     }
@@ -3353,8 +3285,8 @@ getCompressionType(virQEMUDriverPtr driver)
      * We reuse "save" flag for "dump" here. Then, we can support the same
      * format in "save" and "dump".
      */
-    if (driver->dumpImageFormat) {
-        compress = qemuSaveCompressionTypeFromString(driver->dumpImageFormat);
+    if (driver->config->dumpImageFormat) {
+        compress = qemuSaveCompressionTypeFromString(driver->config->dumpImageFormat);
         /* Use "raw" as the format if the specified format is not valid,
          * or the compress program is not available.
          */
@@ -3522,7 +3454,7 @@ qemuDomainScreenshot(virDomainPtr dom,
         goto endjob;
     }
 
-    if (virAsprintf(&tmp, "%s/qemu.screendump.XXXXXX", driver->cacheDir) < 0) {
+    if (virAsprintf(&tmp, "%s/qemu.screendump.XXXXXX", driver->config->cacheDir) < 0) {
         virReportOOMError();
         goto endjob;
     }
@@ -3575,6 +3507,7 @@ static void processWatchdogEvent(void *data, void *opaque)
     int ret;
     struct qemuDomainWatchdogEvent *wdEvent = data;
     virQEMUDriverPtr driver = opaque;
+    virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
 
     qemuDriverLock(driver);
     virObjectLock(wdEvent->vm);
@@ -3586,15 +3519,15 @@ static void processWatchdogEvent(void *data, void *opaque)
             unsigned int flags = 0;
 
             if (virAsprintf(&dumpfile, "%s/%s-%u",
-                            driver->autoDumpPath,
+                            cfg->autoDumpPath,
                             wdEvent->vm->def->name,
                             (unsigned int)time(NULL)) < 0) {
                 virReportOOMError();
                 goto unlock;
             }
 
-            if (qemuDomainObjBeginAsyncJobWithDriver(driver, wdEvent->vm,
-                                                     QEMU_ASYNC_JOB_DUMP) < 0) {
+            if (qemuDomainObjBeginInternalAsyncJobWithDriver(driver, wdEvent->vm,
+                                                             QEMU_ASYNC_JOB_DUMP) < 0) {
                 VIR_FREE(dumpfile);
                 goto unlock;
             }
@@ -3606,7 +3539,7 @@ static void processWatchdogEvent(void *data, void *opaque)
                 goto endjob;
             }
 
-            flags |= driver->autoDumpBypassCache ? VIR_DUMP_BYPASS_CACHE: 0;
+            flags |= cfg->autoDumpBypassCache ? VIR_DUMP_BYPASS_CACHE: 0;
             ret = doCoreDump(driver, wdEvent->vm, dumpfile,
                              getCompressionType(driver), flags);
             if (ret < 0)
@@ -3639,6 +3572,7 @@ unlock:
     virObjectUnref(wdEvent->vm);
     qemuDriverUnlock(driver);
     VIR_FREE(wdEvent);
+    virObjectUnref(cfg);
 }
 
 static int qemuDomainHotplugVcpus(virQEMUDriverPtr driver,
@@ -3923,7 +3857,7 @@ qemuDomainSetVcpusFlags(virDomainPtr dom, unsigned int nvcpus,
             persistentDef->vcpus = nvcpus;
         }
 
-        if (virDomainSaveConfig(driver->configDir, persistentDef) < 0)
+        if (virDomainSaveConfig(driver->config->configDir, persistentDef) < 0)
             goto endjob;
     }
 
@@ -4062,7 +3996,7 @@ qemuDomainPinVcpuFlags(virDomainPtr dom,
         if (newVcpuPin)
             virDomainVcpuPinDefArrayFree(newVcpuPin, newVcpuPinNum);
 
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0)
             goto cleanup;
     }
 
@@ -4095,7 +4029,7 @@ qemuDomainPinVcpuFlags(virDomainPtr dom,
             }
         }
 
-        ret = virDomainSaveConfig(driver->configDir, persistentDef);
+        ret = virDomainSaveConfig(driver->config->configDir, persistentDef);
         goto cleanup;
     }
 
@@ -4314,7 +4248,7 @@ qemuDomainPinEmulator(virDomainPtr dom,
             goto cleanup;
         }
 
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0)
             goto cleanup;
     }
 
@@ -4336,7 +4270,7 @@ qemuDomainPinEmulator(virDomainPtr dom,
             }
         }
 
-        ret = virDomainSaveConfig(driver->configDir, persistentDef);
+        ret = virDomainSaveConfig(driver->config->configDir, persistentDef);
         goto cleanup;
     }
 
@@ -4957,7 +4891,7 @@ qemuDomainSaveImageStartVM(virConnectPtr conn,
                                "%s", _("failed to resume domain"));
             goto out;
         }
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
             VIR_WARN("Failed to save status on vm %s", vm->def->name);
             goto out;
         }
@@ -5226,16 +5160,8 @@ static char *qemuDomainGetXMLDesc(virDomainPtr dom,
 
     /* Flags checked by virDomainDefFormat */
 
-    qemuDriverLock(driver);
-    vm = virDomainFindByUUID(&driver->domains, dom->uuid);
-
-    if (!vm) {
-        char uuidstr[VIR_UUID_STRING_BUFLEN];
-        virUUIDFormat(dom->uuid, uuidstr);
-        virReportError(VIR_ERR_NO_DOMAIN,
-                       _("no domain with matching uuid '%s'"), uuidstr);
+    if (!(vm = qemuDomObjFromDomain(dom)))
         goto cleanup;
-    }
 
     priv = vm->privateData;
 
@@ -5247,7 +5173,7 @@ static char *qemuDomainGetXMLDesc(virDomainPtr dom,
         /* Don't delay if someone's using the monitor, just use
          * existing most recent data instead */
         if (qemuDomainJobAllowed(priv, QEMU_JOB_QUERY)) {
-            if (qemuDomainObjBeginJobWithDriver(driver, vm, QEMU_JOB_QUERY) < 0)
+            if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY) < 0)
                 goto cleanup;
 
             if (!virDomainObjIsActive(vm)) {
@@ -5256,9 +5182,9 @@ static char *qemuDomainGetXMLDesc(virDomainPtr dom,
                 goto endjob;
             }
 
-            qemuDomainObjEnterMonitorWithDriver(driver, vm);
+            qemuDomainObjEnterMonitor(driver, vm);
             err = qemuMonitorGetBalloonInfo(priv->mon, &balloon);
-            qemuDomainObjExitMonitorWithDriver(driver, vm);
+            qemuDomainObjExitMonitor(driver, vm);
 
 endjob:
             if (qemuDomainObjEndJob(driver, vm) == 0) {
@@ -5281,7 +5207,6 @@ endjob:
 cleanup:
     if (vm)
         virObjectUnlock(vm);
-    qemuDriverUnlock(driver);
     return ret;
 }
 
@@ -5457,9 +5382,7 @@ static int qemuListDefinedDomains(virConnectPtr conn,
     virQEMUDriverPtr driver = conn->privateData;
     int n;
 
-    qemuDriverLock(driver);
     n = virDomainObjListGetInactiveNames(&driver->domains, names, nnames);
-    qemuDriverUnlock(driver);
     return n;
 }
 
@@ -5467,9 +5390,7 @@ static int qemuNumDefinedDomains(virConnectPtr conn) {
     virQEMUDriverPtr driver = conn->privateData;
     int n;
 
-    qemuDriverLock(driver);
     n = virDomainObjListNumOfDomains(&driver->domains, 0);
-    qemuDriverUnlock(driver);
 
     return n;
 }
@@ -5666,7 +5587,7 @@ static virDomainPtr qemuDomainDefine(virConnectPtr conn, const char *xml) {
     }
     vm->persistent = 1;
 
-    if (virDomainSaveConfig(driver->configDir,
+    if (virDomainSaveConfig(driver->config->configDir,
                             vm->newDef ? vm->newDef : vm->def) < 0) {
         if (def_backup) {
             /* There is backup so this VM was defined before.
@@ -5772,7 +5693,7 @@ qemuDomainUndefineFlags(virDomainPtr dom,
         }
     }
 
-    if (virDomainDeleteConfig(driver->configDir, driver->autostartDir, vm) < 0)
+    if (virDomainDeleteConfig(driver->config->configDir, driver->config->autostartDir, vm) < 0)
         goto cleanup;
 
     event = virDomainEventNewFromObj(vm,
@@ -6556,7 +6477,7 @@ qemuDomainModifyDeviceFlags(virDomainPtr dom, const char *xml,
          * changed even if we failed to attach the device. For example,
          * a new controller may be created.
          */
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
             ret = -1;
             goto endjob;
         }
@@ -6564,7 +6485,7 @@ qemuDomainModifyDeviceFlags(virDomainPtr dom, const char *xml,
 
     /* Finally, if no error until here, we can save config. */
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
-        ret = virDomainSaveConfig(driver->configDir, vmdef);
+        ret = virDomainSaveConfig(driver->config->configDir, vmdef);
         if (!ret) {
             virDomainObjAssignDef(vm, vmdef, false);
             vmdef = NULL;
@@ -6663,16 +6584,16 @@ static int qemuDomainSetAutostart(virDomainPtr dom,
     autostart = (autostart != 0);
 
     if (vm->autostart != autostart) {
-        if ((configFile = virDomainConfigFile(driver->configDir, vm->def->name)) == NULL)
+        if ((configFile = virDomainConfigFile(driver->config->configDir, vm->def->name)) == NULL)
             goto cleanup;
-        if ((autostartLink = virDomainConfigFile(driver->autostartDir, vm->def->name)) == NULL)
+        if ((autostartLink = virDomainConfigFile(driver->config->autostartDir, vm->def->name)) == NULL)
             goto cleanup;
 
         if (autostart) {
-            if (virFileMakePath(driver->autostartDir) < 0) {
+            if (virFileMakePath(driver->config->autostartDir) < 0) {
                 virReportSystemError(errno,
                                      _("cannot create autostart directory %s"),
-                                     driver->autostartDir);
+                                     driver->config->autostartDir);
                 goto cleanup;
             }
 
@@ -7040,7 +6961,7 @@ qemuDomainSetBlkioParameters(virDomainPtr dom,
             }
         }
 
-        if (virDomainSaveConfig(driver->configDir, persistentDef) < 0)
+        if (virDomainSaveConfig(driver->config->configDir, persistentDef) < 0)
             ret = -1;
     }
 
@@ -7395,7 +7316,7 @@ qemuDomainSetMemoryParameters(virDomainPtr dom,
     }
 
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
-        if (virDomainSaveConfig(driver->configDir, persistentDef) < 0)
+        if (virDomainSaveConfig(driver->config->configDir, persistentDef) < 0)
             ret = -1;
     }
 
@@ -7704,7 +7625,7 @@ qemuDomainSetNumaParameters(virDomainPtr dom,
         if (!persistentDef->numatune.memory.placement_mode)
             persistentDef->numatune.memory.placement_mode =
                 VIR_DOMAIN_NUMATUNE_MEM_PLACEMENT_MODE_AUTO;
-        if (virDomainSaveConfig(driver->configDir, persistentDef) < 0)
+        if (virDomainSaveConfig(driver->config->configDir, persistentDef) < 0)
             ret = -1;
     }
 
@@ -8056,12 +7977,12 @@ qemuSetSchedulerParametersFlags(virDomainPtr dom,
         }
     }
 
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
+    if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0)
         goto cleanup;
 
 
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
-        rc = virDomainSaveConfig(driver->configDir, vmdef);
+        rc = virDomainSaveConfig(driver->config->configDir, vmdef);
         if (rc < 0)
             goto cleanup;
 
@@ -8884,7 +8805,7 @@ qemuDomainSetInterfaceParameters(virDomainPtr dom,
             }
         }
 
-        if (virDomainSaveConfig(driver->configDir, persistentDef) < 0)
+        if (virDomainSaveConfig(driver->config->configDir, persistentDef) < 0)
             goto cleanup;
     }
 
@@ -9161,7 +9082,7 @@ qemuDomainMemoryPeek(virDomainPtr dom,
         goto endjob;
     }
 
-    if (virAsprintf(&tmp, "%s/qemu.mem.XXXXXX", driver->cacheDir) < 0) {
+    if (virAsprintf(&tmp, "%s/qemu.mem.XXXXXX", driver->config->cacheDir) < 0) {
         virReportOOMError();
         goto endjob;
     }
@@ -9268,9 +9189,9 @@ static int qemuDomainGetBlockInfo(virDomainPtr dom,
     if (disk->format) {
         format = disk->format;
     } else {
-        if (driver->allowDiskFormatProbing) {
-            if ((format = virStorageFileProbeFormat(disk->src, driver->user,
-                                                    driver->group)) < 0)
+        if (driver->config->allowDiskFormatProbing) {
+            if ((format = virStorageFileProbeFormat(disk->src, driver->config->user,
+                                                    driver->config->group)) < 0)
                 goto cleanup;
         } else {
             virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -9835,6 +9756,34 @@ cleanup:
 }
 
 
+static int
+qemuDomainMigratePrepareTunnelStream(virConnectPtr dconn,
+                                     virStreamPtr st,
+                                     const char *dname,
+                                     unsigned int flags)
+{
+    virQEMUDriverPtr driver = dconn->privateData;
+    virDomainObjPtr vm;
+    int ret = -1;
+
+    virCheckFlags(0, -1);
+
+    qemuDriverLock(driver);
+    vm = virDomainFindByName(&driver->domains, dname);
+    if (!vm) {
+        virReportError(VIR_ERR_NO_DOMAIN,
+                       _("no domain with matching name '%s'"), dname);
+        goto cleanup;
+    }
+
+    ret = qemuMigrationPrepareTunnelStream(driver, vm, st);
+    virObjectUnlock(vm);
+
+cleanup:
+    qemuDriverUnlock(driver);
+    return ret;
+}
+
 static int
 qemuDomainMigratePerform3(virDomainPtr dom,
                           const char *xmlin,
@@ -9955,7 +9904,7 @@ qemuDomainMigrateConfirm3(virDomainPtr domain,
     } else if (!virDomainObjIsActive(vm) &&
                (!vm->persistent || (flags & VIR_MIGRATE_UNDEFINE_SOURCE))) {
         if (flags & VIR_MIGRATE_UNDEFINE_SOURCE)
-            virDomainDeleteConfig(driver->configDir, driver->autostartDir, vm);
+            virDomainDeleteConfig(driver->config->configDir, driver->config->autostartDir, vm);
         qemuDomainRemoveInactive(driver, vm);
         vm = NULL;
     }
@@ -10204,6 +10153,179 @@ cleanup:
 }
 
 
+static int
+qemuDomainJobInfoToParams(virDomainJobInfoPtr info,
+                          qemuMonitorMigrationStatusPtr status,
+                          virTypedParameterPtr *params,
+                          int *nparams)
+{
+    virTypedParameterPtr par = NULL;
+    int maxpar = 0;
+    int npar = 0;
+
+    if (virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_TIME_ELAPSED,
+                                info->timeElapsed) < 0)
+        goto error;
+
+    if (info->type == VIR_DOMAIN_JOB_BOUNDED &&
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_TIME_REMAINING,
+                                info->timeRemaining) < 0)
+        goto error;
+
+    if (status->downtime_set &&
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_DOWNTIME,
+                                status->downtime) < 0)
+        goto error;
+
+    if (status->setup_time_set &&
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_SETUP_TIME,
+                                status->setup_time) < 0)
+        goto error;
+
+    if (virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_DATA_TOTAL,
+                                info->dataTotal) < 0 ||
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_DATA_PROCESSED,
+                                info->dataProcessed) < 0 ||
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_DATA_REMAINING,
+                                info->dataRemaining) < 0)
+        goto error;
+
+    if (virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_MEMORY_TOTAL,
+                                info->memTotal) < 0 ||
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_MEMORY_PROCESSED,
+                                info->memProcessed) < 0 ||
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_MEMORY_REMAINING,
+                                info->memRemaining) < 0)
+        goto error;
+
+    if (status->ram_duplicate_set) {
+        if (virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                    VIR_DOMAIN_JOB_MEMORY_CONSTANT,
+                                    status->ram_duplicate) < 0 ||
+            virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                    VIR_DOMAIN_JOB_MEMORY_NORMAL,
+                                    status->ram_normal) < 0 ||
+            virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                    VIR_DOMAIN_JOB_MEMORY_NORMAL_BYTES,
+                                    status->ram_normal_bytes) < 0)
+            goto error;
+    }
+
+    if (status->ram_bps_set &&
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_MEMORY_BPS,
+                                status->ram_bps) < 0)
+        goto error;
+
+    /* The dirty rate is meaningless once the guest stopped running */
+    if (status->ram_dirty_rate_set &&
+        status->status == QEMU_MONITOR_MIGRATION_STATUS_ACTIVE &&
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_MEMORY_DIRTY_RATE,
+                                status->ram_dirty_rate) < 0)
+        goto error;
+
+    if (status->ram_iteration_set &&
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_MEMORY_ITERATION,
+                                status->ram_iteration) < 0)
+        goto error;
+
+    if (virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_DISK_TOTAL,
+                                info->fileTotal) < 0 ||
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_DISK_PROCESSED,
+                                info->fileProcessed) < 0 ||
+        virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                VIR_DOMAIN_JOB_DISK_REMAINING,
+                                info->fileRemaining) < 0)
+        goto error;
+
+    *params = par;
+    *nparams = npar;
+    return 0;
+
+error:
+    virTypedParamsFree(par, npar);
+    return -1;
+}
+
+
+static int
+qemuDomainGetJobStats(virDomainPtr dom,
+                      int *type,
+                      virTypedParameterPtr *params,
+                      int *nparams,
+                      unsigned int flags)
+{
+    virDomainObjPtr vm;
+    qemuDomainObjPrivatePtr priv;
+    virDomainJobInfo info;
+    qemuMonitorMigrationStatusPtr status;
+    int ret = -1;
+
+    virCheckFlags(VIR_DOMAIN_JOB_STATS_COMPLETED, -1);
+
+    if (!(vm = qemuDomObjFromDomain(dom)))
+        goto cleanup;
+
+    priv = vm->privateData;
+
+    *type = VIR_DOMAIN_JOB_NONE;
+    *params = NULL;
+    *nparams = 0;
+
+    if (flags & VIR_DOMAIN_JOB_STATS_COMPLETED) {
+        if (!priv->job.completed) {
+            ret = 0;
+            goto cleanup;
+        }
+        info = priv->job.completed->info;
+        status = &priv->job.completed->status;
+    } else {
+        if (!virDomainObjIsActive(vm)) {
+            virReportError(VIR_ERR_OPERATION_INVALID,
+                           "%s", _("domain is not running"));
+            goto cleanup;
+        }
+
+        if (!priv->job.asyncJob || priv->job.dump_memory_only) {
+            ret = 0;
+            goto cleanup;
+        }
+        info = priv->job.info;
+        status = &priv->job.status;
+
+        /* Refresh elapsed time, see qemuDomainGetJobInfo */
+        if (virTimeMillisNow(&info.timeElapsed) < 0)
+            goto cleanup;
+        info.timeElapsed -= priv->job.start;
+    }
+
+    if (qemuDomainJobInfoToParams(&info, status, params, nparams) < 0)
+        goto cleanup;
+
+    *type = info.type;
+    ret = 0;
+
+cleanup:
+    if (vm)
+        virObjectUnlock(vm);
+    return ret;
+}
+
+
 static int qemuDomainAbortJob(virDomainPtr dom) {
     virQEMUDriverPtr driver = dom->conn->privateData;
     virDomainObjPtr vm;
@@ -10289,6 +10411,9 @@ qemuDomainMigrateSetMaxDowntime(virDomainPtr dom,
     ret = qemuMonitorSetMigrationDowntime(priv->mon, downtime);
     qemuDomainObjExitMonitor(driver, vm);
 
+    if (ret == 0)
+        priv->job.migMaxDowntime = downtime;
+
 endjob:
     if (qemuDomainObjEndJob(driver, vm) == 0)
         vm = NULL;
@@ -10412,7 +10537,7 @@ qemuDomainPrepareDiskChainElement(virQEMUDriverPtr driver,
             VIR_WARN("Failed to teardown cgroup for disk path %s", disk->src);
         if (virDomainLockDiskDetach(driver->lockManager, vm, disk) < 0)
             VIR_WARN("Unable to release lock on %s", disk->src);
-    } else if (virDomainLockDiskAttach(driver->lockManager, driver->uri,
+    } else if (virDomainLockDiskAttach(driver->lockManager, driver->config->uri,
                                        vm, disk) < 0 ||
                (cgroup && qemuSetupDiskCgroup(vm, cgroup, disk) < 0) ||
                virSecurityManagerSetImageLabel(driver->securityManager,
@@ -10552,7 +10677,7 @@ qemuDomainSnapshotCreateInactiveExternal(virQEMUDriverPtr driver,
                                    defdisk->src,
                                    virStorageFileFormatTypeToString(defdisk->format));
         } else {
-            if (!driver->allowDiskFormatProbing) {
+            if (!driver->config->allowDiskFormatProbing) {
                 virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                                _("unknown image format of '%s' and "
                                  "format probing is disabled"),
@@ -11095,8 +11220,8 @@ cleanup:
     virCgroupFree(&cgroup);
 
     if (ret == 0 || !qemuCapsGet(priv->caps, QEMU_CAPS_TRANSACTION)) {
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0 ||
-            (persist && virDomainSaveConfig(driver->configDir, vm->newDef) < 0))
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0 ||
+            (persist && virDomainSaveConfig(driver->config->configDir, vm->newDef) < 0))
             ret = -1;
     }
 
@@ -11581,7 +11706,7 @@ qemuDomainSnapshotCreateXML(virDomainPtr domain,
         if (update_current) {
             vm->current_snapshot->def->current = false;
             if (qemuDomainSnapshotWriteMetadata(vm, vm->current_snapshot,
-                                                driver->snapshotDir) < 0)
+                                                driver->config->snapshotDir) < 0)
                 goto cleanup;
             vm->current_snapshot = NULL;
         }
@@ -11631,7 +11756,7 @@ cleanup:
     if (vm) {
         if (snapshot && !(flags & VIR_DOMAIN_SNAPSHOT_CREATE_NO_METADATA)) {
             if (qemuDomainSnapshotWriteMetadata(vm, snap,
-                                                driver->snapshotDir) < 0) {
+                                                driver->config->snapshotDir) < 0) {
                 /* if writing of metadata fails, error out rather than trying
                  * to silently carry on  without completing the snapshot */
                 virDomainSnapshotFree(snapshot);
@@ -12081,7 +12206,7 @@ static int qemuDomainRevertToSnapshot(virDomainSnapshotPtr snapshot,
     if (vm->current_snapshot) {
         vm->current_snapshot->def->current = false;
         if (qemuDomainSnapshotWriteMetadata(vm, vm->current_snapshot,
-                                            driver->snapshotDir) < 0)
+                                            driver->config->snapshotDir) < 0)
             goto cleanup;
         vm->current_snapshot = NULL;
         /* XXX Should we restore vm->current_snapshot after this point
@@ -12308,7 +12433,7 @@ endjob:
 cleanup:
     if (vm && ret == 0) {
         if (qemuDomainSnapshotWriteMetadata(vm, snap,
-                                            driver->snapshotDir) < 0)
+                                            driver->config->snapshotDir) < 0)
             ret = -1;
         else
             vm->current_snapshot = snap;
@@ -12367,7 +12492,7 @@ qemuDomainSnapshotReparentChildren(void *payload,
         rep->last = snap;
 
     rep->err = qemuDomainSnapshotWriteMetadata(rep->vm, snap,
-                                               rep->driver->snapshotDir);
+                                               rep->driver->config->snapshotDir);
 }
 
 static int qemuDomainSnapshotDelete(virDomainSnapshotPtr snapshot,
@@ -12434,7 +12559,7 @@ static int qemuDomainSnapshotDelete(virDomainSnapshotPtr snapshot,
             if (flags & VIR_DOMAIN_SNAPSHOT_DELETE_CHILDREN_ONLY) {
                 snap->def->current = true;
                 if (qemuDomainSnapshotWriteMetadata(vm, snap,
-                                                    driver->snapshotDir) < 0) {
+                                                    driver->config->snapshotDir) < 0) {
                     virReportError(VIR_ERR_INTERNAL_ERROR,
                                    _("failed to set snapshot '%s' as current"),
                                    snap->def->name);
@@ -12903,7 +13028,7 @@ qemuDomainBlockPivot(virConnectPtr conn,
         goto cleanup;
     }
     if (disk->mirrorFormat && disk->mirrorFormat != VIR_STORAGE_FILE_RAW &&
-        (virDomainLockDiskAttach(driver->lockManager, driver->uri,
+        (virDomainLockDiskAttach(driver->lockManager, driver->config->uri,
                                  vm, disk) < 0 ||
          (cgroup && qemuSetupDiskCgroup(vm, cgroup, disk) < 0) ||
          virSecurityManagerSetImageLabel(driver->securityManager, vm->def,
@@ -13294,8 +13419,8 @@ qemuDomainBlockCopy(virDomainPtr dom, const char *path,
          * also passed the RAW flag (and format is non-NULL), or it is
          * safe for us to probe the format from the file that we will
          * be using.  */
-        disk->mirrorFormat = virStorageFileProbeFormat(dest, driver->user,
-                                                       driver->group);
+        disk->mirrorFormat = virStorageFileProbeFormat(dest, driver->config->user,
+                                                       driver->config->group);
     }
     if (!format && disk->mirrorFormat > 0)
         format = virStorageFileFormatTypeToString(disk->mirrorFormat);
@@ -13747,7 +13872,7 @@ qemuDomainSetBlockIoTune(virDomainPtr dom,
             info.write_iops_sec = oldinfo->write_iops_sec;
         }
         persistentDef->disks[idx]->blkdeviotune = info;
-        ret = virDomainSaveConfig(driver->configDir, persistentDef);
+        ret = virDomainSaveConfig(driver->config->configDir, persistentDef);
         if (ret < 0) {
             virReportError(VIR_ERR_OPERATION_INVALID, "%s",
                            _("Write to config file failed"));
@@ -14056,7 +14181,7 @@ qemuDomainSetMetadata(virDomainPtr dom,
             break;
         }
 
-        if (virDomainSaveConfig(driver->configDir, persistentDef) < 0)
+        if (virDomainSaveConfig(driver->config->configDir, persistentDef) < 0)
             goto cleanup;
     }
 
@@ -14562,9 +14687,7 @@ qemuListAllDomains(virConnectPtr conn,
 
     virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ALL, -1);
 
-    qemuDriverLock(driver);
-    ret = virDomainList(conn, driver->domains.objs, domains, flags);
-    qemuDriverUnlock(driver);
+    ret = virDomainList(conn, &driver->domains, domains, flags);
 
     return ret;
 }
@@ -14703,6 +14826,533 @@ cleanup:
     return ret;
 }
 
+
+/* Data gathered from the monitor once per domain and shared by the
+ * individual stats groups, so that a bulk stats query costs at most
+ * one job and one monitor round-trip per command per domain. */
+typedef struct _qemuDomainStatsMonitorData qemuDomainStatsMonitorData;
+typedef qemuDomainStatsMonitorData *qemuDomainStatsMonitorDataPtr;
+struct _qemuDomainStatsMonitorData {
+    bool haveBalloon;
+    unsigned long long balloon;
+    virHashTablePtr blockstats;
+};
+
+typedef int
+(*qemuDomainGetStatsFunc)(virQEMUDriverPtr driver,
+                          virDomainObjPtr dom,
+                          qemuDomainStatsMonitorDataPtr mondata,
+                          virDomainStatsRecordPtr record,
+                          int *maxparams);
+
+struct qemuDomainGetStatsWorker {
+    qemuDomainGetStatsFunc func;
+    unsigned int stats;
+};
+
+#define QEMU_ADD_STATS_PARAM(type, record, maxparams, name, value)      \
+    do {                                                                \
+        if (virTypedParamsAdd ## type(&(record)->params,                \
+                                      &(record)->nparams,               \
+                                      maxparams,                        \
+                                      name,                             \
+                                      value) < 0)                       \
+            return -1;                                                  \
+    } while (0)
+
+#define QEMU_ADD_INDEXED_STATS_PARAM(type, record, maxparams,           \
+                                     group, num, name, value)           \
+    do {                                                                \
+        char param_name[VIR_TYPED_PARAM_FIELD_LENGTH];                  \
+        snprintf(param_name, VIR_TYPED_PARAM_FIELD_LENGTH,              \
+                 "%s.%zu.%s", group, num, name);                        \
+        QEMU_ADD_STATS_PARAM(type, record, maxparams,                   \
+                             param_name, value);                        \
+    } while (0)
+
+static int
+qemuDomainGetStatsState(virQEMUDriverPtr driver ATTRIBUTE_UNUSED,
+                        virDomainObjPtr dom,
+                        qemuDomainStatsMonitorDataPtr mondata ATTRIBUTE_UNUSED,
+                        virDomainStatsRecordPtr record,
+                        int *maxparams)
+{
+    QEMU_ADD_STATS_PARAM(Int, record, maxparams,
+                         "state.state", dom->state.state);
+    QEMU_ADD_STATS_PARAM(Int, record, maxparams,
+                         "state.reason", dom->state.reason);
+
+    return 0;
+}
+
+static int
+qemuDomainGetStatsCpu(virQEMUDriverPtr driver,
+                      virDomainObjPtr dom,
+                      qemuDomainStatsMonitorDataPtr mondata ATTRIBUTE_UNUSED,
+                      virDomainStatsRecordPtr record,
+                      int *maxparams)
+{
+    virCgroupPtr group = NULL;
+    unsigned long long cpu_time = 0;
+    unsigned long long user = 0;
+    unsigned long long sys = 0;
+    int ret = -1;
+
+    if (!virDomainObjIsActive(dom))
+        return 0;
+
+    /* Prefer the cgroup accounting, which includes all threads of
+     * the domain, and fall back to /proc when it is unavailable */
+    if (!qemuCgroupControllerActive(driver, VIR_CGROUP_CONTROLLER_CPUACCT) ||
+        virCgroupForDomain(driver->cgroup, dom->def->name, &group, 0) < 0) {
+        if (qemuGetProcessInfo(&cpu_time, NULL, NULL, dom->pid, 0) < 0)
+            return 0;
+
+        QEMU_ADD_STATS_PARAM(ULLong, record, maxparams,
+                             "cpu.time", cpu_time);
+        return 0;
+    }
+
+    if (virCgroupGetCpuacctUsage(group, &cpu_time) == 0 &&
+        virTypedParamsAddULLong(&record->params, &record->nparams,
+                                maxparams, "cpu.time", cpu_time) < 0)
+        goto cleanup;
+
+    if (virCgroupGetCpuacctStat(group, &user, &sys) == 0 &&
+        (virTypedParamsAddULLong(&record->params, &record->nparams,
+                                 maxparams, "cpu.user", user) < 0 ||
+         virTypedParamsAddULLong(&record->params, &record->nparams,
+                                 maxparams, "cpu.system", sys) < 0))
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virCgroupFree(&group);
+    return ret;
+}
+
+static int
+qemuDomainGetStatsBalloon(virQEMUDriverPtr driver ATTRIBUTE_UNUSED,
+                          virDomainObjPtr dom,
+                          qemuDomainStatsMonitorDataPtr mondata,
+                          virDomainStatsRecordPtr record,
+                          int *maxparams)
+{
+    qemuDomainObjPrivatePtr priv = dom->privateData;
+    unsigned long long cur_balloon = dom->def->mem.cur_balloon;
+
+    /* Same logic as qemuDomainGetInfo, except that the monitor
+     * was already queried, if at all possible */
+    if (virDomainObjIsActive(dom)) {
+        if (dom->def->memballoon &&
+            dom->def->memballoon->model == VIR_DOMAIN_MEMBALLOON_MODEL_NONE) {
+            cur_balloon = dom->def->mem.max_balloon;
+        } else if (!qemuCapsGet(priv->caps, QEMU_CAPS_BALLOON_EVENT) &&
+                   mondata->haveBalloon) {
+            cur_balloon = mondata->balloon;
+        }
+    }
+
+    QEMU_ADD_STATS_PARAM(ULLong, record, maxparams,
+                         "balloon.current", cur_balloon);
+    QEMU_ADD_STATS_PARAM(ULLong, record, maxparams,
+                         "balloon.maximum", dom->def->mem.max_balloon);
+
+    return 0;
+}
+
+static int
+qemuDomainGetStatsVcpu(virQEMUDriverPtr driver ATTRIBUTE_UNUSED,
+                       virDomainObjPtr dom,
+                       qemuDomainStatsMonitorDataPtr mondata ATTRIBUTE_UNUSED,
+                       virDomainStatsRecordPtr record,
+                       int *maxparams)
+{
+    qemuDomainObjPrivatePtr priv = dom->privateData;
+    size_t i;
+
+    QEMU_ADD_STATS_PARAM(UInt, record, maxparams,
+                         "vcpu.current", (unsigned) dom->def->vcpus);
+    QEMU_ADD_STATS_PARAM(UInt, record, maxparams,
+                         "vcpu.maximum", (unsigned) dom->def->maxvcpus);
+
+    if (!virDomainObjIsActive(dom) || !priv->vcpupids)
+        return 0;
+
+    for (i = 0; i < priv->nvcpupids; i++) {
+        unsigned long long cpu_time;
+
+        QEMU_ADD_INDEXED_STATS_PARAM(Int, record, maxparams,
+                                     "vcpu", i, "state", VIR_VCPU_RUNNING);
+
+        if (qemuGetProcessInfo(&cpu_time, NULL, NULL,
+                               dom->pid, priv->vcpupids[i]) < 0)
+            continue;
+
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "vcpu", i, "time", cpu_time);
+    }
+
+    return 0;
+}
+
+#ifdef __linux__
+static int
+qemuDomainGetStatsInterface(virQEMUDriverPtr driver ATTRIBUTE_UNUSED,
+                            virDomainObjPtr dom,
+                            qemuDomainStatsMonitorDataPtr mondata ATTRIBUTE_UNUSED,
+                            virDomainStatsRecordPtr record,
+                            int *maxparams)
+{
+    size_t i;
+    size_t n = 0;
+
+    if (!virDomainObjIsActive(dom))
+        return 0;
+
+    /* Interfaces without a host side device have no statistics,
+     * leave them out rather than leaving holes in the numbering */
+    for (i = 0; i < dom->def->nnets; i++) {
+        if (dom->def->nets[i]->ifname)
+            n++;
+    }
+
+    QEMU_ADD_STATS_PARAM(UInt, record, maxparams,
+                         "net.count", (unsigned) n);
+
+    for (i = 0, n = 0; i < dom->def->nnets; i++) {
+        virDomainNetDefPtr net = dom->def->nets[i];
+        struct _virDomainInterfaceStats tmp;
+        size_t idx;
+
+        if (!net->ifname)
+            continue;
+
+        idx = n++;
+
+        QEMU_ADD_INDEXED_STATS_PARAM(String, record, maxparams,
+                                     "net", idx, "name", net->ifname);
+
+        if (linuxDomainInterfaceStats(net->ifname, &tmp) < 0) {
+            virResetLastError();
+            continue;
+        }
+
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "net", idx, "rx.bytes", tmp.rx_bytes);
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "net", idx, "rx.pkts", tmp.rx_packets);
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "net", idx, "rx.errs", tmp.rx_errs);
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "net", idx, "rx.drop", tmp.rx_drop);
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "net", idx, "tx.bytes", tmp.tx_bytes);
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "net", idx, "tx.pkts", tmp.tx_packets);
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "net", idx, "tx.errs", tmp.tx_errs);
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "net", idx, "tx.drop", tmp.tx_drop);
+    }
+
+    return 0;
+}
+#endif
+
+static int
+qemuDomainGetStatsBlock(virQEMUDriverPtr driver ATTRIBUTE_UNUSED,
+                        virDomainObjPtr dom,
+                        qemuDomainStatsMonitorDataPtr mondata,
+                        virDomainStatsRecordPtr record,
+                        int *maxparams)
+{
+    size_t i;
+
+    if (!mondata->blockstats)
+        return 0;
+
+    QEMU_ADD_STATS_PARAM(UInt, record, maxparams,
+                         "block.count", (unsigned) dom->def->ndisks);
+
+    for (i = 0; i < dom->def->ndisks; i++) {
+        virDomainDiskDefPtr disk = dom->def->disks[i];
+        qemuBlockStatsPtr entry;
+
+        QEMU_ADD_INDEXED_STATS_PARAM(String, record, maxparams,
+                                     "block", i, "name", disk->dst);
+
+        if (!disk->info.alias ||
+            !(entry = virHashLookup(mondata->blockstats, disk->info.alias)))
+            continue;
+
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "block", i, "rd.reqs", entry->rd_req);
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "block", i, "rd.bytes", entry->rd_bytes);
+        if (entry->rd_total_times >= 0)
+            QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                         "block", i, "rd.times",
+                                         entry->rd_total_times);
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "block", i, "wr.reqs", entry->wr_req);
+        QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                     "block", i, "wr.bytes", entry->wr_bytes);
+        if (entry->wr_total_times >= 0)
+            QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                         "block", i, "wr.times",
+                                         entry->wr_total_times);
+        if (entry->flush_req >= 0)
+            QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                         "block", i, "fl.reqs",
+                                         entry->flush_req);
+        if (entry->flush_total_times >= 0)
+            QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                         "block", i, "fl.times",
+                                         entry->flush_total_times);
+        if (entry->errs >= 0)
+            QEMU_ADD_INDEXED_STATS_PARAM(ULLong, record, maxparams,
+                                         "block", i, "errs", entry->errs);
+    }
+
+    return 0;
+}
+
+#undef QEMU_ADD_INDEXED_STATS_PARAM
+#undef QEMU_ADD_STATS_PARAM
+
+static struct qemuDomainGetStatsWorker qemuDomainGetStatsWorkers[] = {
+    { qemuDomainGetStatsState, VIR_DOMAIN_STATS_STATE },
+    { qemuDomainGetStatsCpu, VIR_DOMAIN_STATS_CPU_TOTAL },
+    { qemuDomainGetStatsBalloon, VIR_DOMAIN_STATS_BALLOON },
+    { qemuDomainGetStatsVcpu, VIR_DOMAIN_STATS_VCPU },
+#ifdef __linux__
+    { qemuDomainGetStatsInterface, VIR_DOMAIN_STATS_INTERFACE },
+#endif
+    { qemuDomainGetStatsBlock, VIR_DOMAIN_STATS_BLOCK },
+    { NULL, 0 }
+};
+
+static int
+qemuDomainGetStatsCheckSupport(unsigned int *stats,
+                               bool enforce)
+{
+    unsigned int supported = 0;
+    unsigned int unsupported;
+    size_t i;
+
+    for (i = 0; qemuDomainGetStatsWorkers[i].func; i++)
+        supported |= qemuDomainGetStatsWorkers[i].stats;
+
+    if (*stats == 0) {
+        *stats = supported;
+        return 0;
+    }
+
+    unsupported = *stats & ~supported;
+    if (enforce && unsupported) {
+        virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED,
+                       _("Stats types bits 0x%x are not supported by this daemon"),
+                       unsupported);
+        return -1;
+    }
+
+    *stats &= supported;
+    return 0;
+}
+
+/* Query everything the requested stats groups need from the monitor,
+ * holding a single QUERY job for the whole domain. Failures are not
+ * fatal: the affected stats are simply omitted. Returns 0 on success,
+ * or -1 if @dom went away while the job was held. */
+static int
+qemuDomainGetStatsMonitor(virQEMUDriverPtr driver,
+                          virDomainObjPtr dom,
+                          unsigned int stats,
+                          qemuDomainStatsMonitorDataPtr mondata)
+{
+    qemuDomainObjPrivatePtr priv = dom->privateData;
+    qemuMonitorDomainStats monstats;
+    bool needBalloon;
+    bool needBlock;
+
+    if (!virDomainObjIsActive(dom))
+        return 0;
+
+    needBalloon = (stats & VIR_DOMAIN_STATS_BALLOON) &&
+        !(dom->def->memballoon &&
+          dom->def->memballoon->model == VIR_DOMAIN_MEMBALLOON_MODEL_NONE) &&
+        !qemuCapsGet(priv->caps, QEMU_CAPS_BALLOON_EVENT);
+    needBlock = (stats & VIR_DOMAIN_STATS_BLOCK) && dom->def->ndisks > 0;
+
+    if (!needBalloon && !needBlock)
+        return 0;
+
+    /* Don't wait behind a long running job, such as migration */
+    if (!qemuDomainJobAllowed(priv, QEMU_JOB_QUERY))
+        return 0;
+
+    if (qemuDomainObjBeginJob(driver, dom, QEMU_JOB_QUERY) < 0) {
+        virResetLastError();
+        return 0;
+    }
+
+    if (virDomainObjIsActive(dom)) {
+        qemuDomainObjEnterMonitor(driver, dom);
+        ignore_value(qemuMonitorGetDomainStats(priv->mon, needBalloon,
+                                               needBlock, &monstats));
+        qemuDomainObjExitMonitor(driver, dom);
+        mondata->balloon = monstats.balloon;
+        mondata->haveBalloon = monstats.balloonRet > 0;
+        mondata->blockstats = monstats.blockstats;
+        virResetLastError();
+    }
+
+    if (qemuDomainObjEndJob(driver, dom) == 0)
+        return -1;
+
+    return 0;
+}
+
+static int
+qemuDomainGetStats(virConnectPtr conn,
+                   virQEMUDriverPtr driver,
+                   virDomainObjPtr *domptr,
+                   unsigned int stats,
+                   virDomainStatsRecordPtr *record)
+{
+    virDomainObjPtr dom = *domptr;
+    qemuDomainStatsMonitorData mondata;
+    int maxparams = 0;
+    virDomainStatsRecordPtr tmp = NULL;
+    size_t i;
+    int ret = -1;
+
+    memset(&mondata, 0, sizeof(mondata));
+
+    if (qemuDomainGetStatsMonitor(driver, dom, stats, &mondata) < 0) {
+        /* the domain disappeared while we were querying it */
+        *domptr = NULL;
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (VIR_ALLOC(tmp) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    for (i = 0; qemuDomainGetStatsWorkers[i].func; i++) {
+        if (stats & qemuDomainGetStatsWorkers[i].stats) {
+            if (qemuDomainGetStatsWorkers[i].func(driver, dom, &mondata,
+                                                  tmp, &maxparams) < 0)
+                goto cleanup;
+        }
+    }
+
+    if (!(tmp->dom = virGetDomain(conn, dom->def->name, dom->def->uuid)))
+        goto cleanup;
+    tmp->dom->id = dom->def->id;
+
+    *record = tmp;
+    tmp = NULL;
+    ret = 0;
+
+cleanup:
+    virHashFree(mondata.blockstats);
+    if (tmp) {
+        virTypedParamsFree(tmp->params, tmp->nparams);
+        VIR_FREE(tmp);
+    }
+
+    return ret;
+}
+
+static int
+qemuConnectGetAllDomainStats(virConnectPtr conn,
+                             virDomainPtr *doms,
+                             unsigned int ndoms,
+                             unsigned int stats,
+                             virDomainStatsRecordPtr **retStats,
+                             unsigned int flags)
+{
+    virQEMUDriverPtr driver = conn->privateData;
+    virDomainPtr *domlist = NULL;
+    virDomainObjPtr dom = NULL;
+    virDomainStatsRecordPtr *tmpstats = NULL;
+    bool enforce = !!(flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS);
+    int ndomlist = 0;
+    int nstats = 0;
+    size_t i;
+    int ret = -1;
+
+    if (ndoms)
+        virCheckFlags(VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
+    else
+        virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                      VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                      VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE |
+                      VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
+
+    if (qemuDomainGetStatsCheckSupport(&stats, enforce) < 0)
+        return -1;
+
+    if (!ndoms) {
+        unsigned int lflags = flags & (VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                                       VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                                       VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE);
+
+        ndomlist = virDomainList(conn, &driver->domains, &domlist, lflags);
+        if (ndomlist < 0)
+            goto cleanup;
+
+        doms = domlist;
+        ndoms = ndomlist;
+    }
+
+    if (VIR_ALLOC_N(tmpstats, ndoms + 1) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    for (i = 0; i < ndoms; i++) {
+        virDomainStatsRecordPtr tmp = NULL;
+
+        /* The domain may have been undefined since it was listed */
+        if (!(dom = qemuDomObjFromDomain(doms[i]))) {
+            virResetLastError();
+            continue;
+        }
+
+        if (qemuDomainGetStats(conn, driver, &dom, stats, &tmp) < 0)
+            goto cleanup;
+
+        if (dom)
+            virObjectUnlock(dom);
+        dom = NULL;
+
+        if (tmp)
+            tmpstats[nstats++] = tmp;
+    }
+
+    *retStats = tmpstats;
+    tmpstats = NULL;
+    ret = nstats;
+
+cleanup:
+    if (dom)
+        virObjectUnlock(dom);
+    virDomainStatsRecordListFree(tmpstats);
+    if (domlist) {
+        for (i = 0; i < ndoms; i++)
+            virObjectUnref(domlist[i]);
+        VIR_FREE(domlist);
+    }
+
+    return ret;
+}
+
 static virDriver qemuDriver = {
     .no = VIR_DRV_QEMU,
     .name = QEMU_DRIVER_NAME,
@@ -14878,6 +15528,9 @@ static virDriver qemuDriver = {
     .nodeGetCPUMap = nodeGetCPUMap, /* 1.0.0 */
     .domainFSTrim = qemuDomainFSTrim, /* 1.0.1 */
     .domainOpenChannel = qemuDomainOpenChannel, /* 1.0.2 */
+    .connectGetAllDomainStats = qemuConnectGetAllDomainStats, /* 1.0.3 */
+    .domainMigratePrepareTunnelStream = qemuDomainMigratePrepareTunnelStream, /* 1.0.3 */
+    .domainGetJobStats = qemuDomainGetJobStats, /* 1.0.3 */
 };
 
 
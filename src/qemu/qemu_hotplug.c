@@ -92,7 +92,7 @@ int qemuDomainChangeEjectableMedia(virQEMUDriverPtr driver,
         return -1;
     }
 
-    if (virDomainLockDiskAttach(driver->lockManager, driver->uri,
+    if (virDomainLockDiskAttach(driver->lockManager, driver->config->uri,
                                 vm, disk) < 0)
         return -1;
 
@@ -244,7 +244,7 @@ int qemuDomainAttachPciDiskDevice(virConnectPtr conn,
         }
     }
 
-    if (virDomainLockDiskAttach(driver->lockManager, driver->uri,
+    if (virDomainLockDiskAttach(driver->lockManager, driver->config->uri,
                                 vm, disk) < 0)
         return -1;
 
@@ -477,7 +477,7 @@ int qemuDomainAttachSCSIDisk(virConnectPtr conn,
         }
     }
 
-    if (virDomainLockDiskAttach(driver->lockManager, driver->uri,
+    if (virDomainLockDiskAttach(driver->lockManager, driver->config->uri,
                                 vm, disk) < 0)
         return -1;
 
@@ -601,7 +601,7 @@ int qemuDomainAttachUsbMassstorageDevice(virConnectPtr conn,
         }
     }
 
-    if (virDomainLockDiskAttach(driver->lockManager, driver->uri,
+    if (virDomainLockDiskAttach(driver->lockManager, driver->config->uri,
                                 vm, disk) < 0)
         return -1;
 
@@ -738,7 +738,7 @@ int qemuDomainAttachNetDevice(virConnectPtr conn,
          * supported.
          */
         if (actualType == VIR_DOMAIN_NET_TYPE_NETWORK ||
-            driver->privileged ||
+            driver->config->privileged ||
             (!qemuCapsGet(priv->caps, QEMU_CAPS_NETDEV_BRIDGE))) {
             if ((tapfd = qemuNetworkIfaceConnect(vm->def, conn, driver, net,
                                                  priv->caps)) < 0)
@@ -1866,11 +1866,11 @@ qemuDomainChangeGraphics(virQEMUDriverPtr driver,
             STRNEQ_NULLABLE(olddev->data.vnc.auth.passwd,
                             dev->data.vnc.auth.passwd)) {
             VIR_DEBUG("Updating password on VNC server %p %p",
-                      dev->data.vnc.auth.passwd, driver->vncPassword);
+                      dev->data.vnc.auth.passwd, driver->config->vncPassword);
             ret = qemuDomainChangeGraphicsPasswords(driver, vm,
                                                     VIR_DOMAIN_GRAPHICS_TYPE_VNC,
                                                     &dev->data.vnc.auth,
-                                                    driver->vncPassword);
+                                                    driver->config->vncPassword);
             if (ret < 0)
                 return ret;
 
@@ -1926,11 +1926,11 @@ qemuDomainChangeGraphics(virQEMUDriverPtr driver,
             STRNEQ_NULLABLE(olddev->data.spice.auth.passwd,
                             dev->data.spice.auth.passwd)) {
             VIR_DEBUG("Updating password on SPICE server %p %p",
-                      dev->data.spice.auth.passwd, driver->spicePassword);
+                      dev->data.spice.auth.passwd, driver->config->spicePassword);
             ret = qemuDomainChangeGraphicsPasswords(driver, vm,
                                                     VIR_DOMAIN_GRAPHICS_TYPE_SPICE,
                                                     &dev->data.spice.auth,
-                                                    driver->spicePassword);
+                                                    driver->config->spicePassword);
 
             if (ret < 0)
                 return ret;
@@ -2362,7 +2362,7 @@ qemuDomainDetachHostPciDevice(virQEMUDriverPtr driver,
      * reset and reattach device
      */
      if (detach->parent.data.net)
-         qemuDomainHostdevNetConfigRestore(detach, driver->stateDir);
+         qemuDomainHostdevNetConfigRestore(detach, driver->config->stateDir);
 
     pci = pciGetDevice(subsys->u.pci.domain, subsys->u.pci.bus,
                        subsys->u.pci.slot,   subsys->u.pci.function);
@@ -2642,11 +2642,11 @@ qemuDomainDetachNetDevice(virQEMUDriverPtr driver,
                          virDomainNetGetActualDirectDev(detach),
                          virDomainNetGetActualDirectMode(detach),
                          virDomainNetGetActualVirtPortProfile(detach),
-                         driver->stateDir));
+                         driver->config->stateDir));
         VIR_FREE(detach->ifname);
     }
 
-    if ((driver->macFilter) && (detach->ifname != NULL)) {
+    if ((driver->config->macFilter) && (detach->ifname != NULL)) {
         if ((errno = networkDisallowMacOnPort(driver,
                                               detach->ifname,
                                               &detach->mac))) {
@@ -2685,7 +2685,7 @@ qemuDomainChangeGraphicsPasswords(virQEMUDriverPtr driver,
     const char *connected = NULL;
     int ret;
 
-    if (!auth->passwd && !driver->vncPassword)
+    if (!auth->passwd && !driver->config->vncPassword)
         return 0;
 
     if (auth->connected)
@@ -2746,7 +2746,7 @@ int qemuDomainAttachLease(virQEMUDriverPtr driver,
     if (virDomainLeaseInsertPreAlloc(vm->def) < 0)
         return -1;
 
-    if (virDomainLockLeaseAttach(driver->lockManager, driver->uri,
+    if (virDomainLockLeaseAttach(driver->lockManager, driver->config->uri,
                                  vm, lease) < 0) {
         virDomainLeaseInsertPreAlloced(vm->def, NULL);
         return -1;
@@ -31,6 +31,8 @@
 #include <poll.h>
 
 #include "qemu_migration.h"
+#include "qemu_migration_tunnel.h"
+#include "qemu_migration_converge.h"
 #include "qemu_monitor.h"
 #include "qemu_domain.h"
 #include "qemu_process.h"
@@ -274,26 +276,26 @@ qemuMigrationCookieGraphicsAlloc(virQEMUDriverPtr driver,
         mig->port = def->data.vnc.port;
         listenAddr = virDomainGraphicsListenGetAddress(def, 0);
         if (!listenAddr)
-            listenAddr = driver->vncListen;
+            listenAddr = driver->config->vncListen;
 
 #ifdef WITH_GNUTLS
-        if (driver->vncTLS &&
-            !(mig->tlsSubject = qemuDomainExtractTLSSubject(driver->vncTLSx509certdir)))
+        if (driver->config->vncTLS &&
+            !(mig->tlsSubject = qemuDomainExtractTLSSubject(driver->config->vncTLSx509certdir)))
             goto error;
 #endif
     } else {
         mig->port = def->data.spice.port;
-        if (driver->spiceTLS)
+        if (driver->config->spiceTLS)
             mig->tlsPort = def->data.spice.tlsPort;
         else
             mig->tlsPort = -1;
         listenAddr = virDomainGraphicsListenGetAddress(def, 0);
         if (!listenAddr)
-            listenAddr = driver->spiceListen;
+            listenAddr = driver->config->spiceListen;
 
 #ifdef WITH_GNUTLS
-        if (driver->spiceTLS &&
-            !(mig->tlsSubject = qemuDomainExtractTLSSubject(driver->spiceTLSx509certdir)))
+        if (driver->config->spiceTLS &&
+            !(mig->tlsSubject = qemuDomainExtractTLSSubject(driver->config->spiceTLSx509certdir)))
             goto error;
 #endif
     }
@@ -1140,6 +1142,39 @@ qemuMigrationSetOffline(virQEMUDriverPtr driver,
 }
 
 
+static void
+qemuMigrationUpdateJobInfo(virDomainJobInfoPtr info,
+                           qemuMonitorMigrationStatusPtr status)
+{
+    info->memTotal = status->ram_total;
+    info->memRemaining = status->ram_remaining;
+    info->memProcessed = status->ram_transferred;
+
+    info->fileTotal = status->disk_total;
+    info->fileRemaining = status->disk_remaining;
+    info->fileProcessed = status->disk_transferred;
+
+    info->dataTotal = info->memTotal + info->fileTotal;
+    info->dataRemaining = info->memRemaining + info->fileRemaining;
+    info->dataProcessed = info->memProcessed + info->fileProcessed;
+}
+
+
+/* Keep the final statistics of a finished job so that they can still be
+ * queried with VIR_DOMAIN_JOB_STATS_COMPLETED once the job is gone. */
+static void
+qemuMigrationSaveCompletedJob(qemuDomainObjPrivatePtr priv)
+{
+    /* Failing to allocate is not fatal, the job itself succeeded */
+    if (!priv->job.completed &&
+        VIR_ALLOC(priv->job.completed) < 0)
+        return;
+
+    priv->job.completed->info = priv->job.info;
+    priv->job.completed->status = priv->job.status;
+}
+
+
 static int
 qemuMigrationUpdateJobStatus(virQEMUDriverPtr driver,
                              virDomainObjPtr vm,
@@ -1148,12 +1183,9 @@ qemuMigrationUpdateJobStatus(virQEMUDriverPtr driver,
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
     int ret;
-    int status;
     bool wait_for_spice = false;
     bool spice_migrated = false;
-    unsigned long long memProcessed;
-    unsigned long long memRemaining;
-    unsigned long long memTotal;
+    qemuMonitorMigrationStatus status;
 
     /* If guest uses SPICE and supports seamles_migration we have to hold up
      * migration finish until SPICE server transfers its data */
@@ -1167,15 +1199,11 @@ qemuMigrationUpdateJobStatus(virQEMUDriverPtr driver,
         /* Guest already exited; nothing further to update.  */
         return -1;
     }
-    ret = qemuMonitorGetMigrationStatus(priv->mon,
-                                        &status,
-                                        &memProcessed,
-                                        &memRemaining,
-                                        &memTotal);
+    ret = qemuMonitorGetMigrationStatus(priv->mon, &status);
 
     /* If qemu says migrated, check spice */
     if (wait_for_spice && (ret == 0) &&
-        (status == QEMU_MONITOR_MIGRATION_STATUS_COMPLETED))
+        (status.status == QEMU_MONITOR_MIGRATION_STATUS_COMPLETED))
         ret = qemuMonitorGetSpiceMigrationStatus(priv->mon,
                                                  &spice_migrated);
 
@@ -1188,7 +1216,7 @@ qemuMigrationUpdateJobStatus(virQEMUDriverPtr driver,
     priv->job.info.timeElapsed -= priv->job.start;
 
     ret = -1;
-    switch (status) {
+    switch (status.status) {
     case QEMU_MONITOR_MIGRATION_STATUS_INACTIVE:
         priv->job.info.type = VIR_DOMAIN_JOB_NONE;
         virReportError(VIR_ERR_OPERATION_FAILED,
@@ -1200,20 +1228,18 @@ qemuMigrationUpdateJobStatus(virQEMUDriverPtr driver,
         break;
 
     case QEMU_MONITOR_MIGRATION_STATUS_ACTIVE:
-        priv->job.info.dataTotal = memTotal;
-        priv->job.info.dataRemaining = memRemaining;
-        priv->job.info.dataProcessed = memProcessed;
-
-        priv->job.info.memTotal = memTotal;
-        priv->job.info.memRemaining = memRemaining;
-        priv->job.info.memProcessed = memProcessed;
-
+        priv->job.status = status;
+        qemuMigrationUpdateJobInfo(&priv->job.info, &status);
         ret = 0;
         break;
 
     case QEMU_MONITOR_MIGRATION_STATUS_COMPLETED:
-        if ((wait_for_spice && spice_migrated) || (!wait_for_spice))
+        priv->job.status = status;
+        qemuMigrationUpdateJobInfo(&priv->job.info, &status);
+        if ((wait_for_spice && spice_migrated) || (!wait_for_spice)) {
             priv->job.info.type = VIR_DOMAIN_JOB_COMPLETED;
+            qemuMigrationSaveCompletedJob(priv);
+        }
         ret = 0;
         break;
 
@@ -1234,10 +1260,119 @@ qemuMigrationUpdateJobStatus(virQEMUDriverPtr driver,
 }
 
 
+static void
+qemuMigrationConvergeInit(virQEMUDriverPtr driver,
+                          virDomainObjPtr vm,
+                          qemuMigrationConvergePtr converge,
+                          unsigned long speed)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    memset(converge, 0, sizeof(*converge));
+    converge->speed = speed;
+    converge->maxSpeed = driver->config->migrationConvergeMaxSpeed;
+    /* @speed may come from the migration call rather than
+     * virDomainMigrateSetMaxSpeed; only a later change overrides it */
+    converge->userSpeed = priv->migMaxBandwidth;
+    converge->downtime = QEMU_MIGRATION_CONVERGE_DOWNTIME;
+    converge->maxDowntime = driver->config->migrationConvergeMaxDowntime;
+    qemuMigrationConvergeUserLimits(converge, priv->migMaxBandwidth,
+                                    priv->job.migMaxDowntime);
+}
+
+
+static void
+qemuMigrationConvergeStep(virQEMUDriverPtr driver,
+                          virDomainObjPtr vm,
+                          qemuMigrationConvergePtr converge,
+                          unsigned long long dirtyRate)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuMonitorMigrationStatusPtr status = &priv->job.status;
+    virDomainEventPtr event;
+    unsigned long speed = 0;
+    unsigned long long downtime = 0;
+    int rc;
+
+    /* Either may have been changed while the migration was running */
+    qemuMigrationConvergeUserLimits(converge, priv->migMaxBandwidth,
+                                    priv->job.migMaxDowntime);
+
+    switch (qemuMigrationConvergeNext(converge, &speed, &downtime)) {
+    case QEMU_MIGRATION_CONVERGE_STEP_SPEED:
+        VIR_DEBUG("Migration of %s is stalled, raising speed to %luMiB/s",
+                  vm->def->name, speed);
+        if (qemuDomainObjEnterMonitorAsync(driver, vm,
+                                           QEMU_ASYNC_JOB_MIGRATION_OUT) < 0)
+            return;
+        rc = qemuMonitorSetMigrationSpeed(priv->mon, speed);
+        qemuDomainObjExitMonitorWithDriver(driver, vm);
+
+        if (rc < 0)
+            VIR_WARN("Unable to raise migration speed of %s", vm->def->name);
+        else
+            converge->speed = speed;
+        break;
+
+    case QEMU_MIGRATION_CONVERGE_STEP_DOWNTIME:
+        VIR_DEBUG("Migration of %s is stalled, raising downtime to %llums",
+                  vm->def->name, downtime);
+        if (qemuDomainObjEnterMonitorAsync(driver, vm,
+                                           QEMU_ASYNC_JOB_MIGRATION_OUT) < 0)
+            return;
+        rc = qemuMonitorSetMigrationDowntime(priv->mon, downtime);
+        qemuDomainObjExitMonitorWithDriver(driver, vm);
+
+        if (rc < 0)
+            VIR_WARN("Unable to raise migration downtime of %s",
+                     vm->def->name);
+        else
+            converge->downtime = downtime;
+        break;
+
+    case QEMU_MIGRATION_CONVERGE_STEP_REPORT:
+        VIR_DEBUG("Migration of %s is stalled at the configured limits",
+                  vm->def->name);
+        event = virDomainEventMigrationStalledNewFromObj(vm,
+                                                         status->ram_iteration,
+                                                         dirtyRate,
+                                                         status->ram_bps);
+        if (event)
+            qemuDomainEventQueue(driver, event);
+        converge->reported = true;
+        break;
+
+    case QEMU_MIGRATION_CONVERGE_STEP_NONE:
+        break;
+    }
+}
+
+
+/* Called after each poll of a migration started with
+ * VIR_MIGRATE_AUTO_CONVERGE */
+static void
+qemuMigrationConvergeCheck(virQEMUDriverPtr driver,
+                           virDomainObjPtr vm,
+                           qemuMigrationConvergePtr converge)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    unsigned long long now;
+    unsigned long long dirtyRate;
+
+    if (virTimeMillisNow(&now) < 0)
+        return;
+
+    if (qemuMigrationConvergeStalled(converge, &priv->job.status,
+                                     now, &dirtyRate))
+        qemuMigrationConvergeStep(driver, vm, converge, dirtyRate);
+}
+
+
 static int
 qemuMigrationWaitForCompletion(virQEMUDriverPtr driver, virDomainObjPtr vm,
                                enum qemuDomainAsyncJob asyncJob,
-                               virConnectPtr dconn)
+                               virConnectPtr dconn,
+                               qemuMigrationConvergePtr converge)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
     const char *job;
@@ -1265,6 +1400,9 @@ qemuMigrationWaitForCompletion(virQEMUDriverPtr driver, virDomainObjPtr vm,
         if (qemuMigrationUpdateJobStatus(driver, vm, job, asyncJob) < 0)
             goto cleanup;
 
+        if (converge && priv->job.info.type == VIR_DOMAIN_JOB_UNBOUNDED)
+            qemuMigrationConvergeCheck(driver, vm, converge);
+
         if (dconn && virConnectIsAlive(dconn) <= 0) {
             virReportError(VIR_ERR_OPERATION_FAILED, "%s",
                            _("Lost connection to destination host"));
@@ -1511,6 +1649,350 @@ cleanup:
 }
 
 
+#define TUNNEL_SEND_BUF_SIZE 65536
+
+/* The destination side of a parallel tunnel. A thread reads at most
+ * one chunk ahead from each stream and writes the chunks to QEMU in
+ * order, so a stream which is ahead of the others is not read from
+ * until they have caught up.
+ */
+struct _qemuMigrationTunnelIn {
+    virMutex lock;
+    virThread thread;
+    int qemufd;
+    int wakeupRecvFD;
+    int wakeupSendFD;
+
+    size_t nstreams;
+    qemuMigrationTunnelInStreamPtr streams;
+
+    unsigned long long next;    /* sequence number QEMU needs next */
+    bool done;
+    bool quit;
+    virError err;
+};
+
+
+static void
+qemuMigrationTunnelInFunc(void *opaque)
+{
+    qemuMigrationTunnelInPtr tin = opaque;
+    struct pollfd *fds = NULL;
+    size_t *idx = NULL;
+    size_t nfds;
+    size_t i;
+
+    virMutexLock(&tin->lock);
+
+    for (;;) {
+        int ret;
+
+        if (qemuMigrationTunnelInStreamsFlush(tin->streams, tin->nstreams,
+                                              tin->qemufd, &tin->next,
+                                              &tin->done) < 0)
+            goto error;
+        if (tin->done)
+            break;
+
+        if (VIR_REALLOC_N(fds, tin->nstreams + 1) < 0 ||
+            VIR_REALLOC_N(idx, tin->nstreams + 1) < 0) {
+            virReportOOMError();
+            goto error;
+        }
+
+        fds[0].fd = tin->wakeupRecvFD;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        nfds = 1;
+
+        /* Streams with a chunk waiting are not polled: that's where
+         * the flow control of the whole tunnel comes from */
+        for (i = 0; i < tin->nstreams; i++) {
+            if (tin->streams[i].ready || tin->streams[i].eof)
+                continue;
+            fds[nfds].fd = tin->streams[i].fd;
+            fds[nfds].events = POLLIN;
+            fds[nfds].revents = 0;
+            idx[nfds] = i;
+            nfds++;
+        }
+
+        if (nfds == 1 && tin->nstreams > 0) {
+            virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                           _("tunnelled migration streams ended before "
+                             "all data arrived"));
+            goto error;
+        }
+
+        virMutexUnlock(&tin->lock);
+        ret = poll(fds, nfds, -1);
+        virMutexLock(&tin->lock);
+
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            virReportSystemError(errno, "%s",
+                                 _("poll failed in migration tunnel"));
+            goto error;
+        }
+
+        if (fds[0].revents & (POLLIN | POLLERR | POLLHUP)) {
+            char c;
+
+            if (saferead(tin->wakeupRecvFD, &c, 1) != 1) {
+                virReportSystemError(errno, "%s",
+                                     _("failed to read from wakeup fd"));
+                goto error;
+            }
+            if (tin->quit) {
+                VIR_DEBUG("Migration tunnel was asked to abort");
+                goto cleanup;
+            }
+        }
+
+        for (i = 1; i < nfds; i++) {
+            if (!(fds[i].revents & (POLLIN | POLLERR | POLLHUP)))
+                continue;
+            if (qemuMigrationTunnelInStreamRead(&tin->streams[idx[i]]) < 0)
+                goto error;
+        }
+    }
+
+    VIR_DEBUG("Migration tunnel delivered %llu chunks", tin->next);
+
+cleanup:
+    /* Let QEMU see the end of the data, and the streams a broken
+     * pipe if they had more to say */
+    VIR_FORCE_CLOSE(tin->qemufd);
+    for (i = 0; i < tin->nstreams; i++)
+        VIR_FORCE_CLOSE(tin->streams[i].fd);
+    virMutexUnlock(&tin->lock);
+    VIR_FREE(fds);
+    VIR_FREE(idx);
+    return;
+
+error:
+    virCopyLastError(&tin->err);
+    virResetLastError();
+    goto cleanup;
+}
+
+
+static int
+qemuMigrationTunnelInAddStream(qemuMigrationTunnelInPtr tin,
+                               virStreamPtr st)
+{
+    int pipeFD[2] = { -1, -1 };
+    char *data = NULL;
+    char c = 0;
+    int ret = -1;
+
+    if (VIR_ALLOC_N(data, QEMU_MIGRATION_TUNNEL_CHUNK_MAX) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    if (pipe2(pipeFD, O_CLOEXEC) < 0 ||
+        virSetNonBlock(pipeFD[0]) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot create pipe for tunnelled migration"));
+        goto cleanup;
+    }
+
+    if (virFDStreamOpen(st, pipeFD[1]) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot pass pipe for tunnelled migration"));
+        goto cleanup;
+    }
+    pipeFD[1] = -1; /* 'st' owns the FD now & will close it */
+
+    virMutexLock(&tin->lock);
+    if (tin->done || tin->quit) {
+        virMutexUnlock(&tin->lock);
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("tunnelled migration is already over"));
+        goto cleanup;
+    }
+    if (tin->nstreams >= QEMU_MIGRATION_TUNNEL_STREAMS_MAX) {
+        virMutexUnlock(&tin->lock);
+        virReportError(VIR_ERR_OPERATION_INVALID,
+                       _("tunnelled migration cannot use more than "
+                         "%d streams"), QEMU_MIGRATION_TUNNEL_STREAMS_MAX);
+        goto cleanup;
+    }
+    if (VIR_EXPAND_N(tin->streams, tin->nstreams, 1) < 0) {
+        virMutexUnlock(&tin->lock);
+        virReportOOMError();
+        goto cleanup;
+    }
+    tin->streams[tin->nstreams - 1].fd = pipeFD[0];
+    tin->streams[tin->nstreams - 1].data = data;
+    pipeFD[0] = -1;
+    data = NULL;
+    virMutexUnlock(&tin->lock);
+
+    /* Make the thread poll the new stream too */
+    if (safewrite(tin->wakeupSendFD, &c, 1) != 1) {
+        virReportSystemError(errno, "%s",
+                             _("failed to wakeup migration tunnel"));
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    VIR_FORCE_CLOSE(pipeFD[0]);
+    VIR_FORCE_CLOSE(pipeFD[1]);
+    VIR_FREE(data);
+    return ret;
+}
+
+
+static void
+qemuMigrationTunnelInFree(qemuMigrationTunnelInPtr tin)
+{
+    size_t i;
+
+    if (!tin)
+        return;
+
+    for (i = 0; i < tin->nstreams; i++) {
+        VIR_FORCE_CLOSE(tin->streams[i].fd);
+        VIR_FREE(tin->streams[i].data);
+    }
+    VIR_FREE(tin->streams);
+    VIR_FORCE_CLOSE(tin->qemufd);
+    VIR_FORCE_CLOSE(tin->wakeupRecvFD);
+    VIR_FORCE_CLOSE(tin->wakeupSendFD);
+    virResetError(&tin->err);
+    virMutexDestroy(&tin->lock);
+    VIR_FREE(tin);
+}
+
+
+/* Starts reassembling the data coming over @st, and the streams
+ * attached later with qemuMigrationPrepareTunnelStream, into @qemufd.
+ * On success, @qemufd is owned by the tunnel.
+ */
+static int
+qemuMigrationStartTunnelIn(virDomainObjPtr vm,
+                           virStreamPtr st,
+                           int qemufd)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuMigrationTunnelInPtr tin = NULL;
+    int wakeupFD[2] = { -1, -1 };
+
+    if (VIR_ALLOC(tin) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+    tin->qemufd = -1;
+    tin->wakeupRecvFD = -1;
+    tin->wakeupSendFD = -1;
+
+    if (virMutexInit(&tin->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        VIR_FREE(tin);
+        return -1;
+    }
+
+    if (pipe2(wakeupFD, O_CLOEXEC) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to make pipe"));
+        goto error;
+    }
+    tin->wakeupRecvFD = wakeupFD[0];
+    tin->wakeupSendFD = wakeupFD[1];
+
+    if (qemuMigrationTunnelInAddStream(tin, st) < 0)
+        goto error;
+
+    tin->qemufd = qemufd;
+    if (virThreadCreate(&tin->thread, true,
+                        qemuMigrationTunnelInFunc, tin) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to create migration thread"));
+        tin->qemufd = -1;
+        goto error;
+    }
+
+    priv->migTunnel = tin;
+    return 0;
+
+error:
+    qemuMigrationTunnelInFree(tin);
+    return -1;
+}
+
+
+/* Waits until all data of a parallel tunnel reached QEMU, or tells
+ * the tunnel to give up if @cancel is true.
+ */
+static int
+qemuMigrationStopTunnelIn(virDomainObjPtr vm,
+                          bool cancel)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuMigrationTunnelInPtr tin = priv->migTunnel;
+    int ret = 0;
+
+    if (!tin)
+        return 0;
+    priv->migTunnel = NULL;
+
+    if (cancel) {
+        char c = 0;
+
+        virMutexLock(&tin->lock);
+        tin->quit = true;
+        virMutexUnlock(&tin->lock);
+
+        if (safewrite(tin->wakeupSendFD, &c, 1) != 1) {
+            /* Without a way to wake the thread up, there's no
+             * telling when it would finish */
+            VIR_ERROR(_("Failed to wakeup migration tunnel of domain %s"),
+                      vm->def->name);
+            return -1;
+        }
+    }
+
+    virThreadJoin(&tin->thread);
+
+    if (!cancel && tin->err.code != VIR_ERR_OK) {
+        virSetError(&tin->err);
+        ret = -1;
+    }
+
+    qemuMigrationTunnelInFree(tin);
+    return ret;
+}
+
+
+int
+qemuMigrationPrepareTunnelStream(virQEMUDriverPtr driver,
+                                 virDomainObjPtr vm,
+                                 virStreamPtr st)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    VIR_DEBUG("driver=%p, vm=%s, st=%p", driver, vm->def->name, st);
+
+    if (!qemuMigrationJobIsActive(vm, QEMU_ASYNC_JOB_MIGRATION_IN))
+        return -1;
+
+    if (!priv->migTunnel) {
+        virReportError(VIR_ERR_OPERATION_INVALID,
+                       _("domain '%s' is not processing parallel tunnelled "
+                         "migration"), vm->def->name);
+        return -1;
+    }
+
+    return qemuMigrationTunnelInAddStream(priv->migTunnel, st);
+}
+
+
 /* Prepare is the first step, and it runs on the destination host.
  */
 
@@ -1526,6 +2008,8 @@ qemuMigrationPrepareCleanup(virQEMUDriverPtr driver,
               qemuDomainJobTypeToString(priv->job.active),
               qemuDomainAsyncJobTypeToString(priv->job.asyncJob));
 
+    qemuMigrationStopTunnelIn(vm, true);
+
     if (!qemuMigrationJobIsActive(vm, QEMU_ASYNC_JOB_MIGRATION_IN))
         return;
     qemuDomainObjDiscardAsyncJob(driver, vm);
@@ -1663,7 +2147,7 @@ qemuMigrationPrepareAny(virQEMUDriverPtr driver,
     qemuMigrationJobSetPhase(driver, vm, QEMU_MIGRATION_PHASE_PREPARE);
 
     /* Domain starts inactive, even if the domain XML had an id field. */
-    vm->def->id = -1;
+    virDomainObjListSetID(&driver->domains, vm, -1);
 
     if (flags & VIR_MIGRATE_OFFLINE)
         goto done;
@@ -1689,7 +2173,14 @@ qemuMigrationPrepareAny(virQEMUDriverPtr driver,
         goto endjob;
     }
 
-    if (tunnel) {
+    if (tunnel && (flags & VIR_MIGRATE_PARALLEL)) {
+        if (qemuMigrationStartTunnelIn(vm, st, dataFD[1]) < 0) {
+            virDomainAuditStart(vm, "migrated", false);
+            qemuProcessStop(driver, vm, VIR_DOMAIN_SHUTOFF_FAILED, 0);
+            goto endjob;
+        }
+        dataFD[1] = -1; /* the tunnel owns the FD now & will close it */
+    } else if (tunnel) {
         if (virFDStreamOpen(st, dataFD[1]) < 0) {
             virReportSystemError(errno, "%s",
                                  _("cannot pass pipe for tunnelled migration"));
@@ -1765,6 +2256,7 @@ cleanup:
     return ret;
 
 endjob:
+    qemuMigrationStopTunnelIn(vm, true);
     if (!qemuMigrationJobFinish(driver, vm)) {
         vm = NULL;
     }
@@ -1976,6 +2468,7 @@ enum qemuMigrationDestinationType {
 enum qemuMigrationForwardType {
     MIGRATION_FWD_DIRECT,
     MIGRATION_FWD_STREAM,
+    MIGRATION_FWD_STREAMS,
 };
 
 typedef struct _qemuMigrationSpec qemuMigrationSpec;
@@ -2003,13 +2496,26 @@ struct _qemuMigrationSpec {
     enum qemuMigrationForwardType fwdType;
     union {
         virStreamPtr stream;
+
+        struct {
+            virStreamPtr *st;
+            size_t nst;
+        } streams;
     } fwd;
 };
 
-#define TUNNEL_SEND_BUF_SIZE 65536
-
 typedef struct _qemuMigrationIOThread qemuMigrationIOThread;
 typedef qemuMigrationIOThread *qemuMigrationIOThreadPtr;
+
+typedef struct _qemuMigrationIOWorker qemuMigrationIOWorker;
+typedef qemuMigrationIOWorker *qemuMigrationIOWorkerPtr;
+struct _qemuMigrationIOWorker {
+    qemuMigrationIOThreadPtr io;
+    virThread thread;
+    virStreamPtr st;
+    virError err;
+};
+
 struct _qemuMigrationIOThread {
     virThread thread;
     virStreamPtr st;
@@ -2017,6 +2523,17 @@ struct _qemuMigrationIOThread {
     virError err;
     int wakeupRecvFD;
     int wakeupSendFD;
+
+    /* Parallel tunnel: each worker sends the chunks it reads from
+     * @sock over its own stream. @lock makes reading a chunk and
+     * numbering it atomic. */
+    virMutex lock;
+    size_t nworkers;
+    qemuMigrationIOWorkerPtr workers;
+    unsigned long long seq;
+    bool eof;
+    bool failed;
+    int stop;                   /* -1 running, 0 finish, 1 abort */
 };
 
 static void qemuMigrationIOFunc(void *arg)
@@ -2125,12 +2642,149 @@ error:
 }
 
 
+/* Tells the other workers of a parallel tunnel to give up. The
+ * wakeup byte is left in the pipe so that all of them see it.
+ */
+static void
+qemuMigrationIOFail(qemuMigrationIOThreadPtr io)
+{
+    char stop = 1;
+
+    virMutexLock(&io->lock);
+    io->failed = true;
+    virMutexUnlock(&io->lock);
+
+    ignore_value(safewrite(io->wakeupSendFD, &stop, 1));
+}
+
+static void qemuMigrationIOParallelFunc(void *arg)
+{
+    qemuMigrationIOWorkerPtr worker = arg;
+    qemuMigrationIOThreadPtr io = worker->io;
+    char *buffer = NULL;
+    struct pollfd fds[2];
+    virErrorPtr err = NULL;
+
+    VIR_DEBUG("Running migration tunnel worker; stream=%p, sock=%d",
+              worker->st, io->sock);
+
+    if (VIR_ALLOC_N(buffer, QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE +
+                            QEMU_MIGRATION_TUNNEL_CHUNK_MAX) < 0) {
+        virReportOOMError();
+        goto abrt;
+    }
+
+    fds[0].fd = io->sock;
+    fds[1].fd = io->wakeupRecvFD;
+
+    for (;;) {
+        unsigned long long seq;
+        ssize_t nbytes;
+        int ret;
+
+        fds[0].events = fds[1].events = POLLIN;
+        fds[0].revents = fds[1].revents = 0;
+
+        ret = poll(fds, ARRAY_CARDINALITY(fds), -1);
+
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            virReportSystemError(errno, "%s",
+                                 _("poll failed in migration tunnel"));
+            goto abrt;
+        }
+
+        virMutexLock(&io->lock);
+
+        if (io->stop > 0 || io->failed) {
+            virMutexUnlock(&io->lock);
+            goto abrt;
+        }
+
+        /* Whoever saw the end of the data already sent the end marker */
+        if (io->eof) {
+            virMutexUnlock(&io->lock);
+            break;
+        }
+
+        if (fds[0].revents & (POLLIN | POLLERR | POLLHUP)) {
+            nbytes = read(io->sock,
+                          buffer + QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE,
+                          QEMU_MIGRATION_TUNNEL_CHUNK_MAX);
+            if (nbytes < 0) {
+                virMutexUnlock(&io->lock);
+                /* Another worker took the data we were woken up for */
+                if (errno == EAGAIN || errno == EINTR)
+                    continue;
+                virReportSystemError(errno, "%s",
+                        _("tunnelled migration failed to read from qemu"));
+                goto abrt;
+            }
+        } else if (io->stop == 0) {
+            /* We were asked to finish and there's nothing left to
+             * read, see qemuMigrationIOFunc */
+            nbytes = 0;
+        } else {
+            virMutexUnlock(&io->lock);
+            continue;
+        }
+
+        if (nbytes == 0)
+            io->eof = true;
+        seq = io->seq++;
+        virMutexUnlock(&io->lock);
+
+        qemuMigrationTunnelEncodeHeader(buffer, seq, nbytes);
+        if (virStreamSend(worker->st, buffer,
+                          QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE + nbytes) < 0)
+            goto error;
+
+        if (nbytes == 0) {
+            VIR_DEBUG("Migration tunnel sent %llu chunks", seq);
+            break;
+        }
+    }
+
+    if (virStreamFinish(worker->st) < 0)
+        goto error;
+
+    VIR_FREE(buffer);
+
+    return;
+
+abrt:
+    err = virSaveLastError();
+    if (err && err->code == VIR_ERR_OK) {
+        virFreeError(err);
+        err = NULL;
+    }
+    virStreamAbort(worker->st);
+    if (err) {
+        virSetError(err);
+        virFreeError(err);
+    }
+
+error:
+    qemuMigrationIOFail(io);
+    virCopyLastError(&worker->err);
+    virResetLastError();
+    VIR_FREE(buffer);
+}
+
+
+/* Forwards the data QEMU writes to @sock over @streams. A single
+ * stream gets the data as it is; several streams get it in numbered
+ * chunks for the destination to put back in order.
+ */
 static qemuMigrationIOThreadPtr
-qemuMigrationStartTunnel(virStreamPtr st,
+qemuMigrationStartTunnel(virStreamPtr *streams,
+                         size_t nstreams,
                          int sock)
 {
     qemuMigrationIOThreadPtr io = NULL;
     int wakeupFD[2] = { -1, -1 };
+    size_t i;
 
     if (pipe2(wakeupFD, O_CLOEXEC) < 0) {
         virReportSystemError(errno, "%s",
@@ -2141,19 +2795,62 @@ qemuMigrationStartTunnel(virStreamPtr st,
     if (VIR_ALLOC(io) < 0)
         goto no_memory;
 
-    io->st = st;
+    io->st = streams[0];
     io->sock = sock;
     io->wakeupRecvFD = wakeupFD[0];
     io->wakeupSendFD = wakeupFD[1];
 
-    if (virThreadCreate(&io->thread, true,
-                        qemuMigrationIOFunc,
-                        io) < 0) {
+    if (nstreams == 1) {
+        if (virThreadCreate(&io->thread, true,
+                            qemuMigrationIOFunc,
+                            io) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("Unable to create migration thread"));
+            goto error;
+        }
+        return io;
+    }
+
+    /* Workers must not block reading data another one took */
+    if (virSetNonBlock(sock) < 0) {
         virReportSystemError(errno, "%s",
-                             _("Unable to create migration thread"));
+                             _("Unable to set migration socket non-blocking"));
         goto error;
     }
 
+    if (virMutexInit(&io->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        goto error;
+    }
+    io->stop = -1;
+
+    if (VIR_ALLOC_N(io->workers, nstreams) < 0) {
+        virMutexDestroy(&io->lock);
+        goto no_memory;
+    }
+
+    for (i = 0; i < nstreams; i++) {
+        io->workers[i].io = io;
+        io->workers[i].st = streams[i];
+
+        if (virThreadCreate(&io->workers[i].thread, true,
+                            qemuMigrationIOParallelFunc,
+                            &io->workers[i]) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("Unable to create migration thread"));
+            qemuMigrationIOFail(io);
+            while (i-- > 0) {
+                virThreadJoin(&io->workers[i].thread);
+                virResetError(&io->workers[i].err);
+            }
+            virMutexDestroy(&io->lock);
+            VIR_FREE(io->workers);
+            goto error;
+        }
+        io->nworkers++;
+    }
+
     return io;
 
 no_memory:
@@ -2170,6 +2867,14 @@ qemuMigrationStopTunnel(qemuMigrationIOThreadPtr io, bool error)
 {
     int rv = -1;
     char stop = error ? 1 : 0;
+    virErrorPtr err = &io->err;
+    size_t i;
+
+    if (io->nworkers) {
+        virMutexLock(&io->lock);
+        io->stop = stop;
+        virMutexUnlock(&io->lock);
+    }
 
     /* make sure the thread finishes its job and is joinable */
     if (safewrite(io->wakeupSendFD, &stop, 1) != 1) {
@@ -2178,21 +2883,36 @@ qemuMigrationStopTunnel(qemuMigrationIOThreadPtr io, bool error)
         goto cleanup;
     }
 
-    virThreadJoin(&io->thread);
+    if (io->nworkers) {
+        /* Report a single failure, the others are usually just
+         * workers giving up because of it */
+        for (i = 0; i < io->nworkers; i++) {
+            virThreadJoin(&io->workers[i].thread);
+            if (err->code == VIR_ERR_OK)
+                err = &io->workers[i].err;
+        }
+    } else {
+        virThreadJoin(&io->thread);
+    }
 
     /* Forward error from the IO thread, to this thread */
-    if (io->err.code != VIR_ERR_OK) {
+    if (err->code != VIR_ERR_OK) {
         if (error)
             rv = 0;
         else
-            virSetError(&io->err);
-        virResetError(&io->err);
+            virSetError(err);
         goto cleanup;
     }
 
     rv = 0;
 
 cleanup:
+    virResetError(&io->err);
+    for (i = 0; i < io->nworkers; i++)
+        virResetError(&io->workers[i].err);
+    if (io->nworkers)
+        virMutexDestroy(&io->lock);
+    VIR_FREE(io->workers);
     VIR_FORCE_CLOSE(io->wakeupSendFD);
     VIR_FORCE_CLOSE(io->wakeupRecvFD);
     VIR_FREE(io);
@@ -2257,6 +2977,7 @@ qemuMigrationRun(virQEMUDriverPtr driver,
     int fd = -1;
     unsigned long migrate_speed = resource ? resource : priv->migMaxBandwidth;
     virErrorPtr orig_err = NULL;
+    qemuMigrationConverge converge;
 
     VIR_DEBUG("driver=%p, vm=%p, cookiein=%s, cookieinlen=%d, "
               "cookieout=%p, cookieoutlen=%p, flags=%lx, resource=%lu, "
@@ -2387,13 +3108,22 @@ qemuMigrationRun(virQEMUDriverPtr driver,
         }
     }
 
-    if (spec->fwdType != MIGRATION_FWD_DIRECT &&
-        !(iothread = qemuMigrationStartTunnel(spec->fwd.stream, fd)))
+    if (spec->fwdType == MIGRATION_FWD_STREAM &&
+        !(iothread = qemuMigrationStartTunnel(&spec->fwd.stream, 1, fd)))
+        goto cancel;
+    if (spec->fwdType == MIGRATION_FWD_STREAMS &&
+        !(iothread = qemuMigrationStartTunnel(spec->fwd.streams.st,
+                                              spec->fwd.streams.nst, fd)))
         goto cancel;
 
+    if (flags & VIR_MIGRATE_AUTO_CONVERGE)
+        qemuMigrationConvergeInit(driver, vm, &converge, migrate_speed);
+
     if (qemuMigrationWaitForCompletion(driver, vm,
                                        QEMU_ASYNC_JOB_MIGRATION_OUT,
-                                       dconn) < 0)
+                                       dconn,
+                                       (flags & VIR_MIGRATE_AUTO_CONVERGE) ?
+                                       &converge : NULL) < 0)
         goto cleanup;
 
     /* When migration completed, QEMU will have paused the
@@ -2546,7 +3276,8 @@ static int doNativeMigrate(virQEMUDriverPtr driver,
 
 static int doTunnelMigrate(virQEMUDriverPtr driver,
                            virDomainObjPtr vm,
-                           virStreamPtr st,
+                           virStreamPtr *streams,
+                           size_t nstreams,
                            const char *cookiein,
                            int cookieinlen,
                            char **cookieout,
@@ -2560,9 +3291,10 @@ static int doTunnelMigrate(virQEMUDriverPtr driver,
     int ret = -1;
     qemuMigrationSpec spec;
 
-    VIR_DEBUG("driver=%p, vm=%p, st=%p, cookiein=%s, cookieinlen=%d, "
-              "cookieout=%p, cookieoutlen=%p, flags=%lx, resource=%lu",
-              driver, vm, st, NULLSTR(cookiein), cookieinlen,
+    VIR_DEBUG("driver=%p, vm=%p, streams=%p, nstreams=%zu, cookiein=%s, "
+              "cookieinlen=%d, cookieout=%p, cookieoutlen=%p, flags=%lx, "
+              "resource=%lu",
+              driver, vm, streams, nstreams, NULLSTR(cookiein), cookieinlen,
               cookieout, cookieoutlen, flags, resource);
 
     if (!qemuCapsGet(priv->caps, QEMU_CAPS_MIGRATE_QEMU_FD) &&
@@ -2573,8 +3305,14 @@ static int doTunnelMigrate(virQEMUDriverPtr driver,
         return -1;
     }
 
-    spec.fwdType = MIGRATION_FWD_STREAM;
-    spec.fwd.stream = st;
+    if (nstreams > 1) {
+        spec.fwdType = MIGRATION_FWD_STREAMS;
+        spec.fwd.streams.st = streams;
+        spec.fwd.streams.nst = nstreams;
+    } else {
+        spec.fwdType = MIGRATION_FWD_STREAM;
+        spec.fwd.stream = streams[0];
+    }
 
     if (qemuCapsGet(priv->caps, QEMU_CAPS_MIGRATE_QEMU_FD)) {
         int fds[2];
@@ -2601,13 +3339,13 @@ static int doTunnelMigrate(virQEMUDriverPtr driver,
 
         if (virAsprintf(&spec.dest.unix_socket.file,
                         "%s/qemu.tunnelmigrate.src.%s",
-                        driver->libDir, vm->def->name) < 0) {
+                        driver->config->libDir, vm->def->name) < 0) {
             virReportOOMError();
             goto cleanup;
         }
 
         if (virNetSocketNewListenUNIX(spec.dest.unix_socket.file, 0700,
-                                      driver->user, driver->group,
+                                      driver->config->user, driver->config->group,
                                       &sock) < 0 ||
             virNetSocketListen(sock, 1) < 0)
             goto cleanup;
@@ -2631,6 +3369,89 @@ cleanup:
 }
 
 
+/* Flags of the stream carrying a tunnelled migration */
+static unsigned int
+qemuMigrationStreamFlags(unsigned long flags)
+{
+    return (flags & VIR_MIGRATE_COMPRESSED) ? VIR_STREAM_COMPRESS : 0;
+}
+
+
+/* Opens the connections to @dconnuri which carry the additional
+ * streams of a parallel tunnel, and attaches the streams to the
+ * incoming migration of @dname. @streams must already hold the
+ * stream of the main connection; @conns[i] carries @streams[i]
+ * for all i > 0. The arrays must have room for
+ * QEMU_MIGRATION_TUNNEL_STREAMS_MAX items.
+ */
+static int
+qemuMigrationOpenTunnelStreams(virQEMUDriverPtr driver,
+                               virDomainObjPtr vm,
+                               const char *dconnuri,
+                               const char *dname,
+                               unsigned long flags,
+                               virConnectPtr *conns,
+                               virStreamPtr *streams,
+                               size_t *nstreams)
+{
+    while (*nstreams < driver->config->migrationTunnelStreams) {
+        virConnectPtr conn;
+        virStreamPtr st;
+        int rc;
+
+        qemuDomainObjEnterRemoteWithDriver(driver, vm);
+        conn = virConnectOpen(dconnuri);
+        qemuDomainObjExitRemoteWithDriver(driver, vm);
+        if (conn == NULL) {
+            virReportError(VIR_ERR_OPERATION_FAILED,
+                           _("Failed to connect to remote libvirt URI %s"),
+                           dconnuri);
+            return -1;
+        }
+
+        if (virConnectSetKeepAlive(conn, driver->config->keepAliveInterval,
+                                   driver->config->keepAliveCount) < 0 ||
+            !(st = virStreamNew(conn, qemuMigrationStreamFlags(flags)))) {
+            virConnectClose(conn);
+            return -1;
+        }
+
+        conns[*nstreams] = conn;
+        streams[*nstreams] = st;
+        (*nstreams)++;
+
+        qemuDomainObjEnterRemoteWithDriver(driver, vm);
+        rc = conn->driver->domainMigratePrepareTunnelStream(conn, st,
+                                                            dname, 0);
+        qemuDomainObjExitRemoteWithDriver(driver, vm);
+        if (rc < 0)
+            return -1;
+    }
+
+    VIR_DEBUG("Tunnelled migration of %s uses %zu streams",
+              vm->def->name, *nstreams);
+    return 0;
+}
+
+
+static void
+qemuMigrationCloseTunnelStreams(virQEMUDriverPtr driver,
+                                virDomainObjPtr vm,
+                                virConnectPtr *conns,
+                                virStreamPtr *streams,
+                                size_t nstreams)
+{
+    size_t i;
+
+    for (i = 1; i < nstreams; i++) {
+        virObjectUnref(streams[i]);
+        qemuDomainObjEnterRemoteWithDriver(driver, vm);
+        virConnectClose(conns[i]);
+        qemuDomainObjExitRemoteWithDriver(driver, vm);
+    }
+}
+
+
 /* This is essentially a re-impl of virDomainMigrateVersion2
  * from libvirt.c, but running in source libvirtd context,
  * instead of client app context & also adding in tunnel
@@ -2676,7 +3497,7 @@ static int doPeer2PeerMigrate2(virQEMUDriverPtr driver,
          * due to missing parameters in the prepareTunnel() API.
          */
 
-        if (!(st = virStreamNew(dconn, 0)))
+        if (!(st = virStreamNew(dconn, qemuMigrationStreamFlags(flags))))
             goto cleanup;
 
         qemuDomainObjEnterRemoteWithDriver(driver, vm);
@@ -2717,7 +3538,7 @@ static int doPeer2PeerMigrate2(virQEMUDriverPtr driver,
     VIR_DEBUG("Perform %p", sconn);
     qemuMigrationJobSetPhase(driver, vm, QEMU_MIGRATION_PHASE_PERFORM2);
     if (flags & VIR_MIGRATE_TUNNELLED)
-        ret = doTunnelMigrate(driver, vm, st,
+        ret = doTunnelMigrate(driver, vm, &st, 1,
                               NULL, 0, NULL, NULL,
                               flags, resource, dconn);
     else
@@ -2795,6 +3616,9 @@ static int doPeer2PeerMigrate3(virQEMUDriverPtr driver,
     virErrorPtr orig_err = NULL;
     int cancelled;
     virStreamPtr st = NULL;
+    virStreamPtr streams[QEMU_MIGRATION_TUNNEL_STREAMS_MAX] = { NULL };
+    virConnectPtr conns[QEMU_MIGRATION_TUNNEL_STREAMS_MAX] = { NULL };
+    size_t nstreams = 0;
     VIR_DEBUG("driver=%p, sconn=%p, dconn=%p, vm=%p, xmlin=%s, "
               "dconnuri=%s, uri=%s, flags=%lx, dname=%s, resource=%lu",
               driver, sconn, dconn, vm, NULLSTR(xmlin),
@@ -2820,7 +3644,7 @@ static int doPeer2PeerMigrate3(virQEMUDriverPtr driver,
     cookieout = NULL;
     cookieoutlen = 0;
     if (flags & VIR_MIGRATE_TUNNELLED) {
-        if (!(st = virStreamNew(dconn, 0)))
+        if (!(st = virStreamNew(dconn, qemuMigrationStreamFlags(flags))))
             goto cleanup;
 
         qemuDomainObjEnterRemoteWithDriver(driver, vm);
@@ -2856,6 +3680,19 @@ static int doPeer2PeerMigrate3(virQEMUDriverPtr driver,
         goto finish;
     }
 
+    if (flags & VIR_MIGRATE_TUNNELLED) {
+        streams[nstreams++] = st;
+        if ((flags & VIR_MIGRATE_PARALLEL) &&
+            qemuMigrationOpenTunnelStreams(driver, vm, dconnuri,
+                                           dname ? dname : vm->def->name,
+                                           flags, conns, streams,
+                                           &nstreams) < 0) {
+            orig_err = virSaveLastError();
+            cancelled = 1;
+            goto finish;
+        }
+    }
+
     /* Perform the migration.  The driver isn't supposed to return
      * until the migration is complete. The src VM should remain
      * running, but in paused state until the destination can
@@ -2869,7 +3706,7 @@ static int doPeer2PeerMigrate3(virQEMUDriverPtr driver,
     cookieout = NULL;
     cookieoutlen = 0;
     if (flags & VIR_MIGRATE_TUNNELLED)
-        ret = doTunnelMigrate(driver, vm, st,
+        ret = doTunnelMigrate(driver, vm, streams, nstreams,
                               cookiein, cookieinlen,
                               &cookieout, &cookieoutlen,
                               flags, resource, dconn);
@@ -2957,6 +3794,7 @@ finish:
         ret = -1;
     }
 
+    qemuMigrationCloseTunnelStreams(driver, vm, conns, streams, nstreams);
     virObjectUnref(st);
 
     if (orig_err) {
@@ -2987,6 +3825,7 @@ static int doPeer2PeerMigrate(virQEMUDriverPtr driver,
     bool p2p;
     virErrorPtr orig_err = NULL;
     bool offline = false;
+    bool parallel = false;
 
     VIR_DEBUG("driver=%p, sconn=%p, vm=%p, xmlin=%s, dconnuri=%s, "
               "uri=%s, flags=%lx, dname=%s, resource=%lu",
@@ -3006,8 +3845,8 @@ static int doPeer2PeerMigrate(virQEMUDriverPtr driver,
         return -1;
     }
 
-    if (virConnectSetKeepAlive(dconn, driver->keepAliveInterval,
-                               driver->keepAliveCount) < 0)
+    if (virConnectSetKeepAlive(dconn, driver->config->keepAliveInterval,
+                               driver->config->keepAliveCount) < 0)
         goto cleanup;
 
     qemuDomainObjEnterRemoteWithDriver(driver, vm);
@@ -3022,6 +3861,9 @@ static int doPeer2PeerMigrate(virQEMUDriverPtr driver,
     if (flags & VIR_MIGRATE_OFFLINE)
         offline = VIR_DRV_SUPPORTS_FEATURE(dconn->driver, dconn,
                                            VIR_DRV_FEATURE_MIGRATION_OFFLINE);
+    if (flags & VIR_MIGRATE_PARALLEL)
+        parallel = VIR_DRV_SUPPORTS_FEATURE(dconn->driver, dconn,
+                                            VIR_DRV_FEATURE_MIGRATION_PARALLEL);
     qemuDomainObjExitRemoteWithDriver(driver, vm);
 
     if (!p2p) {
@@ -3051,6 +3893,16 @@ static int doPeer2PeerMigrate(virQEMUDriverPtr driver,
      * Therefore it is safe to clear the bit here.  */
     flags &= ~VIR_MIGRATE_CHANGE_PROTECTION;
 
+    /* The tunnel is only split with the v3 protocol, and only when
+     * the destination can put it back together; otherwise, a single
+     * stream will do. */
+    if ((flags & VIR_MIGRATE_PARALLEL) &&
+        (!(flags & VIR_MIGRATE_TUNNELLED) || !*v3proto || !parallel ||
+         driver->config->migrationTunnelStreams < 2)) {
+        VIR_DEBUG("Not splitting migration data over several connections");
+        flags &= ~VIR_MIGRATE_PARALLEL;
+    }
+
     if (*v3proto)
         ret = doPeer2PeerMigrate3(driver, sconn, dconn, vm, xmlin,
                                   dconnuri, uri, flags, dname, resource);
@@ -3170,7 +4022,7 @@ endjob:
                (!vm->persistent ||
                 (ret == 0 && (flags & VIR_MIGRATE_UNDEFINE_SOURCE)))) {
         if (flags & VIR_MIGRATE_UNDEFINE_SOURCE)
-            virDomainDeleteConfig(driver->configDir, driver->autostartDir, vm);
+            virDomainDeleteConfig(driver->config->configDir, driver->config->autostartDir, vm);
         qemuDomainRemoveInactive(driver, vm);
         vm = NULL;
     }
@@ -3413,6 +4265,11 @@ qemuMigrationFinish(virQEMUDriverPtr driver,
 
     qemuDomainCleanupRemove(vm, qemuMigrationPrepareCleanup);
 
+    /* Make sure QEMU got all the data of a parallel tunnel, which may
+     * still be on its way over some of the streams */
+    if (qemuMigrationStopTunnelIn(vm, retcode != 0) < 0)
+        retcode = -1;
+
     cookie_flags = QEMU_MIGRATION_COOKIE_NETWORK;
     if (flags & VIR_MIGRATE_PERSIST_DEST)
         cookie_flags |= QEMU_MIGRATION_COOKIE_PERSISTENT;
@@ -3455,7 +4312,7 @@ qemuMigrationFinish(virQEMUDriverPtr driver,
                 vm->newDef = vmdef = mig->persistent;
             else
                 vmdef = virDomainObjGetPersistentDef(driver->caps, vm);
-            if (!vmdef || virDomainSaveConfig(driver->configDir, vmdef) < 0) {
+            if (!vmdef || virDomainSaveConfig(driver->config->configDir, vmdef) < 0) {
                 /* Hmpf.  Migration was successful, but making it persistent
                  * was not.  If we report successful, then when this domain
                  * shuts down, management tools are in for a surprise.  On the
@@ -3549,7 +4406,7 @@ qemuMigrationFinish(virQEMUDriverPtr driver,
         }
 
         if (virDomainObjIsActive(vm) &&
-            virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+            virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
             VIR_WARN("Failed to save status on vm %s", vm->def->name);
             goto endjob;
         }
@@ -3650,7 +4507,7 @@ int qemuMigrationConfirm(virQEMUDriverPtr driver,
         event = virDomainEventNewFromObj(vm,
                                          VIR_DOMAIN_EVENT_RESUMED,
                                          VIR_DOMAIN_EVENT_RESUMED_MIGRATED);
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
             VIR_WARN("Failed to save status on vm %s", vm->def->name);
             goto cleanup;
         }
@@ -3792,7 +4649,7 @@ qemuMigrationToFile(virQEMUDriverPtr driver, virDomainObjPtr vm,
     if (rc < 0)
         goto cleanup;
 
-    rc = qemuMigrationWaitForCompletion(driver, vm, asyncJob, NULL);
+    rc = qemuMigrationWaitForCompletion(driver, vm, asyncJob, NULL, NULL);
 
     if (rc < 0)
         goto cleanup;
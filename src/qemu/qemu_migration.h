@@ -37,7 +37,10 @@
      VIR_MIGRATE_NON_SHARED_INC |               \
      VIR_MIGRATE_CHANGE_PROTECTION |            \
      VIR_MIGRATE_UNSAFE |                       \
-     VIR_MIGRATE_OFFLINE)
+     VIR_MIGRATE_OFFLINE |                      \
+     VIR_MIGRATE_COMPRESSED |                   \
+     VIR_MIGRATE_PARALLEL |                     \
+     VIR_MIGRATE_AUTO_CONVERGE)
 
 enum qemuMigrationJobPhase {
     QEMU_MIGRATION_PHASE_NONE = 0,
@@ -101,6 +104,10 @@ int qemuMigrationPrepareTunnel(virQEMUDriverPtr driver,
                                const char *dom_xml,
                                unsigned long flags);
 
+int qemuMigrationPrepareTunnelStream(virQEMUDriverPtr driver,
+                                     virDomainObjPtr vm,
+                                     virStreamPtr st);
+
 int qemuMigrationPrepareDirect(virQEMUDriverPtr driver,
                                virConnectPtr dconn,
                                const char *cookiein,
@@ -0,0 +1,126 @@
+/*
+ * qemu_migration_converge.c: keeping auto-converging migrations moving
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include "qemu_migration_converge.h"
+
+
+/* Takes over the speed and downtime from virDomainMigrateSetMaxSpeed
+ * and virDomainMigrateSetMaxDowntime if they were changed since the
+ * last call, so that the next step starts from what QEMU really uses.
+ * A @downtime of 0 means none was set.
+ */
+void
+qemuMigrationConvergeUserLimits(qemuMigrationConvergePtr converge,
+                                unsigned long speed,
+                                unsigned long long downtime)
+{
+    if (speed != converge->userSpeed)
+        converge->speed = converge->userSpeed = speed;
+    if (downtime && downtime != converge->userDowntime)
+        converge->downtime = converge->userDowntime = downtime;
+}
+
+
+/* Judges the progress shown by @status, taken at @now (in ms), against
+ * the previous check and stores @dirtyRate in bytes per second.
+ *
+ * Returns true if the migration is stalled, false if it is moving or
+ * it is too early to tell.
+ */
+bool
+qemuMigrationConvergeStalled(qemuMigrationConvergePtr converge,
+                             qemuMonitorMigrationStatusPtr status,
+                             unsigned long long now,
+                             unsigned long long *dirtyRate)
+{
+    unsigned long long pageSize = 4096;
+    bool first = converge->lastCheck == 0;
+    bool stalled;
+
+    *dirtyRate = 0;
+
+    if (status->status != QEMU_MONITOR_MIGRATION_STATUS_ACTIVE)
+        return false;
+
+    if (status->ram_iteration_set) {
+        /* The first pass sends all of the memory and tells nothing
+         * about convergence */
+        if (status->ram_iteration < 2 ||
+            status->ram_iteration == converge->iteration)
+            return false;
+    } else if (now - converge->lastCheck < QEMU_MIGRATION_CONVERGE_INTERVAL) {
+        return false;
+    }
+
+    if (status->ram_dirty_rate_set) {
+        if (status->ram_normal)
+            pageSize = status->ram_normal_bytes / status->ram_normal;
+        *dirtyRate = status->ram_dirty_rate * pageSize;
+    }
+
+    stalled = !first &&
+        (status->ram_remaining >= converge->remaining ||
+         (*dirtyRate && status->ram_bps_set && *dirtyRate >= status->ram_bps));
+
+    converge->iteration = status->ram_iteration;
+    converge->remaining = status->ram_remaining;
+    converge->lastCheck = now;
+
+    if (!stalled)
+        converge->reported = false;
+
+    return stalled;
+}
+
+
+/* Picks what to do about a stall: the speed is raised first, then the
+ * downtime, each doubled up to its limit. The caller updates
+ * @converge once the new @speed or @downtime is in effect, or sets
+ * reported once the event is out.
+ */
+qemuMigrationConvergeAction
+qemuMigrationConvergeNext(qemuMigrationConvergePtr converge,
+                          unsigned long *speed,
+                          unsigned long long *downtime)
+{
+    if (converge->speed < converge->maxSpeed) {
+        if (converge->speed == 0 || converge->speed > converge->maxSpeed / 2)
+            *speed = converge->maxSpeed;
+        else
+            *speed = converge->speed * 2;
+        return QEMU_MIGRATION_CONVERGE_STEP_SPEED;
+    }
+
+    if (converge->downtime < converge->maxDowntime) {
+        if (converge->downtime > converge->maxDowntime / 2)
+            *downtime = converge->maxDowntime;
+        else
+            *downtime = converge->downtime * 2;
+        return QEMU_MIGRATION_CONVERGE_STEP_DOWNTIME;
+    }
+
+    if (!converge->reported)
+        return QEMU_MIGRATION_CONVERGE_STEP_REPORT;
+
+    return QEMU_MIGRATION_CONVERGE_STEP_NONE;
+}
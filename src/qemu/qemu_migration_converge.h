@@ -0,0 +1,80 @@
+/*
+ * qemu_migration_converge.h: keeping auto-converging migrations moving
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __QEMU_MIGRATION_CONVERGE_H__
+# define __QEMU_MIGRATION_CONVERGE_H__
+
+# include "internal.h"
+# include "qemu_monitor.h"
+
+/*
+ * State of the controller which keeps a migration started with
+ * VIR_MIGRATE_AUTO_CONVERGE moving. Progress is judged once per pass
+ * over guest memory (or every QEMU_MIGRATION_CONVERGE_INTERVAL ms with
+ * QEMU which doesn't count passes): a pass that leaves at least as much
+ * RAM to send as the previous one, or a guest dirtying memory faster
+ * than it is sent, means the migration is stalled. Each stall raises
+ * the speed and then the downtime one step within the configured
+ * limits; once both are exhausted a stall event is emitted.
+ */
+typedef struct _qemuMigrationConverge qemuMigrationConverge;
+typedef qemuMigrationConverge *qemuMigrationConvergePtr;
+struct _qemuMigrationConverge {
+    unsigned long speed;                /* current speed in MiB/s */
+    unsigned long maxSpeed;
+    unsigned long userSpeed;            /* speed last set by the user */
+    unsigned long long downtime;        /* current max downtime in ms */
+    unsigned long long maxDowntime;
+    unsigned long long userDowntime;    /* downtime last set by the user */
+
+    unsigned long long iteration;       /* pass seen by the last check */
+    unsigned long long remaining;       /* RAM left at the last check */
+    unsigned long long lastCheck;       /* time of the last check in ms */
+    bool reported;                      /* stall event was emitted */
+};
+
+# define QEMU_MIGRATION_CONVERGE_INTERVAL 2000
+
+/* What QEMU uses until told otherwise */
+# define QEMU_MIGRATION_CONVERGE_DOWNTIME 30
+
+typedef enum {
+    QEMU_MIGRATION_CONVERGE_STEP_NONE,      /* nothing left to try */
+    QEMU_MIGRATION_CONVERGE_STEP_SPEED,     /* raise the speed */
+    QEMU_MIGRATION_CONVERGE_STEP_DOWNTIME,  /* raise the max downtime */
+    QEMU_MIGRATION_CONVERGE_STEP_REPORT,    /* emit the stall event */
+} qemuMigrationConvergeAction;
+
+void qemuMigrationConvergeUserLimits(qemuMigrationConvergePtr converge,
+                                     unsigned long speed,
+                                     unsigned long long downtime);
+
+bool qemuMigrationConvergeStalled(qemuMigrationConvergePtr converge,
+                                  qemuMonitorMigrationStatusPtr status,
+                                  unsigned long long now,
+                                  unsigned long long *dirtyRate);
+
+qemuMigrationConvergeAction
+qemuMigrationConvergeNext(qemuMigrationConvergePtr converge,
+                          unsigned long *speed,
+                          unsigned long long *downtime);
+
+#endif /* __QEMU_MIGRATION_CONVERGE_H__ */
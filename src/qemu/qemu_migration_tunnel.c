@@ -0,0 +1,164 @@
+/*
+ * qemu_migration_tunnel.c: chunks of parallel tunnelled migration
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <unistd.h>
+
+#include "qemu_migration_tunnel.h"
+#include "virerror.h"
+#include "virutil.h"
+
+#define VIR_FROM_THIS VIR_FROM_QEMU
+
+
+void
+qemuMigrationTunnelEncodeHeader(char *buf,
+                                unsigned long long seq,
+                                unsigned int len)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+        buf[i] = (seq >> (56 - 8 * i)) & 0xff;
+    for (i = 0; i < 4; i++)
+        buf[8 + i] = (len >> (24 - 8 * i)) & 0xff;
+}
+
+void
+qemuMigrationTunnelDecodeHeader(const char *buf,
+                                unsigned long long *seq,
+                                unsigned int *len)
+{
+    const unsigned char *p = (const unsigned char *) buf;
+    int i;
+
+    *seq = 0;
+    for (i = 0; i < 8; i++)
+        *seq = (*seq << 8) | p[i];
+    *len = 0;
+    for (i = 0; i < 4; i++)
+        *len = (*len << 8) | p[8 + i];
+}
+
+
+/* Reads from @s for as long as data is available without blocking,
+ * up to the end of the chunk it is in.
+ */
+int
+qemuMigrationTunnelInStreamRead(qemuMigrationTunnelInStreamPtr s)
+{
+    while (!s->ready && !s->eof) {
+        char *buf;
+        size_t want;
+        ssize_t nbytes;
+
+        if (s->got < QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE) {
+            buf = s->header + s->got;
+            want = QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE - s->got;
+        } else {
+            buf = s->data + s->got - QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE;
+            want = QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE + s->len - s->got;
+        }
+
+        nbytes = read(s->fd, buf, want);
+        if (nbytes < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN)
+                return 0;
+            virReportSystemError(errno, "%s",
+                                 _("cannot read tunnelled migration data"));
+            return -1;
+        }
+
+        if (nbytes == 0) {
+            if (s->got) {
+                virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                               _("tunnelled migration stream ended "
+                                 "in the middle of a chunk"));
+                return -1;
+            }
+            s->eof = true;
+            return 0;
+        }
+
+        s->got += nbytes;
+        if (s->got == QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE) {
+            qemuMigrationTunnelDecodeHeader(s->header, &s->seq, &s->len);
+            if (s->len > QEMU_MIGRATION_TUNNEL_CHUNK_MAX) {
+                virReportError(VIR_ERR_OPERATION_FAILED,
+                               _("tunnelled migration chunk of %u bytes "
+                                 "is too large"), s->len);
+                return -1;
+            }
+        }
+        if (s->got == QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE + s->len) {
+            s->got = 0;
+            s->ready = true;
+        }
+    }
+
+    return 0;
+}
+
+
+/* Writes every chunk of @streams which is next in line to @fd,
+ * advancing @next past them, and sets @done once the end marker is
+ * reached.
+ */
+int
+qemuMigrationTunnelInStreamsFlush(qemuMigrationTunnelInStreamPtr streams,
+                                  size_t nstreams,
+                                  int fd,
+                                  unsigned long long *next,
+                                  bool *done)
+{
+    bool progress = true;
+    size_t i;
+
+    while (progress && !*done) {
+        progress = false;
+
+        for (i = 0; i < nstreams; i++) {
+            qemuMigrationTunnelInStreamPtr s = &streams[i];
+
+            if (!s->ready || s->seq != *next)
+                continue;
+
+            if (s->len == 0) {
+                *done = true;
+            } else {
+                if (safewrite(fd, s->data, s->len) < 0) {
+                    virReportSystemError(errno, "%s",
+                                         _("cannot pass tunnelled migration "
+                                           "data to qemu"));
+                    return -1;
+                }
+                (*next)++;
+            }
+            s->ready = false;
+            progress = true;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * qemu_migration_tunnel.h: chunks of parallel tunnelled migration
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __QEMU_MIGRATION_TUNNEL_H__
+# define __QEMU_MIGRATION_TUNNEL_H__
+
+# include "internal.h"
+
+/* With VIR_MIGRATE_PARALLEL, the data of a tunnelled migration is
+ * cut into chunks which are sent over several streams. Each chunk
+ * starts with a header holding its sequence number and the length
+ * of the data following it, both big endian. A chunk without data
+ * comes after all the others and marks the end of the migration.
+ */
+# define QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE 12
+
+/* Largest amount of data in one chunk */
+# define QEMU_MIGRATION_TUNNEL_CHUNK_MAX 65536
+
+void qemuMigrationTunnelEncodeHeader(char *buf,
+                                     unsigned long long seq,
+                                     unsigned int len);
+
+void qemuMigrationTunnelDecodeHeader(const char *buf,
+                                     unsigned long long *seq,
+                                     unsigned int *len);
+
+/* The receiving end of one of the streams */
+typedef struct _qemuMigrationTunnelInStream qemuMigrationTunnelInStream;
+typedef qemuMigrationTunnelInStream *qemuMigrationTunnelInStreamPtr;
+struct _qemuMigrationTunnelInStream {
+    int fd;                     /* read end of the pipe the stream fills */
+    char header[QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE];
+    char *data;                 /* QEMU_MIGRATION_TUNNEL_CHUNK_MAX bytes */
+    size_t got;                 /* bytes of the current chunk read so far */
+    unsigned long long seq;
+    unsigned int len;
+    bool ready;                 /* whole chunk read, waiting for its turn */
+    bool eof;
+};
+
+int qemuMigrationTunnelInStreamRead(qemuMigrationTunnelInStreamPtr s);
+
+int qemuMigrationTunnelInStreamsFlush(qemuMigrationTunnelInStreamPtr streams,
+                                      size_t nstreams,
+                                      int fd,
+                                      unsigned long long *next,
+                                      bool *done);
+
+#endif /* __QEMU_MIGRATION_TUNNEL_H__ */
@@ -60,9 +60,11 @@ struct _qemuMonitor {
 
     qemuMonitorCallbacksPtr cb;
 
-    /* If there's a command being processed this will be
-     * non-NULL */
-    qemuMonitorMessagePtr msg;
+    /* The commands being processed, oldest first. The JSON
+     * monitor can have several of them written before their
+     * replies arrive; the text monitor only ever has one */
+    qemuMonitorMessagePtr *msgs;
+    size_t nmsgs;
 
     /* Buffer incoming data ready for Text/QMP monitor
      * code to process & find message boundaries */
@@ -311,6 +313,73 @@ qemuMonitorOpenPty(const char *monitor)
 }
 
 
+/* The first command which still has data to be written */
+static qemuMonitorMessagePtr
+qemuMonitorTxMessage(qemuMonitorPtr mon)
+{
+    size_t i;
+
+    for (i = 0 ; i < mon->nmsgs ; i++) {
+        if (mon->msgs[i]->txOffset < mon->msgs[i]->txLength)
+            return mon->msgs[i];
+    }
+    return NULL;
+}
+
+
+/* The oldest command written in full and still waiting for its reply */
+static qemuMonitorMessagePtr
+qemuMonitorRxMessage(qemuMonitorPtr mon)
+{
+    size_t i;
+
+    for (i = 0 ; i < mon->nmsgs ; i++) {
+        if (!mon->msgs[i]->finished &&
+            mon->msgs[i]->txOffset == mon->msgs[i]->txLength)
+            return mon->msgs[i];
+    }
+    return NULL;
+}
+
+
+/* Wake up everyone waiting for a command, e.g. after an error */
+static void
+qemuMonitorFinishMessages(qemuMonitorPtr mon)
+{
+    size_t i;
+
+    for (i = 0 ; i < mon->nmsgs ; i++)
+        mon->msgs[i]->finished = 1;
+}
+
+
+/*
+ * Find the command a JSON reply carrying @id answers. Replies
+ * without an ID go to the oldest command waiting for one, which
+ * is what QEMU answers first.
+ * Call this function while holding the monitor lock.
+ */
+qemuMonitorMessagePtr
+qemuMonitorFindMessage(qemuMonitorPtr mon,
+                       const char *id)
+{
+    size_t i;
+
+    if (!id)
+        return qemuMonitorRxMessage(mon);
+
+    for (i = 0 ; i < mon->nmsgs ; i++) {
+        qemuMonitorMessagePtr msg = mon->msgs[i];
+
+        if (!msg->finished &&
+            msg->txOffset == msg->txLength &&
+            STREQ_NULLABLE(msg->id, id))
+            return msg;
+    }
+    return NULL;
+}
+
+
 /* This method processes data that has been received
  * from the monitor. Looking for async events and
  * replies/errors.
@@ -319,18 +388,17 @@ static int
 qemuMonitorIOProcess(qemuMonitorPtr mon)
 {
     int len;
-    qemuMonitorMessagePtr msg = NULL;
+    qemuMonitorMessagePtr msg;
 
     /* See if there's a message & whether its ready for its reply
      * ie whether its completed writing all its data */
-    if (mon->msg && mon->msg->txOffset == mon->msg->txLength)
-        msg = mon->msg;
+    msg = qemuMonitorRxMessage(mon);
 
 #if DEBUG_IO
 # if DEBUG_RAW_IO
     char *str1 = qemuMonitorEscapeNonPrintable(msg ? msg->txBuffer : "");
     char *str2 = qemuMonitorEscapeNonPrintable(mon->buffer);
-    VIR_ERROR(_("Process %d %p %p [[[[%s]]][[[%s]]]"), (int)mon->bufferOffset, mon->msg, msg, str1, str2);
+    VIR_ERROR(_("Process %d %zu %p [[[[%s]]][[[%s]]]"), (int)mon->bufferOffset, mon->nmsgs, msg, str1, str2);
     VIR_FREE(str1);
     VIR_FREE(str2);
 # else
@@ -366,7 +434,9 @@ qemuMonitorIOProcess(qemuMonitorPtr mon)
 #if DEBUG_IO
     VIR_DEBUG("Process done %d used %d", (int)mon->bufferOffset, len);
 #endif
-    if (msg && msg->finished)
+    /* With several commands in flight, any of them may have got
+     * its reply, not just @msg */
+    if (len && mon->nmsgs)
         virCondBroadcast(&mon->notify);
     return len;
 }
@@ -420,50 +490,57 @@ qemuMonitorIOWriteWithFD(qemuMonitorPtr mon,
 static int
 qemuMonitorIOWrite(qemuMonitorPtr mon)
 {
+    qemuMonitorMessagePtr msg;
+    int total = 0;
     int done;
 
-    /* If no active message, or fully transmitted, the no-op */
-    if (!mon->msg || mon->msg->txOffset == mon->msg->txLength)
-        return 0;
-
-    if (mon->msg->txFD != -1 && !mon->hasSendFD) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Monitor does not support sending of file descriptors"));
-        return -1;
-    }
-
-    if (mon->msg->txFD == -1)
-        done = write(mon->fd,
-                     mon->msg->txBuffer + mon->msg->txOffset,
-                     mon->msg->txLength - mon->msg->txOffset);
-    else
-        done = qemuMonitorIOWriteWithFD(mon,
-                                        mon->msg->txBuffer + mon->msg->txOffset,
-                                        mon->msg->txLength - mon->msg->txOffset,
-                                        mon->msg->txFD);
-
-    PROBE(QEMU_MONITOR_IO_WRITE,
-          "mon=%p buf=%s len=%d ret=%d errno=%d",
-          mon,
-          mon->msg->txBuffer + mon->msg->txOffset,
-          mon->msg->txLength - mon->msg->txOffset,
-          done, errno);
+    /* Write as many of the queued commands as the socket takes, so
+     * that QEMU can work through them without waiting for us */
+    while ((msg = qemuMonitorTxMessage(mon))) {
+        if (msg->txFD != -1 && !mon->hasSendFD) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Monitor does not support sending of file descriptors"));
+            return -1;
+        }
 
-    if (mon->msg->txFD != -1)
-        PROBE(QEMU_MONITOR_IO_SEND_FD,
-              "mon=%p fd=%d ret=%d errno=%d",
-              mon, mon->msg->txFD, done, errno);
+        if (msg->txFD == -1)
+            done = write(mon->fd,
+                         msg->txBuffer + msg->txOffset,
+                         msg->txLength - msg->txOffset);
+        else
+            done = qemuMonitorIOWriteWithFD(mon,
+                                            msg->txBuffer + msg->txOffset,
+                                            msg->txLength - msg->txOffset,
+                                            msg->txFD);
+
+        PROBE(QEMU_MONITOR_IO_WRITE,
+              "mon=%p buf=%s len=%d ret=%d errno=%d",
+              mon,
+              msg->txBuffer + msg->txOffset,
+              msg->txLength - msg->txOffset,
+              done, errno);
+
+        if (msg->txFD != -1)
+            PROBE(QEMU_MONITOR_IO_SEND_FD,
+                  "mon=%p fd=%d ret=%d errno=%d",
+                  mon, msg->txFD, done, errno);
+
+        if (done < 0) {
+            if (errno == EAGAIN)
+                break;
 
-    if (done < 0) {
-        if (errno == EAGAIN)
-            return 0;
+            virReportSystemError(errno, "%s",
+                                 _("Unable to write to monitor"));
+            return -1;
+        }
+        msg->txOffset += done;
+        total += done;
 
-        virReportSystemError(errno, "%s",
-                             _("Unable to write to monitor"));
-        return -1;
+        if (msg->txOffset < msg->txLength)
+            break;
     }
-    mon->msg->txOffset += done;
-    return done;
+
+    return total;
 }
 
 /*
@@ -532,7 +609,7 @@ static void qemuMonitorUpdateWatch(qemuMonitorPtr mon)
     if (mon->lastError.code == VIR_ERR_OK) {
         events |= VIR_EVENT_HANDLE_READABLE;
 
-        if ((mon->msg && mon->msg->txOffset < mon->msg->txLength) &&
+        if (qemuMonitorTxMessage(mon) &&
             !mon->wait_greeting)
             events |= VIR_EVENT_HANDLE_WRITABLE;
     }
@@ -633,10 +710,10 @@ qemuMonitorIO(int watch, int fd, int events, void *opaque) {
         }
 
         VIR_DEBUG("Error on monitor %s", NULLSTR(mon->lastError.message));
-        /* If IO process resulted in an error & we have a message,
-         * then wakeup that waiter */
-        if (mon->msg && !mon->msg->finished) {
-            mon->msg->finished = 1;
+        /* If IO process resulted in an error & we have messages,
+         * then wakeup their waiter */
+        if (mon->nmsgs) {
+            qemuMonitorFinishMessages(mon);
             virCondSignal(&mon->notify);
         }
     }
@@ -830,7 +907,7 @@ void qemuMonitorClose(qemuMonitorPtr mon)
     /* In case another thread is waiting for its monitor command to be
      * processed, we need to wake it up with appropriate error set.
      */
-    if (mon->msg) {
+    if (mon->nmsgs) {
         if (mon->lastError.code == VIR_ERR_OK) {
             virErrorPtr err = virSaveLastError();
 
@@ -844,7 +921,7 @@ void qemuMonitorClose(qemuMonitorPtr mon)
                 virResetLastError();
             }
         }
-        mon->msg->finished = 1;
+        qemuMonitorFinishMessages(mon);
         virCondSignal(&mon->notify);
     }
 
@@ -865,10 +942,41 @@ char *qemuMonitorNextCommandID(qemuMonitorPtr mon)
 }
 
 
-int qemuMonitorSend(qemuMonitorPtr mon,
-                    qemuMonitorMessagePtr msg)
+static bool
+qemuMonitorMessagesFinished(qemuMonitorMessagePtr *msgs,
+                            size_t nmsgs)
+{
+    size_t i;
+
+    for (i = 0 ; i < nmsgs ; i++) {
+        if (!msgs[i]->finished)
+            return false;
+    }
+    return true;
+}
+
+
+/*
+ * Send @nmsgs commands and wait for all their replies. The JSON
+ * monitor writes them all at once and matches the replies by the
+ * ID of each command, so the whole batch costs a single round trip
+ * to QEMU. The text monitor can't tell replies apart, so there the
+ * commands are sent one after the other.
+ */
+int qemuMonitorSendMany(qemuMonitorPtr mon,
+                        qemuMonitorMessagePtr *msgs,
+                        size_t nmsgs)
 {
     int ret = -1;
+    size_t i;
+
+    if (!mon->json && nmsgs > 1) {
+        for (i = 0 ; i < nmsgs ; i++) {
+            if (qemuMonitorSendMany(mon, msgs + i, 1) < 0)
+                return -1;
+        }
+        return 0;
+    }
 
     /* Check whether qemu quited unexpectedly */
     if (mon->lastError.code != VIR_ERR_OK) {
@@ -878,14 +986,16 @@ int qemuMonitorSend(qemuMonitorPtr mon,
         return -1;
     }
 
-    mon->msg = msg;
+    mon->msgs = msgs;
+    mon->nmsgs = nmsgs;
     qemuMonitorUpdateWatch(mon);
 
-    PROBE(QEMU_MONITOR_SEND_MSG,
-          "mon=%p msg=%s fd=%d",
-          mon, mon->msg->txBuffer, mon->msg->txFD);
+    for (i = 0 ; i < nmsgs ; i++)
+        PROBE(QEMU_MONITOR_SEND_MSG,
+              "mon=%p msg=%s fd=%d",
+              mon, msgs[i]->txBuffer, msgs[i]->txFD);
 
-    while (!mon->msg->finished) {
+    while (!qemuMonitorMessagesFinished(msgs, nmsgs)) {
         if (virCondWait(&mon->notify, &mon->parent.lock) < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("Unable to wait on monitor condition"));
@@ -903,13 +1013,21 @@ int qemuMonitorSend(qemuMonitorPtr mon,
     ret = 0;
 
 cleanup:
-    mon->msg = NULL;
+    mon->msgs = NULL;
+    mon->nmsgs = 0;
     qemuMonitorUpdateWatch(mon);
 
     return ret;
 }
 
 
+int qemuMonitorSend(qemuMonitorPtr mon,
+                    qemuMonitorMessagePtr msg)
+{
+    return qemuMonitorSendMany(mon, &msg, 1);
+}
+
+
 int qemuMonitorHMPCommandWithFd(qemuMonitorPtr mon,
                                 const char *cmd,
                                 int scm_fd,
@@ -1402,7 +1520,7 @@ qemuMonitorGetBlockInfo(qemuMonitorPtr mon)
         return NULL;
     }
 
-    if (!(table = virHashCreate(32, (virHashDataFree) free)))
+    if (!(table = virHashCreate(32, virHashValueFree)))
         return NULL;
 
     if (mon->json)
@@ -1477,6 +1595,86 @@ int qemuMonitorGetBlockStatsInfo(qemuMonitorPtr mon,
     return ret;
 }
 
+/* Return a hash table of qemuBlockStats for all block devices of the
+ * domain, keyed by device alias, gathered with a single monitor
+ * command. Return NULL on failure. Only supported with the JSON
+ * monitor.
+ */
+virHashTablePtr
+qemuMonitorGetAllBlockStatsInfo(qemuMonitorPtr mon)
+{
+    virHashTablePtr table;
+
+    VIR_DEBUG("mon=%p", mon);
+
+    if (!mon) {
+        virReportError(VIR_ERR_INVALID_ARG, "%s",
+                       _("monitor must not be NULL"));
+        return NULL;
+    }
+
+    if (!mon->json) {
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED, "%s",
+                       _("block statistics of all devices require "
+                         "the JSON monitor"));
+        return NULL;
+    }
+
+    if (!(table = virHashCreate(32, virHashValueFree)))
+        return NULL;
+
+    if (qemuMonitorJSONGetAllBlockStatsInfo(mon, table) < 0) {
+        virHashFree(table);
+        return NULL;
+    }
+
+    return table;
+}
+
+/* Fetch the balloon size and/or the stats of all block devices in
+ * @stats. With the JSON monitor both commands are in flight at once.
+ * Each part is filled in independently: stats->balloonRet is -1 and
+ * stats->blockstats is NULL if the respective query failed. Returns
+ * 0 if everything requested was fetched, -1 otherwise.
+ */
+int qemuMonitorGetDomainStats(qemuMonitorPtr mon,
+                              bool balloon,
+                              bool blockstats,
+                              qemuMonitorDomainStatsPtr stats)
+{
+    int ret = 0;
+
+    VIR_DEBUG("mon=%p balloon=%d blockstats=%d", mon, balloon, blockstats);
+
+    memset(stats, 0, sizeof(*stats));
+
+    if (!mon) {
+        virReportError(VIR_ERR_INVALID_ARG, "%s",
+                       _("monitor must not be NULL"));
+        return -1;
+    }
+
+    if (!mon->json) {
+        if (balloon &&
+            (stats->balloonRet = qemuMonitorGetBalloonInfo(mon,
+                                                           &stats->balloon)) < 0)
+            ret = -1;
+        if (blockstats &&
+            !(stats->blockstats = qemuMonitorGetAllBlockStatsInfo(mon)))
+            ret = -1;
+        return ret;
+    }
+
+    if (blockstats &&
+        !(stats->blockstats = virHashCreate(32, virHashValueFree)))
+        ret = -1;
+
+    if (qemuMonitorJSONGetDomainStats(mon, balloon, blockstats, stats) < 0)
+        ret = -1;
+
+    return ret;
+}
+
 /* Return 0 and update @nparams with the number of block stats
  * QEMU supports if success. Return -1 if failure.
  */
@@ -1802,10 +2000,7 @@ int qemuMonitorSetMigrationDowntime(qemuMonitorPtr mon,
 
 
 int qemuMonitorGetMigrationStatus(qemuMonitorPtr mon,
-                                  int *status,
-                                  unsigned long long *transferred,
-                                  unsigned long long *remaining,
-                                  unsigned long long *total)
+                                  qemuMonitorMigrationStatusPtr status)
 {
     int ret;
     VIR_DEBUG("mon=%p", mon);
@@ -1817,15 +2012,9 @@ int qemuMonitorGetMigrationStatus(qemuMonitorPtr mon,
     }
 
     if (mon->json)
-        ret = qemuMonitorJSONGetMigrationStatus(mon, status,
-                                                transferred,
-                                                remaining,
-                                                total);
+        ret = qemuMonitorJSONGetMigrationStatus(mon, status);
     else
-        ret = qemuMonitorTextGetMigrationStatus(mon, status,
-                                                transferred,
-                                                remaining,
-                                                total);
+        ret = qemuMonitorTextGetMigrationStatus(mon, status);
     return ret;
 }
 
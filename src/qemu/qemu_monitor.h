@@ -65,6 +65,9 @@ struct _qemuMonitorMessage {
 
     qemuMonitorPasswordHandler passwordHandler;
     void *passwordOpaque;
+
+    /* ID of the JSON command, used to match its reply */
+    char *id;
 };
 
 typedef struct _qemuMonitorCallbacks qemuMonitorCallbacks;
@@ -168,6 +171,11 @@ int qemuMonitorSetLink(qemuMonitorPtr mon,
 char *qemuMonitorNextCommandID(qemuMonitorPtr mon);
 int qemuMonitorSend(qemuMonitorPtr mon,
                     qemuMonitorMessagePtr msg);
+int qemuMonitorSendMany(qemuMonitorPtr mon,
+                        qemuMonitorMessagePtr *msgs,
+                        size_t nmsgs);
+qemuMonitorMessagePtr qemuMonitorFindMessage(qemuMonitorPtr mon,
+                                             const char *id);
 int qemuMonitorHMPCommandWithFd(qemuMonitorPtr mon,
                                 const char *cmd,
                                 int scm_fd,
@@ -275,6 +283,35 @@ int qemuMonitorGetBlockStatsInfo(qemuMonitorPtr mon,
                                  long long *flush_req,
                                  long long *flush_total_times,
                                  long long *errs);
+
+typedef struct _qemuBlockStats qemuBlockStats;
+typedef qemuBlockStats *qemuBlockStatsPtr;
+struct _qemuBlockStats {
+    long long rd_req;
+    long long rd_bytes;
+    long long rd_total_times;
+    long long wr_req;
+    long long wr_bytes;
+    long long wr_total_times;
+    long long flush_req;
+    long long flush_total_times;
+    long long errs; /* -1 if not supported */
+};
+
+virHashTablePtr qemuMonitorGetAllBlockStatsInfo(qemuMonitorPtr mon);
+
+typedef struct _qemuMonitorDomainStats qemuMonitorDomainStats;
+typedef qemuMonitorDomainStats *qemuMonitorDomainStatsPtr;
+struct _qemuMonitorDomainStats {
+    int balloonRet; /* as returned by qemuMonitorGetBalloonInfo */
+    unsigned long long balloon;
+    virHashTablePtr blockstats; /* NULL if not available */
+};
+
+int qemuMonitorGetDomainStats(qemuMonitorPtr mon,
+                              bool balloon,
+                              bool blockstats,
+                              qemuMonitorDomainStatsPtr stats);
 int qemuMonitorGetBlockStatsParamsNumber(qemuMonitorPtr mon,
                                          int *nparams);
 
@@ -339,11 +376,40 @@ enum {
 
 VIR_ENUM_DECL(qemuMonitorMigrationStatus)
 
+typedef struct _qemuMonitorMigrationStatus qemuMonitorMigrationStatus;
+typedef qemuMonitorMigrationStatus *qemuMonitorMigrationStatusPtr;
+struct _qemuMonitorMigrationStatus {
+    int status;
+    unsigned long long total_time;
+    /* total or expected depending on status */
+    bool downtime_set;
+    unsigned long long downtime;
+    bool setup_time_set;
+    unsigned long long setup_time;
+
+    unsigned long long ram_transferred;
+    unsigned long long ram_remaining;
+    unsigned long long ram_total;
+    bool ram_duplicate_set;
+    unsigned long long ram_duplicate;
+    unsigned long long ram_normal;
+    unsigned long long ram_normal_bytes;
+    /* pages dirtied per second, bytes sent per second */
+    bool ram_dirty_rate_set;
+    unsigned long long ram_dirty_rate;
+    bool ram_bps_set;
+    unsigned long long ram_bps;
+    /* number of completed passes over guest RAM */
+    bool ram_iteration_set;
+    unsigned long long ram_iteration;
+
+    unsigned long long disk_transferred;
+    unsigned long long disk_remaining;
+    unsigned long long disk_total;
+};
+
 int qemuMonitorGetMigrationStatus(qemuMonitorPtr mon,
-                                  int *status,
-                                  unsigned long long *transferred,
-                                  unsigned long long *remaining,
-                                  unsigned long long *total);
+                                  qemuMonitorMigrationStatusPtr status);
 int qemuMonitorGetSpiceMigrationStatus(qemuMonitorPtr mon,
                                        bool *spice_migrated);
 
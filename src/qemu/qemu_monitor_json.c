@@ -149,7 +149,9 @@ qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
 
     VIR_DEBUG("Line [%s]", line);
 
-    if (!(obj = virJSONValueFromString(line)))
+    /* Replies are only read, never modified, so parse them into an
+     * arena rather than doing an allocation per node */
+    if (!(obj = virJSONValueFromStringFlags(line, VIR_JSON_PARSE_ARENA)))
         goto cleanup;
 
     if (obj->type != VIR_JSON_TYPE_OBJECT) {
@@ -168,6 +170,11 @@ qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
                virJSONValueObjectHasKey(obj, "return") == 1) {
         PROBE(QEMU_MONITOR_RECV_REPLY,
               "mon=%p reply=%s", mon, line);
+        /* With several commands in flight the reply may be for
+         * any of them, not just the oldest one */
+        if (msg)
+            msg = qemuMonitorFindMessage(mon,
+                                         virJSONValueObjectGetString(obj, "id"));
         if (msg) {
             msg->rxObject = obj;
             msg->finished = 1;
@@ -222,27 +229,24 @@ int qemuMonitorJSONIOProcess(qemuMonitorPtr mon,
     return used;
 }
 
+/* Fill @msg in to send @cmd, tagged with an ID to match its reply */
 static int
-qemuMonitorJSONCommandWithFd(qemuMonitorPtr mon,
-                             virJSONValuePtr cmd,
-                             int scm_fd,
-                             virJSONValuePtr *reply)
+qemuMonitorJSONMessagePrepare(qemuMonitorPtr mon,
+                              virJSONValuePtr cmd,
+                              int scm_fd,
+                              qemuMonitorMessagePtr msg)
 {
     int ret = -1;
-    qemuMonitorMessage msg;
     char *cmdstr = NULL;
-    char *id = NULL;
     virJSONValuePtr exe;
 
-    *reply = NULL;
-
-    memset(&msg, 0, sizeof(msg));
+    memset(msg, 0, sizeof(*msg));
 
     exe = virJSONValueObjectGet(cmd, "execute");
     if (exe) {
-        if (!(id = qemuMonitorNextCommandID(mon)))
+        if (!(msg->id = qemuMonitorNextCommandID(mon)))
             goto cleanup;
-        if (virJSONValueObjectAppendString(cmd, "id", id) < 0) {
+        if (virJSONValueObjectAppendString(cmd, "id", msg->id) < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("Unable to append command 'id' string"));
             goto cleanup;
@@ -253,15 +257,45 @@ qemuMonitorJSONCommandWithFd(qemuMonitorPtr mon,
         virReportOOMError();
         goto cleanup;
     }
-    if (virAsprintf(&msg.txBuffer, "%s\r\n", cmdstr) < 0) {
+    if (virAsprintf(&msg->txBuffer, "%s\r\n", cmdstr) < 0) {
         virReportOOMError();
         goto cleanup;
     }
-    msg.txLength = strlen(msg.txBuffer);
-    msg.txFD = scm_fd;
+    msg->txLength = strlen(msg->txBuffer);
+    msg->txFD = scm_fd;
 
     VIR_DEBUG("Send command '%s' for write with FD %d", cmdstr, scm_fd);
 
+    ret = 0;
+
+cleanup:
+    VIR_FREE(cmdstr);
+    return ret;
+}
+
+static void
+qemuMonitorJSONMessageClear(qemuMonitorMessagePtr msg)
+{
+    VIR_FREE(msg->id);
+    VIR_FREE(msg->txBuffer);
+    virJSONValueFree(msg->rxObject);
+    msg->rxObject = NULL;
+}
+
+static int
+qemuMonitorJSONCommandWithFd(qemuMonitorPtr mon,
+                             virJSONValuePtr cmd,
+                             int scm_fd,
+                             virJSONValuePtr *reply)
+{
+    int ret = -1;
+    qemuMonitorMessage msg;
+
+    *reply = NULL;
+
+    if (qemuMonitorJSONMessagePrepare(mon, cmd, scm_fd, &msg) < 0)
+        goto cleanup;
+
     ret = qemuMonitorSend(mon, &msg);
 
     VIR_DEBUG("Receive command reply ret=%d rxObject=%p",
@@ -275,14 +309,72 @@ qemuMonitorJSONCommandWithFd(qemuMonitorPtr mon,
             ret = -1;
         } else {
             *reply = msg.rxObject;
+            msg.rxObject = NULL;
         }
     }
 
 cleanup:
-    VIR_FREE(id);
-    VIR_FREE(cmdstr);
-    VIR_FREE(msg.txBuffer);
+    qemuMonitorJSONMessageClear(&msg);
+
+    return ret;
+}
+
+
+/*
+ * Send all of @cmds at once and wait for their replies, which are
+ * stored in the matching entries of @replies. This costs a single
+ * round trip to QEMU, rather than one per command.
+ */
+static int
+qemuMonitorJSONCommands(qemuMonitorPtr mon,
+                        virJSONValuePtr *cmds,
+                        size_t ncmds,
+                        virJSONValuePtr *replies)
+{
+    int ret = -1;
+    qemuMonitorMessagePtr msgs = NULL;
+    qemuMonitorMessagePtr *msgptrs = NULL;
+    size_t i;
 
+    memset(replies, 0, sizeof(*replies) * ncmds);
+
+    if (VIR_ALLOC_N(msgs, ncmds) < 0 ||
+        VIR_ALLOC_N(msgptrs, ncmds) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    for (i = 0 ; i < ncmds ; i++) {
+        if (qemuMonitorJSONMessagePrepare(mon, cmds[i], -1, &msgs[i]) < 0)
+            goto cleanup;
+        msgptrs[i] = &msgs[i];
+    }
+
+    if (qemuMonitorSendMany(mon, msgptrs, ncmds) < 0)
+        goto cleanup;
+
+    for (i = 0 ; i < ncmds ; i++) {
+        if (!msgs[i].rxObject) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Missing monitor reply object"));
+            goto cleanup;
+        }
+    }
+
+    for (i = 0 ; i < ncmds ; i++) {
+        replies[i] = msgs[i].rxObject;
+        msgs[i].rxObject = NULL;
+    }
+
+    ret = 0;
+
+cleanup:
+    if (msgs) {
+        for (i = 0 ; i < ncmds ; i++)
+            qemuMonitorJSONMessageClear(&msgs[i]);
+    }
+    VIR_FREE(msgs);
+    VIR_FREE(msgptrs);
     return ret;
 }
 
@@ -1325,6 +1417,43 @@ cleanup:
 }
 
 
+/* Parse a query-balloon @reply, as for qemuMonitorJSONGetBalloonInfo */
+static int
+qemuMonitorJSONParseBalloonInfo(virJSONValuePtr cmd,
+                                virJSONValuePtr reply,
+                                unsigned long long *currmem)
+{
+    virJSONValuePtr data;
+    unsigned long long mem;
+
+    *currmem = 0;
+
+    /* See if balloon soft-failed */
+    if (qemuMonitorJSONHasError(reply, "DeviceNotActive") ||
+        qemuMonitorJSONHasError(reply, "KVMMissingCap"))
+        return 0;
+
+    /* See if any other fatal error occurred */
+    if (qemuMonitorJSONCheckError(cmd, reply) < 0)
+        return -1;
+
+    if (!(data = virJSONValueObjectGet(reply, "return"))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("info balloon reply was missing return data"));
+        return -1;
+    }
+
+    if (virJSONValueObjectGetNumberUlong(data, "actual", &mem) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("info balloon reply was missing balloon data"));
+        return -1;
+    }
+
+    *currmem = (mem/1024);
+    return 1;
+}
+
+
 /*
  * Returns: 0 if balloon not supported, +1 if balloon query worked
  * or -1 on failure
@@ -1344,40 +1473,9 @@ int qemuMonitorJSONGetBalloonInfo(qemuMonitorPtr mon,
 
     ret = qemuMonitorJSONCommand(mon, cmd, &reply);
 
-    if (ret == 0) {
-        /* See if balloon soft-failed */
-        if (qemuMonitorJSONHasError(reply, "DeviceNotActive") ||
-            qemuMonitorJSONHasError(reply, "KVMMissingCap"))
-            goto cleanup;
-
-        /* See if any other fatal error occurred */
-        ret = qemuMonitorJSONCheckError(cmd, reply);
-
-        /* Success */
-        if (ret == 0) {
-            virJSONValuePtr data;
-            unsigned long long mem;
-
-            if (!(data = virJSONValueObjectGet(reply, "return"))) {
-                virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                               _("info balloon reply was missing return data"));
-                ret = -1;
-                goto cleanup;
-            }
-
-            if (virJSONValueObjectGetNumberUlong(data, "actual", &mem) < 0) {
-                virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                               _("info balloon reply was missing balloon data"));
-                ret = -1;
-                goto cleanup;
-            }
-
-            *currmem = (mem/1024);
-            ret = 1;
-        }
-    }
+    if (ret == 0)
+        ret = qemuMonitorJSONParseBalloonInfo(cmd, reply, currmem);
 
-cleanup:
     virJSONValueFree(cmd);
     virJSONValueFree(reply);
     return ret;
@@ -1608,6 +1706,11 @@ cleanup:
 }
 
 
+static int
+qemuMonitorJSONQueryBlockStats(qemuMonitorPtr mon,
+                               const char *dev_name,
+                               virHashTablePtr table);
+
 int qemuMonitorJSONGetBlockStatsInfo(qemuMonitorPtr mon,
                                      const char *dev_name,
                                      long long *rd_req,
@@ -1620,13 +1723,9 @@ int qemuMonitorJSONGetBlockStatsInfo(qemuMonitorPtr mon,
                                      long long *flush_total_times,
                                      long long *errs)
 {
-    int ret;
-    int i;
-    int found = 0;
-    virJSONValuePtr cmd = qemuMonitorJSONMakeCommand("query-blockstats",
-                                                     NULL);
-    virJSONValuePtr reply = NULL;
-    virJSONValuePtr devices;
+    int ret = -1;
+    virHashTablePtr table = NULL;
+    qemuBlockStatsPtr stats;
 
     *rd_req = *rd_bytes = -1;
     *wr_req = *wr_bytes = *errs = -1;
@@ -1640,130 +1739,296 @@ int qemuMonitorJSONGetBlockStatsInfo(qemuMonitorPtr mon,
     if (flush_total_times)
         *flush_total_times = -1;
 
-    if (!cmd)
+    if (!(table = virHashCreate(32, virHashValueFree)))
         return -1;
 
-    ret = qemuMonitorJSONCommand(mon, cmd, &reply);
+    if (qemuMonitorJSONQueryBlockStats(mon, dev_name, table) < 0)
+        goto cleanup;
 
-    if (ret == 0)
-        ret = qemuMonitorJSONCheckError(cmd, reply);
-    if (ret < 0)
+    if (!(stats = virHashLookup(table, dev_name))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot find statistics for device '%s'"), dev_name);
         goto cleanup;
-    ret = -1;
+    }
+
+    *rd_req = stats->rd_req;
+    *rd_bytes = stats->rd_bytes;
+    *wr_req = stats->wr_req;
+    *wr_bytes = stats->wr_bytes;
+
+    if (rd_total_times)
+        *rd_total_times = stats->rd_total_times;
+    if (wr_total_times)
+        *wr_total_times = stats->wr_total_times;
+    if (flush_req)
+        *flush_req = stats->flush_req;
+    if (flush_total_times)
+        *flush_total_times = stats->flush_total_times;
+
+    ret = 0;
+
+cleanup:
+    virHashFree(table);
+    return ret;
+}
+
+
+static int
+qemuMonitorJSONGetOneBlockStatsInfo(virJSONValuePtr stats,
+                                    qemuBlockStatsPtr bstats)
+{
+    bstats->rd_total_times = -1;
+    bstats->wr_total_times = -1;
+    bstats->flush_req = -1;
+    bstats->flush_total_times = -1;
+    bstats->errs = -1;
+
+    if (virJSONValueObjectGetNumberLong(stats, "rd_bytes",
+                                        &bstats->rd_bytes) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot read %s statistic"),
+                       "rd_bytes");
+        return -1;
+    }
+    if (virJSONValueObjectGetNumberLong(stats, "rd_operations",
+                                        &bstats->rd_req) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot read %s statistic"),
+                        "rd_operations");
+        return -1;
+    }
+    if (virJSONValueObjectHasKey(stats, "rd_total_time_ns") &&
+        (virJSONValueObjectGetNumberLong(stats, "rd_total_time_ns",
+                                         &bstats->rd_total_times) < 0)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot read %s statistic"),
+                       "rd_total_time_ns");
+        return -1;
+    }
+    if (virJSONValueObjectGetNumberLong(stats, "wr_bytes",
+                                        &bstats->wr_bytes) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot read %s statistic"),
+                       "wr_bytes");
+        return -1;
+    }
+    if (virJSONValueObjectGetNumberLong(stats, "wr_operations",
+                                        &bstats->wr_req) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot read %s statistic"),
+                       "wr_operations");
+        return -1;
+    }
+    if (virJSONValueObjectHasKey(stats, "wr_total_time_ns") &&
+        (virJSONValueObjectGetNumberLong(stats, "wr_total_time_ns",
+                                         &bstats->wr_total_times) < 0)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot read %s statistic"),
+                       "wr_total_time_ns");
+        return -1;
+    }
+    if (virJSONValueObjectHasKey(stats, "flush_operations") &&
+        (virJSONValueObjectGetNumberLong(stats, "flush_operations",
+                                         &bstats->flush_req) < 0)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot read %s statistic"),
+                       "flush_operations");
+        return -1;
+    }
+    if (virJSONValueObjectHasKey(stats, "flush_total_time_ns") &&
+        (virJSONValueObjectGetNumberLong(stats, "flush_total_time_ns",
+                                         &bstats->flush_total_times) < 0)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot read %s statistic"),
+                       "flush_total_time_ns");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* Parse a query-blockstats @reply into @table. If @dev_name is
+ * set, only the statistics of that device are parsed, so a device
+ * with malformed statistics does not fail the lookup of others */
+static int
+qemuMonitorJSONParseAllBlockStatsInfo(virJSONValuePtr cmd,
+                                      virJSONValuePtr reply,
+                                      const char *dev_name,
+                                      virHashTablePtr table)
+{
+    int i;
+    virJSONValuePtr devices;
+
+    if (qemuMonitorJSONCheckError(cmd, reply) < 0)
+        return -1;
 
     devices = virJSONValueObjectGet(reply, "return");
     if (!devices || devices->type != VIR_JSON_TYPE_ARRAY) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("blockstats reply was missing device list"));
-        goto cleanup;
+        return -1;
     }
 
     for (i = 0 ; i < virJSONValueArraySize(devices) ; i++) {
         virJSONValuePtr dev = virJSONValueArrayGet(devices, i);
         virJSONValuePtr stats;
+        qemuBlockStatsPtr bstats;
         const char *thisdev;
         if (!dev || dev->type != VIR_JSON_TYPE_OBJECT) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("blockstats device entry was not in expected format"));
-            goto cleanup;
+            return -1;
         }
 
         if ((thisdev = virJSONValueObjectGetString(dev, "device")) == NULL) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("blockstats device entry was not in expected format"));
-            goto cleanup;
+            return -1;
         }
 
         /* New QEMU has separate names for host & guest side of the disk
-         * and libvirt gives the host side a 'drive-' prefix. The passed
-         * in dev_name is the guest side though
+         * and libvirt gives the host side a 'drive-' prefix. Callers
+         * look the stats up by the guest side name though
          */
         if (STRPREFIX(thisdev, QEMU_DRIVE_HOST_PREFIX))
             thisdev += strlen(QEMU_DRIVE_HOST_PREFIX);
 
-        if (STRNEQ(thisdev, dev_name))
+        if (dev_name && STRNEQ(thisdev, dev_name))
             continue;
 
-        found = 1;
         if ((stats = virJSONValueObjectGet(dev, "stats")) == NULL ||
             stats->type != VIR_JSON_TYPE_OBJECT) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("blockstats stats entry was not in expected format"));
-            goto cleanup;
+            return -1;
         }
 
-        if (virJSONValueObjectGetNumberLong(stats, "rd_bytes", rd_bytes) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("cannot read %s statistic"),
-                           "rd_bytes");
-            goto cleanup;
-        }
-        if (virJSONValueObjectGetNumberLong(stats, "rd_operations", rd_req) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("cannot read %s statistic"),
-                            "rd_operations");
-            goto cleanup;
-        }
-        if (rd_total_times &&
-            virJSONValueObjectHasKey(stats, "rd_total_time_ns") &&
-            (virJSONValueObjectGetNumberLong(stats, "rd_total_time_ns",
-                                             rd_total_times) < 0)) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("cannot read %s statistic"),
-                           "rd_total_time_ns");
-            goto cleanup;
-        }
-        if (virJSONValueObjectGetNumberLong(stats, "wr_bytes", wr_bytes) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("cannot read %s statistic"),
-                           "wr_bytes");
-            goto cleanup;
-        }
-        if (virJSONValueObjectGetNumberLong(stats, "wr_operations", wr_req) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("cannot read %s statistic"),
-                           "wr_operations");
-            goto cleanup;
-        }
-        if (wr_total_times &&
-            virJSONValueObjectHasKey(stats, "wr_total_time_ns") &&
-            (virJSONValueObjectGetNumberLong(stats, "wr_total_time_ns",
-                                             wr_total_times) < 0)) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("cannot read %s statistic"),
-                           "wr_total_time_ns");
-            goto cleanup;
-        }
-        if (flush_req &&
-            virJSONValueObjectHasKey(stats, "flush_operations") &&
-            (virJSONValueObjectGetNumberLong(stats, "flush_operations",
-                                            flush_req) < 0)) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("cannot read %s statistic"),
-                           "flush_operations");
-            goto cleanup;
+        if (VIR_ALLOC(bstats) < 0) {
+            virReportOOMError();
+            return -1;
         }
-        if (flush_total_times &&
-            virJSONValueObjectHasKey(stats, "flush_total_time_ns") &&
-            (virJSONValueObjectGetNumberLong(stats, "flush_total_time_ns",
-                                            flush_total_times) < 0)) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("cannot read %s statistic"),
-                           "flush_total_time_ns");
-            goto cleanup;
+
+        if (qemuMonitorJSONGetOneBlockStatsInfo(stats, bstats) < 0 ||
+            virHashAddEntry(table, thisdev, bstats) < 0) {
+            VIR_FREE(bstats);
+            return -1;
         }
     }
 
-    if (!found) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("cannot find statistics for device '%s'"), dev_name);
-        goto cleanup;
+    return 0;
+}
+
+
+static int
+qemuMonitorJSONQueryBlockStats(qemuMonitorPtr mon,
+                               const char *dev_name,
+                               virHashTablePtr table)
+{
+    int ret;
+    virJSONValuePtr cmd = qemuMonitorJSONMakeCommand("query-blockstats",
+                                                     NULL);
+    virJSONValuePtr reply = NULL;
+
+    if (!cmd)
+        return -1;
+
+    ret = qemuMonitorJSONCommand(mon, cmd, &reply);
+
+    if (ret == 0)
+        ret = qemuMonitorJSONParseAllBlockStatsInfo(cmd, reply,
+                                                    dev_name, table);
+
+    virJSONValueFree(cmd);
+    virJSONValueFree(reply);
+    return ret;
+}
+
+
+/* Fill @table with qemuBlockStats for every device reported by a
+ * single query-blockstats command, keyed by the guest side device
+ * name (i.e. with the QEMU_DRIVE_HOST_PREFIX stripped). */
+int qemuMonitorJSONGetAllBlockStatsInfo(qemuMonitorPtr mon,
+                                        virHashTablePtr table)
+{
+    return qemuMonitorJSONQueryBlockStats(mon, NULL, table);
+}
+
+
+/*
+ * Issue query-balloon and/or query-blockstats back to back and wait
+ * for both replies together, so collecting a domain's stats costs
+ * one monitor round trip instead of two. If @blockstats is set,
+ * stats->blockstats must be an empty table to fill; it is freed and
+ * cleared if its command fails.
+ */
+int qemuMonitorJSONGetDomainStats(qemuMonitorPtr mon,
+                                  bool balloon,
+                                  bool blockstats,
+                                  qemuMonitorDomainStatsPtr stats)
+{
+    int ret = -1;
+    virJSONValuePtr cmds[2] = { NULL, NULL };
+    virJSONValuePtr replies[2] = { NULL, NULL };
+    size_t ncmds = 0;
+    int balloonIdx = -1;
+    int blockIdx = -1;
+    size_t i;
+
+    stats->balloonRet = 0;
+    stats->balloon = 0;
+
+    if (balloon) {
+        if (!(cmds[ncmds] = qemuMonitorJSONMakeCommand("query-balloon",
+                                                       NULL)))
+            goto error;
+        balloonIdx = ncmds++;
     }
+    if (blockstats && stats->blockstats) {
+        if (!(cmds[ncmds] = qemuMonitorJSONMakeCommand("query-blockstats",
+                                                       NULL)))
+            goto error;
+        blockIdx = ncmds++;
+    }
+
+    if (ncmds == 0)
+        return 0;
+
+    if (qemuMonitorJSONCommands(mon, cmds, ncmds, replies) < 0)
+        goto error;
+
+    /* Parse each reply independently, so that one failing command
+     * doesn't lose the results of the other */
     ret = 0;
+    if (balloonIdx >= 0 &&
+        (stats->balloonRet =
+         qemuMonitorJSONParseBalloonInfo(cmds[balloonIdx],
+                                         replies[balloonIdx],
+                                         &stats->balloon)) < 0)
+        ret = -1;
+
+    if (blockIdx >= 0 &&
+        qemuMonitorJSONParseAllBlockStatsInfo(cmds[blockIdx],
+                                              replies[blockIdx],
+                                              NULL,
+                                              stats->blockstats) < 0) {
+        virHashFree(stats->blockstats);
+        stats->blockstats = NULL;
+        ret = -1;
+    }
+    goto cleanup;
+
+error:
+    if (balloon)
+        stats->balloonRet = -1;
+    virHashFree(stats->blockstats);
+    stats->blockstats = NULL;
 
 cleanup:
-    virJSONValueFree(cmd);
-    virJSONValueFree(reply);
+    for (i = 0 ; i < ARRAY_CARDINALITY(cmds) ; i++) {
+        virJSONValueFree(cmds[i]);
+        virJSONValueFree(replies[i]);
+    }
     return ret;
 }
 
@@ -2258,14 +2523,13 @@ int qemuMonitorJSONSetMigrationDowntime(qemuMonitorPtr mon,
 
 static int
 qemuMonitorJSONGetMigrationStatusReply(virJSONValuePtr reply,
-                                       int *status,
-                                       unsigned long long *transferred,
-                                       unsigned long long *remaining,
-                                       unsigned long long *total)
+                                       qemuMonitorMigrationStatusPtr status)
 {
     virJSONValuePtr ret;
+    virJSONValuePtr ram;
+    virJSONValuePtr disk;
     const char *statusstr;
-    unsigned long long t;
+    double mbps;
 
     if (!(ret = virJSONValueObjectGet(reply, "return"))) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -2279,66 +2543,106 @@ qemuMonitorJSONGetMigrationStatusReply(virJSONValuePtr reply,
         return -1;
     }
 
-    if ((*status = qemuMonitorMigrationStatusTypeFromString(statusstr)) < 0) {
+    status->status = qemuMonitorMigrationStatusTypeFromString(statusstr);
+    if (status->status < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("unexpected migration status in %s"), statusstr);
         return -1;
     }
 
-    if (*status == QEMU_MONITOR_MIGRATION_STATUS_ACTIVE) {
-        virJSONValuePtr ram = virJSONValueObjectGet(ret, "ram");
-        if (!ram) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("migration was active, but no RAM info was set"));
-            return -1;
-        }
+    if (status->status != QEMU_MONITOR_MIGRATION_STATUS_ACTIVE &&
+        status->status != QEMU_MONITOR_MIGRATION_STATUS_COMPLETED)
+        return 0;
 
-        if (virJSONValueObjectGetNumberUlong(ram, "transferred",
-                                             transferred) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("migration was active, but RAM 'transferred' "
-                             "data was missing"));
-            return -1;
-        }
-        if (virJSONValueObjectGetNumberUlong(ram, "remaining", remaining) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("migration was active, but RAM 'remaining' "
-                             "data was missing"));
-            return -1;
-        }
-        if (virJSONValueObjectGetNumberUlong(ram, "total", total) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("migration was active, but RAM 'total' "
-                             "data was missing"));
-            return -1;
-        }
+    /* Everything below except RAM transfer counters is optional, as
+     * older QEMU reports only a subset of it */
+    virJSONValueObjectGetNumberUlong(ret, "total-time", &status->total_time);
+    if (status->status == QEMU_MONITOR_MIGRATION_STATUS_COMPLETED) {
+        if (virJSONValueObjectGetNumberUlong(ret, "downtime",
+                                             &status->downtime) == 0)
+            status->downtime_set = true;
+    } else {
+        if (virJSONValueObjectGetNumberUlong(ret, "expected-downtime",
+                                             &status->downtime) == 0)
+            status->downtime_set = true;
+    }
+    if (virJSONValueObjectGetNumberUlong(ret, "setup-time",
+                                         &status->setup_time) == 0)
+        status->setup_time_set = true;
 
-        virJSONValuePtr disk = virJSONValueObjectGet(ret, "disk");
-        if (!disk) {
+    if (!(ram = virJSONValueObjectGet(ret, "ram"))) {
+        /* A completed migration of an old QEMU may lack the stats */
+        if (status->status == QEMU_MONITOR_MIGRATION_STATUS_COMPLETED)
             return 0;
-        }
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("migration was active, but no RAM info was set"));
+        return -1;
+    }
 
-        if (virJSONValueObjectGetNumberUlong(disk, "transferred", &t) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("disk migration was active, but 'transferred' "
-                             "data was missing"));
-            return -1;
-        }
-        *transferred += t;
-        if (virJSONValueObjectGetNumberUlong(disk, "remaining", &t) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("disk migration was active, but 'remaining' "
-                             "data was missing"));
-            return -1;
-        }
-        *remaining += t;
-        if (virJSONValueObjectGetNumberUlong(disk, "total", &t) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("disk migration was active, but 'total' "
-                             "data was missing"));
-            return -1;
-        }
-        *total += t;
+    if (virJSONValueObjectGetNumberUlong(ram, "transferred",
+                                         &status->ram_transferred) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("migration was active, but RAM 'transferred' "
+                         "data was missing"));
+        return -1;
+    }
+    if (virJSONValueObjectGetNumberUlong(ram, "remaining",
+                                         &status->ram_remaining) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("migration was active, but RAM 'remaining' "
+                         "data was missing"));
+        return -1;
+    }
+    if (virJSONValueObjectGetNumberUlong(ram, "total",
+                                         &status->ram_total) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("migration was active, but RAM 'total' "
+                         "data was missing"));
+        return -1;
+    }
+
+    if (virJSONValueObjectGetNumberUlong(ram, "duplicate",
+                                         &status->ram_duplicate) == 0)
+        status->ram_duplicate_set = true;
+    virJSONValueObjectGetNumberUlong(ram, "normal", &status->ram_normal);
+    virJSONValueObjectGetNumberUlong(ram, "normal-bytes",
+                                     &status->ram_normal_bytes);
+    if (virJSONValueObjectGetNumberUlong(ram, "dirty-pages-rate",
+                                         &status->ram_dirty_rate) == 0)
+        status->ram_dirty_rate_set = true;
+    if (virJSONValueObjectGetNumberDouble(ram, "mbps", &mbps) == 0 &&
+        mbps > 0) {
+        /* QEMU reports throughput in Mbit/s, we want bytes/s */
+        status->ram_bps = mbps * (1000 * 1000 / 8);
+        status->ram_bps_set = true;
+    }
+    if (virJSONValueObjectGetNumberUlong(ram, "dirty-sync-count",
+                                         &status->ram_iteration) == 0)
+        status->ram_iteration_set = true;
+
+    if (!(disk = virJSONValueObjectGet(ret, "disk")))
+        return 0;
+
+    if (virJSONValueObjectGetNumberUlong(disk, "transferred",
+                                         &status->disk_transferred) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("disk migration was active, but 'transferred' "
+                         "data was missing"));
+        return -1;
+    }
+    if (virJSONValueObjectGetNumberUlong(disk, "remaining",
+                                         &status->disk_remaining) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("disk migration was active, but 'remaining' "
+                         "data was missing"));
+        return -1;
+    }
+    if (virJSONValueObjectGetNumberUlong(disk, "total",
+                                         &status->disk_total) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("disk migration was active, but 'total' "
+                         "data was missing"));
+        return -1;
     }
 
     return 0;
@@ -2346,18 +2650,14 @@ qemuMonitorJSONGetMigrationStatusReply(virJSONValuePtr reply,
 
 
 int qemuMonitorJSONGetMigrationStatus(qemuMonitorPtr mon,
-                                      int *status,
-                                      unsigned long long *transferred,
-                                      unsigned long long *remaining,
-                                      unsigned long long *total)
+                                      qemuMonitorMigrationStatusPtr status)
 {
     int ret;
     virJSONValuePtr cmd = qemuMonitorJSONMakeCommand("query-migrate",
                                                      NULL);
     virJSONValuePtr reply = NULL;
 
-    *status = 0;
-    *transferred = *remaining = *total = 0;
+    memset(status, 0, sizeof(*status));
 
     if (!cmd)
         return -1;
@@ -2368,13 +2668,12 @@ int qemuMonitorJSONGetMigrationStatus(qemuMonitorPtr mon,
         ret = qemuMonitorJSONCheckError(cmd, reply);
 
     if (ret == 0 &&
-        qemuMonitorJSONGetMigrationStatusReply(reply,
-                                               status,
-                                               transferred,
-                                               remaining,
-                                               total) < 0)
+        qemuMonitorJSONGetMigrationStatusReply(reply, status) < 0)
         ret = -1;
 
+    if (ret < 0)
+        memset(status, 0, sizeof(*status));
+
     virJSONValueFree(cmd);
     virJSONValueFree(reply);
     return ret;
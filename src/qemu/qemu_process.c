@@ -91,7 +91,7 @@ qemuProcessRemoveDomainStatus(virQEMUDriverPtr driver,
     char *file = NULL;
     qemuDomainObjPrivatePtr priv = vm->privateData;
 
-    if (virAsprintf(&file, "%s/%s.xml", driver->stateDir, vm->def->name) < 0) {
+    if (virAsprintf(&file, "%s/%s.xml", driver->config->stateDir, vm->def->name) < 0) {
         virReportOOMError();
         return -1;
     }
@@ -567,7 +567,8 @@ qemuProcessFakeReboot(void *opaque)
     VIR_DEBUG("vm=%p", vm);
     qemuDriverLock(driver);
     virObjectLock(vm);
-    if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_MODIFY) < 0)
+    if (qemuDomainObjBeginInternalJobWithDriver(driver, vm,
+                                                QEMU_JOB_MODIFY) < 0)
         goto cleanup;
 
     if (!virDomainObjIsActive(vm)) {
@@ -680,7 +681,7 @@ qemuProcessHandleShutdown(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
                                      VIR_DOMAIN_EVENT_SHUTDOWN,
                                      VIR_DOMAIN_EVENT_SHUTDOWN_FINISHED);
 
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+    if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
         VIR_WARN("Unable to save status on vm %s after state change",
                  vm->def->name);
     }
@@ -732,7 +733,7 @@ qemuProcessHandleStop(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
             VIR_WARN("Unable to release lease on %s", vm->def->name);
         VIR_DEBUG("Preserving lock state '%s'", NULLSTR(priv->lockState));
 
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
             VIR_WARN("Unable to save status on vm %s after state change",
                      vm->def->name);
         }
@@ -777,7 +778,7 @@ qemuProcessHandleResume(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
                                          VIR_DOMAIN_EVENT_RESUMED_UNPAUSED);
 
         VIR_DEBUG("Using lock state '%s' on resume event", NULLSTR(priv->lockState));
-        if (virDomainLockProcessResume(driver->lockManager, driver->uri,
+        if (virDomainLockProcessResume(driver->lockManager, driver->config->uri,
                                        vm, priv->lockState) < 0) {
             /* Don't free priv->lockState on error, because we need
              * to make sure we have state still present if the user
@@ -787,7 +788,7 @@ qemuProcessHandleResume(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
         }
         VIR_FREE(priv->lockState);
 
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
             VIR_WARN("Unable to save status on vm %s after state change",
                      vm->def->name);
         }
@@ -820,7 +821,7 @@ qemuProcessHandleRTCChange(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     if (vm->def->clock.offset == VIR_DOMAIN_CLOCK_OFFSET_VARIABLE)
         vm->def->clock.data.variable.adjustment = offset;
 
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
+    if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0)
         VIR_WARN("unable to save domain status with RTC change");
 
     virObjectUnlock(vm);
@@ -862,7 +863,7 @@ qemuProcessHandleWatchdog(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
             VIR_WARN("Unable to release lease on %s", vm->def->name);
         VIR_DEBUG("Preserving lock state '%s'", NULLSTR(priv->lockState));
 
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
             VIR_WARN("Unable to save status on vm %s after watchdog event",
                      vm->def->name);
         }
@@ -947,7 +948,7 @@ qemuProcessHandleIOError(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
             VIR_WARN("Unable to release lease on %s", vm->def->name);
         VIR_DEBUG("Preserving lock state '%s'", NULLSTR(priv->lockState));
 
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0)
             VIR_WARN("Unable to save status on vm %s after IO error", vm->def->name);
     }
     virObjectUnlock(vm);
@@ -1131,7 +1132,7 @@ qemuProcessHandleTrayChange(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
         else if (reason == VIR_DOMAIN_EVENT_TRAY_CHANGE_CLOSE)
             disk->tray_status = VIR_DOMAIN_DISK_TRAY_CLOSED;
 
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
             VIR_WARN("Unable to save status on vm %s after tray moved event",
                      vm->def->name);
         }
@@ -1172,7 +1173,7 @@ qemuProcessHandlePMWakeup(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
                                                   VIR_DOMAIN_EVENT_STARTED,
                                                   VIR_DOMAIN_EVENT_STARTED_WAKEUP);
 
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
             VIR_WARN("Unable to save status on vm %s after wakeup event",
                      vm->def->name);
         }
@@ -1215,7 +1216,7 @@ qemuProcessHandlePMSuspend(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
                                      VIR_DOMAIN_EVENT_PMSUSPENDED,
                                      VIR_DOMAIN_EVENT_PMSUSPENDED_MEMORY);
 
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
             VIR_WARN("Unable to save status on vm %s after suspend event",
                      vm->def->name);
         }
@@ -1253,7 +1254,7 @@ qemuProcessHandleBalloonChange(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
               vm->def->mem.cur_balloon, actual);
     vm->def->mem.cur_balloon = actual;
 
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
+    if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0)
         VIR_WARN("unable to save domain status with balloon change");
 
     virObjectUnlock(vm);
@@ -1290,7 +1291,7 @@ qemuProcessHandlePMSuspendDisk(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
                                      VIR_DOMAIN_EVENT_PMSUSPENDED,
                                      VIR_DOMAIN_EVENT_PMSUSPENDED_DISK);
 
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+        if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
             VIR_WARN("Unable to save status on vm %s after suspend event",
                      vm->def->name);
         }
@@ -2187,12 +2188,12 @@ qemuProcessInitPasswords(virConnectPtr conn,
             ret = qemuDomainChangeGraphicsPasswords(driver, vm,
                                                     VIR_DOMAIN_GRAPHICS_TYPE_VNC,
                                                     &graphics->data.vnc.auth,
-                                                    driver->vncPassword);
+                                                    driver->config->vncPassword);
         } else if (graphics->type == VIR_DOMAIN_GRAPHICS_TYPE_SPICE) {
             ret = qemuDomainChangeGraphicsPasswords(driver, vm,
                                                     VIR_DOMAIN_GRAPHICS_TYPE_SPICE,
                                                     &graphics->data.spice.auth,
-                                                    driver->spicePassword);
+                                                    driver->config->spicePassword);
         }
     }
 
@@ -2647,24 +2648,24 @@ qemuProcessLimits(virQEMUDriverPtr driver)
 {
     struct rlimit rlim;
 
-    if (driver->maxProcesses > 0) {
-        rlim.rlim_cur = rlim.rlim_max = driver->maxProcesses;
+    if (driver->config->maxProcesses > 0) {
+        rlim.rlim_cur = rlim.rlim_max = driver->config->maxProcesses;
         if (setrlimit(RLIMIT_NPROC, &rlim) < 0) {
             virReportSystemError(errno,
                                  _("cannot limit number of processes to %d"),
-                                 driver->maxProcesses);
+                                 driver->config->maxProcesses);
             return -1;
         }
     }
 
-    if (driver->maxFiles > 0) {
+    if (driver->config->maxFiles > 0) {
         /* Max number of opened files is one greater than
          * actual limit. See man setrlimit */
-        rlim.rlim_cur = rlim.rlim_max = driver->maxFiles + 1;
+        rlim.rlim_cur = rlim.rlim_max = driver->config->maxFiles + 1;
         if (setrlimit(RLIMIT_NOFILE, &rlim) < 0) {
             virReportSystemError(errno,
                                  _("cannot set max opened files to %d"),
-                                 driver->maxFiles);
+                                 driver->config->maxFiles);
             return -1;
         }
     }
@@ -2700,7 +2701,7 @@ static int qemuProcessHook(void *data)
     if (virSecurityManagerSetSocketLabel(h->driver->securityManager, h->vm->def) < 0)
         goto cleanup;
     if (virDomainLockProcessStart(h->driver->lockManager,
-                                  h->driver->uri,
+                                  h->driver->config->uri,
                                   h->vm,
                                   /* QEMU is always paused initially */
                                   true,
@@ -2748,7 +2749,7 @@ qemuProcessPrepareMonitorChr(virQEMUDriverPtr driver,
     monConfig->data.nix.listen = true;
 
     if (virAsprintf(&monConfig->data.nix.path, "%s/%s.monitor",
-                    driver->libDir, vm) < 0) {
+                    driver->config->libDir, vm) < 0) {
         virReportOOMError();
         return -1;
     }
@@ -2771,7 +2772,7 @@ qemuProcessStartCPUs(virQEMUDriverPtr driver, virDomainObjPtr vm,
     qemuDomainObjPrivatePtr priv = vm->privateData;
 
     VIR_DEBUG("Using lock state '%s'", NULLSTR(priv->lockState));
-    if (virDomainLockProcessResume(driver->lockManager, driver->uri,
+    if (virDomainLockProcessResume(driver->lockManager, driver->config->uri,
                                    vm, priv->lockState) < 0) {
         /* Don't free priv->lockState on error, because we need
          * to make sure we have state still present if the user
@@ -3132,19 +3133,31 @@ struct qemuProcessReconnectData {
     virQEMUDriverPtr driver;
     void *payload;
     struct qemuDomainJobObj oldjob;
+    int priority;
+    size_t order;
 };
+
+struct qemuProcessReconnectList {
+    virConnectPtr conn;
+    virQEMUDriverPtr driver;
+    struct qemuProcessReconnectData **items;
+    size_t nitems;
+    size_t nitems_max;
+};
+
 /*
  * Open an existing VM's monitor, re-detect VCPU threads
  * and re-reserve the security labels in use
  *
- * We own the virConnectPtr we are passed here - whoever started
- * this thread function has increased the reference counter to it
- * so that we now have to close it.
+ * Runs in a worker of driver->reconnectPool. We own the
+ * virConnectPtr we are passed here - whoever queued this job
+ * has increased the reference counter to it so that we now
+ * have to close it.
  */
 static void
-qemuProcessReconnect(void *opaque)
+qemuProcessReconnect(void *jobdata, void *opaque ATTRIBUTE_UNUSED)
 {
-    struct qemuProcessReconnectData *data = opaque;
+    struct qemuProcessReconnectData *data = jobdata;
     virQEMUDriverPtr driver = data->driver;
     virDomainObjPtr obj = data->payload;
     qemuDomainObjPrivatePtr priv;
@@ -3242,7 +3255,7 @@ qemuProcessReconnect(void *opaque)
         goto error;
 
     /* update domain state XML with possibly updated state in virDomainObj */
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, obj) < 0)
+    if (virDomainSaveStatus(driver->caps, driver->config->stateDir, obj) < 0)
         goto error;
 
     /* Run an hook to allow admins to do some magic */
@@ -3267,6 +3280,7 @@ qemuProcessReconnect(void *opaque)
     driver->nactive++;
 
 endjob:
+    priv->reconnecting = false;
     if (!qemuDomainObjEndJob(driver, obj))
         obj = NULL;
 
@@ -3280,6 +3294,7 @@ endjob:
     return;
 
 error:
+    priv->reconnecting = false;
     if (!qemuDomainObjEndJob(driver, obj))
         obj = NULL;
 
@@ -3323,22 +3338,26 @@ qemuProcessReconnectHelper(void *payload,
                            const void *name ATTRIBUTE_UNUSED,
                            void *opaque)
 {
-    virThread thread;
-    struct qemuProcessReconnectData *src = opaque;
+    struct qemuProcessReconnectList *list = opaque;
     struct qemuProcessReconnectData *data;
     virDomainObjPtr obj = payload;
+    qemuDomainObjPrivatePtr priv = obj->privateData;
 
-    if (VIR_ALLOC(data) < 0) {
+    if (VIR_ALLOC(data) < 0 ||
+        VIR_RESIZE_N(list->items, list->nitems_max, list->nitems, 1) < 0) {
         virReportOOMError();
+        VIR_FREE(data);
         return;
     }
 
-    memcpy(data, src, sizeof(*data));
+    data->conn = list->conn;
+    data->driver = list->driver;
     data->payload = payload;
+    data->order = list->nitems;
 
     /* This iterator is called with driver being locked.
-     * We create a separate thread to run qemuProcessReconnect in it.
-     * However, qemuProcessReconnect needs to:
+     * We queue a job which runs qemuProcessReconnect in one of
+     * the reconnect workers. However, qemuProcessReconnect needs to:
      * 1. lock driver
      * 2. just before monitor reconnect do lightweight MonitorEnter
      *    (increase VM refcount, unlock VM & driver)
@@ -3363,41 +3382,87 @@ qemuProcessReconnectHelper(void *payload,
 
     qemuDomainObjRestoreJob(obj, &data->oldjob);
 
-    if (qemuDomainObjBeginJobWithDriver(src->driver, obj, QEMU_JOB_MODIFY) < 0)
-        goto error;
+    if (qemuDomainObjBeginJobWithDriver(list->driver, obj,
+                                        QEMU_JOB_MODIFY) < 0) {
+        virObjectUnlock(obj);
+        VIR_FREE(data);
+        return;
+    }
+
+    /* Until the job ends, any API which needs a job fails
+     * straight away instead of waiting for the worker */
+    priv->reconnecting = true;
+
+    data->priority = qemuProcessReconnectPriority(obj,
+                                                  data->oldjob.asyncJob);
 
     /* Since we close the connection later on, we have to make sure
-     * that the threads we start see a valid connection throughout their
-     * lifetime. We simply increase the reference counter here.
+     * that the workers see a valid connection throughout the
+     * lifetime of the job. We simply increase the reference counter
+     * here.
      */
     virConnectRef(data->conn);
 
-    if (virThreadCreate(&thread, true, qemuProcessReconnect, data) < 0) {
+    list->items[list->nitems++] = data;
 
-        virConnectClose(data->conn);
+    virObjectUnlock(obj);
+}
 
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Could not create thread. QEMU initialization "
-                         "might be incomplete"));
-        if (!qemuDomainObjEndJob(src->driver, obj)) {
-            obj = NULL;
-        } else if (virObjectUnref(obj)) {
-           /* We can't spawn a thread and thus connect to monitor.
-            * Kill qemu */
-            qemuProcessStop(src->driver, obj, VIR_DOMAIN_SHUTOFF_FAILED, 0);
-            if (!obj->persistent)
-                qemuDomainRemoveInactive(src->driver, obj);
-            else
-                virObjectUnlock(obj);
-        }
-        goto error;
-    }
+/*
+ * Tell how urgently @obj must be reconnected, given the async job
+ * which was running when libvirtd stopped. Domains are reconnected
+ * in increasing order of the result.
+ */
+enum qemuProcessReconnectPriority
+qemuProcessReconnectPriority(virDomainObjPtr obj,
+                             enum qemuDomainAsyncJob asyncJob)
+{
+    if (asyncJob != QEMU_ASYNC_JOB_NONE)
+        return QEMU_PROCESS_RECONNECT_JOB;
+    if (virDomainObjGetState(obj, NULL) == VIR_DOMAIN_RUNNING)
+        return QEMU_PROCESS_RECONNECT_RUNNING;
+    return QEMU_PROCESS_RECONNECT_OTHER;
+}
 
-    virObjectUnlock(obj);
+static int
+qemuProcessReconnectCompare(const void *a, const void *b)
+{
+    const struct qemuProcessReconnectData *da =
+        *(struct qemuProcessReconnectData * const *)a;
+    const struct qemuProcessReconnectData *db =
+        *(struct qemuProcessReconnectData * const *)b;
+
+    if (da->priority != db->priority)
+        return da->priority - db->priority;
+    if (da->order != db->order)
+        return da->order < db->order ? -1 : 1;
+    return 0;
+}
 
-    return;
+/*
+ * Undo qemuProcessReconnectHelper for a domain which could not be
+ * handed to a worker. Must be called with driver locked.
+ */
+static void
+qemuProcessReconnectAbort(struct qemuProcessReconnectData *data)
+{
+    virQEMUDriverPtr driver = data->driver;
+    virDomainObjPtr obj = data->payload;
+    qemuDomainObjPrivatePtr priv = obj->privateData;
 
-error:
+    virObjectLock(obj);
+    priv->reconnecting = false;
+
+    if (qemuDomainObjEndJob(driver, obj)) {
+        /* We can't connect to the monitor. Kill qemu */
+        qemuProcessStop(driver, obj, VIR_DOMAIN_SHUTOFF_FAILED, 0);
+        if (!obj->persistent)
+            qemuDomainRemoveInactive(driver, obj);
+        else
+            virObjectUnlock(obj);
+    }
+
+    virConnectClose(data->conn);
     VIR_FREE(data);
 }
 
@@ -3405,13 +3470,54 @@ error:
  * qemuProcessReconnectAll
  *
  * Try to re-open the resources for live VMs that we care
- * about.
+ * about. Domains are queued to a pool of at most
+ * max_reconnect_workers threads, those with an interrupted
+ * async job first, then running ones, then the rest. Domains
+ * are usable for APIs which don't need a job as soon as this
+ * returns; see qemuDomainObjPrivate.reconnecting.
  */
 void
 qemuProcessReconnectAll(virConnectPtr conn, virQEMUDriverPtr driver)
 {
-    struct qemuProcessReconnectData data = {.conn = conn, .driver = driver};
-    virHashForEach(driver->domains.objs, qemuProcessReconnectHelper, &data);
+    virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
+    struct qemuProcessReconnectList list = {.conn = conn, .driver = driver};
+    size_t i;
+
+    virDomainObjListForEach(&driver->domains, qemuProcessReconnectHelper, &list);
+
+    if (list.nitems == 0)
+        goto cleanup;
+
+    qsort(list.items, list.nitems, sizeof(*list.items),
+          qemuProcessReconnectCompare);
+
+    if (!driver->reconnectPool)
+        driver->reconnectPool = virThreadPoolNew(0, cfg->maxReconnectWorkers,
+                                                 0, qemuProcessReconnect,
+                                                 NULL);
+
+    VIR_DEBUG("Reconnecting to %zu domains with %d workers",
+              list.nitems, cfg->maxReconnectWorkers);
+
+    /* The pool has no priority workers, so jobs sent with a priority
+     * all go through its shared lane, which every worker takes from
+     * in the order above. Jobs sent without one would be spread over
+     * the queues of the workers, where those stuck behind a slow
+     * domain could be overtaken by less urgent ones */
+    for (i = 0; i < list.nitems; i++) {
+        if (!driver->reconnectPool ||
+            virThreadPoolSendJob(driver->reconnectPool, 1,
+                                 list.items[i]) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Could not queue reconnect job. QEMU "
+                             "initialization might be incomplete"));
+            qemuProcessReconnectAbort(list.items[i]);
+        }
+    }
+
+cleanup:
+    VIR_FREE(list.items);
+    virObjectUnref(cfg);
 }
 
 int
@@ -3548,7 +3654,7 @@ int qemuProcessStart(virConnectPtr conn,
     if (virDomainObjSetDefTransient(driver->caps, vm, true) < 0)
         goto cleanup;
 
-    vm->def->id = driver->nextvmid++;
+    virDomainObjListSetID(&driver->domains, vm, driver->nextvmid++);
     qemuDomainSetFakeReboot(driver, vm, false);
     virDomainObjSetState(vm, VIR_DOMAIN_SHUTOFF, VIR_DOMAIN_SHUTOFF_UNKNOWN);
 
@@ -3594,9 +3700,9 @@ int qemuProcessStart(virConnectPtr conn,
     }
     virDomainAuditSecurityLabel(vm, true);
 
-    if (driver->hugepage_path && vm->def->mem.hugepage_backed) {
+    if (driver->config->hugepagePath && vm->def->mem.hugepage_backed) {
         if (virSecurityManagerSetHugepages(driver->securityManager,
-                    vm->def, driver->hugepage_path) < 0) {
+                    vm->def, driver->config->hugepagePath) < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR,
                     "%s", _("Unable to set huge path in security driver"));
             goto cleanup;
@@ -3632,7 +3738,7 @@ int qemuProcessStart(virConnectPtr conn,
 
                 graphics->data.spice.port = port;
             }
-            if (driver->spiceTLS &&
+            if (driver->config->spiceTLS &&
                 (graphics->data.spice.autoport ||
                  graphics->data.spice.tlsPort == -1)) {
                 unsigned short tlsPort;
@@ -3659,9 +3765,9 @@ int qemuProcessStart(virConnectPtr conn,
                 }
                 graphics->listens[0].type = VIR_DOMAIN_GRAPHICS_LISTEN_TYPE_ADDRESS;
                 if (graphics->type == VIR_DOMAIN_GRAPHICS_TYPE_VNC)
-                    graphics->listens[0].address = strdup(driver->vncListen);
+                    graphics->listens[0].address = strdup(driver->config->vncListen);
                 else
-                    graphics->listens[0].address = strdup(driver->spiceListen);
+                    graphics->listens[0].address = strdup(driver->config->spiceListen);
                 if (!graphics->listens[0].address) {
                     VIR_SHRINK_N(graphics->listens, graphics->nListens, 1);
                     virReportOOMError();
@@ -3671,10 +3777,10 @@ int qemuProcessStart(virConnectPtr conn,
         }
     }
 
-    if (virFileMakePath(driver->logDir) < 0) {
+    if (virFileMakePath(driver->config->logDir) < 0) {
         virReportSystemError(errno,
                              _("cannot create log directory %s"),
-                             driver->logDir);
+                             driver->config->logDir);
         goto cleanup;
     }
 
@@ -3749,7 +3855,7 @@ int qemuProcessStart(virConnectPtr conn,
     priv->gotShutdown = false;
 
     VIR_FREE(priv->pidfile);
-    if (!(priv->pidfile = virPidFileBuildPath(driver->stateDir, vm->def->name))) {
+    if (!(priv->pidfile = virPidFileBuildPath(driver->config->stateDir, vm->def->name))) {
         virReportSystemError(errno,
                              "%s", _("Failed to build pidfile path."));
         goto cleanup;
@@ -3821,8 +3927,8 @@ int qemuProcessStart(virConnectPtr conn,
                  virStrerror(errno, ebuf, sizeof(ebuf)));
 
     VIR_DEBUG("Clear emulator capabilities: %d",
-              driver->clearEmulatorCapabilities);
-    if (driver->clearEmulatorCapabilities)
+              driver->config->clearEmulatorCapabilities);
+    if (driver->config->clearEmulatorCapabilities)
         virCommandClearCaps(cmd);
 
     /* in case a certain disk is desirous of CAP_SYS_RAWIO, add this */
@@ -3887,7 +3993,7 @@ int qemuProcessStart(virConnectPtr conn,
     }
 
     VIR_DEBUG("Writing early domain status to disk");
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+    if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0) {
         goto cleanup;
     }
 
@@ -4038,7 +4144,7 @@ int qemuProcessStart(virConnectPtr conn,
         goto cleanup;
 
     VIR_DEBUG("Writing domain status to disk");
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
+    if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0)
         goto cleanup;
 
     /* finally we can call the 'started' hook script if any */
@@ -4147,7 +4253,7 @@ void qemuProcessStop(virQEMUDriverPtr driver,
      * can lock driver and vm, and then call qemuProcessStop(). So we should
      * set vm->def->id to -1 here to avoid qemuProcessStop() to be called twice.
      */
-    vm->def->id = -1;
+    virDomainObjListSetID(&driver->domains, vm, -1);
 
     driver->nactive--;
     if (!driver->nactive && driver->inhibitCallback)
@@ -4183,7 +4289,7 @@ void qemuProcessStop(virQEMUDriverPtr driver,
 
     virDomainConfVMNWFilterTeardown(vm);
 
-    if (driver->macFilter) {
+    if (driver->config->macFilter) {
         def = vm->def;
         for (i = 0 ; i < def->nnets ; i++) {
             virDomainNetDefPtr net = def->nets[i];
@@ -4277,7 +4383,7 @@ void qemuProcessStop(virQEMUDriverPtr driver,
                              virDomainNetGetActualDirectDev(net),
                              virDomainNetGetActualDirectMode(net),
                              virDomainNetGetActualVirtPortProfile(net),
-                             driver->stateDir));
+                             driver->config->stateDir));
             VIR_FREE(net->ifname);
         }
         /* release the physical device (or any other resources used by
@@ -4393,16 +4499,16 @@ int qemuProcessAttach(virConnectPtr conn ATTRIBUTE_UNUSED,
     if (virDomainObjSetDefTransient(driver->caps, vm, true) < 0)
         goto cleanup;
 
-    vm->def->id = driver->nextvmid++;
+    virDomainObjListSetID(&driver->domains, vm, driver->nextvmid++);
 
     if (!driver->nactive && driver->inhibitCallback)
         driver->inhibitCallback(true, driver->inhibitOpaque);
     driver->nactive++;
 
-    if (virFileMakePath(driver->logDir) < 0) {
+    if (virFileMakePath(driver->config->logDir) < 0) {
         virReportSystemError(errno,
                              _("cannot create log directory %s"),
-                             driver->logDir);
+                             driver->config->logDir);
         goto cleanup;
     }
 
@@ -4535,7 +4641,7 @@ int qemuProcessAttach(virConnectPtr conn ATTRIBUTE_UNUSED,
         virDomainObjSetState(vm, VIR_DOMAIN_PAUSED, reason);
 
     VIR_DEBUG("Writing domain status to disk");
-    if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
+    if (virDomainSaveStatus(driver->caps, driver->config->stateDir, vm) < 0)
         goto cleanup;
 
     /* Run an hook to allow admins to do some magic */
@@ -4591,8 +4697,8 @@ qemuProcessAutoDestroy(virQEMUDriverPtr driver,
         qemuDomainObjDiscardAsyncJob(driver, dom);
     }
 
-    if (qemuDomainObjBeginJobWithDriver(driver, dom,
-                                        QEMU_JOB_DESTROY) < 0)
+    if (qemuDomainObjBeginInternalJobWithDriver(driver, dom,
+                                                QEMU_JOB_DESTROY) < 0)
         goto cleanup;
 
     VIR_DEBUG("Killing domain");
@@ -42,6 +42,18 @@ int qemuProcessStopCPUs(virQEMUDriverPtr driver,
 void qemuProcessAutostartAll(virQEMUDriverPtr driver);
 void qemuProcessReconnectAll(virConnectPtr conn, virQEMUDriverPtr driver);
 
+/* Order in which domains are reconnected on startup */
+enum qemuProcessReconnectPriority {
+    /* An async job such as migration was interrupted */
+    QEMU_PROCESS_RECONNECT_JOB,
+    QEMU_PROCESS_RECONNECT_RUNNING,
+    QEMU_PROCESS_RECONNECT_OTHER,
+};
+
+enum qemuProcessReconnectPriority
+qemuProcessReconnectPriority(virDomainObjPtr obj,
+                             enum qemuDomainAsyncJob asyncJob);
+
 int qemuProcessAssignPCIAddresses(virDomainDefPtr def);
 
 typedef enum {
@@ -91,6 +91,12 @@ struct private_data {
     int localUses;              /* Ref count for private data */
     char *hostname;             /* Original hostname */
     bool serverKeepAlive;       /* Does server support keepalive protocol? */
+    int streamEncodings;        /* Stream encodings supported by server,
+                                   -1 until queried */
+    int listPages;              /* Can server page list replies?
+                                   -1 until queried */
+    int domainEventFilter;      /* Can server filter domain events?
+                                   -1 until queried */
 
     virDomainEventStatePtr domainEventState;
 };
@@ -267,6 +273,14 @@ static void
 remoteDomainBuildEventPMSuspendDisk(virNetClientProgramPtr prog,
                                   virNetClientPtr client,
                                   void *evdata, void *opaque);
+static void
+remoteDomainBuildEventMigrationStalled(virNetClientProgramPtr prog,
+                                       virNetClientPtr client,
+                                       void *evdata, void *opaque);
+static void
+remoteDomainBuildEventBatch(virNetClientProgramPtr prog,
+                            virNetClientPtr client,
+                            void *evdata, void *opaque);
 
 static virNetClientProgramEvent remoteDomainEvents[] = {
     { REMOTE_PROC_DOMAIN_EVENT_RTC_CHANGE,
@@ -329,6 +343,14 @@ static virNetClientProgramEvent remoteDomainEvents[] = {
       remoteDomainBuildEventPMSuspendDisk,
       sizeof(remote_domain_event_pmsuspend_disk_msg),
       (xdrproc_t)xdr_remote_domain_event_pmsuspend_disk_msg },
+    { REMOTE_PROC_DOMAIN_EVENT_MIGRATION_STALLED,
+      remoteDomainBuildEventMigrationStalled,
+      sizeof(remote_domain_event_migration_stalled_msg),
+      (xdrproc_t)xdr_remote_domain_event_migration_stalled_msg },
+    { REMOTE_PROC_DOMAIN_EVENT_BATCH,
+      remoteDomainBuildEventBatch,
+      sizeof(remote_domain_event_batch_msg),
+      (xdrproc_t)xdr_remote_domain_event_batch_msg },
 };
 
 enum virDrvOpenRemoteFlags {
@@ -902,6 +924,9 @@ remoteAllocPrivateData(void)
     }
     remoteDriverLock(priv);
     priv->localUses = 1;
+    priv->streamEncodings = -1;
+    priv->listPages = -1;
+    priv->domainEventFilter = -1;
 
     return priv;
 }
@@ -1389,6 +1414,192 @@ done:
     return rv;
 }
 
+/*
+ * Servers which can page the results of the ListAll APIs don't limit
+ * them to what fits in a single message, so prefer that whenever the
+ * caller wants the objects rather than just their number.
+ */
+static bool
+remoteListPages(virConnectPtr conn,
+                struct private_data *priv)
+{
+    if (priv->listPages < 0) {
+        remote_supports_feature_args args =
+            { VIR_DRV_FEATURE_PROGRAM_LIST_PAGES };
+        remote_supports_feature_ret ret = { 0 };
+
+        if (call(conn, priv, 0, REMOTE_PROC_SUPPORTS_FEATURE,
+                 (xdrproc_t)xdr_remote_supports_feature_args, (char *) &args,
+                 (xdrproc_t)xdr_remote_supports_feature_ret, (char *) &ret) < 0) {
+            VIR_DEBUG("Unable to query list paging, using single replies");
+            virResetLastError();
+            ret.supported = 0;
+        }
+
+        priv->listPages = ret.supported > 0;
+    }
+
+    return priv->listPages > 0;
+}
+
+/* How the objects in the replies of a paged list procedure are laid
+ * out, and what is made of them */
+typedef struct _remoteListPageType remoteListPageType;
+struct _remoteListPageType {
+    int proc;
+    xdrproc_t args_filter;
+    xdrproc_t ret_filter;
+    size_t len_offset;          /* of the u_int count of objects */
+    size_t val_offset;          /* of the array of objects */
+    size_t more_offset;
+    size_t objsize;             /* sizeof one remote_nonnull_* */
+    void *(*get)(virConnectPtr conn, void *val);
+    /* Key of an object, which may be formatted into @buf */
+    const char *(*key)(void *val, char *buf);
+};
+
+/* Room for the reply of any paged list procedure */
+typedef union {
+    remote_connect_list_all_domains_paged_ret domains;
+    remote_connect_list_all_networks_paged_ret nets;
+    remote_connect_list_all_interfaces_paged_ret ifaces;
+    remote_connect_list_all_node_devices_paged_ret devices;
+    remote_connect_list_all_nwfilters_paged_ret filters;
+    remote_connect_list_all_secrets_paged_ret secrets;
+    remote_connect_list_all_storage_pools_paged_ret pools;
+    remote_storage_pool_list_all_volumes_paged_ret vols;
+} remoteListPageRet;
+
+/*
+ * Fetch every object of a ListAll API a page at a time, each page
+ * starting after the key of the last object of the previous one.
+ * @args are the arguments of the procedure, @start their start
+ * field. Returns the number of objects stored in a NULL terminated
+ * array in @objs, or -1 on error.
+ */
+static int
+remoteListAllPaged(virConnectPtr conn,
+                   struct private_data *priv,
+                   const remoteListPageType *type,
+                   char *args,
+                   remote_string *start,
+                   void ***objs)
+{
+    int rv = -1;
+    size_t i;
+    void **tmp = NULL;
+    size_t ntmp = 0;
+    char *last = NULL;
+    bool more;
+    char buf[VIR_UUID_STRING_BUFLEN];
+    remoteListPageRet ret;
+    char *retp = (char *) &ret;
+
+    do {
+        u_int len;
+        char *val;
+
+        *start = last ? &last : NULL;
+
+        memset(&ret, 0, sizeof(ret));
+        if (call(conn, priv, 0, type->proc,
+                 type->args_filter, args,
+                 type->ret_filter, retp) == -1)
+            goto cleanup;
+
+        len = *(u_int *) (retp + type->len_offset);
+        val = *(char **) (retp + type->val_offset);
+
+        if (VIR_REALLOC_N(tmp, ntmp + len + 1) < 0) {
+            virReportOOMError();
+            goto error;
+        }
+
+        for (i = 0; i < len; i++) {
+            if (!(tmp[ntmp] = type->get(conn, val + i * type->objsize))) {
+                virReportOOMError();
+                goto error;
+            }
+            ntmp++;
+        }
+        tmp[ntmp] = NULL;
+
+        /* The next page starts after the last object of this one */
+        more = *(int *) (retp + type->more_offset) && len;
+        VIR_FREE(last);
+        if (more &&
+            !(last = strdup(type->key(val + (len - 1) * type->objsize,
+                                      buf)))) {
+            virReportOOMError();
+            goto error;
+        }
+
+        xdr_free(type->ret_filter, retp);
+    } while (more);
+
+    if (!tmp && VIR_ALLOC_N(tmp, 1) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    *objs = tmp;
+    tmp = NULL;
+    rv = ntmp;
+
+cleanup:
+    for (i = 0; i < ntmp && tmp; i++)
+        virObjectUnref(tmp[i]);
+    VIR_FREE(tmp);
+    VIR_FREE(last);
+    *start = NULL;
+    return rv;
+
+error:
+    xdr_free(type->ret_filter, retp);
+    goto cleanup;
+}
+
+static void *
+remoteListPageDomainGet(virConnectPtr conn, void *val)
+{
+    return get_nonnull_domain(conn, *(remote_nonnull_domain *) val);
+}
+
+static const char *
+remoteListPageDomainKey(void *val, char *buf ATTRIBUTE_UNUSED)
+{
+    remote_nonnull_domain *dom = val;
+
+    return dom->name;
+}
+
+static const remoteListPageType remoteListPageDomainType = {
+    REMOTE_PROC_CONNECT_LIST_ALL_DOMAINS_PAGED,
+    (xdrproc_t) xdr_remote_connect_list_all_domains_paged_args,
+    (xdrproc_t) xdr_remote_connect_list_all_domains_paged_ret,
+    offsetof(remote_connect_list_all_domains_paged_ret, domains.domains_len),
+    offsetof(remote_connect_list_all_domains_paged_ret, domains.domains_val),
+    offsetof(remote_connect_list_all_domains_paged_ret, more),
+    sizeof(remote_nonnull_domain),
+    remoteListPageDomainGet,
+    remoteListPageDomainKey,
+};
+
+static int
+remoteConnectListAllDomainsPaged(virConnectPtr conn,
+                                 struct private_data *priv,
+                                 virDomainPtr **domains,
+                                 unsigned int flags)
+{
+    remote_connect_list_all_domains_paged_args args;
+
+    args.max = REMOTE_LIST_PAGE_MAX;
+    args.flags = flags;
+
+    return remoteListAllPaged(conn, priv, &remoteListPageDomainType,
+                              (char *) &args, &args.start, (void ***) domains);
+}
+
 static int
 remoteConnectListAllDomains(virConnectPtr conn,
                             virDomainPtr **domains,
@@ -1404,6 +1615,11 @@ remoteConnectListAllDomains(virConnectPtr conn,
 
     remoteDriverLock(priv);
 
+    if (domains && remoteListPages(conn, priv)) {
+        rv = remoteConnectListAllDomainsPaged(conn, priv, domains, flags);
+        goto done;
+    }
+
     args.need_results = !!domains;
     args.flags = flags;
 
@@ -2763,6 +2979,47 @@ done:
     return rv;
 }
 
+static void *
+remoteListPageNetworkGet(virConnectPtr conn, void *val)
+{
+    return get_nonnull_network(conn, *(remote_nonnull_network *) val);
+}
+
+static const char *
+remoteListPageNetworkKey(void *val, char *buf ATTRIBUTE_UNUSED)
+{
+    remote_nonnull_network *net = val;
+
+    return net->name;
+}
+
+static const remoteListPageType remoteListPageNetworkType = {
+    REMOTE_PROC_CONNECT_LIST_ALL_NETWORKS_PAGED,
+    (xdrproc_t) xdr_remote_connect_list_all_networks_paged_args,
+    (xdrproc_t) xdr_remote_connect_list_all_networks_paged_ret,
+    offsetof(remote_connect_list_all_networks_paged_ret, nets.nets_len),
+    offsetof(remote_connect_list_all_networks_paged_ret, nets.nets_val),
+    offsetof(remote_connect_list_all_networks_paged_ret, more),
+    sizeof(remote_nonnull_network),
+    remoteListPageNetworkGet,
+    remoteListPageNetworkKey,
+};
+
+static int
+remoteConnectListAllNetworksPaged(virConnectPtr conn,
+                                  struct private_data *priv,
+                                  virNetworkPtr **nets,
+                                  unsigned int flags)
+{
+    remote_connect_list_all_networks_paged_args args;
+
+    args.max = REMOTE_LIST_PAGE_MAX;
+    args.flags = flags;
+
+    return remoteListAllPaged(conn, priv, &remoteListPageNetworkType,
+                              (char *) &args, &args.start, (void ***) nets);
+}
+
 static int
 remoteConnectListAllNetworks(virConnectPtr conn,
                              virNetworkPtr **nets,
@@ -2778,6 +3035,11 @@ remoteConnectListAllNetworks(virConnectPtr conn,
 
     remoteDriverLock(priv);
 
+    if (nets && remoteListPages(conn, priv)) {
+        rv = remoteConnectListAllNetworksPaged(conn, priv, nets, flags);
+        goto done;
+    }
+
     args.need_results = !!nets;
     args.flags = flags;
 
@@ -2826,6 +3088,47 @@ done:
     return rv;
 }
 
+static void *
+remoteListPageInterfaceGet(virConnectPtr conn, void *val)
+{
+    return get_nonnull_interface(conn, *(remote_nonnull_interface *) val);
+}
+
+static const char *
+remoteListPageInterfaceKey(void *val, char *buf ATTRIBUTE_UNUSED)
+{
+    remote_nonnull_interface *iface = val;
+
+    return iface->name;
+}
+
+static const remoteListPageType remoteListPageInterfaceType = {
+    REMOTE_PROC_CONNECT_LIST_ALL_INTERFACES_PAGED,
+    (xdrproc_t) xdr_remote_connect_list_all_interfaces_paged_args,
+    (xdrproc_t) xdr_remote_connect_list_all_interfaces_paged_ret,
+    offsetof(remote_connect_list_all_interfaces_paged_ret, ifaces.ifaces_len),
+    offsetof(remote_connect_list_all_interfaces_paged_ret, ifaces.ifaces_val),
+    offsetof(remote_connect_list_all_interfaces_paged_ret, more),
+    sizeof(remote_nonnull_interface),
+    remoteListPageInterfaceGet,
+    remoteListPageInterfaceKey,
+};
+
+static int
+remoteConnectListAllInterfacesPaged(virConnectPtr conn,
+                                    struct private_data *priv,
+                                    virInterfacePtr **ifaces,
+                                    unsigned int flags)
+{
+    remote_connect_list_all_interfaces_paged_args args;
+
+    args.max = REMOTE_LIST_PAGE_MAX;
+    args.flags = flags;
+
+    return remoteListAllPaged(conn, priv, &remoteListPageInterfaceType,
+                              (char *) &args, &args.start, (void ***) ifaces);
+}
+
 static int
 remoteConnectListAllInterfaces(virConnectPtr conn,
                                virInterfacePtr **ifaces,
@@ -2841,6 +3144,11 @@ remoteConnectListAllInterfaces(virConnectPtr conn,
 
     remoteDriverLock(priv);
 
+    if (ifaces && remoteListPages(conn, priv)) {
+        rv = remoteConnectListAllInterfacesPaged(conn, priv, ifaces, flags);
+        goto done;
+    }
+
     args.need_results = !!ifaces;
     args.flags = flags;
 
@@ -2889,6 +3197,47 @@ done:
     return rv;
 }
 
+static void *
+remoteListPageNodeDeviceGet(virConnectPtr conn, void *val)
+{
+    return get_nonnull_node_device(conn, *(remote_nonnull_node_device *) val);
+}
+
+static const char *
+remoteListPageNodeDeviceKey(void *val, char *buf ATTRIBUTE_UNUSED)
+{
+    remote_nonnull_node_device *dev = val;
+
+    return dev->name;
+}
+
+static const remoteListPageType remoteListPageNodeDeviceType = {
+    REMOTE_PROC_CONNECT_LIST_ALL_NODE_DEVICES_PAGED,
+    (xdrproc_t) xdr_remote_connect_list_all_node_devices_paged_args,
+    (xdrproc_t) xdr_remote_connect_list_all_node_devices_paged_ret,
+    offsetof(remote_connect_list_all_node_devices_paged_ret, devices.devices_len),
+    offsetof(remote_connect_list_all_node_devices_paged_ret, devices.devices_val),
+    offsetof(remote_connect_list_all_node_devices_paged_ret, more),
+    sizeof(remote_nonnull_node_device),
+    remoteListPageNodeDeviceGet,
+    remoteListPageNodeDeviceKey,
+};
+
+static int
+remoteConnectListAllNodeDevicesPaged(virConnectPtr conn,
+                                     struct private_data *priv,
+                                     virNodeDevicePtr **devices,
+                                     unsigned int flags)
+{
+    remote_connect_list_all_node_devices_paged_args args;
+
+    args.max = REMOTE_LIST_PAGE_MAX;
+    args.flags = flags;
+
+    return remoteListAllPaged(conn, priv, &remoteListPageNodeDeviceType,
+                              (char *) &args, &args.start, (void ***) devices);
+}
+
 static int
 remoteConnectListAllNodeDevices(virConnectPtr conn,
                                 virNodeDevicePtr **devices,
@@ -2904,6 +3253,11 @@ remoteConnectListAllNodeDevices(virConnectPtr conn,
 
     remoteDriverLock(priv);
 
+    if (devices && remoteListPages(conn, priv)) {
+        rv = remoteConnectListAllNodeDevicesPaged(conn, priv, devices, flags);
+        goto done;
+    }
+
     args.need_results = !!devices;
     args.flags = flags;
 
@@ -2952,6 +3306,47 @@ done:
     return rv;
 }
 
+static void *
+remoteListPageNWFilterGet(virConnectPtr conn, void *val)
+{
+    return get_nonnull_nwfilter(conn, *(remote_nonnull_nwfilter *) val);
+}
+
+static const char *
+remoteListPageNWFilterKey(void *val, char *buf ATTRIBUTE_UNUSED)
+{
+    remote_nonnull_nwfilter *nwfilter = val;
+
+    return nwfilter->name;
+}
+
+static const remoteListPageType remoteListPageNWFilterType = {
+    REMOTE_PROC_CONNECT_LIST_ALL_NWFILTERS_PAGED,
+    (xdrproc_t) xdr_remote_connect_list_all_nwfilters_paged_args,
+    (xdrproc_t) xdr_remote_connect_list_all_nwfilters_paged_ret,
+    offsetof(remote_connect_list_all_nwfilters_paged_ret, filters.filters_len),
+    offsetof(remote_connect_list_all_nwfilters_paged_ret, filters.filters_val),
+    offsetof(remote_connect_list_all_nwfilters_paged_ret, more),
+    sizeof(remote_nonnull_nwfilter),
+    remoteListPageNWFilterGet,
+    remoteListPageNWFilterKey,
+};
+
+static int
+remoteConnectListAllNWFiltersPaged(virConnectPtr conn,
+                                   struct private_data *priv,
+                                   virNWFilterPtr **filters,
+                                   unsigned int flags)
+{
+    remote_connect_list_all_nwfilters_paged_args args;
+
+    args.max = REMOTE_LIST_PAGE_MAX;
+    args.flags = flags;
+
+    return remoteListAllPaged(conn, priv, &remoteListPageNWFilterType,
+                              (char *) &args, &args.start, (void ***) filters);
+}
+
 static int
 remoteConnectListAllNWFilters(virConnectPtr conn,
                               virNWFilterPtr **filters,
@@ -2967,6 +3362,11 @@ remoteConnectListAllNWFilters(virConnectPtr conn,
 
     remoteDriverLock(priv);
 
+    if (filters && remoteListPages(conn, priv)) {
+        rv = remoteConnectListAllNWFiltersPaged(conn, priv, filters, flags);
+        goto done;
+    }
+
     args.need_results = !!filters;
     args.flags = flags;
 
@@ -3015,6 +3415,48 @@ done:
     return rv;
 }
 
+static void *
+remoteListPageSecretGet(virConnectPtr conn, void *val)
+{
+    return get_nonnull_secret(conn, *(remote_nonnull_secret *) val);
+}
+
+/* Secrets have no name, so are ordered by UUID */
+static const char *
+remoteListPageSecretKey(void *val, char *buf)
+{
+    remote_nonnull_secret *secret = val;
+
+    return virUUIDFormat((unsigned char *) secret->uuid, buf);
+}
+
+static const remoteListPageType remoteListPageSecretType = {
+    REMOTE_PROC_CONNECT_LIST_ALL_SECRETS_PAGED,
+    (xdrproc_t) xdr_remote_connect_list_all_secrets_paged_args,
+    (xdrproc_t) xdr_remote_connect_list_all_secrets_paged_ret,
+    offsetof(remote_connect_list_all_secrets_paged_ret, secrets.secrets_len),
+    offsetof(remote_connect_list_all_secrets_paged_ret, secrets.secrets_val),
+    offsetof(remote_connect_list_all_secrets_paged_ret, more),
+    sizeof(remote_nonnull_secret),
+    remoteListPageSecretGet,
+    remoteListPageSecretKey,
+};
+
+static int
+remoteConnectListAllSecretsPaged(virConnectPtr conn,
+                                 struct private_data *priv,
+                                 virSecretPtr **secrets,
+                                 unsigned int flags)
+{
+    remote_connect_list_all_secrets_paged_args args;
+
+    args.max = REMOTE_LIST_PAGE_MAX;
+    args.flags = flags;
+
+    return remoteListAllPaged(conn, priv, &remoteListPageSecretType,
+                              (char *) &args, &args.start, (void ***) secrets);
+}
+
 static int
 remoteConnectListAllSecrets(virConnectPtr conn,
                             virSecretPtr **secrets,
@@ -3030,6 +3472,11 @@ remoteConnectListAllSecrets(virConnectPtr conn,
 
     remoteDriverLock(priv);
 
+    if (secrets && remoteListPages(conn, priv)) {
+        rv = remoteConnectListAllSecretsPaged(conn, priv, secrets, flags);
+        goto done;
+    }
+
     args.need_results = !!secrets;
     args.flags = flags;
 
@@ -3216,6 +3663,47 @@ done:
     return rv;
 }
 
+static void *
+remoteListPageStoragePoolGet(virConnectPtr conn, void *val)
+{
+    return get_nonnull_storage_pool(conn, *(remote_nonnull_storage_pool *) val);
+}
+
+static const char *
+remoteListPageStoragePoolKey(void *val, char *buf ATTRIBUTE_UNUSED)
+{
+    remote_nonnull_storage_pool *pool = val;
+
+    return pool->name;
+}
+
+static const remoteListPageType remoteListPageStoragePoolType = {
+    REMOTE_PROC_CONNECT_LIST_ALL_STORAGE_POOLS_PAGED,
+    (xdrproc_t) xdr_remote_connect_list_all_storage_pools_paged_args,
+    (xdrproc_t) xdr_remote_connect_list_all_storage_pools_paged_ret,
+    offsetof(remote_connect_list_all_storage_pools_paged_ret, pools.pools_len),
+    offsetof(remote_connect_list_all_storage_pools_paged_ret, pools.pools_val),
+    offsetof(remote_connect_list_all_storage_pools_paged_ret, more),
+    sizeof(remote_nonnull_storage_pool),
+    remoteListPageStoragePoolGet,
+    remoteListPageStoragePoolKey,
+};
+
+static int
+remoteConnectListAllStoragePoolsPaged(virConnectPtr conn,
+                                      struct private_data *priv,
+                                      virStoragePoolPtr **pools,
+                                      unsigned int flags)
+{
+    remote_connect_list_all_storage_pools_paged_args args;
+
+    args.max = REMOTE_LIST_PAGE_MAX;
+    args.flags = flags;
+
+    return remoteListAllPaged(conn, priv, &remoteListPageStoragePoolType,
+                              (char *) &args, &args.start, (void ***) pools);
+}
+
 static int
 remoteConnectListAllStoragePools(virConnectPtr conn,
                                  virStoragePoolPtr **pools,
@@ -3231,6 +3719,11 @@ remoteConnectListAllStoragePools(virConnectPtr conn,
 
     remoteDriverLock(priv);
 
+    if (pools && remoteListPages(conn, priv)) {
+        rv = remoteConnectListAllStoragePoolsPaged(conn, priv, pools, flags);
+        goto done;
+    }
+
     args.need_results = !!pools;
     args.flags = flags;
 
@@ -3279,6 +3772,48 @@ done:
     return rv;
 }
 
+static void *
+remoteListPageStorageVolGet(virConnectPtr conn, void *val)
+{
+    return get_nonnull_storage_vol(conn, *(remote_nonnull_storage_vol *) val);
+}
+
+static const char *
+remoteListPageStorageVolKey(void *val, char *buf ATTRIBUTE_UNUSED)
+{
+    remote_nonnull_storage_vol *vol = val;
+
+    return vol->name;
+}
+
+static const remoteListPageType remoteListPageStorageVolType = {
+    REMOTE_PROC_STORAGE_POOL_LIST_ALL_VOLUMES_PAGED,
+    (xdrproc_t) xdr_remote_storage_pool_list_all_volumes_paged_args,
+    (xdrproc_t) xdr_remote_storage_pool_list_all_volumes_paged_ret,
+    offsetof(remote_storage_pool_list_all_volumes_paged_ret, vols.vols_len),
+    offsetof(remote_storage_pool_list_all_volumes_paged_ret, vols.vols_val),
+    offsetof(remote_storage_pool_list_all_volumes_paged_ret, more),
+    sizeof(remote_nonnull_storage_vol),
+    remoteListPageStorageVolGet,
+    remoteListPageStorageVolKey,
+};
+
+static int
+remoteStoragePoolListAllVolumesPaged(virStoragePoolPtr pool,
+                                     struct private_data *priv,
+                                     virStorageVolPtr **vols,
+                                     unsigned int flags)
+{
+    remote_storage_pool_list_all_volumes_paged_args args;
+
+    make_nonnull_storage_pool(&args.pool, pool);
+    args.max = REMOTE_LIST_PAGE_MAX;
+    args.flags = flags;
+
+    return remoteListAllPaged(pool->conn, priv, &remoteListPageStorageVolType,
+                              (char *) &args, &args.start, (void ***) vols);
+}
+
 static int
 remoteStoragePoolListAllVolumes(virStoragePoolPtr pool,
                                 virStorageVolPtr **vols,
@@ -3294,6 +3829,11 @@ remoteStoragePoolListAllVolumes(virStoragePoolPtr pool,
 
     remoteDriverLock(priv);
 
+    if (vols && remoteListPages(pool->conn, priv)) {
+        rv = remoteStoragePoolListAllVolumesPaged(pool, priv, vols, flags);
+        goto done;
+    }
+
     make_nonnull_storage_pool(&args.pool, pool);
     args.need_results = !!vols;
     args.flags = flags;
@@ -4175,6 +4715,91 @@ out:
 #endif /* WITH_POLKIT */
 /*----------------------------------------------------------------------*/
 
+/*
+ * Tell the server which domains our callbacks for @eventID watch, so
+ * that it doesn't send events we would only throw away. The first
+ * time around this also lets the server know we can take batches of
+ * events, and finds out whether it can filter them at all.
+ */
+static int
+remoteDomainEventUpdateFilter(virConnectPtr conn,
+                              struct private_data *priv,
+                              int eventID)
+{
+    remote_domain_events_filter_args args;
+    unsigned char *uuids = NULL;
+    size_t nuuids = 0;
+    int filtered;
+    int rv = -1;
+
+    if (priv->domainEventFilter < 0) {
+        remote_supports_feature_args fargs =
+            { VIR_DRV_FEATURE_PROGRAM_DOMAIN_EVENT_FILTER };
+        remote_supports_feature_ret fret = { 0 };
+
+        if (call(conn, priv, 0, REMOTE_PROC_SUPPORTS_FEATURE,
+                 (xdrproc_t)xdr_remote_supports_feature_args, (char *) &fargs,
+                 (xdrproc_t)xdr_remote_supports_feature_ret, (char *) &fret) < 0) {
+            VIR_DEBUG("Unable to query event filtering, receiving all events");
+            virResetLastError();
+            fret.supported = 0;
+        }
+        priv->domainEventFilter = fret.supported > 0;
+
+        /* Servers which filter events can batch them too */
+        if (priv->domainEventFilter) {
+            fargs.feature = VIR_DRV_FEATURE_PROGRAM_DOMAIN_EVENT_BATCH;
+            fret.supported = 0;
+            if (call(conn, priv, 0, REMOTE_PROC_SUPPORTS_FEATURE,
+                     (xdrproc_t)xdr_remote_supports_feature_args, (char *) &fargs,
+                     (xdrproc_t)xdr_remote_supports_feature_ret, (char *) &fret) < 0) {
+                VIR_DEBUG("Unable to query event batches");
+                virResetLastError();
+                fret.supported = 0;
+            }
+            if (fret.supported > 0) {
+                remote_domain_events_batch_args bargs = { 1 };
+
+                if (call(conn, priv, 0, REMOTE_PROC_DOMAIN_EVENTS_BATCH,
+                         (xdrproc_t)xdr_remote_domain_events_batch_args,
+                         (char *) &bargs,
+                         (xdrproc_t)xdr_void, (char *) NULL) < 0) {
+                    VIR_DEBUG("Unable to enable event batches");
+                    virResetLastError();
+                }
+            }
+        }
+    }
+
+    if (!priv->domainEventFilter)
+        return 0;
+
+    if ((filtered = virDomainEventStateDomainFilter(conn,
+                                                    priv->domainEventState,
+                                                    eventID,
+                                                    &uuids, &nuuids)) < 0)
+        return -1;
+
+    memset(&args, 0, sizeof(args));
+    args.eventID = eventID;
+    args.all = !filtered || nuuids > REMOTE_DOMAIN_EVENT_FILTER_MAX;
+    if (!args.all) {
+        args.doms.doms_len = nuuids;
+        args.doms.doms_val = (remote_uuid *) uuids;
+    }
+
+    if (call(conn, priv, 0, REMOTE_PROC_DOMAIN_EVENTS_FILTER,
+             (xdrproc_t) xdr_remote_domain_events_filter_args, (char *) &args,
+             (xdrproc_t) xdr_void, (char *) NULL) == -1)
+        goto cleanup;
+
+    rv = 0;
+
+cleanup:
+    VIR_FREE(uuids);
+    return rv;
+}
+
 static int remoteDomainEventRegister(virConnectPtr conn,
                                      virConnectDomainEventCallback callback,
                                      void *opaque,
@@ -4192,6 +4817,13 @@ static int remoteDomainEventRegister(virConnectPtr conn,
          goto done;
     }
 
+    /* The server must not keep dropping events this callback wants */
+    if (remoteDomainEventUpdateFilter(conn, priv,
+                                      VIR_DOMAIN_EVENT_ID_LIFECYCLE) < 0) {
+        virDomainEventStateDeregister(conn, priv->domainEventState, callback);
+        goto done;
+    }
+
     if (count == 1) {
         /* Tell the server when we are the first callback deregistering */
         if (call(conn, priv, 0, REMOTE_PROC_DOMAIN_EVENTS_REGISTER,
@@ -4221,6 +4853,14 @@ static int remoteDomainEventDeregister(virConnectPtr conn,
                                                callback)) < 0)
         goto done;
 
+    /* A stale filter only lets through events we discard anyway */
+    if (count > 0 &&
+        remoteDomainEventUpdateFilter(conn, priv,
+                                      VIR_DOMAIN_EVENT_ID_LIFECYCLE) < 0) {
+        VIR_DEBUG("Unable to narrow event filter");
+        virResetLastError();
+    }
+
     if (count == 0) {
         /* Tell the server when we are the last callback deregistering */
         if (call(conn, priv, 0, REMOTE_PROC_DOMAIN_EVENTS_DEREGISTER,
@@ -4643,9 +5283,84 @@ remoteDomainBuildEventPMSuspendDisk(virNetClientProgramPtr prog ATTRIBUTE_UNUSED
 }
 
 
-static virDrvOpenStatus ATTRIBUTE_NONNULL(1)
-remoteSecretOpen(virConnectPtr conn, virConnectAuthPtr auth,
-                 unsigned int flags)
+static void
+remoteDomainBuildEventMigrationStalled(virNetClientProgramPtr prog ATTRIBUTE_UNUSED,
+                                       virNetClientPtr client ATTRIBUTE_UNUSED,
+                                       void *evdata, void *opaque)
+{
+    virConnectPtr conn = opaque;
+    struct private_data *priv = conn->privateData;
+    remote_domain_event_migration_stalled_msg *msg = evdata;
+    virDomainPtr dom;
+    virDomainEventPtr event = NULL;
+
+    dom = get_nonnull_domain(conn, msg->dom);
+    if (!dom)
+        return;
+
+    event = virDomainEventMigrationStalledNewFromDom(dom, msg->iteration,
+                                                     msg->dirtyRate,
+                                                     msg->bandwidth);
+
+    virDomainFree(dom);
+
+    remoteDomainEventQueue(priv, event);
+}
+
+
+/*
+ * Unpack the events the server coalesced into one message and hand
+ * each of them to the function which would have got it on its own.
+ */
+static void
+remoteDomainBuildEventBatch(virNetClientProgramPtr prog,
+                            virNetClientPtr client,
+                            void *evdata, void *opaque)
+{
+    remote_domain_event_batch_msg *msg = evdata;
+    int i, j;
+
+    for (i = 0; i < msg->events.events_len; i++) {
+        remote_domain_event_batch_entry *entry = msg->events.events_val + i;
+        virNetClientProgramEventPtr event = NULL;
+        char *data = NULL;
+        XDR xdr;
+
+        for (j = 0; j < ARRAY_CARDINALITY(remoteDomainEvents); j++) {
+            if (remoteDomainEvents[j].proc == entry->procedure &&
+                remoteDomainEvents[j].func != remoteDomainBuildEventBatch) {
+                event = &remoteDomainEvents[j];
+                break;
+            }
+        }
+
+        if (!event) {
+            VIR_WARN("Unexpected event %d in batch", entry->procedure);
+            continue;
+        }
+
+        if (VIR_ALLOC_N(data, event->msg_len) < 0) {
+            virReportOOMError();
+            return;
+        }
+
+        xdrmem_create(&xdr, entry->data.data_val, entry->data.data_len,
+                      XDR_DECODE);
+        if ((event->msg_filter)(&xdr, data))
+            event->func(prog, client, data, opaque);
+        else
+            VIR_WARN("Unable to decode event %d in batch", entry->procedure);
+        xdr_destroy(&xdr);
+
+        xdr_free(event->msg_filter, data);
+        VIR_FREE(data);
+    }
+}
+
+
+static virDrvOpenStatus ATTRIBUTE_NONNULL(1)
+remoteSecretOpen(virConnectPtr conn, virConnectAuthPtr auth,
+                 unsigned int flags)
 {
     return remoteGenericOpen(conn, auth, flags, &conn->secretPrivateData);
 }
@@ -4691,6 +5406,57 @@ done:
 }
 
 
+/*
+ * For streams created with VIR_STREAM_COMPRESS, agree with the
+ * server on how stream data is encoded, before the first data is
+ * sent or received. Servers which don't know about encodings just
+ * get raw data.
+ */
+static int
+remoteStreamSetupEncoding(virStreamPtr st,
+                          struct private_data *priv)
+{
+    virNetClientStreamPtr privst = st->privateData;
+    int encoding = VIR_NET_STREAM_ENCODING_RAW;
+    int level = -1;
+
+    if (!(st->flags & (VIR_STREAM_COMPRESS | VIR_STREAM_COMPRESS_BEST)) ||
+        virNetClientStreamHasEncoding(privst))
+        return 0;
+
+    if (priv->streamEncodings < 0) {
+        remote_supports_feature_args args =
+            { VIR_DRV_FEATURE_PROGRAM_STREAM_ENCODING };
+        remote_supports_feature_ret ret = { 0 };
+
+        /* Old servers ask the driver, which knows nothing about it */
+        if (call(st->conn, priv, 0, REMOTE_PROC_SUPPORTS_FEATURE,
+                 (xdrproc_t)xdr_remote_supports_feature_args, (char *) &args,
+                 (xdrproc_t)xdr_remote_supports_feature_ret, (char *) &ret) < 0) {
+            VIR_DEBUG("Unable to query stream encodings, sending raw data");
+            virResetLastError();
+            ret.supported = 0;
+        }
+
+        priv->streamEncodings = ret.supported > 0 ? ret.supported : 0;
+        priv->streamEncodings &= virNetMessageStreamEncodings();
+    }
+
+    if (priv->streamEncodings & (1 << VIR_NET_STREAM_ENCODING_ZLIB)) {
+        encoding = VIR_NET_STREAM_ENCODING_ZLIB;
+        /* zlib levels for best speed and best compression */
+        level = (st->flags & VIR_STREAM_COMPRESS_BEST) ? 9 : 1;
+    } else if (priv->streamEncodings & (1 << VIR_NET_STREAM_ENCODING_HOLE)) {
+        encoding = VIR_NET_STREAM_ENCODING_HOLE;
+    }
+
+    VIR_DEBUG("st=%p encoding=%d level=%d", st, encoding, level);
+
+    return virNetClientStreamSetEncoding(privst, priv->client,
+                                         encoding, level);
+}
+
+
 static int
 remoteStreamSend(virStreamPtr st,
                  const char *data,
@@ -4705,6 +5471,10 @@ remoteStreamSend(virStreamPtr st,
         return -1;
 
     remoteDriverLock(priv);
+    if (remoteStreamSetupEncoding(st, priv) < 0) {
+        remoteDriverUnlock(priv);
+        return -1;
+    }
     priv->localUses++;
     remoteDriverUnlock(priv);
 
@@ -4735,6 +5505,10 @@ remoteStreamRecv(virStreamPtr st,
         return -1;
 
     remoteDriverLock(priv);
+    if (remoteStreamSetupEncoding(st, priv) < 0) {
+        remoteDriverUnlock(priv);
+        return -1;
+    }
     priv->localUses++;
     remoteDriverUnlock(priv);
 
@@ -4959,6 +5733,14 @@ static int remoteDomainEventRegisterAny(virConnectPtr conn,
         goto done;
     }
 
+    /* The server must not keep dropping events this callback wants */
+    if (remoteDomainEventUpdateFilter(conn, priv, eventID) < 0) {
+        virDomainEventStateDeregisterID(conn,
+                                        priv->domainEventState,
+                                        callbackID);
+        goto done;
+    }
+
     /* If this is the first callback for this eventID, we need to enable
      * events on the server */
     if (count == 1) {
@@ -5007,6 +5789,13 @@ static int remoteDomainEventDeregisterAny(virConnectPtr conn,
         goto done;
     }
 
+    /* A stale filter only lets through events we discard anyway */
+    if (count > 0 &&
+        remoteDomainEventUpdateFilter(conn, priv, eventID) < 0) {
+        VIR_DEBUG("Unable to narrow event filter");
+        virResetLastError();
+    }
+
     /* If that was the last callback for this eventID, we need to disable
      * events on the server */
     if (count == 0) {
@@ -5836,6 +6625,59 @@ done:
     return rv;
 }
 
+static int
+remoteDomainGetJobStats(virDomainPtr domain,
+                        int *type,
+                        virTypedParameterPtr *params,
+                        int *nparams,
+                        unsigned int flags)
+{
+    int rv = -1;
+    remote_domain_get_job_stats_args args;
+    remote_domain_get_job_stats_ret ret;
+    virTypedParameterPtr par = NULL;
+    int npar = 0;
+    struct private_data *priv = domain->conn->privateData;
+
+    remoteDriverLock(priv);
+
+    make_nonnull_domain(&args.dom, domain);
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+    if (call(domain->conn, priv, 0, REMOTE_PROC_DOMAIN_GET_JOB_STATS,
+             (xdrproc_t) xdr_remote_domain_get_job_stats_args, (char *) &args,
+             (xdrproc_t) xdr_remote_domain_get_job_stats_ret, (char *) &ret) == -1)
+        goto done;
+
+    npar = ret.params.params_len;
+    if (npar && VIR_ALLOC_N(par, npar) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    if (remoteDeserializeTypedParameters(ret.params.params_val,
+                                         ret.params.params_len,
+                                         REMOTE_DOMAIN_JOB_STATS_MAX,
+                                         par,
+                                         &npar) < 0)
+        goto cleanup;
+
+    *type = ret.type;
+    *params = par;
+    *nparams = npar;
+    par = NULL;
+    rv = 0;
+
+cleanup:
+    virTypedParamsFree(par, npar);
+    xdr_free((xdrproc_t) xdr_remote_domain_get_job_stats_ret,
+             (char *) &ret);
+done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
 static int
 remoteNodeGetCPUMap(virConnectPtr conn,
                     unsigned char **cpumap,
@@ -5885,6 +6727,466 @@ done:
 }
 
 
+static int
+remoteConnectGetAllDomainStats(virConnectPtr conn,
+                               virDomainPtr *doms,
+                               unsigned int ndoms,
+                               unsigned int stats,
+                               virDomainStatsRecordPtr **retStats,
+                               unsigned int flags)
+{
+    int rv = -1;
+    int i;
+    struct private_data *priv = conn->privateData;
+    remote_connect_get_all_domain_stats_args args;
+    remote_connect_get_all_domain_stats_ret ret;
+    virDomainStatsRecordPtr elem = NULL;
+    virDomainStatsRecordPtr *tmpret = NULL;
+
+    memset(&args, 0, sizeof(args));
+    memset(&ret, 0, sizeof(ret));
+
+    if (ndoms > REMOTE_DOMAIN_LIST_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("too many domains '%u' for limit '%d'"),
+                       ndoms, REMOTE_DOMAIN_LIST_MAX);
+        return -1;
+    }
+
+    if (ndoms) {
+        if (VIR_ALLOC_N(args.doms.doms_val, ndoms) < 0) {
+            virReportOOMError();
+            return -1;
+        }
+
+        for (i = 0; i < ndoms; i++)
+            make_nonnull_domain(args.doms.doms_val + i, doms[i]);
+    }
+    args.doms.doms_len = ndoms;
+
+    args.stats = stats;
+    args.flags = flags;
+
+    remoteDriverLock(priv);
+
+    if (call(conn, priv, 0, REMOTE_PROC_CONNECT_GET_ALL_DOMAIN_STATS,
+             (xdrproc_t) xdr_remote_connect_get_all_domain_stats_args,
+             (char *) &args,
+             (xdrproc_t) xdr_remote_connect_get_all_domain_stats_ret,
+             (char *) &ret) == -1)
+        goto done;
+
+    if (ret.retStats.retStats_len > REMOTE_DOMAIN_LIST_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("Too many domain stats records '%d' for limit '%d'"),
+                       ret.retStats.retStats_len, REMOTE_DOMAIN_LIST_MAX);
+        goto cleanup;
+    }
+
+    if (VIR_ALLOC_N(tmpret, ret.retStats.retStats_len + 1) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    for (i = 0; i < ret.retStats.retStats_len; i++) {
+        remote_domain_stats_record *rec = ret.retStats.retStats_val + i;
+
+        if (VIR_ALLOC(elem) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+
+        if (!(elem->dom = get_nonnull_domain(conn, rec->dom)))
+            goto cleanup;
+
+        elem->nparams = rec->params.params_len;
+        if (VIR_ALLOC_N(elem->params, elem->nparams) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+
+        if (remoteDeserializeTypedParameters(rec->params.params_val,
+                                             rec->params.params_len,
+                                             REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX,
+                                             elem->params,
+                                             &elem->nparams) < 0)
+            goto cleanup;
+
+        tmpret[i] = elem;
+        elem = NULL;
+    }
+
+    *retStats = tmpret;
+    tmpret = NULL;
+    rv = ret.retStats.retStats_len;
+
+cleanup:
+    if (elem) {
+        virObjectUnref(elem->dom);
+        VIR_FREE(elem->params);
+        VIR_FREE(elem);
+    }
+
+    virDomainStatsRecordListFree(tmpret);
+    xdr_free((xdrproc_t) xdr_remote_connect_get_all_domain_stats_ret,
+             (char *) &ret);
+
+done:
+    remoteDriverUnlock(priv);
+    xdr_free((xdrproc_t) xdr_remote_connect_get_all_domain_stats_args,
+             (char *) &args);
+    return rv;
+}
+
+static int
+remoteConnectGetRPCStats(virConnectPtr conn,
+                         virTypedParameterPtr *params,
+                         int *nparams,
+                         unsigned int flags)
+{
+    int rv = -1;
+    struct private_data *priv = conn->privateData;
+    remote_connect_get_rpc_stats_args args;
+    remote_connect_get_rpc_stats_ret ret;
+    virTypedParameterPtr tmpparams = NULL;
+    int ntmpparams;
+
+    remoteDriverLock(priv);
+
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+    if (call(conn, priv, 0, REMOTE_PROC_CONNECT_GET_RPC_STATS,
+             (xdrproc_t) xdr_remote_connect_get_rpc_stats_args,
+             (char *) &args,
+             (xdrproc_t) xdr_remote_connect_get_rpc_stats_ret,
+             (char *) &ret) == -1)
+        goto done;
+
+    ntmpparams = ret.params.params_len;
+    if (ntmpparams &&
+        VIR_ALLOC_N(tmpparams, ntmpparams) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    if (remoteDeserializeTypedParameters(ret.params.params_val,
+                                         ret.params.params_len,
+                                         REMOTE_CONNECT_GET_RPC_STATS_MAX,
+                                         tmpparams,
+                                         &ntmpparams) < 0)
+        goto cleanup;
+
+    *params = tmpparams;
+    *nparams = ntmpparams;
+    tmpparams = NULL;
+    rv = 0;
+
+cleanup:
+    virTypedParamsFree(tmpparams, ntmpparams);
+    xdr_free((xdrproc_t) xdr_remote_connect_get_rpc_stats_ret,
+             (char *) &ret);
+
+done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+
+/* Calls submitted with the *Async APIs: the reply is decoded into
+ * @ret by whichever thread processes the client I/O, and then
+ * copied into the caller's structure @result */
+struct remoteAsyncCallData {
+    virDomainPtr dom;
+    int proc;
+    void *result;
+    size_t size;
+    virConnectAsyncCallback cb;
+    void *opaque;
+    union {
+        remote_domain_get_info_ret info;
+        remote_domain_block_stats_ret block;
+        remote_domain_interface_stats_ret iface;
+    } ret;
+};
+
+static struct remoteAsyncCallData *
+remoteAsyncCallDataNew(virDomainPtr dom,
+                       int proc,
+                       void *result,
+                       size_t size,
+                       virConnectAsyncCallback cb,
+                       void *opaque)
+{
+    struct remoteAsyncCallData *data;
+
+    if (VIR_ALLOC(data) < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+
+    /* Keeps the connection alive until the reply is in */
+    data->dom = virObjectRef(dom);
+    data->proc = proc;
+    data->result = result;
+    data->size = size;
+    data->cb = cb;
+    data->opaque = opaque;
+
+    return data;
+}
+
+static void
+remoteAsyncCallDataFree(struct remoteAsyncCallData *data)
+{
+    if (!data)
+        return;
+
+    virObjectUnref(data->dom);
+    VIR_FREE(data);
+}
+
+static int
+remoteAsyncCallCopyResult(struct remoteAsyncCallData *data)
+{
+    int rv = -1;
+
+    switch (data->proc) {
+    case REMOTE_PROC_DOMAIN_GET_INFO: {
+        virDomainInfoPtr info = data->result;
+
+        info->state = data->ret.info.state;
+        HYPER_TO_ULONG(info->maxMem, data->ret.info.maxMem);
+        HYPER_TO_ULONG(info->memory, data->ret.info.memory);
+        info->nrVirtCpu = data->ret.info.nrVirtCpu;
+        info->cpuTime = data->ret.info.cpuTime;
+        break;
+    }
+
+    case REMOTE_PROC_DOMAIN_BLOCK_STATS: {
+        struct _virDomainBlockStats stats;
+
+        stats.rd_req = data->ret.block.rd_req;
+        stats.rd_bytes = data->ret.block.rd_bytes;
+        stats.wr_req = data->ret.block.wr_req;
+        stats.wr_bytes = data->ret.block.wr_bytes;
+        stats.errs = data->ret.block.errs;
+        memcpy(data->result, &stats, data->size);
+        break;
+    }
+
+    case REMOTE_PROC_DOMAIN_INTERFACE_STATS: {
+        struct _virDomainInterfaceStats stats;
+
+        stats.rx_bytes = data->ret.iface.rx_bytes;
+        stats.rx_packets = data->ret.iface.rx_packets;
+        stats.rx_errs = data->ret.iface.rx_errs;
+        stats.rx_drop = data->ret.iface.rx_drop;
+        stats.tx_bytes = data->ret.iface.tx_bytes;
+        stats.tx_packets = data->ret.iface.tx_packets;
+        stats.tx_errs = data->ret.iface.tx_errs;
+        stats.tx_drop = data->ret.iface.tx_drop;
+        memcpy(data->result, &stats, data->size);
+        break;
+    }
+
+    default:
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("unexpected async procedure %d"), data->proc);
+        goto done;
+    }
+
+    rv = 0;
+
+done:
+    return rv;
+}
+
+static void
+remoteAsyncCallDone(virNetClientProgramPtr prog ATTRIBUTE_UNUSED,
+                    int rv,
+                    void *opaque)
+{
+    struct remoteAsyncCallData *data = opaque;
+    virConnectPtr conn = data->dom->conn;
+
+    if (rv == 0)
+        rv = remoteAsyncCallCopyResult(data);
+
+    if (rv < 0)
+        virDispatchError(conn);
+
+    data->cb(conn, rv, data->opaque);
+    remoteAsyncCallDataFree(data);
+}
+
+/* Like call(), but @data->cb is invoked once the reply arrives
+ * instead of waiting for it */
+static int
+remoteCallAsync(struct private_data *priv,
+                struct remoteAsyncCallData *data,
+                xdrproc_t args_filter, char *args,
+                xdrproc_t ret_filter)
+{
+    int rv;
+    int counter = priv->counter++;
+    virNetClientPtr client = priv->client;
+    virNetClientProgramPtr prog = priv->remoteProgram;
+
+    /* The reply callback of an earlier call may run from within
+     * virNetClientSendAsync and issue calls on this connection */
+    remoteDriverUnlock(priv);
+    rv = virNetClientProgramCallAsync(prog,
+                                      client,
+                                      counter,
+                                      data->proc,
+                                      args_filter, args,
+                                      ret_filter, &data->ret,
+                                      remoteAsyncCallDone, data);
+    remoteDriverLock(priv);
+
+    return rv;
+}
+
+static int
+remoteDomainGetInfoAsync(virDomainPtr dom,
+                         virDomainInfoPtr info,
+                         virConnectAsyncCallback cb,
+                         void *opaque,
+                         unsigned int flags)
+{
+    int rv = -1;
+    struct private_data *priv = dom->conn->privateData;
+    remote_domain_get_info_args args;
+    struct remoteAsyncCallData *data;
+
+    virCheckFlags(0, -1);
+
+    if (!(data = remoteAsyncCallDataNew(dom, REMOTE_PROC_DOMAIN_GET_INFO,
+                                        info, sizeof(*info), cb, opaque)))
+        return -1;
+
+    remoteDriverLock(priv);
+
+    make_nonnull_domain(&args.dom, dom);
+
+    if (remoteCallAsync(priv, data,
+                        (xdrproc_t) xdr_remote_domain_get_info_args,
+                        (char *) &args,
+                        (xdrproc_t) xdr_remote_domain_get_info_ret) < 0) {
+        remoteAsyncCallDataFree(data);
+        goto done;
+    }
+
+    rv = 0;
+
+done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+static int
+remoteDomainBlockStatsAsync(virDomainPtr dom,
+                            const char *path,
+                            virDomainBlockStatsPtr stats,
+                            size_t size,
+                            virConnectAsyncCallback cb,
+                            void *opaque,
+                            unsigned int flags)
+{
+    int rv = -1;
+    struct private_data *priv = dom->conn->privateData;
+    remote_domain_block_stats_args args;
+    struct remoteAsyncCallData *data;
+
+    virCheckFlags(0, -1);
+
+    if (!(data = remoteAsyncCallDataNew(dom, REMOTE_PROC_DOMAIN_BLOCK_STATS,
+                                        stats, size, cb, opaque)))
+        return -1;
+
+    remoteDriverLock(priv);
+
+    make_nonnull_domain(&args.dom, dom);
+    args.path = (char *) path;
+
+    if (remoteCallAsync(priv, data,
+                        (xdrproc_t) xdr_remote_domain_block_stats_args,
+                        (char *) &args,
+                        (xdrproc_t) xdr_remote_domain_block_stats_ret) < 0) {
+        remoteAsyncCallDataFree(data);
+        goto done;
+    }
+
+    rv = 0;
+
+done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+static int
+remoteDomainInterfaceStatsAsync(virDomainPtr dom,
+                                const char *path,
+                                virDomainInterfaceStatsPtr stats,
+                                size_t size,
+                                virConnectAsyncCallback cb,
+                                void *opaque,
+                                unsigned int flags)
+{
+    int rv = -1;
+    struct private_data *priv = dom->conn->privateData;
+    remote_domain_interface_stats_args args;
+    struct remoteAsyncCallData *data;
+
+    virCheckFlags(0, -1);
+
+    if (!(data = remoteAsyncCallDataNew(dom, REMOTE_PROC_DOMAIN_INTERFACE_STATS,
+                                        stats, size, cb, opaque)))
+        return -1;
+
+    remoteDriverLock(priv);
+
+    make_nonnull_domain(&args.dom, dom);
+    args.path = (char *) path;
+
+    if (remoteCallAsync(priv, data,
+                        (xdrproc_t) xdr_remote_domain_interface_stats_args,
+                        (char *) &args,
+                        (xdrproc_t) xdr_remote_domain_interface_stats_ret) < 0) {
+        remoteAsyncCallDataFree(data);
+        goto done;
+    }
+
+    rv = 0;
+
+done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+static int
+remoteConnectWaitAsync(virConnectPtr conn,
+                       unsigned int flags)
+{
+    int rv;
+    struct private_data *priv = conn->privateData;
+    virNetClientPtr client;
+
+    virCheckFlags(0, -1);
+
+    remoteDriverLock(priv);
+    client = virObjectRef(priv->client);
+    remoteDriverUnlock(priv);
+
+    /* Reply callbacks run from here, and must be able to
+     * issue calls, so the driver lock is not held */
+    rv = virNetClientWaitAsync(client);
+    virObjectUnref(client);
+
+    return rv;
+}
+
 static int
 remoteDomainLxcOpenNamespace(virDomainPtr domain,
                              int **fdlist,
@@ -6239,6 +7541,14 @@ static virDriver remote_driver = {
     .nodeGetCPUMap = remoteNodeGetCPUMap, /* 1.0.0 */
     .domainFSTrim = remoteDomainFSTrim, /* 1.0.1 */
     .domainLxcOpenNamespace = remoteDomainLxcOpenNamespace, /* 1.0.2 */
+    .connectGetAllDomainStats = remoteConnectGetAllDomainStats, /* 1.0.3 */
+    .connectGetRPCStats = remoteConnectGetRPCStats, /* 1.0.3 */
+    .domainGetInfoAsync = remoteDomainGetInfoAsync, /* 1.0.3 */
+    .domainBlockStatsAsync = remoteDomainBlockStatsAsync, /* 1.0.3 */
+    .domainInterfaceStatsAsync = remoteDomainInterfaceStatsAsync, /* 1.0.3 */
+    .connectWaitAsync = remoteConnectWaitAsync, /* 1.0.3 */
+    .domainMigratePrepareTunnelStream = remoteDomainMigratePrepareTunnelStream, /* 1.0.3 */
+    .domainGetJobStats = remoteDomainGetJobStats, /* 1.0.3 */
 };
 
 static virNetworkDriver network_driver = {
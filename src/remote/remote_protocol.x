@@ -234,6 +234,40 @@ const REMOTE_DOMAIN_DISK_ERRORS_MAX = 256;
  */
 const REMOTE_NODE_MEMORY_PARAMETERS_MAX = 64;
 
+/*
+ * Upper limit on number of domains in a domain list sent by the client
+ */
+const REMOTE_DOMAIN_LIST_MAX = 16384;
+
+/*
+ * Upper limit on number of stats fields returned for a single domain
+ */
+const REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX = 4096;
+
+/*
+ * Upper limit on number of RPC statistics fields
+ */
+const REMOTE_CONNECT_GET_RPC_STATS_MAX = 16384;
+
+/*
+ * Upper limit on number of objects in one page of a paged list
+ * reply. The server returns fewer if they wouldn't fit in a message.
+ */
+const REMOTE_LIST_PAGE_MAX = 16384;
+
+/* Upper limit on number of domains a client can filter events by. */
+const REMOTE_DOMAIN_EVENT_FILTER_MAX = 16384;
+
+/*
+ * Upper limits on number of events coalesced into one batch message,
+ * and on the size of the data of each of them.
+ */
+const REMOTE_DOMAIN_EVENT_BATCH_MAX = 1024;
+const REMOTE_DOMAIN_EVENT_BATCH_DATA_MAX = 65536;
+
+/* Upper limit on number of job stats */
+const REMOTE_DOMAIN_JOB_STATS_MAX = 64;
+
 /* UUID.  VIR_UUID_BUFLEN definition comes from libvirt.h */
 typedef opaque remote_uuid[VIR_UUID_BUFLEN];
 
@@ -2145,6 +2179,17 @@ struct remote_domain_get_job_info_ret { /* insert@1 */
     unsigned hyper fileRemaining;
 };
 
+struct remote_domain_get_job_stats_args {
+    remote_nonnull_domain dom;
+    unsigned int flags;
+};
+
+struct remote_domain_get_job_stats_ret {
+    int type;
+    remote_typed_param params<REMOTE_DOMAIN_JOB_STATS_MAX>;
+};
+
+
 
 struct remote_domain_abort_job_args {
     remote_nonnull_domain dom;
@@ -2270,6 +2315,44 @@ struct remote_domain_event_pmsuspend_disk_msg {
     remote_nonnull_domain dom;
 };
 
+struct remote_domain_event_migration_stalled_msg {
+    remote_nonnull_domain dom;
+    unsigned hyper iteration;
+    unsigned hyper dirtyRate;
+    unsigned hyper bandwidth;
+};
+
+/*
+ * Restrict the events of type @eventID relayed to the client to
+ * those of the domains in @doms, unless @all is set.
+ */
+struct remote_domain_events_filter_args {
+    int eventID;
+    int all;
+    remote_uuid doms<REMOTE_DOMAIN_EVENT_FILTER_MAX>;
+};
+
+/*
+ * Several events sent as one message: @data is what would have been
+ * the payload of an event message for @procedure.
+ */
+struct remote_domain_event_batch_entry {
+    int procedure;
+    opaque data<REMOTE_DOMAIN_EVENT_BATCH_DATA_MAX>;
+};
+
+struct remote_domain_event_batch_msg {
+    remote_domain_event_batch_entry events<REMOTE_DOMAIN_EVENT_BATCH_MAX>;
+};
+
+/*
+ * Have events sent in REMOTE_PROC_DOMAIN_EVENT_BATCH messages if
+ * @enable is set, or one message each otherwise.
+ */
+struct remote_domain_events_batch_args {
+    int enable;
+};
+
 struct remote_domain_managed_save_args {
     remote_nonnull_domain dom;
     unsigned int flags;
@@ -2508,6 +2591,11 @@ struct remote_domain_migrate_prepare_tunnel3_ret {
     opaque cookie_out<REMOTE_MIGRATE_COOKIE_MAX>; /* insert@3 */
 };
 
+struct remote_domain_migrate_prepare_tunnel_stream_args {
+    remote_nonnull_string dname;
+    unsigned int flags;
+};
+
 struct remote_domain_migrate_perform3_args {
     remote_nonnull_domain dom;
     remote_string xmlin;
@@ -2702,6 +2790,124 @@ struct remote_domain_fstrim_args {
     unsigned int flags;
 };
 
+struct remote_domain_stats_record {
+    remote_nonnull_domain dom;
+    remote_typed_param params<REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX>;
+};
+
+struct remote_connect_get_all_domain_stats_args {
+    remote_nonnull_domain doms<REMOTE_DOMAIN_LIST_MAX>;
+    unsigned int stats;
+    unsigned int flags;
+};
+
+struct remote_connect_get_all_domain_stats_ret {
+    remote_domain_stats_record retStats<REMOTE_DOMAIN_LIST_MAX>;
+};
+
+struct remote_connect_get_rpc_stats_args {
+    unsigned int flags;
+};
+
+struct remote_connect_get_rpc_stats_ret {
+    remote_typed_param params<REMOTE_CONNECT_GET_RPC_STATS_MAX>;
+};
+
+/*
+ * Paged variants of the list_all procedures: each call returns the
+ * objects following @start in the order of their names (UUIDs for
+ * secrets), or the first ones if @start is NULL, and whether more
+ * objects follow.
+ */
+struct remote_connect_list_all_domains_paged_args {
+    remote_string start;
+    unsigned int max;
+    unsigned int flags;
+};
+
+struct remote_connect_list_all_domains_paged_ret {
+    remote_nonnull_domain domains<REMOTE_LIST_PAGE_MAX>;
+    int more;
+};
+
+struct remote_connect_list_all_storage_pools_paged_args {
+    remote_string start;
+    unsigned int max;
+    unsigned int flags;
+};
+
+struct remote_connect_list_all_storage_pools_paged_ret {
+    remote_nonnull_storage_pool pools<REMOTE_LIST_PAGE_MAX>;
+    int more;
+};
+
+struct remote_storage_pool_list_all_volumes_paged_args {
+    remote_nonnull_storage_pool pool;
+    remote_string start;
+    unsigned int max;
+    unsigned int flags;
+};
+
+struct remote_storage_pool_list_all_volumes_paged_ret {
+    remote_nonnull_storage_vol vols<REMOTE_LIST_PAGE_MAX>;
+    int more;
+};
+
+struct remote_connect_list_all_networks_paged_args {
+    remote_string start;
+    unsigned int max;
+    unsigned int flags;
+};
+
+struct remote_connect_list_all_networks_paged_ret {
+    remote_nonnull_network nets<REMOTE_LIST_PAGE_MAX>;
+    int more;
+};
+
+struct remote_connect_list_all_interfaces_paged_args {
+    remote_string start;
+    unsigned int max;
+    unsigned int flags;
+};
+
+struct remote_connect_list_all_interfaces_paged_ret {
+    remote_nonnull_interface ifaces<REMOTE_LIST_PAGE_MAX>;
+    int more;
+};
+
+struct remote_connect_list_all_node_devices_paged_args {
+    remote_string start;
+    unsigned int max;
+    unsigned int flags;
+};
+
+struct remote_connect_list_all_node_devices_paged_ret {
+    remote_nonnull_node_device devices<REMOTE_LIST_PAGE_MAX>;
+    int more;
+};
+
+struct remote_connect_list_all_nwfilters_paged_args {
+    remote_string start;
+    unsigned int max;
+    unsigned int flags;
+};
+
+struct remote_connect_list_all_nwfilters_paged_ret {
+    remote_nonnull_nwfilter filters<REMOTE_LIST_PAGE_MAX>;
+    int more;
+};
+
+struct remote_connect_list_all_secrets_paged_args {
+    remote_string start;
+    unsigned int max;
+    unsigned int flags;
+};
+
+struct remote_connect_list_all_secrets_paged_ret {
+    remote_nonnull_secret secrets<REMOTE_LIST_PAGE_MAX>;
+    int more;
+};
+
 /*----- Protocol. -----*/
 
 /* Define the program number, protocol version and procedure numbers here. */
@@ -3049,7 +3255,25 @@ enum remote_procedure {
     REMOTE_PROC_NODE_GET_CPU_MAP = 293, /* skipgen skipgen */
     REMOTE_PROC_DOMAIN_FSTRIM = 294, /* autogen autogen */
     REMOTE_PROC_DOMAIN_SEND_PROCESS_SIGNAL = 295, /* autogen autogen */
-    REMOTE_PROC_DOMAIN_OPEN_CHANNEL = 296 /* autogen autogen | readstream@2 */
+    REMOTE_PROC_DOMAIN_OPEN_CHANNEL = 296, /* autogen autogen | readstream@2 */
+    REMOTE_PROC_CONNECT_GET_ALL_DOMAIN_STATS = 297, /* skipgen skipgen */
+    REMOTE_PROC_CONNECT_GET_RPC_STATS = 298, /* skipgen skipgen */
+    REMOTE_PROC_CONNECT_LIST_ALL_DOMAINS_PAGED = 299, /* skipgen skipgen priority:high */
+    REMOTE_PROC_CONNECT_LIST_ALL_STORAGE_POOLS_PAGED = 300, /* skipgen skipgen priority:high */
+
+    REMOTE_PROC_STORAGE_POOL_LIST_ALL_VOLUMES_PAGED = 301, /* skipgen skipgen priority:high */
+    REMOTE_PROC_CONNECT_LIST_ALL_NETWORKS_PAGED = 302, /* skipgen skipgen priority:high */
+    REMOTE_PROC_CONNECT_LIST_ALL_INTERFACES_PAGED = 303, /* skipgen skipgen priority:high */
+    REMOTE_PROC_CONNECT_LIST_ALL_NODE_DEVICES_PAGED = 304, /* skipgen skipgen priority:high */
+    REMOTE_PROC_CONNECT_LIST_ALL_NWFILTERS_PAGED = 305, /* skipgen skipgen priority:high */
+    REMOTE_PROC_CONNECT_LIST_ALL_SECRETS_PAGED = 306, /* skipgen skipgen priority:high */
+    REMOTE_PROC_DOMAIN_EVENTS_FILTER = 307, /* skipgen skipgen priority:high */
+    REMOTE_PROC_DOMAIN_EVENT_BATCH = 308, /* autogen autogen */
+    REMOTE_PROC_DOMAIN_MIGRATE_PREPARE_TUNNEL_STREAM = 309, /* autogen autogen | writestream@1 */
+    REMOTE_PROC_DOMAIN_GET_JOB_STATS = 310, /* skipgen skipgen */
+
+    REMOTE_PROC_DOMAIN_EVENT_MIGRATION_STALLED = 311, /* autogen autogen */
+    REMOTE_PROC_DOMAIN_EVENTS_BATCH = 312 /* skipgen skipgen priority:high */
 
     /*
      * Notice how the entries are grouped in sets of 10 ?
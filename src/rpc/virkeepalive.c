@@ -34,6 +34,28 @@
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
+/* Each level of the wheel has 64 slots; a level 0 slot covers one
+ * second, a level 1 slot covers 64 seconds */
+#define VIR_KEEPALIVE_WHEEL_BITS 6
+#define VIR_KEEPALIVE_WHEEL_SLOTS (1 << VIR_KEEPALIVE_WHEEL_BITS)
+#define VIR_KEEPALIVE_WHEEL_MASK (VIR_KEEPALIVE_WHEEL_SLOTS - 1)
+#define VIR_KEEPALIVE_WHEEL_LEVELS 2
+#define VIR_KEEPALIVE_WHEEL_SPAN \
+    (1 << (VIR_KEEPALIVE_WHEEL_BITS * VIR_KEEPALIVE_WHEEL_LEVELS))
+
+struct _virKeepAliveWheel {
+    virMutex lock;
+
+    virEventEpollLoopPtr loop;
+    int timer;
+    virKeepAliveClockFunc clock;
+
+    /* Second up to which the slots have been processed */
+    time_t now;
+    size_t nkas;
+    virKeepAlivePtr slots[VIR_KEEPALIVE_WHEEL_LEVELS][VIR_KEEPALIVE_WHEEL_SLOTS];
+};
+
 struct _virKeepAlive {
     virObjectLockable parent;
 
@@ -44,6 +66,17 @@ struct _virKeepAlive {
     time_t intervalStart;
     int timer;
 
+    /* Set when the keepalive is driven by a shared wheel rather
+     * than by a timer of its own. While queued in a slot, the
+     * wheel holds a reference to the keepalive. */
+    virKeepAliveWheelPtr wheel;
+    bool wheelActive;
+    bool wheelQueued;
+    time_t wheelExpires;
+    virKeepAlivePtr *wheelSlot;
+    virKeepAlivePtr wheelPrev;
+    virKeepAlivePtr wheelNext;
+
     virKeepAliveSendFunc sendCB;
     virKeepAliveDeadFunc deadCB;
     virKeepAliveFreeFunc freeCB;
@@ -67,6 +100,14 @@ static int virKeepAliveOnceInit(void)
 
 VIR_ONCE_GLOBAL_INIT(virKeepAlive)
 
+/* Keepalives driven by a wheel go by its clock. Must be called
+ * with @ka locked. */
+static time_t
+virKeepAliveNow(virKeepAlivePtr ka)
+{
+    return ka->wheel ? ka->wheel->clock(NULL) : time(NULL);
+}
+
 static virNetMessagePtr
 virKeepAliveMessage(virKeepAlivePtr ka, int proc)
 {
@@ -112,18 +153,161 @@ error:
 }
 
 
+/*
+ * Wheel slots are doubly linked lists of keepalives, which must be
+ * manipulated with the wheel locked.
+ */
+static void
+virKeepAliveWheelLinkSlot(virKeepAlivePtr *slot,
+                          virKeepAlivePtr ka)
+{
+    ka->wheelSlot = slot;
+    ka->wheelPrev = NULL;
+    ka->wheelNext = *slot;
+    if (*slot)
+        (*slot)->wheelPrev = ka;
+    *slot = ka;
+}
+
+
+static void
+virKeepAliveWheelLink(virKeepAliveWheelPtr wheel,
+                      virKeepAlivePtr ka)
+{
+    time_t expires = ka->wheelExpires;
+    time_t delta;
+    virKeepAlivePtr *slot;
+
+    if (expires <= wheel->now)
+        expires = wheel->now + 1;
+    delta = expires - wheel->now;
+
+    if (delta < VIR_KEEPALIVE_WHEEL_SLOTS) {
+        slot = &wheel->slots[0][expires & VIR_KEEPALIVE_WHEEL_MASK];
+    } else {
+        /* Anything beyond the span of the wheel is parked in the
+         * farthest slot, and requeued from there once it comes up */
+        if (delta >= VIR_KEEPALIVE_WHEEL_SPAN)
+            expires = wheel->now + VIR_KEEPALIVE_WHEEL_SPAN - 1;
+        slot = &wheel->slots[1][(expires >> VIR_KEEPALIVE_WHEEL_BITS) &
+                                VIR_KEEPALIVE_WHEEL_MASK];
+    }
+
+    virKeepAliveWheelLinkSlot(slot, ka);
+}
+
+
+static void
+virKeepAliveWheelUnlink(virKeepAlivePtr ka)
+{
+    if (ka->wheelPrev)
+        ka->wheelPrev->wheelNext = ka->wheelNext;
+    else
+        *ka->wheelSlot = ka->wheelNext;
+    if (ka->wheelNext)
+        ka->wheelNext->wheelPrev = ka->wheelPrev;
+    ka->wheelSlot = NULL;
+    ka->wheelPrev = ka->wheelNext = NULL;
+}
+
+
+static void virKeepAliveWheelTick(int timer, void *opaque);
+
+/*
+ * Queue @ka, which must be locked, to expire @timeout seconds
+ * from now. Keepalives are only ever queued once, so calling
+ * this again just moves @ka to its new slot.
+ */
+static int
+virKeepAliveWheelQueue(virKeepAliveWheelPtr wheel,
+                       virKeepAlivePtr ka,
+                       int timeout)
+{
+    int ret = -1;
+
+    virMutexLock(&wheel->lock);
+
+    if (wheel->nkas == 0) {
+        /* The slots have not been looked at since the wheel last
+         * emptied, so catch up before anything is queued */
+        wheel->now = wheel->clock(NULL);
+
+        if (wheel->timer < 0) {
+            if ((wheel->timer = virEventEpollLoopAddTimeout(wheel->loop, 1000,
+                                                            virKeepAliveWheelTick,
+                                                            wheel, NULL)) < 0)
+                goto cleanup;
+        } else {
+            virEventEpollLoopUpdateTimeout(wheel->loop, wheel->timer, 1000);
+        }
+    }
+
+    if (ka->wheelQueued) {
+        virKeepAliveWheelUnlink(ka);
+    } else {
+        ka->wheelQueued = true;
+        wheel->nkas++;
+        virObjectRef(ka);
+    }
+
+    ka->wheelExpires = wheel->clock(NULL) + timeout;
+    virKeepAliveWheelLink(wheel, ka);
+    ret = 0;
+
+cleanup:
+    virMutexUnlock(&wheel->lock);
+    return ret;
+}
+
+
+/*
+ * Take @ka, which must be locked, out of the wheel. Returns true
+ * if it was queued, in which case the caller inherits the
+ * reference the wheel had.
+ */
+static bool
+virKeepAliveWheelDequeue(virKeepAliveWheelPtr wheel,
+                         virKeepAlivePtr ka)
+{
+    bool queued;
+
+    virMutexLock(&wheel->lock);
+    if ((queued = ka->wheelQueued)) {
+        virKeepAliveWheelUnlink(ka);
+        ka->wheelQueued = false;
+        wheel->nkas--;
+    }
+    virMutexUnlock(&wheel->lock);
+
+    return queued;
+}
+
+
+static void
+virKeepAliveReschedule(virKeepAlivePtr ka,
+                       int timeout)
+{
+    if (ka->wheel) {
+        if (virKeepAliveWheelQueue(ka->wheel, ka, timeout) < 0)
+            VIR_WARN("Failed to queue keepalive for client %p", ka->client);
+    } else {
+        virEventUpdateTimeout(ka->timer, timeout * 1000);
+    }
+}
+
+
 static bool
 virKeepAliveTimerInternal(virKeepAlivePtr ka,
                           virNetMessagePtr *msg)
 {
-    time_t now = time(NULL);
+    time_t now = virKeepAliveNow(ka);
 
     if (ka->interval <= 0 || ka->intervalStart == 0)
         return false;
 
     if (now - ka->intervalStart < ka->interval) {
         int timeout = ka->interval - (now - ka->intervalStart);
-        virEventUpdateTimeout(ka->timer, timeout * 1000);
+        virKeepAliveReschedule(ka, timeout);
         return false;
     }
 
@@ -144,7 +328,7 @@ virKeepAliveTimerInternal(virKeepAlivePtr ka,
         ka->countToDeath--;
         ka->intervalStart = now;
         *msg = virKeepAliveMessage(ka, KEEPALIVE_PROC_PING);
-        virEventUpdateTimeout(ka->timer, ka->interval * 1000);
+        virKeepAliveReschedule(ka, ka->interval);
         return false;
     }
 }
@@ -228,6 +412,21 @@ virKeepAliveDispose(void *obj)
 }
 
 
+/*
+ * Let @wheel rather than a timer of its own drive @ka. Must be
+ * called before virKeepAliveStart, and @wheel must exist until
+ * @ka is stopped.
+ */
+void
+virKeepAliveSetWheel(virKeepAlivePtr ka,
+                     virKeepAliveWheelPtr wheel)
+{
+    virObjectLock(ka);
+    ka->wheel = wheel;
+    virObjectUnlock(ka);
+}
+
+
 int
 virKeepAliveStart(virKeepAlivePtr ka,
                   int interval,
@@ -240,7 +439,7 @@ virKeepAliveStart(virKeepAlivePtr ka,
 
     virObjectLock(ka);
 
-    if (ka->timer >= 0) {
+    if (ka->timer >= 0 || ka->wheelActive) {
         VIR_DEBUG("Keepalive messages already enabled");
         ret = 0;
         goto cleanup;
@@ -267,13 +466,22 @@ virKeepAliveStart(virKeepAlivePtr ka,
           "ka=%p client=%p interval=%d count=%u",
           ka, ka->client, interval, count);
 
-    now = time(NULL);
+    now = virKeepAliveNow(ka);
     delay = now - ka->lastPacketReceived;
     if (delay > ka->interval)
         timeout = 0;
     else
         timeout = ka->interval - delay;
     ka->intervalStart = now - (ka->interval - timeout);
+
+    if (ka->wheel) {
+        if (virKeepAliveWheelQueue(ka->wheel, ka, timeout) < 0)
+            goto cleanup;
+        ka->wheelActive = true;
+        ret = 0;
+        goto cleanup;
+    }
+
     ka->timer = virEventAddTimeout(timeout * 1000, virKeepAliveTimer,
                                    ka, virObjectFreeCallback);
     if (ka->timer < 0)
@@ -292,6 +500,8 @@ cleanup:
 void
 virKeepAliveStop(virKeepAlivePtr ka)
 {
+    bool queued = false;
+
     virObjectLock(ka);
 
     PROBE(RPC_KEEPALIVE_STOP,
@@ -303,7 +513,16 @@ virKeepAliveStop(virKeepAlivePtr ka)
         ka->timer = -1;
     }
 
+    if (ka->wheelActive) {
+        ka->wheelActive = false;
+        queued = virKeepAliveWheelDequeue(ka->wheel, ka);
+    }
+
     virObjectUnlock(ka);
+
+    /* The reference the wheel had */
+    if (queued)
+        virObjectUnref(ka);
 }
 
 
@@ -320,7 +539,7 @@ virKeepAliveTimeout(virKeepAlivePtr ka)
     if (ka->interval <= 0 || ka->intervalStart == 0) {
         timeout = -1;
     } else {
-        timeout = ka->interval - (time(NULL) - ka->intervalStart);
+        timeout = ka->interval - (virKeepAliveNow(ka) - ka->intervalStart);
         if (timeout < 0)
             timeout = 0;
     }
@@ -369,7 +588,7 @@ virKeepAliveCheckMessage(virKeepAlivePtr ka,
     virObjectLock(ka);
 
     ka->countToDeath = ka->count;
-    ka->lastPacketReceived = ka->intervalStart = time(NULL);
+    ka->lastPacketReceived = ka->intervalStart = virKeepAliveNow(ka);
 
     if (msg->header.prog == KEEPALIVE_PROGRAM &&
         msg->header.vers == KEEPALIVE_PROTOCOL_VERSION &&
@@ -395,6 +614,9 @@ virKeepAliveCheckMessage(virKeepAlivePtr ka,
         }
     }
 
+    /* A keepalive in a wheel is left in its slot, and requeued
+     * according to intervalStart once the slot comes up, so that
+     * incoming traffic never has to touch the wheel */
     if (ka->timer >= 0)
         virEventUpdateTimeout(ka->timer, ka->interval * 1000);
 
@@ -402,3 +624,265 @@ virKeepAliveCheckMessage(virKeepAlivePtr ka,
 
     return ret;
 }
+
+
+/*
+ * A timer wheel driving the keepalives of many clients with a
+ * single timer, which ticks once a second while any keepalive is
+ * queued. Every tick, the keepalives whose slot came up are checked
+ * all at once: pings go out to those which were idle for a whole
+ * interval, those which did not answer enough pings are declared
+ * dead, and the rest are requeued according to when they last got
+ * a packet.
+ */
+virKeepAliveWheelPtr
+virKeepAliveWheelNew(virEventEpollLoopPtr loop)
+{
+    virKeepAliveWheelPtr wheel;
+
+    if (VIR_ALLOC(wheel) < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+
+    if (virMutexInit(&wheel->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize mutex"));
+        VIR_FREE(wheel);
+        return NULL;
+    }
+
+    wheel->loop = loop;
+    wheel->timer = -1;
+    wheel->clock = time;
+    wheel->now = time(NULL);
+
+    return wheel;
+}
+
+
+/*
+ * Must only be called once all keepalives using @wheel have been
+ * stopped, and its event loop is no longer running
+ */
+void
+virKeepAliveWheelFree(virKeepAliveWheelPtr wheel)
+{
+    if (!wheel)
+        return;
+
+    if (wheel->nkas)
+        VIR_WARN("Freeing keepalive wheel %p with %zu keepalives queued",
+                 wheel, wheel->nkas);
+
+    if (wheel->timer >= 0)
+        virEventEpollLoopRemoveTimeout(wheel->loop, wheel->timer);
+
+    virMutexDestroy(&wheel->lock);
+    VIR_FREE(wheel);
+}
+
+
+/*
+ * Make @wheel and the keepalives it drives read the time from
+ * @clock rather than time(), which lets tests move time forward
+ * at will. Must be called before anything is queued.
+ */
+void
+virKeepAliveWheelSetClock(virKeepAliveWheelPtr wheel,
+                          virKeepAliveClockFunc clock)
+{
+    virMutexLock(&wheel->lock);
+    wheel->clock = clock;
+    wheel->now = clock(NULL);
+    virMutexUnlock(&wheel->lock);
+}
+
+
+/*
+ * Move the contents of @slot to the front of @expired, keeping
+ * the references the wheel had
+ */
+static void
+virKeepAliveWheelTake(virKeepAliveWheelPtr wheel,
+                      virKeepAlivePtr *slot,
+                      virKeepAlivePtr *expired)
+{
+    while (*slot) {
+        virKeepAlivePtr ka = *slot;
+
+        *slot = ka->wheelNext;
+        ka->wheelSlot = NULL;
+        ka->wheelPrev = NULL;
+        ka->wheelNext = *expired;
+        ka->wheelQueued = false;
+        wheel->nkas--;
+        *expired = ka;
+    }
+}
+
+
+/*
+ * Advance the wheel up to the current time, returning the
+ * keepalives which expired on the way. Must be called with
+ * the wheel locked.
+ */
+static virKeepAlivePtr
+virKeepAliveWheelAdvance(virKeepAliveWheelPtr wheel)
+{
+    virKeepAlivePtr expired = NULL;
+    time_t now = wheel->clock(NULL);
+    size_t i, j;
+
+    /* After the clock jumped, or the process was suspended for a
+     * while, positions in the wheel are meaningless, so just
+     * check everything */
+    if (now < wheel->now || now - wheel->now >= VIR_KEEPALIVE_WHEEL_SPAN) {
+        for (i = 0 ; i < VIR_KEEPALIVE_WHEEL_LEVELS ; i++)
+            for (j = 0 ; j < VIR_KEEPALIVE_WHEEL_SLOTS ; j++)
+                virKeepAliveWheelTake(wheel, &wheel->slots[i][j], &expired);
+        wheel->now = now;
+        return expired;
+    }
+
+    while (wheel->now < now) {
+        wheel->now++;
+
+        /* Entering a new level 1 slot, spread its keepalives
+         * over level 0, or park them again if still far away */
+        if ((wheel->now & VIR_KEEPALIVE_WHEEL_MASK) == 0) {
+            virKeepAlivePtr cascade = wheel->slots[1][(wheel->now >> VIR_KEEPALIVE_WHEEL_BITS) &
+                                                      VIR_KEEPALIVE_WHEEL_MASK];
+
+            wheel->slots[1][(wheel->now >> VIR_KEEPALIVE_WHEEL_BITS) &
+                            VIR_KEEPALIVE_WHEEL_MASK] = NULL;
+            while (cascade) {
+                virKeepAlivePtr ka = cascade;
+                cascade = ka->wheelNext;
+                /* Those due this very second go to the level 0 slot
+                 * taken just below, rather than a second later */
+                if (ka->wheelExpires <= wheel->now)
+                    virKeepAliveWheelLinkSlot(&wheel->slots[0][wheel->now &
+                                                               VIR_KEEPALIVE_WHEEL_MASK],
+                                              ka);
+                else
+                    virKeepAliveWheelLink(wheel, ka);
+            }
+        }
+
+        virKeepAliveWheelTake(wheel,
+                              &wheel->slots[0][wheel->now & VIR_KEEPALIVE_WHEEL_MASK],
+                              &expired);
+    }
+
+    return expired;
+}
+
+
+/*
+ * Check the keepalives of @wheel which expired by now. This is
+ * what the timer of the wheel does every second.
+ */
+void
+virKeepAliveWheelRun(virKeepAliveWheelPtr wheel)
+{
+    virKeepAlivePtr expired;
+    virKeepAlivePtr ka;
+    virKeepAlivePtr *kas = NULL;
+    virNetMessagePtr *msgs = NULL;
+    size_t nkas = 0;
+    size_t i;
+    size_t npings = 0;
+    size_t ndead = 0;
+
+    virMutexLock(&wheel->lock);
+
+    expired = virKeepAliveWheelAdvance(wheel);
+    for (ka = expired ; ka ; ka = ka->wheelNext)
+        nkas++;
+
+    /* The list has to be copied while the wheel is locked, as a
+     * keepalive restarted meanwhile would be linked elsewhere */
+    if (nkas &&
+        (VIR_ALLOC_N(kas, nkas) < 0 ||
+         VIR_ALLOC_N(msgs, nkas) < 0)) {
+        /* Just try again on the next tick */
+        virReportOOMError();
+        while ((ka = expired)) {
+            expired = ka->wheelNext;
+            ka->wheelQueued = true;
+            wheel->nkas++;
+            virKeepAliveWheelLink(wheel, ka);
+        }
+        virMutexUnlock(&wheel->lock);
+        goto cleanup;
+    }
+
+    for (i = 0, ka = expired ; ka ; ka = ka->wheelNext)
+        kas[i++] = ka;
+    for (i = 0 ; i < nkas ; i++)
+        kas[i]->wheelNext = NULL;
+
+    if (wheel->nkas == 0 && nkas == 0 && wheel->timer >= 0)
+        virEventEpollLoopUpdateTimeout(wheel->loop, wheel->timer, -1);
+
+    virMutexUnlock(&wheel->lock);
+
+    /* First decide what to do with each of them, requeueing
+     * those which are still alive, ... */
+    for (i = 0 ; i < nkas ; i++) {
+        bool dead = false;
+
+        ka = kas[i];
+        virObjectLock(ka);
+        /* Unless stopped after it was taken out of the wheel */
+        if (ka->wheelActive)
+            dead = virKeepAliveTimerInternal(ka, &msgs[i]);
+        virObjectUnlock(ka);
+
+        if (dead) {
+            ndead++;
+        } else if (!msgs[i]) {
+            virObjectUnref(ka);
+            kas[i] = NULL;
+        } else {
+            npings++;
+        }
+    }
+
+    /* ... then send all the pings at once, and finally get rid
+     * of the dead clients */
+    if (npings || ndead)
+        VIR_DEBUG("Keepalive wheel %p sending %zu pings, closing %zu clients",
+                  wheel, npings, ndead);
+
+    for (i = 0 ; i < nkas ; i++) {
+        if (!kas[i] || !msgs[i])
+            continue;
+        if (kas[i]->sendCB(kas[i]->client, msgs[i]) < 0) {
+            VIR_WARN("Failed to send keepalive request to client %p",
+                     kas[i]->client);
+            virNetMessageFree(msgs[i]);
+        }
+        virObjectUnref(kas[i]);
+        kas[i] = NULL;
+    }
+
+    for (i = 0 ; i < nkas ; i++) {
+        if (!kas[i])
+            continue;
+        kas[i]->deadCB(kas[i]->client);
+        virObjectUnref(kas[i]);
+    }
+
+cleanup:
+    VIR_FREE(kas);
+    VIR_FREE(msgs);
+}
+
+
+static void
+virKeepAliveWheelTick(int timer ATTRIBUTE_UNUSED, void *opaque)
+{
+    virKeepAliveWheelRun(opaque);
+}
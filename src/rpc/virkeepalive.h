@@ -25,14 +25,19 @@
 
 # include "virnetmessage.h"
 # include "virobject.h"
+# include "vireventepoll.h"
 
 typedef int (*virKeepAliveSendFunc)(void *client, virNetMessagePtr msg);
 typedef void (*virKeepAliveDeadFunc)(void *client);
 typedef void (*virKeepAliveFreeFunc)(void *client);
+typedef time_t (*virKeepAliveClockFunc)(time_t *t);
 
 typedef struct _virKeepAlive virKeepAlive;
 typedef virKeepAlive *virKeepAlivePtr;
 
+typedef struct _virKeepAliveWheel virKeepAliveWheel;
+typedef virKeepAliveWheel *virKeepAliveWheelPtr;
+
 
 virKeepAlivePtr virKeepAliveNew(int interval,
                                 unsigned int count,
@@ -43,6 +48,9 @@ virKeepAlivePtr virKeepAliveNew(int interval,
                                 ATTRIBUTE_NONNULL(3) ATTRIBUTE_NONNULL(4)
                                 ATTRIBUTE_NONNULL(5) ATTRIBUTE_NONNULL(6);
 
+void virKeepAliveSetWheel(virKeepAlivePtr ka,
+                          virKeepAliveWheelPtr wheel);
+
 int virKeepAliveStart(virKeepAlivePtr ka,
                       int interval,
                       unsigned int count);
@@ -55,4 +63,10 @@ bool virKeepAliveCheckMessage(virKeepAlivePtr ka,
                               virNetMessagePtr msg,
                               virNetMessagePtr *response);
 
+virKeepAliveWheelPtr virKeepAliveWheelNew(virEventEpollLoopPtr loop);
+void virKeepAliveWheelFree(virKeepAliveWheelPtr wheel);
+void virKeepAliveWheelSetClock(virKeepAliveWheelPtr wheel,
+                               virKeepAliveClockFunc clock);
+void virKeepAliveWheelRun(virKeepAliveWheelPtr wheel);
+
 #endif /* __VIR_KEEPALIVE_H__ */
@@ -56,6 +56,14 @@ struct _virNetClientCall {
     bool nonBlock;
     bool haveThread;
 
+    /* Set for calls submitted with virNetClientSendAsync */
+    virNetClientReplyFunc replyCb;
+    void *replyOpaque;
+    bool failed;
+
+    /* Set for the calls virNetClientWaitAsync uses to drive I/O */
+    bool drain;
+
     virCond cond;
 
     virNetClientCallPtr next;
@@ -97,6 +105,11 @@ struct _virNetClient {
     /* True if a thread holds the buck */
     bool haveTheBuck;
 
+    /* Number of async calls still waiting for a reply */
+    size_t nasync;
+    /* Async calls whose reply callback has yet to be run */
+    virNetClientCallPtr asyncDone;
+
     size_t nstreams;
     virNetClientStreamPtr *streams;
 
@@ -242,6 +255,67 @@ static bool virNetClientCallMatchPredicate(virNetClientCallPtr head,
 }
 
 
+/* Move an async call, already unlinked from the dispatch queue,
+ * onto the list of calls whose reply callback is pending */
+static void virNetClientCallFinishAsync(virNetClientPtr client,
+                                        virNetClientCallPtr call,
+                                        bool failed)
+{
+    VIR_DEBUG("Finished async call %p failed=%d", call, failed);
+    call->failed = failed;
+    call->haveThread = false;
+    virNetClientCallQueue(&client->asyncDone, call);
+    client->nasync--;
+}
+
+
+/*
+ * Run the reply callbacks of all finished async calls. The client
+ * lock is released while they run, so that a callback is free to
+ * issue further calls on the same client. The error state of the
+ * calling thread is preserved across the callbacks.
+ */
+static void virNetClientDispatchAsync(virNetClientPtr client)
+{
+    virNetClientCallPtr calls = client->asyncDone;
+    virErrorPtr saved;
+
+    if (!calls)
+        return;
+    client->asyncDone = NULL;
+
+    saved = virSaveLastError();
+    virObjectRef(client);
+    virObjectUnlock(client);
+
+    while (calls) {
+        virNetClientCallPtr call = calls;
+        calls = call->next;
+        call->next = NULL;
+
+        virResetLastError();
+        if (call->failed)
+            virReportError(VIR_ERR_RPC, "%s",
+                           _("connection closed before the reply was received"));
+
+        call->replyCb(client, call->failed ? -1 : 0,
+                      call->msg, call->replyOpaque);
+
+        ignore_value(virCondDestroy(&call->cond));
+        virNetMessageFree(call->msg);
+        VIR_FREE(call);
+    }
+
+    if (saved) {
+        virSetError(saved);
+        virFreeError(saved);
+    }
+
+    virObjectLock(client);
+    virObjectUnref(client);
+}
+
+
 bool
 virNetClientKeepAliveIsSupported(virNetClientPtr client)
 {
@@ -636,6 +710,20 @@ virNetClientMarkClose(virNetClientPtr client,
 }
 
 
+static bool
+virNetClientCloseFailAsync(virNetClientCallPtr call,
+                           void *opaque)
+{
+    virNetClientPtr client = opaque;
+
+    if (!call->replyCb || call->haveThread)
+        return false;
+
+    virNetClientCallFinishAsync(client, call, true);
+    return true;
+}
+
+
 static void
 virNetClientCloseLocked(virNetClientPtr client)
 {
@@ -646,6 +734,11 @@ virNetClientCloseLocked(virNetClientPtr client)
     if (!client->sock)
         return;
 
+    /* No reply can arrive any more for pending async calls */
+    virNetClientCallRemovePredicate(&client->waitDispatch,
+                                    virNetClientCloseFailAsync,
+                                    client);
+
     virObjectUnref(client->sock);
     client->sock = NULL;
 #if WITH_GNUTLS
@@ -710,6 +803,7 @@ static void virNetClientCloseInternal(virNetClientPtr client,
         virNetClientIOEventLoopPassTheBuck(client, NULL);
     }
 
+    virNetClientDispatchAsync(client);
     virObjectUnlock(client);
 }
 
@@ -741,6 +835,7 @@ int virNetClientSetTLSSession(virNetClientPtr client,
     int len;
     struct pollfd fds[1];
     sigset_t oldmask, blockedsigs;
+    char *cacheKey = NULL;
 
     sigemptyset(&blockedsigs);
 # ifdef SIGWINCH
@@ -757,6 +852,16 @@ int virNetClientSetTLSSession(virNetClientPtr client,
                                             client->hostname)))
         goto error;
 
+    /* Resuming the previous session with the same server skips
+     * the key exchange, which makes up most of the handshake */
+    if (virAsprintf(&cacheKey, "%s;%s", NULLSTR(client->hostname),
+                    NULLSTR(virNetSocketRemoteAddrString(client->sock))) < 0) {
+        virReportOOMError();
+        goto error;
+    }
+    if (virNetTLSSessionResume(client->tls, cacheKey) < 0)
+        goto error;
+
     virNetSocketSetTLSSession(client->sock, client->tls);
 
     for (;;) {
@@ -826,10 +931,16 @@ int virNetClientSetTLSSession(virNetClientPtr client,
         goto error;
     }
 
+    VIR_DEBUG("TLS session with %s resumed: %d", cacheKey,
+              virNetTLSSessionIsResumed(client->tls));
+    virNetTLSSessionSave(client->tls);
+
+    VIR_FREE(cacheKey);
     virObjectUnlock(client);
     return 0;
 
 error:
+    VIR_FREE(cacheKey);
     virObjectUnref(client->tls);
     client->tls = NULL;
     virObjectUnlock(client);
@@ -980,15 +1091,15 @@ virNetClientCallDispatchReply(virNetClientPtr client)
         return -1;
     }
 
-    if (VIR_REALLOC_N(thecall->msg->buffer, client->msg.bufferLength) < 0) {
-        virReportOOMError();
-        return -1;
-    }
-
-    memcpy(thecall->msg->buffer, client->msg.buffer, client->msg.bufferLength);
-    memcpy(&thecall->msg->header, &client->msg.header, sizeof(client->msg.header));
+    /* Hand the reply buffer over rather than copying it */
+    virNetMessageReleaseBuffer(thecall->msg);
+    thecall->msg->buffer = client->msg.buffer;
+    thecall->msg->bufferAlloc = client->msg.bufferAlloc;
     thecall->msg->bufferLength = client->msg.bufferLength;
     thecall->msg->bufferOffset = client->msg.bufferOffset;
+    client->msg.buffer = NULL;
+    client->msg.bufferAlloc = 0;
+    memcpy(&thecall->msg->header, &client->msg.header, sizeof(client->msg.header));
 
     thecall->msg->nfds = client->msg.nfds;
     thecall->msg->fds = client->msg.fds;
@@ -1144,6 +1255,17 @@ virNetClientCallDispatch(virNetClientPtr client)
     case VIR_NET_STREAM: /* Stream protocol */
         return virNetClientCallDispatchStream(client);
 
+    case VIR_NET_STREAM_ENCODED: /* Stream protocol, encoded data */
+        if (client->msg.header.status != VIR_NET_CONTINUE) {
+            virReportError(VIR_ERR_RPC,
+                           _("got unexpected encoded stream status %d"),
+                           client->msg.header.status);
+            return -1;
+        }
+        if (virNetMessageDecodeStreamData(&client->msg) < 0)
+            return -1;
+        return virNetClientCallDispatchStream(client);
+
     default:
         virReportError(VIR_ERR_RPC,
                        _("got unexpected RPC call prog %d vers %d proc %d type %d"),
@@ -1158,19 +1280,19 @@ static ssize_t
 virNetClientIOWriteMessage(virNetClientPtr client,
                            virNetClientCallPtr thecall)
 {
+    struct iovec iov[VIR_NET_MESSAGE_NIOV];
+    int niov;
     ssize_t ret = 0;
 
-    if (thecall->msg->bufferOffset < thecall->msg->bufferLength) {
-        ret = virNetSocketWrite(client->sock,
-                                thecall->msg->buffer + thecall->msg->bufferOffset,
-                                thecall->msg->bufferLength - thecall->msg->bufferOffset);
+    if ((niov = virNetMessageGetIOV(thecall->msg, iov))) {
+        ret = virNetSocketWritev(client->sock, iov, niov);
         if (ret <= 0)
             return ret;
 
-        thecall->msg->bufferOffset += ret;
+        virNetMessageAdvance(thecall->msg, ret);
     }
 
-    if (thecall->msg->bufferOffset == thecall->msg->bufferLength) {
+    if (virNetMessageIsSent(thecall->msg)) {
         size_t i;
         for (i = thecall->msg->donefds ; i < thecall->msg->nfds ; i++) {
             int rv;
@@ -1181,8 +1303,7 @@ virNetClientIOWriteMessage(virNetClientPtr client,
             thecall->msg->donefds++;
         }
         thecall->msg->donefds = 0;
-        thecall->msg->bufferOffset = thecall->msg->bufferLength = 0;
-        VIR_FREE(thecall->msg->buffer);
+        virNetMessageReleaseBuffer(thecall->msg);
         if (thecall->expectReply)
             thecall->mode = VIR_NET_CLIENT_MODE_WAIT_RX;
         else
@@ -1230,11 +1351,10 @@ virNetClientIOReadMessage(virNetClientPtr client)
 
     /* Start by reading length word */
     if (client->msg.bufferLength == 0) {
-        client->msg.bufferLength = 4;
-        if (VIR_ALLOC_N(client->msg.buffer, client->msg.bufferLength) < 0) {
-            virReportOOMError();
+        if (virNetMessageReserveBuffer(&client->msg,
+                                       VIR_NET_MESSAGE_LEN_MAX) < 0)
             return -ENOMEM;
-        }
+        client->msg.bufferLength = VIR_NET_MESSAGE_LEN_MAX;
     }
 
     wantData = client->msg.bufferLength - client->msg.bufferOffset;
@@ -1354,17 +1474,29 @@ static bool virNetClientIOEventLoopPollEvents(virNetClientCallPtr call,
 }
 
 
+struct virNetClientIOEventData {
+    virNetClientPtr client;
+    virNetClientCallPtr thiscall;
+};
+
 static bool virNetClientIOEventLoopRemoveDone(virNetClientCallPtr call,
                                               void *opaque)
 {
-    virNetClientCallPtr thiscall = opaque;
+    struct virNetClientIOEventData *data = opaque;
 
-    if (call == thiscall)
+    if (call == data->thiscall)
         return false;
 
     if (call->mode != VIR_NET_CLIENT_MODE_COMPLETE)
         return false;
 
+    /* Async calls have nobody waiting for them; their reply
+     * callback runs once the client lock is released */
+    if (call->replyCb && !call->haveThread) {
+        virNetClientCallFinishAsync(data->client, call, false);
+        return true;
+    }
+
     /*
      * ...if the call being removed from the list
      * still has a thread, then wake that thread up,
@@ -1391,6 +1523,41 @@ static bool virNetClientIOEventLoopRemoveDone(virNetClientCallPtr call,
 }
 
 
+static bool virNetClientIOEventLoopCompleteDrain(virNetClientCallPtr call,
+                                                 void *opaque ATTRIBUTE_UNUSED)
+{
+    if (call->drain)
+        call->mode = VIR_NET_CLIENT_MODE_COMPLETE;
+
+    return false;
+}
+
+
+/*
+ * Remove completed calls from the dispatch queue, waking up their
+ * threads. Once the last async call got its reply, threads waiting
+ * in virNetClientWaitAsync are done too.
+ */
+static void virNetClientIOEventLoopRemoveAllDone(virNetClientPtr client,
+                                                 virNetClientCallPtr thiscall)
+{
+    struct virNetClientIOEventData data = { client, thiscall };
+
+    virNetClientCallRemovePredicate(&client->waitDispatch,
+                                    virNetClientIOEventLoopRemoveDone,
+                                    &data);
+
+    if (client->nasync == 0) {
+        virNetClientCallMatchPredicate(client->waitDispatch,
+                                       virNetClientIOEventLoopCompleteDrain,
+                                       NULL);
+        virNetClientCallRemovePredicate(&client->waitDispatch,
+                                        virNetClientIOEventLoopRemoveDone,
+                                        &data);
+    }
+}
+
+
 static void
 virNetClientIODetachNonBlocking(virNetClientCallPtr call)
 {
@@ -1467,6 +1634,13 @@ static int virNetClientIOEventLoop(virNetClientPtr client,
         int timeout = -1;
         virNetMessagePtr msg = NULL;
 
+        /* Draining is over once no async call is left waiting */
+        if (thiscall->drain && client->nasync == 0) {
+            virNetClientCallRemove(&client->waitDispatch, thiscall);
+            virNetClientIOEventLoopPassTheBuck(client, thiscall);
+            return 0;
+        }
+
         /* If we have existing SASL decoded data we don't want to sleep in
          * the poll(), just check if any other FDs are also ready.
          * If the connection is going to be closed, we don't want to sleep in
@@ -1572,7 +1746,10 @@ static int virNetClientIOEventLoop(virNetClientPtr client,
 
         if (fds[0].revents & POLLIN) {
             if (virNetClientIOHandleInput(client) < 0) {
-                virNetClientMarkClose(client, VIR_CONNECT_CLOSE_REASON_ERROR);
+                virNetClientMarkClose(client,
+                                      fds[0].revents & POLLHUP ?
+                                      VIR_CONNECT_CLOSE_REASON_EOF :
+                                      VIR_CONNECT_CLOSE_REASON_ERROR);
                 goto error;
             }
         }
@@ -1580,9 +1757,7 @@ static int virNetClientIOEventLoop(virNetClientPtr client,
         /* Iterate through waiting calls and if any are
          * complete, remove them from the dispatch list.
          */
-        virNetClientCallRemovePredicate(&client->waitDispatch,
-                                        virNetClientIOEventLoopRemoveDone,
-                                        thiscall);
+        virNetClientIOEventLoopRemoveAllDone(client, thiscall);
 
         /* Now see if *we* are done */
         if (thiscall->mode == VIR_NET_CLIENT_MODE_COMPLETE) {
@@ -1598,7 +1773,10 @@ static int virNetClientIOEventLoop(virNetClientPtr client,
             return 1;
         }
 
-        if (fds[0].revents & (POLLHUP | POLLERR)) {
+        /* Replies the server sent before hanging up are still
+         * readable, so only give up once they have all been read */
+        if (fds[0].revents & (POLLHUP | POLLERR) &&
+            !(fds[0].revents & POLLIN)) {
             virNetClientMarkClose(client, VIR_CONNECT_CLOSE_REASON_EOF);
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("received hangup / error event on socket"));
@@ -1848,14 +2026,13 @@ void virNetClientIncomingEvent(virNetSocketPtr sock,
     }
 
     /* Remove completed calls or signal their threads. */
-    virNetClientCallRemovePredicate(&client->waitDispatch,
-                                    virNetClientIOEventLoopRemoveDone,
-                                    NULL);
+    virNetClientIOEventLoopRemoveAllDone(client, NULL);
     virNetClientIOUpdateCallback(client, true);
 
 done:
     if (client->wantClose)
         virNetClientCloseLocked(client);
+    virNetClientDispatchAsync(client);
     virObjectUnlock(client);
 }
 
@@ -1994,6 +2171,7 @@ int virNetClientSendWithReply(virNetClientPtr client,
     int ret;
     virObjectLock(client);
     ret = virNetClientSendInternal(client, msg, true, false);
+    virNetClientDispatchAsync(client);
     virObjectUnlock(client);
     if (ret < 0)
         return -1;
@@ -2017,6 +2195,7 @@ int virNetClientSendNoReply(virNetClientPtr client,
     int ret;
     virObjectLock(client);
     ret = virNetClientSendInternal(client, msg, false, false);
+    virNetClientDispatchAsync(client);
     virObjectUnlock(client);
     if (ret < 0)
         return -1;
@@ -2040,6 +2219,7 @@ int virNetClientSendNonBlock(virNetClientPtr client,
     int ret;
     virObjectLock(client);
     ret = virNetClientSendInternal(client, msg, false, true);
+    virNetClientDispatchAsync(client);
     virObjectUnlock(client);
     return ret;
 }
@@ -2070,8 +2250,148 @@ int virNetClientSendWithReplyStream(virNetClientPtr client,
     }
 
     ret = virNetClientSendInternal(client, msg, true, false);
+    virNetClientDispatchAsync(client);
     virObjectUnlock(client);
     if (ret < 0)
         return -1;
     return 0;
 }
+
+
+/*
+ * @msg: a message allocated on the heap
+ * @cb: callback to invoke when the reply arrives
+ * @opaque: data to pass to @cb
+ *
+ * Send a message and return without waiting for the reply, so
+ * that many calls can be in flight on the client at once. The
+ * reply is matched by serial and handed to @cb, together with
+ * @msg, by whichever thread happens to be processing I/O on the
+ * client at that time: a thread making a synchronous call, the
+ * event loop if async I/O is registered, or a thread blocked in
+ * virNetClientWaitAsync. @cb may also be invoked before this
+ * method returns. It is called with the client unlocked, with
+ * a status of 0 if a reply was received, or -1 with an error
+ * reported if the connection was closed first. @msg is freed
+ * once @cb returns.
+ *
+ * Returns 0 if the message was queued, in which case @cb is
+ * guaranteed to be called exactly once and the client owns @msg;
+ * -1 on failure, in which case @cb is never called and the caller
+ * keeps ownership of @msg.
+ */
+int virNetClientSendAsync(virNetClientPtr client,
+                          virNetMessagePtr msg,
+                          virNetClientReplyFunc cb,
+                          void *opaque)
+{
+    virNetClientCallPtr call;
+    int ret = -1;
+
+    PROBE(RPC_CLIENT_MSG_TX_QUEUE,
+          "client=%p len=%zu prog=%u vers=%u proc=%u type=%u status=%u serial=%u",
+          client, msg->bufferLength,
+          msg->header.prog, msg->header.vers, msg->header.proc,
+          msg->header.type, msg->header.status, msg->header.serial);
+
+    virObjectLock(client);
+
+    if (!client->sock || client->wantClose) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("client socket is closed"));
+        goto cleanup;
+    }
+
+    if (!(call = virNetClientCallNew(msg, true, false)))
+        goto cleanup;
+
+    /* The call expects a reply, but nobody will wait for it */
+    call->nonBlock = true;
+    call->haveThread = true;
+    call->replyCb = cb;
+    call->replyOpaque = opaque;
+    client->nasync++;
+
+    switch (virNetClientIO(client, call)) {
+    case 1:
+        /* Left in the queue, the reply will be dispatched later */
+        ret = 0;
+        break;
+
+    case 0:
+        virNetClientCallFinishAsync(client, call, false);
+        ret = 0;
+        break;
+
+    default:
+        client->nasync--;
+        ignore_value(virCondDestroy(&call->cond));
+        VIR_FREE(call);
+        break;
+    }
+
+cleanup:
+    virNetClientDispatchAsync(client);
+    virObjectUnlock(client);
+    return ret;
+}
+
+
+/*
+ * Process I/O on the client until all the calls previously
+ * submitted with virNetClientSendAsync have had their reply
+ * callback invoked. This is needed when no event loop is
+ * driving the client.
+ *
+ * Returns 0 on success, -1 if the connection failed
+ */
+int virNetClientWaitAsync(virNetClientPtr client)
+{
+    int ret = 0;
+
+    virObjectLock(client);
+
+    while (client->nasync > 0) {
+        virNetMessagePtr msg;
+        virNetClientCallPtr call;
+        int rv;
+
+        if (!client->sock || client->wantClose) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("client socket is closed"));
+            ret = -1;
+            break;
+        }
+
+        /* An empty message waiting for input that never matches
+         * a reply; it completes once the last async call did */
+        if (VIR_ALLOC(msg) < 0) {
+            virReportOOMError();
+            ret = -1;
+            break;
+        }
+
+        if (!(call = virNetClientCallNew(msg, false, false))) {
+            VIR_FREE(msg);
+            ret = -1;
+            break;
+        }
+        call->drain = true;
+        call->haveThread = true;
+
+        rv = virNetClientIO(client, call);
+
+        ignore_value(virCondDestroy(&call->cond));
+        VIR_FREE(call);
+        VIR_FREE(msg);
+
+        if (rv < 0) {
+            ret = -1;
+            break;
+        }
+    }
+
+    virNetClientDispatchAsync(client);
+    virObjectUnlock(client);
+    return ret;
+}
@@ -104,6 +104,18 @@ int virNetClientSendWithReplyStream(virNetClientPtr client,
                                     virNetMessagePtr msg,
                                     virNetClientStreamPtr st);
 
+typedef void (*virNetClientReplyFunc)(virNetClientPtr client,
+                                      int status,
+                                      virNetMessagePtr msg,
+                                      void *opaque);
+
+int virNetClientSendAsync(virNetClientPtr client,
+                          virNetMessagePtr msg,
+                          virNetClientReplyFunc cb,
+                          void *opaque);
+
+int virNetClientWaitAsync(virNetClientPtr client);
+
 # ifdef WITH_SASL
 void virNetClientSetSASLSession(virNetClientPtr client,
                                 virNetSASLSessionPtr sasl);
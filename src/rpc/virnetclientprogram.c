@@ -268,6 +268,40 @@ cleanup:
 }
 
 
+/*
+ * Validate that @msg is the reply to the call @proc with @serial
+ */
+static int virNetClientProgramCheckReply(virNetMessagePtr msg,
+                                         unsigned serial,
+                                         int proc)
+{
+    /* None of these 3 should ever happen here, because
+     * virNetClientSend should have validated the reply,
+     * but it doesn't hurt to check again.
+     */
+    if (msg->header.type != VIR_NET_REPLY &&
+        msg->header.type != VIR_NET_REPLY_WITH_FDS) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected message type %d"), msg->header.type);
+        return -1;
+    }
+    if (msg->header.proc != proc) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected message proc %d != %d"),
+                       msg->header.proc, proc);
+        return -1;
+    }
+    if (msg->header.serial != serial) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected message serial %d != %d"),
+                       msg->header.serial, serial);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 int virNetClientProgramCall(virNetClientProgramPtr prog,
                             virNetClientPtr client,
                             unsigned serial,
@@ -331,28 +365,8 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
     if (virNetClientSendWithReply(client, msg) < 0)
         goto error;
 
-    /* None of these 3 should ever happen here, because
-     * virNetClientSend should have validated the reply,
-     * but it doesn't hurt to check again.
-     */
-    if (msg->header.type != VIR_NET_REPLY &&
-        msg->header.type != VIR_NET_REPLY_WITH_FDS) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Unexpected message type %d"), msg->header.type);
-        goto error;
-    }
-    if (msg->header.proc != proc) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Unexpected message proc %d != %d"),
-                       msg->header.proc, proc);
-        goto error;
-    }
-    if (msg->header.serial != serial) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Unexpected message serial %d != %d"),
-                       msg->header.serial, serial);
+    if (virNetClientProgramCheckReply(msg, serial, proc) < 0)
         goto error;
-    }
 
     switch (msg->header.status) {
     case VIR_NET_OK:
@@ -406,3 +420,118 @@ error:
     }
     return -1;
 }
+
+
+struct virNetClientProgramAsyncData {
+    virNetClientProgramPtr prog;
+    unsigned serial;
+    int proc;
+    xdrproc_t ret_filter;
+    void *ret;
+    virNetClientProgramReplyFunc cb;
+    void *opaque;
+};
+
+
+static void virNetClientProgramCallDone(virNetClientPtr client ATTRIBUTE_UNUSED,
+                                        int status,
+                                        virNetMessagePtr msg,
+                                        void *opaque)
+{
+    struct virNetClientProgramAsyncData *data = opaque;
+    int rv = -1;
+
+    if (status < 0)
+        goto done;
+
+    if (virNetClientProgramCheckReply(msg, data->serial, data->proc) < 0)
+        goto done;
+
+    switch (msg->header.status) {
+    case VIR_NET_OK:
+        if (virNetMessageDecodePayload(msg, data->ret_filter, data->ret) < 0)
+            goto done;
+        rv = 0;
+        break;
+
+    case VIR_NET_ERROR:
+        virNetClientProgramDispatchError(data->prog, msg);
+        break;
+
+    default:
+        virReportError(VIR_ERR_RPC,
+                       _("Unexpected message status %d"), msg->header.status);
+        break;
+    }
+
+done:
+    data->cb(data->prog, rv, data->opaque);
+    virObjectUnref(data->prog);
+    VIR_FREE(data);
+}
+
+
+/*
+ * Like virNetClientProgramCall, but returns as soon as the call
+ * has been queued. @ret must stay valid until @cb has been invoked
+ * with the outcome of the call: 0 if @ret was filled in, or -1 with
+ * an error reported. @cb runs in whichever thread processes the
+ * reply, see virNetClientSendAsync.
+ *
+ * Returns 0 if the call was queued, -1 if it failed, in which
+ * case @cb is never invoked.
+ */
+int virNetClientProgramCallAsync(virNetClientProgramPtr prog,
+                                 virNetClientPtr client,
+                                 unsigned serial,
+                                 int proc,
+                                 xdrproc_t args_filter, void *args,
+                                 xdrproc_t ret_filter, void *ret,
+                                 virNetClientProgramReplyFunc cb,
+                                 void *opaque)
+{
+    virNetMessagePtr msg;
+    struct virNetClientProgramAsyncData *data = NULL;
+
+    if (!(msg = virNetMessageNew(false)))
+        return -1;
+
+    msg->header.prog = prog->program;
+    msg->header.vers = prog->version;
+    msg->header.status = VIR_NET_OK;
+    msg->header.type = VIR_NET_CALL;
+    msg->header.serial = serial;
+    msg->header.proc = proc;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto error;
+
+    if (virNetMessageEncodePayload(msg, args_filter, args) < 0)
+        goto error;
+
+    if (VIR_ALLOC(data) < 0) {
+        virReportOOMError();
+        goto error;
+    }
+
+    data->prog = virObjectRef(prog);
+    data->serial = serial;
+    data->proc = proc;
+    data->ret_filter = ret_filter;
+    data->ret = ret;
+    data->cb = cb;
+    data->opaque = opaque;
+
+    if (virNetClientSendAsync(client, msg,
+                              virNetClientProgramCallDone, data) < 0) {
+        virObjectUnref(data->prog);
+        goto error;
+    }
+
+    return 0;
+
+error:
+    VIR_FREE(data);
+    virNetMessageFree(msg);
+    return -1;
+}
@@ -40,6 +40,11 @@ struct _virNetClientStream {
 
     virError err;
 
+    /* Set once the encoding of stream data was negotiated,
+     * @codec is NULL if data is sent raw */
+    bool encodingSet;
+    virNetMessageStreamCodecPtr codec;
+
     /* XXX this buffer is unbounded if the client
      * app has domain events registered, since packets
      * may be read off wire, while app isn't ready to
@@ -160,6 +165,7 @@ void virNetClientStreamDispose(void *obj)
 
     virResetError(&st->err);
     VIR_FREE(st->incoming);
+    virNetMessageStreamCodecFree(st->codec);
     virObjectUnref(st->prog);
 }
 
@@ -300,6 +306,89 @@ cleanup:
 }
 
 
+bool virNetClientStreamHasEncoding(virNetClientStreamPtr st)
+{
+    bool ret;
+    virObjectLock(st);
+    ret = st->encodingSet;
+    virObjectUnlock(st);
+    return ret;
+}
+
+
+/*
+ * Ask the server to send the stream data with @encoding, and encode
+ * the data we send the same way. VIR_NET_STREAM_ENCODING_RAW just
+ * records that no encoding is to be used. The encoding can only be
+ * set once.
+ */
+int virNetClientStreamSetEncoding(virNetClientStreamPtr st,
+                                  virNetClientPtr client,
+                                  int encoding,
+                                  int level)
+{
+    virNetMessagePtr msg = NULL;
+    virNetMessageStreamCodecPtr codec = NULL;
+    virNetStreamEncodingRequest req;
+    int ret = -1;
+
+    VIR_DEBUG("st=%p encoding=%d level=%d", st, encoding, level);
+
+    virObjectLock(st);
+    if (st->encodingSet) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Stream encoding is already set"));
+        goto cleanup;
+    }
+
+    if (encoding == VIR_NET_STREAM_ENCODING_RAW) {
+        st->encodingSet = true;
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (!(codec = virNetMessageStreamCodecNew(encoding, level)))
+        goto cleanup;
+
+    if (!(msg = virNetMessageNew(false)))
+        goto cleanup;
+
+    msg->header.prog = virNetClientProgramGetProgram(st->prog);
+    msg->header.vers = virNetClientProgramGetVersion(st->prog);
+    msg->header.status = VIR_NET_OK;
+    msg->header.type = VIR_NET_STREAM_ENCODED;
+    msg->header.serial = st->serial;
+    msg->header.proc = st->proc;
+
+    memset(&req, 0, sizeof(req));
+    req.encoding = encoding;
+    req.level = level;
+
+    if (virNetMessageEncodeHeader(msg) < 0 ||
+        virNetMessageEncodePayload(msg,
+                                   (xdrproc_t)xdr_virNetStreamEncodingRequest,
+                                   &req) < 0)
+        goto cleanup;
+
+    /* Like data packets, the request doesn't get any reply */
+    virObjectUnlock(st);
+    ret = virNetClientSendNoReply(client, msg);
+    virObjectLock(st);
+    if (ret < 0)
+        goto cleanup;
+
+    st->codec = codec;
+    st->encodingSet = true;
+    codec = NULL;
+
+cleanup:
+    virObjectUnlock(st);
+    virNetMessageFree(msg);
+    virNetMessageStreamCodecFree(codec);
+    return ret;
+}
+
+
 int virNetClientStreamSendPacket(virNetClientStreamPtr st,
                                  virNetClientPtr client,
                                  int status,
@@ -307,6 +396,7 @@ int virNetClientStreamSendPacket(virNetClientStreamPtr st,
                                  size_t nbytes)
 {
     virNetMessagePtr msg;
+    virNetMessageStreamCodecPtr codec;
     VIR_DEBUG("st=%p status=%d data=%p nbytes=%zu", st, status, data, nbytes);
 
     if (!(msg = virNetMessageNew(false)))
@@ -320,23 +410,24 @@ int virNetClientStreamSendPacket(virNetClientStreamPtr st,
     msg->header.type = VIR_NET_STREAM;
     msg->header.serial = st->serial;
     msg->header.proc = st->proc;
+    codec = st->codec;
 
     virObjectUnlock(st);
 
-    if (virNetMessageEncodeHeader(msg) < 0)
-        goto error;
-
     /* Data packets are async fire&forget, but OK/ERROR packets
      * need a synchronous confirmation
      */
     if (status == VIR_NET_CONTINUE) {
-        if (virNetMessageEncodePayloadRaw(msg, data, nbytes) < 0)
+        /* The codec is only used by the thread sending on the
+         * stream, so it needs no locking */
+        if (virNetMessageEncodeStreamData(msg, codec, data, nbytes) < 0)
             goto error;
 
         if (virNetClientSendNoReply(client, msg) < 0)
             goto error;
     } else {
-        if (virNetMessageEncodePayloadRaw(msg, NULL, 0) < 0)
+        if (virNetMessageEncodeHeader(msg) < 0 ||
+            virNetMessageEncodePayloadRaw(msg, NULL, 0) < 0)
             goto error;
 
         if (virNetClientSendWithReply(client, msg) < 0)
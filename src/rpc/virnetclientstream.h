@@ -47,6 +47,13 @@ bool virNetClientStreamMatches(virNetClientStreamPtr st,
 int virNetClientStreamQueuePacket(virNetClientStreamPtr st,
                                   virNetMessagePtr msg);
 
+bool virNetClientStreamHasEncoding(virNetClientStreamPtr st);
+
+int virNetClientStreamSetEncoding(virNetClientStreamPtr st,
+                                  virNetClientPtr client,
+                                  int encoding,
+                                  int level);
+
 int virNetClientStreamSendPacket(virNetClientStreamPtr st,
                                  virNetClientPtr client,
                                  int status,
@@ -22,6 +22,9 @@
 
 #include <stdlib.h>
 #include <unistd.h>
+#if WITH_ZLIB
+# include <zlib.h>
+#endif
 
 #include "virnetmessage.h"
 #include "viralloc.h"
@@ -29,13 +32,121 @@
 #include "virlog.h"
 #include "virfile.h"
 #include "virutil.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
+/*
+ * Message buffers are recycled rather than freed, so that busy
+ * connections don't keep allocating and releasing them. There is
+ * one free list for each size class: most messages fit in a
+ * VIR_NET_MESSAGE_INITIAL buffer, only big replies and stream data
+ * need the maximum message size. The free buffers are chained
+ * through their first bytes.
+ */
+typedef struct _virNetMessageBufferPool virNetMessageBufferPool;
+typedef virNetMessageBufferPool *virNetMessageBufferPoolPtr;
+struct _virNetMessageBufferPool {
+    size_t size;
+    size_t nfree_max;
+    size_t nfree;
+    char *head;
+};
+
+static virMutex virNetMessageBufferLock;
+static virNetMessageBufferPool virNetMessageBufferPools[] = {
+    { VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX, 64, 0, NULL },
+    { VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX, 4, 0, NULL },
+};
+
+static int virNetMessageOnceInit(void)
+{
+    if (virMutexInit(&virNetMessageBufferLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize mutex"));
+        return -1;
+    }
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virNetMessage)
+
+
+/*
+ * Get a buffer of at least @len bytes, setting @alloc to its
+ * actual size
+ */
+static char *
+virNetMessageBufferGet(size_t len, size_t *alloc)
+{
+    virNetMessageBufferPoolPtr pool = NULL;
+    char *buf = NULL;
+    size_t i;
+
+    for (i = 0 ; i < ARRAY_CARDINALITY(virNetMessageBufferPools) ; i++) {
+        if (len <= virNetMessageBufferPools[i].size) {
+            pool = &virNetMessageBufferPools[i];
+            break;
+        }
+    }
+
+    if (pool) {
+        virMutexLock(&virNetMessageBufferLock);
+        if ((buf = pool->head)) {
+            memcpy(&pool->head, buf, sizeof(pool->head));
+            pool->nfree--;
+        }
+        virMutexUnlock(&virNetMessageBufferLock);
+        len = pool->size;
+    }
+
+    if (!buf && VIR_ALLOC_N(buf, len) < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+
+    *alloc = len;
+    return buf;
+}
+
+
+static void
+virNetMessageBufferPut(char *buf, size_t alloc)
+{
+    size_t i;
+
+    if (!buf)
+        return;
+
+    for (i = 0 ; i < ARRAY_CARDINALITY(virNetMessageBufferPools) ; i++) {
+        virNetMessageBufferPoolPtr pool = &virNetMessageBufferPools[i];
+
+        if (alloc != pool->size)
+            continue;
+
+        virMutexLock(&virNetMessageBufferLock);
+        if (pool->nfree < pool->nfree_max) {
+            memcpy(buf, &pool->head, sizeof(pool->head));
+            pool->head = buf;
+            pool->nfree++;
+            buf = NULL;
+        }
+        virMutexUnlock(&virNetMessageBufferLock);
+        break;
+    }
+
+    VIR_FREE(buf);
+}
+
+
 virNetMessagePtr virNetMessageNew(bool tracked)
 {
     virNetMessagePtr msg;
 
+    if (virNetMessageInitialize() < 0)
+        return NULL;
+
     if (VIR_ALLOC(msg) < 0) {
         virReportOOMError();
         return NULL;
@@ -58,7 +169,9 @@ void virNetMessageClear(virNetMessagePtr msg)
     for (i = 0 ; i < msg->nfds ; i++)
         VIR_FORCE_CLOSE(msg->fds[i]);
     VIR_FREE(msg->fds);
-    VIR_FREE(msg->buffer);
+    if (msg->spliceLength)
+        VIR_FORCE_CLOSE(msg->spliceFd);
+    virNetMessageReleaseBuffer(msg);
     memset(msg, 0, sizeof(*msg));
     msg->tracked = tracked;
 }
@@ -77,11 +190,139 @@ void virNetMessageFree(virNetMessagePtr msg)
 
     for (i = 0 ; i < msg->nfds ; i++)
         VIR_FORCE_CLOSE(msg->fds[i]);
-    VIR_FREE(msg->buffer);
+    if (msg->spliceLength)
+        VIR_FORCE_CLOSE(msg->spliceFd);
+    virNetMessageReleaseBuffer(msg);
     VIR_FREE(msg->fds);
     VIR_FREE(msg);
 }
 
+
+/**
+ * virNetMessageReserveBuffer:
+ * @msg: the message
+ * @len: number of bytes needed
+ *
+ * Make sure msg->buffer has room for at least @len bytes, keeping
+ * the first msg->bufferOffset bytes of its content. The lengths
+ * and offsets of @msg are not changed.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int virNetMessageReserveBuffer(virNetMessagePtr msg, size_t len)
+{
+    char *buf;
+    size_t alloc;
+
+    if (msg->buffer && msg->bufferAlloc >= len)
+        return 0;
+
+    if (virNetMessageInitialize() < 0)
+        return -1;
+
+    if (!(buf = virNetMessageBufferGet(len, &alloc)))
+        return -1;
+
+    if (msg->buffer) {
+        memcpy(buf, msg->buffer, msg->bufferOffset);
+        virNetMessageBufferPut(msg->buffer, msg->bufferAlloc);
+    }
+
+    msg->buffer = buf;
+    msg->bufferAlloc = alloc;
+    return 0;
+}
+
+
+/**
+ * virNetMessageReservePayload:
+ * @msg: the message
+ * @len: number of bytes needed
+ *
+ * Get a buffer of @len bytes which will be sent after the header
+ * of @msg without being copied, if it is filled in and then passed
+ * to virNetMessageEncodePayloadRaw.
+ *
+ * Returns the buffer, owned by @msg, or NULL on error
+ */
+char *virNetMessageReservePayload(virNetMessagePtr msg, size_t len)
+{
+    if (msg->payload && msg->payloadAlloc >= len)
+        return msg->payload;
+
+    if (virNetMessageInitialize() < 0)
+        return NULL;
+
+    virNetMessageBufferPut(msg->payload, msg->payloadAlloc);
+    msg->payloadLength = msg->payloadOffset = 0;
+    msg->payload = virNetMessageBufferGet(len, &msg->payloadAlloc);
+    return msg->payload;
+}
+
+
+/*
+ * Give the buffers of @msg back to the pool
+ */
+void virNetMessageReleaseBuffer(virNetMessagePtr msg)
+{
+    virNetMessageBufferPut(msg->buffer, msg->bufferAlloc);
+    msg->buffer = NULL;
+    msg->bufferAlloc = msg->bufferLength = msg->bufferOffset = 0;
+
+    virNetMessageBufferPut(msg->payload, msg->payloadAlloc);
+    msg->payload = NULL;
+    msg->payloadAlloc = msg->payloadLength = msg->payloadOffset = 0;
+}
+
+
+/**
+ * virNetMessageGetIOV:
+ * @msg: the outgoing message
+ * @iov: array of at least VIR_NET_MESSAGE_NIOV entries
+ *
+ * Fill @iov with the parts of @msg that are still to be sent.
+ *
+ * Returns the number of entries filled, 0 if @msg has been sent
+ */
+int virNetMessageGetIOV(virNetMessagePtr msg, struct iovec *iov)
+{
+    int n = 0;
+
+    if (msg->bufferOffset < msg->bufferLength) {
+        iov[n].iov_base = msg->buffer + msg->bufferOffset;
+        iov[n].iov_len = msg->bufferLength - msg->bufferOffset;
+        n++;
+    }
+
+    if (msg->payloadOffset < msg->payloadLength) {
+        iov[n].iov_base = msg->payload + msg->payloadOffset;
+        iov[n].iov_len = msg->payloadLength - msg->payloadOffset;
+        n++;
+    }
+
+    return n;
+}
+
+
+/*
+ * Record that @len more bytes of @msg have been sent
+ */
+void virNetMessageAdvance(virNetMessagePtr msg, size_t len)
+{
+    size_t n = MIN(len, msg->bufferLength - msg->bufferOffset);
+
+    msg->bufferOffset += n;
+    msg->payloadOffset += len - n;
+}
+
+
+bool virNetMessageIsSent(virNetMessagePtr msg)
+{
+    return msg->bufferOffset == msg->bufferLength &&
+        msg->payloadOffset == msg->payloadLength &&
+        msg->spliceOffset == msg->spliceLength;
+}
+
 void virNetMessageQueuePush(virNetMessagePtr *queue, virNetMessagePtr msg)
 {
     virNetMessagePtr tmp = *queue;
@@ -142,11 +383,9 @@ int virNetMessageDecodeLength(virNetMessagePtr msg)
 
     /* Extend our declared buffer length and carry
        on reading the header + payload */
-    msg->bufferLength += len;
-    if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0) {
-        virReportOOMError();
+    if (virNetMessageReserveBuffer(msg, msg->bufferLength + len) < 0)
         goto cleanup;
-    }
+    msg->bufferLength += len;
 
     VIR_DEBUG("Got length, now need %zu total (%u more)",
               msg->bufferLength, len);
@@ -221,12 +460,12 @@ int virNetMessageEncodeHeader(virNetMessagePtr msg)
     int ret = -1;
     unsigned int len = 0;
 
-    msg->bufferLength = VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX;
-    if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0) {
-        virReportOOMError();
-        return ret;
-    }
     msg->bufferOffset = 0;
+    if (virNetMessageReserveBuffer(msg, VIR_NET_MESSAGE_INITIAL +
+                                   VIR_NET_MESSAGE_LEN_MAX) < 0)
+        return ret;
+    msg->bufferLength = MIN(msg->bufferAlloc,
+                            VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX);
 
     /* Format the header. */
     xdrmem_create(&xdr,
@@ -351,9 +590,23 @@ int virNetMessageEncodePayload(virNetMessagePtr msg,
     xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
                   msg->bufferLength - msg->bufferOffset, XDR_ENCODE);
 
-    if (!(*filter)(&xdr, data)) {
-        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message payload"));
-        goto error;
+    while (!(*filter)(&xdr, data)) {
+        /* The payload may just not fit in the initial buffer, so
+         * retry once with the largest one before giving up */
+        if (msg->bufferLength >= VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX) {
+            virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message payload"));
+            goto error;
+        }
+
+        xdr_destroy(&xdr);
+        if (virNetMessageReserveBuffer(msg, VIR_NET_MESSAGE_MAX +
+                                       VIR_NET_MESSAGE_LEN_MAX) < 0)
+            return -1;
+        msg->bufferLength = VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX;
+        VIR_DEBUG("Retrying payload encoding with %zu bytes", msg->bufferLength);
+
+        xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
+                      msg->bufferLength - msg->bufferOffset, XDR_ENCODE);
     }
 
     /* Get the length stored in buffer. */
@@ -408,33 +661,99 @@ error:
 }
 
 
+/*
+ * If @data is the buffer returned by virNetMessageReservePayload
+ * for @msg, it is sent from there rather than copied after the
+ * header.
+ */
 int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
                                   const char *data,
                                   size_t len)
 {
     XDR xdr;
     unsigned int msglen;
+    size_t avail = VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX -
+        msg->bufferOffset;
 
-    if ((msg->bufferLength - msg->bufferOffset) < len) {
+    if (avail < len) {
         virReportError(VIR_ERR_RPC,
                     _("Stream data too long to send (%zu bytes needed, %zu bytes available)"),
-                    len, (msg->bufferLength - msg->bufferOffset));
+                    len, avail);
         return -1;
     }
 
-    memcpy(msg->buffer + msg->bufferOffset, data, len);
-    msg->bufferOffset += len;
+    if (data && data == msg->payload) {
+        msg->payloadLength = len;
+        msg->payloadOffset = 0;
+    } else {
+        if (virNetMessageReserveBuffer(msg, msg->bufferOffset + len) < 0)
+            return -1;
+        memcpy(msg->buffer + msg->bufferOffset, data, len);
+        msg->bufferOffset += len;
+    }
 
     /* Re-encode the length word. */
-    VIR_DEBUG("Encode length as %zu", msg->bufferOffset);
+    msglen = msg->bufferOffset + msg->payloadLength;
+    VIR_DEBUG("Encode length as %u", msglen);
+    xdrmem_create(&xdr, msg->buffer, VIR_NET_MESSAGE_HEADER_XDR_LEN, XDR_ENCODE);
+    if (!xdr_u_int(&xdr, &msglen)) {
+        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message length"));
+        goto error;
+    }
+    xdr_destroy(&xdr);
+
+    msg->bufferLength = msg->bufferOffset;
+    msg->bufferOffset = 0;
+    return 0;
+
+error:
+    xdr_destroy(&xdr);
+    return -1;
+}
+
+
+/**
+ * virNetMessageEncodePayloadSplice:
+ * @msg: the message
+ * @fd: pipe to take the data from
+ * @len: number of bytes to send from @fd
+ *
+ * Encode the length of @msg as if @len bytes of data had been
+ * appended to it, the data being spliced from @fd once the rest of
+ * @msg has been sent. @fd must have at least @len bytes buffered,
+ * and nobody else must read from it meanwhile.
+ *
+ * On success, @msg owns @fd
+ */
+int virNetMessageEncodePayloadSplice(virNetMessagePtr msg,
+                                     int fd,
+                                     size_t len)
+{
+    XDR xdr;
+    unsigned int msglen;
+    size_t avail = VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX -
+        msg->bufferOffset;
+
+    if (avail < len) {
+        virReportError(VIR_ERR_RPC,
+                    _("Stream data too long to send (%zu bytes needed, %zu bytes available)"),
+                    len, avail);
+        return -1;
+    }
+
+    /* Re-encode the length word. */
+    msglen = msg->bufferOffset + len;
+    VIR_DEBUG("Encode length as %u", msglen);
     xdrmem_create(&xdr, msg->buffer, VIR_NET_MESSAGE_HEADER_XDR_LEN, XDR_ENCODE);
-    msglen = msg->bufferOffset;
     if (!xdr_u_int(&xdr, &msglen)) {
         virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message length"));
         goto error;
     }
     xdr_destroy(&xdr);
 
+    msg->spliceFd = fd;
+    msg->spliceLength = len;
+    msg->spliceOffset = 0;
     msg->bufferLength = msg->bufferOffset;
     msg->bufferOffset = 0;
     return 0;
@@ -470,6 +789,299 @@ error:
 }
 
 
+struct _virNetMessageStreamCodec {
+    int encoding;
+    int level;
+#if WITH_ZLIB
+    bool deflating;
+    z_stream zs;
+#endif
+};
+
+
+/*
+ * Returns a bitmask of (1 << virNetStreamEncoding) for each
+ * encoding of stream data this build can both send and receive
+ */
+unsigned int virNetMessageStreamEncodings(void)
+{
+    unsigned int encodings = (1 << VIR_NET_STREAM_ENCODING_HOLE);
+
+#if WITH_ZLIB
+    encodings |= (1 << VIR_NET_STREAM_ENCODING_ZLIB);
+#endif
+
+    return encodings;
+}
+
+
+/**
+ * virNetMessageStreamCodecNew:
+ * @encoding: the virNetStreamEncoding to use for stream data
+ * @level: compression level, -1 for the default
+ *
+ * Create the state used by virNetMessageEncodeStreamData to
+ * encode the data sent on one stream. Whatever the encoding,
+ * chunks only made of zeros are always sent as holes.
+ *
+ * Returns the new codec, or NULL on error
+ */
+virNetMessageStreamCodecPtr
+virNetMessageStreamCodecNew(int encoding, int level)
+{
+    virNetMessageStreamCodecPtr codec;
+
+    if (encoding <= VIR_NET_STREAM_ENCODING_RAW ||
+        encoding > VIR_NET_STREAM_ENCODING_ZLIB ||
+        !(virNetMessageStreamEncodings() & (1 << encoding))) {
+        virReportError(VIR_ERR_RPC,
+                       _("Unsupported stream encoding %d"), encoding);
+        return NULL;
+    }
+
+    if (VIR_ALLOC(codec) < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+
+    codec->encoding = encoding;
+    codec->level = level;
+
+#if WITH_ZLIB
+    if (encoding == VIR_NET_STREAM_ENCODING_ZLIB) {
+        if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION) {
+            virReportError(VIR_ERR_RPC,
+                           _("Invalid stream compression level %d"), level);
+            goto error;
+        }
+
+        if (deflateInit(&codec->zs, level) != Z_OK) {
+            virReportError(VIR_ERR_RPC, "%s",
+                           _("Unable to initialize stream compression"));
+            goto error;
+        }
+        codec->deflating = true;
+    }
+#endif
+
+    return codec;
+
+#if WITH_ZLIB
+error:
+    VIR_FREE(codec);
+    return NULL;
+#endif
+}
+
+
+void virNetMessageStreamCodecFree(virNetMessageStreamCodecPtr codec)
+{
+    if (!codec)
+        return;
+
+#if WITH_ZLIB
+    if (codec->deflating)
+        deflateEnd(&codec->zs);
+#endif
+
+    VIR_FREE(codec);
+}
+
+
+/*
+ * Comparing the data with itself shifted by one byte lets memcmp
+ * do the scan, which is much faster than a loop over the bytes
+ */
+static bool
+virNetMessageStreamDataIsZero(const char *data, size_t len)
+{
+    return len && data[0] == 0 && memcmp(data, data + 1, len - 1) == 0;
+}
+
+
+/**
+ * virNetMessageEncodeStreamData:
+ * @msg: the message, with its header filled in
+ * @codec: the codec of the stream, or NULL
+ * @data: the stream data
+ * @len: length of @data
+ *
+ * Encode the header of @msg followed by @data. If @codec is set
+ * and @data is all zeros, or compresses to less than @len bytes,
+ * @msg becomes a VIR_NET_STREAM_ENCODED packet. Otherwise it is a
+ * plain VIR_NET_STREAM packet, encoded as with
+ * virNetMessageEncodePayloadRaw.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int virNetMessageEncodeStreamData(virNetMessagePtr msg,
+                                  virNetMessageStreamCodecPtr codec,
+                                  const char *data,
+                                  size_t len)
+{
+    virNetStreamPacket pkt;
+    XDR xdr;
+    size_t pktlen;
+    size_t datalen = 0;
+
+    /* Data no longer than the packet header can't be sent any
+     * smaller, nor does the header even fit in its space */
+    if (!codec || len <= VIR_NET_STREAM_PACKET_XDR_LEN)
+        goto raw;
+
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.length = len;
+    if (virNetMessageStreamDataIsZero(data, len))
+        pkt.encoding = VIR_NET_STREAM_ENCODING_HOLE;
+    else if (codec->encoding == VIR_NET_STREAM_ENCODING_ZLIB)
+        pkt.encoding = VIR_NET_STREAM_ENCODING_ZLIB;
+    else
+        goto raw;
+
+    msg->header.type = VIR_NET_STREAM_ENCODED;
+    if (virNetMessageEncodeHeader(msg) < 0)
+        return -1;
+
+    /* The encoded packet is never bigger than the raw data, so
+     * it always fits in a message */
+    if (virNetMessageReserveBuffer(msg, msg->bufferOffset + len) < 0)
+        return -1;
+
+    xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
+                  len, XDR_ENCODE);
+    if (!xdr_virNetStreamPacket(&xdr, &pkt)) {
+        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode stream packet"));
+        xdr_destroy(&xdr);
+        return -1;
+    }
+    pktlen = xdr_getpos(&xdr);
+    xdr_destroy(&xdr);
+
+#if WITH_ZLIB
+    if (pkt.encoding == VIR_NET_STREAM_ENCODING_ZLIB) {
+        /* Data which doesn't shrink is sent as it is */
+        if (len <= pktlen || deflateReset(&codec->zs) != Z_OK)
+            goto raw;
+
+        codec->zs.next_in = (Bytef *)data;
+        codec->zs.avail_in = len;
+        codec->zs.next_out = (Bytef *)msg->buffer + msg->bufferOffset + pktlen;
+        codec->zs.avail_out = len - pktlen;
+
+        if (deflate(&codec->zs, Z_FINISH) != Z_STREAM_END)
+            goto raw;
+
+        datalen = len - pktlen - codec->zs.avail_out;
+    }
+#endif
+
+    VIR_DEBUG("Encoded %zu bytes of stream data as %zu bytes with encoding %d",
+              len, pktlen + datalen, pkt.encoding);
+
+    msg->bufferOffset += pktlen + datalen;
+    msg->payloadLength = msg->payloadOffset = 0;
+    return virNetMessageEncodePayloadEmpty(msg);
+
+raw:
+    msg->header.type = VIR_NET_STREAM;
+    if (virNetMessageEncodeHeader(msg) < 0)
+        return -1;
+
+    return virNetMessageEncodePayloadRaw(msg, data, len);
+}
+
+
+/*
+ * Turn the VIR_NET_STREAM_ENCODED packet in @msg, whose header
+ * was decoded, into the VIR_NET_STREAM packet it stands for: on
+ * success the decoded data is found from msg->bufferOffset to
+ * msg->bufferLength.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int virNetMessageDecodeStreamData(virNetMessagePtr msg)
+{
+    virNetStreamPacket pkt;
+    XDR xdr;
+    size_t offset;
+    char *buf = NULL;
+    size_t alloc = 0;
+    int ret = -1;
+
+    memset(&pkt, 0, sizeof(pkt));
+    xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
+                  msg->bufferLength - msg->bufferOffset, XDR_DECODE);
+    if (!xdr_virNetStreamPacket(&xdr, &pkt)) {
+        virReportError(VIR_ERR_RPC, "%s", _("Unable to decode stream packet"));
+        goto cleanup;
+    }
+    offset = msg->bufferOffset + xdr_getpos(&xdr);
+
+    if (pkt.length > VIR_NET_MESSAGE_PAYLOAD_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("Stream packet length %u exceeds maximum %d"),
+                       pkt.length, VIR_NET_MESSAGE_PAYLOAD_MAX);
+        goto cleanup;
+    }
+
+    /* The decoded data goes into a new buffer, which keeps
+     * a copy of the message header */
+    if (virNetMessageInitialize() < 0 ||
+        !(buf = virNetMessageBufferGet(msg->bufferOffset + pkt.length,
+                                       &alloc)))
+        goto cleanup;
+    memcpy(buf, msg->buffer, msg->bufferOffset);
+
+    switch ((virNetStreamEncoding) pkt.encoding) {
+    case VIR_NET_STREAM_ENCODING_HOLE:
+        if (offset != msg->bufferLength) {
+            virReportError(VIR_ERR_RPC, "%s",
+                           _("Unexpected data in stream hole packet"));
+            goto cleanup;
+        }
+        memset(buf + msg->bufferOffset, 0, pkt.length);
+        break;
+
+#if WITH_ZLIB
+    case VIR_NET_STREAM_ENCODING_ZLIB: {
+        uLongf buflen = pkt.length;
+
+        if (uncompress((Bytef *)buf + msg->bufferOffset, &buflen,
+                       (Bytef *)msg->buffer + offset,
+                       msg->bufferLength - offset) != Z_OK ||
+            buflen != pkt.length) {
+            virReportError(VIR_ERR_RPC, "%s",
+                           _("Unable to decompress stream data"));
+            goto cleanup;
+        }
+        break;
+    }
+#endif
+
+    default:
+        virReportError(VIR_ERR_RPC,
+                       _("Unsupported stream encoding %d"), pkt.encoding);
+        goto cleanup;
+    }
+
+    VIR_DEBUG("Decoded %zu bytes of stream data into %u bytes with encoding %d",
+              msg->bufferLength - offset, pkt.length, pkt.encoding);
+
+    virNetMessageBufferPut(msg->buffer, msg->bufferAlloc);
+    msg->buffer = buf;
+    msg->bufferAlloc = alloc;
+    msg->bufferLength = msg->bufferOffset + pkt.length;
+    msg->header.type = VIR_NET_STREAM;
+    buf = NULL;
+    ret = 0;
+
+cleanup:
+    virNetMessageBufferPut(buf, alloc);
+    xdr_destroy(&xdr);
+    return ret;
+}
+
+
 void virNetMessageSaveError(virNetMessageErrorPtr rerr)
 {
     /* This func may be called several times & the first
@@ -21,8 +21,18 @@
 #ifndef __VIR_NET_MESSAGE_H__
 # define __VIR_NET_MESSAGE_H__
 
+# include <sys/uio.h>
+
 # include "virnetprotocol.h"
 
+/* Size of the buffer initially used for outgoing messages, and for
+ * incoming messages which fit into it. Messages are only moved to
+ * a buffer of VIR_NET_MESSAGE_MAX when they don't fit */
+# define VIR_NET_MESSAGE_INITIAL 65536
+
+/* Maximum number of iovecs filled by virNetMessageGetIOV */
+# define VIR_NET_MESSAGE_NIOV 2
+
 typedef struct virNetMessageHeader *virNetMessageHeaderPtr;
 typedef struct virNetMessageError *virNetMessageErrorPtr;
 
@@ -31,12 +41,29 @@ typedef virNetMessage *virNetMessagePtr;
 
 typedef void (*virNetMessageFreeCallback)(virNetMessagePtr msg, void *opaque);
 
+typedef struct _virNetMessageStreamCodec virNetMessageStreamCodec;
+typedef virNetMessageStreamCodec *virNetMessageStreamCodecPtr;
+
 struct _virNetMessage {
     bool tracked;
 
-    char *buffer; /* Typically VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX */
+    char *buffer; /* Typically VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX */
     size_t bufferLength;
     size_t bufferOffset;
+    size_t bufferAlloc; /* Size of buffer if it came from the buffer pool */
+
+    /* Data sent straight after buffer, without being copied into it.
+     * Set up with virNetMessageReservePayload */
+    char *payload;
+    size_t payloadLength;
+    size_t payloadOffset;
+    size_t payloadAlloc;
+
+    /* Data sent after payload straight from a pipe, without ever
+     * being read into memory. Set up with virNetMessageEncodePayloadSplice */
+    int spliceFd;
+    size_t spliceLength;
+    size_t spliceOffset;
 
     virNetMessageHeader header;
 
@@ -47,6 +74,10 @@ struct _virNetMessage {
     int *fds;
     size_t donefds;
 
+    /* When the message was fully read, in microseconds, see
+     * virTimeMicrosMonotonicRaw. Zero if unknown */
+    unsigned long long received;
+
     virNetMessagePtr next;
 };
 
@@ -57,6 +88,20 @@ void virNetMessageClear(virNetMessagePtr);
 
 void virNetMessageFree(virNetMessagePtr msg);
 
+int virNetMessageReserveBuffer(virNetMessagePtr msg, size_t len)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
+char *virNetMessageReservePayload(virNetMessagePtr msg, size_t len)
+    ATTRIBUTE_NONNULL(1);
+void virNetMessageReleaseBuffer(virNetMessagePtr msg)
+    ATTRIBUTE_NONNULL(1);
+
+int virNetMessageGetIOV(virNetMessagePtr msg, struct iovec *iov)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+void virNetMessageAdvance(virNetMessagePtr msg, size_t len)
+    ATTRIBUTE_NONNULL(1);
+bool virNetMessageIsSent(virNetMessagePtr msg)
+    ATTRIBUTE_NONNULL(1);
+
 virNetMessagePtr virNetMessageQueueServe(virNetMessagePtr *queue)
     ATTRIBUTE_NONNULL(1);
 void virNetMessageQueuePush(virNetMessagePtr *queue,
@@ -86,9 +131,28 @@ int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
                                   const char *buf,
                                   size_t len)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
+int virNetMessageEncodePayloadSplice(virNetMessagePtr msg,
+                                     int fd,
+                                     size_t len)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
+
 int virNetMessageEncodePayloadEmpty(virNetMessagePtr msg)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
 
+unsigned int virNetMessageStreamEncodings(void);
+
+virNetMessageStreamCodecPtr virNetMessageStreamCodecNew(int encoding,
+                                                        int level);
+void virNetMessageStreamCodecFree(virNetMessageStreamCodecPtr codec);
+
+int virNetMessageEncodeStreamData(virNetMessagePtr msg,
+                                  virNetMessageStreamCodecPtr codec,
+                                  const char *data,
+                                  size_t len)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
+int virNetMessageDecodeStreamData(virNetMessagePtr msg)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
+
 void virNetMessageSaveError(virNetMessageErrorPtr rerr)
     ATTRIBUTE_NONNULL(1);
 
@@ -92,6 +92,9 @@ const VIR_NET_MESSAGE_NUM_FDS_MAX = 32;
  *  - type == VIR_NET_STREAM
  *      * serial matches that from the corresponding VIR_NET_CALL
  *
+ *  - type == VIR_NET_STREAM_ENCODED
+ *      * serial matches that from the corresponding VIR_NET_CALL
+ *
  * and the 'status' field varies according to:
  *
  *  - type == VIR_NET_CALL
@@ -109,6 +112,10 @@ const VIR_NET_MESSAGE_NUM_FDS_MAX = 32;
  *     * VIR_NET_OK if stream is complete
  *     * VIR_NET_ERROR if stream had an error
  *
+ *  - type == VIR_NET_STREAM_ENCODED
+ *     * VIR_NET_CONTINUE if more data is following
+ *     * VIR_NET_OK to request an encoding from the peer
+ *
  * Payload varies according to type and status:
  *
  *  - type == VIR_NET_CALL
@@ -132,6 +139,13 @@ const VIR_NET_MESSAGE_NUM_FDS_MAX = 32;
  *     * status == VIR_NET_OK
  *          <empty>
  *
+ *  - type == VIR_NET_STREAM_ENCODED
+ *     * status == VIR_NET_CONTINUE
+ *          virNetStreamPacket  encoding information
+ *          byte[]              encoded stream data
+ *     * status == VIR_NET_OK
+ *          virNetStreamEncodingRequest  encoding the peer should use
+ *
  *  - type == VIR_NET_CALL_WITH_FDS
  *          int8 - number of FDs
  *          XXX_args  for procedure
@@ -156,7 +170,9 @@ enum virNetMessageType {
     /* client -> server. args from a method call, with passed FDs */
     VIR_NET_CALL_WITH_FDS = 4,
     /* server -> client. reply/error from a method call, with passed FDs */
-    VIR_NET_REPLY_WITH_FDS = 5
+    VIR_NET_REPLY_WITH_FDS = 5,
+    /* either direction. stream data packet in a negotiated encoding */
+    VIR_NET_STREAM_ENCODED = 6
 };
 
 enum virNetMessageStatus {
@@ -187,6 +203,40 @@ struct virNetMessageHeader {
     virNetMessageStatus status;
 };
 
+/*
+ * Encoded stream data
+ *
+ * A peer only sends VIR_NET_STREAM_ENCODED data packets on a stream
+ * after the other end asked for it with a virNetStreamEncodingRequest,
+ * and only uses encodings the other end announced support for, which
+ * the remote program does with VIR_DRV_FEATURE_PROGRAM_STREAM_ENCODING.
+ * Data which does not pack well is still sent as VIR_NET_STREAM.
+ */
+enum virNetStreamEncoding {
+    /* Data is sent as is */
+    VIR_NET_STREAM_ENCODING_RAW = 0,
+    /* Data consisting of zero bytes only is sent as a hole */
+    VIR_NET_STREAM_ENCODING_HOLE = 1,
+    /* Data is sent zlib compressed, zeroed data as a hole */
+    VIR_NET_STREAM_ENCODING_ZLIB = 2
+};
+
+/* How the data following it in the packet is encoded. A
+ * VIR_NET_STREAM_ENCODING_HOLE packet has no data, the hole
+ * is decoded to @length zero bytes */
+struct virNetStreamPacket {
+    virNetStreamEncoding encoding;
+    unsigned length;            /* Length of the data once decoded */
+};
+
+/* Size of struct virNetStreamPacket (serialised) */
+const VIR_NET_STREAM_PACKET_XDR_LEN = 8;
+
+struct virNetStreamEncodingRequest {
+    virNetStreamEncoding encoding;
+    int level;                  /* Compression level, -1 for the default */
+};
+
 /* Error message. See <virterror.h> for explanation of fields. */
 
 /* Most of these don't really belong here. There are sadly needed
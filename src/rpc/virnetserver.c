@@ -37,6 +37,7 @@
 #include "virfile.h"
 #include "virnetservermdns.h"
 #include "virdbus.h"
+#include "vireventepoll.h"
 
 #ifndef SA_SIGINFO
 # define SA_SIGINFO 0
@@ -63,11 +64,43 @@ struct _virNetServerJob {
     virNetServerProgramPtr prog;
 };
 
+typedef struct _virNetServerIOLoop virNetServerIOLoop;
+typedef virNetServerIOLoop *virNetServerIOLoopPtr;
+
+/* A thread running an event loop of its own, which does the
+ * socket I/O and runs the keepalive timers for a share of the
+ * clients, so that the main loop isn't the bottleneck once
+ * there are many busy clients */
+struct _virNetServerIOLoop {
+    virNetServerPtr srv;
+    virEventEpollLoopPtr loop;
+    virThread thread;
+    bool quit;
+
+    /* Drives the keepalives of the clients below */
+    virKeepAliveWheelPtr wheel;
+
+    /* Clients whose I/O this loop handles */
+    size_t nclients;
+    virNetServerClientPtr *clients;
+
+    /* Scratch copy of @clients for virNetServerIOLoopReap, only
+     * used by the thread and kept between iterations */
+    size_t reap_max;
+    virNetServerClientPtr *reap;
+};
+
 struct _virNetServer {
     virObjectLockable parent;
 
     virThreadPoolPtr workers;
 
+    size_t nioloops;
+    virNetServerIOLoopPtr *ioloops;
+    /* Used by I/O threads to wake up the main loop when
+     * they have closed clients */
+    int reapTimer;
+
     bool privileged;
 
     size_t nsignals;
@@ -93,6 +126,8 @@ struct _virNetServer {
     int keepaliveInterval;
     unsigned int keepaliveCount;
     bool keepaliveRequired;
+    /* Drives the keepalives of clients handled by the main loop */
+    virKeepAliveWheelPtr wheel;
 
     unsigned int quit :1;
 
@@ -209,7 +244,11 @@ static int virNetServerDispatchNewMessage(virNetServerClientPtr client,
     VIR_DEBUG("server=%p client=%p message=%p",
               srv, client, msg);
 
-    virObjectLock(srv);
+    /* The client is locked, possibly by an I/O thread, and elsewhere
+     * the server is locked before its clients, so it must not be
+     * locked here. It doesn't need to be: programs are all added
+     * before any client can connect, and the worker pool lives as
+     * long as the server does */
     for (i = 0 ; i < srv->nprograms ; i++) {
         if (virNetServerProgramMatches(srv->programs[i], msg)) {
             prog = srv->programs[i];
@@ -245,15 +284,234 @@ static int virNetServerDispatchNewMessage(virNetServerClientPtr client,
     }
 
 cleanup:
+    return ret;
+}
+
+
+/* Remove @client from the server wide list, which must be locked */
+static void virNetServerRemoveClient(virNetServerPtr srv,
+                                     virNetServerClientPtr client)
+{
+    size_t i;
+
+    for (i = 0 ; i < srv->nclients ; i++) {
+        if (srv->clients[i] == client) {
+            virObjectUnref(client);
+            VIR_DELETE_ELEMENT(srv->clients, i, srv->nclients);
+            return;
+        }
+    }
+}
+
+
+/*
+ * Drop the clients of @ioloop which have been closed, first
+ * closing those which asked for it, the same way the main loop
+ * does for its own clients. The main loop leaves the clients of
+ * I/O loops alone, so they are also removed from the server wide
+ * list here.
+ *
+ * The clients are looked at without the server locked, as they
+ * may be busy and the server is locked before them elsewhere.
+ */
+static void virNetServerIOLoopReap(virNetServerIOLoopPtr ioloop)
+{
+    virNetServerPtr srv = ioloop->srv;
+    virNetServerClientPtr *clients;
+    size_t nclients = 0;
+    size_t nclosed = 0;
+    size_t i;
+
+    virObjectLock(srv);
+    if (!ioloop->nclients) {
+        virObjectUnlock(srv);
+        return;
+    }
+    if (VIR_RESIZE_N(ioloop->reap, ioloop->reap_max,
+                     0, ioloop->nclients) < 0) {
+        virObjectUnlock(srv);
+        virReportOOMError();
+        return;
+    }
+    clients = ioloop->reap;
+    for (i = 0 ; i < ioloop->nclients ; i++)
+        clients[nclients++] = virObjectRef(ioloop->clients[i]);
     virObjectUnlock(srv);
 
-    return ret;
+    /* Keep only the closed ones in @clients */
+    for (i = 0 ; i < nclients ; i++) {
+        if (virNetServerClientWantClose(clients[i]))
+            virNetServerClientClose(clients[i]);
+        if (virNetServerClientIsClosed(clients[i]))
+            clients[nclosed++] = clients[i];
+        else
+            virObjectUnref(clients[i]);
+    }
+
+    if (nclosed) {
+        virObjectLock(srv);
+        for (i = 0 ; i < nclosed ; i++) {
+            size_t j;
+
+            for (j = 0 ; j < ioloop->nclients ; j++) {
+                if (ioloop->clients[j] == clients[i]) {
+                    virObjectUnref(clients[i]);
+                    VIR_DELETE_ELEMENT(ioloop->clients, j, ioloop->nclients);
+                    break;
+                }
+            }
+            virNetServerRemoveClient(srv, clients[i]);
+        }
+
+        /* Let the main loop reconsider the shutdown timer */
+        if (srv->reapTimer > 0)
+            virEventUpdateTimeout(srv->reapTimer, 0);
+        virObjectUnlock(srv);
+    }
+
+    for (i = 0 ; i < nclosed ; i++)
+        virObjectUnref(clients[i]);
+}
+
+
+static void virNetServerIOLoopRun(void *opaque)
+{
+    virNetServerIOLoopPtr ioloop = opaque;
+    virNetServerPtr srv = ioloop->srv;
+
+    virObjectLock(srv);
+    while (!ioloop->quit) {
+        virObjectUnlock(srv);
+        if (virEventEpollLoopRunOnce(ioloop->loop) < 0) {
+            virErrorPtr err = virGetLastError();
+            VIR_ERROR(_("Client I/O loop iteration failed: %s"),
+                      err && err->message ? err->message : "<unknown>");
+            virObjectLock(srv);
+            break;
+        }
+        virNetServerIOLoopReap(ioloop);
+        virObjectLock(srv);
+    }
+    virObjectUnlock(srv);
+}
+
+
+static void virNetServerWakeupTimer(int timer ATTRIBUTE_UNUSED,
+                                    void *opaque ATTRIBUTE_UNUSED)
+{
+}
+
+
+static void virNetServerReapTimer(int timer,
+                                  void *opaque ATTRIBUTE_UNUSED)
+{
+    /* Waking the main loop up is all that was needed */
+    virEventUpdateTimeout(timer, -1);
+}
+
+
+static int virNetServerStartIOLoops(virNetServerPtr srv,
+                                    size_t nioloops)
+{
+    if (VIR_ALLOC_N(srv->ioloops, nioloops) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    while (srv->nioloops < nioloops) {
+        virNetServerIOLoopPtr ioloop;
+
+        if (VIR_ALLOC(ioloop) < 0) {
+            virReportOOMError();
+            return -1;
+        }
+        ioloop->srv = srv;
+
+        if (!(ioloop->loop = virEventEpollLoopNew())) {
+            VIR_FREE(ioloop);
+            return -1;
+        }
+
+        if (!(ioloop->wheel = virKeepAliveWheelNew(ioloop->loop))) {
+            virEventEpollLoopFree(ioloop->loop);
+            VIR_FREE(ioloop);
+            return -1;
+        }
+
+        if (virThreadCreate(&ioloop->thread, true,
+                            virNetServerIOLoopRun, ioloop) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("Unable to create client I/O thread"));
+            virKeepAliveWheelFree(ioloop->wheel);
+            virEventEpollLoopFree(ioloop->loop);
+            VIR_FREE(ioloop);
+            return -1;
+        }
+
+        srv->ioloops[srv->nioloops++] = ioloop;
+    }
+
+    return 0;
+}
+
+
+static void virNetServerStopIOLoop(virNetServerIOLoopPtr ioloop)
+{
+    virObjectLock(ioloop->srv);
+    ioloop->quit = true;
+    virObjectUnlock(ioloop->srv);
+
+    /* An already expired timer makes the thread return from its
+     * loop iteration, even one it is only about to start */
+    ignore_value(virEventEpollLoopAddTimeout(ioloop->loop, 0,
+                                             virNetServerWakeupTimer,
+                                             NULL, NULL));
+    virThreadJoin(&ioloop->thread);
+}
+
+
+/*
+ * Must only be called once the thread has been stopped and
+ * all the clients have been closed
+ */
+static void virNetServerFreeIOLoop(virNetServerIOLoopPtr ioloop)
+{
+    size_t i;
+
+    for (i = 0 ; i < ioloop->nclients ; i++)
+        virObjectUnref(ioloop->clients[i]);
+    VIR_FREE(ioloop->clients);
+    VIR_FREE(ioloop->reap);
+
+    virKeepAliveWheelFree(ioloop->wheel);
+    virEventEpollLoopFree(ioloop->loop);
+    VIR_FREE(ioloop);
+}
+
+
+/*
+ * Pick the I/O loop with the fewest clients, or NULL if all
+ * client I/O is done by the main loop
+ */
+static virNetServerIOLoopPtr virNetServerPickIOLoop(virNetServerPtr srv)
+{
+    virNetServerIOLoopPtr best = NULL;
+    size_t i;
+
+    for (i = 0 ; i < srv->nioloops ; i++) {
+        if (!best || srv->ioloops[i]->nclients < best->nclients)
+            best = srv->ioloops[i];
+    }
+
+    return best;
 }
 
 
 static int virNetServerAddClient(virNetServerPtr srv,
                                  virNetServerClientPtr client)
 {
+    virNetServerIOLoopPtr ioloop;
+
     virObjectLock(srv);
 
     if (srv->nclients >= srv->nclients_max) {
@@ -263,6 +521,22 @@ static int virNetServerAddClient(virNetServerPtr srv,
         goto error;
     }
 
+    if ((ioloop = virNetServerPickIOLoop(srv)) &&
+        virNetServerClientSetEventLoop(client, ioloop->loop) < 0)
+        goto error;
+
+    /* With I/O threads the client is live as soon as it
+     * is initialized, so everything it needs must be set
+     * up before then */
+    virNetServerClientSetDispatcher(client,
+                                    virNetServerDispatchNewMessage,
+                                    srv);
+
+    virNetServerClientInitKeepAlive(client,
+                                    ioloop ? ioloop->wheel : srv->wheel,
+                                    srv->keepaliveInterval,
+                                    srv->keepaliveCount);
+
     if (virNetServerClientInit(client) < 0)
         goto error;
 
@@ -273,12 +547,14 @@ static int virNetServerAddClient(virNetServerPtr srv,
     srv->clients[srv->nclients-1] = client;
     virObjectRef(client);
 
-    virNetServerClientSetDispatcher(client,
-                                    virNetServerDispatchNewMessage,
-                                    srv);
-
-    virNetServerClientInitKeepAlive(client, srv->keepaliveInterval,
-                                    srv->keepaliveCount);
+    if (ioloop) {
+        if (VIR_APPEND_ELEMENT_COPY(ioloop->clients, ioloop->nclients,
+                                    client) < 0) {
+            virReportOOMError();
+            goto error;
+        }
+        virObjectRef(client);
+    }
 
     virObjectUnlock(srv);
     return 0;
@@ -349,6 +625,7 @@ virNetServerFatalSignal(int sig, siginfo_t *siginfo ATTRIBUTE_UNUSED,
 virNetServerPtr virNetServerNew(size_t min_workers,
                                 size_t max_workers,
                                 size_t priority_workers,
+                                size_t io_threads,
                                 size_t max_clients,
                                 int keepaliveInterval,
                                 unsigned int keepaliveCount,
@@ -375,6 +652,13 @@ virNetServerPtr virNetServerNew(size_t min_workers,
                                           srv)))
         goto error;
 
+    if (io_threads &&
+        virNetServerStartIOLoops(srv, io_threads) < 0)
+        goto error;
+
+    if (!(srv->wheel = virKeepAliveWheelNew(NULL)))
+        goto error;
+
     srv->nclients_max = max_clients;
     srv->keepaliveInterval = keepaliveInterval;
     srv->keepaliveCount = keepaliveCount;
@@ -447,6 +731,7 @@ virNetServerPtr virNetServerNewPostExecRestart(virJSONValuePtr object,
     unsigned int min_workers;
     unsigned int max_workers;
     unsigned int priority_workers;
+    unsigned int io_threads = 0;
     unsigned int max_clients;
     unsigned int keepaliveInterval;
     unsigned int keepaliveCount;
@@ -468,6 +753,12 @@ virNetServerPtr virNetServerNewPostExecRestart(virJSONValuePtr object,
                        _("Missing priority_workers data in JSON document"));
         goto error;
     }
+    if (virJSONValueObjectHasKey(object, "io_threads") &&
+        virJSONValueObjectGetNumberUint(object, "io_threads", &io_threads) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Malformed io_threads data in JSON document"));
+        goto error;
+    }
     if (virJSONValueObjectGetNumberUint(object, "max_clients", &max_clients) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Missing max_clients data in JSON document"));
@@ -497,7 +788,7 @@ virNetServerPtr virNetServerNewPostExecRestart(virJSONValuePtr object,
     }
 
     if (!(srv = virNetServerNew(min_workers, max_clients,
-                                priority_workers, max_clients,
+                                priority_workers, io_threads, max_clients,
                                 keepaliveInterval, keepaliveCount,
                                 keepaliveRequired, mdnsGroupName,
                                 clientPrivNew, clientPrivPreExecRestart,
@@ -611,6 +902,11 @@ virJSONValuePtr virNetServerPreExecRestart(virNetServerPtr srv)
                        _("Cannot set priority_workers data in JSON document"));
         goto error;
     }
+    if (virJSONValueObjectAppendNumberUint(object, "io_threads", srv->nioloops) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Cannot set io_threads data in JSON document"));
+        goto error;
+    }
     if (virJSONValueObjectAppendNumberUint(object, "max_clients", srv->nclients_max) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Cannot set max_clients data in JSON document"));
@@ -1001,6 +1297,8 @@ error:
     return -1;
 }
 
+/* Must be called before the server accepts any clients, since
+ * incoming calls look up programs without locking the server */
 int virNetServerAddProgram(virNetServerPtr srv,
                            virNetServerProgramPtr prog)
 {
@@ -1081,6 +1379,15 @@ void virNetServerRun(virNetServerPtr srv)
         goto cleanup;
     }
 
+    if (srv->nioloops &&
+        (srv->reapTimer = virEventAddTimeout(-1,
+                                             virNetServerReapTimer,
+                                             NULL, NULL)) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Failed to register client reaping timeout"));
+        goto cleanup;
+    }
+
     VIR_DEBUG("srv=%p quit=%d", srv, srv->quit);
     while (!srv->quit) {
         /* A shutdown timeout is specified, so check
@@ -1112,6 +1419,12 @@ void virNetServerRun(virNetServerPtr srv)
         }
         virObjectLock(srv);
 
+        /* With I/O threads, all clients are owned by one of them,
+         * which closes and drops its clients itself, and the main
+         * loop must not lock them while holding the server */
+        if (srv->nioloops)
+            continue;
+
     reprocess:
         for (i = 0 ; i < srv->nclients ; i++) {
             /* Coverity 5.3.0 couldn't see that srv->clients is non-NULL
@@ -1137,6 +1450,10 @@ void virNetServerRun(virNetServerPtr srv)
     }
 
 cleanup:
+    if (srv->reapTimer > 0) {
+        virEventRemoveTimeout(srv->reapTimer);
+        srv->reapTimer = 0;
+    }
     virObjectUnlock(srv);
 }
 
@@ -1161,6 +1478,11 @@ void virNetServerDispose(void *obj)
     for (i = 0 ; i < srv->nservices ; i++)
         virNetServerServiceToggle(srv->services[i], false);
 
+    /* The I/O loops hand messages to the workers without the server
+     * locked, so they must be gone before the workers */
+    for (i = 0 ; i < srv->nioloops ; i++)
+        virNetServerStopIOLoop(srv->ioloops[i]);
+
     virThreadPoolFree(srv->workers);
 
     for (i = 0 ; i < srv->nsignals ; i++) {
@@ -1187,6 +1509,11 @@ void virNetServerDispose(void *obj)
     }
     VIR_FREE(srv->clients);
 
+    for (i = 0 ; i < srv->nioloops ; i++)
+        virNetServerFreeIOLoop(srv->ioloops[i]);
+    VIR_FREE(srv->ioloops);
+    virKeepAliveWheelFree(srv->wheel);
+
     VIR_FREE(srv->mdnsGroupName);
     virNetServerMDNSFree(srv->mdns);
 }
@@ -38,6 +38,7 @@
 virNetServerPtr virNetServerNew(size_t min_workers,
                                 size_t max_workers,
                                 size_t priority_workers,
+                                size_t io_threads,
                                 size_t max_clients,
                                 int keepaliveInterval,
                                 unsigned int keepaliveCount,
@@ -34,6 +34,7 @@
 #include "viralloc.h"
 #include "virthread.h"
 #include "virkeepalive.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
@@ -74,6 +75,9 @@ struct _virNetServerClient
 #endif
     int sockTimer; /* Timer to be fired upon cached data,
                     * so we jump out from poll() immediately */
+    /* Loop the socket and timers are registered on,
+     * NULL for the default event loop */
+    virEventEpollLoopPtr loop;
 
     /* Count of messages in the 'tx' queue,
      * and the server worker pool queue
@@ -224,7 +228,7 @@ static void virNetServerClientUpdateEvent(virNetServerClientPtr client)
     virNetSocketUpdateIOCallback(client->sock, mode);
 
     if (client->rx && virNetSocketHasCachedData(client->sock))
-        virEventUpdateTimeout(client->sockTimer, 0);
+        virEventEpollLoopUpdateTimeout(client->loop, client->sockTimer, 0);
 }
 
 
@@ -330,7 +334,7 @@ static void virNetServerClientSockTimerFunc(int timer,
 {
     virNetServerClientPtr client = opaque;
     virObjectLock(client);
-    virEventUpdateTimeout(timer, -1);
+    virEventEpollLoopUpdateTimeout(client->loop, timer, -1);
     /* Although client->rx != NULL when this timer is enabled, it might have
      * changed since the client was unlocked in the meantime. */
     if (client->rx)
@@ -364,19 +368,12 @@ virNetServerClientNewInternal(virNetSocketPtr sock,
 #endif
     client->nrequests_max = nrequests_max;
 
-    client->sockTimer = virEventAddTimeout(-1, virNetServerClientSockTimerFunc,
-                                           client, NULL);
-    if (client->sockTimer < 0)
-        goto error;
-
     /* Prepare one for packet receive */
     if (!(client->rx = virNetMessageNew(true)))
         goto error;
-    client->rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-    if (VIR_ALLOC_N(client->rx->buffer, client->rx->bufferLength) < 0) {
-        virReportOOMError();
+    if (virNetMessageReserveBuffer(client->rx, VIR_NET_MESSAGE_LEN_MAX) < 0)
         goto error;
-    }
+    client->rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
     client->nrequests = 1;
 
     PROBE(RPC_SERVER_CLIENT_NEW,
@@ -748,7 +745,7 @@ void virNetServerClientDispose(void *obj)
     virObjectUnref(client->sasl);
 #endif
     if (client->sockTimer > 0)
-        virEventRemoveTimeout(client->sockTimer);
+        virEventEpollLoopRemoveTimeout(client->loop, client->sockTimer);
 #if WITH_GNUTLS
     virObjectUnref(client->tls);
     virObjectUnref(client->tlsCtxt);
@@ -804,6 +801,14 @@ void virNetServerClientClose(virNetServerClientPtr client)
     if (client->sock)
         virNetSocketRemoveIOCallback(client->sock);
 
+    /* The loop may be gone by the time the client is
+     * disposed, so drop the timer while it is known
+     * to exist */
+    if (client->sockTimer > 0) {
+        virEventEpollLoopRemoveTimeout(client->loop, client->sockTimer);
+        client->sockTimer = 0;
+    }
+
 #if WITH_GNUTLS
     if (client->tls) {
         virObjectUnref(client->tls);
@@ -865,10 +870,40 @@ bool virNetServerClientWantClose(virNetServerClientPtr client)
 }
 
 
+/*
+ * Handle the I/O of @client on @loop rather than on the default
+ * event loop. Must be called before virNetServerClientInit, and
+ * @loop must exist until the client is closed.
+ */
+int virNetServerClientSetEventLoop(virNetServerClientPtr client,
+                                   virEventEpollLoopPtr loop)
+{
+    int ret = -1;
+
+    virObjectLock(client);
+    if (!client->sock ||
+        virNetSocketSetEventLoop(client->sock, loop) < 0)
+        goto cleanup;
+
+    client->loop = loop;
+    ret = 0;
+
+cleanup:
+    virObjectUnlock(client);
+    return ret;
+}
+
+
 int virNetServerClientInit(virNetServerClientPtr client)
 {
     virObjectLock(client);
 
+    if ((client->sockTimer =
+         virEventEpollLoopAddTimeout(client->loop, -1,
+                                     virNetServerClientSockTimerFunc,
+                                     client, NULL)) < 0)
+        goto error;
+
 #if WITH_GNUTLS
     if (!client->tlsCtxt) {
 #endif
@@ -1029,6 +1064,8 @@ readmore:
 
         /* Definitely finished reading, so remove from queue */
         virNetMessageQueueServe(&client->rx);
+        if (virTimeMicrosMonotonicRaw(&msg->received) < 0)
+            msg->received = 0;
         PROBE(RPC_SERVER_CLIENT_MSG_RX,
               "client=%p len=%zu prog=%u vers=%u proc=%u type=%u status=%u serial=%u",
               client, msg->bufferLength,
@@ -1082,15 +1119,12 @@ readmore:
         if (client->nrequests < client->nrequests_max) {
             if (!(client->rx = virNetMessageNew(true))) {
                 client->wantClose = true;
+            } else if (virNetMessageReserveBuffer(client->rx,
+                                                  VIR_NET_MESSAGE_LEN_MAX) < 0) {
+                client->wantClose = true;
             } else {
                 client->rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-                if (VIR_ALLOC_N(client->rx->buffer,
-                                client->rx->bufferLength) < 0) {
-                    virReportOOMError();
-                    client->wantClose = true;
-                } else {
-                    client->nrequests++;
-                }
+                client->nrequests++;
             }
         }
         virNetServerClientUpdateEvent(client);
@@ -1108,6 +1142,8 @@ readmore:
  */
 static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
 {
+    struct iovec iov[VIR_NET_MESSAGE_NIOV];
+    int niov;
     ssize_t ret;
 
     if (client->tx->bufferLength < client->tx->bufferOffset) {
@@ -1118,16 +1154,24 @@ static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
         return -1;
     }
 
-    if (client->tx->bufferLength == client->tx->bufferOffset)
-        return 1;
+    if (!(niov = virNetMessageGetIOV(client->tx, iov))) {
+        virNetMessagePtr msg = client->tx;
 
-    ret = virNetSocketWrite(client->sock,
-                            client->tx->buffer + client->tx->bufferOffset,
-                            client->tx->bufferLength - client->tx->bufferOffset);
+        if (msg->spliceOffset == msg->spliceLength)
+            return 1;
+
+        ret = virNetSocketSplice(client->sock, msg->spliceFd,
+                                 msg->spliceLength - msg->spliceOffset);
+        if (ret > 0)
+            msg->spliceOffset += ret;
+        return ret;
+    }
+
+    ret = virNetSocketWritev(client->sock, iov, niov);
     if (ret <= 0)
         return ret; /* -1 error, 0 = egain */
 
-    client->tx->bufferOffset += ret;
+    virNetMessageAdvance(client->tx, ret);
     return ret;
 }
 
@@ -1140,7 +1184,7 @@ static void
 virNetServerClientDispatchWrite(virNetServerClientPtr client)
 {
     while (client->tx) {
-        if (client->tx->bufferOffset < client->tx->bufferLength) {
+        if (!virNetMessageIsSent(client->tx)) {
             ssize_t ret;
             ret = virNetServerClientWrite(client);
             if (ret < 0) {
@@ -1151,7 +1195,7 @@ virNetServerClientDispatchWrite(virNetServerClientPtr client)
                 return; /* Would block on write EAGAIN */
         }
 
-        if (client->tx->bufferOffset == client->tx->bufferLength) {
+        if (virNetMessageIsSent(client->tx)) {
             virNetMessagePtr msg;
             size_t i;
 
@@ -1187,12 +1231,12 @@ virNetServerClientDispatchWrite(virNetServerClientPtr client)
                     client->nrequests < client->nrequests_max) {
                     /* Ready to recv more messages */
                     virNetMessageClear(msg);
-                    msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-                    if (VIR_ALLOC_N(msg->buffer, msg->bufferLength) < 0) {
-                        virReportOOMError();
+                    if (virNetMessageReserveBuffer(msg,
+                                                   VIR_NET_MESSAGE_LEN_MAX) < 0) {
                         virNetMessageFree(msg);
                         return;
                     }
+                    msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
                     client->rx = msg;
                     msg = NULL;
                     client->nrequests++;
@@ -1326,6 +1370,22 @@ bool virNetServerClientNeedAuth(virNetServerClientPtr client)
 }
 
 
+/*
+ * Whether stream data can be spliced into the socket of @client
+ * rather than copied into messages
+ */
+bool virNetServerClientCanSplice(virNetServerClientPtr client)
+{
+    bool ret = false;
+
+    virObjectLock(client);
+    if (client->sock)
+        ret = virNetSocketCanSplice(client->sock);
+    virObjectUnlock(client);
+    return ret;
+}
+
+
 static void
 virNetServerClientKeepAliveDeadCB(void *opaque)
 {
@@ -1342,6 +1402,7 @@ virNetServerClientKeepAliveSendCB(void *opaque,
 
 int
 virNetServerClientInitKeepAlive(virNetServerClientPtr client,
+                                virKeepAliveWheelPtr wheel,
                                 int interval,
                                 unsigned int count)
 {
@@ -1358,6 +1419,7 @@ virNetServerClientInitKeepAlive(virNetServerClientPtr client,
     /* keepalive object has a reference to client */
     virObjectRef(client);
 
+    virKeepAliveSetWheel(ka, wheel);
     client->keepalive = ka;
 
 cleanup:
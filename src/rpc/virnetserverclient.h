@@ -28,6 +28,7 @@
 # include "virnetmessage.h"
 # include "virobject.h"
 # include "virjson.h"
+# include "virkeepalive.h"
 
 typedef struct _virNetServerClient virNetServerClient;
 typedef virNetServerClient *virNetServerClientPtr;
@@ -116,9 +117,12 @@ void virNetServerClientDelayedClose(virNetServerClientPtr client);
 void virNetServerClientImmediateClose(virNetServerClientPtr client);
 bool virNetServerClientWantClose(virNetServerClientPtr client);
 
+int virNetServerClientSetEventLoop(virNetServerClientPtr client,
+                                   virEventEpollLoopPtr loop);
 int virNetServerClientInit(virNetServerClientPtr client);
 
 int virNetServerClientInitKeepAlive(virNetServerClientPtr client,
+                                    virKeepAliveWheelPtr wheel,
                                     int interval,
                                     unsigned int count);
 bool virNetServerClientCheckKeepAlive(virNetServerClientPtr client,
@@ -132,6 +136,7 @@ int virNetServerClientSendMessage(virNetServerClientPtr client,
                                   virNetMessagePtr msg);
 
 bool virNetServerClientNeedAuth(virNetServerClientPtr client);
+bool virNetServerClientCanSplice(virNetServerClientPtr client);
 
 
 #endif /* __VIR_NET_SERVER_CLIENT_H__ */
@@ -31,9 +31,13 @@
 #include "virlog.h"
 #include "virfile.h"
 #include "virthread.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
+/* Maximum number of programs keeping call statistics at once */
+#define VIR_NET_SERVER_PROGRAM_STATS_MAX 16
+
 struct _virNetServerProgram {
     virObject object;
 
@@ -41,12 +45,51 @@ struct _virNetServerProgram {
     unsigned version;
     virNetServerProgramProcPtr procs;
     size_t nprocs;
+
+    int statsID; /* Index into the shards' stats, or -1 */
+};
+
+/*
+ * Call statistics are accumulated in per-thread shards, so that
+ * the worker threads never contend on them, and only summed up
+ * when somebody asks for them. A shard is handed over to another
+ * thread once its owner exits, so there are never more shards
+ * than threads ever running at the same time. Shards are never
+ * freed.
+ *
+ * Readers do not synchronize with the owning thread, so a value
+ * may be slightly stale, which is fine for statistics.
+ */
+typedef struct _virNetServerProgramShard virNetServerProgramShard;
+typedef virNetServerProgramShard *virNetServerProgramShardPtr;
+
+struct _virNetServerProgramShard {
+    virNetServerProgramShardPtr next;
+    bool inuse;
+    virNetServerProgramProcStatsPtr stats[VIR_NET_SERVER_PROGRAM_STATS_MAX];
 };
 
+/* Protects everything below, and the shard fields apart from
+ * the counters themselves */
+static virMutex virNetServerProgramStatsLock;
+static virNetServerProgramShardPtr virNetServerProgramShards;
+static bool virNetServerProgramStatsIDs[VIR_NET_SERVER_PROGRAM_STATS_MAX];
+static virThreadLocal virNetServerProgramShardLocal;
+
 
 static virClassPtr virNetServerProgramClass;
 static void virNetServerProgramDispose(void *obj);
 
+static void
+virNetServerProgramShardRelease(void *opaque)
+{
+    virNetServerProgramShardPtr shard = opaque;
+
+    virMutexLock(&virNetServerProgramStatsLock);
+    shard->inuse = false;
+    virMutexUnlock(&virNetServerProgramStatsLock);
+}
+
 static int virNetServerProgramOnceInit(void)
 {
     if (!(virNetServerProgramClass = virClassNew(virClassForObject(),
@@ -55,6 +98,19 @@ static int virNetServerProgramOnceInit(void)
                                                  virNetServerProgramDispose)))
         return -1;
 
+    if (virMutexInit(&virNetServerProgramStatsLock) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to initialize mutex"));
+        return -1;
+    }
+
+    if (virThreadLocalInit(&virNetServerProgramShardLocal,
+                           virNetServerProgramShardRelease) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to initialize thread local variable"));
+        return -1;
+    }
+
     return 0;
 }
 
@@ -67,6 +123,7 @@ virNetServerProgramPtr virNetServerProgramNew(unsigned program,
                                               size_t nprocs)
 {
     virNetServerProgramPtr prog;
+    size_t i;
 
     if (virNetServerProgramInitialize() < 0)
         return NULL;
@@ -78,6 +135,21 @@ virNetServerProgramPtr virNetServerProgramNew(unsigned program,
     prog->version = version;
     prog->procs = procs;
     prog->nprocs = nprocs;
+    prog->statsID = -1;
+
+    virMutexLock(&virNetServerProgramStatsLock);
+    for (i = 0; i < VIR_NET_SERVER_PROGRAM_STATS_MAX; i++) {
+        if (!virNetServerProgramStatsIDs[i]) {
+            virNetServerProgramStatsIDs[i] = true;
+            prog->statsID = i;
+            break;
+        }
+    }
+    virMutexUnlock(&virNetServerProgramStatsLock);
+
+    if (prog->statsID < 0)
+        VIR_WARN("Too many programs, not keeping call statistics for %x",
+                 program);
 
     VIR_DEBUG("prog=%p", prog);
 
@@ -137,6 +209,180 @@ virNetServerProgramGetPriority(virNetServerProgramPtr prog,
     return proc->priority;
 }
 
+
+size_t virNetServerProgramGetNProcs(virNetServerProgramPtr prog)
+{
+    return prog->nprocs;
+}
+
+
+/*
+ * Returns the name of @procedure, or NULL if it is not a valid
+ * procedure of @prog
+ */
+const char *
+virNetServerProgramGetProcName(virNetServerProgramPtr prog,
+                               int procedure)
+{
+    virNetServerProgramProcPtr proc = virNetServerProgramGetProc(prog, procedure);
+
+    if (!proc)
+        return NULL;
+
+    return proc->name;
+}
+
+
+/*
+ * Get the statistics of @procedure for the calling thread,
+ * setting up its shard on first use. Returns NULL if the
+ * statistics are not being kept.
+ */
+static virNetServerProgramProcStatsPtr
+virNetServerProgramGetShardStats(virNetServerProgramPtr prog,
+                                 int procedure)
+{
+    virNetServerProgramShardPtr shard;
+    virNetServerProgramProcStatsPtr stats;
+
+    if (prog->statsID < 0)
+        return NULL;
+
+    if (!(shard = virThreadLocalGet(&virNetServerProgramShardLocal))) {
+        virMutexLock(&virNetServerProgramStatsLock);
+        for (shard = virNetServerProgramShards; shard; shard = shard->next) {
+            if (!shard->inuse)
+                break;
+        }
+        if (!shard) {
+            if (VIR_ALLOC(shard) < 0) {
+                virMutexUnlock(&virNetServerProgramStatsLock);
+                return NULL;
+            }
+            shard->next = virNetServerProgramShards;
+            virNetServerProgramShards = shard;
+        }
+        shard->inuse = true;
+        virMutexUnlock(&virNetServerProgramStatsLock);
+
+        if (virThreadLocalSet(&virNetServerProgramShardLocal, shard) < 0) {
+            virNetServerProgramShardRelease(shard);
+            return NULL;
+        }
+    }
+
+    if (!(stats = shard->stats[prog->statsID])) {
+        virMutexLock(&virNetServerProgramStatsLock);
+        if (VIR_ALLOC_N(stats, prog->nprocs) == 0)
+            shard->stats[prog->statsID] = stats;
+        virMutexUnlock(&virNetServerProgramStatsLock);
+        if (!stats)
+            return NULL;
+    }
+
+    return stats + procedure;
+}
+
+
+static void
+virNetServerProgramRecordCall(virNetServerProgramPtr prog,
+                              virNetMessagePtr msg,
+                              unsigned long long start,
+                              unsigned long long end,
+                              size_t replyLen,
+                              bool failed)
+{
+    virNetServerProgramProcStatsPtr stats;
+    unsigned long long wait = 0;
+    unsigned long long exec = 0;
+    unsigned long long limit = 10;
+    size_t bucket = 0;
+
+    if (!(stats = virNetServerProgramGetShardStats(prog, msg->header.proc)))
+        return;
+
+    if (msg->received && start > msg->received)
+        wait = start - msg->received;
+    if (end > start)
+        exec = end - start;
+
+    while (bucket < VIR_NET_SERVER_PROGRAM_HIST_BUCKETS - 1 &&
+           exec >= limit) {
+        bucket++;
+        limit *= 10;
+    }
+
+    stats->calls++;
+    if (failed)
+        stats->errors++;
+    stats->waitTotal += wait;
+    if (wait > stats->waitMax)
+        stats->waitMax = wait;
+    stats->execTotal += exec;
+    if (exec > stats->execMax)
+        stats->execMax = exec;
+    stats->execHist[bucket]++;
+    stats->replyBytes += replyLen;
+    if (replyLen > stats->replyBytesMax)
+        stats->replyBytesMax = replyLen;
+}
+
+
+/*
+ * @stats: filled with an array of statistics, indexed by procedure
+ * @nstats: filled with the number of elements in @stats
+ *
+ * Sum up the call statistics of all threads.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int
+virNetServerProgramGetStats(virNetServerProgramPtr prog,
+                            virNetServerProgramProcStatsPtr *stats,
+                            size_t *nstats)
+{
+    virNetServerProgramShardPtr shard;
+    size_t i, j;
+
+    if (VIR_ALLOC_N(*stats, prog->nprocs) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+    *nstats = prog->nprocs;
+
+    if (prog->statsID < 0)
+        return 0;
+
+    virMutexLock(&virNetServerProgramStatsLock);
+    for (shard = virNetServerProgramShards; shard; shard = shard->next) {
+        virNetServerProgramProcStatsPtr src = shard->stats[prog->statsID];
+
+        if (!src)
+            continue;
+
+        for (i = 0; i < prog->nprocs; i++) {
+            virNetServerProgramProcStatsPtr dst = *stats + i;
+
+            dst->calls += src[i].calls;
+            dst->errors += src[i].errors;
+            dst->waitTotal += src[i].waitTotal;
+            if (src[i].waitMax > dst->waitMax)
+                dst->waitMax = src[i].waitMax;
+            dst->execTotal += src[i].execTotal;
+            if (src[i].execMax > dst->execMax)
+                dst->execMax = src[i].execMax;
+            for (j = 0; j < VIR_NET_SERVER_PROGRAM_HIST_BUCKETS; j++)
+                dst->execHist[j] += src[i].execHist[j];
+            dst->replyBytes += src[i].replyBytes;
+            if (src[i].replyBytesMax > dst->replyBytesMax)
+                dst->replyBytesMax = src[i].replyBytesMax;
+        }
+    }
+    virMutexUnlock(&virNetServerProgramStatsLock);
+
+    return 0;
+}
+
 static int
 virNetServerProgramSendError(unsigned program,
                              unsigned version,
@@ -205,7 +451,9 @@ virNetServerProgramSendReplyError(virNetServerProgramPtr prog,
                                         msg,
                                         rerr,
                                         req->proc,
-                                        req->type == VIR_NET_STREAM ? VIR_NET_STREAM : VIR_NET_REPLY,
+                                        (req->type == VIR_NET_STREAM ||
+                                         req->type == VIR_NET_STREAM_ENCODED) ?
+                                        VIR_NET_STREAM : VIR_NET_REPLY,
                                         req->serial);
 }
 
@@ -306,6 +554,7 @@ int virNetServerProgramDispatch(virNetServerProgramPtr prog,
         break;
 
     case VIR_NET_STREAM:
+    case VIR_NET_STREAM_ENCODED:
         /* Since stream data is non-acked, async, we may continue to receive
          * stream packets after we closed down a stream. Just drop & ignore
          * these.
@@ -375,6 +624,8 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
     virNetServerProgramProcPtr dispatcher;
     virNetMessageError rerr;
     size_t i;
+    unsigned long long start = 0;
+    unsigned long long end = 0;
 
     memset(&rerr, 0, sizeof(rerr));
 
@@ -429,7 +680,9 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
      *
      *   'args and 'ret'
      */
+    ignore_value(virTimeMicrosMonotonicRaw(&start));
     rv = (dispatcher->func)(server, client, msg, &rerr, arg, ret);
+    ignore_value(virTimeMicrosMonotonicRaw(&end));
 
     /*
      * If rv == 1, this indicates the dispatch func has
@@ -481,10 +734,17 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
     VIR_FREE(arg);
     VIR_FREE(ret);
 
+    virNetServerProgramRecordCall(prog, msg, start, end,
+                                  msg->bufferLength, false);
+
     /* Put reply on end of tx queue to send out  */
     return virNetServerClientSendMessage(client, msg);
 
 error:
+    /* Only calls which made it to the dispatch func are accounted */
+    if (start)
+        virNetServerProgramRecordCall(prog, msg, start, end, 0, true);
+
     /* Bad stuff (de-)serializing message, but we have an
      * RPC error message we can send back to the client */
     rv = virNetServerProgramSendReplyError(prog, client, msg, &rerr, &msg->header);
@@ -501,6 +761,7 @@ int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
                                       virNetMessagePtr msg,
                                       int procedure,
                                       int serial,
+                                      virNetMessageStreamCodecPtr codec,
                                       const char *data,
                                       size_t len)
 {
@@ -521,15 +782,14 @@ int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
      */
     msg->header.status = data ? VIR_NET_CONTINUE : VIR_NET_OK;
 
-    if (virNetMessageEncodeHeader(msg) < 0)
-        return -1;
-
     if (data && len) {
-        if (virNetMessageEncodePayloadRaw(msg, data, len) < 0)
+        /* May turn the packet into VIR_NET_STREAM_ENCODED */
+        if (virNetMessageEncodeStreamData(msg, codec, data, len) < 0)
             return -1;
 
     } else {
-        if (virNetMessageEncodePayloadEmpty(msg) < 0)
+        if (virNetMessageEncodeHeader(msg) < 0 ||
+            virNetMessageEncodePayloadEmpty(msg) < 0)
             return -1;
     }
     VIR_DEBUG("Total %zu", msg->bufferLength);
@@ -538,6 +798,50 @@ int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
 }
 
 
-void virNetServerProgramDispose(void *obj ATTRIBUTE_UNUSED)
+/*
+ * Same as virNetServerProgramSendStreamData with @len bytes of
+ * data, but the data is spliced from the pipe @fd straight to the
+ * socket of @client, see virNetServerClientCanSplice. @msg takes
+ * @fd over, even on failure.
+ */
+int virNetServerProgramSendStreamSplice(virNetServerProgramPtr prog,
+                                        virNetServerClientPtr client,
+                                        virNetMessagePtr msg,
+                                        int procedure,
+                                        int serial,
+                                        int fd,
+                                        size_t len)
+{
+    VIR_DEBUG("client=%p msg=%p fd=%d len=%zu", client, msg, fd, len);
+
+    msg->header.prog = prog->program;
+    msg->header.vers = prog->version;
+    msg->header.proc = procedure;
+    msg->header.type = VIR_NET_STREAM;
+    msg->header.serial = serial;
+    msg->header.status = VIR_NET_CONTINUE;
+
+    if (virNetMessageEncodeHeader(msg) < 0 ||
+        virNetMessageEncodePayloadSplice(msg, fd, len) < 0) {
+        VIR_FORCE_CLOSE(fd);
+        return -1;
+    }
+
+    return virNetServerClientSendMessage(client, msg);
+}
+
+
+void virNetServerProgramDispose(void *obj)
 {
+    virNetServerProgramPtr prog = obj;
+    virNetServerProgramShardPtr shard;
+
+    if (prog->statsID < 0)
+        return;
+
+    virMutexLock(&virNetServerProgramStatsLock);
+    for (shard = virNetServerProgramShards; shard; shard = shard->next)
+        VIR_FREE(shard->stats[prog->statsID]);
+    virNetServerProgramStatsIDs[prog->statsID] = false;
+    virMutexUnlock(&virNetServerProgramStatsLock);
 }
@@ -55,6 +55,29 @@ struct _virNetServerProgramProc {
     xdrproc_t ret_filter;
     bool needAuth;
     unsigned int priority;
+    const char *name;
+};
+
+/* Number of buckets in the execution time histogram */
+# define VIR_NET_SERVER_PROGRAM_HIST_BUCKETS 8
+
+typedef struct _virNetServerProgramProcStats virNetServerProgramProcStats;
+typedef virNetServerProgramProcStats *virNetServerProgramProcStatsPtr;
+
+/* Times are in microseconds */
+struct _virNetServerProgramProcStats {
+    unsigned long long calls;
+    unsigned long long errors;
+    unsigned long long waitTotal;   /* Time between reading the call and
+                                     * a worker picking it up */
+    unsigned long long waitMax;
+    unsigned long long execTotal;   /* Time spent in the dispatch func */
+    unsigned long long execMax;
+    /* execHist[i] counts the calls that ran for less than 10^(i+1)
+     * microseconds, the last bucket gets all the slower ones */
+    unsigned long long execHist[VIR_NET_SERVER_PROGRAM_HIST_BUCKETS];
+    unsigned long long replyBytes;
+    unsigned long long replyBytesMax;
 };
 
 virNetServerProgramPtr virNetServerProgramNew(unsigned program,
@@ -68,6 +91,15 @@ int virNetServerProgramGetVersion(virNetServerProgramPtr prog);
 unsigned int virNetServerProgramGetPriority(virNetServerProgramPtr prog,
                                             int procedure);
 
+size_t virNetServerProgramGetNProcs(virNetServerProgramPtr prog);
+const char *virNetServerProgramGetProcName(virNetServerProgramPtr prog,
+                                           int procedure);
+
+int virNetServerProgramGetStats(virNetServerProgramPtr prog,
+                                virNetServerProgramProcStatsPtr *stats,
+                                size_t *nstats)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(3);
+
 int virNetServerProgramMatches(virNetServerProgramPtr prog,
                                virNetMessagePtr msg);
 
@@ -98,7 +130,16 @@ int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
                                       virNetMessagePtr msg,
                                       int procedure,
                                       int serial,
+                                      virNetMessageStreamCodecPtr codec,
                                       const char *data,
                                       size_t len);
 
+int virNetServerProgramSendStreamSplice(virNetServerProgramPtr prog,
+                                        virNetServerClientPtr client,
+                                        virNetMessagePtr msg,
+                                        int procedure,
+                                        int serial,
+                                        int fd,
+                                        size_t len);
+
 #endif /* __VIR_NET_SERVER_PROGRAM_H__ */
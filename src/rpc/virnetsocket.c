@@ -25,6 +25,7 @@
 
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <signal.h>
@@ -63,6 +64,7 @@ struct _virNetSocket {
 
     int fd;
     int watch;
+    virEventEpollLoopPtr loop;
     pid_t pid;
     int errfd;
     bool client;
@@ -997,7 +999,7 @@ void virNetSocketDispose(void *obj)
 
     VIR_DEBUG("sock=%p fd=%d", sock, sock->fd);
     if (sock->watch > 0) {
-        virEventRemoveHandle(sock->watch);
+        virEventEpollLoopRemoveHandle(sock->loop, sock->watch);
         sock->watch = -1;
     }
 
@@ -1499,6 +1501,139 @@ ssize_t virNetSocketWrite(virNetSocketPtr sock, const char *buf, size_t len)
 }
 
 
+/*
+ * Write as much of the @iovcnt buffers in @iov as possible. They
+ * are gathered into a single writev on plain sockets; with TLS, SASL
+ * or SSH, only the first buffer is written on each call.
+ *
+ * Returns the number of bytes written, 0 if it would block, -1 on
+ * error
+ */
+ssize_t virNetSocketWritev(virNetSocketPtr sock,
+                           const struct iovec *iov,
+                           int iovcnt)
+{
+    ssize_t ret;
+    bool plain = iovcnt > 1;
+
+#if WITH_GNUTLS
+    if (sock->tlsSession)
+        plain = false;
+#endif
+#if WITH_SASL
+    if (sock->saslSession)
+        plain = false;
+#endif
+#if WITH_SSH2
+    if (sock->sshSession)
+        plain = false;
+#endif
+#ifdef WIN32
+    plain = false;
+#endif
+
+    if (!plain)
+        return virNetSocketWrite(sock, iov[0].iov_base, iov[0].iov_len);
+
+    virObjectLock(sock);
+rewrite:
+    ret = writev(sock->fd, iov, iovcnt);
+    if (ret < 0) {
+        if (errno == EINTR)
+            goto rewrite;
+        if (errno == EAGAIN) {
+            ret = 0;
+        } else {
+            virReportSystemError(errno, "%s",
+                                 _("Cannot write data"));
+        }
+    } else if (ret == 0) {
+        virReportSystemError(EIO, "%s",
+                             _("End of file while writing data"));
+        ret = -1;
+    }
+    virObjectUnlock(sock);
+
+    return ret;
+}
+
+
+/*
+ * Whether data can be spliced into @sock, which requires the
+ * data to go on the wire unchanged
+ */
+bool virNetSocketCanSplice(virNetSocketPtr sock)
+{
+    bool ret = false;
+
+#if HAVE_SPLICE
+    virObjectLock(sock);
+    ret = true;
+# if WITH_GNUTLS
+    if (sock->tlsSession)
+        ret = false;
+# endif
+# if WITH_SASL
+    if (sock->saslSession)
+        ret = false;
+# endif
+# if WITH_SSH2
+    if (sock->sshSession)
+        ret = false;
+# endif
+    virObjectUnlock(sock);
+#endif
+
+    return ret;
+}
+
+
+/*
+ * Move up to @len bytes buffered in the pipe @fd to @sock, without
+ * copying them through user space. Must only be used if
+ * virNetSocketCanSplice said so.
+ *
+ * Returns the number of bytes sent, 0 if it would block, -1 on
+ * error
+ */
+#if HAVE_SPLICE
+ssize_t virNetSocketSplice(virNetSocketPtr sock, int fd, size_t len)
+{
+    ssize_t ret;
+
+    virObjectLock(sock);
+resplice:
+    ret = splice(fd, NULL, sock->fd, NULL, len, SPLICE_F_NONBLOCK);
+    if (ret < 0) {
+        if (errno == EINTR)
+            goto resplice;
+        if (errno == EAGAIN) {
+            ret = 0;
+        } else {
+            virReportSystemError(errno, "%s",
+                                 _("Cannot splice data"));
+        }
+    } else if (ret == 0) {
+        virReportSystemError(EIO, "%s",
+                             _("End of file while splicing data"));
+        ret = -1;
+    }
+    virObjectUnlock(sock);
+
+    return ret;
+}
+#else
+ssize_t virNetSocketSplice(virNetSocketPtr sock ATTRIBUTE_UNUSED,
+                           int fd ATTRIBUTE_UNUSED,
+                           size_t len ATTRIBUTE_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Splicing data is not supported on this platform"));
+    return -1;
+}
+#endif
+
+
 /*
  * Returns 1 if an FD was sent, 0 if it would block, -1 on error
  */
@@ -1664,6 +1799,31 @@ static void virNetSocketEventFree(void *opaque)
     virObjectUnref(sock);
 }
 
+/*
+ * Make the I/O callback of @sock run on @loop rather than on the
+ * default event loop. This must be done before the callback is
+ * added, and @loop must outlive @sock.
+ */
+int virNetSocketSetEventLoop(virNetSocketPtr sock,
+                             virEventEpollLoopPtr loop)
+{
+    int ret = -1;
+
+    virObjectLock(sock);
+    if (sock->watch > 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Cannot change the event loop of a watched socket"));
+        goto cleanup;
+    }
+
+    sock->loop = loop;
+    ret = 0;
+
+cleanup:
+    virObjectUnlock(sock);
+    return ret;
+}
+
 int virNetSocketAddIOCallback(virNetSocketPtr sock,
                               int events,
                               virNetSocketIOFunc func,
@@ -1679,11 +1839,12 @@ int virNetSocketAddIOCallback(virNetSocketPtr sock,
         goto cleanup;
     }
 
-    if ((sock->watch = virEventAddHandle(sock->fd,
-                                         events,
-                                         virNetSocketEventHandle,
-                                         sock,
-                                         virNetSocketEventFree)) < 0) {
+    if ((sock->watch = virEventEpollLoopAddHandle(sock->loop,
+                                                  sock->fd,
+                                                  events,
+                                                  virNetSocketEventHandle,
+                                                  sock,
+                                                  virNetSocketEventFree)) < 0) {
         VIR_DEBUG("Failed to register watch on socket %p", sock);
         goto cleanup;
     }
@@ -1710,7 +1871,7 @@ void virNetSocketUpdateIOCallback(virNetSocketPtr sock,
         return;
     }
 
-    virEventUpdateHandle(sock->watch, events);
+    virEventEpollLoopUpdateHandle(sock->loop, sock->watch, events);
 
     virObjectUnlock(sock);
 }
@@ -1725,7 +1886,7 @@ void virNetSocketRemoveIOCallback(virNetSocketPtr sock)
         return;
     }
 
-    virEventRemoveHandle(sock->watch);
+    virEventEpollLoopRemoveHandle(sock->loop, sock->watch);
 
     virObjectUnlock(sock);
 }
@@ -39,6 +39,11 @@
 
 #define DH_BITS 1024
 
+/* How many sessions are remembered for resumption, and for how
+ * long, which is also how long GnuTLS accepts resuming them */
+#define VIR_NET_TLS_SESSION_CACHE_SIZE 128
+#define VIR_NET_TLS_SESSION_CACHE_TIMEOUT 3600
+
 #define LIBVIRT_PKI_DIR SYSCONFDIR "/pki"
 #define LIBVIRT_CACERT LIBVIRT_PKI_DIR "/CA/cacert.pem"
 #define LIBVIRT_CACRL LIBVIRT_PKI_DIR "/CA/cacrl.pem"
@@ -49,12 +54,48 @@
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
+typedef struct _virNetTLSSessionCacheEntry virNetTLSSessionCacheEntry;
+typedef virNetTLSSessionCacheEntry *virNetTLSSessionCacheEntryPtr;
+struct _virNetTLSSessionCacheEntry {
+    unsigned char *key;
+    size_t keylen;
+    unsigned char *data;
+    size_t datalen;
+    time_t expires;
+};
+
+/*
+ * A server keeps the sessions it established, by session ID, so
+ * that clients can resume them. Clients keep the last session
+ * established with each server, to resume it on their next
+ * connection, in a cache shared by the whole process since each
+ * connection usually comes with a context of its own.
+ */
+typedef struct _virNetTLSSessionCache virNetTLSSessionCache;
+typedef virNetTLSSessionCache *virNetTLSSessionCachePtr;
+struct _virNetTLSSessionCache {
+    virMutex lock;
+    size_t next; /* Entry to replace when the cache is full */
+    virNetTLSSessionCacheEntry entries[VIR_NET_TLS_SESSION_CACHE_SIZE];
+};
+
 struct _virNetTLSContext {
     virObjectLockable parent;
 
     gnutls_certificate_credentials_t x509cred;
     gnutls_dh_params_t dhParams;
 
+    /* Server only. The cache has its own lock, as GnuTLS uses it
+     * during handshakes, with the session locked */
+    virNetTLSSessionCache cache;
+    /* Client only, the credentials the context was loaded from, so
+     * that sessions are only ever resumed with the credentials they
+     * were established with */
+    char *identity;
+#if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+    gnutls_datum_t ticketKey;
+#endif
+
     bool isServer;
     bool requireValidCert;
     const char *const*x509dnWhitelist;
@@ -67,6 +108,8 @@ struct _virNetTLSSession {
 
     bool isServer;
     char *hostname;
+    char *cacheKey; /* Client only, see virNetTLSSessionResume */
+    virNetTLSContextPtr ctxt;
     gnutls_session_t session;
     virNetTLSSessionWriteFunc writeFunc;
     virNetTLSSessionReadFunc readFunc;
@@ -78,6 +121,9 @@ static virClassPtr virNetTLSSessionClass;
 static void virNetTLSContextDispose(void *obj);
 static void virNetTLSSessionDispose(void *obj);
 
+static virNetTLSSessionCache virNetTLSClientSessionCache;
+static int virNetTLSSessionCacheInit(virNetTLSSessionCachePtr cache);
+
 
 static int virNetTLSContextOnceInit(void)
 {
@@ -93,12 +139,212 @@ static int virNetTLSContextOnceInit(void)
                                               virNetTLSSessionDispose)))
         return -1;
 
+    if (virNetTLSSessionCacheInit(&virNetTLSClientSessionCache) < 0)
+        return -1;
+
     return 0;
 }
 
 VIR_ONCE_GLOBAL_INIT(virNetTLSContext)
 
 
+static int
+virNetTLSSessionCacheInit(virNetTLSSessionCachePtr cache)
+{
+    if (virMutexInit(&cache->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize mutex"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void
+virNetTLSSessionCacheEntryClear(virNetTLSSessionCacheEntryPtr entry)
+{
+    /* Session data holds the master secret */
+    if (entry->data)
+        memset(entry->data, 0, entry->datalen);
+    VIR_FREE(entry->data);
+    VIR_FREE(entry->key);
+    entry->keylen = entry->datalen = 0;
+    entry->expires = 0;
+}
+
+
+static void
+virNetTLSSessionCacheClear(virNetTLSSessionCachePtr cache)
+{
+    size_t i;
+
+    for (i = 0 ; i < VIR_NET_TLS_SESSION_CACHE_SIZE ; i++)
+        virNetTLSSessionCacheEntryClear(&cache->entries[i]);
+    virMutexDestroy(&cache->lock);
+}
+
+
+/*
+ * Returns the live entry for @key, or NULL. Expired entries
+ * met on the way are dropped. Must be called with @cache locked.
+ */
+static virNetTLSSessionCacheEntryPtr
+virNetTLSSessionCacheFind(virNetTLSSessionCachePtr cache,
+                          const unsigned char *key,
+                          size_t keylen,
+                          time_t now)
+{
+    size_t i;
+
+    for (i = 0 ; i < VIR_NET_TLS_SESSION_CACHE_SIZE ; i++) {
+        virNetTLSSessionCacheEntryPtr entry = &cache->entries[i];
+
+        if (!entry->key)
+            continue;
+
+        if (entry->expires <= now) {
+            virNetTLSSessionCacheEntryClear(entry);
+            continue;
+        }
+
+        if (entry->keylen == keylen &&
+            memcmp(entry->key, key, keylen) == 0)
+            return entry;
+    }
+
+    return NULL;
+}
+
+
+static int
+virNetTLSSessionCacheStore(virNetTLSSessionCachePtr cache,
+                           const unsigned char *key,
+                           size_t keylen,
+                           const unsigned char *data,
+                           size_t datalen)
+{
+    virNetTLSSessionCacheEntryPtr entry;
+    unsigned char *newkey = NULL;
+    unsigned char *newdata = NULL;
+    time_t now = time(NULL);
+    size_t i;
+
+    if (VIR_ALLOC_N(newkey, keylen) < 0 ||
+        VIR_ALLOC_N(newdata, datalen) < 0) {
+        VIR_FREE(newkey);
+        virReportOOMError();
+        return -1;
+    }
+    memcpy(newkey, key, keylen);
+    memcpy(newdata, data, datalen);
+
+    virMutexLock(&cache->lock);
+
+    if (!(entry = virNetTLSSessionCacheFind(cache, key, keylen, now))) {
+        for (i = 0 ; i < VIR_NET_TLS_SESSION_CACHE_SIZE ; i++) {
+            if (!cache->entries[i].key) {
+                entry = &cache->entries[i];
+                break;
+            }
+        }
+    }
+
+    /* When full, replace the entries in turn */
+    if (!entry) {
+        entry = &cache->entries[cache->next];
+        cache->next = (cache->next + 1) % VIR_NET_TLS_SESSION_CACHE_SIZE;
+    }
+
+    virNetTLSSessionCacheEntryClear(entry);
+    entry->key = newkey;
+    entry->keylen = keylen;
+    entry->data = newdata;
+    entry->datalen = datalen;
+    entry->expires = now + VIR_NET_TLS_SESSION_CACHE_TIMEOUT;
+
+    virMutexUnlock(&cache->lock);
+    return 0;
+}
+
+
+/*
+ * Returns a copy of the data stored for @key, allocated with
+ * gnutls_malloc, or an empty datum if there is none
+ */
+static gnutls_datum_t
+virNetTLSSessionCacheRetrieve(virNetTLSSessionCachePtr cache,
+                              const unsigned char *key,
+                              size_t keylen)
+{
+    virNetTLSSessionCacheEntryPtr entry;
+    gnutls_datum_t ret = { NULL, 0 };
+
+    virMutexLock(&cache->lock);
+    if ((entry = virNetTLSSessionCacheFind(cache, key, keylen, time(NULL))) &&
+        (ret.data = gnutls_malloc(entry->datalen))) {
+        memcpy(ret.data, entry->data, entry->datalen);
+        ret.size = entry->datalen;
+    }
+    virMutexUnlock(&cache->lock);
+
+    return ret;
+}
+
+
+static void
+virNetTLSSessionCacheRemove(virNetTLSSessionCachePtr cache,
+                            const unsigned char *key,
+                            size_t keylen)
+{
+    virNetTLSSessionCacheEntryPtr entry;
+
+    virMutexLock(&cache->lock);
+    if ((entry = virNetTLSSessionCacheFind(cache, key, keylen, time(NULL))))
+        virNetTLSSessionCacheEntryClear(entry);
+    virMutexUnlock(&cache->lock);
+}
+
+
+/* GnuTLS session database callbacks of server sessions */
+static int
+virNetTLSContextSessionStore(void *opaque,
+                             gnutls_datum_t key,
+                             gnutls_datum_t data)
+{
+    virNetTLSContextPtr ctxt = opaque;
+
+    if (virNetTLSSessionCacheStore(&ctxt->cache, key.data, key.size,
+                                   data.data, data.size) < 0) {
+        virResetLastError();
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static gnutls_datum_t
+virNetTLSContextSessionRetrieve(void *opaque,
+                                gnutls_datum_t key)
+{
+    virNetTLSContextPtr ctxt = opaque;
+
+    return virNetTLSSessionCacheRetrieve(&ctxt->cache, key.data, key.size);
+}
+
+
+static int
+virNetTLSContextSessionRemove(void *opaque,
+                              gnutls_datum_t key)
+{
+    virNetTLSContextPtr ctxt = opaque;
+
+    virNetTLSSessionCacheRemove(&ctxt->cache, key.data, key.size);
+    return 0;
+}
+
+
 static int
 virNetTLSContextCheckCertFile(const char *type, const char *file, bool allowMissing)
 {
@@ -723,6 +969,27 @@ static virNetTLSContextPtr virNetTLSContextNew(const char *cacert,
 
         gnutls_certificate_set_dh_params(ctxt->x509cred,
                                          ctxt->dhParams);
+
+#if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+        err = gnutls_session_ticket_key_generate(&ctxt->ticketKey);
+        if (err < 0) {
+            virReportError(VIR_ERR_SYSTEM_ERROR,
+                           _("Unable to generate TLS session ticket key: %s"),
+                           gnutls_strerror(err));
+            goto error;
+        }
+#endif
+    }
+
+    /* Lets sessions be resumed rather than going through a full
+     * handshake on each connection */
+    if (isServer) {
+        if (virNetTLSSessionCacheInit(&ctxt->cache) < 0)
+            goto error;
+    } else if (virAsprintf(&ctxt->identity, "%s;%s;%s;%s", cacert,
+                           NULLSTR(cacrl), NULLSTR(cert), NULLSTR(key)) < 0) {
+        virReportOOMError();
+        goto error;
     }
 
     ctxt->requireValidCert = requireValidCert;
@@ -736,9 +1003,14 @@ static virNetTLSContextPtr virNetTLSContextNew(const char *cacert,
     return ctxt;
 
 error:
-    if (isServer)
+    if (isServer) {
         gnutls_dh_params_deinit(ctxt->dhParams);
+#if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+        gnutls_free(ctxt->ticketKey.data);
+#endif
+    }
     gnutls_certificate_free_credentials(ctxt->x509cred);
+    VIR_FREE(ctxt->identity);
     VIR_FREE(ctxt);
     return NULL;
 }
@@ -1115,6 +1387,17 @@ void virNetTLSContextDispose(void *obj)
 
     gnutls_dh_params_deinit(ctxt->dhParams);
     gnutls_certificate_free_credentials(ctxt->x509cred);
+
+    if (ctxt->isServer)
+        virNetTLSSessionCacheClear(&ctxt->cache);
+    VIR_FREE(ctxt->identity);
+
+#if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+    if (ctxt->isServer) {
+        memset(ctxt->ticketKey.data, 0, ctxt->ticketKey.size);
+        gnutls_free(ctxt->ticketKey.data);
+    }
+#endif
 }
 
 
@@ -1197,6 +1480,33 @@ virNetTLSSessionPtr virNetTLSSessionNew(virNetTLSContextPtr ctxt,
         gnutls_certificate_server_set_request(sess->session, GNUTLS_CERT_REQUEST);
 
         gnutls_dh_set_prime_bits(sess->session, DH_BITS);
+
+        gnutls_db_set_retrieve_function(sess->session,
+                                        virNetTLSContextSessionRetrieve);
+        gnutls_db_set_store_function(sess->session,
+                                     virNetTLSContextSessionStore);
+        gnutls_db_set_remove_function(sess->session,
+                                      virNetTLSContextSessionRemove);
+        gnutls_db_set_ptr(sess->session, ctxt);
+        gnutls_db_set_cache_expiration(sess->session,
+                                       VIR_NET_TLS_SESSION_CACHE_TIMEOUT);
+
+#if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+        if ((err = gnutls_session_ticket_enable_server(sess->session,
+                                                       &ctxt->ticketKey)) != 0) {
+            virReportError(VIR_ERR_SYSTEM_ERROR,
+                           _("Failed to enable TLS session tickets: %s"),
+                           gnutls_strerror(err));
+            goto error;
+        }
+    } else {
+        if ((err = gnutls_session_ticket_enable_client(sess->session)) != 0) {
+            virReportError(VIR_ERR_SYSTEM_ERROR,
+                           _("Failed to enable TLS session tickets: %s"),
+                           gnutls_strerror(err));
+            goto error;
+        }
+#endif
     }
 
     gnutls_transport_set_ptr(sess->session, sess);
@@ -1206,6 +1516,8 @@ virNetTLSSessionPtr virNetTLSSessionNew(virNetTLSContextPtr ctxt,
                                        virNetTLSSessionPull);
 
     sess->isServer = ctxt->isServer;
+    /* The session database callbacks use the context */
+    sess->ctxt = virObjectRef(ctxt);
 
     PROBE(RPC_TLS_SESSION_NEW,
           "sess=%p ctxt=%p hostname=%s isServer=%d",
@@ -1361,12 +1673,130 @@ cleanup:
 }
 
 
+/**
+ * virNetTLSSessionResume:
+ * @sess: a client session, before its handshake
+ * @key: identifies the server connected to
+ *
+ * Offer the server to resume the session last saved under @key
+ * by virNetTLSSessionSave on a session of a context loaded from
+ * the same credentials, if any, which avoids most of the cost of
+ * the handshake. The server falls back to a full handshake if it
+ * doesn't know the session anymore.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int virNetTLSSessionResume(virNetTLSSessionPtr sess,
+                           const char *key)
+{
+    gnutls_datum_t data;
+    int ret = -1;
+    int err;
+
+    virObjectLock(sess);
+
+    VIR_FREE(sess->cacheKey);
+    if (virAsprintf(&sess->cacheKey, "%s;%s", key,
+                    NULLSTR(sess->ctxt->identity)) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    data = virNetTLSSessionCacheRetrieve(&virNetTLSClientSessionCache,
+                                         (const unsigned char *)sess->cacheKey,
+                                         strlen(sess->cacheKey));
+    if (data.data) {
+        if ((err = gnutls_session_set_data(sess->session,
+                                           data.data, data.size)) != 0)
+            VIR_DEBUG("Cannot resume TLS session with %s: %s",
+                      key, gnutls_strerror(err));
+        else
+            VIR_DEBUG("Resuming TLS session with %s", key);
+        memset(data.data, 0, data.size);
+        gnutls_free(data.data);
+    }
+
+    ret = 0;
+
+cleanup:
+    virObjectUnlock(sess);
+    return ret;
+}
+
+
+/**
+ * virNetTLSSessionSave:
+ * @sess: a client session
+ *
+ * Remember @sess, so that the next session with the same server,
+ * from a context loaded from the same credentials, can resume it.
+ * Only call this once the handshake is complete and the server
+ * certificate was checked.
+ */
+void virNetTLSSessionSave(virNetTLSSessionPtr sess)
+{
+    unsigned char *data = NULL;
+    size_t len = 0;
+    int err;
+
+    virObjectLock(sess);
+
+    if (!sess->cacheKey || !sess->handshakeComplete)
+        goto cleanup;
+
+    /* The first call only gets the size of the data */
+    err = gnutls_session_get_data(sess->session, NULL, &len);
+    if ((err != 0 && err != GNUTLS_E_SHORT_MEMORY_BUFFER) || !len) {
+        VIR_DEBUG("No TLS session data to save");
+        goto cleanup;
+    }
+
+    if (VIR_ALLOC_N(data, len) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    if ((err = gnutls_session_get_data(sess->session, data, &len)) != 0) {
+        VIR_DEBUG("Unable to get TLS session data: %s", gnutls_strerror(err));
+        goto cleanup;
+    }
+
+    if (virNetTLSSessionCacheStore(&virNetTLSClientSessionCache,
+                                   (const unsigned char *)sess->cacheKey,
+                                   strlen(sess->cacheKey),
+                                   data, len) < 0)
+        goto cleanup;
+
+    VIR_DEBUG("Saved TLS session with %s", sess->cacheKey);
+
+cleanup:
+    if (data)
+        memset(data, 0, len);
+    VIR_FREE(data);
+    virObjectUnlock(sess);
+}
+
+
+bool virNetTLSSessionIsResumed(virNetTLSSessionPtr sess)
+{
+    bool ret;
+
+    virObjectLock(sess);
+    ret = sess->handshakeComplete && gnutls_session_is_resumed(sess->session);
+    virObjectUnlock(sess);
+
+    return ret;
+}
+
+
 void virNetTLSSessionDispose(void *obj)
 {
     virNetTLSSessionPtr sess = obj;
 
     VIR_FREE(sess->hostname);
+    VIR_FREE(sess->cacheKey);
     gnutls_deinit(sess->session);
+    virObjectUnref(sess->ctxt);
 }
 
 /*
@@ -94,4 +94,9 @@ virNetTLSSessionGetHandshakeStatus(virNetTLSSessionPtr sess);
 
 int virNetTLSSessionGetKeySize(virNetTLSSessionPtr sess);
 
+int virNetTLSSessionResume(virNetTLSSessionPtr sess,
+                           const char *key);
+void virNetTLSSessionSave(virNetTLSSessionPtr sess);
+bool virNetTLSSessionIsResumed(virNetTLSSessionPtr sess);
+
 #endif
@@ -70,6 +70,9 @@ typedef virStorageBackend *virStorageBackendPtr;
 
 struct _virStorageBackend {
     int type;
+    /* refreshPool brings the existing volume list up to date itself,
+     * rather than expecting it to be emptied first */
+    bool incrementalRefresh;
 
     virStorageBackendFindPoolSources findPoolSources;
     virStorageBackendCheckPool checkPool;
@@ -46,20 +46,14 @@ virStorageBackendDiskMakeDataVol(virStoragePoolObjPtr pool,
                                  virStorageVolDefPtr vol)
 {
     char *tmp, *devpath;
+    bool new_vol = false;
 
     if (vol == NULL) {
         if (VIR_ALLOC(vol) < 0) {
             virReportOOMError();
             return -1;
         }
-
-        if (VIR_REALLOC_N(pool->volumes.objs,
-                          pool->volumes.count+1) < 0) {
-            virReportOOMError();
-            virStorageVolDefFree(vol);
-            return -1;
-        }
-        pool->volumes.objs[pool->volumes.count++] = vol;
+        new_vol = true;
 
         /* Prepended path will be same for all partitions, so we can
          * strip the path to form a reasonable pool-unique name
@@ -67,14 +61,14 @@ virStorageBackendDiskMakeDataVol(virStoragePoolObjPtr pool,
         tmp = strrchr(groups[0], '/');
         if ((vol->name = strdup(tmp ? tmp + 1 : groups[0])) == NULL) {
             virReportOOMError();
-            return -1;
+            goto error;
         }
     }
 
     if (vol->target.path == NULL) {
         if ((devpath = strdup(groups[0])) == NULL) {
             virReportOOMError();
-            return -1;
+            goto error;
         }
 
         /* Now figure out the stable path
@@ -86,21 +80,21 @@ virStorageBackendDiskMakeDataVol(virStoragePoolObjPtr pool,
         vol->target.path = virStorageBackendStablePath(pool, devpath, true);
         VIR_FREE(devpath);
         if (vol->target.path == NULL)
-            return -1;
+            goto error;
     }
 
     if (vol->key == NULL) {
         /* XXX base off a unique key of the underlying disk */
         if ((vol->key = strdup(vol->target.path)) == NULL) {
             virReportOOMError();
-            return -1;
+            goto error;
         }
     }
 
     if (vol->source.extents == NULL) {
         if (VIR_ALLOC(vol->source.extents) < 0) {
             virReportOOMError();
-            return -1;
+            goto error;
         }
         vol->source.nextent = 1;
 
@@ -108,26 +102,26 @@ virStorageBackendDiskMakeDataVol(virStoragePoolObjPtr pool,
                              &vol->source.extents[0].start) < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR,
                            "%s", _("cannot parse device start location"));
-            return -1;
+            goto error;
         }
 
         if (virStrToLong_ull(groups[4], NULL, 10,
                              &vol->source.extents[0].end) < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR,
                            "%s", _("cannot parse device end location"));
-            return -1;
+            goto error;
         }
 
         if ((vol->source.extents[0].path =
              strdup(pool->def->source.devices[0].path)) == NULL) {
             virReportOOMError();
-            return -1;
+            goto error;
         }
     }
 
     /* Refresh allocation/capacity/perms */
     if (virStorageBackendUpdateVolInfo(vol, 1) < 0)
-        return -1;
+        goto error;
 
     /* set partition type */
     if (STREQ(groups[1], "normal"))
@@ -146,12 +140,22 @@ virStorageBackendDiskMakeDataVol(virStoragePoolObjPtr pool,
     vol->allocation = vol->capacity =
         (vol->source.extents[0].end - vol->source.extents[0].start);
 
+    /* Only add a new volume once its key and path are known */
+    if (new_vol &&
+        virStoragePoolObjAddVol(pool, vol) < 0)
+        goto error;
+
     if (STRNEQ(groups[2], "metadata"))
         pool->def->allocation += vol->allocation;
     if (vol->source.extents[0].end > pool->def->capacity)
         pool->def->capacity = vol->source.extents[0].end;
 
     return 0;
+
+error:
+    if (new_vol)
+        virStorageVolDefFree(vol);
+    return -1;
 }
 
 static int
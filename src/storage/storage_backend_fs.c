@@ -50,6 +50,14 @@
 #include "virxml.h"
 #include "virfile.h"
 #include "virlog.h"
+#include "virutil.h"
+#include "virobject.h"
+#include "virevent.h"
+#include "stat-time.h"
+
+#if HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+#endif
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
@@ -804,18 +812,165 @@ error:
 }
 
 
-/**
+static void
+virStorageBackendFileSystemStampVol(virStorageVolDefPtr vol,
+                                    const struct stat *sb)
+{
+    vol->probed.valid = true;
+    vol->probed.dev = sb->st_dev;
+    vol->probed.ino = sb->st_ino;
+    vol->probed.size = sb->st_size;
+    vol->probed.mtime = get_stat_mtime(sb);
+    vol->probed.ctime = get_stat_ctime(sb);
+}
+
+/* Whether the file behind @vol is still the one it was probed from */
+static bool
+virStorageBackendFileSystemVolUnchanged(virStorageVolDefPtr vol,
+                                        const struct stat *sb)
+{
+    struct timespec mtime = get_stat_mtime(sb);
+    struct timespec ctime = get_stat_ctime(sb);
+
+    return vol->probed.valid &&
+        vol->probed.dev == sb->st_dev &&
+        vol->probed.ino == sb->st_ino &&
+        vol->probed.size == sb->st_size &&
+        vol->probed.mtime.tv_sec == mtime.tv_sec &&
+        vol->probed.mtime.tv_nsec == mtime.tv_nsec &&
+        vol->probed.ctime.tv_sec == ctime.tv_sec &&
+        vol->probed.ctime.tv_nsec == ctime.tv_nsec;
+}
+
+
+static void
+virStorageBackendFileSystemUpdateBacking(virStorageVolDefPtr vol)
+{
+    if (virStorageBackendUpdateVolTargetInfo(&vol->backingStore,
+                                NULL, NULL,
+                                VIR_STORAGE_VOL_OPEN_DEFAULT) < 0) {
+        /* The backing file is currently unavailable, the capacity,
+         * allocation, owner, group and mode are unknown. Just log the
+         * error and continue.
+         * Unfortunately virStorageBackendProbeTarget() might already
+         * have logged a similar message for the same problem, but only
+         * if AUTO format detection was used. */
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot probe backing volume info: %s"),
+                       vol->backingStore.path);
+    }
+}
+
+
+/*
+ * Probe the file @name in the pool directory. On success *@volret
+ * is set to the new volume, or to NULL if the file is not a volume,
+ * eg '.', '..', 'lost+found' or a dangling symbolic link.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+virStorageBackendFileSystemProbeVol(virStoragePoolObjPtr pool,
+                                    const char *name,
+                                    virStorageVolDefPtr *volret)
+{
+    virStorageVolDefPtr vol = NULL;
+    struct stat sb;
+    bool stamp;
+    char *backingStore;
+    int backingStoreFormat;
+    int ret;
+
+    *volret = NULL;
+
+    if (VIR_ALLOC(vol) < 0)
+        goto no_memory;
+
+    if ((vol->name = strdup(name)) == NULL)
+        goto no_memory;
+
+    vol->type = VIR_STORAGE_VOL_FILE;
+    vol->target.format = VIR_STORAGE_FILE_RAW; /* Real value is filled in during probe */
+    if (virAsprintf(&vol->target.path, "%s/%s",
+                    pool->def->target.path,
+                    vol->name) == -1)
+        goto no_memory;
+
+    if ((vol->key = strdup(vol->target.path)) == NULL)
+        goto no_memory;
+
+    /* Stat before probing: should the file change in between, the
+     * stamp is older than what was probed and the next refresh will
+     * simply probe it again */
+    stamp = stat(vol->target.path, &sb) == 0;
+
+    if ((ret = virStorageBackendProbeTarget(&vol->target,
+                                            &backingStore,
+                                            &backingStoreFormat,
+                                            &vol->allocation,
+                                            &vol->capacity,
+                                            &vol->target.encryption)) < 0) {
+        if (ret == -2) {
+            /* Silently ignore non-regular files,
+             * eg '.' '..', 'lost+found', dangling symbolic link */
+            virStorageVolDefFree(vol);
+            return 0;
+        } else if (ret == -3) {
+            /* The backing file is currently unavailable, its format is not
+             * explicitly specified, the probe to auto detect the format
+             * failed: continue with faked RAW format, since AUTO will
+             * break virStorageVolTargetDefFormat() generating the line
+             * <format type='...'/>. */
+            backingStoreFormat = VIR_STORAGE_FILE_RAW;
+        } else
+            goto error;
+    }
+
+    /* directory based volume */
+    if (vol->target.format == VIR_STORAGE_FILE_DIR)
+        vol->type = VIR_STORAGE_VOL_DIR;
+
+    if (backingStore != NULL) {
+        vol->backingStore.path = backingStore;
+        vol->backingStore.format = backingStoreFormat;
+        virStorageBackendFileSystemUpdateBacking(vol);
+    }
+
+    /* Don't let a volume whose backing format could not be probed be
+     * reused, so it is probed again once the backing file shows up */
+    if (stamp && ret != -3)
+        virStorageBackendFileSystemStampVol(vol, &sb);
+
+    *volret = vol;
+    return 0;
+
+no_memory:
+    virReportOOMError();
+error:
+    virStorageVolDefFree(vol);
+    return -1;
+}
+
+
+/*
  * Iterate over the pool's directory and enumerate all disk images
- * within it. This is non-recursive.
+ * within it. This is non-recursive. Volumes whose file has not
+ * changed since it was last probed are kept rather than probed again.
  */
 static int
-virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
-                                   virStoragePoolObjPtr pool)
+virStorageBackendFileSystemScan(virStoragePoolObjPtr pool)
 {
     DIR *dir;
     struct dirent *ent;
-    struct statvfs sb;
-    virStorageVolDefPtr vol = NULL;
+    virStorageVolDefList old = pool->volumes;
+    virStorageVolDefPtr vol;
+    unsigned int i;
+    int ret = -1;
+
+    /* Build up a new list, moving over unchanged volumes */
+    memset(&pool->volumes, 0, sizeof(pool->volumes));
+    pool->volumes.privateData = old.privateData;
+    pool->volumes.privateDataFreeFunc = old.privateDataFreeFunc;
 
     if (!(dir = opendir(pool->def->target.path))) {
         virReportSystemError(errno,
@@ -825,82 +980,373 @@ virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
     }
 
     while ((ent = readdir(dir)) != NULL) {
-        int ret;
-        char *backingStore;
-        int backingStoreFormat;
-
-        if (VIR_ALLOC(vol) < 0)
-            goto no_memory;
-
-        if ((vol->name = strdup(ent->d_name)) == NULL)
-            goto no_memory;
-
-        vol->type = VIR_STORAGE_VOL_FILE;
-        vol->target.format = VIR_STORAGE_FILE_RAW; /* Real value is filled in during probe */
-        if (virAsprintf(&vol->target.path, "%s/%s",
-                        pool->def->target.path,
-                        vol->name) == -1)
-            goto no_memory;
-
-        if ((vol->key = strdup(vol->target.path)) == NULL)
-            goto no_memory;
-
-        if ((ret = virStorageBackendProbeTarget(&vol->target,
-                                                &backingStore,
-                                                &backingStoreFormat,
-                                                &vol->allocation,
-                                                &vol->capacity,
-                                                &vol->target.encryption)) < 0) {
-            if (ret == -2) {
-                /* Silently ignore non-regular files,
-                 * eg '.' '..', 'lost+found', dangling symbolic link */
-                virStorageVolDefFree(vol);
-                vol = NULL;
-                continue;
-            } else if (ret == -3) {
-                /* The backing file is currently unavailable, its format is not
-                 * explicitly specified, the probe to auto detect the format
-                 * failed: continue with faked RAW format, since AUTO will
-                 * break virStorageVolTargetDefFormat() generating the line
-                 * <format type='...'/>. */
-                backingStoreFormat = VIR_STORAGE_FILE_RAW;
-            } else
+        struct stat sb;
+
+        if ((vol = virHashLookup(old.byName, ent->d_name)) &&
+            stat(vol->target.path, &sb) == 0 &&
+            virStorageBackendFileSystemVolUnchanged(vol, &sb)) {
+            if (vol->backingStore.path)
+                virStorageBackendFileSystemUpdateBacking(vol);
+            if (virStoragePoolObjAddVol(pool, vol) < 0)
                 goto cleanup;
+            continue;
         }
 
-        /* directory based volume */
-        if (vol->target.format == VIR_STORAGE_FILE_DIR)
-            vol->type = VIR_STORAGE_VOL_DIR;
-
-        if (backingStore != NULL) {
-            vol->backingStore.path = backingStore;
-            vol->backingStore.format = backingStoreFormat;
-
-            if (virStorageBackendUpdateVolTargetInfo(&vol->backingStore,
-                                        NULL, NULL,
-                                        VIR_STORAGE_VOL_OPEN_DEFAULT) < 0) {
-                /* The backing file is currently unavailable, the capacity,
-                 * allocation, owner, group and mode are unknown. Just log the
-                 * error and continue.
-                 * Unfortunately virStorageBackendProbeTarget() might already
-                 * have logged a similar message for the same problem, but only
-                 * if AUTO format detection was used. */
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("cannot probe backing volume info: %s"),
-                               vol->backingStore.path);
-            }
+        if (virStorageBackendFileSystemProbeVol(pool, ent->d_name, &vol) < 0)
+            goto cleanup;
+
+        if (vol && virStoragePoolObjAddVol(pool, vol) < 0) {
+            virStorageVolDefFree(vol);
+            goto cleanup;
         }
+    }
 
+    ret = 0;
+
+cleanup:
+    if (dir)
+        closedir(dir);
 
-        if (VIR_REALLOC_N(pool->volumes.objs,
-                          pool->volumes.count+1) < 0)
-            goto no_memory;
-        pool->volumes.objs[pool->volumes.count++] = vol;
-        vol = NULL;
+    for (i = 0 ; i < old.count ; i++) {
+        vol = old.objs[i];
+        if (virStorageVolDefFindByName(pool, vol->name) != vol)
+            virStorageVolDefFree(vol);
     }
-    closedir(dir);
+    VIR_FREE(old.objs);
+    virHashFree(old.byName);
+    virHashFree(old.byKey);
+    virHashFree(old.byPath);
+
+    if (ret < 0)
+        virStoragePoolObjClearVols(pool);
+    return ret;
+}
 
 
+#if HAVE_SYS_INOTIFY_H
+/*
+ * An inotify watch on the pool directory, recording the names of the
+ * entries changed since the pool was last refreshed, so a refresh only
+ * needs to look at those. The watch hangs off the volume list of the
+ * pool and is dropped along with it, which forces the next refresh to
+ * scan the whole directory. It is shared with the event loop, hence
+ * refcounted.
+ */
+typedef struct _virStorageBackendFSWatch virStorageBackendFSWatch;
+typedef virStorageBackendFSWatch *virStorageBackendFSWatchPtr;
+struct _virStorageBackendFSWatch {
+    virObjectLockable parent;
+
+    int fd;
+    int watch;
+
+    /* names of changed entries */
+    virHashTablePtr changed;
+    /* changes were lost, the directory has to be scanned */
+    bool overflow;
+    /* the directory is no longer watched */
+    bool broken;
+};
+
+static virClassPtr virStorageBackendFSWatchClass;
+static void virStorageBackendFSWatchDispose(void *obj);
+
+static int virStorageBackendFSWatchOnceInit(void)
+{
+    if (!(virStorageBackendFSWatchClass =
+          virClassNew(virClassForObjectLockable(),
+                      "virStorageBackendFSWatch",
+                      sizeof(virStorageBackendFSWatch),
+                      virStorageBackendFSWatchDispose)))
+        return -1;
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virStorageBackendFSWatch)
+
+static void
+virStorageBackendFSWatchDispose(void *obj)
+{
+    virStorageBackendFSWatchPtr w = obj;
+
+    VIR_FORCE_CLOSE(w->fd);
+    virHashFree(w->changed);
+}
+
+/*
+ * Read all pending events of the watch, which must be locked, into
+ * its set of changed entries.
+ */
+static void
+virStorageBackendFSWatchDrain(virStorageBackendFSWatchPtr w)
+{
+    char buf[4096];
+    struct inotify_event *e;
+    ssize_t got;
+    char *tmp;
+
+    if (w->broken)
+        return;
+
+    for (;;) {
+        got = read(w->fd, buf, sizeof(buf));
+        if (got <= 0) {
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got == 0 || errno != EAGAIN)
+                w->broken = true;
+            break;
+        }
+
+        tmp = buf;
+        while (got >= (ssize_t)sizeof(struct inotify_event)) {
+            e = (struct inotify_event *)tmp;
+            tmp += sizeof(struct inotify_event) + e->len;
+            got -= sizeof(struct inotify_event) + e->len;
+
+            if (e->mask & (IN_IGNORED | IN_UNMOUNT |
+                           IN_DELETE_SELF | IN_MOVE_SELF))
+                w->broken = true;
+            else if (e->mask & IN_Q_OVERFLOW)
+                w->overflow = true;
+            else if (e->len &&
+                     virHashUpdateEntry(w->changed, e->name, NULL) < 0)
+                w->overflow = true;
+        }
+    }
+
+    /* Nothing more worth reading will come */
+    if (w->broken && w->watch >= 0) {
+        virEventRemoveHandle(w->watch);
+        w->watch = -1;
+    }
+}
+
+static void
+virStorageBackendFSWatchEvent(int watch ATTRIBUTE_UNUSED,
+                              int fd ATTRIBUTE_UNUSED,
+                              int events ATTRIBUTE_UNUSED,
+                              void *opaque)
+{
+    virStorageBackendFSWatchPtr w = opaque;
+
+    virObjectLock(w);
+    virStorageBackendFSWatchDrain(w);
+    virObjectUnlock(w);
+}
+
+static void
+virStorageBackendFSWatchFree(void *opaque)
+{
+    virStorageBackendFSWatchPtr w = opaque;
+
+    virObjectLock(w);
+    if (w->watch >= 0) {
+        virEventRemoveHandle(w->watch);
+        w->watch = -1;
+    }
+    virObjectUnlock(w);
+    virObjectUnref(w);
+}
+
+/*
+ * Start watching the pool directory, unless already done. Not
+ * being able to is not an error, refreshes just have to scan the
+ * whole directory then.
+ */
+static void
+virStorageBackendFSWatchStart(virStoragePoolObjPtr pool)
+{
+    virStorageBackendFSWatchPtr w;
+
+    if (pool->volumes.privateData ||
+        virStorageBackendFSWatchInitialize() < 0 ||
+        !(w = virObjectNew(virStorageBackendFSWatchClass)))
+        return;
+
+    w->watch = -1;
+    if ((w->fd = inotify_init()) < 0 ||
+        virSetNonBlock(w->fd) < 0 ||
+        virSetCloseExec(w->fd) < 0 ||
+        inotify_add_watch(w->fd, pool->def->target.path,
+                          IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                          IN_MOVED_TO | IN_CLOSE_WRITE |
+                          IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF) < 0 ||
+        !(w->changed = virHashCreate(32, NULL))) {
+        VIR_DEBUG("Cannot watch pool directory '%s'", pool->def->target.path);
+        virObjectUnref(w);
+        return;
+    }
+
+    /* The event loop holds a reference of its own */
+    virObjectRef(w);
+    if ((w->watch = virEventAddHandle(w->fd, VIR_EVENT_HANDLE_READABLE,
+                                      virStorageBackendFSWatchEvent,
+                                      w, virObjectFreeCallback)) < 0) {
+        virObjectUnref(w);
+        virObjectUnref(w);
+        return;
+    }
+
+    pool->volumes.privateData = w;
+    pool->volumes.privateDataFreeFunc = virStorageBackendFSWatchFree;
+}
+
+/*
+ * Take the set of entries changed since the last call, which is NULL
+ * if the directory has to be scanned.
+ *
+ * Returns 0 on success, -1 if the watch is broken and has to be
+ * started afresh.
+ */
+static int
+virStorageBackendFSWatchTakeChanges(virStorageBackendFSWatchPtr w,
+                                    virHashTablePtr *changed)
+{
+    virHashTablePtr fresh = virHashCreate(32, NULL);
+    int ret = 0;
+
+    *changed = NULL;
+
+    virObjectLock(w);
+    /* The event loop may not have got round to reading changes
+     * made just before the refresh yet */
+    virStorageBackendFSWatchDrain(w);
+    if (w->broken) {
+        ret = -1;
+    } else if (w->overflow || !fresh) {
+        virHashRemoveAll(w->changed);
+    } else {
+        *changed = w->changed;
+        w->changed = fresh;
+        fresh = NULL;
+    }
+    w->overflow = false;
+    virObjectUnlock(w);
+
+    virHashFree(fresh);
+    return ret;
+}
+
+/*
+ * Bring the volumes for the entries in @changed up to date, after
+ * the pool directory watch reported changes to them. Writes to files
+ * kept open, eg by a running guest, are only reported once they are
+ * closed, so the volumes already known are checked for changes too.
+ */
+static int
+virStorageBackendFileSystemRescan(virStoragePoolObjPtr pool,
+                                  virHashTablePtr changed)
+{
+    virHashKeyValuePairPtr names = NULL;
+    size_t i;
+
+    for (i = 0 ; i < pool->volumes.count ; i++) {
+        virStorageVolDefPtr vol = pool->volumes.objs[i];
+        struct stat sb;
+
+        if (stat(vol->target.path, &sb) == 0 &&
+            virStorageBackendFileSystemVolUnchanged(vol, &sb))
+            continue;
+
+        if (virHashUpdateEntry(changed, vol->name, NULL) < 0)
+            goto error;
+    }
+
+    if (!(names = virHashGetItems(changed, NULL)))
+        goto error;
+
+    for (i = 0 ; names[i].key ; i++) {
+        const char *name = names[i].key;
+        virStorageVolDefPtr old = virStorageVolDefFindByName(pool, name);
+        virStorageVolDefPtr vol = NULL;
+        struct stat sb;
+        char *path;
+        bool gone;
+
+        if (old &&
+            stat(old->target.path, &sb) == 0 &&
+            virStorageBackendFileSystemVolUnchanged(old, &sb)) {
+            if (old->backingStore.path)
+                virStorageBackendFileSystemUpdateBacking(old);
+            continue;
+        }
+
+        if (virAsprintf(&path, "%s/%s", pool->def->target.path, name) < 0) {
+            virReportOOMError();
+            goto error;
+        }
+        gone = lstat(path, &sb) < 0 && errno == ENOENT;
+        VIR_FREE(path);
+
+        if (!gone &&
+            virStorageBackendFileSystemProbeVol(pool, name, &vol) < 0)
+            goto error;
+
+        if (old) {
+            virStoragePoolObjRemoveVol(pool, old);
+            virStorageVolDefFree(old);
+        }
+
+        if (vol && virStoragePoolObjAddVol(pool, vol) < 0) {
+            virStorageVolDefFree(vol);
+            goto error;
+        }
+    }
+
+    VIR_FREE(names);
+    return 0;
+
+error:
+    VIR_FREE(names);
+    virStoragePoolObjClearVols(pool);
+    return -1;
+}
+#endif /* HAVE_SYS_INOTIFY_H */
+
+
+/**
+ * Bring the volumes of the pool up to date with its directory. If
+ * the pool asks for its directory to be watched, only the entries
+ * changed since the last refresh are looked at, otherwise the
+ * directory is scanned, probing only files which are new or changed.
+ */
+static int
+virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
+                                   virStoragePoolObjPtr pool)
+{
+    struct statvfs sb;
+#if HAVE_SYS_INOTIFY_H
+    virHashTablePtr changed = NULL;
+    int ret;
+
+    if (pool->volumes.privateData &&
+        virStorageBackendFSWatchTakeChanges(pool->volumes.privateData,
+                                            &changed) < 0) {
+        /* eg the directory was replaced, watch the new one */
+        (pool->volumes.privateDataFreeFunc)(pool->volumes.privateData);
+        pool->volumes.privateData = NULL;
+        pool->volumes.privateDataFreeFunc = NULL;
+    }
+
+    /* Start watching before scanning, not to miss changes */
+    if (pool->def->target.watch && !pool->volumes.privateData)
+        virStorageBackendFSWatchStart(pool);
+
+    if (changed) {
+        ret = virStorageBackendFileSystemRescan(pool, changed);
+        virHashFree(changed);
+    } else {
+        ret = virStorageBackendFileSystemScan(pool);
+    }
+    if (ret < 0)
+        return -1;
+#else
+    if (virStorageBackendFileSystemScan(pool) < 0)
+        return -1;
+#endif
+
     if (statvfs(pool->def->target.path, &sb) < 0) {
         virReportSystemError(errno,
                              _("cannot statvfs path '%s'"),
@@ -914,17 +1360,6 @@ virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
     pool->def->allocation = pool->def->capacity - pool->def->available;
 
     return 0;
-
-no_memory:
-    virReportOOMError();
-    /* fallthrough */
-
- cleanup:
-    if (dir)
-        closedir(dir);
-    virStorageVolDefFree(vol);
-    virStoragePoolObjClearVols(pool);
-    return -1;
 }
 
 
@@ -1265,6 +1700,7 @@ virStorageBackendFileSystemVolResize(virConnectPtr conn ATTRIBUTE_UNUSED,
 
 virStorageBackend virStorageBackendDirectory = {
     .type = VIR_STORAGE_POOL_DIR,
+    .incrementalRefresh = true,
 
     .buildPool = virStorageBackendFileSystemBuild,
     .checkPool = virStorageBackendFileSystemCheck,
@@ -1281,6 +1717,7 @@ virStorageBackend virStorageBackendDirectory = {
 #if WITH_STORAGE_FS
 virStorageBackend virStorageBackendFileSystem = {
     .type = VIR_STORAGE_POOL_FS,
+    .incrementalRefresh = true,
 
     .buildPool = virStorageBackendFileSystemBuild,
     .checkPool = virStorageBackendFileSystemCheck,
@@ -1297,6 +1734,7 @@ virStorageBackend virStorageBackendFileSystem = {
 };
 virStorageBackend virStorageBackendNetFileSystem = {
     .type = VIR_STORAGE_POOL_NETFS,
+    .incrementalRefresh = true,
 
     .buildPool = virStorageBackendFileSystemBuild,
     .checkPool = virStorageBackendFileSystemCheck,
@@ -103,12 +103,6 @@ virStorageBackendLogicalMakeVol(virStoragePoolObjPtr pool,
             virReportOOMError();
             goto cleanup;
         }
-
-        if (VIR_REALLOC_N(pool->volumes.objs,
-                          pool->volumes.count + 1)) {
-            virReportOOMError();
-            goto cleanup;
-        }
     }
 
     if (vol->target.path == NULL) {
@@ -260,8 +254,9 @@ virStorageBackendLogicalMakeVol(virStoragePoolObjPtr pool,
         vol->source.nextent++;
     }
 
-    if (is_new_vol)
-        pool->volumes.objs[pool->volumes.count++] = vol;
+    if (is_new_vol &&
+        virStoragePoolObjAddVol(pool, vol) < 0)
+        goto cleanup;
 
     ret = 0;
 
@@ -64,6 +64,131 @@ static void storageDriverUnlock(virStorageDriverStatePtr driver)
     virMutexUnlock(&driver->lock);
 }
 
+
+static void
+storageDriverVolIndexFree(void *payload,
+                          const void *name ATTRIBUTE_UNUSED)
+{
+    VIR_FREE(payload);
+}
+
+static int
+storageDriverVolIndexMatch(const void *payload,
+                           const void *name ATTRIBUTE_UNUSED,
+                           const void *data)
+{
+    return STREQ(payload, data);
+}
+
+static void
+storageDriverVolIndexSet(virHashTablePtr table,
+                         const char *key,
+                         const char *poolname)
+{
+    char *tmp;
+
+    /* Failing to index a volume only makes looking it up slower */
+    if (!key || !(tmp = strdup(poolname)))
+        return;
+    if (virHashUpdateEntry(table, key, tmp) < 0)
+        VIR_FREE(tmp);
+}
+
+static void
+storageDriverVolIndexUnset(virHashTablePtr table,
+                           const char *key,
+                           const char *poolname)
+{
+    const char *cur;
+
+    if (key &&
+        (cur = virHashLookup(table, key)) &&
+        STREQ(cur, poolname))
+        virHashRemoveEntry(table, key);
+}
+
+/* Record that @vol lives in the locked @pool */
+static void
+storageDriverIndexVol(virStorageDriverStatePtr driver,
+                      virStoragePoolObjPtr pool,
+                      virStorageVolDefPtr vol)
+{
+    virMutexLock(&driver->volIndexLock);
+    storageDriverVolIndexSet(driver->volKeys, vol->key, pool->def->name);
+    storageDriverVolIndexSet(driver->volPaths, vol->target.path,
+                             pool->def->name);
+    virMutexUnlock(&driver->volIndexLock);
+}
+
+static void
+storageDriverUnindexVol(virStorageDriverStatePtr driver,
+                        virStoragePoolObjPtr pool,
+                        virStorageVolDefPtr vol)
+{
+    virMutexLock(&driver->volIndexLock);
+    storageDriverVolIndexUnset(driver->volKeys, vol->key, pool->def->name);
+    storageDriverVolIndexUnset(driver->volPaths, vol->target.path,
+                               pool->def->name);
+    virMutexUnlock(&driver->volIndexLock);
+}
+
+static void
+storageDriverUnindexPool(virStorageDriverStatePtr driver,
+                         virStoragePoolObjPtr pool)
+{
+    virMutexLock(&driver->volIndexLock);
+    virHashRemoveSet(driver->volKeys, storageDriverVolIndexMatch,
+                     pool->def->name);
+    virHashRemoveSet(driver->volPaths, storageDriverVolIndexMatch,
+                     pool->def->name);
+    virMutexUnlock(&driver->volIndexLock);
+}
+
+/* Replace the entries for the locked @pool by its current volumes,
+ * after it has been refreshed */
+static void
+storageDriverIndexPool(virStorageDriverStatePtr driver,
+                       virStoragePoolObjPtr pool)
+{
+    unsigned int i;
+
+    storageDriverUnindexPool(driver, pool);
+
+    virMutexLock(&driver->volIndexLock);
+    for (i = 0 ; i < pool->volumes.count ; i++) {
+        virStorageVolDefPtr vol = pool->volumes.objs[i];
+
+        storageDriverVolIndexSet(driver->volKeys, vol->key, pool->def->name);
+        storageDriverVolIndexSet(driver->volPaths, vol->target.path,
+                                 pool->def->name);
+    }
+    virMutexUnlock(&driver->volIndexLock);
+}
+
+/* Returns the locked pool which the index in @table says holds the
+ * volume with @key, or NULL. Must be called with the driver locked */
+static virStoragePoolObjPtr
+storageDriverVolIndexFind(virStorageDriverStatePtr driver,
+                          virHashTablePtr table,
+                          const char *key)
+{
+    virStoragePoolObjPtr pool = NULL;
+    const char *cur;
+    char *poolname = NULL;
+
+    /* Copy the name, as pools must not be locked under volIndexLock */
+    virMutexLock(&driver->volIndexLock);
+    if ((cur = virHashLookup(table, key)))
+        poolname = strdup(cur);
+    virMutexUnlock(&driver->volIndexLock);
+
+    if (poolname)
+        pool = virStoragePoolObjFindByName(&driver->pools, poolname);
+
+    VIR_FREE(poolname);
+    return pool;
+}
+
 static void
 storageDriverAutostart(virStorageDriverStatePtr driver) {
     unsigned int i;
@@ -117,6 +242,7 @@ storageDriverAutostart(virStorageDriverStatePtr driver) {
                 continue;
             }
             pool->active = 1;
+            storageDriverIndexPool(driver, pool);
         }
         virStoragePoolObjUnlock(pool);
     }
@@ -141,8 +267,17 @@ storageDriverStartup(bool privileged,
         VIR_FREE(driverState);
         return -1;
     }
+    if (virMutexInit(&driverState->volIndexLock) < 0) {
+        virMutexDestroy(&driverState->lock);
+        VIR_FREE(driverState);
+        return -1;
+    }
     storageDriverLock(driverState);
 
+    if (!(driverState->volKeys = virHashCreate(256, storageDriverVolIndexFree)) ||
+        !(driverState->volPaths = virHashCreate(256, storageDriverVolIndexFree)))
+        goto error;
+
     if (privileged) {
         if ((base = strdup(SYSCONFDIR "/libvirt")) == NULL)
             goto out_of_memory;
@@ -222,7 +357,10 @@ storageDriverShutdown(void) {
 
     VIR_FREE(driverState->configDir);
     VIR_FREE(driverState->autostartDir);
+    virHashFree(driverState->volKeys);
+    virHashFree(driverState->volPaths);
     storageDriverUnlock(driverState);
+    virMutexDestroy(&driverState->volIndexLock);
     virMutexDestroy(&driverState->lock);
     VIR_FREE(driverState);
 
@@ -531,6 +669,7 @@ storagePoolCreate(virConnectPtr conn,
     }
     VIR_INFO("Creating storage pool '%s'", pool->def->name);
     pool->active = 1;
+    storageDriverIndexPool(driver, pool);
 
     ret = virGetStoragePool(conn, pool->def->name, pool->def->uuid,
                             NULL, NULL);
@@ -684,6 +823,7 @@ storagePoolStart(virStoragePoolPtr obj,
 
     VIR_INFO("Starting up storage pool '%s'", pool->def->name);
     pool->active = 1;
+    storageDriverIndexPool(driver, pool);
     ret = 0;
 
 cleanup:
@@ -768,6 +908,7 @@ storagePoolDestroy(virStoragePoolPtr obj) {
         backend->stopPool(obj->conn, pool) < 0)
         goto cleanup;
 
+    storageDriverUnindexPool(driver, pool);
     virStoragePoolObjClearVols(pool);
 
     pool->active = 0;
@@ -878,7 +1019,9 @@ storagePoolRefresh(virStoragePoolPtr obj,
         goto cleanup;
     }
 
-    virStoragePoolObjClearVols(pool);
+    storageDriverUnindexPool(driver, pool);
+    if (!backend->incrementalRefresh)
+        virStoragePoolObjClearVols(pool);
     if (backend->refreshPool(obj->conn, pool) < 0) {
         if (backend->stopPool)
             backend->stopPool(obj->conn, pool);
@@ -891,6 +1034,7 @@ storagePoolRefresh(virStoragePoolPtr obj,
         }
         goto cleanup;
     }
+    storageDriverIndexPool(driver, pool);
     ret = 0;
 
 cleanup:
@@ -1253,10 +1397,22 @@ static virStorageVolPtr
 storageVolumeLookupByKey(virConnectPtr conn,
                          const char *key) {
     virStorageDriverStatePtr driver = conn->storagePrivateData;
+    virStoragePoolObjPtr pool;
     unsigned int i;
     virStorageVolPtr ret = NULL;
 
     storageDriverLock(driver);
+    if ((pool = storageDriverVolIndexFind(driver, driver->volKeys, key))) {
+        virStorageVolDefPtr vol;
+
+        if (virStoragePoolObjIsActive(pool) &&
+            (vol = virStorageVolDefFindByKey(pool, key)))
+            ret = virGetStorageVol(conn, pool->def->name, vol->name,
+                                   vol->key, NULL, NULL);
+        virStoragePoolObjUnlock(pool);
+    }
+
+    /* Not indexed, ask every pool */
     for (i = 0 ; i < driver->pools.count && !ret ; i++) {
         virStoragePoolObjLock(driver->pools.objs[i]);
         if (virStoragePoolObjIsActive(driver->pools.objs[i])) {
@@ -1285,6 +1441,7 @@ static virStorageVolPtr
 storageVolumeLookupByPath(virConnectPtr conn,
                           const char *path) {
     virStorageDriverStatePtr driver = conn->storagePrivateData;
+    virStoragePoolObjPtr pool;
     unsigned int i;
     virStorageVolPtr ret = NULL;
     char *cleanpath;
@@ -1294,6 +1451,19 @@ storageVolumeLookupByPath(virConnectPtr conn,
         return NULL;
 
     storageDriverLock(driver);
+    if ((pool = storageDriverVolIndexFind(driver, driver->volPaths,
+                                          cleanpath))) {
+        virStorageVolDefPtr vol;
+
+        if (virStoragePoolObjIsActive(pool) &&
+            (vol = virStorageVolDefFindByPath(pool, cleanpath)))
+            ret = virGetStorageVol(conn, pool->def->name, vol->name,
+                                   vol->key, NULL, NULL);
+        virStoragePoolObjUnlock(pool);
+    }
+
+    /* Not indexed, or @path is not the stable path the volume is
+     * known by: ask every pool */
     for (i = 0 ; i < driver->pools.count && !ret ; i++) {
         virStoragePoolObjLock(driver->pools.objs[i]);
         if (virStoragePoolObjIsActive(driver->pools.objs[i])) {
@@ -1380,12 +1550,6 @@ storageVolumeCreateXML(virStoragePoolPtr obj,
         goto cleanup;
     }
 
-    if (VIR_REALLOC_N(pool->volumes.objs,
-                      pool->volumes.count+1) < 0) {
-        virReportOOMError();
-        goto cleanup;
-    }
-
     if (!backend->createVol) {
         virReportError(VIR_ERR_NO_SUPPORT,
                        "%s", _("storage pool does not support volume "
@@ -1397,13 +1561,15 @@ storageVolumeCreateXML(virStoragePoolPtr obj,
         goto cleanup;
     }
 
-    pool->volumes.objs[pool->volumes.count++] = voldef;
+    if (virStoragePoolObjAddVol(pool, voldef) < 0)
+        goto cleanup;
     volobj = virGetStorageVol(obj->conn, pool->def->name, voldef->name,
                               voldef->key, NULL, NULL);
     if (!volobj) {
-        pool->volumes.count--;
+        virStoragePoolObjRemoveVol(pool, voldef);
         goto cleanup;
     }
+    storageDriverIndexVol(driver, pool, voldef);
 
     if (backend->buildVol) {
         int buildret;
@@ -1558,18 +1724,14 @@ storageVolumeCreateXMLFrom(virStoragePoolPtr obj,
         backend->refreshVol(obj->conn, pool, origvol) < 0)
         goto cleanup;
 
-    if (VIR_REALLOC_N(pool->volumes.objs,
-                      pool->volumes.count+1) < 0) {
-        virReportOOMError();
-        goto cleanup;
-    }
-
     /* 'Define' the new volume so we get async progress reporting */
     if (backend->createVol(obj->conn, pool, newvol) < 0) {
         goto cleanup;
     }
 
-    pool->volumes.objs[pool->volumes.count++] = newvol;
+    if (virStoragePoolObjAddVol(pool, newvol) < 0)
+        goto cleanup;
+    storageDriverIndexVol(driver, pool, newvol);
     volobj = virGetStorageVol(obj->conn, pool->def->name, newvol->name,
                               newvol->key, NULL, NULL);
 
@@ -2124,7 +2286,6 @@ storageVolumeDelete(virStorageVolPtr obj,
     virStoragePoolObjPtr pool;
     virStorageBackendPtr backend;
     virStorageVolDefPtr vol = NULL;
-    unsigned int i;
     int ret = -1;
 
     storageDriverLock(driver);
@@ -2173,25 +2334,11 @@ storageVolumeDelete(virStorageVolPtr obj,
     if (backend->deleteVol(obj->conn, pool, vol, flags) < 0)
         goto cleanup;
 
-    for (i = 0 ; i < pool->volumes.count ; i++) {
-        if (pool->volumes.objs[i] == vol) {
-            VIR_INFO("Deleting volume '%s' from storage pool '%s'",
-                     vol->name, pool->def->name);
-            virStorageVolDefFree(vol);
-            vol = NULL;
-
-            if (i < (pool->volumes.count - 1))
-                memmove(pool->volumes.objs + i, pool->volumes.objs + i + 1,
-                        sizeof(*(pool->volumes.objs)) * (pool->volumes.count - (i + 1)));
-
-            if (VIR_REALLOC_N(pool->volumes.objs, pool->volumes.count - 1) < 0) {
-                ; /* Failure to reduce memory allocation isn't fatal */
-            }
-            pool->volumes.count--;
-
-            break;
-        }
-    }
+    VIR_INFO("Deleting volume '%s' from storage pool '%s'",
+             vol->name, pool->def->name);
+    storageDriverUnindexVol(driver, pool, vol);
+    virStoragePoolObjRemoveVol(pool, vol);
+    virStorageVolDefFree(vol);
     ret = 0;
 
 cleanup:
@@ -72,6 +72,50 @@ cleanup:
     return fd;
 }
 
+#if HAVE_SPLICE
+/*
+ * Move the data from @fdin to @fdout without copying it through
+ * user space, which works as long as one of them is a pipe.
+ *
+ * Returns 0 on success, 1 if nothing was moved because splicing
+ * isn't possible here, -1 on error
+ */
+static int
+runIOSplice(int fdin, const char *fdinname,
+            int fdout, const char *fdoutname,
+            unsigned long long length,
+            unsigned long long *total)
+{
+    size_t chunk = 1024*1024;
+
+    while (1) {
+        ssize_t got;
+
+        if (length &&
+            (length - *total) < chunk)
+            chunk = length - *total;
+
+        if (chunk == 0)
+            return 0; /* End of requested data from client */
+
+        if ((got = splice(fdin, NULL, fdout, NULL, chunk,
+                          SPLICE_F_MOVE | SPLICE_F_MORE)) < 0) {
+            if (errno == EINTR)
+                continue;
+            if (*total == 0 && (errno == EINVAL || errno == ENOSYS))
+                return 1;
+            virReportSystemError(errno, _("Unable to splice %s to %s"),
+                                 fdinname, fdoutname);
+            return -1;
+        }
+        if (got == 0)
+            return 0; /* End of file before end of requested data */
+
+        *total += got;
+    }
+}
+#endif
+
 static int
 runIO(const char *path, int fd, int oflags, unsigned long long length)
 {
@@ -138,6 +182,19 @@ runIO(const char *path, int fd, int oflags, unsigned long long length)
         goto cleanup;
     }
 
+#if HAVE_SPLICE
+    /* The other end is normally a pipe to the stream, so unless
+     * O_DIRECT needs the data aligned, don't bother copying it */
+    if (!direct) {
+        int rc = runIOSplice(fdin, fdinname, fdout, fdoutname,
+                             length, &total);
+        if (rc < 0)
+            goto cleanup;
+        if (rc == 0)
+            goto done;
+    }
+#endif
+
     while (1) {
         ssize_t got;
 
@@ -179,6 +236,9 @@ runIO(const char *path, int fd, int oflags, unsigned long long length)
         }
     }
 
+#if HAVE_SPLICE
+done:
+#endif
     /* Ensure all data is written */
     if (fdatasync(fdout) < 0) {
         if (errno != EINVAL && errno != EROFS) {
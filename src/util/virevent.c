@@ -25,11 +25,14 @@
 
 #include "virevent.h"
 #include "vireventpoll.h"
+#include "vireventepoll.h"
 #include "virlog.h"
 #include "virerror.h"
 
 #include <stdlib.h>
 
+#define VIR_FROM_THIS VIR_FROM_EVENT
+
 static virEventAddHandleFunc addHandleImpl = NULL;
 static virEventUpdateHandleFunc updateHandleImpl = NULL;
 static virEventRemoveHandleFunc removeHandleImpl = NULL;
@@ -37,6 +40,14 @@ static virEventAddTimeoutFunc addTimeoutImpl = NULL;
 static virEventUpdateTimeoutFunc updateTimeoutImpl = NULL;
 static virEventRemoveTimeoutFunc removeTimeoutImpl = NULL;
 
+VIR_ENUM_IMPL(virEventImpl, VIR_EVENT_IMPL_LAST,
+              "poll",
+              "epoll")
+
+/* Implementation used by virEventRegisterDefaultImpl, -1 if
+ * not yet chosen */
+static int defaultImplType = -1;
+
 /**
  * virEventAddHandle: register a callback for monitoring file handle events
  *
@@ -184,6 +195,57 @@ void virEventRegisterImpl(virEventAddHandleFunc addHandle,
     removeTimeoutImpl = removeTimeout;
 }
 
+/**
+ * virEventSetDefaultImplType:
+ * @type: the virEventImplType to use
+ *
+ * Choose which implementation is installed by a subsequent call
+ * to virEventRegisterDefaultImpl. This must be done before the
+ * default implementation is registered.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int virEventSetDefaultImplType(int type)
+{
+    if (type < 0 || type >= VIR_EVENT_IMPL_LAST) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("unknown event loop implementation %d"), type);
+        return -1;
+    }
+
+    VIR_DEBUG("default event implementation set to %s",
+              virEventImplTypeToString(type));
+    defaultImplType = type;
+    return 0;
+}
+
+/*
+ * Work out which implementation to use if the application
+ * did not explicitly choose one. This honours the
+ * LIBVIRT_EVENT_IMPL environment variable, falling back to
+ * poll() if it is unset or invalid.
+ */
+static int virEventGetDefaultImplType(void)
+{
+    const char *env;
+    int type;
+
+    if (defaultImplType >= 0)
+        return defaultImplType;
+
+    if ((env = getenv("LIBVIRT_EVENT_IMPL")) && *env) {
+        if ((type = virEventImplTypeFromString(env)) < 0)
+            VIR_WARN("Ignoring unknown event loop implementation '%s'", env);
+        else
+            defaultImplType = type;
+    }
+
+    if (defaultImplType < 0)
+        defaultImplType = VIR_EVENT_IMPL_POLL;
+
+    return defaultImplType;
+}
+
 /**
  * virEventRegisterDefaultImpl:
  *
@@ -191,7 +253,10 @@ void virEventRegisterImpl(virEventAddHandleFunc addHandle,
  * poll() system call. This is a generic implementation
  * that can be used by any client application which does
  * not have a need to integrate with an external event
- * loop impl.
+ * loop impl. On Linux, an implementation based on epoll,
+ * which scales better to large numbers of file handles,
+ * can be chosen instead by setting the LIBVIRT_EVENT_IMPL
+ * environment variable to "epoll".
  *
  * Once registered, the application has to invoke virEventRunDefaultImpl in
  * a loop to process events.  Failure to do so may result in connections being
@@ -201,23 +266,48 @@ void virEventRegisterImpl(virEventAddHandleFunc addHandle,
  */
 int virEventRegisterDefaultImpl(void)
 {
-    VIR_DEBUG("registering default event implementation");
+    int type;
 
     virResetLastError();
 
-    if (virEventPollInit() < 0) {
-        virDispatchError(NULL);
-        return -1;
-    }
+    type = virEventGetDefaultImplType();
+    VIR_DEBUG("registering default event implementation %s",
+              virEventImplTypeToString(type));
+
+    switch ((virEventImplType) type) {
+    case VIR_EVENT_IMPL_EPOLL:
+        if (virEventEpollInit() < 0) {
+            virDispatchError(NULL);
+            return -1;
+        }
 
-    virEventRegisterImpl(
-        virEventPollAddHandle,
-        virEventPollUpdateHandle,
-        virEventPollRemoveHandle,
-        virEventPollAddTimeout,
-        virEventPollUpdateTimeout,
-        virEventPollRemoveTimeout
-        );
+        virEventRegisterImpl(
+            virEventEpollAddHandle,
+            virEventEpollUpdateHandle,
+            virEventEpollRemoveHandle,
+            virEventEpollAddTimeout,
+            virEventEpollUpdateTimeout,
+            virEventEpollRemoveTimeout
+            );
+        break;
+
+    case VIR_EVENT_IMPL_POLL:
+    case VIR_EVENT_IMPL_LAST:
+        if (virEventPollInit() < 0) {
+            virDispatchError(NULL);
+            return -1;
+        }
+
+        virEventRegisterImpl(
+            virEventPollAddHandle,
+            virEventPollUpdateHandle,
+            virEventPollRemoveHandle,
+            virEventPollAddTimeout,
+            virEventPollUpdateTimeout,
+            virEventPollRemoveTimeout
+            );
+        break;
+    }
 
     return 0;
 }
@@ -244,9 +334,16 @@ int virEventRunDefaultImpl(void)
     VIR_DEBUG("running default event implementation");
     virResetLastError();
 
-    if (virEventPollRunOnce() < 0) {
-        virDispatchError(NULL);
-        return -1;
+    if (defaultImplType == VIR_EVENT_IMPL_EPOLL) {
+        if (virEventEpollRunOnce() < 0) {
+            virDispatchError(NULL);
+            return -1;
+        }
+    } else {
+        if (virEventPollRunOnce() < 0) {
+            virDispatchError(NULL);
+            return -1;
+        }
     }
 
     return 0;
@@ -24,5 +24,17 @@
 #ifndef __VIR_EVENT_H__
 # define __VIR_EVENT_H__
 # include "internal.h"
+# include "virutil.h"
+
+typedef enum {
+    VIR_EVENT_IMPL_POLL,  /* poll() based loop, see vireventpoll.h */
+    VIR_EVENT_IMPL_EPOLL, /* epoll based loop, see vireventepoll.h */
+
+    VIR_EVENT_IMPL_LAST
+} virEventImplType;
+
+VIR_ENUM_DECL(virEventImpl)
+
+int virEventSetDefaultImplType(int type);
 
 #endif /* __VIR_EVENT_H__ */
@@ -0,0 +1,1404 @@
+/*
+ * vireventepoll.c: epoll based event loop for monitoring file handles
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
+
+#include "virthread.h"
+#include "virlog.h"
+#include "vireventepoll.h"
+#include "virevent.h"
+#include "viralloc.h"
+#include "virutil.h"
+#include "virfile.h"
+#include "virerror.h"
+#include "virhash.h"
+#include "virhashcode.h"
+#include "virtime.h"
+
+#define VIR_FROM_THIS VIR_FROM_EVENT
+
+#ifdef HAVE_SYS_EPOLL_H
+
+# define EVENT_DEBUG(fmt, ...) VIR_DEBUG(fmt, __VA_ARGS__)
+
+/* Maximum number of ready file descriptors fetched by a
+ * single epoll_wait() call. Since descriptors are level
+ * triggered, any others will be reported next time round */
+# define EVENT_EPOLL_MAX_EVENTS 64
+
+/* Watch, timer and fd numbers used as hash keys. The +1
+ * avoids using a NULL pointer for fd 0 */
+# define EVENT_EPOLL_KEY(n) ((void *)(intptr_t)((n) + 1))
+
+static int virEventEpollInterruptLocked(virEventEpollLoopPtr loop);
+
+typedef struct _virEventEpollHandle virEventEpollHandle;
+typedef virEventEpollHandle *virEventEpollHandlePtr;
+
+typedef struct _virEventEpollFD virEventEpollFD;
+typedef virEventEpollFD *virEventEpollFDPtr;
+
+typedef struct _virEventEpollTimeout virEventEpollTimeout;
+typedef virEventEpollTimeout *virEventEpollTimeoutPtr;
+
+/* State for a single file handle being monitored */
+struct _virEventEpollHandle {
+    int watch;
+    int fd;
+    int events;     /* Native EPOLL* event mask */
+    virEventHandleCallback cb;
+    virFreeCallback ff;
+    void *opaque;
+    bool deleted;
+
+    virEventEpollHandlePtr next; /* In the list of deleted handles */
+};
+
+/* The kernel only lets a file descriptor be added to an epoll
+ * set once, so all handles watching the same descriptor are
+ * grouped together and their event masks merged */
+struct _virEventEpollFD {
+    int fd;
+    int events;         /* Event mask currently given to the kernel */
+    bool registered;    /* Whether fd is in the epoll set */
+    bool alwaysReady;   /* epoll refused fd, eg a plain file */
+
+    size_t nhandles;
+    virEventEpollHandlePtr *handles;
+};
+
+/* State for a single timer being generated */
+struct _virEventEpollTimeout {
+    int timer;
+    int frequency;
+    unsigned long long expiresAt;
+    virEventTimeoutCallback cb;
+    virFreeCallback ff;
+    void *opaque;
+    bool deleted;
+
+    ssize_t heapIndex;  /* Position in the timer heap, -1 if disabled */
+    virEventEpollTimeoutPtr next; /* In the list of deleted timers */
+};
+
+/* State for an event loop */
+struct _virEventEpollLoop {
+    virMutex lock;
+    int running;
+    virThread leader;
+    int wakeupfd[2];
+    int epollfd;
+
+    /* Unique IDs for the next FD watch and timer to be registered */
+    int nextWatch;
+    int nextTimer;
+
+    virHashTablePtr handles;    /* watch -> virEventEpollHandlePtr */
+    virHashTablePtr fds;        /* fd -> virEventEpollFDPtr */
+    virHashTablePtr timeouts;   /* timer -> virEventEpollTimeoutPtr */
+
+    /* Descriptors which cannot be monitored by epoll. Like
+     * poll(), we treat them as permanently ready */
+    size_t nalwaysReady;
+    virEventEpollFDPtr *alwaysReady;
+
+    /* Binary min-heap of enabled timers, ordered by expiry.
+     * Space is reserved for every registered timer, so that
+     * enabling a timer never needs to allocate memory */
+    size_t ntimeouts;
+    size_t heapCount;
+    size_t heapAlloc;
+    virEventEpollTimeoutPtr *heap;
+
+    /* Removed entries whose free callbacks are still to be run */
+    virEventEpollHandlePtr deletedHandles;
+    virEventEpollTimeoutPtr deletedTimeouts;
+};
+
+/* The loop behind the virEventEpoll* functions. Further loops
+ * can be created with virEventEpollLoopNew */
+static virEventEpollLoop eventLoop = {
+    .epollfd = -1,
+    .wakeupfd = { -1, -1 },
+    .nextWatch = 1,
+    .nextTimer = 1,
+};
+
+
+static uint32_t virEventEpollKeyCode(const void *name, uint32_t seed)
+{
+    unsigned long value = (unsigned long)(intptr_t)name;
+    return virHashCodeGen(&value, sizeof(value), seed);
+}
+static bool virEventEpollKeyEqual(const void *namea, const void *nameb)
+{
+    return namea == nameb;
+}
+static void *virEventEpollKeyCopy(const void *name)
+{
+    return (void *)name;
+}
+
+static virHashTablePtr virEventEpollHashCreate(void)
+{
+    return virHashCreateFull(64, NULL,
+                             virEventEpollKeyCode,
+                             virEventEpollKeyEqual,
+                             virEventEpollKeyCopy,
+                             NULL);
+}
+
+
+static int
+virEventEpollToNativeEvents(int events)
+{
+    int ret = 0;
+    if (events & VIR_EVENT_HANDLE_READABLE)
+        ret |= EPOLLIN;
+    if (events & VIR_EVENT_HANDLE_WRITABLE)
+        ret |= EPOLLOUT;
+    if (events & VIR_EVENT_HANDLE_ERROR)
+        ret |= EPOLLERR;
+    if (events & VIR_EVENT_HANDLE_HANGUP)
+        ret |= EPOLLHUP;
+    return ret;
+}
+
+static int
+virEventEpollFromNativeEvents(int events)
+{
+    int ret = 0;
+    if (events & EPOLLIN)
+        ret |= VIR_EVENT_HANDLE_READABLE;
+    if (events & EPOLLOUT)
+        ret |= VIR_EVENT_HANDLE_WRITABLE;
+    if (events & EPOLLERR)
+        ret |= VIR_EVENT_HANDLE_ERROR;
+    if (events & EPOLLHUP)
+        ret |= VIR_EVENT_HANDLE_HANGUP;
+    return ret;
+}
+
+
+/*
+ * Push the merged event mask of all handles on @rec to the
+ * kernel. Unless @force is set, the epoll set is only touched
+ * if the mask actually changed. Forcing is used when a new
+ * handle is added, since the descriptor number may have been
+ * reused for a different file since it was last registered.
+ *
+ * Returns 0 on success, -1 on error
+ */
+static int
+virEventEpollUpdateFD(virEventEpollLoopPtr loop,
+                      virEventEpollFDPtr rec,
+                      bool force)
+{
+    struct epoll_event ev;
+    int events = 0;
+    int op;
+    int rc;
+    size_t i;
+
+    for (i = 0 ; i < rec->nhandles ; i++)
+        events |= rec->handles[i]->events;
+
+    if (rec->alwaysReady) {
+        rec->events = events;
+        return 0;
+    }
+
+    if (!force &&
+        rec->events == events &&
+        rec->registered == !!events)
+        return 0;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = rec->fd;
+
+    /* A descriptor nobody is interested in must be taken out of
+     * the set entirely, since epoll always reports errors and
+     * hangups, which poll() would not for an unused fd */
+    if (!events) {
+        if (rec->registered &&
+            epoll_ctl(loop->epollfd, EPOLL_CTL_DEL, rec->fd, &ev) < 0)
+            EVENT_DEBUG("Unable to remove fd %d from epoll set: %d",
+                        rec->fd, errno);
+        rec->registered = false;
+        rec->events = 0;
+        return 0;
+    }
+
+    op = rec->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    rc = epoll_ctl(loop->epollfd, op, rec->fd, &ev);
+    if (rc < 0 && op == EPOLL_CTL_MOD && errno == ENOENT)
+        rc = epoll_ctl(loop->epollfd, EPOLL_CTL_ADD, rec->fd, &ev);
+    else if (rc < 0 && op == EPOLL_CTL_ADD && errno == EEXIST)
+        rc = epoll_ctl(loop->epollfd, EPOLL_CTL_MOD, rec->fd, &ev);
+
+    if (rc < 0) {
+        if (errno == EPERM) {
+            EVENT_DEBUG("fd %d does not support epoll, treating as ready",
+                        rec->fd);
+            if (VIR_APPEND_ELEMENT_COPY(loop->alwaysReady,
+                                        loop->nalwaysReady, rec) < 0) {
+                virReportOOMError();
+                return -1;
+            }
+            rec->alwaysReady = true;
+            rec->registered = false;
+            rec->events = events;
+            return 0;
+        }
+        virReportSystemError(errno,
+                             _("Unable to watch file handle %d"),
+                             rec->fd);
+        return -1;
+    }
+
+    rec->registered = true;
+    rec->events = events;
+    return 0;
+}
+
+
+/*
+ * Detach @handle from the record for its file descriptor,
+ * releasing the record once no handles remain on it.
+ */
+static void
+virEventEpollDetachHandle(virEventEpollLoopPtr loop,
+                          virEventEpollHandlePtr handle)
+{
+    virEventEpollFDPtr rec;
+    size_t i;
+
+    if (!(rec = virHashLookup(loop->fds, EVENT_EPOLL_KEY(handle->fd))))
+        return;
+
+    for (i = 0 ; i < rec->nhandles ; i++) {
+        if (rec->handles[i] == handle) {
+            VIR_DELETE_ELEMENT(rec->handles, i, rec->nhandles);
+            break;
+        }
+    }
+
+    ignore_value(virEventEpollUpdateFD(loop, rec, false));
+
+    if (rec->nhandles)
+        return;
+
+    if (rec->alwaysReady) {
+        for (i = 0 ; i < loop->nalwaysReady ; i++) {
+            if (loop->alwaysReady[i] == rec) {
+                VIR_DELETE_ELEMENT(loop->alwaysReady, i,
+                                   loop->nalwaysReady);
+                break;
+            }
+        }
+    }
+
+    virHashRemoveEntry(loop->fds, EVENT_EPOLL_KEY(rec->fd));
+    VIR_FREE(rec);
+}
+
+
+/*
+ * Register a callback for monitoring file handle events.
+ * NB, it *must* be safe to call this from within a callback.
+ * Handles added by a callback are not dispatched until the
+ * next iteration of the loop.
+ */
+int virEventEpollLoopAddHandle(virEventEpollLoopPtr loop,
+                               int fd, int events,
+                               virEventHandleCallback cb,
+                               void *opaque,
+                               virFreeCallback ff)
+{
+    virEventEpollHandlePtr handle = NULL;
+    virEventEpollFDPtr rec;
+    bool newrec = false;
+    int watch = -1;
+
+    if (!loop)
+        return virEventAddHandle(fd, events, cb, opaque, ff);
+
+    virMutexLock(&loop->lock);
+
+    if (VIR_ALLOC(handle) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    handle->watch = loop->nextWatch;
+    handle->fd = fd;
+    handle->events = virEventEpollToNativeEvents(events);
+    handle->cb = cb;
+    handle->ff = ff;
+    handle->opaque = opaque;
+
+    if (!(rec = virHashLookup(loop->fds, EVENT_EPOLL_KEY(fd)))) {
+        if (VIR_ALLOC(rec) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+        rec->fd = fd;
+        if (virHashAddEntry(loop->fds, EVENT_EPOLL_KEY(fd), rec) < 0) {
+            VIR_FREE(rec);
+            goto cleanup;
+        }
+        newrec = true;
+    }
+
+    if (VIR_APPEND_ELEMENT_COPY(rec->handles, rec->nhandles, handle) < 0) {
+        virReportOOMError();
+        goto error;
+    }
+
+    if (virEventEpollUpdateFD(loop, rec, true) < 0) {
+        rec->nhandles--;
+        goto error;
+    }
+
+    if (virHashAddEntry(loop->handles,
+                        EVENT_EPOLL_KEY(handle->watch), handle) < 0) {
+        virEventEpollDetachHandle(loop, handle);
+        VIR_FREE(handle);
+        goto cleanup;
+    }
+
+    watch = loop->nextWatch++;
+
+    /* Changes to the epoll set take effect immediately, even
+     * while another thread is in epoll_wait(), so a wakeup is
+     * only required for descriptors we emulate */
+    if (rec->alwaysReady)
+        virEventEpollInterruptLocked(loop);
+
+    PROBE(EVENT_EPOLL_ADD_HANDLE,
+          "watch=%d fd=%d events=%d cb=%p opaque=%p ff=%p",
+          watch, fd, events, cb, opaque, ff);
+
+cleanup:
+    if (watch < 0)
+        VIR_FREE(handle);
+    virMutexUnlock(&loop->lock);
+    return watch;
+
+error:
+    if (newrec) {
+        virHashRemoveEntry(loop->fds, EVENT_EPOLL_KEY(fd));
+        VIR_FREE(rec->handles);
+        VIR_FREE(rec);
+    }
+    goto cleanup;
+}
+
+void virEventEpollLoopUpdateHandle(virEventEpollLoopPtr loop,
+                                   int watch, int events)
+{
+    virEventEpollHandlePtr handle;
+    virEventEpollFDPtr rec;
+
+    if (!loop) {
+        virEventUpdateHandle(watch, events);
+        return;
+    }
+
+    PROBE(EVENT_EPOLL_UPDATE_HANDLE,
+          "watch=%d events=%d",
+          watch, events);
+
+    if (watch <= 0) {
+        VIR_WARN("Ignoring invalid update watch %d", watch);
+        return;
+    }
+
+    virMutexLock(&loop->lock);
+    if (!(handle = virHashLookup(loop->handles, EVENT_EPOLL_KEY(watch)))) {
+        virMutexUnlock(&loop->lock);
+        VIR_WARN("Got update for non-existent handle watch %d", watch);
+        return;
+    }
+
+    handle->events = virEventEpollToNativeEvents(events);
+    if ((rec = virHashLookup(loop->fds, EVENT_EPOLL_KEY(handle->fd)))) {
+        if (virEventEpollUpdateFD(loop, rec, false) < 0)
+            VIR_WARN("Unable to update events for watch %d", watch);
+        if (rec->alwaysReady)
+            virEventEpollInterruptLocked(loop);
+    }
+    virMutexUnlock(&loop->lock);
+}
+
+/*
+ * Unregister a callback from a file handle
+ * NB, it *must* be safe to call this from within a callback
+ * The descriptor is taken out of the epoll set immediately,
+ * but the free callback is run out-of-band
+ */
+int virEventEpollLoopRemoveHandle(virEventEpollLoopPtr loop, int watch)
+{
+    virEventEpollHandlePtr handle;
+
+    if (!loop)
+        return virEventRemoveHandle(watch);
+
+    PROBE(EVENT_EPOLL_REMOVE_HANDLE,
+          "watch=%d",
+          watch);
+
+    if (watch <= 0) {
+        VIR_WARN("Ignoring invalid remove watch %d", watch);
+        return -1;
+    }
+
+    virMutexLock(&loop->lock);
+    if (!(handle = virHashSteal(loop->handles, EVENT_EPOLL_KEY(watch)))) {
+        virMutexUnlock(&loop->lock);
+        return -1;
+    }
+
+    EVENT_DEBUG("mark delete %d %d", watch, handle->fd);
+    handle->deleted = true;
+    virEventEpollDetachHandle(loop, handle);
+
+    handle->next = loop->deletedHandles;
+    loop->deletedHandles = handle;
+
+    virEventEpollInterruptLocked(loop);
+    virMutexUnlock(&loop->lock);
+    return 0;
+}
+
+
+static void
+virEventEpollHeapSwap(virEventEpollLoopPtr loop, size_t a, size_t b)
+{
+    virEventEpollTimeoutPtr tmp = loop->heap[a];
+    loop->heap[a] = loop->heap[b];
+    loop->heap[b] = tmp;
+    loop->heap[a]->heapIndex = a;
+    loop->heap[b]->heapIndex = b;
+}
+
+static void
+virEventEpollHeapSiftUp(virEventEpollLoopPtr loop, size_t i)
+{
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (loop->heap[parent]->expiresAt <= loop->heap[i]->expiresAt)
+            break;
+        virEventEpollHeapSwap(loop, i, parent);
+        i = parent;
+    }
+}
+
+static void
+virEventEpollHeapSiftDown(virEventEpollLoopPtr loop, size_t i)
+{
+    for (;;) {
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        size_t smallest = i;
+
+        if (left < loop->heapCount &&
+            loop->heap[left]->expiresAt < loop->heap[smallest]->expiresAt)
+            smallest = left;
+        if (right < loop->heapCount &&
+            loop->heap[right]->expiresAt < loop->heap[smallest]->expiresAt)
+            smallest = right;
+        if (smallest == i)
+            break;
+        virEventEpollHeapSwap(loop, i, smallest);
+        i = smallest;
+    }
+}
+
+static void
+virEventEpollHeapRemove(virEventEpollLoopPtr loop,
+                        virEventEpollTimeoutPtr timeout)
+{
+    size_t i = timeout->heapIndex;
+
+    if (timeout->heapIndex < 0)
+        return;
+
+    timeout->heapIndex = -1;
+    loop->heapCount--;
+    if (i == loop->heapCount)
+        return;
+
+    loop->heap[i] = loop->heap[loop->heapCount];
+    loop->heap[i]->heapIndex = i;
+    virEventEpollHeapSiftUp(loop, i);
+    virEventEpollHeapSiftDown(loop, loop->heap[i]->heapIndex);
+}
+
+/*
+ * (Re-)arm @timeout to fire @frequency ms after @now, or
+ * disarm it if the frequency is negative.
+ */
+static void
+virEventEpollScheduleTimeout(virEventEpollLoopPtr loop,
+                             virEventEpollTimeoutPtr timeout,
+                             unsigned long long now)
+{
+    if (timeout->frequency < 0) {
+        virEventEpollHeapRemove(loop, timeout);
+        timeout->expiresAt = 0;
+        return;
+    }
+
+    timeout->expiresAt = now + timeout->frequency;
+    if (timeout->heapIndex < 0) {
+        /* Space was reserved in virEventEpollAddTimeout */
+        timeout->heapIndex = loop->heapCount;
+        loop->heap[loop->heapCount++] = timeout;
+        virEventEpollHeapSiftUp(loop, timeout->heapIndex);
+    } else {
+        virEventEpollHeapSiftUp(loop, timeout->heapIndex);
+        virEventEpollHeapSiftDown(loop, timeout->heapIndex);
+    }
+}
+
+
+/*
+ * Register a callback for a timer event
+ * NB, it *must* be safe to call this from within a callback
+ * Timers added by a callback are not dispatched until the
+ * next iteration of the loop.
+ */
+int virEventEpollLoopAddTimeout(virEventEpollLoopPtr loop,
+                                int frequency,
+                                virEventTimeoutCallback cb,
+                                void *opaque,
+                                virFreeCallback ff)
+{
+    virEventEpollTimeoutPtr timeout;
+    unsigned long long now;
+    int ret = -1;
+
+    if (!loop)
+        return virEventAddTimeout(frequency, cb, opaque, ff);
+
+    if (virTimeMillisNow(&now) < 0)
+        return -1;
+
+    virMutexLock(&loop->lock);
+    if (VIR_RESIZE_N(loop->heap, loop->heapAlloc,
+                     loop->ntimeouts, 1) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    if (VIR_ALLOC(timeout) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    timeout->timer = loop->nextTimer;
+    timeout->frequency = frequency;
+    timeout->cb = cb;
+    timeout->ff = ff;
+    timeout->opaque = opaque;
+    timeout->heapIndex = -1;
+
+    if (virHashAddEntry(loop->timeouts,
+                        EVENT_EPOLL_KEY(timeout->timer), timeout) < 0) {
+        VIR_FREE(timeout);
+        goto cleanup;
+    }
+
+    loop->ntimeouts++;
+    virEventEpollScheduleTimeout(loop, timeout, now);
+    ret = loop->nextTimer++;
+    virEventEpollInterruptLocked(loop);
+
+    PROBE(EVENT_EPOLL_ADD_TIMEOUT,
+          "timer=%d frequency=%d cb=%p opaque=%p ff=%p",
+          ret, frequency, cb, opaque, ff);
+
+cleanup:
+    virMutexUnlock(&loop->lock);
+    return ret;
+}
+
+void virEventEpollLoopUpdateTimeout(virEventEpollLoopPtr loop,
+                                    int timer, int frequency)
+{
+    virEventEpollTimeoutPtr timeout;
+    unsigned long long now;
+
+    if (!loop) {
+        virEventUpdateTimeout(timer, frequency);
+        return;
+    }
+
+    PROBE(EVENT_EPOLL_UPDATE_TIMEOUT,
+          "timer=%d frequency=%d",
+          timer, frequency);
+
+    if (timer <= 0) {
+        VIR_WARN("Ignoring invalid update timer %d", timer);
+        return;
+    }
+
+    if (virTimeMillisNow(&now) < 0)
+        return;
+
+    virMutexLock(&loop->lock);
+    if (!(timeout = virHashLookup(loop->timeouts, EVENT_EPOLL_KEY(timer)))) {
+        virMutexUnlock(&loop->lock);
+        VIR_WARN("Got update for non-existent timer %d", timer);
+        return;
+    }
+
+    timeout->frequency = frequency;
+    virEventEpollScheduleTimeout(loop, timeout, now);
+    VIR_DEBUG("Set timer freq=%d expires=%llu", frequency,
+              timeout->expiresAt);
+    virEventEpollInterruptLocked(loop);
+    virMutexUnlock(&loop->lock);
+}
+
+/*
+ * Unregister a callback for a timer
+ * NB, it *must* be safe to call this from within a callback
+ * The timer is disarmed immediately, but the free callback
+ * is run out-of-band
+ */
+int virEventEpollLoopRemoveTimeout(virEventEpollLoopPtr loop, int timer)
+{
+    virEventEpollTimeoutPtr timeout;
+
+    if (!loop)
+        return virEventRemoveTimeout(timer);
+
+    PROBE(EVENT_EPOLL_REMOVE_TIMEOUT,
+          "timer=%d",
+          timer);
+
+    if (timer <= 0) {
+        VIR_WARN("Ignoring invalid remove timer %d", timer);
+        return -1;
+    }
+
+    virMutexLock(&loop->lock);
+    if (!(timeout = virHashSteal(loop->timeouts, EVENT_EPOLL_KEY(timer)))) {
+        virMutexUnlock(&loop->lock);
+        return -1;
+    }
+
+    timeout->deleted = true;
+    virEventEpollHeapRemove(loop, timeout);
+    loop->ntimeouts--;
+
+    timeout->next = loop->deletedTimeouts;
+    loop->deletedTimeouts = timeout;
+
+    virEventEpollInterruptLocked(loop);
+    virMutexUnlock(&loop->lock);
+    return 0;
+}
+
+
+/* Determine how long to wait for file handle events, given
+ * the soonest timer at the top of the heap.
+ * @timeout: filled with expiry time of soonest timer, or -1 if
+ *           no timeout is pending
+ * returns: 0 on success, -1 on error
+ */
+static int virEventEpollCalculateTimeout(virEventEpollLoopPtr loop,
+                                         int *timeout)
+{
+    unsigned long long then;
+    unsigned long long now;
+    size_t i;
+
+    /* Emulated descriptors are always ready, but only matter
+     * while somebody is actually waiting for them */
+    for (i = 0 ; i < loop->nalwaysReady ; i++) {
+        if (loop->alwaysReady[i]->events & (EPOLLIN | EPOLLOUT)) {
+            *timeout = 0;
+            return 0;
+        }
+    }
+
+    if (!loop->heapCount) {
+        *timeout = -1;
+        return 0;
+    }
+
+    if (virTimeMillisNow(&now) < 0)
+        return -1;
+
+    then = loop->heap[0]->expiresAt;
+    EVENT_DEBUG("Schedule timeout then=%llu now=%llu", then, now);
+    if (then <= now)
+        *timeout = 0;
+    else if (then - now > INT_MAX)
+        *timeout = INT_MAX;
+    else
+        *timeout = then - now;
+
+    EVENT_DEBUG("Timeout at %llu due in %d ms", then, *timeout);
+    return 0;
+}
+
+
+static int
+virEventEpollCompareTimer(const void *a, const void *b)
+{
+    int ta = *(const int *)a;
+    int tb = *(const int *)b;
+
+    return ta < tb ? -1 : ta > tb;
+}
+
+/*
+ * Invoke the user supplied callback for each timer whose
+ * expiry time is met, and schedule the next timeout. Does
+ * not try to 'catch up' on time if the actual expiry time
+ * was later than the requested time.
+ *
+ * Only the expired part of the heap is visited. Timers are
+ * dispatched in order of registration, like the poll() based
+ * implementation does, and each one is looked up again before
+ * dispatch since earlier callbacks may have removed or
+ * rescheduled it.
+ *
+ * Returns 0 upon success, -1 if an error occurred
+ */
+static int virEventEpollDispatchTimeouts(virEventEpollLoopPtr loop)
+{
+    unsigned long long now;
+    unsigned long long threshold;
+    size_t *idx = NULL;
+    int *timers = NULL;
+    size_t nexpired = 0;
+    size_t i;
+    int ret = -1;
+
+    if (virTimeMillisNow(&now) < 0)
+        return -1;
+
+    /* Add 20ms fuzz so we don't pointlessly spin doing
+     * <10ms sleeps, particularly on kernels with low HZ
+     * it is fine that a timer expires 20ms earlier than
+     * requested
+     */
+    threshold = now + 20;
+
+    if (!loop->heapCount ||
+        loop->heap[0]->expiresAt > threshold)
+        return 0;
+
+    if (VIR_ALLOC_N(idx, loop->heapCount) < 0 ||
+        VIR_ALLOC_N(timers, loop->heapCount) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    /* The expired timers form a subtree rooted at the top of
+     * the heap, so walk it breadth first, using idx as queue */
+    idx[nexpired++] = 0;
+    for (i = 0 ; i < nexpired ; i++) {
+        size_t child = 2 * idx[i] + 1;
+        if (child < loop->heapCount &&
+            loop->heap[child]->expiresAt <= threshold)
+            idx[nexpired++] = child;
+        if (child + 1 < loop->heapCount &&
+            loop->heap[child + 1]->expiresAt <= threshold)
+            idx[nexpired++] = child + 1;
+    }
+
+    for (i = 0 ; i < nexpired ; i++)
+        timers[i] = loop->heap[idx[i]]->timer;
+    qsort(timers, nexpired, sizeof(*timers), virEventEpollCompareTimer);
+
+    VIR_DEBUG("Dispatch %zu", nexpired);
+
+    for (i = 0 ; i < nexpired ; i++) {
+        virEventEpollTimeoutPtr timeout;
+        virEventTimeoutCallback cb;
+        void *opaque;
+        int timer = timers[i];
+
+        if (!(timeout = virHashLookup(loop->timeouts,
+                                      EVENT_EPOLL_KEY(timer))) ||
+            timeout->frequency < 0 ||
+            timeout->expiresAt > threshold)
+            continue;
+
+        cb = timeout->cb;
+        opaque = timeout->opaque;
+        virEventEpollScheduleTimeout(loop, timeout, now);
+
+        PROBE(EVENT_EPOLL_DISPATCH_TIMEOUT,
+              "timer=%d",
+              timer);
+        virMutexUnlock(&loop->lock);
+        (cb)(timer, opaque);
+        virMutexLock(&loop->lock);
+    }
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(idx);
+    VIR_FREE(timers);
+    return ret;
+}
+
+
+/*
+ * Dispatch @revents to every handle watching @fd that was
+ * registered before @lastWatch. The record is looked up
+ * again after each callback, since callbacks may remove
+ * handles, and even close and reuse the descriptor.
+ */
+static void
+virEventEpollDispatchFD(virEventEpollLoopPtr loop,
+                        int fd, int revents, int lastWatch)
+{
+    virEventEpollFDPtr rec;
+    size_t i;
+
+    for (i = 0 ; ; i++) {
+        virEventEpollHandlePtr handle;
+        virEventHandleCallback cb;
+        void *opaque;
+        int watch;
+        int hEvents;
+
+        if (!(rec = virHashLookup(loop->fds, EVENT_EPOLL_KEY(fd))) ||
+            i >= rec->nhandles)
+            break;
+
+        handle = rec->handles[i];
+        if (handle->watch >= lastWatch || !handle->events)
+            continue;
+
+        /* Like poll(), errors and hangups are always reported */
+        if (!(hEvents = revents & (handle->events | EPOLLERR | EPOLLHUP)))
+            continue;
+
+        cb = handle->cb;
+        opaque = handle->opaque;
+        watch = handle->watch;
+        hEvents = virEventEpollFromNativeEvents(hEvents);
+
+        PROBE(EVENT_EPOLL_DISPATCH_HANDLE,
+              "watch=%d events=%d",
+              watch, hEvents);
+        virMutexUnlock(&loop->lock);
+        (cb)(watch, fd, hEvents, opaque);
+        virMutexLock(&loop->lock);
+    }
+}
+
+/* Iterate over the file handles reported ready by epoll_wait()
+ * and invoke the user supplied callback of each handle with
+ * pending events, then do the same for descriptors that are
+ * emulated as always ready.
+ *
+ * Returns 0 upon success, -1 if an error occurred
+ */
+static int virEventEpollDispatchHandles(virEventEpollLoopPtr loop,
+                                        struct epoll_event *events,
+                                        int nevents,
+                                        int lastWatch)
+{
+    int i;
+    VIR_DEBUG("Dispatch %d", nevents);
+
+    for (i = 0 ; i < nevents ; i++)
+        virEventEpollDispatchFD(loop, events[i].data.fd, events[i].events,
+                                lastWatch);
+
+    for (i = 0 ; i < loop->nalwaysReady ; i++) {
+        virEventEpollFDPtr rec = loop->alwaysReady[i];
+        virEventEpollDispatchFD(loop, rec->fd, rec->events & (EPOLLIN | EPOLLOUT),
+                                lastWatch);
+    }
+
+    return 0;
+}
+
+
+/* Used post dispatch to actually free any timers and handles
+ * that were previously removed. This asynchronous cleanup is
+ * needed to make dispatch re-entrant safe.
+ */
+static void virEventEpollCleanup(virEventEpollLoopPtr loop)
+{
+    while (loop->deletedTimeouts) {
+        virEventEpollTimeoutPtr timeout = loop->deletedTimeouts;
+        loop->deletedTimeouts = timeout->next;
+
+        PROBE(EVENT_EPOLL_PURGE_TIMEOUT,
+              "timer=%d",
+              timeout->timer);
+        if (timeout->ff) {
+            virMutexUnlock(&loop->lock);
+            timeout->ff(timeout->opaque);
+            virMutexLock(&loop->lock);
+        }
+        VIR_FREE(timeout);
+    }
+
+    while (loop->deletedHandles) {
+        virEventEpollHandlePtr handle = loop->deletedHandles;
+        loop->deletedHandles = handle->next;
+
+        PROBE(EVENT_EPOLL_PURGE_HANDLE,
+              "watch=%d",
+              handle->watch);
+        if (handle->ff) {
+            virMutexUnlock(&loop->lock);
+            handle->ff(handle->opaque);
+            virMutexLock(&loop->lock);
+        }
+        VIR_FREE(handle);
+    }
+
+    /* Release some memory if we've got a big chunk free */
+    if (loop->heapAlloc > 2 * loop->ntimeouts + 16)
+        VIR_SHRINK_N(loop->heap, loop->heapAlloc,
+                     loop->heapAlloc - loop->ntimeouts);
+}
+
+/*
+ * Run a single iteration of the event loop, blocking until
+ * at least one file handle has an event, or a timer expires
+ */
+int virEventEpollLoopRunOnce(virEventEpollLoopPtr loop)
+{
+    struct epoll_event events[EVENT_EPOLL_MAX_EVENTS];
+    int ret, timeout, lastWatch;
+
+    virMutexLock(&loop->lock);
+    loop->running = 1;
+    virThreadSelf(&loop->leader);
+
+    virEventEpollCleanup(loop);
+
+    if (virEventEpollCalculateTimeout(loop, &timeout) < 0)
+        goto error;
+
+    lastWatch = loop->nextWatch;
+    virMutexUnlock(&loop->lock);
+
+ retry:
+    PROBE(EVENT_EPOLL_RUN,
+          "timeout=%d",
+          timeout);
+    ret = epoll_wait(loop->epollfd, events,
+                     EVENT_EPOLL_MAX_EVENTS, timeout);
+    if (ret < 0) {
+        EVENT_DEBUG("epoll_wait got error event %d", errno);
+        if (errno == EINTR || errno == EAGAIN) {
+            goto retry;
+        }
+        virReportSystemError(errno, "%s",
+                             _("Unable to wait on file handles"));
+        return -1;
+    }
+    EVENT_DEBUG("epoll_wait got %d event(s)", ret);
+
+    virMutexLock(&loop->lock);
+    if (virEventEpollDispatchTimeouts(loop) < 0)
+        goto error;
+
+    if (virEventEpollDispatchHandles(loop, events, ret, lastWatch) < 0)
+        goto error;
+
+    virEventEpollCleanup(loop);
+
+    loop->running = 0;
+    virMutexUnlock(&loop->lock);
+    return 0;
+
+error:
+    virMutexUnlock(&loop->lock);
+    return -1;
+}
+
+
+static void virEventEpollHandleWakeup(int watch ATTRIBUTE_UNUSED,
+                                      int fd,
+                                      int events ATTRIBUTE_UNUSED,
+                                      void *opaque)
+{
+    virEventEpollLoopPtr loop = opaque;
+    char c;
+    virMutexLock(&loop->lock);
+    ignore_value(saferead(fd, &c, sizeof(c)));
+    virMutexUnlock(&loop->lock);
+}
+
+static int virEventEpollLoopSetup(virEventEpollLoopPtr loop)
+{
+    if (virMutexInit(&loop->lock) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to initialize mutex"));
+        return -1;
+    }
+
+    if (!(loop->handles = virEventEpollHashCreate()) ||
+        !(loop->fds = virEventEpollHashCreate()) ||
+        !(loop->timeouts = virEventEpollHashCreate()))
+        goto error;
+
+    if ((loop->epollfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to create epoll instance"));
+        goto error;
+    }
+
+    if (pipe2(loop->wakeupfd, O_CLOEXEC | O_NONBLOCK) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to setup wakeup pipe"));
+        goto error;
+    }
+
+    if (virEventEpollLoopAddHandle(loop, loop->wakeupfd[0],
+                                   VIR_EVENT_HANDLE_READABLE,
+                                   virEventEpollHandleWakeup,
+                                   loop, NULL) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unable to add handle %d to event loop"),
+                       loop->wakeupfd[0]);
+        goto error;
+    }
+
+    return 0;
+
+error:
+    VIR_FORCE_CLOSE(loop->wakeupfd[0]);
+    VIR_FORCE_CLOSE(loop->wakeupfd[1]);
+    VIR_FORCE_CLOSE(loop->epollfd);
+    virHashFree(loop->handles);
+    virHashFree(loop->fds);
+    virHashFree(loop->timeouts);
+    loop->handles = loop->fds = loop->timeouts = NULL;
+    virMutexDestroy(&loop->lock);
+    return -1;
+}
+
+int virEventEpollInit(void)
+{
+    return virEventEpollLoopSetup(&eventLoop);
+}
+
+virEventEpollLoopPtr virEventEpollLoopNew(void)
+{
+    virEventEpollLoopPtr loop;
+
+    if (VIR_ALLOC(loop) < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+
+    loop->epollfd = -1;
+    loop->wakeupfd[0] = loop->wakeupfd[1] = -1;
+    loop->nextWatch = 1;
+    loop->nextTimer = 1;
+
+    if (virEventEpollLoopSetup(loop) < 0) {
+        VIR_FREE(loop);
+        return NULL;
+    }
+
+    return loop;
+}
+
+
+static void
+virEventEpollFreeHandle(void *payload,
+                        const void *name ATTRIBUTE_UNUSED,
+                        void *opaque ATTRIBUTE_UNUSED)
+{
+    virEventEpollHandlePtr handle = payload;
+    VIR_FREE(handle);
+}
+
+static void
+virEventEpollFreeFD(void *payload,
+                    const void *name ATTRIBUTE_UNUSED,
+                    void *opaque ATTRIBUTE_UNUSED)
+{
+    virEventEpollFDPtr rec = payload;
+    VIR_FREE(rec->handles);
+    VIR_FREE(rec);
+}
+
+static void
+virEventEpollFreeTimeout(void *payload,
+                         const void *name ATTRIBUTE_UNUSED,
+                         void *opaque ATTRIBUTE_UNUSED)
+{
+    virEventEpollTimeoutPtr timeout = payload;
+    VIR_FREE(timeout);
+}
+
+/*
+ * Free @loop, which must not be running. The free callbacks of
+ * handles and timers which were removed are run, but any still
+ * registered are dropped without running theirs.
+ */
+void virEventEpollLoopFree(virEventEpollLoopPtr loop)
+{
+    if (!loop)
+        return;
+
+    virMutexLock(&loop->lock);
+    virEventEpollCleanup(loop);
+    virMutexUnlock(&loop->lock);
+
+    virHashForEach(loop->handles, virEventEpollFreeHandle, NULL);
+    virHashForEach(loop->fds, virEventEpollFreeFD, NULL);
+    virHashForEach(loop->timeouts, virEventEpollFreeTimeout, NULL);
+    virHashFree(loop->handles);
+    virHashFree(loop->fds);
+    virHashFree(loop->timeouts);
+
+    VIR_FREE(loop->alwaysReady);
+    VIR_FREE(loop->heap);
+    VIR_FORCE_CLOSE(loop->wakeupfd[0]);
+    VIR_FORCE_CLOSE(loop->wakeupfd[1]);
+    VIR_FORCE_CLOSE(loop->epollfd);
+    virMutexDestroy(&loop->lock);
+    VIR_FREE(loop);
+}
+
+
+static int virEventEpollInterruptLocked(virEventEpollLoopPtr loop)
+{
+    char c = '\0';
+
+    if (!loop->running ||
+        virThreadIsSelf(&loop->leader)) {
+        VIR_DEBUG("Skip interrupt, %d %d", loop->running,
+                  virThreadID(&loop->leader));
+        return 0;
+    }
+
+    VIR_DEBUG("Interrupting");
+    if (safewrite(loop->wakeupfd[1], &c, sizeof(c)) != sizeof(c))
+        return -1;
+    return 0;
+}
+
+int virEventEpollLoopInterrupt(virEventEpollLoopPtr loop)
+{
+    int ret;
+
+    virMutexLock(&loop->lock);
+    ret = virEventEpollInterruptLocked(loop);
+    virMutexUnlock(&loop->lock);
+    return ret;
+}
+
+
+int virEventEpollAddHandle(int fd, int events,
+                           virEventHandleCallback cb,
+                           void *opaque,
+                           virFreeCallback ff)
+{
+    return virEventEpollLoopAddHandle(&eventLoop, fd, events, cb, opaque, ff);
+}
+
+void virEventEpollUpdateHandle(int watch, int events)
+{
+    virEventEpollLoopUpdateHandle(&eventLoop, watch, events);
+}
+
+int virEventEpollRemoveHandle(int watch)
+{
+    return virEventEpollLoopRemoveHandle(&eventLoop, watch);
+}
+
+int virEventEpollAddTimeout(int frequency,
+                            virEventTimeoutCallback cb,
+                            void *opaque,
+                            virFreeCallback ff)
+{
+    return virEventEpollLoopAddTimeout(&eventLoop, frequency, cb, opaque, ff);
+}
+
+void virEventEpollUpdateTimeout(int timer, int frequency)
+{
+    virEventEpollLoopUpdateTimeout(&eventLoop, timer, frequency);
+}
+
+int virEventEpollRemoveTimeout(int timer)
+{
+    return virEventEpollLoopRemoveTimeout(&eventLoop, timer);
+}
+
+int virEventEpollRunOnce(void)
+{
+    return virEventEpollLoopRunOnce(&eventLoop);
+}
+
+int virEventEpollInterrupt(void)
+{
+    return virEventEpollLoopInterrupt(&eventLoop);
+}
+
+#else /* ! HAVE_SYS_EPOLL_H */
+
+static const char *unsupported = N_("epoll is not available on this platform");
+
+int virEventEpollAddHandle(int fd ATTRIBUTE_UNUSED,
+                           int events ATTRIBUTE_UNUSED,
+                           virEventHandleCallback cb ATTRIBUTE_UNUSED,
+                           void *opaque ATTRIBUTE_UNUSED,
+                           virFreeCallback ff ATTRIBUTE_UNUSED)
+{
+    virReportError(VIR_ERR_NO_SUPPORT, "%s", _(unsupported));
+    return -1;
+}
+
+void virEventEpollUpdateHandle(int watch ATTRIBUTE_UNUSED,
+                               int events ATTRIBUTE_UNUSED)
+{
+}
+
+int virEventEpollRemoveHandle(int watch ATTRIBUTE_UNUSED)
+{
+    return -1;
+}
+
+int virEventEpollAddTimeout(int frequency ATTRIBUTE_UNUSED,
+                            virEventTimeoutCallback cb ATTRIBUTE_UNUSED,
+                            void *opaque ATTRIBUTE_UNUSED,
+                            virFreeCallback ff ATTRIBUTE_UNUSED)
+{
+    virReportError(VIR_ERR_NO_SUPPORT, "%s", _(unsupported));
+    return -1;
+}
+
+void virEventEpollUpdateTimeout(int timer ATTRIBUTE_UNUSED,
+                                int frequency ATTRIBUTE_UNUSED)
+{
+}
+
+int virEventEpollRemoveTimeout(int timer ATTRIBUTE_UNUSED)
+{
+    return -1;
+}
+
+int virEventEpollInit(void)
+{
+    virReportError(VIR_ERR_NO_SUPPORT, "%s", _(unsupported));
+    return -1;
+}
+
+int virEventEpollRunOnce(void)
+{
+    virReportError(VIR_ERR_NO_SUPPORT, "%s", _(unsupported));
+    return -1;
+}
+
+int virEventEpollInterrupt(void)
+{
+    return -1;
+}
+
+virEventEpollLoopPtr virEventEpollLoopNew(void)
+{
+    virReportError(VIR_ERR_NO_SUPPORT, "%s", _(unsupported));
+    return NULL;
+}
+
+void virEventEpollLoopFree(virEventEpollLoopPtr loop ATTRIBUTE_UNUSED)
+{
+}
+
+/* No loop can be created, so only the default implementation
+ * is ever passed in */
+int virEventEpollLoopAddHandle(virEventEpollLoopPtr loop ATTRIBUTE_UNUSED,
+                               int fd, int events,
+                               virEventHandleCallback cb,
+                               void *opaque,
+                               virFreeCallback ff)
+{
+    return virEventAddHandle(fd, events, cb, opaque, ff);
+}
+
+void virEventEpollLoopUpdateHandle(virEventEpollLoopPtr loop ATTRIBUTE_UNUSED,
+                                   int watch, int events)
+{
+    virEventUpdateHandle(watch, events);
+}
+
+int virEventEpollLoopRemoveHandle(virEventEpollLoopPtr loop ATTRIBUTE_UNUSED,
+                                  int watch)
+{
+    return virEventRemoveHandle(watch);
+}
+
+int virEventEpollLoopAddTimeout(virEventEpollLoopPtr loop ATTRIBUTE_UNUSED,
+                                int frequency,
+                                virEventTimeoutCallback cb,
+                                void *opaque,
+                                virFreeCallback ff)
+{
+    return virEventAddTimeout(frequency, cb, opaque, ff);
+}
+
+void virEventEpollLoopUpdateTimeout(virEventEpollLoopPtr loop ATTRIBUTE_UNUSED,
+                                    int timer, int frequency)
+{
+    virEventUpdateTimeout(timer, frequency);
+}
+
+int virEventEpollLoopRemoveTimeout(virEventEpollLoopPtr loop ATTRIBUTE_UNUSED,
+                                   int timer)
+{
+    return virEventRemoveTimeout(timer);
+}
+
+int virEventEpollLoopRunOnce(virEventEpollLoopPtr loop ATTRIBUTE_UNUSED)
+{
+    virReportError(VIR_ERR_NO_SUPPORT, "%s", _(unsupported));
+    return -1;
+}
+
+int virEventEpollLoopInterrupt(virEventEpollLoopPtr loop ATTRIBUTE_UNUSED)
+{
+    return -1;
+}
+
+#endif /* ! HAVE_SYS_EPOLL_H */
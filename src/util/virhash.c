@@ -266,6 +266,20 @@ virHashFree(virHashTablePtr table)
     VIR_FREE(table);
 }
 
+/**
+ * virHashValueFree:
+ * @value: the data in the hash
+ * @name: the hash key
+ *
+ * A virHashDataFree callback for tables whose payloads were
+ * allocated with VIR_ALLOC and own no further memory.
+ */
+void
+virHashValueFree(void *value, const void *name ATTRIBUTE_UNUSED)
+{
+    VIR_FREE(value);
+}
+
 static int
 virHashAddOrUpdateEntry(virHashTablePtr table, const void *name,
                         void *userdata,
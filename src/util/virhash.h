@@ -108,6 +108,7 @@ virHashTablePtr virHashCreateFull(ssize_t size,
                                   virHashKeyCopy keyCopy,
                                   virHashKeyFree keyFree);
 void virHashFree(virHashTablePtr table);
+void virHashValueFree(void *value, const void *name);
 ssize_t virHashSize(virHashTablePtr table);
 ssize_t virHashTableSize(virHashTablePtr table);
 
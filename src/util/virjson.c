@@ -28,6 +28,7 @@
 #include "virerror.h"
 #include "virlog.h"
 #include "virutil.h"
+#include "virhashcode.h"
 
 #if WITH_YAJL
 # include <yajl/yajl_gen.h>
@@ -58,15 +59,193 @@ struct _virJSONParser {
     virJSONValuePtr head;
     virJSONParserStatePtr state;
     unsigned int nstate;
+    virJSONArenaPtr arena;
 };
 
 
+/* Objects with at least this many keys get a hash index */
+#define VIR_JSON_OBJECT_INDEX_MIN 16
+
+/* Smallest block carved up by an arena; later blocks double in size */
+#define VIR_JSON_ARENA_BLOCK_MIN 4096
+
+/* Arrays in an arena start with room for this many items */
+#define VIR_JSON_ARENA_ITEMS_MIN 4
+
+typedef struct _virJSONArenaBlock virJSONArenaBlock;
+typedef virJSONArenaBlock *virJSONArenaBlockPtr;
+struct _virJSONArenaBlock {
+    virJSONArenaBlockPtr next;
+    size_t size;
+    size_t used;
+    char *data;
+};
+
+struct _virJSONArena {
+    virJSONArenaBlockPtr blocks;
+    virJSONValuePtr root;
+    /* Number of malloc'd values appended to containers of the arena */
+    size_t nadopted;
+};
+
+
+static virJSONArenaPtr virJSONArenaNew(void)
+{
+    virJSONArenaPtr arena;
+
+    if (VIR_ALLOC(arena) < 0)
+        return NULL;
+
+    return arena;
+}
+
+
+/* Return @size bytes of zeroed memory, which stays valid until the
+ * arena is freed */
+static void *virJSONArenaAlloc(virJSONArenaPtr arena, size_t size)
+{
+    virJSONArenaBlockPtr block = arena->blocks;
+    void *ret;
+
+    /* Keep everything suitably aligned for any of our structs */
+    size = VIR_DIV_UP(size, 2 * sizeof(void *)) * 2 * sizeof(void *);
+
+    if (!block || block->size - block->used < size) {
+        size_t blocksize = block ? block->size * 2 : VIR_JSON_ARENA_BLOCK_MIN;
+
+        if (blocksize < size)
+            blocksize = size;
+
+        if (VIR_ALLOC(block) < 0)
+            return NULL;
+        if (VIR_ALLOC_N(block->data, blocksize) < 0) {
+            VIR_FREE(block);
+            return NULL;
+        }
+        block->size = blocksize;
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    ret = block->data + block->used;
+    block->used += size;
+    return ret;
+}
+
+
+static char *virJSONArenaStrndup(virJSONArenaPtr arena,
+                                 const char *str,
+                                 size_t len)
+{
+    char *ret;
+
+    if (!(ret = virJSONArenaAlloc(arena, len + 1)))
+        return NULL;
+
+    memcpy(ret, str, len);
+    return ret;
+}
+
+
+/*
+ * Make room in an arena allocated array of @n items of @size bytes
+ * for one more. Capacity isn't stored, the arrays simply double
+ * whenever @n reaches a power of two, so that building an array of
+ * N items costs O(N) copying, like a realloc'd one would.
+ */
+static int virJSONArenaGrowArray(virJSONArenaPtr arena,
+                                 void *ptrptr,
+                                 size_t n,
+                                 size_t size)
+{
+    void **ptr = ptrptr;
+    size_t alloc;
+    void *tmp;
+
+    if (n != 0 &&
+        (n < VIR_JSON_ARENA_ITEMS_MIN || (n & (n - 1)) != 0))
+        return 0;
+
+    alloc = n ? n * 2 : VIR_JSON_ARENA_ITEMS_MIN;
+    if (alloc > SIZE_MAX / size)
+        return -1;
+
+    if (!(tmp = virJSONArenaAlloc(arena, alloc * size)))
+        return -1;
+
+    if (n)
+        memcpy(tmp, *ptr, n * size);
+    *ptr = tmp;
+    return 0;
+}
+
+
+static void virJSONArenaFreeAdopted(virJSONValuePtr value)
+{
+    virJSONValuePtr child;
+    int i;
+
+    switch ((virJSONType) value->type) {
+    case VIR_JSON_TYPE_OBJECT:
+        for (i = 0 ; i < value->data.object.npairs ; i++) {
+            child = value->data.object.pairs[i].value;
+            if (child->arena)
+                virJSONArenaFreeAdopted(child);
+            else
+                virJSONValueFree(child);
+        }
+        break;
+    case VIR_JSON_TYPE_ARRAY:
+        for (i = 0 ; i < value->data.array.nvalues ; i++) {
+            child = value->data.array.values[i];
+            if (child->arena)
+                virJSONArenaFreeAdopted(child);
+            else
+                virJSONValueFree(child);
+        }
+        break;
+    case VIR_JSON_TYPE_STRING:
+    case VIR_JSON_TYPE_NUMBER:
+    case VIR_JSON_TYPE_BOOLEAN:
+    case VIR_JSON_TYPE_NULL:
+        break;
+    }
+}
+
+
+static void virJSONArenaFree(virJSONArenaPtr arena)
+{
+    virJSONArenaBlockPtr block;
+
+    if (!arena)
+        return;
+
+    /* Values appended to the tree after parsing were malloc'd */
+    if (arena->nadopted && arena->root)
+        virJSONArenaFreeAdopted(arena->root);
+
+    while ((block = arena->blocks)) {
+        arena->blocks = block->next;
+        VIR_FREE(block->data);
+        VIR_FREE(block);
+    }
+    VIR_FREE(arena);
+}
+
+
 void virJSONValueFree(virJSONValuePtr value)
 {
     int i;
     if (!value || value->protect)
         return;
 
+    /* Everything in an arena goes away along with its root */
+    if (value->arena) {
+        if (value->arena->root == value)
+            virJSONArenaFree(value->arena);
+        return;
+    }
+
     switch ((virJSONType) value->type) {
     case VIR_JSON_TYPE_OBJECT:
         for (i = 0 ; i < value->data.object.npairs; i++) {
@@ -74,6 +253,7 @@ void virJSONValueFree(virJSONValuePtr value)
             virJSONValueFree(value->data.object.pairs[i].value);
         }
         VIR_FREE(value->data.object.pairs);
+        VIR_FREE(value->data.object.index);
         break;
     case VIR_JSON_TYPE_ARRAY:
         for (i = 0 ; i < value->data.array.nvalues ; i++)
@@ -258,9 +438,110 @@ virJSONValuePtr virJSONValueNewObject(void)
     return val;
 }
 
-int virJSONValueObjectAppend(virJSONValuePtr object, const char *key, virJSONValuePtr value)
+static uint32_t virJSONObjectIndexSlot(virJSONObjectPtr object,
+                                       const char *key)
 {
-    char *newkey;
+    return virHashCodeGen(key, strlen(key), 0) & (object->nindex - 1);
+}
+
+
+/* Return the position of @key in @object's pairs, or -1 */
+static int virJSONObjectFind(virJSONObjectPtr object, const char *key)
+{
+    unsigned int i;
+
+    if (object->index) {
+        uint32_t slot = virJSONObjectIndexSlot(object, key);
+
+        while (object->index[slot]) {
+            i = object->index[slot] - 1;
+            if (STREQ(object->pairs[i].key, key))
+                return i;
+            slot = (slot + 1) & (object->nindex - 1);
+        }
+        return -1;
+    }
+
+    for (i = 0 ; i < object->npairs ; i++) {
+        if (STREQ(object->pairs[i].key, key))
+            return i;
+    }
+
+    return -1;
+}
+
+
+static void virJSONObjectIndexAdd(virJSONObjectPtr object, unsigned int n)
+{
+    uint32_t slot = virJSONObjectIndexSlot(object, object->pairs[n].key);
+
+    while (object->index[slot])
+        slot = (slot + 1) & (object->nindex - 1);
+    object->index[slot] = n + 1;
+}
+
+
+/*
+ * Keep the hash index of a large object @value up to date now that it has
+ * one more pair. The table is kept at most half full, with linear
+ * probing. If it can't be grown, lookups just fall back to scanning.
+ */
+static void virJSONObjectIndexUpdate(virJSONValuePtr value)
+{
+    virJSONObjectPtr object = &value->data.object;
+    unsigned int *index = NULL;
+    unsigned int nindex;
+    unsigned int i;
+
+    if (object->npairs < VIR_JSON_OBJECT_INDEX_MIN)
+        return;
+
+    if (object->index && object->npairs * 2 <= object->nindex) {
+        virJSONObjectIndexAdd(object, object->npairs - 1);
+        return;
+    }
+
+    nindex = VIR_JSON_OBJECT_INDEX_MIN * 4;
+    while (nindex < object->npairs * 2)
+        nindex *= 2;
+
+    if (value->arena)
+        index = virJSONArenaAlloc(value->arena, sizeof(*index) * nindex);
+    else
+        ignore_value(VIR_ALLOC_N(index, nindex));
+
+    if (!value->arena)
+        VIR_FREE(object->index);
+    object->index = index;
+    object->nindex = index ? nindex : 0;
+    if (!index)
+        return;
+
+    for (i = 0 ; i < object->npairs ; i++)
+        virJSONObjectIndexAdd(object, i);
+}
+
+
+/* A malloc'd value appended into an arena is freed along with it */
+static void virJSONValueAdopt(virJSONValuePtr container, virJSONValuePtr value)
+{
+    if (container->arena && !value->arena)
+        container->arena->nadopted++;
+}
+
+
+/*
+ * Append @value under @key. The key is copied, unless @stealKey is
+ * set, in which case @key must have been allocated the same way as
+ * @object and is owned by @object on success. Values from an arena
+ * can only be appended to containers in the same arena.
+ */
+static int virJSONValueObjectAppendInternal(virJSONValuePtr object,
+                                            char *key,
+                                            virJSONValuePtr value,
+                                            bool stealKey)
+{
+    char *newkey = NULL;
 
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return -1;
@@ -268,22 +549,49 @@ int virJSONValueObjectAppend(virJSONValuePtr object, const char *key, virJSONVal
     if (virJSONValueObjectHasKey(object, key))
         return -1;
 
-    if (!(newkey = strdup(key)))
+    if (value->arena && value->arena != object->arena)
         return -1;
 
-    if (VIR_REALLOC_N(object->data.object.pairs,
-                      object->data.object.npairs + 1) < 0) {
-        VIR_FREE(newkey);
-        return -1;
+    if (object->arena) {
+        if (stealKey)
+            newkey = key;
+        else if (!(newkey = virJSONArenaStrndup(object->arena, key,
+                                                strlen(key))))
+            return -1;
+
+        if (virJSONArenaGrowArray(object->arena,
+                                  &object->data.object.pairs,
+                                  object->data.object.npairs,
+                                  sizeof(*object->data.object.pairs)) < 0)
+            return -1;
+    } else {
+        if (stealKey)
+            newkey = key;
+        else if (!(newkey = strdup(key)))
+            return -1;
+
+        if (VIR_REALLOC_N(object->data.object.pairs,
+                          object->data.object.npairs + 1) < 0) {
+            if (!stealKey)
+                VIR_FREE(newkey);
+            return -1;
+        }
     }
 
+    virJSONValueAdopt(object, value);
     object->data.object.pairs[object->data.object.npairs].key = newkey;
     object->data.object.pairs[object->data.object.npairs].value = value;
     object->data.object.npairs++;
+    virJSONObjectIndexUpdate(object);
 
     return 0;
 }
 
+int virJSONValueObjectAppend(virJSONValuePtr object, const char *key, virJSONValuePtr value)
+{
+    return virJSONValueObjectAppendInternal(object, (char *)key, value, false);
+}
+
 
 int virJSONValueObjectAppendString(virJSONValuePtr object, const char *key, const char *value)
 {
@@ -388,10 +696,23 @@ int virJSONValueArrayAppend(virJSONValuePtr array, virJSONValuePtr value)
     if (array->type != VIR_JSON_TYPE_ARRAY)
         return -1;
 
-    if (VIR_REALLOC_N(array->data.array.values,
-                      array->data.array.nvalues + 1) < 0)
+    if (value->arena && value->arena != array->arena)
         return -1;
 
+    if (array->arena) {
+        if (virJSONArenaGrowArray(array->arena,
+                                  &array->data.array.values,
+                                  array->data.array.nvalues,
+                                  sizeof(*array->data.array.values)) < 0)
+            return -1;
+    } else {
+        if (VIR_REALLOC_N(array->data.array.values,
+                          array->data.array.nvalues + 1) < 0)
+            return -1;
+    }
+
+    virJSONValueAdopt(array, value);
+
     array->data.array.values[array->data.array.nvalues] = value;
     array->data.array.nvalues++;
 
@@ -400,17 +721,10 @@ int virJSONValueArrayAppend(virJSONValuePtr array, virJSONValuePtr value)
 
 int virJSONValueObjectHasKey(virJSONValuePtr object, const char *key)
 {
-    int i;
-
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return -1;
 
-    for (i = 0 ; i < object->data.object.npairs ; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key))
-            return 1;
-    }
-
-    return 0;
+    return virJSONObjectFind(&object->data.object, key) >= 0;
 }
 
 virJSONValuePtr virJSONValueObjectGet(virJSONValuePtr object, const char *key)
@@ -420,12 +734,10 @@ virJSONValuePtr virJSONValueObjectGet(virJSONValuePtr object, const char *key)
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return NULL;
 
-    for (i = 0 ; i < object->data.object.npairs ; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key))
-            return object->data.object.pairs[i].value;
-    }
+    if ((i = virJSONObjectFind(&object->data.object, key)) < 0)
+        return NULL;
 
-    return NULL;
+    return object->data.object.pairs[i].value;
 }
 
 int virJSONValueObjectKeysNumber(virJSONValuePtr object)
@@ -660,6 +972,41 @@ int virJSONValueObjectIsNull(virJSONValuePtr object, const char *key)
 
 
 #if WITH_YAJL
+static virJSONValuePtr virJSONParserNewValue(virJSONParserPtr parser,
+                                             virJSONType type)
+{
+    virJSONValuePtr value;
+
+    if (parser->arena) {
+        if (!(value = virJSONArenaAlloc(parser->arena, sizeof(*value))))
+            return NULL;
+        value->arena = parser->arena;
+    } else {
+        if (VIR_ALLOC(value) < 0)
+            return NULL;
+    }
+
+    value->type = type;
+    return value;
+}
+
+static char *virJSONParserStrndup(virJSONParserPtr parser,
+                                  const char *str,
+                                  size_t len)
+{
+    if (parser->arena)
+        return virJSONArenaStrndup(parser->arena, str, len);
+    return strndup(str, len);
+}
+
+static void virJSONParserFreeKey(virJSONParserPtr parser,
+                                 virJSONParserStatePtr state)
+{
+    if (!parser->arena)
+        VIR_FREE(state->key);
+    state->key = NULL;
+}
+
 static int virJSONParserInsertValue(virJSONParserPtr parser,
                                     virJSONValuePtr value)
 {
@@ -681,12 +1028,12 @@ static int virJSONParserInsertValue(virJSONParserPtr parser,
                 return -1;
             }
 
-            if (virJSONValueObjectAppend(state->value,
-                                         state->key,
-                                         value) < 0)
+            if (virJSONValueObjectAppendInternal(state->value,
+                                                 state->key,
+                                                 value, true) < 0)
                 return -1;
 
-            VIR_FREE(state->key);
+            state->key = NULL;
         }   break;
 
         case VIR_JSON_TYPE_ARRAY: {
@@ -712,7 +1059,8 @@ static int virJSONParserInsertValue(virJSONParserPtr parser,
 static int virJSONParserHandleNull(void *ctx)
 {
     virJSONParserPtr parser = ctx;
-    virJSONValuePtr value = virJSONValueNewNull();
+    virJSONValuePtr value = virJSONParserNewValue(parser,
+                                                  VIR_JSON_TYPE_NULL);
 
     VIR_DEBUG("parser=%p", parser);
 
@@ -730,12 +1078,14 @@ static int virJSONParserHandleNull(void *ctx)
 static int virJSONParserHandleBoolean(void *ctx, int boolean_)
 {
     virJSONParserPtr parser = ctx;
-    virJSONValuePtr value = virJSONValueNewBoolean(boolean_);
+    virJSONValuePtr value = virJSONParserNewValue(parser,
+                                                  VIR_JSON_TYPE_BOOLEAN);
 
     VIR_DEBUG("parser=%p boolean=%d", parser, boolean_);
 
     if (!value)
         return 0;
+    value->data.boolean = boolean_;
 
     if (virJSONParserInsertValue(parser, value) < 0) {
         virJSONValueFree(value);
@@ -750,19 +1100,19 @@ static int virJSONParserHandleNumber(void *ctx,
                                      yajl_size_t l)
 {
     virJSONParserPtr parser = ctx;
-    char *str = strndup(s, l);
-    virJSONValuePtr value;
-
-    if (!str)
-        return -1;
-    value = virJSONValueNewNumber(str);
-    VIR_FREE(str);
-
-    VIR_DEBUG("parser=%p str=%s", parser, str);
+    virJSONValuePtr value = virJSONParserNewValue(parser,
+                                                  VIR_JSON_TYPE_NUMBER);
 
     if (!value)
         return 0;
 
+    if (!(value->data.number = virJSONParserStrndup(parser, s, l))) {
+        virJSONValueFree(value);
+        return 0;
+    }
+
+    VIR_DEBUG("parser=%p str=%s", parser, value->data.number);
+
     if (virJSONParserInsertValue(parser, value) < 0) {
         virJSONValueFree(value);
         return 0;
@@ -776,14 +1126,21 @@ static int virJSONParserHandleString(void *ctx,
                                      yajl_size_t stringLen)
 {
     virJSONParserPtr parser = ctx;
-    virJSONValuePtr value = virJSONValueNewStringLen((const char *)stringVal,
-                                                     stringLen);
+    virJSONValuePtr value = virJSONParserNewValue(parser,
+                                                  VIR_JSON_TYPE_STRING);
 
     VIR_DEBUG("parser=%p str=%p", parser, (const char *)stringVal);
 
     if (!value)
         return 0;
 
+    if (!(value->data.string = virJSONParserStrndup(parser,
+                                                    (const char *)stringVal,
+                                                    stringLen))) {
+        virJSONValueFree(value);
+        return 0;
+    }
+
     if (virJSONParserInsertValue(parser, value) < 0) {
         virJSONValueFree(value);
         return 0;
@@ -807,7 +1164,8 @@ static int virJSONParserHandleMapKey(void *ctx,
     state = &parser->state[parser->nstate-1];
     if (state->key)
         return 0;
-    state->key = strndup((const char *)stringVal, stringLen);
+    state->key = virJSONParserStrndup(parser, (const char *)stringVal,
+                                      stringLen);
     if (!state->key)
         return 0;
     return 1;
@@ -816,7 +1174,8 @@ static int virJSONParserHandleMapKey(void *ctx,
 static int virJSONParserHandleStartMap(void *ctx)
 {
     virJSONParserPtr parser = ctx;
-    virJSONValuePtr value = virJSONValueNewObject();
+    virJSONValuePtr value = virJSONParserNewValue(parser,
+                                                  VIR_JSON_TYPE_OBJECT);
 
     VIR_DEBUG("parser=%p", parser);
 
@@ -854,7 +1213,7 @@ static int virJSONParserHandleEndMap(void *ctx)
 
     state = &(parser->state[parser->nstate-1]);
     if (state->key) {
-        VIR_FREE(state->key);
+        virJSONParserFreeKey(parser, state);
         return 0;
     }
 
@@ -869,7 +1228,8 @@ static int virJSONParserHandleEndMap(void *ctx)
 static int virJSONParserHandleStartArray(void *ctx)
 {
     virJSONParserPtr parser = ctx;
-    virJSONValuePtr value = virJSONValueNewArray();
+    virJSONValuePtr value = virJSONParserNewValue(parser,
+                                                  VIR_JSON_TYPE_ARRAY);
 
     VIR_DEBUG("parser=%p", parser);
 
@@ -904,7 +1264,7 @@ static int virJSONParserHandleEndArray(void *ctx)
 
     state = &(parser->state[parser->nstate-1]);
     if (state->key) {
-        VIR_FREE(state->key);
+        virJSONParserFreeKey(parser, state);
         return 0;
     }
 
@@ -932,16 +1292,25 @@ static const yajl_callbacks parserCallbacks = {
 
 
 /* XXX add an incremental streaming parser - yajl trivially supports it */
-virJSONValuePtr virJSONValueFromString(const char *jsonstring)
+virJSONValuePtr virJSONValueFromStringFlags(const char *jsonstring,
+                                            unsigned int flags)
 {
     yajl_handle hand;
-    virJSONParser parser = { NULL, NULL, 0 };
+    virJSONParser parser = { NULL, NULL, 0, NULL };
     virJSONValuePtr ret = NULL;
 # ifndef WITH_YAJL2
     yajl_parser_config cfg = { 1, 1 };
 # endif
 
-    VIR_DEBUG("string=%s", jsonstring);
+    virCheckFlags(VIR_JSON_PARSE_ARENA, NULL);
+
+    VIR_DEBUG("string=%s flags=%x", jsonstring, flags);
+
+    if ((flags & VIR_JSON_PARSE_ARENA) &&
+        !(parser.arena = virJSONArenaNew())) {
+        virReportOOMError();
+        return NULL;
+    }
 
 # ifdef WITH_YAJL2
     hand = yajl_alloc(&parserCallbacks, NULL, &parser);
@@ -969,11 +1338,14 @@ virJSONValuePtr virJSONValueFromString(const char *jsonstring)
                        _("cannot parse json %s: %s"),
                        jsonstring, (const char*) errstr);
         VIR_FREE(errstr);
-        virJSONValueFree(parser.head);
         goto cleanup;
     }
 
     ret = parser.head;
+    if (parser.arena && ret) {
+        parser.arena->root = ret;
+        parser.arena = NULL;
+    }
 
 cleanup:
     yajl_free(hand);
@@ -981,16 +1353,30 @@ cleanup:
     if (parser.nstate) {
         int i;
         for (i = 0 ; i < parser.nstate ; i++) {
-            VIR_FREE(parser.state[i].key);
+            virJSONParserFreeKey(&parser, &parser.state[i]);
         }
     }
+    VIR_FREE(parser.state);
 
-    VIR_DEBUG("result=%p", parser.head);
+    if (!ret) {
+        if (parser.arena)
+            virJSONArenaFree(parser.arena);
+        else
+            virJSONValueFree(parser.head);
+    }
+
+    VIR_DEBUG("result=%p", ret);
 
     return ret;
 }
 
 
+virJSONValuePtr virJSONValueFromString(const char *jsonstring)
+{
+    return virJSONValueFromStringFlags(jsonstring, 0);
+}
+
+
 static int virJSONValueToStringOne(virJSONValuePtr object,
                                    yajl_gen g)
 {
@@ -1106,6 +1492,13 @@ cleanup:
 
 
 #else
+virJSONValuePtr virJSONValueFromStringFlags(const char *jsonstring ATTRIBUTE_UNUSED,
+                                            unsigned int flags ATTRIBUTE_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return NULL;
+}
 virJSONValuePtr virJSONValueFromString(const char *jsonstring ATTRIBUTE_UNUSED)
 {
     virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -48,6 +48,9 @@ typedef virJSONObjectPair *virJSONObjectPairPtr;
 typedef struct _virJSONArray virJSONArray;
 typedef virJSONArray *virJSONArrayPtr;
 
+typedef struct _virJSONArena virJSONArena;
+typedef virJSONArena *virJSONArenaPtr;
+
 
 struct _virJSONObjectPair {
     char *key;
@@ -57,6 +60,9 @@ struct _virJSONObjectPair {
 struct _virJSONObject {
     unsigned int npairs;
     virJSONObjectPairPtr pairs;
+    /* Hash index over pairs once the object is large, else NULL */
+    unsigned int *index;
+    unsigned int nindex;
 };
 
 struct _virJSONArray {
@@ -67,6 +73,7 @@ struct _virJSONArray {
 struct _virJSONValue {
     int type; /* enum virJSONType */
     bool protect; /* prevents deletion when embedded in another object */
+    virJSONArenaPtr arena; /* arena holding this value, NULL if malloc'd */
 
     union {
         virJSONObject object;
@@ -131,7 +138,16 @@ int virJSONValueObjectAppendNumberDouble(virJSONValuePtr object, const char *key
 int virJSONValueObjectAppendBoolean(virJSONValuePtr object, const char *key, int boolean);
 int virJSONValueObjectAppendNull(virJSONValuePtr object, const char *key);
 
+typedef enum {
+    /* Allocate the whole tree from a few large blocks which are all
+     * released when the root is freed. Values in the tree can't be
+     * freed on their own or moved into another tree */
+    VIR_JSON_PARSE_ARENA = (1 << 0),
+} virJSONParseFlags;
+
 virJSONValuePtr virJSONValueFromString(const char *jsonstring);
+virJSONValuePtr virJSONValueFromStringFlags(const char *jsonstring,
+                                            unsigned int flags);
 char *virJSONValueToString(virJSONValuePtr object,
                            bool pretty);
 
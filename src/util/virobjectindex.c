@@ -0,0 +1,221 @@
+/*
+ * virobjectindex.c: name and UUID index for lists of objects
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include "virobjectindex.h"
+#include "virhash.h"
+#include "virthread.h"
+#include "viruuid.h"
+#include "viralloc.h"
+#include "virerror.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+struct _virObjectIndex {
+    virRWLock lock;
+    virObjectIndexLockFunc lockFunc;
+
+    /* uuid string -> object */
+    virHashTablePtr byUUID;
+    /* name -> object */
+    virHashTablePtr byName;
+};
+
+
+/**
+ * virObjectIndexNew:
+ * @lock: function locking an object of the list
+ *
+ * Returns a new empty index, or NULL on failure.
+ */
+virObjectIndexPtr virObjectIndexNew(virObjectIndexLockFunc lock)
+{
+    virObjectIndexPtr idx;
+
+    if (VIR_ALLOC(idx) < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+
+    if (virRWLockInit(&idx->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize object index lock"));
+        VIR_FREE(idx);
+        return NULL;
+    }
+    idx->lockFunc = lock;
+
+    if (!(idx->byUUID = virHashCreate(32, NULL)) ||
+        !(idx->byName = virHashCreate(32, NULL))) {
+        virObjectIndexFree(idx);
+        return NULL;
+    }
+
+    return idx;
+}
+
+
+void virObjectIndexFree(virObjectIndexPtr idx)
+{
+    if (!idx)
+        return;
+
+    virHashFree(idx->byUUID);
+    virHashFree(idx->byName);
+    virRWLockDestroy(&idx->lock);
+    VIR_FREE(idx);
+}
+
+
+/**
+ * virObjectIndexAdd:
+ * @idx: the index
+ * @uuid: UUID of @obj, or NULL if objects of this type have none
+ * @name: name of @obj, or NULL if objects of this type have none
+ * @obj: the object
+ *
+ * Make @obj findable by @uuid and @name, replacing any object
+ * previously indexed under either of them.
+ *
+ * Returns 0 on success, -1 on failure, in which case @idx is left
+ * unchanged.
+ */
+int virObjectIndexAdd(virObjectIndexPtr idx,
+                      const unsigned char *uuid,
+                      const char *name,
+                      void *obj)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    int ret = -1;
+
+    virRWLockWrite(&idx->lock);
+
+    if (uuid) {
+        virUUIDFormat(uuid, uuidstr);
+        if (virHashUpdateEntry(idx->byUUID, uuidstr, obj) < 0)
+            goto cleanup;
+    }
+
+    if (name &&
+        virHashUpdateEntry(idx->byName, name, obj) < 0) {
+        if (uuid)
+            virHashRemoveEntry(idx->byUUID, uuidstr);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    virRWLockUnlock(&idx->lock);
+    return ret;
+}
+
+
+/**
+ * virObjectIndexRemove:
+ * @idx: the index
+ * @uuid: UUID @obj was added with
+ * @name: name @obj was added with
+ * @obj: the object
+ *
+ * Remove the entries for @obj. Entries for @uuid or @name which have
+ * since been taken over by another object are left alone. Once this
+ * returns, lookups which found @obj before have locked it, so taking
+ * and releasing its lock waits for them to be done with it.
+ */
+void virObjectIndexRemove(virObjectIndexPtr idx,
+                          const unsigned char *uuid,
+                          const char *name,
+                          void *obj)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (!idx)
+        return;
+
+    virRWLockWrite(&idx->lock);
+
+    if (uuid) {
+        virUUIDFormat(uuid, uuidstr);
+        if (virHashLookup(idx->byUUID, uuidstr) == obj)
+            virHashRemoveEntry(idx->byUUID, uuidstr);
+    }
+
+    if (name &&
+        virHashLookup(idx->byName, name) == obj)
+        virHashRemoveEntry(idx->byName, name);
+
+    virRWLockUnlock(&idx->lock);
+}
+
+
+static void *
+virObjectIndexLookup(virObjectIndexPtr idx,
+                     virHashTablePtr table,
+                     const char *key)
+{
+    void *obj;
+
+    virRWLockRead(&idx->lock);
+    if ((obj = virHashLookup(table, key)))
+        (idx->lockFunc)(obj);
+    virRWLockUnlock(&idx->lock);
+
+    return obj;
+}
+
+
+/**
+ * virObjectIndexLookupUUID:
+ * @idx: the index
+ * @uuid: UUID to look up
+ *
+ * Returns the object indexed under @uuid, locked, or NULL.
+ */
+void *virObjectIndexLookupUUID(virObjectIndexPtr idx,
+                               const unsigned char *uuid)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (!idx)
+        return NULL;
+
+    virUUIDFormat(uuid, uuidstr);
+    return virObjectIndexLookup(idx, idx->byUUID, uuidstr);
+}
+
+
+/**
+ * virObjectIndexLookupName:
+ * @idx: the index
+ * @name: name to look up
+ *
+ * Returns the object indexed under @name, locked, or NULL.
+ */
+void *virObjectIndexLookupName(virObjectIndexPtr idx,
+                               const char *name)
+{
+    if (!idx)
+        return NULL;
+
+    return virObjectIndexLookup(idx, idx->byName, name);
+}
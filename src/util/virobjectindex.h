@@ -0,0 +1,71 @@
+/*
+ * virobjectindex.h: name and UUID index for lists of objects
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __VIR_OBJECT_INDEX_H__
+# define __VIR_OBJECT_INDEX_H__
+
+# include "internal.h"
+
+/*
+ * An index mapping names and UUIDs to the objects of a list, so
+ * the object lists in src/conf can be searched without walking
+ * (and locking) every object. The index does not own the objects:
+ * the list adds each object when it is inserted and removes it
+ * before it is freed. The name and UUID of an object must not
+ * change while it is indexed.
+ *
+ * The index has its own reader/writer lock, so lookups run
+ * concurrently with each other. As with virDomainObjList, an object
+ * is returned locked, and the lock is taken before the index is
+ * unlocked: an object must therefore be unindexed with
+ * virObjectIndexRemove, then locked and unlocked once more by the
+ * list, before it can be freed. The index is only modified by
+ * callers which hold no indexed object locked, except the one
+ * being added if it is not indexed yet. A NULL index is valid for
+ * every lookup, and behaves as an empty one.
+ */
+typedef struct _virObjectIndex virObjectIndex;
+typedef virObjectIndex *virObjectIndexPtr;
+
+typedef void (*virObjectIndexLockFunc)(void *obj);
+
+virObjectIndexPtr virObjectIndexNew(virObjectIndexLockFunc lock)
+    ATTRIBUTE_NONNULL(1);
+void virObjectIndexFree(virObjectIndexPtr idx);
+
+int virObjectIndexAdd(virObjectIndexPtr idx,
+                      const unsigned char *uuid,
+                      const char *name,
+                      void *obj)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(4) ATTRIBUTE_RETURN_CHECK;
+void virObjectIndexRemove(virObjectIndexPtr idx,
+                          const unsigned char *uuid,
+                          const char *name,
+                          void *obj);
+
+void *virObjectIndexLookupUUID(virObjectIndexPtr idx,
+                               const unsigned char *uuid)
+    ATTRIBUTE_NONNULL(2);
+void *virObjectIndexLookupName(virObjectIndexPtr idx,
+                               const char *name)
+    ATTRIBUTE_NONNULL(2);
+
+#endif /* __VIR_OBJECT_INDEX_H__ */
@@ -28,6 +28,9 @@
 typedef struct virMutex virMutex;
 typedef virMutex *virMutexPtr;
 
+typedef struct virRWLock virRWLock;
+typedef virRWLock *virRWLockPtr;
+
 typedef struct virCond virCond;
 typedef virCond *virCondPtr;
 
@@ -85,6 +88,16 @@ void virMutexLock(virMutexPtr m);
 void virMutexUnlock(virMutexPtr m);
 
 
+/* A lock that may be held by any number of readers at once, or by
+ * a single writer. It is not recursive, and a read lock cannot be
+ * upgraded to a write lock. */
+int virRWLockInit(virRWLockPtr l) ATTRIBUTE_RETURN_CHECK;
+void virRWLockDestroy(virRWLockPtr l);
+
+void virRWLockRead(virRWLockPtr l);
+void virRWLockWrite(virRWLockPtr l);
+void virRWLockUnlock(virRWLockPtr l);
+
 
 int virCondInit(virCondPtr c) ATTRIBUTE_RETURN_CHECK;
 int virCondDestroy(virCondPtr c) ATTRIBUTE_RETURN_CHECK;
@@ -22,23 +22,30 @@
  *     Hu Tao <hutao@cn.fujitsu.com>
  *     Daniel P. Berrange <berrange@redhat.com>
  */
-
 #include <config.h>
 
+#include <string.h>
+
 #include "virthreadpool.h"
 #include "viralloc.h"
 #include "virthread.h"
+#include "viratomic.h"
 #include "virerror.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
+/* Default for how long a worker above minWorkers may sit idle
+ * before it exits, in ms */
+#define VIR_THREAD_POOL_IDLE_TIMEOUT (30 * 1000)
+
 typedef struct _virThreadPoolJob virThreadPoolJob;
 typedef virThreadPoolJob *virThreadPoolJobPtr;
 
 struct _virThreadPoolJob {
-    virThreadPoolJobPtr prev;
     virThreadPoolJobPtr next;
     unsigned int priority;
+    unsigned long long queued; /* When the job was submitted, in us */
 
     void *data;
 };
@@ -49,113 +56,517 @@ typedef virThreadPoolJobList *virThreadPoolJobListPtr;
 struct _virThreadPoolJobList {
     virThreadPoolJobPtr head;
     virThreadPoolJobPtr tail;
-    virThreadPoolJobPtr firstPrio;
 };
 
+typedef struct _virThreadPoolCounters virThreadPoolCounters;
+typedef virThreadPoolCounters *virThreadPoolCountersPtr;
+
+struct _virThreadPoolCounters {
+    unsigned long long jobsDone;
+    unsigned long long jobsStolen;
+    unsigned long long waitTotal;
+    unsigned long long waitMax;
+    unsigned long long runTotal;
+};
+
+typedef struct _virThreadPoolWorker virThreadPoolWorker;
+typedef virThreadPoolWorker *virThreadPoolWorkerPtr;
+
+/*
+ * One slot per possible worker. Each slot has its own job queue
+ * and lock, so submitting and running jobs only contends with
+ * workers stealing from the same queue, not with the whole pool.
+ */
+struct _virThreadPoolWorker {
+    virThreadPoolPtr pool;
+    size_t id;
+
+    virMutex lock;
+    virCond cond;
+    virThread thread;
+
+    /* Modified with both pool->mutex and lock held */
+    volatile int alive;
+    /* Modified with lock held, read without it as a hint */
+    volatile int idle;
+    volatile int njobs;
+
+    virThreadPoolJobList jobs;
+    virThreadPoolCounters counters;
+};
 
 struct _virThreadPool {
-    bool quit;
+    volatile int quit;
 
     virThreadPoolJobFunc jobFunc;
     void *jobOpaque;
-    virThreadPoolJobList jobList;
-    size_t jobQueueDepth;
 
+    /* Jobs queued anywhere in the pool, not yet picked up */
+    volatile int jobQueueDepth;
+    volatile int jobQueueDepthMax;
+    /* Jobs queued or running, signalled on drain_cond at zero */
+    volatile int jobsPending;
+
+    /* Protects starting and stopping workers and the priority lane */
     virMutex mutex;
-    virCond cond;
     virCond quit_cond;
+    virCond drain_cond;
 
     size_t maxWorkers;
     size_t minWorkers;
-    size_t freeWorkers;
-    size_t nWorkers;
-    virThreadPtr workers;
-
+    volatile int idleTimeout;
+    volatile int freeWorkers;
+    volatile int nWorkers;
+    volatile int nextWorker;
+    size_t nslots;
+    virThreadPoolWorkerPtr workers;
+
+    virThreadPoolJobList prioJobs;
+    volatile int nPrioJobs;
     size_t nPrioWorkers;
+    size_t nPrioRunning;
     virThreadPtr prioWorkers;
     virCond prioCond;
+    virThreadPoolCounters prioCounters;
 };
 
-struct virThreadPoolWorkerData {
-    virThreadPoolPtr pool;
-    virCondPtr cond;
-    bool priority;
-};
 
-static void virThreadPoolWorker(void *opaque)
+static unsigned long long
+virThreadPoolTimeNow(void)
 {
-    struct virThreadPoolWorkerData *data = opaque;
-    virThreadPoolPtr pool = data->pool;
-    virCondPtr cond = data->cond;
-    bool priority = data->priority;
-    virThreadPoolJobPtr job = NULL;
+    unsigned long long now;
 
-    VIR_FREE(data);
+    if (virTimeMicrosMonotonicRaw(&now) < 0)
+        return 0;
+    return now;
+}
 
-    virMutexLock(&pool->mutex);
 
-    while (1) {
-        while (!pool->quit &&
-               ((!priority && !pool->jobList.head) ||
-                (priority && !pool->jobList.firstPrio))) {
-            if (!priority)
-                pool->freeWorkers++;
-            if (virCondWait(cond, &pool->mutex) < 0) {
-                if (!priority)
-                    pool->freeWorkers--;
-                goto out;
-            }
-            if (!priority)
-                pool->freeWorkers--;
+static void
+virThreadPoolJobListAppend(virThreadPoolJobListPtr list,
+                           virThreadPoolJobPtr job)
+{
+    job->next = NULL;
+    if (list->tail)
+        list->tail->next = job;
+    else
+        list->head = job;
+    list->tail = job;
+}
+
+
+static virThreadPoolJobPtr
+virThreadPoolJobListPop(virThreadPoolJobListPtr list)
+{
+    virThreadPoolJobPtr job = list->head;
+
+    if (job) {
+        if (!(list->head = job->next))
+            list->tail = NULL;
+        job->next = NULL;
+    }
+    return job;
+}
+
+
+static void
+virThreadPoolJobListClear(virThreadPoolJobListPtr list)
+{
+    virThreadPoolJobPtr job;
+
+    while ((job = virThreadPoolJobListPop(list)))
+        VIR_FREE(job);
+}
+
+
+/* Account for a newly queued job */
+static void
+virThreadPoolJobQueued(virThreadPoolPtr pool)
+{
+    int depth = virAtomicIntInc(&pool->jobQueueDepth);
+    int max;
+
+    virAtomicIntInc(&pool->jobsPending);
+
+    while ((max = virAtomicIntGet(&pool->jobQueueDepthMax)) < depth &&
+           !virAtomicIntCompareExchange(&pool->jobQueueDepthMax, max, depth))
+        ;
+}
+
+
+static void
+virThreadPoolRunJob(virThreadPoolPtr pool,
+                    virThreadPoolJobPtr job,
+                    virMutexPtr lock,
+                    virThreadPoolCountersPtr counters,
+                    bool stolen)
+{
+    unsigned long long start = virThreadPoolTimeNow();
+    unsigned long long end;
+    unsigned long long wait = start > job->queued ? start - job->queued : 0;
+
+    (pool->jobFunc)(job->data, pool->jobOpaque);
+    VIR_FREE(job);
+
+    end = virThreadPoolTimeNow();
+
+    virMutexLock(lock);
+    counters->jobsDone++;
+    if (stolen)
+        counters->jobsStolen++;
+    counters->waitTotal += wait;
+    if (wait > counters->waitMax)
+        counters->waitMax = wait;
+    if (end > start)
+        counters->runTotal += end - start;
+    virMutexUnlock(lock);
+
+    if (virAtomicIntDecAndTest(&pool->jobsPending)) {
+        virMutexLock(&pool->mutex);
+        virCondBroadcast(&pool->drain_cond);
+        virMutexUnlock(&pool->mutex);
+    }
+}
+
+
+/* Called with worker->lock held */
+static virThreadPoolJobPtr
+virThreadPoolWorkerPop(virThreadPoolWorkerPtr worker)
+{
+    virThreadPoolJobPtr job = virThreadPoolJobListPop(&worker->jobs);
+
+    if (job) {
+        virAtomicIntAdd(&worker->njobs, -1);
+        virAtomicIntAdd(&worker->pool->jobQueueDepth, -1);
+    }
+    return job;
+}
+
+
+/*
+ * Find the next job for @self: its own queue comes first, then
+ * the priority lane, and finally the queues of the other workers.
+ */
+static virThreadPoolJobPtr
+virThreadPoolTakeJob(virThreadPoolPtr pool,
+                     virThreadPoolWorkerPtr self,
+                     bool *stolen)
+{
+    virThreadPoolJobPtr job;
+    size_t i;
+
+    *stolen = false;
+
+    virMutexLock(&self->lock);
+    job = virThreadPoolWorkerPop(self);
+    virMutexUnlock(&self->lock);
+    if (job)
+        return job;
+
+    if (virAtomicIntGet(&pool->nPrioJobs) > 0) {
+        virMutexLock(&pool->mutex);
+        if ((job = virThreadPoolJobListPop(&pool->prioJobs))) {
+            virAtomicIntAdd(&pool->nPrioJobs, -1);
+            virAtomicIntAdd(&pool->jobQueueDepth, -1);
+        }
+        virMutexUnlock(&pool->mutex);
+        if (job)
+            return job;
+    }
+
+    for (i = 1; i < pool->nslots; i++) {
+        virThreadPoolWorkerPtr victim =
+            &pool->workers[(self->id + i) % pool->nslots];
+
+        if (!virAtomicIntGet(&victim->njobs))
+            continue;
+
+        virMutexLock(&victim->lock);
+        job = virThreadPoolWorkerPop(victim);
+        virMutexUnlock(&victim->lock);
+        if (job) {
+            *stolen = true;
+            return job;
         }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Mark @worker as gone. Unless @force is set this only happens
+ * if the pool can spare it, ie. there are more than minWorkers
+ * running and no queued jobs, not even on the queues of busy
+ * workers which it could steal from. Returns true if the worker
+ * must exit, in which case it must not touch the pool anymore.
+ */
+static bool
+virThreadPoolWorkerExit(virThreadPoolPtr pool,
+                        virThreadPoolWorkerPtr worker,
+                        bool force)
+{
+    virMutexLock(&pool->mutex);
+    virMutexLock(&worker->lock);
+
+    if (!force &&
+        ((size_t)virAtomicIntGet(&pool->nWorkers) <= pool->minWorkers ||
+         virAtomicIntGet(&pool->jobQueueDepth))) {
+        virMutexUnlock(&worker->lock);
+        virMutexUnlock(&pool->mutex);
+        return false;
+    }
 
-        if (pool->quit)
+    virAtomicIntSet(&worker->alive, 0);
+    virMutexUnlock(&worker->lock);
+
+    if (virAtomicIntDecAndTest(&pool->nWorkers) && pool->nPrioRunning == 0)
+        virCondSignal(&pool->quit_cond);
+    virMutexUnlock(&pool->mutex);
+    return true;
+}
+
+
+/*
+ * Sleep until virThreadPoolSendJob hands us some work. Returns 0
+ * when there may be jobs to run, or -1 if the worker has been
+ * retired, either because the pool is going away or because it
+ * has been idle for long enough.
+ */
+static int
+virThreadPoolWorkerWait(virThreadPoolPtr pool,
+                        virThreadPoolWorkerPtr worker)
+{
+    unsigned long long deadline;
+    bool timedout = false;
+
+    if (virTimeMillisNow(&deadline) < 0)
+        deadline = 0;
+    deadline += virAtomicIntGet(&pool->idleTimeout);
+
+    virMutexLock(&worker->lock);
+    virAtomicIntSet(&worker->idle, 1);
+    virAtomicIntInc(&pool->freeWorkers);
+
+    /* A job submitted after we last looked at the queues, but
+     * before we were marked idle, would not wake us up, hence
+     * the check on the queue depth */
+    while (virAtomicIntGet(&worker->idle) &&
+           !virAtomicIntGet(&pool->quit) &&
+           !virAtomicIntGet(&pool->jobQueueDepth)) {
+        if (virCondWaitUntil(&worker->cond, &worker->lock, deadline) < 0) {
+            timedout = true;
             break;
+        }
+    }
+
+    if (virAtomicIntGet(&worker->idle)) {
+        virAtomicIntSet(&worker->idle, 0);
+        virAtomicIntAdd(&pool->freeWorkers, -1);
+    }
+    virMutexUnlock(&worker->lock);
+
+    if (virAtomicIntGet(&pool->quit)) {
+        virThreadPoolWorkerExit(pool, worker, true);
+        return -1;
+    }
 
-        if (priority) {
-            job = pool->jobList.firstPrio;
-        } else {
-            job = pool->jobList.head;
+    if (timedout && virThreadPoolWorkerExit(pool, worker, false))
+        return -1;
+
+    return 0;
+}
+
+
+static void virThreadPoolWorkerRun(void *opaque)
+{
+    virThreadPoolWorkerPtr worker = opaque;
+    virThreadPoolPtr pool = worker->pool;
+    virThreadPoolJobPtr job;
+    bool stolen;
+
+    while (1) {
+        if (!virAtomicIntGet(&pool->quit) &&
+            (job = virThreadPoolTakeJob(pool, worker, &stolen))) {
+            virThreadPoolRunJob(pool, job, &worker->lock,
+                                &worker->counters, stolen);
+            continue;
         }
 
-        if (job == pool->jobList.firstPrio) {
-            virThreadPoolJobPtr tmp = job->next;
-            while (tmp) {
-                if (tmp->priority) {
-                    break;
-                }
-                tmp = tmp->next;
-            }
-            pool->jobList.firstPrio = tmp;
+        if (virThreadPoolWorkerWait(pool, worker) < 0)
+            return;
+    }
+}
+
+
+static void virThreadPoolPrioWorkerRun(void *opaque)
+{
+    virThreadPoolPtr pool = opaque;
+    virThreadPoolJobPtr job;
+
+    virMutexLock(&pool->mutex);
+
+    while (1) {
+        while (!virAtomicIntGet(&pool->quit) && !pool->prioJobs.head) {
+            if (virCondWait(&pool->prioCond, &pool->mutex) < 0)
+                goto out;
         }
 
-        if (job->prev)
-            job->prev->next = job->next;
-        else
-            pool->jobList.head = job->next;
-        if (job->next)
-            job->next->prev = job->prev;
-        else
-            pool->jobList.tail = job->prev;
+        if (virAtomicIntGet(&pool->quit))
+            break;
 
-        pool->jobQueueDepth--;
+        job = virThreadPoolJobListPop(&pool->prioJobs);
+        virAtomicIntAdd(&pool->nPrioJobs, -1);
+        virAtomicIntAdd(&pool->jobQueueDepth, -1);
 
         virMutexUnlock(&pool->mutex);
-        (pool->jobFunc)(job->data, pool->jobOpaque);
-        VIR_FREE(job);
+        virThreadPoolRunJob(pool, job, &pool->mutex,
+                            &pool->prioCounters, false);
         virMutexLock(&pool->mutex);
     }
 
 out:
-    if (priority)
-        pool->nPrioWorkers--;
-    else
-        pool->nWorkers--;
-    if (pool->nWorkers == 0 && pool->nPrioWorkers==0)
+    pool->nPrioRunning--;
+    if (virAtomicIntGet(&pool->nWorkers) == 0 && pool->nPrioRunning == 0)
         virCondSignal(&pool->quit_cond);
     virMutexUnlock(&pool->mutex);
 }
 
+
+/* Start a worker in an unused slot. Called with pool->mutex held */
+static virThreadPoolWorkerPtr
+virThreadPoolSpawnWorker(virThreadPoolPtr pool)
+{
+    virThreadPoolWorkerPtr worker = NULL;
+    size_t i;
+
+    for (i = 0; i < pool->nslots; i++) {
+        if (!virAtomicIntGet(&pool->workers[i].alive)) {
+            worker = &pool->workers[i];
+            break;
+        }
+    }
+    if (!worker)
+        return NULL;
+
+    virMutexLock(&worker->lock);
+    virAtomicIntSet(&worker->alive, 1);
+    virMutexUnlock(&worker->lock);
+
+    if (virThreadCreate(&worker->thread,
+                        false,
+                        virThreadPoolWorkerRun,
+                        worker) < 0) {
+        virMutexLock(&worker->lock);
+        virAtomicIntSet(&worker->alive, 0);
+        virMutexUnlock(&worker->lock);
+        return NULL;
+    }
+
+    virAtomicIntInc(&pool->nWorkers);
+    return worker;
+}
+
+
+/* Choose a queue for a new job, preferring a worker that is idle */
+static virThreadPoolWorkerPtr
+virThreadPoolPickWorker(virThreadPoolPtr pool)
+{
+    unsigned int start = virAtomicIntInc(&pool->nextWorker);
+    size_t i;
+
+    if (virAtomicIntGet(&pool->freeWorkers) > 0) {
+        for (i = 0; i < pool->nslots; i++) {
+            virThreadPoolWorkerPtr worker =
+                &pool->workers[(start + i) % pool->nslots];
+            if (virAtomicIntGet(&worker->idle))
+                return worker;
+        }
+    }
+
+    for (i = 0; i < pool->nslots; i++) {
+        virThreadPoolWorkerPtr worker =
+            &pool->workers[(start + i) % pool->nslots];
+        if (virAtomicIntGet(&worker->alive))
+            return worker;
+    }
+
+    return NULL;
+}
+
+
+/* Queue @job on @worker, unless it has exited meanwhile */
+static int
+virThreadPoolPushJob(virThreadPoolPtr pool,
+                     virThreadPoolWorkerPtr worker,
+                     virThreadPoolJobPtr job)
+{
+    virMutexLock(&worker->lock);
+    if (!virAtomicIntGet(&worker->alive)) {
+        virMutexUnlock(&worker->lock);
+        return -1;
+    }
+    virThreadPoolJobListAppend(&worker->jobs, job);
+    virAtomicIntInc(&worker->njobs);
+    virThreadPoolJobQueued(pool);
+    virMutexUnlock(&worker->lock);
+    return 0;
+}
+
+
+/* Queue @job on the priority lane. Called with pool->mutex held */
+static void
+virThreadPoolPushPrioJob(virThreadPoolPtr pool,
+                         virThreadPoolJobPtr job)
+{
+    virThreadPoolJobListAppend(&pool->prioJobs, job);
+    virAtomicIntInc(&pool->nPrioJobs);
+    virThreadPoolJobQueued(pool);
+    virCondSignal(&pool->prioCond);
+}
+
+
+/* Claim @worker if it is idle and wake it up */
+static bool
+virThreadPoolWakeWorker(virThreadPoolPtr pool,
+                        virThreadPoolWorkerPtr worker)
+{
+    bool woken = false;
+
+    if (!virAtomicIntGet(&worker->idle))
+        return false;
+
+    virMutexLock(&worker->lock);
+    if (virAtomicIntGet(&worker->idle)) {
+        virAtomicIntSet(&worker->idle, 0);
+        virAtomicIntAdd(&pool->freeWorkers, -1);
+        virCondSignal(&worker->cond);
+        woken = true;
+    }
+    virMutexUnlock(&worker->lock);
+    return woken;
+}
+
+
+static void
+virThreadPoolWakeAny(virThreadPoolPtr pool,
+                     virThreadPoolWorkerPtr preferred)
+{
+    size_t i;
+
+    if (preferred && virThreadPoolWakeWorker(pool, preferred))
+        return;
+
+    if (!virAtomicIntGet(&pool->freeWorkers))
+        return;
+
+    for (i = 0; i < pool->nslots; i++) {
+        if (virThreadPoolWakeWorker(pool, &pool->workers[i]))
+            return;
+    }
+}
+
+
 virThreadPoolPtr virThreadPoolNew(size_t minWorkers,
                                   size_t maxWorkers,
                                   size_t prioWorkers,
@@ -164,7 +575,6 @@ virThreadPoolPtr virThreadPoolNew(size_t minWorkers,
 {
     virThreadPoolPtr pool;
     size_t i;
-    struct virThreadPoolWorkerData *data = NULL;
 
     if (minWorkers > maxWorkers)
         minWorkers = maxWorkers;
@@ -174,70 +584,73 @@ virThreadPoolPtr virThreadPoolNew(size_t minWorkers,
         return NULL;
     }
 
-    pool->jobList.tail = pool->jobList.head = NULL;
-
     pool->jobFunc = func;
     pool->jobOpaque = opaque;
 
     if (virMutexInit(&pool->mutex) < 0)
         goto error;
-    if (virCondInit(&pool->cond) < 0)
-        goto error;
     if (virCondInit(&pool->quit_cond) < 0)
         goto error;
+    if (virCondInit(&pool->drain_cond) < 0)
+        goto error;
+    if (virCondInit(&pool->prioCond) < 0)
+        goto error;
 
-    if (VIR_ALLOC_N(pool->workers, minWorkers) < 0)
+    if (VIR_ALLOC_N(pool->workers, maxWorkers) < 0) {
+        virReportOOMError();
         goto error;
+    }
 
     pool->minWorkers = minWorkers;
     pool->maxWorkers = maxWorkers;
+    pool->idleTimeout = VIR_THREAD_POOL_IDLE_TIMEOUT;
 
-    for (i = 0; i < minWorkers; i++) {
-        if (VIR_ALLOC(data) < 0) {
-            virReportOOMError();
+    for (i = 0; i < maxWorkers; i++) {
+        virThreadPoolWorkerPtr worker = &pool->workers[i];
+
+        worker->pool = pool;
+        worker->id = i;
+        if (virMutexInit(&worker->lock) < 0)
+            goto error;
+        if (virCondInit(&worker->cond) < 0) {
+            virMutexDestroy(&worker->lock);
             goto error;
         }
-        data->pool = pool;
-        data->cond = &pool->cond;
+        pool->nslots++;
+    }
 
-        if (virThreadCreate(&pool->workers[i],
-                            true,
-                            virThreadPoolWorker,
-                            data) < 0) {
+    virMutexLock(&pool->mutex);
+    for (i = 0; i < minWorkers; i++) {
+        if (!virThreadPoolSpawnWorker(pool)) {
+            virMutexUnlock(&pool->mutex);
             goto error;
         }
-        pool->nWorkers++;
     }
+    virMutexUnlock(&pool->mutex);
 
     if (prioWorkers) {
-        if (virCondInit(&pool->prioCond) < 0)
-            goto error;
-        if (VIR_ALLOC_N(pool->prioWorkers, prioWorkers) < 0)
+        if (VIR_ALLOC_N(pool->prioWorkers, prioWorkers) < 0) {
+            virReportOOMError();
             goto error;
+        }
 
         for (i = 0; i < prioWorkers; i++) {
-            if (VIR_ALLOC(data) < 0) {
-                virReportOOMError();
-                goto error;
-            }
-            data->pool = pool;
-            data->cond = &pool->prioCond;
-            data->priority = true;
-
             if (virThreadCreate(&pool->prioWorkers[i],
                                 true,
-                                virThreadPoolWorker,
-                                data) < 0) {
+                                virThreadPoolPrioWorkerRun,
+                                pool) < 0) {
                 goto error;
             }
+            virMutexLock(&pool->mutex);
             pool->nPrioWorkers++;
+            pool->nPrioRunning++;
+            virMutexUnlock(&pool->mutex);
         }
     }
 
     return pool;
 
 error:
-    VIR_FREE(data);
     virThreadPoolFree(pool);
     return NULL;
 
@@ -245,42 +658,59 @@ error:
 
 void virThreadPoolFree(virThreadPoolPtr pool)
 {
-    virThreadPoolJobPtr job;
-    bool priority = false;
+    size_t i;
 
     if (!pool)
         return;
 
     virMutexLock(&pool->mutex);
-    pool->quit = true;
-    if (pool->nWorkers > 0)
-        virCondBroadcast(&pool->cond);
-    if (pool->nPrioWorkers > 0) {
-        priority = true;
-        virCondBroadcast(&pool->prioCond);
+    virAtomicIntSet(&pool->quit, 1);
+    for (i = 0; i < pool->nslots; i++) {
+        virMutexLock(&pool->workers[i].lock);
+        virCondSignal(&pool->workers[i].cond);
+        virMutexUnlock(&pool->workers[i].lock);
     }
+    if (pool->nPrioRunning > 0)
+        virCondBroadcast(&pool->prioCond);
 
-    while (pool->nWorkers > 0 || pool->nPrioWorkers > 0)
+    while (virAtomicIntGet(&pool->nWorkers) > 0 || pool->nPrioRunning > 0)
         ignore_value(virCondWait(&pool->quit_cond, &pool->mutex));
 
-    while ((job = pool->jobList.head)) {
-        pool->jobList.head = pool->jobList.head->next;
-        VIR_FREE(job);
-    }
+    virThreadPoolJobListClear(&pool->prioJobs);
+    virMutexUnlock(&pool->mutex);
 
+    for (i = 0; i < pool->nslots; i++) {
+        virThreadPoolJobListClear(&pool->workers[i].jobs);
+        virMutexDestroy(&pool->workers[i].lock);
+        ignore_value(virCondDestroy(&pool->workers[i].cond));
+    }
     VIR_FREE(pool->workers);
-    virMutexUnlock(&pool->mutex);
+    VIR_FREE(pool->prioWorkers);
+
     virMutexDestroy(&pool->mutex);
     ignore_value(virCondDestroy(&pool->quit_cond));
-    ignore_value(virCondDestroy(&pool->cond));
-    if (priority) {
-        VIR_FREE(pool->prioWorkers);
-        ignore_value(virCondDestroy(&pool->prioCond));
-    }
+    ignore_value(virCondDestroy(&pool->drain_cond));
+    ignore_value(virCondDestroy(&pool->prioCond));
     VIR_FREE(pool);
 }
 
 
+/*
+ * Wait until every job sent to the pool so far has run. Unlike
+ * virThreadPoolFree, which drops whatever is still queued, this
+ * gives the jobs a chance to release what they were handed. Must
+ * not be called from a job of @pool, and nothing must send jobs
+ * to @pool meanwhile if it is to return.
+ */
+void virThreadPoolDrain(virThreadPoolPtr pool)
+{
+    virMutexLock(&pool->mutex);
+    while (virAtomicIntGet(&pool->jobsPending) > 0)
+        ignore_value(virCondWait(&pool->drain_cond, &pool->mutex));
+    virMutexUnlock(&pool->mutex);
+}
+
+
 size_t virThreadPoolGetMinWorkers(virThreadPoolPtr pool)
 {
     return pool->minWorkers;
@@ -296,6 +726,52 @@ size_t virThreadPoolGetPriorityWorkers(virThreadPoolPtr pool)
     return pool->nPrioWorkers;
 }
 
+/*
+ * Set how long, in milliseconds, a worker above the minimum may sit
+ * idle before it exits. Workers already waiting keep their deadline.
+ */
+void virThreadPoolSetIdleTimeout(virThreadPoolPtr pool,
+                                 unsigned int timeout)
+{
+    virAtomicIntSet(&pool->idleTimeout, timeout);
+}
+
+static void
+virThreadPoolCountersAdd(virThreadPoolStatsPtr stats,
+                         virThreadPoolCountersPtr counters)
+{
+    stats->jobsDone += counters->jobsDone;
+    stats->jobsStolen += counters->jobsStolen;
+    stats->waitTotal += counters->waitTotal;
+    if (counters->waitMax > stats->waitMax)
+        stats->waitMax = counters->waitMax;
+    stats->runTotal += counters->runTotal;
+}
+
+void virThreadPoolGetStats(virThreadPoolPtr pool,
+                           virThreadPoolStatsPtr stats)
+{
+    size_t i;
+
+    memset(stats, 0, sizeof(*stats));
+
+    virMutexLock(&pool->mutex);
+    stats->workers = virAtomicIntGet(&pool->nWorkers);
+    stats->prioWorkers = pool->nPrioRunning;
+    virThreadPoolCountersAdd(stats, &pool->prioCounters);
+
+    for (i = 0; i < pool->nslots; i++) {
+        virMutexLock(&pool->workers[i].lock);
+        virThreadPoolCountersAdd(stats, &pool->workers[i].counters);
+        virMutexUnlock(&pool->workers[i].lock);
+    }
+    virMutexUnlock(&pool->mutex);
+
+    stats->freeWorkers = virAtomicIntGet(&pool->freeWorkers);
+    stats->jobQueueDepth = virAtomicIntGet(&pool->jobQueueDepth);
+    stats->jobQueueDepthMax = virAtomicIntGet(&pool->jobQueueDepthMax);
+}
+
 /*
  * @priority - job priority
  * Return: 0 on success, -1 otherwise
@@ -305,67 +781,66 @@ int virThreadPoolSendJob(virThreadPoolPtr pool,
                          void *jobData)
 {
     virThreadPoolJobPtr job;
-    struct virThreadPoolWorkerData *data = NULL;
+    virThreadPoolWorkerPtr worker = NULL;
 
-    virMutexLock(&pool->mutex);
-    if (pool->quit)
-        goto error;
-
-    if (pool->freeWorkers - pool->jobQueueDepth <= 0 &&
-        pool->nWorkers < pool->maxWorkers) {
-        if (VIR_EXPAND_N(pool->workers, pool->nWorkers, 1) < 0) {
-            virReportOOMError();
-            goto error;
-        }
-
-        if (VIR_ALLOC(data) < 0) {
-            pool->nWorkers--;
-            virReportOOMError();
-            goto error;
-        }
-
-        data->pool = pool;
-        data->cond = &pool->cond;
-
-        if (virThreadCreate(&pool->workers[pool->nWorkers - 1],
-                            true,
-                            virThreadPoolWorker,
-                            data) < 0) {
-            VIR_FREE(data);
-            pool->nWorkers--;
-            goto error;
-        }
-    }
+    if (virAtomicIntGet(&pool->quit))
+        return -1;
 
     if (VIR_ALLOC(job) < 0) {
         virReportOOMError();
-        goto error;
+        return -1;
     }
 
     job->data = jobData;
     job->priority = priority;
+    job->queued = virThreadPoolTimeNow();
 
-    job->prev = pool->jobList.tail;
-    if (pool->jobList.tail)
-        pool->jobList.tail->next = job;
-    pool->jobList.tail = job;
-
-    if (!pool->jobList.head)
-        pool->jobList.head = job;
+    if (virAtomicIntGet(&pool->freeWorkers) <=
+        virAtomicIntGet(&pool->jobQueueDepth) &&
+        (size_t)virAtomicIntGet(&pool->nWorkers) < pool->maxWorkers) {
+        virMutexLock(&pool->mutex);
+        if (!virAtomicIntGet(&pool->quit) &&
+            (size_t)virAtomicIntGet(&pool->nWorkers) < pool->maxWorkers)
+            worker = virThreadPoolSpawnWorker(pool);
+
+        /* Queue the job before letting go of pool->mutex: a worker
+         * can't retire without it, so the new one is sure to see
+         * the job rather than time out first. It looks at its own
+         * queue and the priority lane before sleeping, so there is
+         * no need to wake it up */
+        if (worker) {
+            if (priority)
+                virThreadPoolPushPrioJob(pool, job);
+            else
+                ignore_value(virThreadPoolPushJob(pool, worker, job));
+            virMutexUnlock(&pool->mutex);
+            return 0;
+        }
+        virMutexUnlock(&pool->mutex);
+    }
 
-    if (priority && !pool->jobList.firstPrio)
-        pool->jobList.firstPrio = job;
+    if (priority) {
+        virMutexLock(&pool->mutex);
+        if (virAtomicIntGet(&pool->quit)) {
+            virMutexUnlock(&pool->mutex);
+            goto error;
+        }
+        virThreadPoolPushPrioJob(pool, job);
+        virMutexUnlock(&pool->mutex);
 
-    pool->jobQueueDepth++;
+        virThreadPoolWakeAny(pool, NULL);
+        return 0;
+    }
 
-    virCondSignal(&pool->cond);
-    if (priority)
-        virCondSignal(&pool->prioCond);
+    do {
+        if (!(worker = virThreadPoolPickWorker(pool)))
+            goto error;
+    } while (virThreadPoolPushJob(pool, worker, job) < 0);
 
-    virMutexUnlock(&pool->mutex);
+    virThreadPoolWakeAny(pool, worker);
     return 0;
 
 error:
-    virMutexUnlock(&pool->mutex);
+    VIR_FREE(job);
     return -1;
 }
@@ -33,6 +33,24 @@ typedef virThreadPool *virThreadPoolPtr;
 
 typedef void (*virThreadPoolJobFunc)(void *jobdata, void *opaque);
 
+typedef struct _virThreadPoolStats virThreadPoolStats;
+typedef virThreadPoolStats *virThreadPoolStatsPtr;
+
+/* Times are in microseconds */
+struct _virThreadPoolStats {
+    size_t workers;             /* Workers currently running */
+    size_t freeWorkers;         /* Workers waiting for a job */
+    size_t prioWorkers;         /* Priority workers running */
+    size_t jobQueueDepth;       /* Jobs waiting for a worker */
+    size_t jobQueueDepthMax;    /* Highest jobQueueDepth seen */
+    unsigned long long jobsDone;
+    unsigned long long jobsStolen; /* Jobs run by a worker other than
+                                    * the one they were queued on */
+    unsigned long long waitTotal;  /* Time jobs spent queued */
+    unsigned long long waitMax;
+    unsigned long long runTotal;   /* Time spent running jobs */
+};
+
 virThreadPoolPtr virThreadPoolNew(size_t minWorkers,
                                   size_t maxWorkers,
                                   size_t prioWorkers,
@@ -42,7 +60,13 @@ virThreadPoolPtr virThreadPoolNew(size_t minWorkers,
 size_t virThreadPoolGetMinWorkers(virThreadPoolPtr pool);
 size_t virThreadPoolGetMaxWorkers(virThreadPoolPtr pool);
 size_t virThreadPoolGetPriorityWorkers(virThreadPoolPtr pool);
+void virThreadPoolSetIdleTimeout(virThreadPoolPtr pool,
+                                 unsigned int timeout);
+void virThreadPoolGetStats(virThreadPoolPtr pool,
+                           virThreadPoolStatsPtr stats)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
 
+void virThreadPoolDrain(virThreadPoolPtr pool) ATTRIBUTE_NONNULL(1);
 void virThreadPoolFree(virThreadPoolPtr pool);
 
 int virThreadPoolSendJob(virThreadPoolPtr pool,
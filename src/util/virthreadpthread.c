@@ -91,6 +91,37 @@ void virMutexUnlock(virMutexPtr m)
 }
 
 
+int virRWLockInit(virRWLockPtr l)
+{
+    int ret;
+    if ((ret = pthread_rwlock_init(&l->lock, NULL)) != 0) {
+        errno = ret;
+        return -1;
+    }
+    return 0;
+}
+
+void virRWLockDestroy(virRWLockPtr l)
+{
+    pthread_rwlock_destroy(&l->lock);
+}
+
+void virRWLockRead(virRWLockPtr l)
+{
+    pthread_rwlock_rdlock(&l->lock);
+}
+
+void virRWLockWrite(virRWLockPtr l)
+{
+    pthread_rwlock_wrlock(&l->lock);
+}
+
+void virRWLockUnlock(virRWLockPtr l)
+{
+    pthread_rwlock_unlock(&l->lock);
+}
+
+
 int virCondInit(virCondPtr c)
 {
     int ret;
@@ -127,7 +158,7 @@ int virCondWaitUntil(virCondPtr c, virMutexPtr m, unsigned long long whenms)
     struct timespec ts;
 
     ts.tv_sec = whenms / 1000;
-    ts.tv_nsec = (whenms % 1000) * 1000;
+    ts.tv_nsec = (whenms % 1000) * 1000 * 1000;
 
     if ((ret = pthread_cond_timedwait(&c->cond, &m->lock, &ts)) != 0) {
         errno = ret;
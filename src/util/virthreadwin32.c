@@ -121,6 +121,32 @@ void virMutexUnlock(virMutexPtr m)
 }
 
 
+int virRWLockInit(virRWLockPtr l)
+{
+    return virMutexInit(&l->lock);
+}
+
+void virRWLockDestroy(virRWLockPtr l)
+{
+    virMutexDestroy(&l->lock);
+}
+
+void virRWLockRead(virRWLockPtr l)
+{
+    virMutexLock(&l->lock);
+}
+
+void virRWLockWrite(virRWLockPtr l)
+{
+    virMutexLock(&l->lock);
+}
+
+void virRWLockUnlock(virRWLockPtr l)
+{
+    virMutexUnlock(&l->lock);
+}
+
+
 
 int virCondInit(virCondPtr c)
 {
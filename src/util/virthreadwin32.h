@@ -30,6 +30,12 @@ struct virMutex {
     HANDLE lock;
 };
 
+/* Slim reader/writer locks are not available before Vista, so
+ * readers are serialized like writers */
+struct virRWLock {
+    virMutex lock;
+};
+
 struct virCond {
     virMutex lock;
     unsigned int nwaiters;
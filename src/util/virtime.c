@@ -79,6 +79,38 @@ int virTimeMillisNowRaw(unsigned long long *now)
 }
 
 
+/**
+ * virTimeMicrosMonotonicRaw:
+ * @now: filled with the current time in microseconds
+ *
+ * Retrieves a timestamp in microseconds from a clock which is not
+ * affected by changes to the system time, for measuring intervals.
+ * Where no such clock exists, the system time is used.
+ *
+ * Returns 0 on success, -1 on error with errno set
+ */
+int virTimeMicrosMonotonicRaw(unsigned long long *now)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+        return -1;
+
+    *now = (ts.tv_sec * 1000000ull) + (ts.tv_nsec / 1000ull);
+#else
+    struct timeval tv;
+
+    if (gettimeofday(&tv, NULL) < 0)
+        return -1;
+
+    *now = (tv.tv_sec * 1000000ull) + tv.tv_usec;
+#endif
+
+    return 0;
+}
+
+
 /**
  * virTimeFieldsNowRaw:
  * @fields: filled with current time fields
@@ -148,6 +148,7 @@ vmwareLoadDomains(struct vmware_driver *driver)
     char *directoryName = NULL;
     char *fileName = NULL;
     int ret = -1;
+    int pid;
     virVMXContext ctx;
     char *outbuf = NULL;
     char *str;
@@ -191,8 +192,9 @@ vmwareLoadDomains(struct vmware_driver *driver)
 
         vmwareDomainConfigDisplay(pDomain, vmdef);
 
-        if ((vm->def->id = vmwareExtractPid(vmxPath)) < 0)
+        if ((pid = vmwareExtractPid(vmxPath)) < 0)
             goto cleanup;
+        virDomainObjListSetID(&driver->domains, vm, pid);
         /* vmrun list only reports running vms */
         virDomainObjSetState(vm, VIR_DOMAIN_RUNNING,
                              VIR_DOMAIN_RUNNING_UNKNOWN);
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include "testutils.h"
+#include "daemon/eventbatch.h"
+#include "viralloc.h"
+#include "virerror.h"
+#include "viruuid.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define TEST_EVENT_PROC 42
+#define NEVENTS (REMOTE_DOMAIN_EVENT_BATCH_MAX + 10)
+
+struct testEvent {
+    int id;
+    bool huge;              /* Too large to fit in a batch */
+    size_t nfree;
+};
+
+/* What reached the client */
+static int received[NEVENTS];
+static size_t nreceived;
+static size_t nbatches;
+static size_t nalone;
+
+static struct testEvent events[NEVENTS];
+
+static bool_t
+testEventFilter(XDR *xdr, struct testEvent *ev)
+{
+    static char pad[REMOTE_DOMAIN_EVENT_BATCH_DATA_MAX];
+
+    if (xdr->x_op == XDR_FREE) {
+        ev->nfree++;
+        return TRUE;
+    }
+
+    if (!xdr_int(xdr, &ev->id))
+        return FALSE;
+
+    if (ev->huge) {
+        char *data = pad;
+        u_int len = sizeof(pad);
+
+        return xdr_bytes(xdr, &data, &len, sizeof(pad));
+    }
+
+    return TRUE;
+}
+
+static void
+testReceive(int id)
+{
+    if (nreceived < NEVENTS)
+        received[nreceived] = id;
+    nreceived++;
+}
+
+static void
+testSend(int procnr, xdrproc_t proc, void *data, void *opaque ATTRIBUTE_UNUSED)
+{
+    if (procnr == REMOTE_PROC_DOMAIN_EVENT_BATCH) {
+        remote_domain_event_batch_msg *msg = data;
+        size_t i;
+
+        nbatches++;
+        for (i = 0 ; i < msg->events.events_len ; i++) {
+            remote_domain_event_batch_entry *entry =
+                msg->events.events_val + i;
+            XDR xdr;
+            int id = -1;
+
+            xdrmem_create(&xdr, entry->data.data_val, entry->data.data_len,
+                          XDR_DECODE);
+            if (entry->procedure == TEST_EVENT_PROC)
+                ignore_value(xdr_int(&xdr, &id));
+            xdr_destroy(&xdr);
+            testReceive(id);
+        }
+    } else {
+        nalone++;
+        testReceive(((struct testEvent *) data)->id);
+    }
+
+    xdr_free(proc, data);
+}
+
+static void
+testReset(void)
+{
+    memset(events, 0, sizeof(events));
+    memset(received, 0, sizeof(received));
+    nreceived = nbatches = nalone = 0;
+}
+
+static int
+testQueue(daemonEventBatchPtr batch, size_t i, bool huge)
+{
+    events[i].id = i;
+    events[i].huge = huge;
+    return daemonEventBatchQueue(batch, TEST_EVENT_PROC,
+                                 (xdrproc_t)testEventFilter, &events[i],
+                                 testSend, NULL);
+}
+
+/* All of the first @n events arrived once, in order, and were freed */
+static int
+testCheck(size_t n, size_t wantBatches, size_t wantAlone)
+{
+    size_t i;
+
+    if (nreceived != n || nbatches != wantBatches || nalone != wantAlone) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "got %zu events in %zu batches and %zu alone\n",
+                    nreceived, nbatches, nalone);
+        return -1;
+    }
+
+    for (i = 0 ; i < n ; i++) {
+        if (received[i] != i || events[i].nfree != 1) {
+            if (virTestGetVerbose())
+                fprintf(stderr, "event %zu is %d, freed %zu times\n",
+                        i, received[i], events[i].nfree);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* An event sent alone must not overtake those batched before it */
+static int
+testUnbatchable(const void *data ATTRIBUTE_UNUSED)
+{
+    daemonEventBatch batch;
+    int ret = -1;
+
+    memset(&batch, 0, sizeof(batch));
+    testReset();
+
+    if (testQueue(&batch, 0, false) != 1 ||
+        testQueue(&batch, 1, false) != 1 ||
+        testCheck(0, 0, 0) < 0)
+        goto cleanup;
+
+    if (testQueue(&batch, 2, true) != 0 ||
+        testCheck(3, 1, 1) < 0)
+        goto cleanup;
+
+    if (testQueue(&batch, 3, false) != 1)
+        goto cleanup;
+    daemonEventBatchFlush(&batch, testSend, NULL);
+    if (testCheck(4, 2, 1) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    daemonEventBatchClear(&batch);
+    return ret;
+}
+
+
+/* A full batch is sent before the event which doesn't fit */
+static int
+testFull(const void *data ATTRIBUTE_UNUSED)
+{
+    daemonEventBatch batch;
+    size_t i;
+    int ret = -1;
+
+    memset(&batch, 0, sizeof(batch));
+    testReset();
+
+    for (i = 0 ; i < NEVENTS ; i++) {
+        if (testQueue(&batch, i, false) != 1)
+            goto cleanup;
+    }
+
+    if (testCheck(REMOTE_DOMAIN_EVENT_BATCH_MAX, 1, 0) < 0)
+        goto cleanup;
+
+    daemonEventBatchFlush(&batch, testSend, NULL);
+    if (testCheck(NEVENTS, 2, 0) < 0)
+        goto cleanup;
+
+    /* Nothing left to send */
+    daemonEventBatchFlush(&batch, testSend, NULL);
+    if (testCheck(NEVENTS, 2, 0) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    daemonEventBatchClear(&batch);
+    return ret;
+}
+
+
+/* Only the domains named in a filter pass it, and every domain passes
+ * without one */
+static int
+testFilter(const void *data ATTRIBUTE_UNUSED)
+{
+    remote_uuid doms[2];
+    unsigned char other[VIR_UUID_BUFLEN];
+    virHashTablePtr filter = NULL;
+    int ret = -1;
+
+    if (virUUIDParse("c7a5fdbd-edaf-9455-926a-d65c16db1809", doms[0]) < 0 ||
+        virUUIDParse("c7a5fdbd-edaf-9455-926a-d65c16db1810", doms[1]) < 0 ||
+        virUUIDParse("c7a5fdbd-edaf-9455-926a-d65c16db1811", other) < 0)
+        goto cleanup;
+
+    if (!daemonEventFilterWanted(NULL, other))
+        goto cleanup;
+
+    if (!(filter = daemonEventFilterNew(doms, 2)))
+        goto cleanup;
+
+    if (!daemonEventFilterWanted(filter, (unsigned char *) doms[0]) ||
+        !daemonEventFilterWanted(filter, (unsigned char *) doms[1]) ||
+        daemonEventFilterWanted(filter, other))
+        goto cleanup;
+
+    /* No domain passes an empty filter */
+    virHashFree(filter);
+    if (!(filter = daemonEventFilterNew(NULL, 0)) ||
+        daemonEventFilterWanted(filter, (unsigned char *) doms[0]))
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virHashFree(filter);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virtTestRun("Unbatchable event", 1, testUnbatchable, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Full batch", 1, testFull, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Event filter", 1, testFilter, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
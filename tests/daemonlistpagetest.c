@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include "testutils.h"
+#include "daemon/listpage.h"
+#include "viralloc.h"
+#include "virobject.h"
+#include "virutil.h"
+#include "virerror.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+typedef struct _testObj testObj;
+typedef testObj *testObjPtr;
+struct _testObj {
+    virObject object;
+    const char *name;
+    size_t size;
+};
+
+static virClassPtr testObjClass;
+static size_t testObjAlive;
+
+static void
+testObjDispose(void *obj ATTRIBUTE_UNUSED)
+{
+    testObjAlive--;
+}
+
+/* The objects, deliberately out of order, and their reply sizes */
+static const struct {
+    const char *name;
+    size_t size;
+} testObjs[] = {
+    { "golf", 10 }, { "alpha", 40 }, { "kilo", 10 }, { "echo", 10 },
+    { "charlie", 100 }, { "india", 10 }, { "bravo", 10 }, { "juliet", 30 },
+    { "delta", 10 }, { "hotel", 20 }, { "foxtrot", 10 },
+};
+
+static const char *testSorted[] = {
+    "alpha", "bravo", "charlie", "delta", "echo", "foxtrot",
+    "golf", "hotel", "india", "juliet", "kilo",
+};
+
+struct testParent {
+    size_t nlists;      /* Times the objects were listed */
+};
+
+static int
+testList(void *opaque, void ***objs, unsigned int flags ATTRIBUTE_UNUSED)
+{
+    struct testParent *parent = opaque;
+    testObjPtr *list = NULL;
+    size_t n = ARRAY_CARDINALITY(testObjs);
+    size_t i;
+
+    parent->nlists++;
+
+    if (VIR_ALLOC_N(list, n + 1) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    for (i = 0 ; i < n ; i++) {
+        if (!(list[i] = virObjectNew(testObjClass)))
+            goto error;
+        testObjAlive++;
+        list[i]->name = testObjs[i].name;
+        list[i]->size = testObjs[i].size;
+    }
+
+    *objs = (void **) list;
+    return n;
+
+error:
+    for (i = 0 ; i < n ; i++)
+        virObjectUnref(list[i]);
+    VIR_FREE(list);
+    return -1;
+}
+
+static const char *
+testKeyName(void *opaque, char *buf ATTRIBUTE_UNUSED, size_t *size)
+{
+    testObjPtr obj = opaque;
+
+    *size = obj->size;
+    return obj->name;
+}
+
+/* Keys formatted into the buffer, as for secrets */
+static const char *
+testKeyBuf(void *opaque, char *buf, size_t *size)
+{
+    testObjPtr obj = opaque;
+
+    *size = obj->size;
+    return virStrcpy(buf, obj->name, DAEMON_LIST_PAGE_KEY_BUFLEN);
+}
+
+static const daemonListPageOps testOpsName = { testList, testKeyName };
+static const daemonListPageOps testOpsBuf = { testList, testKeyBuf };
+
+
+struct testPagesData {
+    const daemonListPageOps *ops;
+    size_t max;
+    size_t maxBytes;
+};
+
+/*
+ * Paging through the objects returns all of them in order, only
+ * lists them once, and keeps every page within its limits unless
+ * one object alone exceeds them.
+ */
+static int
+testPages(const void *opaque)
+{
+    const struct testPagesData *data = opaque;
+    daemonListPageSnapshotPtr snapshot = NULL;
+    struct testParent parent = { 0 };
+    const char *start = NULL;
+    char *last = NULL;
+    size_t seen = 0;
+    bool more = true;
+    int ret = -1;
+
+    while (more) {
+        void **objs;
+        size_t nobjs;
+        size_t bytes = 0;
+        size_t i;
+
+        if (daemonListPage(&snapshot, data->ops, &parent, NULL, 0, start,
+                           data->max, data->maxBytes,
+                           &objs, &nobjs, &more) < 0)
+            goto cleanup;
+
+        if (nobjs == 0 || nobjs > data->max)
+            goto cleanup;
+
+        for (i = 0 ; i < nobjs ; i++) {
+            testObjPtr obj = objs[i];
+
+            if (seen >= ARRAY_CARDINALITY(testSorted) ||
+                STRNEQ(obj->name, testSorted[seen])) {
+                if (virTestGetVerbose())
+                    fprintf(stderr, "object %zu is '%s'\n", seen, obj->name);
+                goto cleanup;
+            }
+            bytes += obj->size;
+            seen++;
+        }
+
+        if (nobjs > 1 && bytes > data->maxBytes)
+            goto cleanup;
+
+        /* Like a remote client, which only knows the key */
+        VIR_FREE(last);
+        if (!(last = strdup(((testObjPtr) objs[nobjs - 1])->name))) {
+            virReportOOMError();
+            goto cleanup;
+        }
+        start = last;
+    }
+
+    if (seen != ARRAY_CARDINALITY(testSorted) || parent.nlists != 1) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "saw %zu objects, listed %zu times\n",
+                    seen, parent.nlists);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    daemonListPageSnapshotFree(snapshot);
+    VIR_FREE(last);
+    if (testObjAlive != 0) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "%zu objects leaked\n", testObjAlive);
+        ret = -1;
+    }
+    return ret;
+}
+
+
+/* Check the page in @objs holds just the object @name */
+static int
+testExpectPage(void **objs, size_t nobjs, const char *name)
+{
+    if (!name)
+        return nobjs == 0 ? 0 : -1;
+    if (nobjs != 1 || STRNEQ(((testObjPtr) objs[0])->name, name)) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "expected a page with '%s'\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * The objects are listed again whenever the request is not for the
+ * page following the previous one, and the page is still found
+ */
+static int
+testRelist(const void *opaque ATTRIBUTE_UNUSED)
+{
+    daemonListPageSnapshotPtr snapshot = NULL;
+    struct testParent parent = { 0 };
+    void **objs;
+    size_t nobjs;
+    bool more;
+    int ret = -1;
+
+    /* alpha, then bravo from the snapshot */
+    if (daemonListPage(&snapshot, &testOpsName, &parent, NULL, 0, NULL,
+                       1, 1000, &objs, &nobjs, &more) < 0 ||
+        testExpectPage(objs, nobjs, "alpha") < 0 ||
+        daemonListPage(&snapshot, &testOpsName, &parent, NULL, 0, "alpha",
+                       1, 1000, &objs, &nobjs, &more) < 0 ||
+        testExpectPage(objs, nobjs, "bravo") < 0 ||
+        parent.nlists != 1)
+        goto cleanup;
+
+    /* Going back, with other flags, another parent or other ops */
+    if (daemonListPage(&snapshot, &testOpsName, &parent, NULL, 0, "alpha",
+                       1, 1000, &objs, &nobjs, &more) < 0 ||
+        testExpectPage(objs, nobjs, "bravo") < 0 ||
+        parent.nlists != 2 ||
+        daemonListPage(&snapshot, &testOpsName, &parent, NULL, 1, "bravo",
+                       1, 1000, &objs, &nobjs, &more) < 0 ||
+        testExpectPage(objs, nobjs, "charlie") < 0 ||
+        parent.nlists != 3 ||
+        daemonListPage(&snapshot, &testOpsName, &parent, "pool", 1, "charlie",
+                       1, 1000, &objs, &nobjs, &more) < 0 ||
+        testExpectPage(objs, nobjs, "delta") < 0 ||
+        parent.nlists != 4 ||
+        daemonListPage(&snapshot, &testOpsBuf, &parent, "pool", 1, "delta",
+                       1, 1000, &objs, &nobjs, &more) < 0 ||
+        testExpectPage(objs, nobjs, "echo") < 0 ||
+        parent.nlists != 5)
+        goto cleanup;
+
+    /* Starting afresh while a listing is in progress */
+    if (daemonListPage(&snapshot, &testOpsBuf, &parent, "pool", 1, NULL,
+                       1, 1000, &objs, &nobjs, &more) < 0 ||
+        testExpectPage(objs, nobjs, "alpha") < 0 ||
+        parent.nlists != 6)
+        goto cleanup;
+
+    /* A key between objects, or past them all */
+    if (daemonListPage(&snapshot, &testOpsBuf, &parent, "pool", 1, "hotels",
+                       1, 1000, &objs, &nobjs, &more) < 0 ||
+        testExpectPage(objs, nobjs, "india") < 0 || !more ||
+        daemonListPage(&snapshot, &testOpsBuf, &parent, "pool", 1, "zulu",
+                       1, 1000, &objs, &nobjs, &more) < 0 ||
+        testExpectPage(objs, nobjs, NULL) < 0 || more)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    daemonListPageSnapshotFree(snapshot);
+    if (testObjAlive != 0) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "%zu objects leaked\n", testObjAlive);
+        ret = -1;
+    }
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (!(testObjClass = virClassNew(virClassForObject(), "testObj",
+                                     sizeof(testObj), testObjDispose)))
+        return EXIT_FAILURE;
+
+#define DO_TEST_PAGES(name, ops, max, maxBytes)                         \
+    do {                                                                \
+        struct testPagesData data = { ops, max, maxBytes };             \
+        if (virtTestRun("Pages " name, 1, testPages, &data) < 0)        \
+            ret = -1;                                                   \
+    } while (0)
+
+    DO_TEST_PAGES("all at once", &testOpsName, 100, 1000);
+    DO_TEST_PAGES("one at a time", &testOpsName, 1, 1000);
+    DO_TEST_PAGES("by count", &testOpsName, 3, 1000);
+    DO_TEST_PAGES("by size", &testOpsName, 100, 50);
+    DO_TEST_PAGES("smaller than objects", &testOpsName, 100, 5);
+    DO_TEST_PAGES("keys in buffer", &testOpsBuf, 4, 60);
+
+    if (virtTestRun("Relist", 1, testRelist, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include "testutils.h"
+#include "datatypes.h"
+#include "domain_event.h"
+#include "viralloc.h"
+#include "virerror.h"
+#include "viruuid.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+static const char *uuidA = "c7a5fdbd-edaf-9455-926a-d65c16db1809";
+static const char *uuidB = "c7a5fdbd-edaf-9455-926a-d65c16db1810";
+
+struct testCounter {
+    size_t calls;
+    virDomainEventStatePtr state;   /* Deregister on the first call */
+    int callbackID;
+};
+
+static void
+testRebootCallback(virConnectPtr conn,
+                   virDomainPtr dom ATTRIBUTE_UNUSED,
+                   void *opaque)
+{
+    struct testCounter *counter = opaque;
+
+    counter->calls++;
+    if (counter->state) {
+        virDomainEventStateDeregisterID(conn, counter->state,
+                                        counter->callbackID);
+        counter->state = NULL;
+    }
+}
+
+static int
+testLifecycleCallback(virConnectPtr conn ATTRIBUTE_UNUSED,
+                      virDomainPtr dom ATTRIBUTE_UNUSED,
+                      int event ATTRIBUTE_UNUSED,
+                      int detail ATTRIBUTE_UNUSED,
+                      void *opaque)
+{
+    struct testCounter *counter = opaque;
+
+    counter->calls++;
+    return 0;
+}
+
+static int
+testRegister(virConnectPtr conn,
+             virDomainEventStatePtr state,
+             virDomainPtr dom,
+             int eventID,
+             struct testCounter *counter)
+{
+    virConnectDomainEventGenericCallback cb;
+
+    if (eventID == VIR_DOMAIN_EVENT_ID_LIFECYCLE)
+        cb = VIR_DOMAIN_EVENT_CALLBACK(testLifecycleCallback);
+    else
+        cb = VIR_DOMAIN_EVENT_CALLBACK(testRebootCallback);
+
+    if (virDomainEventStateRegisterID(conn, state, dom, eventID, cb,
+                                      counter, NULL,
+                                      &counter->callbackID) < 0)
+        return -1;
+    return 0;
+}
+
+/* Queue a reboot event of @uuidstr, or a lifecycle one if @lifecycle */
+static int
+testQueue(virDomainEventStatePtr state,
+          const char *uuidstr,
+          bool lifecycle)
+{
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    virDomainEventPtr event;
+
+    if (virUUIDParse(uuidstr, uuid) < 0)
+        return -1;
+
+    if (lifecycle)
+        event = virDomainEventNew(1, "test", uuid,
+                                  VIR_DOMAIN_EVENT_STARTED,
+                                  VIR_DOMAIN_EVENT_STARTED_BOOTED);
+    else
+        event = virDomainEventRebootNew(1, "test", uuid);
+    if (!event)
+        return -1;
+
+    virDomainEventStateQueue(state, event);
+    return 0;
+}
+
+static int
+testExpectCalls(const char *what,
+                struct testCounter *counter,
+                size_t want)
+{
+    if (counter->calls != want) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "%s called %zu times, expected %zu\n",
+                    what, counter->calls, want);
+        return -1;
+    }
+    return 0;
+}
+
+static virDomainPtr
+testGetDomain(virConnectPtr conn, const char *uuidstr)
+{
+    unsigned char uuid[VIR_UUID_BUFLEN];
+
+    if (virUUIDParse(uuidstr, uuid) < 0)
+        return NULL;
+    return virGetDomain(conn, "test", uuid);
+}
+
+
+/*
+ * Events only reach the callbacks of their own type and domain, also
+ * once callbacks were added or removed since the last dispatch, or
+ * removed while dispatching.
+ */
+static int
+testCallbackIndex(const void *data ATTRIBUTE_UNUSED)
+{
+    virConnectPtr conn = NULL;
+    virDomainPtr domA = NULL;
+    virDomainPtr domB = NULL;
+    virDomainEventStatePtr state = NULL;
+    struct testCounter life = { 0 };
+    struct testCounter rebootA = { 0 };
+    struct testCounter rebootB = { 0 };
+    struct testCounter rebootAll = { 0 };
+    struct testCounter once = { 0 };
+    int ret = -1;
+
+    if (!(conn = virGetConnect()) ||
+        !(domA = testGetDomain(conn, uuidA)) ||
+        !(domB = testGetDomain(conn, uuidB)) ||
+        !(state = virDomainEventStateNew()))
+        goto cleanup;
+
+    if (testRegister(conn, state, NULL,
+                     VIR_DOMAIN_EVENT_ID_LIFECYCLE, &life) < 0 ||
+        testRegister(conn, state, domA,
+                     VIR_DOMAIN_EVENT_ID_REBOOT, &rebootA) < 0 ||
+        testRegister(conn, state, NULL,
+                     VIR_DOMAIN_EVENT_ID_REBOOT, &rebootAll) < 0)
+        goto cleanup;
+
+    if (testQueue(state, uuidA, false) < 0 ||
+        testQueue(state, uuidB, false) < 0 ||
+        testQueue(state, uuidB, true) < 0 ||
+        virEventRunDefaultImpl() < 0)
+        goto cleanup;
+
+    if (testExpectCalls("lifecycle", &life, 1) < 0 ||
+        testExpectCalls("reboot A", &rebootA, 1) < 0 ||
+        testExpectCalls("reboot", &rebootAll, 2) < 0)
+        goto cleanup;
+
+    /* The index follows changes made between dispatches */
+    if (virDomainEventStateDeregisterID(conn, state,
+                                        rebootAll.callbackID) < 0)
+        goto cleanup;
+
+    if (testQueue(state, uuidA, false) < 0 ||
+        testQueue(state, uuidB, false) < 0 ||
+        virEventRunDefaultImpl() < 0)
+        goto cleanup;
+
+    if (testExpectCalls("lifecycle", &life, 1) < 0 ||
+        testExpectCalls("reboot A", &rebootA, 2) < 0 ||
+        testExpectCalls("reboot", &rebootAll, 2) < 0)
+        goto cleanup;
+
+    if (testRegister(conn, state, domB,
+                     VIR_DOMAIN_EVENT_ID_REBOOT, &rebootB) < 0)
+        goto cleanup;
+
+    if (testQueue(state, uuidB, false) < 0 ||
+        virEventRunDefaultImpl() < 0)
+        goto cleanup;
+
+    if (testExpectCalls("reboot A", &rebootA, 2) < 0 ||
+        testExpectCalls("reboot B", &rebootB, 1) < 0)
+        goto cleanup;
+
+    /* A callback removed while dispatching gets no more events, from
+     * the same flush or later ones */
+    once.state = state;
+    if (testRegister(conn, state, NULL,
+                     VIR_DOMAIN_EVENT_ID_REBOOT, &once) < 0)
+        goto cleanup;
+
+    if (testQueue(state, uuidA, false) < 0 ||
+        testQueue(state, uuidA, false) < 0 ||
+        virEventRunDefaultImpl() < 0)
+        goto cleanup;
+
+    if (testExpectCalls("reboot A", &rebootA, 4) < 0 ||
+        testExpectCalls("one-off reboot", &once, 1) < 0)
+        goto cleanup;
+
+    if (testQueue(state, uuidA, false) < 0 ||
+        virEventRunDefaultImpl() < 0)
+        goto cleanup;
+
+    if (testExpectCalls("reboot A", &rebootA, 5) < 0 ||
+        testExpectCalls("one-off reboot", &once, 1) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virDomainEventStateFree(state);
+    if (domA)
+        virObjectUnref(domA);
+    if (domB)
+        virObjectUnref(domB);
+    if (conn)
+        virObjectUnref(conn);
+    return ret;
+}
+
+
+/* Check virDomainEventStateDomainFilter gives @want for @eventID of
+ * @conn, and the UUIDs @uuidstrs if the callbacks are restricted */
+static int
+testExpectFilter(virConnectPtr conn,
+                 virDomainEventStatePtr state,
+                 int eventID,
+                 int want,
+                 const char **uuidstrs,
+                 size_t nuuidstrs)
+{
+    unsigned char *uuids = NULL;
+    size_t nuuids = 0;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    size_t i;
+    int ret = -1;
+    int rc;
+
+    if ((rc = virDomainEventStateDomainFilter(conn, state, eventID,
+                                              &uuids, &nuuids)) != want) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "event %d filtered %d, expected %d\n",
+                    eventID, rc, want);
+        goto cleanup;
+    }
+
+    if (want != 1) {
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (nuuids != nuuidstrs)
+        goto cleanup;
+
+    for (i = 0 ; i < nuuidstrs ; i++) {
+        if (virUUIDParse(uuidstrs[i], uuid) < 0 ||
+            memcmp(uuids + i * VIR_UUID_BUFLEN, uuid, VIR_UUID_BUFLEN) != 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(uuids);
+    return ret;
+}
+
+
+/* The domains watched by the callbacks of a connection for an event
+ * type, as sent to the daemon to filter events */
+static int
+testDomainFilter(const void *data ATTRIBUTE_UNUSED)
+{
+    virConnectPtr conn1 = NULL;
+    virConnectPtr conn2 = NULL;
+    virDomainPtr domA = NULL;
+    virDomainPtr domB = NULL;
+    virDomainEventStatePtr state = NULL;
+    struct testCounter life1 = { 0 };
+    struct testCounter rebootA1 = { 0 };
+    struct testCounter rebootB1 = { 0 };
+    struct testCounter reboot2 = { 0 };
+    const char *both[] = { uuidA, uuidB };
+    int ret = -1;
+
+    if (!(conn1 = virGetConnect()) ||
+        !(conn2 = virGetConnect()) ||
+        !(domA = testGetDomain(conn1, uuidA)) ||
+        !(domB = testGetDomain(conn1, uuidB)) ||
+        !(state = virDomainEventStateNew()))
+        goto cleanup;
+
+    /* No callbacks, no events */
+    if (testExpectFilter(conn1, state, VIR_DOMAIN_EVENT_ID_REBOOT,
+                         1, NULL, 0) < 0)
+        goto cleanup;
+
+    if (testRegister(conn1, state, NULL,
+                     VIR_DOMAIN_EVENT_ID_LIFECYCLE, &life1) < 0 ||
+        testRegister(conn1, state, domA,
+                     VIR_DOMAIN_EVENT_ID_REBOOT, &rebootA1) < 0 ||
+        testRegister(conn1, state, domB,
+                     VIR_DOMAIN_EVENT_ID_REBOOT, &rebootB1) < 0 ||
+        testRegister(conn2, state, NULL,
+                     VIR_DOMAIN_EVENT_ID_REBOOT, &reboot2) < 0)
+        goto cleanup;
+
+    /* The callbacks of other connections don't widen the filter */
+    if (testExpectFilter(conn1, state, VIR_DOMAIN_EVENT_ID_REBOOT,
+                         1, both, 2) < 0 ||
+        testExpectFilter(conn1, state, VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+                         0, NULL, 0) < 0 ||
+        testExpectFilter(conn2, state, VIR_DOMAIN_EVENT_ID_REBOOT,
+                         0, NULL, 0) < 0 ||
+        testExpectFilter(conn2, state, VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+                         1, NULL, 0) < 0)
+        goto cleanup;
+
+    if (virDomainEventStateDeregisterID(conn1, state,
+                                        rebootB1.callbackID) < 0 ||
+        testExpectFilter(conn1, state, VIR_DOMAIN_EVENT_ID_REBOOT,
+                         1, both, 1) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virDomainEventStateFree(state);
+    if (domA)
+        virObjectUnref(domA);
+    if (domB)
+        virObjectUnref(domB);
+    if (conn1)
+        virObjectUnref(conn1);
+    if (conn2)
+        virObjectUnref(conn2);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virEventRegisterDefaultImpl() < 0)
+        return EXIT_FAILURE;
+
+    if (virtTestRun("Callback index", 1, testCallbackIndex, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Domain filter", 1, testDomainFilter, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "testutils.h"
+
+#include "domain_conf.h"
+#include "viralloc.h"
+#include "virthread.h"
+#include "virtime.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+/* Domains present for the whole run, with IDs 1..NDOMS */
+#define NDOMS 64
+/* Lookups done by each thread in the contention runs */
+#define ROUNDS 20000
+/* Transient domains added and removed while readers are running */
+#define NCHURN 500
+#define NREADERS 4
+
+static virDomainObjList doms;
+
+
+static void
+testMakeUUID(unsigned char *uuid, int n)
+{
+    memset(uuid, 0, VIR_UUID_BUFLEN);
+    uuid[0] = 0xab;
+    uuid[VIR_UUID_BUFLEN - 2] = (n >> 8) & 0xff;
+    uuid[VIR_UUID_BUFLEN - 1] = n & 0xff;
+}
+
+
+static virDomainObjPtr
+testAddDomain(int n, int id)
+{
+    virDomainDefPtr def;
+    virDomainObjPtr obj;
+
+    if (VIR_ALLOC(def) < 0)
+        return NULL;
+
+    if (virAsprintf(&def->name, "test%d", n) < 0) {
+        virDomainDefFree(def);
+        return NULL;
+    }
+    testMakeUUID(def->uuid, n);
+    def->id = id;
+
+    if (!(obj = virDomainAssignDef(NULL, &doms, def, false)))
+        virDomainDefFree(def);
+
+    return obj;
+}
+
+
+static int
+testLookup(const void *data ATTRIBUTE_UNUSED)
+{
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    virDomainObjPtr obj;
+    char *name = NULL;
+    int ret = -1;
+    int i;
+
+    for (i = 1; i <= NDOMS; i++) {
+        testMakeUUID(uuid, i);
+
+        if (!(obj = virDomainFindByUUID(&doms, uuid)))
+            goto cleanup;
+        if (obj->def->id != i)
+            goto unlock;
+        virObjectUnlock(obj);
+
+        if (!(obj = virDomainFindByID(&doms, i)))
+            goto cleanup;
+        if (memcmp(obj->def->uuid, uuid, VIR_UUID_BUFLEN) != 0)
+            goto unlock;
+        virObjectUnlock(obj);
+
+        if (virAsprintf(&name, "test%d", i) < 0)
+            goto cleanup;
+        if (!(obj = virDomainFindByName(&doms, name)))
+            goto cleanup;
+        if (obj->def->id != i)
+            goto unlock;
+        virObjectUnlock(obj);
+        VIR_FREE(name);
+    }
+
+    testMakeUUID(uuid, NDOMS + 1);
+    if (virDomainFindByUUID(&doms, uuid) ||
+        virDomainFindByID(&doms, NDOMS + 1) ||
+        virDomainFindByName(&doms, "nosuchdomain"))
+        goto cleanup;
+
+    if (virDomainObjListNumOfDomains(&doms, 1) != NDOMS ||
+        virDomainObjListNumOfDomains(&doms, 0) != 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(name);
+    return ret;
+
+unlock:
+    virObjectUnlock(obj);
+    goto cleanup;
+}
+
+
+static int
+testSetID(const void *data ATTRIBUTE_UNUSED)
+{
+    virDomainObjPtr obj;
+    int ret = -1;
+
+    if (!(obj = virDomainFindByID(&doms, 1)))
+        return -1;
+    virDomainObjListSetID(&doms, obj, NDOMS + 100);
+    virObjectUnlock(obj);
+
+    if (virDomainFindByID(&doms, 1))
+        goto cleanup;
+    if (!(obj = virDomainFindByID(&doms, NDOMS + 100)))
+        goto cleanup;
+    virDomainObjListSetID(&doms, obj, -1);
+    virObjectUnlock(obj);
+
+    if (virDomainFindByID(&doms, NDOMS + 100) ||
+        virDomainObjListNumOfDomains(&doms, 0) != 1)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    if ((obj = virDomainFindByName(&doms, "test1"))) {
+        virDomainObjListSetID(&doms, obj, 1);
+        virObjectUnlock(obj);
+    }
+    return ret;
+}
+
+
+static void
+testCountIter(void *payload,
+              const void *name ATTRIBUTE_UNUSED,
+              void *opaque)
+{
+    virDomainObjPtr obj = payload;
+    int *count = opaque;
+
+    /* The list must not be locked while the callback runs, so
+     * calling back into it has to work */
+    virObjectLock(obj);
+    if (virDomainObjIsActive(obj))
+        (*count)++;
+    virObjectUnlock(obj);
+
+    if (virDomainObjListNumOfDomains(&doms, 1) < 0)
+        (*count) = -1;
+}
+
+
+static int
+testForEach(const void *data ATTRIBUTE_UNUSED)
+{
+    int count = 0;
+
+    if (virDomainObjListForEach(&doms, testCountIter, &count) < 0)
+        return -1;
+
+    return count == NDOMS ? 0 : -1;
+}
+
+
+struct testWorkerData {
+    virThread thread;
+    int idx;
+    /* When set, every lookup is done with this lock held, the way
+     * API calls used to hold the whole driver lock */
+    virMutexPtr driverLock;
+    bool failed;
+};
+
+/* A stand-in for the work an API such as getInfo or dumpxml does
+ * while it holds the domain lock */
+static unsigned int
+testWorkerBusy(virDomainObjPtr obj)
+{
+    unsigned int sum = 0;
+    int i;
+    const char *p;
+
+    for (i = 0; i < 50; i++)
+        for (p = obj->def->name; *p; p++)
+            sum = sum * 31 + *p;
+
+    return sum;
+}
+
+static void
+testWorker(void *opaque)
+{
+    struct testWorkerData *data = opaque;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    virDomainObjPtr obj;
+    volatile unsigned int sink = 0;
+    int i;
+
+    for (i = 0; i < ROUNDS; i++) {
+        int n = ((i * 7 + data->idx * 13) % NDOMS) + 1;
+
+        if (data->driverLock)
+            virMutexLock(data->driverLock);
+
+        if (i % 4 == 0) {
+            obj = virDomainFindByID(&doms, n);
+        } else {
+            testMakeUUID(uuid, n);
+            obj = virDomainFindByUUID(&doms, uuid);
+        }
+
+        if (!obj || obj->def->id != n)
+            data->failed = true;
+
+        if (obj) {
+            sink += testWorkerBusy(obj);
+            virObjectUnlock(obj);
+        }
+
+        if (data->driverLock)
+            virMutexUnlock(data->driverLock);
+    }
+}
+
+
+static int
+testRunWorkers(int nthreads,
+               virMutexPtr driverLock,
+               unsigned long long *opsPerSec)
+{
+    struct testWorkerData *data = NULL;
+    unsigned long long start, end;
+    int ret = -1;
+    int started = 0;
+    int i;
+
+    if (VIR_ALLOC_N(data, nthreads) < 0)
+        return -1;
+
+    if (virTimeMillisNow(&start) < 0)
+        goto cleanup;
+
+    for (i = 0; i < nthreads; i++) {
+        data[i].idx = i;
+        data[i].driverLock = driverLock;
+        if (virThreadCreate(&data[i].thread, true, testWorker, &data[i]) < 0)
+            goto join;
+        started++;
+    }
+
+join:
+    for (i = 0; i < started; i++)
+        virThreadJoin(&data[i].thread);
+
+    if (started != nthreads ||
+        virTimeMillisNow(&end) < 0)
+        goto cleanup;
+
+    for (i = 0; i < nthreads; i++) {
+        if (data[i].failed)
+            goto cleanup;
+    }
+
+    if (end == start)
+        end++;
+    *opsPerSec = (unsigned long long)nthreads * ROUNDS * 1000 / (end - start);
+    ret = 0;
+
+cleanup:
+    VIR_FREE(data);
+    return ret;
+}
+
+
+/*
+ * Measure lookup throughput with a varying number of threads, once
+ * serialized behind a single global lock, once relying on the domain
+ * list and domain locks alone. Only correctness is checked, since
+ * the achievable speedup depends on the host; the figures are printed
+ * in verbose mode.
+ */
+static int
+testContention(const void *data)
+{
+    int nthreads = *(const int *)data;
+    unsigned long long global = 0;
+    unsigned long long fine = 0;
+    virMutex driverLock;
+    int ret = -1;
+
+    if (virMutexInit(&driverLock) < 0)
+        return -1;
+
+    if (testRunWorkers(nthreads, &driverLock, &global) < 0 ||
+        testRunWorkers(nthreads, NULL, &fine) < 0)
+        goto cleanup;
+
+    if (virTestGetVerbose())
+        fprintf(stderr, "\n%d threads: %llu lookups/s with global lock, "
+                "%llu lookups/s with list lock\n", nthreads, global, fine);
+
+    ret = 0;
+
+cleanup:
+    virMutexDestroy(&driverLock);
+    return ret;
+}
+
+
+static void
+testChurn(void *opaque)
+{
+    bool *failed = opaque;
+    virDomainObjPtr obj;
+    int i;
+
+    for (i = 0; i < NCHURN; i++) {
+        if (!(obj = testAddDomain(NDOMS + 1 + (i % 8), -1))) {
+            *failed = true;
+            return;
+        }
+        virDomainRemoveInactive(&doms, obj);
+    }
+}
+
+static int
+testConcurrentRemove(const void *data ATTRIBUTE_UNUSED)
+{
+    struct testWorkerData readers[NREADERS];
+    virThread churn;
+    bool churnFailed = false;
+    int ret = 0;
+    int i;
+
+    memset(readers, 0, sizeof(readers));
+
+    if (virThreadCreate(&churn, true, testChurn, &churnFailed) < 0)
+        return -1;
+
+    for (i = 0; i < NREADERS; i++) {
+        readers[i].idx = i;
+        if (virThreadCreate(&readers[i].thread, true,
+                            testWorker, &readers[i]) < 0) {
+            ret = -1;
+            break;
+        }
+    }
+
+    while (--i >= 0) {
+        virThreadJoin(&readers[i].thread);
+        if (readers[i].failed)
+            ret = -1;
+    }
+    virThreadJoin(&churn);
+
+    if (churnFailed ||
+        virDomainObjListNumOfDomains(&doms, 0) != 0 ||
+        virDomainObjListNumOfDomains(&doms, 1) != NDOMS)
+        ret = -1;
+
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+    size_t i;
+    static const int nthreads[] = { 1, 2, 4, 8 };
+
+    if (virThreadInitialize() < 0 ||
+        virDomainObjListInit(&doms) < 0)
+        return EXIT_FAILURE;
+
+    for (i = 1; i <= NDOMS; i++) {
+        virDomainObjPtr obj;
+        if (!(obj = testAddDomain(i, i)))
+            return EXIT_FAILURE;
+        virObjectUnlock(obj);
+    }
+
+    if (virtTestRun("lookup", 1, testLookup, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("set id", 1, testSetID, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("foreach", 1, testForEach, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("concurrent remove", 1, testConcurrentRemove, NULL) < 0)
+        ret = -1;
+
+    for (i = 0; i < ARRAY_CARDINALITY(nthreads); i++) {
+        char *name;
+        if (virAsprintf(&name, "contention %d threads", nthreads[i]) < 0)
+            return EXIT_FAILURE;
+        if (virtTestRun(name, 1, testContention, &nthreads[i]) < 0)
+            ret = -1;
+        VIR_FREE(name);
+    }
+
+    virDomainObjListDeinit(&doms);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
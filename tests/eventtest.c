@@ -23,7 +23,9 @@
 #include <config.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <signal.h>
+#include <fcntl.h>
 #include <time.h>
 
 #include "testutils.h"
@@ -31,7 +33,29 @@
 #include "virthread.h"
 #include "virlog.h"
 #include "virutil.h"
-#include "vireventpoll.h"
+#include "virfile.h"
+
+/* This file is built twice, once for each of the event loop
+ * implementations, with TEST_EVENT_EPOLL selecting epoll */
+#ifdef TEST_EVENT_EPOLL
+# include "vireventepoll.h"
+# define testEventInit virEventEpollInit
+# define testEventRunOnce virEventEpollRunOnce
+# define testEventAddHandle virEventEpollAddHandle
+# define testEventRemoveHandle virEventEpollRemoveHandle
+# define testEventAddTimeout virEventEpollAddTimeout
+# define testEventUpdateTimeout virEventEpollUpdateTimeout
+# define testEventRemoveTimeout virEventEpollRemoveTimeout
+#else
+# include "vireventpoll.h"
+# define testEventInit virEventPollInit
+# define testEventRunOnce virEventPollRunOnce
+# define testEventAddHandle virEventPollAddHandle
+# define testEventRemoveHandle virEventPollRemoveHandle
+# define testEventAddTimeout virEventPollAddTimeout
+# define testEventUpdateTimeout virEventPollUpdateTimeout
+# define testEventRemoveTimeout virEventPollRemoveTimeout
+#endif
 
 #define NUM_FDS 31
 #define NUM_TIME 31
@@ -89,7 +113,7 @@ testPipeReader(int watch, int fd, int events, void *data)
     info->error = EV_ERROR_NONE;
 
     if (info->delete != -1)
-        virEventPollRemoveHandle(info->delete);
+        testEventRemoveHandle(info->delete);
 }
 
 
@@ -108,7 +132,7 @@ testTimer(int timer, void *data)
     info->error = EV_ERROR_NONE;
 
     if (info->delete != -1)
-        virEventPollRemoveTimeout(info->delete);
+        testEventRemoveTimeout(info->delete);
 }
 
 static pthread_mutex_t eventThreadMutex = PTHREAD_MUTEX_INITIALIZER;
@@ -127,7 +151,7 @@ ATTRIBUTE_NORETURN static void *eventThreadLoop(void *data ATTRIBUTE_UNUSED) {
         eventThreadRunOnce = 0;
         pthread_mutex_unlock(&eventThreadMutex);
 
-        virEventPollRunOnce();
+        testEventRunOnce();
 
         pthread_mutex_lock(&eventThreadMutex);
         eventThreadJobDone = 1;
@@ -257,6 +281,139 @@ resetAll(void)
     }
 }
 
+#ifdef TEST_EVENT_EPOLL
+/* Events on one loop must be dispatched by that loop alone */
+static int
+testSeparateLoops(void)
+{
+    const char *name = "Separate loops";
+    virEventEpollLoopPtr loops[2] = { NULL, NULL };
+    struct handleInfo info[2];
+    int ret = EXIT_FAILURE;
+    char one = '1';
+    int i;
+
+    memset(info, 0, sizeof(info));
+    for (i = 0 ; i < 2 ; i++) {
+        info[i].pipeFD[0] = info[i].pipeFD[1] = -1;
+        info[i].delete = -1;
+    }
+
+    for (i = 0 ; i < 2 ; i++) {
+        if (pipe(info[i].pipeFD) < 0 ||
+            !(loops[i] = virEventEpollLoopNew()) ||
+            (info[i].watch =
+             virEventEpollLoopAddHandle(loops[i], info[i].pipeFD[0],
+                                        VIR_EVENT_HANDLE_READABLE,
+                                        testPipeReader,
+                                        &info[i], NULL)) < 0) {
+            virtTestResult(name, 1, "Cannot set up loop %d\n", i);
+            goto cleanup;
+        }
+    }
+
+    if (safewrite(info[1].pipeFD[1], &one, 1) != 1 ||
+        safewrite(info[0].pipeFD[1], &one, 1) != 1)
+        goto cleanup;
+
+    if (virEventEpollLoopRunOnce(loops[0]) < 0 ||
+        !info[0].fired || info[0].error != EV_ERROR_NONE || info[1].fired) {
+        virtTestResult(name, 1, "First loop dispatched wrong handles\n");
+        goto cleanup;
+    }
+
+    if (virEventEpollLoopRunOnce(loops[1]) < 0 ||
+        !info[1].fired || info[1].error != EV_ERROR_NONE) {
+        virtTestResult(name, 1, "Second loop did not dispatch its handle\n");
+        goto cleanup;
+    }
+
+    virtTestResult(name, 0, NULL);
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    for (i = 0 ; i < 2 ; i++) {
+        if (loops[i] && info[i].watch > 0)
+            virEventEpollLoopRemoveHandle(loops[i], info[i].watch);
+        virEventEpollLoopFree(loops[i]);
+        VIR_FORCE_CLOSE(info[i].pipeFD[0]);
+        VIR_FORCE_CLOSE(info[i].pipeFD[1]);
+    }
+    return ret;
+}
+
+static void
+testDisabledHandle(int watch ATTRIBUTE_UNUSED,
+                   int fd ATTRIBUTE_UNUSED,
+                   int events ATTRIBUTE_UNUSED,
+                   void *data)
+{
+    int *fired = data;
+    (*fired)++;
+}
+
+static void
+testDisabledTimer(int timer ATTRIBUTE_UNUSED,
+                  void *data)
+{
+    int *fired = data;
+    (*fired)++;
+}
+
+/* A descriptor epoll refuses is emulated as always ready, but
+ * once its handle is disabled the loop must block until the
+ * next timer instead of spinning */
+static int
+testDisabledAlwaysReady(void)
+{
+    const char *name = "Disabled always ready handle";
+    virEventEpollLoopPtr loop = NULL;
+    int ret = EXIT_FAILURE;
+    int fd = -1;
+    int watch = -1;
+    int timer = -1;
+    int handleFired = 0;
+    int timerFired = 0;
+
+    if ((fd = open("/dev/null", O_RDONLY)) < 0 ||
+        !(loop = virEventEpollLoopNew()) ||
+        (watch = virEventEpollLoopAddHandle(loop, fd,
+                                            VIR_EVENT_HANDLE_READABLE,
+                                            testDisabledHandle,
+                                            &handleFired, NULL)) < 0 ||
+        (timer = virEventEpollLoopAddTimeout(loop, 50,
+                                             testDisabledTimer,
+                                             &timerFired, NULL)) < 0) {
+        virtTestResult(name, 1, "Cannot set up loop\n");
+        goto cleanup;
+    }
+
+    virEventEpollLoopUpdateHandle(loop, watch, 0);
+
+    if (virEventEpollLoopRunOnce(loop) < 0 ||
+        handleFired || !timerFired) {
+        virtTestResult(name, 1,
+                       "Loop did not wait for the timer (handle %d, timer %d)\n",
+                       handleFired, timerFired);
+        goto cleanup;
+    }
+
+    virtTestResult(name, 0, NULL);
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    if (loop) {
+        if (watch > 0)
+            virEventEpollLoopRemoveHandle(loop, watch);
+        if (timer > 0)
+            virEventEpollLoopRemoveTimeout(loop, timer);
+    }
+    virEventEpollLoopFree(loop);
+    VIR_FORCE_CLOSE(fd);
+    return ret;
+}
+#endif
+
 static int
 mymain(void)
 {
@@ -279,24 +436,29 @@ mymain(void)
         return EXIT_FAILURE;
     }
 
-    virEventPollInit();
+#if defined(TEST_EVENT_EPOLL) && !defined(HAVE_SYS_EPOLL_H)
+    return EXIT_AM_SKIP;
+#endif
+
+    if (testEventInit() < 0)
+        return EXIT_FAILURE;
 
     for (i = 0 ; i < NUM_FDS ; i++) {
         handles[i].delete = -1;
         handles[i].watch =
-            virEventPollAddHandle(handles[i].pipeFD[0],
-                                  VIR_EVENT_HANDLE_READABLE,
-                                  testPipeReader,
-                                  &handles[i], NULL);
+            testEventAddHandle(handles[i].pipeFD[0],
+                               VIR_EVENT_HANDLE_READABLE,
+                               testPipeReader,
+                               &handles[i], NULL);
     }
 
     for (i = 0 ; i < NUM_TIME ; i++) {
         timers[i].delete = -1;
         timers[i].timeout = -1;
         timers[i].timer =
-            virEventPollAddTimeout(timers[i].timeout,
-                                   testTimer,
-                                   &timers[i], NULL);
+            testEventAddTimeout(timers[i].timeout,
+                                testTimer,
+                                &timers[i], NULL);
     }
 
     pthread_create(&eventThread, NULL, eventThreadLoop, NULL);
@@ -315,7 +477,7 @@ mymain(void)
 
     /* Now lets delete one before starting poll(), and
      * try triggering another handle */
-    virEventPollRemoveHandle(handles[0].watch);
+    testEventRemoveHandle(handles[0].watch);
     startJob();
     if (safewrite(handles[1].pipeFD[1], &one, 1) != 1)
         return EXIT_FAILURE;
@@ -335,7 +497,7 @@ mymain(void)
     sched_yield();
     usleep(100 * 1000);
     pthread_mutex_lock(&eventThreadMutex);
-    virEventPollRemoveHandle(handles[1].watch);
+    testEventRemoveHandle(handles[1].watch);
     if (finishJob("Interrupted during poll", -1, -1) != EXIT_SUCCESS)
         return EXIT_FAILURE;
 
@@ -371,22 +533,22 @@ mymain(void)
 
 
     /* Run a timer on its own */
-    virEventPollUpdateTimeout(timers[1].timer, 100);
+    testEventUpdateTimeout(timers[1].timer, 100);
     startJob();
     if (finishJob("Firing a timer", -1, 1) != EXIT_SUCCESS)
         return EXIT_FAILURE;
-    virEventPollUpdateTimeout(timers[1].timer, -1);
+    testEventUpdateTimeout(timers[1].timer, -1);
 
     resetAll();
 
     /* Now lets delete one before starting poll(), and
      * try triggering another timer */
-    virEventPollUpdateTimeout(timers[1].timer, 100);
-    virEventPollRemoveTimeout(timers[0].timer);
+    testEventUpdateTimeout(timers[1].timer, 100);
+    testEventRemoveTimeout(timers[0].timer);
     startJob();
     if (finishJob("Deleted before poll", -1, 1) != EXIT_SUCCESS)
         return EXIT_FAILURE;
-    virEventPollUpdateTimeout(timers[1].timer, -1);
+    testEventUpdateTimeout(timers[1].timer, -1);
 
     resetAll();
 
@@ -401,7 +563,7 @@ mymain(void)
     sched_yield();
     usleep(100 * 1000);
     pthread_mutex_lock(&eventThreadMutex);
-    virEventPollRemoveTimeout(timers[1].timer);
+    testEventRemoveTimeout(timers[1].timer);
     if (finishJob("Interrupted during poll", -1, -1) != EXIT_SUCCESS)
         return EXIT_FAILURE;
 
@@ -414,27 +576,27 @@ mymain(void)
      * before poll() exits for the first safewrite(). We don't
      * see a hard failure in other cases, so nothing to worry
      * about */
-    virEventPollUpdateTimeout(timers[2].timer, 100);
-    virEventPollUpdateTimeout(timers[3].timer, 100);
+    testEventUpdateTimeout(timers[2].timer, 100);
+    testEventUpdateTimeout(timers[3].timer, 100);
     startJob();
     timers[2].delete = timers[3].timer;
     if (finishJob("Deleted during dispatch", -1, 2) != EXIT_SUCCESS)
         return EXIT_FAILURE;
-    virEventPollUpdateTimeout(timers[2].timer, -1);
+    testEventUpdateTimeout(timers[2].timer, -1);
 
     resetAll();
 
     /* Extreme fun, lets delete ourselves during dispatch */
-    virEventPollUpdateTimeout(timers[2].timer, 100);
+    testEventUpdateTimeout(timers[2].timer, 100);
     startJob();
     timers[2].delete = timers[2].timer;
     if (finishJob("Deleted during dispatch", -1, 2) != EXIT_SUCCESS)
         return EXIT_FAILURE;
 
     for (i = 0 ; i < NUM_FDS - 1 ; i++)
-        virEventPollRemoveHandle(handles[i].watch);
+        testEventRemoveHandle(handles[i].watch);
     for (i = 0 ; i < NUM_TIME - 1 ; i++)
-        virEventPollRemoveTimeout(timers[i].timer);
+        testEventRemoveTimeout(timers[i].timer);
 
     resetAll();
 
@@ -455,14 +617,14 @@ mymain(void)
     handles[0].pipeFD[0] = handles[1].pipeFD[0];
     handles[0].pipeFD[1] = handles[1].pipeFD[1];
 
-    handles[0].watch = virEventPollAddHandle(handles[0].pipeFD[0],
-                                             0,
-                                             testPipeReader,
-                                             &handles[0], NULL);
-    handles[1].watch = virEventPollAddHandle(handles[1].pipeFD[0],
-                                             VIR_EVENT_HANDLE_READABLE,
-                                             testPipeReader,
-                                             &handles[1], NULL);
+    handles[0].watch = testEventAddHandle(handles[0].pipeFD[0],
+                                          0,
+                                          testPipeReader,
+                                          &handles[0], NULL);
+    handles[1].watch = testEventAddHandle(handles[1].pipeFD[0],
+                                          VIR_EVENT_HANDLE_READABLE,
+                                          testPipeReader,
+                                          &handles[1], NULL);
     startJob();
     if (safewrite(handles[1].pipeFD[1], &one, 1) != 1)
         return EXIT_FAILURE;
@@ -471,6 +633,13 @@ mymain(void)
 
     //pthread_kill(eventThread, SIGTERM);
 
+#ifdef TEST_EVENT_EPOLL
+    if (testSeparateLoops() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (testDisabledAlwaysReady() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+#endif
+
     return EXIT_SUCCESS;
 }
 
@@ -7,11 +7,24 @@
 
 #include "internal.h"
 #include "virjson.h"
+#include "viralloc.h"
+#include "virbuffer.h"
+#include "virtime.h"
 #include "testutils.h"
 
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+/* Disks in the query-blockstats reply used for benchmarking */
+#define BENCH_DISKS 64
+/* Parses done by the parse benchmark */
+#define BENCH_ROUNDS 500
+/* Lookups done per object size by the lookup benchmark */
+#define BENCH_LOOKUPS 200000
+
 struct testInfo {
     const char *doc;
     bool pass;
+    unsigned int flags;
 };
 
 
@@ -22,7 +35,7 @@ testJSONFromString(const void *data)
     virJSONValuePtr json;
     int ret = -1;
 
-    json = virJSONValueFromString(info->doc);
+    json = virJSONValueFromStringFlags(info->doc, info->flags);
 
     if (info->pass) {
         if (!json) {
@@ -54,20 +67,268 @@ cleanup:
 }
 
 
+/* An object with @nkeys keys "key0" ... "keyN", with values 0 ... N */
+static char *
+testJSONMakeObject(int nkeys)
+{
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    int i;
+
+    virBufferAddLit(&buf, "{");
+    for (i = 0 ; i < nkeys ; i++)
+        virBufferAsprintf(&buf, "%s\"key%d\": %d", i ? ", " : "", i, i);
+    virBufferAddLit(&buf, "}");
+
+    if (virBufferError(&buf)) {
+        virBufferFreeAndReset(&buf);
+        return NULL;
+    }
+    return virBufferContentAndReset(&buf);
+}
+
+
+/* Check that every key of a large object, including ones appended
+ * after parsing, is found through the hash index */
+static int
+testJSONLookup(const void *data)
+{
+    const struct testInfo *info = data;
+    int nkeys = 200;
+    char *doc = NULL;
+    virJSONValuePtr json = NULL;
+    char key[32];
+    int ret = -1;
+    int val;
+    int i;
+
+    if (!(doc = testJSONMakeObject(nkeys)) ||
+        !(json = virJSONValueFromStringFlags(doc, info->flags)))
+        goto cleanup;
+
+    for (i = 0 ; i < 50 ; i++) {
+        snprintf(key, sizeof(key), "extra%d", i);
+        if (virJSONValueObjectAppendNumberInt(json, key, nkeys + i) < 0)
+            goto cleanup;
+    }
+
+    if (virJSONValueObjectKeysNumber(json) != nkeys + 50)
+        goto cleanup;
+
+    for (i = 0 ; i < nkeys + 50 ; i++) {
+        if (i < nkeys)
+            snprintf(key, sizeof(key), "key%d", i);
+        else
+            snprintf(key, sizeof(key), "extra%d", i - nkeys);
+        if (virJSONValueObjectGetNumberInt(json, key, &val) < 0 ||
+            val != i) {
+            if (virTestGetVerbose())
+                fprintf(stderr, "Lookup of %s failed\n", key);
+            goto cleanup;
+        }
+    }
+
+    if (virJSONValueObjectHasKey(json, "key200") != 0 ||
+        virJSONValueObjectAppendNumberInt(json, "key0", 0) == 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virJSONValueFree(json);
+    VIR_FREE(doc);
+    return ret;
+}
+
+
+/* A query-blockstats reply for BENCH_DISKS disks */
+static char *
+testJSONMakeBlockstats(void)
+{
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    int i;
+
+    virBufferAddLit(&buf, "{\"return\": [");
+    for (i = 0 ; i < BENCH_DISKS ; i++)
+        virBufferAsprintf(&buf,
+                          "%s{\"device\": \"drive-virtio-disk%d\", "
+                          "\"parent\": {\"stats\": {\"wr_highest_offset\": 0, "
+                          "\"wr_bytes\": 0, \"wr_operations\": 0, "
+                          "\"rd_bytes\": 0, \"rd_operations\": 0}}, "
+                          "\"stats\": {\"flush_total_time_ns\": 500000, "
+                          "\"wr_highest_offset\": 8192, "
+                          "\"wr_total_time_ns\": 3000000, "
+                          "\"wr_bytes\": 8192, \"rd_total_time_ns\": 76000000, "
+                          "\"flush_operations\": 1, \"wr_operations\": 2, "
+                          "\"rd_bytes\": 5256192, \"rd_operations\": 332}}",
+                          i ? ", " : "", i);
+    virBufferAddLit(&buf, "], \"id\": \"libvirt-12\"}");
+
+    if (virBufferError(&buf)) {
+        virBufferFreeAndReset(&buf);
+        return NULL;
+    }
+    return virBufferContentAndReset(&buf);
+}
+
+
+/* Parse @doc BENCH_ROUNDS times and read every disk's stats back */
+static int
+testJSONBenchParseOne(const char *doc,
+                      unsigned int flags,
+                      unsigned long long *opsPerSec)
+{
+    unsigned long long start, end;
+    virJSONValuePtr json;
+    virJSONValuePtr devices;
+    long long val;
+    int i, j;
+
+    if (virTimeMillisNow(&start) < 0)
+        return -1;
+
+    for (i = 0 ; i < BENCH_ROUNDS ; i++) {
+        if (!(json = virJSONValueFromStringFlags(doc, flags)))
+            return -1;
+
+        if (!(devices = virJSONValueObjectGet(json, "return")) ||
+            virJSONValueArraySize(devices) != BENCH_DISKS) {
+            virJSONValueFree(json);
+            return -1;
+        }
+
+        for (j = 0 ; j < BENCH_DISKS ; j++) {
+            virJSONValuePtr stats;
+            stats = virJSONValueObjectGet(virJSONValueArrayGet(devices, j),
+                                          "stats");
+            if (!stats ||
+                virJSONValueObjectGetNumberLong(stats, "rd_bytes", &val) < 0 ||
+                val != 5256192) {
+                virJSONValueFree(json);
+                return -1;
+            }
+        }
+
+        virJSONValueFree(json);
+    }
+
+    if (virTimeMillisNow(&end) < 0)
+        return -1;
+
+    if (end == start)
+        end++;
+    *opsPerSec = (unsigned long long)BENCH_ROUNDS * 1000 / (end - start);
+    return 0;
+}
+
+
+/*
+ * Measure parse throughput of a large QMP reply, with one allocation
+ * per node and with an arena. Only correctness is checked, since the
+ * figures depend on the host; they are printed in verbose mode.
+ */
+static int
+testJSONBenchParse(const void *data ATTRIBUTE_UNUSED)
+{
+    char *doc;
+    unsigned long long heap = 0;
+    unsigned long long arena = 0;
+    int ret = -1;
+
+    if (!(doc = testJSONMakeBlockstats()))
+        return -1;
+
+    if (testJSONBenchParseOne(doc, 0, &heap) < 0 ||
+        testJSONBenchParseOne(doc, VIR_JSON_PARSE_ARENA, &arena) < 0)
+        goto cleanup;
+
+    if (virTestGetVerbose())
+        fprintf(stderr, "\n%d disks: %llu parses/s malloc'd, "
+                "%llu parses/s in an arena\n", BENCH_DISKS, heap, arena);
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(doc);
+    return ret;
+}
+
+
+/*
+ * Measure key lookup throughput as objects grow past the size at
+ * which they get a hash index. Printed in verbose mode.
+ */
+static int
+testJSONBenchLookup(const void *data ATTRIBUTE_UNUSED)
+{
+    static const int sizes[] = { 8, 64, 512 };
+    unsigned long long start, end;
+    virJSONValuePtr json = NULL;
+    char *doc = NULL;
+    char key[32];
+    int ret = -1;
+    size_t i;
+    int j, val;
+
+    for (i = 0 ; i < ARRAY_CARDINALITY(sizes) ; i++) {
+        if (!(doc = testJSONMakeObject(sizes[i])) ||
+            !(json = virJSONValueFromStringFlags(doc, VIR_JSON_PARSE_ARENA)))
+            goto cleanup;
+
+        if (virTimeMillisNow(&start) < 0)
+            goto cleanup;
+
+        for (j = 0 ; j < BENCH_LOOKUPS ; j++) {
+            /* Always ask for the last key, the worst case for a scan */
+            snprintf(key, sizeof(key), "key%d", sizes[i] - 1);
+            if (virJSONValueObjectGetNumberInt(json, key, &val) < 0 ||
+                val != sizes[i] - 1)
+                goto cleanup;
+        }
+
+        if (virTimeMillisNow(&end) < 0)
+            goto cleanup;
+
+        if (end == start)
+            end++;
+        if (virTestGetVerbose())
+            fprintf(stderr, "%s%d keys: %llu lookups/s", i ? ", " : "\n",
+                    sizes[i],
+                    (unsigned long long)BENCH_LOOKUPS * 1000 / (end - start));
+
+        virJSONValueFree(json);
+        json = NULL;
+        VIR_FREE(doc);
+    }
+    if (virTestGetVerbose())
+        fprintf(stderr, "\n");
+
+    ret = 0;
+
+cleanup:
+    virJSONValueFree(json);
+    VIR_FREE(doc);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
     int ret = 0;
 
-#define DO_TEST_FULL(name, cmd, doc, pass)                          \
+#define DO_TEST_FULL(name, cmd, doc, pass, flags)                   \
     do {                                                            \
-        struct testInfo info = { doc, pass };                       \
+        struct testInfo info = { doc, pass, flags };                \
         if (virtTestRun(name, 1, testJSON ## cmd, &info) < 0)       \
             ret = -1;                                               \
     } while (0)
 
-#define DO_TEST_PARSE(name, doc)                \
-    DO_TEST_FULL(name, FromString, doc, true)
+#define DO_TEST_PARSE(name, doc)                                    \
+    do {                                                            \
+        DO_TEST_FULL(name, FromString, doc, true, 0);               \
+        DO_TEST_FULL(name " (arena)", FromString, doc, true,        \
+                     VIR_JSON_PARSE_ARENA);                         \
+    } while (0)
 
     DO_TEST_PARSE("Simple", "{\"return\": {}, \"id\": \"libvirt-1\"}");
     DO_TEST_PARSE("NotSoSimple", "{\"QMP\": {\"version\": {\"qemu\":"
@@ -105,6 +366,14 @@ mymain(void)
                   "\"query-uuid\"}, {\"name\": \"query-migrate\"}, {\"name\": "
                   "\"query-balloon\"}], \"id\": \"libvirt-2\"}");
 
+    DO_TEST_FULL("Lookup", Lookup, NULL, true, 0);
+    DO_TEST_FULL("Lookup (arena)", Lookup, NULL, true, VIR_JSON_PARSE_ARENA);
+
+    if (virtTestRun("Benchmark parse", 1, testJSONBenchParse, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Benchmark lookup", 1, testJSONBenchLookup, NULL) < 0)
+        ret = -1;
+
     return (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
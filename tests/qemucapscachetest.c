@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "testutils.h"
+#include "qemu/qemu_capabilities.h"
+#include "viralloc.h"
+#include "virerror.h"
+#include "virfile.h"
+#include "virutil.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+static const char *binary = "/usr/bin/qemu-kvm";
+static char *cacheFile;
+
+static void
+testBinaryStat(struct stat *sb)
+{
+    memset(sb, 0, sizeof(*sb));
+    sb->st_ctime = 1360000000;
+    sb->st_mtime = 1350000000;
+    sb->st_size = 4525304;
+}
+
+/* What qemuCapsFormatCache writes for the capabilities of a binary
+ * @sb describes, written by libvirt @version */
+static char *
+testCacheXML(const struct stat *sb, unsigned long version)
+{
+    char *xml;
+
+    if (virAsprintf(&xml,
+                    "<qemuCaps>\n"
+                    "  <binary path='%s' ctime='%llu' mtime='%llu'"
+                    " size='%llu'/>\n"
+                    "  <libvirt version='%lu'/>\n"
+                    "  <host kvm='%s'/>\n"
+                    "  <usedQMP/>\n"
+                    "  <version>1002000</version>\n"
+                    "  <kvmVersion>0</kvmVersion>\n"
+                    "  <arch>x86_64</arch>\n"
+                    "  <flag name='vnc-colon'/>\n"
+                    "  <flag name='name'/>\n"
+                    "  <flag name='uuid'/>\n"
+                    "  <cpu name='qemu64'/>\n"
+                    "  <cpu name='Nehalem'/>\n"
+                    "  <machine name='pc-1.2' alias='pc'/>\n"
+                    "  <machine name='isapc'/>\n"
+                    "</qemuCaps>\n",
+                    binary,
+                    (unsigned long long) sb->st_ctime,
+                    (unsigned long long) sb->st_mtime,
+                    (unsigned long long) sb->st_size,
+                    version,
+                    virFileExists("/dev/kvm") ? "yes" : "no") < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+
+    return xml;
+}
+
+/* Loading @xml for @bin must give up quietly, so that the binary is
+ * probed instead */
+static int
+testExpectProbe(const char *what,
+                const char *bin,
+                const char *xml,
+                struct stat *sb)
+{
+    qemuCapsPtr caps;
+
+    if (xml && virFileWriteStr(cacheFile, xml, 0600) < 0)
+        return -1;
+
+    if ((caps = qemuCapsLoadCache(bin, cacheFile, sb))) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "%s: cached capabilities were used\n", what);
+        virObjectUnref(caps);
+        return -1;
+    }
+    if (virGetLastError()) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "%s: error left behind\n", what);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* What is loaded from the cache is formatted back unchanged */
+static int
+testRoundTrip(const void *data ATTRIBUTE_UNUSED)
+{
+    qemuCapsPtr caps = NULL;
+    struct stat sb;
+    char *xml = NULL;
+    char *got = NULL;
+    char **names;
+    int ret = -1;
+
+    testBinaryStat(&sb);
+    if (!(xml = testCacheXML(&sb, LIBVIR_VERSION_NUMBER)) ||
+        virFileWriteStr(cacheFile, xml, 0600) < 0)
+        goto cleanup;
+
+    if (!(caps = qemuCapsLoadCache(binary, cacheFile, &sb)))
+        goto cleanup;
+
+    if (STRNEQ_NULLABLE(qemuCapsGetBinary(caps), binary) ||
+        !qemuCapsUsedQMP(caps) ||
+        qemuCapsGetVersion(caps) != 1002000 ||
+        qemuCapsGetArch(caps) != VIR_ARCH_X86_64 ||
+        !qemuCapsGet(caps, QEMU_CAPS_NAME) ||
+        qemuCapsGet(caps, QEMU_CAPS_KQEMU) ||
+        qemuCapsGetCPUDefinitions(caps, &names) != 2 ||
+        STRNEQ(names[1], "Nehalem") ||
+        qemuCapsGetMachineTypes(caps, &names) != 2 ||
+        STRNEQ_NULLABLE(qemuCapsGetCanonicalMachine(caps, "pc"), "pc-1.2"))
+        goto cleanup;
+
+    if (!(got = qemuCapsFormatCache(caps)))
+        goto cleanup;
+
+    if (STRNEQ(xml, got)) {
+        virtTestDifference(stderr, xml, got);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    virObjectUnref(caps);
+    VIR_FREE(got);
+    VIR_FREE(xml);
+    return ret;
+}
+
+
+/* A binary which changed since, or a cache written by another
+ * version of libvirt, means probing again */
+static int
+testInvalidate(const void *data ATTRIBUTE_UNUSED)
+{
+    struct stat sb;
+    struct stat changed;
+    char *xml = NULL;
+    int ret = -1;
+
+    testBinaryStat(&sb);
+    if (!(xml = testCacheXML(&sb, LIBVIR_VERSION_NUMBER)))
+        goto cleanup;
+
+    changed = sb;
+    changed.st_mtime++;
+    if (testExpectProbe("mtime", binary, xml, &changed) < 0)
+        goto cleanup;
+
+    changed = sb;
+    changed.st_ctime++;
+    if (testExpectProbe("ctime", binary, xml, &changed) < 0)
+        goto cleanup;
+
+    changed = sb;
+    changed.st_size--;
+    if (testExpectProbe("size", binary, xml, &changed) < 0)
+        goto cleanup;
+
+    if (testExpectProbe("binary", "/usr/bin/qemu-system-x86_64",
+                        xml, &sb) < 0)
+        goto cleanup;
+
+    VIR_FREE(xml);
+    if (!(xml = testCacheXML(&sb, LIBVIR_VERSION_NUMBER + 1)) ||
+        testExpectProbe("newer libvirt", binary, xml, &sb) < 0)
+        goto cleanup;
+
+    VIR_FREE(xml);
+    if (!(xml = testCacheXML(&sb, LIBVIR_VERSION_NUMBER - 1)) ||
+        testExpectProbe("older libvirt", binary, xml, &sb) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(xml);
+    return ret;
+}
+
+
+/* Whatever is wrong with the cache file, the binary is probed */
+static int
+testCorrupt(const void *data ATTRIBUTE_UNUSED)
+{
+    struct stat sb;
+    char *xml = NULL;
+    char *p;
+    int ret = -1;
+
+    testBinaryStat(&sb);
+    if (!(xml = testCacheXML(&sb, LIBVIR_VERSION_NUMBER)))
+        goto cleanup;
+
+    if (testExpectProbe("not XML", binary, "\x7f" "ELF\x02\x01", &sb) < 0 ||
+        testExpectProbe("wrong root", binary,
+                        "<domain type='kvm'/>\n", &sb) < 0)
+        goto cleanup;
+
+    /* Unknown flags come from a cache this libvirt didn't write */
+    if (!(p = strstr(xml, "'uuid'")))
+        goto cleanup;
+    memcpy(p, "'bogo'", strlen("'bogo'"));
+    if (testExpectProbe("unknown flag", binary, xml, &sb) < 0)
+        goto cleanup;
+
+    /* Cut off in the middle of writing it */
+    xml[strlen(xml) / 2] = '\0';
+    if (testExpectProbe("truncated", binary, xml, &sb) < 0)
+        goto cleanup;
+
+    unlink(cacheFile);
+    if (testExpectProbe("missing", binary, NULL, &sb) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(xml);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+    char template[] = "/tmp/libvirt_XXXXXX";
+    char *tmpdir;
+
+    if (!(tmpdir = mkdtemp(template))) {
+        fprintf(stderr, "Cannot create temporary directory\n");
+        return EXIT_FAILURE;
+    }
+    if (virAsprintf(&cacheFile, "%s/qemucaps.xml", tmpdir) < 0) {
+        rmdir(tmpdir);
+        return EXIT_FAILURE;
+    }
+
+    if (virtTestRun("Round trip", 1, testRoundTrip, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Invalidate", 1, testInvalidate, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Corrupt", 1, testCorrupt, NULL) < 0)
+        ret = -1;
+
+    unlink(cacheFile);
+    VIR_FREE(cacheFile);
+    rmdir(tmpdir);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
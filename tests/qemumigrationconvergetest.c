@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include "testutils.h"
+#include "qemu/qemu_migration_converge.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+static void
+testConvergeInit(qemuMigrationConvergePtr converge,
+                 qemuMonitorMigrationStatusPtr status)
+{
+    memset(converge, 0, sizeof(*converge));
+    converge->speed = converge->userSpeed = 32;
+    converge->maxSpeed = 100;
+    converge->downtime = QEMU_MIGRATION_CONVERGE_DOWNTIME;
+    converge->maxDowntime = 100;
+
+    memset(status, 0, sizeof(*status));
+    status->status = QEMU_MONITOR_MIGRATION_STATUS_ACTIVE;
+}
+
+static int
+testExpectStalled(qemuMigrationConvergePtr converge,
+                  qemuMonitorMigrationStatusPtr status,
+                  unsigned long long now,
+                  bool want)
+{
+    unsigned long long dirtyRate;
+
+    if (qemuMigrationConvergeStalled(converge, status, now,
+                                     &dirtyRate) != want) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "at %llums: expected %s\n",
+                    now, want ? "a stall" : "no stall");
+        return -1;
+    }
+    return 0;
+}
+
+
+/* With passes counted, only the end of each pass after the first
+ * one is judged, against the pass before */
+static int
+testIterations(const void *data ATTRIBUTE_UNUSED)
+{
+    qemuMigrationConverge converge;
+    qemuMonitorMigrationStatus status;
+
+    testConvergeInit(&converge, &status);
+    status.ram_iteration_set = true;
+
+    status.ram_iteration = 1;
+    status.ram_remaining = 1000;
+    if (testExpectStalled(&converge, &status, 1000, false) < 0 ||
+        converge.lastCheck != 0)
+        return -1;
+
+    /* Nothing to compare the second pass against */
+    status.ram_iteration = 2;
+    status.ram_remaining = 800;
+    if (testExpectStalled(&converge, &status, 2000, false) < 0)
+        return -1;
+
+    /* Same pass, however long it takes */
+    status.ram_remaining = 900;
+    if (testExpectStalled(&converge, &status, 60000, false) < 0)
+        return -1;
+
+    status.ram_iteration = 3;
+    status.ram_remaining = 500;
+    if (testExpectStalled(&converge, &status, 61000, false) < 0)
+        return -1;
+
+    status.ram_iteration = 4;
+    status.ram_remaining = 500;
+    if (testExpectStalled(&converge, &status, 62000, true) < 0)
+        return -1;
+
+    /* Stalls only count while the migration runs */
+    status.status = QEMU_MONITOR_MIGRATION_STATUS_COMPLETED;
+    status.ram_iteration = 5;
+    status.ram_remaining = 600;
+    if (testExpectStalled(&converge, &status, 63000, false) < 0 ||
+        converge.iteration != 4)
+        return -1;
+
+    return 0;
+}
+
+
+/* Without passes counted, progress is judged every
+ * QEMU_MIGRATION_CONVERGE_INTERVAL */
+static int
+testInterval(const void *data ATTRIBUTE_UNUSED)
+{
+    qemuMigrationConverge converge;
+    qemuMonitorMigrationStatus status;
+    unsigned long long t = 100000;
+
+    testConvergeInit(&converge, &status);
+
+    status.ram_remaining = 1000;
+    if (testExpectStalled(&converge, &status, t, false) < 0 ||
+        converge.lastCheck != t)
+        return -1;
+
+    status.ram_remaining = 1200;
+    if (testExpectStalled(&converge, &status,
+                          t + QEMU_MIGRATION_CONVERGE_INTERVAL - 1,
+                          false) < 0)
+        return -1;
+
+    t += QEMU_MIGRATION_CONVERGE_INTERVAL;
+    if (testExpectStalled(&converge, &status, t, true) < 0)
+        return -1;
+
+    t += QEMU_MIGRATION_CONVERGE_INTERVAL;
+    status.ram_remaining = 1100;
+    if (testExpectStalled(&converge, &status, t, false) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/* A guest dirtying memory faster than it is sent is stalled even if
+ * the amount left went down */
+static int
+testDirtyRate(const void *data ATTRIBUTE_UNUSED)
+{
+    qemuMigrationConverge converge;
+    qemuMonitorMigrationStatus status;
+    unsigned long long dirtyRate;
+
+    testConvergeInit(&converge, &status);
+    status.ram_iteration_set = true;
+    status.ram_dirty_rate_set = true;
+    status.ram_bps_set = true;
+    status.ram_normal = 10;
+    status.ram_normal_bytes = 10 * 8192;
+    status.ram_bps = 8192 * 100;
+
+    status.ram_iteration = 2;
+    status.ram_remaining = 1000;
+    status.ram_dirty_rate = 200;
+    if (testExpectStalled(&converge, &status, 1000, false) < 0)
+        return -1;
+
+    status.ram_iteration = 3;
+    status.ram_remaining = 900;
+    status.ram_dirty_rate = 99;
+    if (qemuMigrationConvergeStalled(&converge, &status, 2000,
+                                     &dirtyRate) ||
+        dirtyRate != 99 * 8192)
+        return -1;
+
+    status.ram_iteration = 4;
+    status.ram_remaining = 800;
+    status.ram_dirty_rate = 100;
+    if (testExpectStalled(&converge, &status, 3000, true) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/* Speed goes up to its limit, then downtime, then the stall is
+ * reported once until the migration moves again */
+static int
+testSteps(const void *data ATTRIBUTE_UNUSED)
+{
+    qemuMigrationConverge converge;
+    qemuMonitorMigrationStatus status;
+    unsigned long speed = 0;
+    unsigned long long downtime = 0;
+
+    testConvergeInit(&converge, &status);
+
+    status.ram_remaining = 1000;
+    if (testExpectStalled(&converge, &status, 100000, false) < 0)
+        return -1;
+
+    if (qemuMigrationConvergeNext(&converge, &speed, &downtime) !=
+        QEMU_MIGRATION_CONVERGE_STEP_SPEED || speed != 64)
+        return -1;
+    converge.speed = speed;
+
+    if (qemuMigrationConvergeNext(&converge, &speed, &downtime) !=
+        QEMU_MIGRATION_CONVERGE_STEP_SPEED || speed != 100)
+        return -1;
+    converge.speed = speed;
+
+    if (qemuMigrationConvergeNext(&converge, &speed, &downtime) !=
+        QEMU_MIGRATION_CONVERGE_STEP_DOWNTIME || downtime != 60)
+        return -1;
+    converge.downtime = downtime;
+
+    if (qemuMigrationConvergeNext(&converge, &speed, &downtime) !=
+        QEMU_MIGRATION_CONVERGE_STEP_DOWNTIME || downtime != 100)
+        return -1;
+    converge.downtime = downtime;
+
+    if (qemuMigrationConvergeNext(&converge, &speed, &downtime) !=
+        QEMU_MIGRATION_CONVERGE_STEP_REPORT)
+        return -1;
+    converge.reported = true;
+
+    if (qemuMigrationConvergeNext(&converge, &speed, &downtime) !=
+        QEMU_MIGRATION_CONVERGE_STEP_NONE)
+        return -1;
+
+    /* Progress allows for another report */
+    if (testExpectStalled(&converge, &status, 200000, true) < 0 ||
+        !converge.reported)
+        return -1;
+    status.ram_remaining = 900;
+    if (testExpectStalled(&converge, &status, 300000, false) < 0 ||
+        converge.reported)
+        return -1;
+
+    return 0;
+}
+
+
+/* Speed and downtime set by the user while migrating are where the
+ * next step starts from */
+static int
+testUserLimits(const void *data ATTRIBUTE_UNUSED)
+{
+    qemuMigrationConverge converge;
+    qemuMonitorMigrationStatus status;
+    unsigned long speed = 0;
+    unsigned long long downtime = 0;
+
+    testConvergeInit(&converge, &status);
+
+    /* Nothing changed */
+    converge.speed = 64;
+    qemuMigrationConvergeUserLimits(&converge, 32, 0);
+    if (converge.speed != 64 ||
+        converge.downtime != QEMU_MIGRATION_CONVERGE_DOWNTIME)
+        return -1;
+
+    qemuMigrationConvergeUserLimits(&converge, 10, 0);
+    if (qemuMigrationConvergeNext(&converge, &speed, &downtime) !=
+        QEMU_MIGRATION_CONVERGE_STEP_SPEED || speed != 20)
+        return -1;
+    converge.speed = speed;
+
+    /* Taken over once only */
+    qemuMigrationConvergeUserLimits(&converge, 10, 0);
+    if (converge.speed != 20)
+        return -1;
+
+    qemuMigrationConvergeUserLimits(&converge, 200, 45);
+    if (qemuMigrationConvergeNext(&converge, &speed, &downtime) !=
+        QEMU_MIGRATION_CONVERGE_STEP_DOWNTIME || downtime != 90)
+        return -1;
+    converge.downtime = downtime;
+
+    qemuMigrationConvergeUserLimits(&converge, 200, 45);
+    if (converge.downtime != 90)
+        return -1;
+
+    /* Already past the limit */
+    qemuMigrationConvergeUserLimits(&converge, 200, 500);
+    if (qemuMigrationConvergeNext(&converge, &speed, &downtime) !=
+        QEMU_MIGRATION_CONVERGE_STEP_REPORT)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virtTestRun("Stalls per pass", 1, testIterations, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Stalls per interval", 1, testInterval, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Dirty rate", 1, testDirtyRate, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Steps", 1, testSteps, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("User limits", 1, testUserLimits, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
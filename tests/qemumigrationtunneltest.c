@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "testutils.h"
+#include "qemu/qemu_migration_tunnel.h"
+#include "viralloc.h"
+#include "virfile.h"
+#include "virutil.h"
+#include "virerror.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define NSTREAMS 3
+
+struct testTunnel {
+    qemuMigrationTunnelInStream streams[NSTREAMS];
+    int writeFD[NSTREAMS];      /* where the chunks of each stream go */
+    int qemuFD[2];              /* what QEMU would get */
+};
+
+static void
+testTunnelFree(struct testTunnel *t)
+{
+    size_t i;
+
+    for (i = 0 ; i < NSTREAMS ; i++) {
+        VIR_FORCE_CLOSE(t->streams[i].fd);
+        VIR_FORCE_CLOSE(t->writeFD[i]);
+        VIR_FREE(t->streams[i].data);
+    }
+    VIR_FORCE_CLOSE(t->qemuFD[0]);
+    VIR_FORCE_CLOSE(t->qemuFD[1]);
+}
+
+static int
+testTunnelInit(struct testTunnel *t)
+{
+    size_t i;
+
+    memset(t, 0, sizeof(*t));
+    for (i = 0 ; i < NSTREAMS ; i++)
+        t->streams[i].fd = t->writeFD[i] = -1;
+    t->qemuFD[0] = t->qemuFD[1] = -1;
+
+    for (i = 0 ; i < NSTREAMS ; i++) {
+        int fds[2];
+
+        if (pipe2(fds, O_CLOEXEC) < 0 ||
+            virSetNonBlock(fds[0]) < 0)
+            goto error;
+        t->streams[i].fd = fds[0];
+        t->writeFD[i] = fds[1];
+
+        if (VIR_ALLOC_N(t->streams[i].data,
+                        QEMU_MIGRATION_TUNNEL_CHUNK_MAX) < 0)
+            goto error;
+    }
+
+    if (pipe2(t->qemuFD, O_CLOEXEC) < 0 ||
+        virSetNonBlock(t->qemuFD[0]) < 0)
+        goto error;
+
+    return 0;
+
+error:
+    testTunnelFree(t);
+    return -1;
+}
+
+/* Send chunk @seq holding @data, of @len bytes, over stream @i */
+static int
+testSendChunk(struct testTunnel *t,
+              size_t i,
+              unsigned long long seq,
+              const char *data,
+              unsigned int len)
+{
+    char header[QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE];
+
+    qemuMigrationTunnelEncodeHeader(header, seq, len);
+    if (safewrite(t->writeFD[i], header, sizeof(header)) < 0 ||
+        safewrite(t->writeFD[i], data, len) < 0)
+        return -1;
+    return 0;
+}
+
+/* Read what is available from every stream and pass on what can be */
+static int
+testReadAll(struct testTunnel *t,
+            unsigned long long *next,
+            bool *done)
+{
+    size_t i;
+
+    for (i = 0 ; i < NSTREAMS ; i++) {
+        if (qemuMigrationTunnelInStreamRead(&t->streams[i]) < 0)
+            return -1;
+    }
+
+    return qemuMigrationTunnelInStreamsFlush(t->streams, NSTREAMS,
+                                             t->qemuFD[1], next, done);
+}
+
+/* Check QEMU got exactly @want so far */
+static int
+testExpectQemu(struct testTunnel *t, const char *want)
+{
+    char buf[100];
+    ssize_t got;
+
+    if ((got = read(t->qemuFD[0], buf, sizeof(buf) - 1)) < 0) {
+        if (errno != EAGAIN)
+            return -1;
+        got = 0;
+    }
+    buf[got] = '\0';
+
+    if (STRNEQ(buf, want)) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "qemu got '%s', expected '%s'\n", buf, want);
+        return -1;
+    }
+    return 0;
+}
+
+
+static int
+testHeader(const void *data ATTRIBUTE_UNUSED)
+{
+    const unsigned char want[QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE] = {
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x88,
+        0x00, 0x01, 0x00, 0x00,
+    };
+    char buf[QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE];
+    unsigned long long seq;
+    unsigned int len;
+
+    qemuMigrationTunnelEncodeHeader(buf, 0x0102030405060788ULL, 65536);
+    if (memcmp(buf, want, sizeof(want)) != 0)
+        return -1;
+
+    qemuMigrationTunnelDecodeHeader(buf, &seq, &len);
+    if (seq != 0x0102030405060788ULL || len != 65536)
+        return -1;
+
+    return 0;
+}
+
+
+/*
+ * Chunks reach QEMU in sequence whichever stream they came over and
+ * whenever they arrived, a stream is not read past a chunk waiting
+ * for its turn, and the end marker stops everything.
+ */
+static int
+testOutOfOrder(const void *data ATTRIBUTE_UNUSED)
+{
+    struct testTunnel t;
+    unsigned long long next = 0;
+    bool done = false;
+    int ret = -1;
+
+    if (testTunnelInit(&t) < 0)
+        return -1;
+
+    /* Two chunks queued on stream 0, the first of them is 2 */
+    if (testSendChunk(&t, 0, 2, "cc", 2) < 0 ||
+        testSendChunk(&t, 0, 4, "ee", 2) < 0 ||
+        testSendChunk(&t, 2, 1, "bb", 2) < 0 ||
+        testReadAll(&t, &next, &done) < 0 ||
+        testExpectQemu(&t, "") < 0 ||
+        !t.streams[0].ready || t.streams[0].seq != 2)
+        goto cleanup;
+
+    if (testSendChunk(&t, 1, 0, "aa", 2) < 0 ||
+        testReadAll(&t, &next, &done) < 0 ||
+        testExpectQemu(&t, "aabbcc") < 0 ||
+        next != 3)
+        goto cleanup;
+
+    /* Stream 0 only moves on to chunk 4 once chunk 2 is gone */
+    if (testReadAll(&t, &next, &done) < 0 ||
+        !t.streams[0].ready || t.streams[0].seq != 4 ||
+        testSendChunk(&t, 1, 3, "dd", 2) < 0 ||
+        testReadAll(&t, &next, &done) < 0 ||
+        testExpectQemu(&t, "ddee") < 0 ||
+        next != 5 || done)
+        goto cleanup;
+
+    /* Nothing after the end marker is passed on */
+    if (testSendChunk(&t, 2, 6, "gg", 2) < 0 ||
+        testSendChunk(&t, 1, 5, "", 0) < 0 ||
+        testReadAll(&t, &next, &done) < 0 ||
+        testExpectQemu(&t, "") < 0 ||
+        !done || next != 5)
+        goto cleanup;
+
+    /* Streams closed between chunks just end */
+    VIR_FORCE_CLOSE(t.writeFD[1]);
+    if (qemuMigrationTunnelInStreamRead(&t.streams[1]) < 0 ||
+        !t.streams[1].eof)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    testTunnelFree(&t);
+    return ret;
+}
+
+
+/* A stream closed in the middle of a chunk is an error */
+static int
+testTruncated(const void *data ATTRIBUTE_UNUSED)
+{
+    struct testTunnel t;
+    char header[QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE];
+    int ret = -1;
+
+    if (testTunnelInit(&t) < 0)
+        return -1;
+
+    qemuMigrationTunnelEncodeHeader(header, 0, 10);
+    if (safewrite(t.writeFD[0], header, sizeof(header)) < 0 ||
+        safewrite(t.writeFD[0], "abcd", 4) < 0)
+        goto cleanup;
+
+    /* Waiting for the rest of the chunk */
+    if (qemuMigrationTunnelInStreamRead(&t.streams[0]) < 0 ||
+        t.streams[0].ready || t.streams[0].eof)
+        goto cleanup;
+
+    VIR_FORCE_CLOSE(t.writeFD[0]);
+    if (qemuMigrationTunnelInStreamRead(&t.streams[0]) == 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virResetLastError();
+    testTunnelFree(&t);
+    return ret;
+}
+
+
+/* A chunk larger than the buffers is refused before reading it */
+static int
+testOversized(const void *data ATTRIBUTE_UNUSED)
+{
+    struct testTunnel t;
+    char header[QEMU_MIGRATION_TUNNEL_CHUNK_HEADER_SIZE];
+    int ret = -1;
+
+    if (testTunnelInit(&t) < 0)
+        return -1;
+
+    qemuMigrationTunnelEncodeHeader(header, 0,
+                                    QEMU_MIGRATION_TUNNEL_CHUNK_MAX + 1);
+    if (safewrite(t.writeFD[0], header, sizeof(header)) < 0)
+        goto cleanup;
+
+    if (qemuMigrationTunnelInStreamRead(&t.streams[0]) == 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virResetLastError();
+    testTunnelFree(&t);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virtTestRun("Chunk header", 1, testHeader, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Chunks out of order", 1, testOutOfOrder, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Truncated chunk", 1, testTruncated, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Oversized chunk", 1, testOversized, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
@@ -423,6 +423,302 @@ cleanup:
 }
 
 
+static int
+testQemuMonitorJSONGetAllBlockStatsInfo(const void *data)
+{
+    virCapsPtr caps = (virCapsPtr)data;
+    qemuMonitorTestPtr test = qemuMonitorTestNew(true, caps);
+    int ret = -1;
+    virHashTablePtr table = NULL;
+    qemuBlockStatsPtr stats;
+
+    if (!test)
+        return -1;
+
+    if (qemuMonitorTestAddItem(test, "query-blockstats",
+                               "{ "
+                               "  \"return\": [ "
+                               "   { "
+                               "     \"device\": \"drive-virtio-disk0\", "
+                               "     \"stats\": { "
+                               "       \"rd_bytes\": 5256192, "
+                               "       \"wr_bytes\": 8192, "
+                               "       \"rd_operations\": 332, "
+                               "       \"wr_operations\": 2, "
+                               "       \"flush_operations\": 1, "
+                               "       \"rd_total_time_ns\": 76000000, "
+                               "       \"wr_total_time_ns\": 3000000, "
+                               "       \"flush_total_time_ns\": 500000 "
+                               "     } "
+                               "   }, "
+                               "   { "
+                               "     \"device\": \"drive-ide0-1-0\", "
+                               "     \"stats\": { "
+                               "       \"rd_bytes\": 49250, "
+                               "       \"wr_bytes\": 0, "
+                               "       \"rd_operations\": 16, "
+                               "       \"wr_operations\": 0 "
+                               "     } "
+                               "   } "
+                               "  ]"
+                               "}") < 0)
+        goto cleanup;
+
+    if (!(table = qemuMonitorGetAllBlockStatsInfo(qemuMonitorTestGetMonitor(test))))
+        goto cleanup;
+
+    if (virHashSize(table) != 2) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "table size %zd is not 2", virHashSize(table));
+        goto cleanup;
+    }
+
+#define CHECK(dev, field, want)                                         \
+    do {                                                                \
+        if (!(stats = virHashLookup(table, (dev)))) {                   \
+            virReportError(VIR_ERR_INTERNAL_ERROR,                      \
+                           "missing stats for %s", (dev));              \
+            goto cleanup;                                               \
+        }                                                               \
+        if (stats->field != (want)) {                                   \
+            virReportError(VIR_ERR_INTERNAL_ERROR,                      \
+                           "%s " #field " %lld is not %lld",            \
+                           (dev), stats->field, (long long) (want));    \
+            goto cleanup;                                               \
+        }                                                               \
+    } while (0)
+
+    CHECK("virtio-disk0", rd_bytes, 5256192);
+    CHECK("virtio-disk0", wr_req, 2);
+    CHECK("virtio-disk0", flush_req, 1);
+    CHECK("virtio-disk0", flush_total_times, 500000);
+    CHECK("ide0-1-0", rd_req, 16);
+    CHECK("ide0-1-0", flush_req, -1);
+    CHECK("ide0-1-0", rd_total_times, -1);
+
+#undef CHECK
+    ret = 0;
+
+cleanup:
+    virHashFree(table);
+    qemuMonitorTestFree(test);
+    return ret;
+}
+
+
+/* Looking up a single device must not fail because another
+ * device has statistics in an unexpected format */
+static int
+testQemuMonitorJSONGetBlockStatsInfo(const void *data)
+{
+    virCapsPtr caps = (virCapsPtr)data;
+    qemuMonitorTestPtr test = qemuMonitorTestNew(true, caps);
+    int ret = -1;
+    long long rd_req, rd_bytes, rd_total_times;
+    long long wr_req, wr_bytes, wr_total_times;
+    long long flush_req, flush_total_times, errs;
+
+    if (!test)
+        return -1;
+
+    if (qemuMonitorTestAddItem(test, "query-blockstats",
+                               "{ "
+                               "  \"return\": [ "
+                               "   { "
+                               "     \"device\": \"drive-ide0-1-0\", "
+                               "     \"stats\": { "
+                               "       \"wr_bytes\": 0 "
+                               "     } "
+                               "   }, "
+                               "   { "
+                               "     \"device\": \"drive-virtio-disk0\", "
+                               "     \"stats\": { "
+                               "       \"rd_bytes\": 5256192, "
+                               "       \"wr_bytes\": 8192, "
+                               "       \"rd_operations\": 332, "
+                               "       \"wr_operations\": 2, "
+                               "       \"flush_operations\": 1 "
+                               "     } "
+                               "   } "
+                               "  ]"
+                               "}") < 0)
+        goto cleanup;
+
+    if (qemuMonitorGetBlockStatsInfo(qemuMonitorTestGetMonitor(test),
+                                     "virtio-disk0",
+                                     &rd_req, &rd_bytes, &rd_total_times,
+                                     &wr_req, &wr_bytes, &wr_total_times,
+                                     &flush_req, &flush_total_times,
+                                     &errs) < 0)
+        goto cleanup;
+
+    if (rd_req != 332 || rd_bytes != 5256192 || rd_total_times != -1 ||
+        wr_req != 2 || wr_bytes != 8192 || wr_total_times != -1 ||
+        flush_req != 1 || flush_total_times != -1) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "unexpected statistics for virtio-disk0");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    qemuMonitorTestFree(test);
+    return ret;
+}
+
+
+static int
+testQemuMonitorJSONGetDomainStats(const void *data)
+{
+    virCapsPtr caps = (virCapsPtr)data;
+    qemuMonitorTestPtr test = qemuMonitorTestNew(true, caps);
+    int ret = -1;
+    qemuMonitorDomainStats stats;
+    qemuBlockStatsPtr bstats;
+
+    memset(&stats, 0, sizeof(stats));
+
+    if (!test)
+        return -1;
+
+    if (qemuMonitorTestAddItem(test, "query-balloon",
+                               "{ "
+                               "  \"return\": { "
+                               "    \"actual\": 536870912 "
+                               "  }"
+                               "}") < 0)
+        goto cleanup;
+
+    if (qemuMonitorTestAddItem(test, "query-blockstats",
+                               "{ "
+                               "  \"return\": [ "
+                               "   { "
+                               "     \"device\": \"drive-virtio-disk0\", "
+                               "     \"stats\": { "
+                               "       \"rd_bytes\": 5256192, "
+                               "       \"wr_bytes\": 8192, "
+                               "       \"rd_operations\": 332, "
+                               "       \"wr_operations\": 2 "
+                               "     } "
+                               "   } "
+                               "  ]"
+                               "}") < 0)
+        goto cleanup;
+
+    if (qemuMonitorGetDomainStats(qemuMonitorTestGetMonitor(test),
+                                  true, true, &stats) < 0)
+        goto cleanup;
+
+    if (stats.balloonRet != 1 || stats.balloon != 524288) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "balloon %d/%llu is not 1/524288",
+                       stats.balloonRet, stats.balloon);
+        goto cleanup;
+    }
+
+    if (!stats.blockstats ||
+        !(bstats = virHashLookup(stats.blockstats, "virtio-disk0"))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "missing stats for virtio-disk0");
+        goto cleanup;
+    }
+
+    if (bstats->rd_bytes != 5256192 || bstats->wr_req != 2) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "virtio-disk0 rd_bytes %lld wr_req %lld are wrong",
+                       bstats->rd_bytes, bstats->wr_req);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    virHashFree(stats.blockstats);
+    qemuMonitorTestFree(test);
+    return ret;
+}
+
+
+static int
+testQemuMonitorJSONGetMigrationStatus(const void *data)
+{
+    virCapsPtr caps = (virCapsPtr)data;
+    qemuMonitorTestPtr test = qemuMonitorTestNew(true, caps);
+    int ret = -1;
+    qemuMonitorMigrationStatus status;
+
+    if (!test)
+        return -1;
+
+    if (qemuMonitorTestAddItem(test, "query-migrate",
+                               "{ "
+                               "  \"return\": { "
+                               "    \"status\": \"active\", "
+                               "    \"total-time\": 4017, "
+                               "    \"expected-downtime\": 312, "
+                               "    \"setup-time\": 12, "
+                               "    \"ram\": { "
+                               "      \"transferred\": 123, "
+                               "      \"remaining\": 123, "
+                               "      \"total\": 246, "
+                               "      \"duplicate\": 20, "
+                               "      \"normal\": 30, "
+                               "      \"normal-bytes\": 122880, "
+                               "      \"dirty-pages-rate\": 1500, "
+                               "      \"mbps\": 800.0, "
+                               "      \"dirty-sync-count\": 3 "
+                               "    } "
+                               "  } "
+                               "}") < 0)
+        goto cleanup;
+
+    if (qemuMonitorGetMigrationStatus(qemuMonitorTestGetMonitor(test),
+                                      &status) < 0)
+        goto cleanup;
+
+    if (status.status != QEMU_MONITOR_MIGRATION_STATUS_ACTIVE ||
+        status.total_time != 4017 ||
+        !status.downtime_set || status.downtime != 312 ||
+        !status.setup_time_set || status.setup_time != 12) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "migration status or timing is wrong");
+        goto cleanup;
+    }
+
+    if (status.ram_transferred != 123 || status.ram_remaining != 123 ||
+        status.ram_total != 246 ||
+        !status.ram_duplicate_set || status.ram_duplicate != 20 ||
+        status.ram_normal != 30 || status.ram_normal_bytes != 122880) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "migration RAM counters are wrong");
+        goto cleanup;
+    }
+
+    if (!status.ram_dirty_rate_set || status.ram_dirty_rate != 1500 ||
+        !status.ram_bps_set || status.ram_bps != 100000000 ||
+        !status.ram_iteration_set || status.ram_iteration != 3) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "dirty rate %llu, bps %llu, iteration %llu are wrong",
+                       status.ram_dirty_rate, status.ram_bps,
+                       status.ram_iteration);
+        goto cleanup;
+    }
+
+    if (status.disk_total != 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "unexpected disk migration statistics");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    qemuMonitorTestFree(test);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -446,6 +742,10 @@ mymain(void)
     DO_TEST(GetMachines);
     DO_TEST(GetCPUDefinitions);
     DO_TEST(GetCommands);
+    DO_TEST(GetAllBlockStatsInfo);
+    DO_TEST(GetBlockStatsInfo);
+    DO_TEST(GetDomainStats);
+    DO_TEST(GetMigrationStatus);
 
     virCapabilitiesFree(caps);
 
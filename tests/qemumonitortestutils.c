@@ -105,6 +105,37 @@ static int qemuMonitorTestAddReponse(qemuMonitorTestPtr test,
 }
 
 
+/*
+ * Appends a JSON reply tagged with the @id of the command it
+ * answers, as QEMU does
+ */
+static int qemuMonitorTestAddReponseJSON(qemuMonitorTestPtr test,
+                                         const char *response,
+                                         const char *id)
+{
+    virJSONValuePtr val = NULL;
+    char *str = NULL;
+    int ret = -1;
+
+    if (!id)
+        return qemuMonitorTestAddReponse(test, response);
+
+    if (!(val = virJSONValueFromString(response)))
+        goto cleanup;
+
+    if (virJSONValueObjectAppendString(val, "id", id) < 0 ||
+        !(str = virJSONValueToString(val, false)))
+        goto cleanup;
+
+    ret = qemuMonitorTestAddReponse(test, str);
+
+cleanup:
+    VIR_FREE(str);
+    virJSONValueFree(val);
+    return ret;
+}
+
+
 /*
  * Processes a single line, looking for a matching expected
  * item to reply with, else replies with an error
@@ -114,11 +145,14 @@ static int qemuMonitorTestProcessCommandJSON(qemuMonitorTestPtr test,
 {
     virJSONValuePtr val;
     const char *cmdname;
+    const char *id;
     int ret = -1;
 
     if (!(val = virJSONValueFromString(cmdstr)))
         return -1;
 
+    id = virJSONValueObjectGetString(val, "id");
+
     if (!(cmdname = virJSONValueObjectGetString(val, "execute"))) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        "Missing command name in %s", cmdstr);
@@ -127,13 +161,15 @@ static int qemuMonitorTestProcessCommandJSON(qemuMonitorTestPtr test,
 
     if (test->nitems == 0 ||
         STRNEQ(test->items[0]->command_name, cmdname)) {
-        ret = qemuMonitorTestAddReponse(test,
-                                        "{ \"error\": "
-                                        " { \"desc\": \"Unexpected command\", "
-                                        "   \"class\": \"UnexpectedCommand\" } }");
+        ret = qemuMonitorTestAddReponseJSON(test,
+                                            "{ \"error\": "
+                                            " { \"desc\": \"Unexpected command\", "
+                                            "   \"class\": \"UnexpectedCommand\" } }",
+                                            id);
     } else {
-        ret = qemuMonitorTestAddReponse(test,
-                                        test->items[0]->response);
+        ret = qemuMonitorTestAddReponseJSON(test,
+                                            test->items[0]->response,
+                                            id);
         qemuMonitorTestItemFree(test->items[0]);
         if (test->nitems == 1) {
             VIR_FREE(test->items);
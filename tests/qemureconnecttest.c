@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "testutils.h"
+#include "qemu/qemu_conf.h"
+#include "qemu/qemu_domain.h"
+#include "qemu/qemu_process.h"
+#include "viralloc.h"
+#include "virerror.h"
+#include "virthread.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+static virQEMUDriver driver;
+
+static virDomainObjPtr
+testDomainNew(void)
+{
+    virDomainObjPtr vm;
+
+    if (!(vm = virDomainObjNew(driver.caps)))
+        return NULL;
+
+    if (VIR_ALLOC(vm->def) < 0 ||
+        !(vm->def->name = strdup("reconnect"))) {
+        virReportOOMError();
+        virObjectUnlock(vm);
+        virObjectUnref(vm);
+        return NULL;
+    }
+    vm->def->id = -1;
+
+    return vm;
+}
+
+
+/* Jobs started on behalf of APIs fail straight away while the domain
+ * is being reconnected, rather than wait for the reconnect worker */
+static int
+testApiFailsFast(const void *data ATTRIBUTE_UNUSED)
+{
+    virDomainObjPtr vm;
+    qemuDomainObjPrivatePtr priv;
+    virErrorPtr err;
+    int ret = -1;
+
+    if (!(vm = testDomainNew()))
+        return -1;
+    priv = vm->privateData;
+
+    priv->reconnecting = true;
+    virResetLastError();
+    if (qemuDomainObjBeginJob(&driver, vm, QEMU_JOB_QUERY) == 0) {
+        ignore_value(qemuDomainObjEndJob(&driver, vm));
+        goto cleanup;
+    }
+
+    err = virGetLastError();
+    if (!err || err->code != VIR_ERR_OPERATION_INVALID ||
+        priv->jobs_queued != 0 || priv->job.active != QEMU_JOB_NONE)
+        goto cleanup;
+
+    priv->reconnecting = false;
+    if (qemuDomainObjBeginJob(&driver, vm, QEMU_JOB_QUERY) < 0)
+        goto cleanup;
+    if (!qemuDomainObjEndJob(&driver, vm)) {
+        vm = NULL;
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    if (vm) {
+        virObjectUnlock(vm);
+        virObjectUnref(vm);
+    }
+    virResetLastError();
+    return ret;
+}
+
+
+struct testInternalJob {
+    virDomainObjPtr vm;
+    bool done;
+    int ret;
+};
+
+static void
+testInternalJobThread(void *opaque)
+{
+    struct testInternalJob *data = opaque;
+    virDomainObjPtr vm = data->vm;
+
+    qemuDriverLock(&driver);
+    virObjectLock(vm);
+    data->ret = qemuDomainObjBeginInternalJobWithDriver(&driver, vm,
+                                                        QEMU_JOB_MODIFY);
+    data->done = true;
+    if (data->ret == 0)
+        ignore_value(qemuDomainObjEndJob(&driver, vm));
+    virObjectUnlock(vm);
+    qemuDriverUnlock(&driver);
+}
+
+/* Jobs the driver starts itself, such as a fake reboot, wait for
+ * the reconnect instead */
+static int
+testInternalWaits(const void *data ATTRIBUTE_UNUSED)
+{
+    struct testInternalJob job;
+    virDomainObjPtr vm;
+    qemuDomainObjPrivatePtr priv;
+    virThread thread;
+    bool done;
+    int ret = -1;
+
+    if (!(vm = testDomainNew()))
+        return -1;
+    priv = vm->privateData;
+
+    /* What qemuProcessReconnectHelper does */
+    qemuDriverLock(&driver);
+    if (qemuDomainObjBeginJobWithDriver(&driver, vm, QEMU_JOB_MODIFY) < 0) {
+        qemuDriverUnlock(&driver);
+        goto cleanup;
+    }
+    priv->reconnecting = true;
+    virObjectUnlock(vm);
+    qemuDriverUnlock(&driver);
+
+    memset(&job, 0, sizeof(job));
+    job.vm = vm;
+    if (virThreadCreate(&thread, true, testInternalJobThread, &job) < 0) {
+        virObjectLock(vm);
+        priv->reconnecting = false;
+        ignore_value(qemuDomainObjEndJob(&driver, vm));
+        goto cleanup;
+    }
+
+    usleep(100 * 1000);
+    virObjectLock(vm);
+    done = job.done;
+    virObjectUnlock(vm);
+
+    /* And what the reconnect worker does when it is finished */
+    qemuDriverLock(&driver);
+    virObjectLock(vm);
+    priv->reconnecting = false;
+    ignore_value(qemuDomainObjEndJob(&driver, vm));
+    virObjectUnlock(vm);
+    qemuDriverUnlock(&driver);
+
+    virThreadJoin(&thread);
+    virObjectLock(vm);
+
+    if (done) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "internal job did not wait for the reconnect\n");
+        goto cleanup;
+    }
+    if (job.ret < 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virObjectUnlock(vm);
+    virObjectUnref(vm);
+    return ret;
+}
+
+
+/* Domains with an interrupted async job are reconnected first, then
+ * running ones, then the rest */
+static int
+testReconnectOrder(const void *data ATTRIBUTE_UNUSED)
+{
+    virDomainObjPtr vm;
+    int ret = -1;
+
+    if (!(vm = testDomainNew()))
+        return -1;
+
+    virDomainObjSetState(vm, VIR_DOMAIN_PAUSED, VIR_DOMAIN_PAUSED_MIGRATION);
+    if (qemuProcessReconnectPriority(vm, QEMU_ASYNC_JOB_MIGRATION_OUT) !=
+        QEMU_PROCESS_RECONNECT_JOB ||
+        qemuProcessReconnectPriority(vm, QEMU_ASYNC_JOB_NONE) !=
+        QEMU_PROCESS_RECONNECT_OTHER)
+        goto cleanup;
+
+    virDomainObjSetState(vm, VIR_DOMAIN_RUNNING, VIR_DOMAIN_RUNNING_BOOTED);
+    if (qemuProcessReconnectPriority(vm, QEMU_ASYNC_JOB_SAVE) !=
+        QEMU_PROCESS_RECONNECT_JOB ||
+        qemuProcessReconnectPriority(vm, QEMU_ASYNC_JOB_NONE) !=
+        QEMU_PROCESS_RECONNECT_RUNNING)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virObjectUnlock(vm);
+    virObjectUnref(vm);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virThreadInitialize() < 0 ||
+        virMutexInit(&driver.lock) < 0)
+        return EXIT_FAILURE;
+
+    if (!(driver.caps = virCapabilitiesNew(VIR_ARCH_X86_64, 0, 0)) ||
+        !(driver.config = virQEMUDriverConfigNew(false)))
+        return EXIT_FAILURE;
+    qemuDomainSetPrivateDataHooks(driver.caps);
+
+    if (virtTestRun("API jobs fail fast", 1, testApiFailsFast, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Internal jobs wait", 1, testInternalWaits, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Reconnect order", 1, testReconnectOrder, NULL) < 0)
+        ret = -1;
+
+    virObjectUnref(driver.config);
+    virCapabilitiesFree(driver.caps);
+    virMutexDestroy(&driver.lock);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
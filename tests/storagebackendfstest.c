@@ -0,0 +1,304 @@
+/*
+ * storagebackendfstest.c: incremental refresh of directory pools
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+
+#include "internal.h"
+#include "testutils.h"
+#include "storage/storage_backend_fs.h"
+#include "viralloc.h"
+#include "virfile.h"
+#include "virevent.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+static char *tmpdir;
+
+static int
+testWriteVol(const char *name, size_t size, int flags)
+{
+    char *path = NULL;
+    char *buf = NULL;
+    int fd = -1;
+    int ret = -1;
+
+    if (virAsprintf(&path, "%s/%s", tmpdir, name) < 0 ||
+        VIR_ALLOC_N(buf, size + 1) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+    memset(buf, 'x', size);
+
+    if ((fd = open(path, O_WRONLY | O_CREAT | flags, 0600)) < 0 ||
+        safewrite(fd, buf, size) != size ||
+        VIR_CLOSE(fd) < 0) {
+        virReportSystemError(errno, "cannot write '%s'", path);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    VIR_FORCE_CLOSE(fd);
+    VIR_FREE(buf);
+    VIR_FREE(path);
+    return ret;
+}
+
+/* Open @name for appending to it while the pool is refreshed */
+static int
+testOpenVol(const char *name)
+{
+    char *path = NULL;
+    int fd;
+
+    if (virAsprintf(&path, "%s/%s", tmpdir, name) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    if ((fd = open(path, O_WRONLY | O_APPEND)) < 0)
+        virReportSystemError(errno, "cannot open '%s'", path);
+
+    VIR_FREE(path);
+    return fd;
+}
+
+static int
+testRemoveVol(const char *name)
+{
+    char *path = NULL;
+    int ret = -1;
+
+    if (virAsprintf(&path, "%s/%s", tmpdir, name) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    if (unlink(path) < 0)
+        virReportSystemError(errno, "cannot remove '%s'", path);
+    else
+        ret = 0;
+
+    VIR_FREE(path);
+    return ret;
+}
+
+static void
+testCleanupVols(void)
+{
+    const char *names[] = { "a.img", "b.img", "c.img" };
+    char *path;
+    size_t i;
+
+    for (i = 0 ; i < ARRAY_CARDINALITY(names) ; i++) {
+        if (virAsprintf(&path, "%s/%s", tmpdir, names[i]) < 0)
+            continue;
+        unlink(path);
+        VIR_FREE(path);
+    }
+}
+
+struct testVolInfo {
+    const char *name;
+    unsigned long long capacity;
+};
+
+/* Refresh @pool and check it has exactly the volumes in @vols */
+static int
+testRefresh(virStoragePoolObjPtr pool,
+            const struct testVolInfo *vols,
+            size_t nvols)
+{
+    size_t i;
+
+    if (virStorageBackendDirectory.refreshPool(NULL, pool) < 0)
+        return -1;
+
+    if (pool->volumes.count != nvols) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "expected %zu volumes, got %u\n",
+                    nvols, pool->volumes.count);
+        return -1;
+    }
+
+    for (i = 0 ; i < nvols ; i++) {
+        virStorageVolDefPtr vol;
+
+        if (!(vol = virStorageVolDefFindByName(pool, vols[i].name))) {
+            if (virTestGetVerbose())
+                fprintf(stderr, "missing volume '%s'\n", vols[i].name);
+            return -1;
+        }
+
+        if (vol->capacity != vols[i].capacity ||
+            vol->allocation > vol->capacity + 4096) {
+            if (virTestGetVerbose())
+                fprintf(stderr,
+                        "volume '%s' has capacity %llu allocation %llu, "
+                        "expected capacity %llu\n",
+                        vols[i].name, vol->capacity, vol->allocation,
+                        vols[i].capacity);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+testIncrementalRefresh(const void *data)
+{
+    bool watch = *(const bool *)data;
+    virStoragePoolObjList pools;
+    virStoragePoolDefPtr def = NULL;
+    virStoragePoolObjPtr pool = NULL;
+    char *xml = NULL;
+    char buf[200];
+    int fd = -1;
+    int ret = -1;
+    const struct testVolInfo initial[] = {
+        { "a.img", 1024 },
+        { "b.img", 2048 },
+    };
+    const struct testVolInfo changed[] = {
+        { "a.img", 4096 },
+        { "c.img", 512 },
+    };
+    const struct testVolInfo rewritten[] = {
+        { "a.img", 100 },
+        { "c.img", 512 },
+    };
+    const struct testVolInfo grown[] = {
+        { "a.img", 100 + sizeof(buf) },
+        { "c.img", 512 },
+    };
+
+    memset(&pools, 0, sizeof(pools));
+
+    if (virAsprintf(&xml,
+                    "<pool type='dir'>"
+                    "  <name>fstest</name>"
+                    "  <target><path>%s</path>%s</target>"
+                    "</pool>", tmpdir, watch ? "<watch/>" : "") < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    if (!(def = virStoragePoolDefParseString(xml)) ||
+        !(pool = virStoragePoolObjAssignDef(&pools, def)))
+        goto cleanup;
+    def = NULL;
+
+    /* The first refresh scans the directory */
+    if (testWriteVol("a.img", 1024, O_TRUNC) < 0 ||
+        testWriteVol("b.img", 2048, O_TRUNC) < 0 ||
+        testRefresh(pool, initial, ARRAY_CARDINALITY(initial)) < 0)
+        goto cleanup;
+
+#if HAVE_SYS_INOTIFY_H
+    /* The directory is only watched when asked to */
+    if (!pool->volumes.privateData != !watch) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "pool directory is %swatched\n",
+                    watch ? "not " : "");
+        goto cleanup;
+    }
+#endif
+
+    /* Growing, creating and deleting files must all be picked up
+     * straight away, without the event loop having run */
+    if (testWriteVol("a.img", 3072, O_APPEND) < 0 ||
+        testRemoveVol("b.img") < 0 ||
+        testWriteVol("c.img", 512, O_TRUNC) < 0 ||
+        testRefresh(pool, changed, ARRAY_CARDINALITY(changed)) < 0)
+        goto cleanup;
+
+    /* Rewriting a file in place must not leave a stale size */
+    if (testWriteVol("a.img", 100, O_TRUNC) < 0 ||
+        testRefresh(pool, rewritten, ARRAY_CARDINALITY(rewritten)) < 0)
+        goto cleanup;
+
+    /* Nothing changed, nothing may be lost */
+    if (testRefresh(pool, rewritten, ARRAY_CARDINALITY(rewritten)) < 0)
+        goto cleanup;
+
+    /* Writes to a file which is still open, like the image of a
+     * running guest, must be picked up too */
+    memset(buf, 'x', sizeof(buf));
+    if ((fd = testOpenVol("a.img")) < 0)
+        goto cleanup;
+    if (safewrite(fd, buf, sizeof(buf)) != sizeof(buf)) {
+        virReportSystemError(errno, "%s", "cannot append to 'a.img'");
+        goto cleanup;
+    }
+    if (testRefresh(pool, grown, ARRAY_CARDINALITY(grown)) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    VIR_FORCE_CLOSE(fd);
+    if (pool)
+        virStoragePoolObjUnlock(pool);
+    virStoragePoolObjListFree(&pools);
+    virStoragePoolDefFree(def);
+    VIR_FREE(xml);
+    testCleanupVols();
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+    char template[] = "/tmp/libvirt_XXXXXX";
+    bool scan = false;
+    bool watch = true;
+
+    if (!(tmpdir = mkdtemp(template))) {
+        fprintf(stderr, "Cannot create temporary directory\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Lets the pool directory be watched */
+    virEventRegisterDefaultImpl();
+
+    if (virtTestRun("incremental refresh", 1,
+                    testIncrementalRefresh, &scan) < 0)
+        ret = -1;
+    if (virtTestRun("incremental refresh with watch", 1,
+                    testIncrementalRefresh, &watch) < 0)
+        ret = -1;
+
+    rmdir(tmpdir);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
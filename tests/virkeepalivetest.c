@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include "testutils.h"
+#include "virerror.h"
+#include "virevent.h"
+#include "rpc/virkeepalive.h"
+
+#define VIR_FROM_THIS VIR_FROM_RPC
+
+/* Two seconds before both the level 0 and level 1 slots of the
+ * wheel wrap around */
+#define TEST_START (64 * 64 * 10 - 2)
+
+static time_t testNow;
+
+static time_t
+testClock(time_t *t)
+{
+    if (t)
+        *t = testNow;
+    return testNow;
+}
+
+/* Seconds since the start of the test, or -1 for never */
+static long
+testOffset(time_t t)
+{
+    return t ? (long) (t - TEST_START) : -1;
+}
+
+
+struct testClient {
+    const char *name;
+    int interval;
+    unsigned int count;
+    bool stop;              /* Stopped before its first ping */
+    time_t pinged;          /* Expected time of the first ping */
+    time_t died;            /* Expected time it is declared dead */
+
+    virKeepAlivePtr ka;
+    size_t npings;
+    time_t gotPinged;
+    time_t gotDied;
+    bool freed;
+};
+
+static int
+testSend(void *opaque, virNetMessagePtr msg)
+{
+    struct testClient *client = opaque;
+
+    if (client->npings++ == 0)
+        client->gotPinged = testNow;
+    virNetMessageFree(msg);
+    return 0;
+}
+
+static void
+testDead(void *opaque)
+{
+    struct testClient *client = opaque;
+
+    client->gotDied = testNow;
+}
+
+static void
+testFree(void *opaque)
+{
+    struct testClient *client = opaque;
+
+    client->freed = true;
+}
+
+
+/* Any message received marks the client as alive */
+static int
+testReceived(struct testClient *client)
+{
+    virNetMessagePtr msg;
+    virNetMessagePtr response;
+
+    if (!(msg = virNetMessageNew(false)))
+        return -1;
+    virKeepAliveCheckMessage(client->ka, msg, &response);
+    virNetMessageFree(msg);
+    virNetMessageFree(response);
+    return 0;
+}
+
+
+/*
+ * Clients whose keepalives fall in a level 0 slot past the wrap
+ * around, in a level 1 slot past the wrap around, and beyond the
+ * span of the wheel, are pinged and declared dead on time. Stopping
+ * a keepalive takes it out of its slot, whether first, last or in
+ * the middle of it, without disturbing the others.
+ */
+static int
+testWheel(const void *opaque ATTRIBUTE_UNUSED)
+{
+    virKeepAliveWheelPtr wheel = NULL;
+    struct testClient clients[] = {
+        /* Keepalives are linked at the head of their slot */
+        { "stopped last", 10, 1, true, 0, 0 },
+        { "level 0", 10, 1, false, TEST_START + 10, TEST_START + 20 },
+        { "stopped middle", 10, 1, true, 0, 0 },
+        { "level 0 again", 10, 1, false, TEST_START + 10, TEST_START + 20 },
+        { "level 1", 100, 2, false, TEST_START + 100, TEST_START + 300 },
+        { "level 1 boundary", 66, 0, false, 0, TEST_START + 66 },
+        { "beyond span", 5000, 0, false, 0, TEST_START + 5000 },
+        { "stopped first", 10, 1, true, 0, 0 },
+    };
+    size_t nclients = ARRAY_CARDINALITY(clients);
+    time_t end = TEST_START + 5001;
+    size_t i;
+    int ret = -1;
+
+    testNow = TEST_START;
+
+    if (!(wheel = virKeepAliveWheelNew(NULL)))
+        goto cleanup;
+    virKeepAliveWheelSetClock(wheel, testClock);
+
+    for (i = 0 ; i < nclients ; i++) {
+        struct testClient *client = &clients[i];
+
+        if (!(client->ka = virKeepAliveNew(client->interval, client->count,
+                                           client, testSend, testDead,
+                                           testFree)))
+            goto cleanup;
+        virKeepAliveSetWheel(client->ka, wheel);
+
+        if (testReceived(client) < 0 ||
+            virKeepAliveStart(client->ka, 0, 0) < 0)
+            goto cleanup;
+    }
+
+    /* All the stopped ones share a slot with the "level 0" ones */
+    testNow++;
+    virKeepAliveWheelRun(wheel);
+    for (i = 0 ; i < nclients ; i++) {
+        if (clients[i].stop)
+            virKeepAliveStop(clients[i].ka);
+    }
+
+    while (testNow < end) {
+        testNow++;
+        virKeepAliveWheelRun(wheel);
+    }
+
+    for (i = 0 ; i < nclients ; i++) {
+        struct testClient *client = &clients[i];
+
+        if (client->gotPinged != client->pinged ||
+            client->gotDied != client->died) {
+            if (virTestGetVerbose())
+                fprintf(stderr,
+                        "%s: pinged at %ld, died at %ld, "
+                        "expected %ld and %ld\n",
+                        client->name,
+                        testOffset(client->gotPinged),
+                        testOffset(client->gotDied),
+                        testOffset(client->pinged),
+                        testOffset(client->died));
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+cleanup:
+    for (i = 0 ; i < nclients ; i++) {
+        if (!clients[i].ka)
+            continue;
+        virKeepAliveStop(clients[i].ka);
+        virObjectUnref(clients[i].ka);
+        /* Once stopped, the wheel must not hold on to any of them */
+        if (!clients[i].freed) {
+            if (virTestGetVerbose())
+                fprintf(stderr, "%s: still referenced\n", clients[i].name);
+            ret = -1;
+        }
+    }
+    virKeepAliveWheelFree(wheel);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    /* The wheel timer goes to the default event loop */
+    virEventRegisterDefaultImpl();
+
+    if (virtTestRun("Keepalive wheel", 1, testWheel, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
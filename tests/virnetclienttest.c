@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "testutils.h"
+#include "virutil.h"
+#include "virerror.h"
+#include "viralloc.h"
+#include "virfile.h"
+#include "virlog.h"
+#include "virthread.h"
+
+#include "rpc/virnetclient.h"
+#include "rpc/virnetsocket.h"
+
+#define VIR_FROM_THIS VIR_FROM_RPC
+
+#ifndef WIN32
+
+# define TEST_PROGRAM 0x11223344
+# define TEST_VERSION 1
+# define NCALLS 8
+
+/* What the fake daemon at the other end of the socket does */
+struct testServer {
+    int fd;
+    size_t nread;               /* Calls to read before replying */
+    size_t nreply;              /* Calls to reply to, last one first */
+    bool waitEOF;               /* Read until the client goes away */
+    unsigned int serials[NCALLS];
+    int ret;
+};
+
+/* What a reply callback was handed */
+struct testReply {
+    size_t ncalls;
+    int status;
+    unsigned int value;
+};
+
+static struct testReply replies[NCALLS];
+
+
+static virNetMessagePtr
+testServerRead(int fd)
+{
+    virNetMessagePtr msg;
+
+    if (!(msg = virNetMessageNew(false)))
+        return NULL;
+
+    if (virNetMessageReserveBuffer(msg, VIR_NET_MESSAGE_LEN_MAX) < 0)
+        goto error;
+    msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
+
+    if (saferead(fd, msg->buffer, msg->bufferLength) != msg->bufferLength ||
+        virNetMessageDecodeLength(msg) < 0)
+        goto error;
+
+    if (saferead(fd, msg->buffer + msg->bufferOffset,
+                 msg->bufferLength - msg->bufferOffset) !=
+        msg->bufferLength - msg->bufferOffset ||
+        virNetMessageDecodeHeader(msg) < 0)
+        goto error;
+
+    return msg;
+
+error:
+    virNetMessageFree(msg);
+    return NULL;
+}
+
+
+/* Reply to call @serial with ten times its serial as payload */
+static int
+testServerReply(int fd, unsigned int serial)
+{
+    virNetMessagePtr msg;
+    unsigned int value = serial * 10;
+    int ret = -1;
+
+    if (!(msg = virNetMessageNew(false)))
+        return -1;
+
+    msg->header.prog = TEST_PROGRAM;
+    msg->header.vers = TEST_VERSION;
+    msg->header.proc = serial;
+    msg->header.type = VIR_NET_REPLY;
+    msg->header.serial = serial;
+    msg->header.status = VIR_NET_OK;
+
+    if (virNetMessageEncodeHeader(msg) < 0 ||
+        virNetMessageEncodePayload(msg, (xdrproc_t)xdr_u_int, &value) < 0)
+        goto cleanup;
+
+    if (safewrite(fd, msg->buffer, msg->bufferLength) != msg->bufferLength)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virNetMessageFree(msg);
+    return ret;
+}
+
+
+static void
+testServerRun(void *opaque)
+{
+    struct testServer *srv = opaque;
+    virNetMessagePtr msg;
+    size_t i;
+    char c;
+
+    srv->ret = -1;
+
+    for (i = 0 ; i < srv->nread ; i++) {
+        if (!(msg = testServerRead(srv->fd)))
+            goto cleanup;
+        srv->serials[i] = msg->header.serial;
+        virNetMessageFree(msg);
+    }
+
+    /* Replies go out in the opposite order to the calls */
+    for (i = srv->nreply ; i > 0 ; i--) {
+        if (testServerReply(srv->fd, srv->serials[i - 1]) < 0)
+            goto cleanup;
+    }
+
+    /* Whatever was sent before the client went away is ignored */
+    if (srv->waitEOF) {
+        ssize_t got;
+
+        while ((got = saferead(srv->fd, &c, 1)) > 0)
+            ;
+        if (got < 0)
+            goto cleanup;
+    }
+
+    srv->ret = 0;
+
+cleanup:
+    VIR_FORCE_CLOSE(srv->fd);
+}
+
+
+static void
+testReplyCallback(virNetClientPtr client ATTRIBUTE_UNUSED,
+                  int status,
+                  virNetMessagePtr msg,
+                  void *opaque)
+{
+    struct testReply *reply = opaque;
+
+    reply->ncalls++;
+    reply->status = status;
+    if (status == 0 &&
+        virNetMessageDecodePayload(msg, (xdrproc_t)xdr_u_int,
+                                   &reply->value) < 0)
+        reply->status = -2;
+}
+
+
+static int
+testSendCalls(virNetClientPtr client, size_t ncalls)
+{
+    size_t i;
+
+    for (i = 0 ; i < ncalls ; i++) {
+        virNetMessagePtr msg;
+
+        if (!(msg = virNetMessageNew(false)))
+            return -1;
+
+        msg->header.prog = TEST_PROGRAM;
+        msg->header.vers = TEST_VERSION;
+        msg->header.proc = i + 1;
+        msg->header.type = VIR_NET_CALL;
+        msg->header.serial = i + 1;
+        msg->header.status = VIR_NET_OK;
+
+        if (virNetMessageEncodeHeader(msg) < 0 ||
+            virNetMessageEncodePayloadEmpty(msg) < 0 ||
+            virNetClientSendAsync(client, msg, testReplyCallback,
+                                  &replies[i]) < 0) {
+            virNetMessageFree(msg);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+struct testAsyncData {
+    size_t ncalls;              /* Async calls to make */
+    size_t nreply;              /* How many of them get a reply */
+    bool clientClose;           /* Close the client instead of waiting */
+};
+
+/*
+ * Issue async calls to a fake daemon over a UNIX socket, collect
+ * the replies and check that every callback ran exactly once, with
+ * the right reply, however the daemon ordered them, and with an
+ * error for the calls the connection was closed on.
+ */
+static int
+testAsync(const void *opaque)
+{
+    const struct testAsyncData *data = opaque;
+    virNetSocketPtr lsock = NULL; /* Listen socket */
+    virNetSocketPtr ssock = NULL; /* Server socket */
+    virNetClientPtr client = NULL;
+    struct testServer srv;
+    virThread thread;
+    bool haveThread = false;
+    char *path = NULL;
+    char *tmpdir;
+    char template[] = "/tmp/libvirt_XXXXXX";
+    size_t i;
+    int ret = -1;
+
+    memset(&srv, 0, sizeof(srv));
+    srv.fd = -1;
+    memset(replies, 0, sizeof(replies));
+
+    if (!(tmpdir = mkdtemp(template))) {
+        VIR_WARN("Failed to create temporary directory");
+        goto cleanup;
+    }
+    if (virAsprintf(&path, "%s/test.sock", tmpdir) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    if (virNetSocketNewListenUNIX(path, 0700, -1, getgid(), &lsock) < 0 ||
+        virNetSocketListen(lsock, 0) < 0)
+        goto cleanup;
+
+    if (!(client = virNetClientNewUNIX(path, false, NULL)))
+        goto cleanup;
+
+    if (virNetSocketAccept(lsock, &ssock) < 0 || !ssock ||
+        (srv.fd = virNetSocketDupFD(ssock, true)) < 0 ||
+        virSetBlocking(srv.fd, true) < 0)
+        goto cleanup;
+    virObjectUnref(ssock);
+    ssock = NULL;
+
+    srv.nread = data->clientClose ? 0 : data->ncalls;
+    srv.nreply = data->nreply;
+    srv.waitEOF = data->clientClose;
+    if (virThreadCreate(&thread, true, testServerRun, &srv) < 0)
+        goto cleanup;
+    haveThread = true;
+
+    if (testSendCalls(client, data->ncalls) < 0)
+        goto cleanup;
+
+    if (data->clientClose) {
+        /* Pending calls are failed by closing the client, nobody
+         * has to wait for them */
+        virNetClientClose(client);
+    } else if (virNetClientWaitAsync(client) < 0 &&
+               data->nreply == data->ncalls) {
+        goto cleanup;
+    }
+
+    virThreadJoin(&thread);
+    haveThread = false;
+    if (srv.ret < 0)
+        goto cleanup;
+
+    for (i = 0 ; i < data->ncalls ; i++) {
+        /* The daemon replied to the first nreply calls */
+        bool answered = i < data->nreply;
+
+        if (replies[i].ncalls != 1 ||
+            replies[i].status != (answered ? 0 : -1) ||
+            (answered && replies[i].value != (i + 1) * 10)) {
+            if (virTestGetVerbose())
+                fprintf(stderr,
+                        "call %zu: %zu callbacks, status %d, value %u\n",
+                        i, replies[i].ncalls, replies[i].status,
+                        replies[i].value);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+cleanup:
+    if (client)
+        virNetClientClose(client);
+    virObjectUnref(client);
+    if (haveThread)
+        virThreadJoin(&thread);
+    VIR_FORCE_CLOSE(srv.fd);
+    virObjectUnref(ssock);
+    virObjectUnref(lsock);
+    if (path)
+        unlink(path);
+    VIR_FREE(path);
+    if (tmpdir)
+        rmdir(tmpdir);
+    return ret;
+}
+#endif
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+#ifndef WIN32
+    struct testAsyncData replyAll = { NCALLS, NCALLS, false };
+    struct testAsyncData hangUp = { 3, 1, false };
+    struct testAsyncData cancel = { 3, 0, true };
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (virtTestRun("Async replies out of order", 1,
+                    testAsync, &replyAll) < 0)
+        ret = -1;
+    if (virtTestRun("Async calls failed by daemon hang up", 1,
+                    testAsync, &hangUp) < 0)
+        ret = -1;
+    if (virtTestRun("Async calls cancelled by closing", 1,
+                    testAsync, &cancel) < 0)
+        ret = -1;
+#endif
+
+    return ret==0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
@@ -28,6 +28,7 @@
 #include "virerror.h"
 #include "viralloc.h"
 #include "virlog.h"
+#include "virfile.h"
 
 #include "rpc/virnetmessage.h"
 
@@ -47,7 +48,7 @@ static int testMessageHeaderEncode(const void *args ATTRIBUTE_UNUSED)
     };
     /* According to doc to virNetMessageEncodeHeader(&msg):
      * msg->buffer will be this long */
-    unsigned long msg_buf_size = VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX;
+    unsigned long msg_buf_size = VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX;
     int ret = -1;
 
     if (!msg) {
@@ -527,6 +528,284 @@ cleanup:
 }
 
 
+static int testMessagePayloadStreamReserve(const void *args ATTRIBUTE_UNUSED)
+{
+    const char *stream = "The quick brown fox jumps over the lazy dog";
+    size_t len = strlen(stream);
+    virNetMessagePtr msg = virNetMessageNew(true);
+    static const char expect[] = {
+        0x00, 0x00, 0x00, 0x47,  /* Length */
+        0x11, 0x22, 0x33, 0x44,  /* Program */
+        0x00, 0x00, 0x00, 0x01,  /* Version */
+        0x00, 0x00, 0x06, 0x66,  /* Procedure */
+        0x00, 0x00, 0x00, 0x03,  /* Type */
+        0x00, 0x00, 0x00, 0x99,  /* Serial */
+        0x00, 0x00, 0x00, 0x02,  /* Status */
+    };
+    struct iovec iov[VIR_NET_MESSAGE_NIOV];
+    char *payload;
+    int ret = -1;
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.type = VIR_NET_STREAM;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_CONTINUE;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (!(payload = virNetMessageReservePayload(msg, len)))
+        goto cleanup;
+    memcpy(payload, stream, len);
+
+    if (virNetMessageEncodePayloadRaw(msg, payload, len) < 0)
+        goto cleanup;
+
+    /* The header and the data must be sent from their own buffers */
+    if (virNetMessageGetIOV(msg, iov) != 2) {
+        VIR_DEBUG("Expect 2 iovecs");
+        goto cleanup;
+    }
+
+    if (iov[0].iov_len != sizeof(expect) ||
+        memcmp(expect, iov[0].iov_base, sizeof(expect)) != 0) {
+        VIR_DEBUG("Unexpected message header");
+        goto cleanup;
+    }
+
+    if (iov[1].iov_base != payload ||
+        iov[1].iov_len != len) {
+        VIR_DEBUG("Expect payload sent in place");
+        goto cleanup;
+    }
+
+    /* A partial write ending inside the payload */
+    virNetMessageAdvance(msg, sizeof(expect) + 10);
+    if (virNetMessageIsSent(msg) ||
+        virNetMessageGetIOV(msg, iov) != 1 ||
+        iov[0].iov_base != payload + 10 ||
+        iov[0].iov_len != len - 10) {
+        VIR_DEBUG("Unexpected state after partial write");
+        goto cleanup;
+    }
+
+    virNetMessageAdvance(msg, len - 10);
+    if (!virNetMessageIsSent(msg) ||
+        virNetMessageGetIOV(msg, iov) != 0) {
+        VIR_DEBUG("Expect message sent");
+        goto cleanup;
+    }
+
+    ret = 0;
+cleanup:
+    virNetMessageFree(msg);
+    return ret;
+}
+
+
+static int testMessagePayloadStreamSplice(const void *args ATTRIBUTE_UNUSED)
+{
+    const char *stream = "The quick brown fox jumps over the lazy dog";
+    size_t len = strlen(stream);
+    virNetMessagePtr msg = virNetMessageNew(true);
+    static const char expect[] = {
+        0x00, 0x00, 0x00, 0x47,  /* Length */
+        0x11, 0x22, 0x33, 0x44,  /* Program */
+        0x00, 0x00, 0x00, 0x01,  /* Version */
+        0x00, 0x00, 0x06, 0x66,  /* Procedure */
+        0x00, 0x00, 0x00, 0x03,  /* Type */
+        0x00, 0x00, 0x00, 0x99,  /* Serial */
+        0x00, 0x00, 0x00, 0x02,  /* Status */
+    };
+    struct iovec iov[VIR_NET_MESSAGE_NIOV];
+    char buf[100];
+    int fds[2] = { -1, -1 };
+    int ret = -1;
+
+    /* Closing the write end lets the read below stop at the end
+     * of the data rather than wait for more */
+    if (pipe(fds) < 0 ||
+        safewrite(fds[1], stream, len) != len ||
+        VIR_CLOSE(fds[1]) < 0)
+        goto cleanup;
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.type = VIR_NET_STREAM;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_CONTINUE;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (virNetMessageEncodePayloadSplice(msg, fds[0], len) < 0)
+        goto cleanup;
+    fds[0] = -1;
+
+    /* Only the header is in memory, with the length of the data */
+    if (virNetMessageGetIOV(msg, iov) != 1 ||
+        iov[0].iov_len != sizeof(expect) ||
+        memcmp(expect, iov[0].iov_base, sizeof(expect)) != 0) {
+        VIR_DEBUG("Unexpected message header");
+        goto cleanup;
+    }
+
+    virNetMessageAdvance(msg, sizeof(expect));
+    if (virNetMessageIsSent(msg) ||
+        virNetMessageGetIOV(msg, iov) != 0) {
+        VIR_DEBUG("Expect data still to be spliced");
+        goto cleanup;
+    }
+
+    /* Stand in for the socket */
+    if (saferead(msg->spliceFd, buf, sizeof(buf)) != len ||
+        memcmp(buf, stream, len) != 0) {
+        VIR_DEBUG("Unexpected data in the pipe");
+        goto cleanup;
+    }
+    msg->spliceOffset += len;
+
+    if (!virNetMessageIsSent(msg)) {
+        VIR_DEBUG("Expect message sent");
+        goto cleanup;
+    }
+
+    ret = 0;
+cleanup:
+    virNetMessageFree(msg);
+    VIR_FORCE_CLOSE(fds[0]);
+    VIR_FORCE_CLOSE(fds[1]);
+    return ret;
+}
+
+
+enum {
+    TEST_STREAM_DATA_ZERO,
+    TEST_STREAM_DATA_TEXT,
+    TEST_STREAM_DATA_RANDOM,
+};
+
+struct testStreamDataInfo {
+    int encoding;
+    int fill;
+    size_t len;
+    int type; /* Expected type of the packet on the wire */
+};
+
+static int testMessageStreamData(const void *args)
+{
+    const struct testStreamDataInfo *info = args;
+    const char *text = "The quick brown fox jumps over the lazy dog";
+    size_t textlen = strlen(text);
+    unsigned int seed = 42;
+    virNetMessageStreamCodecPtr codec = NULL;
+    virNetMessagePtr msg = virNetMessageNew(true);
+    virNetMessagePtr rmsg = virNetMessageNew(true);
+    struct iovec iov[VIR_NET_MESSAGE_NIOV];
+    char *data = NULL;
+    size_t wirelen = 0;
+    size_t i;
+    int niov;
+    int ret = -1;
+
+    if (!msg || !rmsg)
+        goto cleanup;
+
+    if (VIR_ALLOC_N(data, info->len) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    for (i = 0 ; i < info->len ; i++) {
+        switch (info->fill) {
+        case TEST_STREAM_DATA_TEXT:
+            data[i] = text[i % textlen];
+            break;
+        case TEST_STREAM_DATA_RANDOM:
+            seed = seed * 1103515245 + 12345;
+            data[i] = seed >> 16;
+            break;
+        }
+    }
+
+    if (!(codec = virNetMessageStreamCodecNew(info->encoding, -1)))
+        goto cleanup;
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_CONTINUE;
+
+    if (virNetMessageEncodeStreamData(msg, codec, data, info->len) < 0)
+        goto cleanup;
+
+    if (msg->header.type != info->type) {
+        VIR_DEBUG("Expect type %d got %d", info->type, msg->header.type);
+        goto cleanup;
+    }
+
+    niov = virNetMessageGetIOV(msg, iov);
+    for (i = 0 ; i < niov ; i++)
+        wirelen += iov[i].iov_len;
+
+    if (info->type == VIR_NET_STREAM_ENCODED &&
+        wirelen >= info->len) {
+        VIR_DEBUG("Expect %zu bytes shrunk, got %zu", info->len, wirelen);
+        goto cleanup;
+    }
+
+    /* Read the packet back, as if it came off the wire */
+    rmsg->bufferLength = 4;
+    if (VIR_ALLOC_N(rmsg->buffer, rmsg->bufferLength) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+    memcpy(rmsg->buffer, iov[0].iov_base, rmsg->bufferLength);
+
+    if (virNetMessageDecodeLength(rmsg) < 0 ||
+        rmsg->bufferLength != wirelen) {
+        VIR_DEBUG("Failed to decode message length");
+        goto cleanup;
+    }
+
+    wirelen = 0;
+    for (i = 0 ; i < niov ; i++) {
+        memcpy(rmsg->buffer + wirelen, iov[i].iov_base, iov[i].iov_len);
+        wirelen += iov[i].iov_len;
+    }
+
+    if (virNetMessageDecodeHeader(rmsg) < 0) {
+        VIR_DEBUG("Failed to decode message header");
+        goto cleanup;
+    }
+
+    if (rmsg->header.type == VIR_NET_STREAM_ENCODED &&
+        virNetMessageDecodeStreamData(rmsg) < 0) {
+        VIR_DEBUG("Failed to decode stream data");
+        goto cleanup;
+    }
+
+    if (rmsg->header.type != VIR_NET_STREAM ||
+        rmsg->bufferLength - rmsg->bufferOffset != info->len ||
+        memcmp(rmsg->buffer + rmsg->bufferOffset, data, info->len) != 0) {
+        VIR_DEBUG("Stream data changed on the way");
+        goto cleanup;
+    }
+
+    ret = 0;
+cleanup:
+    VIR_FREE(data);
+    virNetMessageStreamCodecFree(codec);
+    virNetMessageFree(msg);
+    virNetMessageFree(rmsg);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -549,6 +828,50 @@ mymain(void)
     if (virtTestRun("Message Payload Stream Encode", 1, testMessagePayloadStreamEncode, NULL) < 0)
         ret = -1;
 
+    if (virtTestRun("Message Payload Stream Reserve", 1, testMessagePayloadStreamReserve, NULL) < 0)
+        ret = -1;
+
+    if (virtTestRun("Message Payload Stream Splice", 1, testMessagePayloadStreamSplice, NULL) < 0)
+        ret = -1;
+
+#define DO_TEST_STREAM_DATA(name, encoding, fill, len, type)            \
+    do {                                                                \
+        struct testStreamDataInfo info = { encoding, fill, len, type }; \
+        if (virtTestRun("Message Stream Data " name, 1,                \
+                        testMessageStreamData, &info) < 0)              \
+            ret = -1;                                                   \
+    } while (0)
+
+    DO_TEST_STREAM_DATA("Hole", VIR_NET_STREAM_ENCODING_HOLE,
+                        TEST_STREAM_DATA_ZERO, 1024 * 1024,
+                        VIR_NET_STREAM_ENCODED);
+    DO_TEST_STREAM_DATA("Hole Text", VIR_NET_STREAM_ENCODING_HOLE,
+                        TEST_STREAM_DATA_TEXT, 65536,
+                        VIR_NET_STREAM);
+    DO_TEST_STREAM_DATA("Hole Short Zero", VIR_NET_STREAM_ENCODING_HOLE,
+                        TEST_STREAM_DATA_ZERO, 1,
+                        VIR_NET_STREAM);
+    DO_TEST_STREAM_DATA("Hole Short Text", VIR_NET_STREAM_ENCODING_HOLE,
+                        TEST_STREAM_DATA_TEXT, 1,
+                        VIR_NET_STREAM);
+#if WITH_ZLIB
+    DO_TEST_STREAM_DATA("Zlib Zero", VIR_NET_STREAM_ENCODING_ZLIB,
+                        TEST_STREAM_DATA_ZERO, 1024 * 1024,
+                        VIR_NET_STREAM_ENCODED);
+    DO_TEST_STREAM_DATA("Zlib Text", VIR_NET_STREAM_ENCODING_ZLIB,
+                        TEST_STREAM_DATA_TEXT, 256 * 1024,
+                        VIR_NET_STREAM_ENCODED);
+    DO_TEST_STREAM_DATA("Zlib Random", VIR_NET_STREAM_ENCODING_ZLIB,
+                        TEST_STREAM_DATA_RANDOM, 65536,
+                        VIR_NET_STREAM);
+    DO_TEST_STREAM_DATA("Zlib Short Zero", VIR_NET_STREAM_ENCODING_ZLIB,
+                        TEST_STREAM_DATA_ZERO, 1,
+                        VIR_NET_STREAM);
+    DO_TEST_STREAM_DATA("Zlib Short Text", VIR_NET_STREAM_ENCODING_ZLIB,
+                        TEST_STREAM_DATA_TEXT, 1,
+                        VIR_NET_STREAM);
+#endif
+
     return ret==0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
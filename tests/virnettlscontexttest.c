@@ -34,6 +34,7 @@
 #include "virfile.h"
 #include "vircommand.h"
 #include "virsocketaddr.h"
+#include "virtime.h"
 #include "gnutls_1_0_compat.h"
 
 #if !defined WIN32 && HAVE_LIBTASN1_H && LIBGNUTLS_VERSION_NUMBER >= 0x020600
@@ -732,6 +733,297 @@ cleanup:
 }
 
 
+/*
+ * Connects a client to a server over a socketpair the way
+ * virNetClient and virNetServerClient do: handshake, check the
+ * certificates both ways, then the server confirms with a '\1'
+ * byte. With @cacheKey set, the client resumes the session it
+ * saved the previous time. Without contexts, only the confirmation
+ * byte goes through the plain socket.
+ */
+static int testTLSConnect(virNetTLSContextPtr serverCtxt,
+                          virNetTLSContextPtr clientCtxt,
+                          const char *hostname,
+                          const char *cacheKey,
+                          bool *resumed)
+{
+    virNetTLSSessionPtr clientSess = NULL;
+    virNetTLSSessionPtr serverSess = NULL;
+    bool clientShake = false;
+    bool serverShake = false;
+    int channel[2];
+    char buf = '\1';
+    int ret = -1;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) < 0)
+        abort();
+
+    if (!serverCtxt) {
+        if (safewrite(channel[0], &buf, 1) != 1 ||
+            saferead(channel[1], &buf, 1) != 1)
+            goto cleanup;
+        ret = 0;
+        goto cleanup;
+    }
+
+    ignore_value(virSetNonBlock(channel[0]));
+    ignore_value(virSetNonBlock(channel[1]));
+
+    if (!(serverSess = virNetTLSSessionNew(serverCtxt, NULL)) ||
+        !(clientSess = virNetTLSSessionNew(clientCtxt, hostname)))
+        goto cleanup;
+
+    if (cacheKey &&
+        virNetTLSSessionResume(clientSess, cacheKey) < 0)
+        goto cleanup;
+
+    virNetTLSSessionSetIOCallbacks(serverSess, testWrite, testRead, &channel[0]);
+    virNetTLSSessionSetIOCallbacks(clientSess, testWrite, testRead, &channel[1]);
+
+    do {
+        int rv;
+        if (!serverShake) {
+            rv = virNetTLSSessionHandshake(serverSess);
+            if (rv < 0)
+                goto cleanup;
+            if (rv == VIR_NET_TLS_HANDSHAKE_COMPLETE)
+                serverShake = true;
+        }
+        if (!clientShake) {
+            rv = virNetTLSSessionHandshake(clientSess);
+            if (rv < 0)
+                goto cleanup;
+            if (rv == VIR_NET_TLS_HANDSHAKE_COMPLETE)
+                clientShake = true;
+        }
+    } while (!clientShake || !serverShake);
+
+    if (virNetTLSContextCheckCertificate(serverCtxt, serverSess) < 0 ||
+        virNetTLSContextCheckCertificate(clientCtxt, clientSess) < 0)
+        goto cleanup;
+
+    if (virNetTLSSessionWrite(serverSess, &buf, 1) != 1)
+        goto cleanup;
+    buf = '\0';
+    while (virNetTLSSessionRead(clientSess, &buf, 1) != 1) {
+        if (errno != EAGAIN)
+            goto cleanup;
+    }
+    if (buf != '\1')
+        goto cleanup;
+
+    if (cacheKey)
+        virNetTLSSessionSave(clientSess);
+
+    if (resumed)
+        *resumed = virNetTLSSessionIsResumed(clientSess) &&
+            virNetTLSSessionIsResumed(serverSess);
+
+    ret = 0;
+
+cleanup:
+    virObjectUnref(serverSess);
+    virObjectUnref(clientSess);
+    VIR_FORCE_CLOSE(channel[0]);
+    VIR_FORCE_CLOSE(channel[1]);
+    return ret;
+}
+
+
+static int testTLSSessionContextsNew(struct testTLSSessionData *data,
+                                     virNetTLSContextPtr *serverCtxt,
+                                     virNetTLSContextPtr *clientCtxt)
+{
+    testTLSGenerateCert(&data->careq);
+    data->serverreq.cacrt = data->careq.crt;
+    testTLSGenerateCert(&data->serverreq);
+    data->clientreq.cacrt = data->careq.crt;
+    testTLSGenerateCert(&data->clientreq);
+
+    if (!(*serverCtxt = virNetTLSContextNewServer(data->careq.filename,
+                                                  NULL,
+                                                  data->serverreq.filename,
+                                                  keyfile,
+                                                  data->wildcards,
+                                                  true,
+                                                  true)) ||
+        !(*clientCtxt = virNetTLSContextNewClient(data->careq.filename,
+                                                  NULL,
+                                                  data->clientreq.filename,
+                                                  keyfile,
+                                                  true,
+                                                  true))) {
+        VIR_WARN("Unexpected failure loading %s against %s",
+                 data->careq.filename, data->serverreq.filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void testTLSSessionContextsFree(struct testTLSSessionData *data,
+                                       virNetTLSContextPtr serverCtxt,
+                                       virNetTLSContextPtr clientCtxt)
+{
+    virObjectUnref(serverCtxt);
+    virObjectUnref(clientCtxt);
+    gnutls_x509_crt_deinit(data->careq.crt);
+    gnutls_x509_crt_deinit(data->clientreq.crt);
+    gnutls_x509_crt_deinit(data->serverreq.crt);
+    data->careq.crt = data->clientreq.crt = data->serverreq.crt = NULL;
+
+    if (getenv("VIRT_TEST_DEBUG_CERTS") == NULL) {
+        unlink(data->careq.filename);
+        unlink(data->clientreq.filename);
+        unlink(data->serverreq.filename);
+    }
+}
+
+
+/*
+ * A client connecting again to the same server must resume its
+ * previous session, even with a context created afresh as each
+ * connection of the remote driver does, but not a client loaded
+ * from other credentials
+ */
+static int testTLSSessionResume(const void *opaque)
+{
+    struct testTLSSessionData *data = (struct testTLSSessionData *)opaque;
+    struct testTLSCertReq otherreq = data->clientreq;
+    virNetTLSContextPtr clientCtxt = NULL;
+    virNetTLSContextPtr serverCtxt = NULL;
+    virNetTLSContextPtr sameCtxt = NULL;
+    virNetTLSContextPtr otherCtxt = NULL;
+    bool resumed = true;
+    int ret = -1;
+
+    if (testTLSSessionContextsNew(data, &serverCtxt, &clientCtxt) < 0)
+        goto cleanup;
+
+    if (testTLSConnect(serverCtxt, clientCtxt, data->hostname,
+                       "resume", &resumed) < 0)
+        goto cleanup;
+    if (resumed) {
+        VIR_WARN("Unexpected resumed session on first connection");
+        goto cleanup;
+    }
+
+    if (testTLSConnect(serverCtxt, clientCtxt, data->hostname,
+                       "resume", &resumed) < 0)
+        goto cleanup;
+    if (!resumed) {
+        VIR_WARN("Expected resumed session on second connection");
+        goto cleanup;
+    }
+
+    if (!(sameCtxt = virNetTLSContextNewClient(data->careq.filename,
+                                               NULL,
+                                               data->clientreq.filename,
+                                               keyfile,
+                                               true,
+                                               true)))
+        goto cleanup;
+
+    if (testTLSConnect(serverCtxt, sameCtxt, data->hostname,
+                       "resume", &resumed) < 0)
+        goto cleanup;
+    if (!resumed) {
+        VIR_WARN("Expected resumed session from a new context");
+        goto cleanup;
+    }
+
+    otherreq.filename = "otherclientcert.pem";
+    otherreq.crt = NULL;
+    otherreq.cacrt = data->careq.crt;
+    testTLSGenerateCert(&otherreq);
+
+    if (!(otherCtxt = virNetTLSContextNewClient(data->careq.filename,
+                                                NULL,
+                                                otherreq.filename,
+                                                keyfile,
+                                                true,
+                                                true)))
+        goto cleanup;
+
+    if (testTLSConnect(serverCtxt, otherCtxt, data->hostname,
+                       "resume", &resumed) < 0)
+        goto cleanup;
+    if (resumed) {
+        VIR_WARN("Unexpected resumed session from other credentials");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    virObjectUnref(sameCtxt);
+    virObjectUnref(otherCtxt);
+    if (otherreq.crt) {
+        gnutls_x509_crt_deinit(otherreq.crt);
+        if (getenv("VIRT_TEST_DEBUG_CERTS") == NULL)
+            unlink(otherreq.filename);
+    }
+    testTLSSessionContextsFree(data, serverCtxt, clientCtxt);
+    return ret;
+}
+
+
+/*
+ * Only run in verbose mode: how many connections
+ * per second a client makes over a plain UNIX socket, with a full
+ * TLS handshake and with a resumed TLS session
+ */
+static int testTLSConnectBenchmark(const void *opaque)
+{
+    struct testTLSSessionData *data = (struct testTLSSessionData *)opaque;
+    virNetTLSContextPtr clientCtxt = NULL;
+    virNetTLSContextPtr serverCtxt = NULL;
+    const size_t nconns = 200;
+    size_t i, j;
+    int ret = -1;
+    struct {
+        const char *name;
+        bool tls;
+        const char *cacheKey;
+    } modes[] = {
+        { "unix", false, NULL },
+        { "tls", true, NULL },
+        { "tls resumed", true, "benchmark" },
+    };
+
+    if (testTLSSessionContextsNew(data, &serverCtxt, &clientCtxt) < 0)
+        goto cleanup;
+
+    for (i = 0 ; i < ARRAY_CARDINALITY(modes) ; i++) {
+        unsigned long long start, end;
+
+        if (virTimeMillisNow(&start) < 0)
+            goto cleanup;
+
+        for (j = 0 ; j < nconns ; j++) {
+            if (testTLSConnect(modes[i].tls ? serverCtxt : NULL,
+                               modes[i].tls ? clientCtxt : NULL,
+                               data->hostname, modes[i].cacheKey,
+                               NULL) < 0)
+                goto cleanup;
+        }
+
+        if (virTimeMillisNow(&end) < 0)
+            goto cleanup;
+
+        fprintf(stderr, "%-12s %10.1f connections/s\n", modes[i].name,
+                nconns * 1000.0 / (end > start ? end - start : 1));
+    }
+
+    ret = 0;
+
+cleanup:
+    testTLSSessionContextsFree(data, serverCtxt, clientCtxt);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -1254,6 +1546,20 @@ mymain(void)
     DO_SESS_TEST(cacertreq, servercertreq, clientcertreq, false, false, "libvirt.org", wildcards5);
     DO_SESS_TEST(cacertreq, servercertreq, clientcertreq, false, false, "libvirt.org", wildcards6);
 
+    do {
+        static struct testTLSSessionData data;
+        data.careq = cacertreq;
+        data.serverreq = servercertreq;
+        data.clientreq = clientcertreq;
+        data.hostname = "libvirt.org";
+        if (virtTestRun("TLS Session Resume", 1, testTLSSessionResume, &data) < 0)
+            ret = -1;
+        if (virTestGetVerbose() &&
+            virtTestRun("TLS Connect Benchmark", 1,
+                        testTLSConnectBenchmark, &data) < 0)
+            ret = -1;
+    } while (0);
+
     unlink(keyfile);
 
     asn1_delete_structure(&pkix_asn1);
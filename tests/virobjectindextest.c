@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "testutils.h"
+#include "viruuid.h"
+#include "virthread.h"
+
+#include "virobjectindex.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+static const unsigned char uuid1[VIR_UUID_BUFLEN] = { 1, 2, 3, 4 };
+static const unsigned char uuid2[VIR_UUID_BUFLEN] = { 5, 6, 7, 8 };
+
+typedef struct _testObj testObj;
+typedef testObj *testObjPtr;
+struct _testObj {
+    virMutex lock;
+    bool locked;
+};
+
+static testObj obj1;
+static testObj obj2;
+/* Returned by the lookup helpers for an object found unlocked */
+static testObj unlocked;
+
+
+static void
+testObjLock(void *opaque)
+{
+    testObjPtr obj = opaque;
+
+    virMutexLock(&obj->lock);
+    obj->locked = true;
+}
+
+static void
+testObjUnlock(testObjPtr obj)
+{
+    obj->locked = false;
+    virMutexUnlock(&obj->lock);
+}
+
+static testObjPtr
+testLookupDone(testObjPtr obj)
+{
+    if (!obj)
+        return NULL;
+    if (!obj->locked)
+        return &unlocked;
+    testObjUnlock(obj);
+    return obj;
+}
+
+/* Look up an object and release it, which the index must have
+ * locked */
+static testObjPtr
+testLookupUUID(virObjectIndexPtr idx,
+               const unsigned char *uuid)
+{
+    return testLookupDone(virObjectIndexLookupUUID(idx, uuid));
+}
+
+static testObjPtr
+testLookupName(virObjectIndexPtr idx,
+               const char *name)
+{
+    return testLookupDone(virObjectIndexLookupName(idx, name));
+}
+
+
+static int
+testEmpty(const void *data ATTRIBUTE_UNUSED)
+{
+    virObjectIndexPtr idx;
+    int ret = -1;
+
+    /* A missing index behaves as an empty one */
+    if (virObjectIndexLookupUUID(NULL, uuid1) ||
+        virObjectIndexLookupName(NULL, "one"))
+        return -1;
+    virObjectIndexRemove(NULL, uuid1, "one", &obj1);
+
+    if (!(idx = virObjectIndexNew(testObjLock)))
+        return -1;
+
+    if (testLookupUUID(idx, uuid1) ||
+        testLookupName(idx, "one"))
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virObjectIndexFree(idx);
+    return ret;
+}
+
+
+static int
+testAddRemove(const void *data ATTRIBUTE_UNUSED)
+{
+    virObjectIndexPtr idx;
+    int ret = -1;
+
+    if (!(idx = virObjectIndexNew(testObjLock)))
+        return -1;
+
+    if (virObjectIndexAdd(idx, uuid1, "one", &obj1) < 0 ||
+        virObjectIndexAdd(idx, uuid2, "two", &obj2) < 0)
+        goto cleanup;
+
+    if (testLookupUUID(idx, uuid1) != &obj1 ||
+        testLookupName(idx, "one") != &obj1 ||
+        testLookupUUID(idx, uuid2) != &obj2 ||
+        testLookupName(idx, "two") != &obj2 ||
+        testLookupName(idx, "three"))
+        goto cleanup;
+
+    virObjectIndexRemove(idx, uuid1, "one", &obj1);
+    if (testLookupUUID(idx, uuid1) ||
+        testLookupName(idx, "one") ||
+        testLookupName(idx, "two") != &obj2)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virObjectIndexFree(idx);
+    return ret;
+}
+
+
+static int
+testNameOnly(const void *data ATTRIBUTE_UNUSED)
+{
+    virObjectIndexPtr idx;
+    int ret = -1;
+
+    if (!(idx = virObjectIndexNew(testObjLock)))
+        return -1;
+
+    if (virObjectIndexAdd(idx, NULL, "eth0", &obj1) < 0)
+        goto cleanup;
+
+    if (testLookupName(idx, "eth0") != &obj1)
+        goto cleanup;
+
+    virObjectIndexRemove(idx, NULL, "eth0", &obj1);
+    if (testLookupName(idx, "eth0"))
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virObjectIndexFree(idx);
+    return ret;
+}
+
+
+static int
+testTakeOver(const void *data ATTRIBUTE_UNUSED)
+{
+    virObjectIndexPtr idx;
+    int ret = -1;
+
+    if (!(idx = virObjectIndexNew(testObjLock)))
+        return -1;
+
+    /* A second object added under the same name replaces the
+     * first, and removing the first must not drop it */
+    if (virObjectIndexAdd(idx, uuid1, "one", &obj1) < 0 ||
+        virObjectIndexAdd(idx, uuid2, "one", &obj2) < 0)
+        goto cleanup;
+
+    virObjectIndexRemove(idx, uuid1, "one", &obj1);
+    if (testLookupName(idx, "one") != &obj2 ||
+        testLookupUUID(idx, uuid2) != &obj2 ||
+        testLookupUUID(idx, uuid1))
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virObjectIndexFree(idx);
+    return ret;
+}
+
+
+struct testRace {
+    virObjectIndexPtr idx;
+    virMutex lock;
+    testObjPtr found;
+    bool removed;
+};
+
+static void
+testRaceLookup(void *opaque)
+{
+    struct testRace *race = opaque;
+    testObjPtr obj = testLookupName(race->idx, "one");
+
+    virMutexLock(&race->lock);
+    race->found = obj;
+    virMutexUnlock(&race->lock);
+}
+
+static void
+testRaceRemove(void *opaque)
+{
+    struct testRace *race = opaque;
+
+    virObjectIndexRemove(race->idx, uuid1, "one", &obj1);
+
+    virMutexLock(&race->lock);
+    race->removed = true;
+    virMutexUnlock(&race->lock);
+}
+
+/* A lookup locks the object it found before letting go of the
+ * index, so removing the object waits for that lookup */
+static int
+testLookupHolds(const void *data ATTRIBUTE_UNUSED)
+{
+    struct testRace race;
+    virThread lookup;
+    virThread remove;
+    bool removed;
+    int ret = -1;
+
+    memset(&race, 0, sizeof(race));
+    if (virMutexInit(&race.lock) < 0)
+        return -1;
+
+    if (!(race.idx = virObjectIndexNew(testObjLock)))
+        goto cleanup;
+    if (virObjectIndexAdd(race.idx, uuid1, "one", &obj1) < 0)
+        goto cleanup;
+
+    testObjLock(&obj1);
+    if (virThreadCreate(&lookup, true, testRaceLookup, &race) < 0) {
+        testObjUnlock(&obj1);
+        goto cleanup;
+    }
+    usleep(100 * 1000);
+    if (virThreadCreate(&remove, true, testRaceRemove, &race) < 0) {
+        testObjUnlock(&obj1);
+        virThreadJoin(&lookup);
+        goto cleanup;
+    }
+    usleep(100 * 1000);
+
+    virMutexLock(&race.lock);
+    removed = race.removed;
+    virMutexUnlock(&race.lock);
+
+    testObjUnlock(&obj1);
+    virThreadJoin(&lookup);
+    virThreadJoin(&remove);
+
+    if (removed) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "object removed while a lookup waited for it\n");
+        goto cleanup;
+    }
+
+    if (race.found != &obj1 ||
+        testLookupName(race.idx, "one"))
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virObjectIndexFree(race.idx);
+    virMutexDestroy(&race.lock);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virThreadInitialize() < 0 ||
+        virMutexInit(&obj1.lock) < 0 ||
+        virMutexInit(&obj2.lock) < 0)
+        return EXIT_FAILURE;
+
+    if (virtTestRun("empty", 1, testEmpty, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("add/remove", 1, testAddRemove, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("name only", 1, testNameOnly, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("take over", 1, testTakeOver, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("lookup holds", 1, testLookupHolds, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
@@ -0,0 +1,497 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <unistd.h>
+
+#include "testutils.h"
+
+#include "virthreadpool.h"
+#include "virthread.h"
+#include "virtime.h"
+
+/* How long to wait for the pool before declaring it stuck, in ms */
+#define TEST_TIMEOUT (5 * 1000)
+
+#define NJOBS 10
+
+typedef struct _testJob testJob;
+typedef testJob *testJobPtr;
+struct _testJob {
+    size_t id;
+    bool wait;              /* Block until the gate is opened */
+};
+
+/* Shared by the jobs of one test */
+typedef struct _testState testState;
+typedef testState *testStatePtr;
+struct _testState {
+    virMutex lock;
+    virCond cond;
+    bool gateOpen;
+    size_t started;
+    size_t finished;
+    size_t order[NJOBS];    /* Ids of the jobs in the order they ran */
+};
+
+static testState state;
+static testJob jobs[NJOBS];
+
+
+static void
+testJobFunc(void *jobdata, void *opaque)
+{
+    testJobPtr job = jobdata;
+    testStatePtr st = opaque;
+
+    virMutexLock(&st->lock);
+    st->order[st->started++] = job->id;
+    virCondBroadcast(&st->cond);
+    while (job->wait && !st->gateOpen)
+        ignore_value(virCondWait(&st->cond, &st->lock));
+    st->finished++;
+    virCondBroadcast(&st->cond);
+    virMutexUnlock(&st->lock);
+}
+
+
+static int
+testStateInit(void)
+{
+    size_t i;
+
+    memset(&state, 0, sizeof(state));
+    if (virMutexInit(&state.lock) < 0 ||
+        virCondInit(&state.cond) < 0)
+        return -1;
+
+    for (i = 0; i < NJOBS; i++) {
+        jobs[i].id = i;
+        jobs[i].wait = false;
+    }
+    return 0;
+}
+
+
+static void
+testStateFree(void)
+{
+    virMutexDestroy(&state.lock);
+    ignore_value(virCondDestroy(&state.cond));
+}
+
+
+static void
+testOpenGate(void)
+{
+    virMutexLock(&state.lock);
+    state.gateOpen = true;
+    virCondBroadcast(&state.cond);
+    virMutexUnlock(&state.lock);
+}
+
+
+/* Wait until *@counter reaches @want, which must be read under
+ * state.lock */
+static int
+testWaitFor(size_t *counter, size_t want)
+{
+    unsigned long long deadline;
+    int ret = 0;
+
+    if (virTimeMillisNow(&deadline) < 0)
+        return -1;
+    deadline += TEST_TIMEOUT;
+
+    virMutexLock(&state.lock);
+    while (*counter < want) {
+        if (virCondWaitUntil(&state.cond, &state.lock, deadline) < 0) {
+            ret = -1;
+            break;
+        }
+    }
+    virMutexUnlock(&state.lock);
+
+    return ret;
+}
+
+
+/* Wait until the pool is down to @workers workers and has accounted
+ * for @jobsDone jobs, which only happens after the job function has
+ * returned */
+static int
+testWaitForPool(virThreadPoolPtr pool,
+                size_t workers,
+                unsigned long long jobsDone)
+{
+    virThreadPoolStats stats;
+    int waited;
+
+    for (waited = 0; waited < TEST_TIMEOUT; waited += 10) {
+        virThreadPoolGetStats(pool, &stats);
+        if (stats.workers == workers && stats.jobsDone == jobsDone)
+            return 0;
+        usleep(10 * 1000);
+    }
+
+    return -1;
+}
+
+
+/* A priority job must run even while every ordinary worker is busy */
+static int
+testPriority(const void *data ATTRIBUTE_UNUSED)
+{
+    virThreadPoolPtr pool = NULL;
+    int ret = -1;
+
+    if (testStateInit() < 0)
+        return -1;
+
+    if (!(pool = virThreadPoolNew(1, 1, 1, testJobFunc, &state)))
+        goto cleanup;
+
+    jobs[0].wait = true;
+    if (virThreadPoolSendJob(pool, 0, &jobs[0]) < 0 ||
+        testWaitFor(&state.started, 1) < 0)
+        goto cleanup;
+
+    if (virThreadPoolSendJob(pool, 1, &jobs[1]) < 0 ||
+        testWaitFor(&state.finished, 1) < 0)
+        goto cleanup;
+
+    if (state.order[1] != 1)
+        goto cleanup;
+
+    testOpenGate();
+    if (testWaitFor(&state.finished, 2) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    testOpenGate();
+    virThreadPoolFree(pool);
+    testStateFree();
+    return ret;
+}
+
+
+/* The pool grows up to maxWorkers when jobs block, and shrinks
+ * back to minWorkers once they have been idle long enough */
+static int
+testGrowShrink(const void *data ATTRIBUTE_UNUSED)
+{
+    virThreadPoolPtr pool = NULL;
+    virThreadPoolStats stats;
+    size_t i;
+    int ret = -1;
+
+    if (testStateInit() < 0)
+        return -1;
+
+    if (!(pool = virThreadPoolNew(1, 4, 0, testJobFunc, &state)))
+        goto cleanup;
+    virThreadPoolSetIdleTimeout(pool, 50);
+
+    for (i = 0; i < 4; i++) {
+        jobs[i].wait = true;
+        if (virThreadPoolSendJob(pool, 0, &jobs[i]) < 0)
+            goto cleanup;
+    }
+
+    /* All four can only have started on four different workers */
+    if (testWaitFor(&state.started, 4) < 0)
+        goto cleanup;
+
+    virThreadPoolGetStats(pool, &stats);
+    if (stats.workers != 4)
+        goto cleanup;
+
+    /* One more job than there are workers has to wait */
+    if (virThreadPoolSendJob(pool, 0, &jobs[4]) < 0)
+        goto cleanup;
+    virThreadPoolGetStats(pool, &stats);
+    if (stats.workers != 4 || stats.jobQueueDepth != 1)
+        goto cleanup;
+
+    testOpenGate();
+    if (testWaitFor(&state.finished, 5) < 0)
+        goto cleanup;
+
+    if (testWaitForPool(pool, 1, 5) < 0)
+        goto cleanup;
+
+    virThreadPoolGetStats(pool, &stats);
+    if (stats.jobQueueDepth != 0 || stats.jobQueueDepthMax < 1)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    testOpenGate();
+    virThreadPoolFree(pool);
+    testStateFree();
+    return ret;
+}
+
+
+/* A single worker runs jobs in the order they were submitted */
+static int
+testFifo(const void *data ATTRIBUTE_UNUSED)
+{
+    virThreadPoolPtr pool = NULL;
+    size_t i;
+    int ret = -1;
+
+    if (testStateInit() < 0)
+        return -1;
+
+    if (!(pool = virThreadPoolNew(1, 1, 0, testJobFunc, &state)))
+        goto cleanup;
+
+    jobs[0].wait = true;
+    if (virThreadPoolSendJob(pool, 0, &jobs[0]) < 0 ||
+        testWaitFor(&state.started, 1) < 0)
+        goto cleanup;
+
+    for (i = 1; i < NJOBS; i++) {
+        if (virThreadPoolSendJob(pool, 0, &jobs[i]) < 0)
+            goto cleanup;
+    }
+
+    testOpenGate();
+    if (testWaitFor(&state.finished, NJOBS) < 0)
+        goto cleanup;
+
+    for (i = 0; i < NJOBS; i++) {
+        if (state.order[i] != i)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    testOpenGate();
+    virThreadPoolFree(pool);
+    testStateFree();
+    return ret;
+}
+
+
+/* Without priority workers, jobs sent with a priority go through the
+ * shared lane in the order they were sent, so a busy worker doesn't
+ * hold back the ones which would otherwise have been queued on it */
+static int
+testPriorityLane(const void *data ATTRIBUTE_UNUSED)
+{
+    virThreadPoolPtr pool = NULL;
+    size_t i;
+    int ret = -1;
+
+    if (testStateInit() < 0)
+        return -1;
+
+    if (!(pool = virThreadPoolNew(2, 2, 0, testJobFunc, &state)))
+        goto cleanup;
+
+    jobs[0].wait = true;
+    if (virThreadPoolSendJob(pool, 1, &jobs[0]) < 0 ||
+        testWaitFor(&state.started, 1) < 0)
+        goto cleanup;
+
+    for (i = 1; i < NJOBS; i++) {
+        if (virThreadPoolSendJob(pool, 1, &jobs[i]) < 0)
+            goto cleanup;
+    }
+
+    /* All of them run on the other worker while the first blocks */
+    if (testWaitFor(&state.finished, NJOBS - 1) < 0)
+        goto cleanup;
+
+    for (i = 0; i < NJOBS; i++) {
+        if (state.order[i] != i)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    testOpenGate();
+    virThreadPoolFree(pool);
+    testStateFree();
+    return ret;
+}
+
+
+struct testDrainData {
+    virThreadPoolPtr pool;
+    bool done;
+};
+
+static void
+testDrainThread(void *opaque)
+{
+    struct testDrainData *data = opaque;
+
+    virThreadPoolDrain(data->pool);
+    virMutexLock(&state.lock);
+    data->done = true;
+    virMutexUnlock(&state.lock);
+}
+
+/* Draining waits for the queued jobs as well as the running one */
+static int
+testDrain(const void *data ATTRIBUTE_UNUSED)
+{
+    struct testDrainData drain = { NULL, false };
+    virThreadPoolPtr pool = NULL;
+    virThread thread;
+    bool done;
+    size_t i;
+    int ret = -1;
+
+    if (testStateInit() < 0)
+        return -1;
+
+    if (!(pool = virThreadPoolNew(1, 1, 0, testJobFunc, &state)))
+        goto cleanup;
+
+    /* Nothing to wait for */
+    virThreadPoolDrain(pool);
+
+    jobs[0].wait = true;
+    for (i = 0; i < NJOBS; i++) {
+        if (virThreadPoolSendJob(pool, i % 2, &jobs[i]) < 0)
+            goto cleanup;
+    }
+    if (testWaitFor(&state.started, 1) < 0)
+        goto cleanup;
+
+    drain.pool = pool;
+    if (virThreadCreate(&thread, true, testDrainThread, &drain) < 0)
+        goto cleanup;
+
+    usleep(100 * 1000);
+    virMutexLock(&state.lock);
+    done = drain.done;
+    virMutexUnlock(&state.lock);
+
+    testOpenGate();
+    virThreadJoin(&thread);
+
+    if (done || state.finished != NJOBS)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    testOpenGate();
+    virThreadPoolFree(pool);
+    testStateFree();
+    return ret;
+}
+
+
+static void
+testFreeThread(void *opaque)
+{
+    virThreadPoolFree(opaque);
+}
+
+/* Freeing the pool waits for running jobs, but drops queued ones */
+static int
+testFreeQueued(const void *data ATTRIBUTE_UNUSED)
+{
+    virThreadPoolPtr pool = NULL;
+    virThread thread;
+    size_t i;
+    int ret = -1;
+
+    if (testStateInit() < 0)
+        return -1;
+
+    if (!(pool = virThreadPoolNew(1, 1, 0, testJobFunc, &state)))
+        goto cleanup;
+
+    jobs[0].wait = true;
+    if (virThreadPoolSendJob(pool, 0, &jobs[0]) < 0 ||
+        testWaitFor(&state.started, 1) < 0)
+        goto cleanup;
+
+    for (i = 1; i < NJOBS; i++) {
+        if (virThreadPoolSendJob(pool, 0, &jobs[i]) < 0)
+            goto cleanup;
+    }
+
+    if (virThreadCreate(&thread, true, testFreeThread, pool) < 0)
+        goto cleanup;
+    pool = NULL;
+
+    /* Give the pool time to notice it is being freed while its
+     * worker is still busy */
+    usleep(100 * 1000);
+    testOpenGate();
+    virThreadJoin(&thread);
+
+    /* Whatever was started, finished, and nothing ran out of order */
+    virMutexLock(&state.lock);
+    if (state.started == state.finished && state.order[0] == 0) {
+        ret = 0;
+        for (i = 0; i < state.started; i++) {
+            if (state.order[i] != i)
+                ret = -1;
+        }
+    }
+    virMutexUnlock(&state.lock);
+
+cleanup:
+    testOpenGate();
+    virThreadPoolFree(pool);
+    testStateFree();
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virThreadInitialize() < 0)
+        return EXIT_FAILURE;
+
+    if (virtTestRun("Priority", 1, testPriority, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Grow and shrink", 1, testGrowShrink, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("FIFO", 1, testFifo, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Priority lane order", 1, testPriorityLane, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Drain", 1, testDrain, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Free with queued jobs", 1, testFreeQueued, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
@@ -62,56 +62,61 @@
 #endif
 
 virDomainPtr
-vshCommandOptDomainBy(vshControl *ctl, const vshCmd *cmd,
-                      const char **name, unsigned int flags)
+vshLookupDomainBy(vshControl *ctl,
+                  const char *name,
+                  unsigned int flags)
 {
     virDomainPtr dom = NULL;
-    const char *n = NULL;
     int id;
-    const char *optname = "domain";
     virCheckFlags(VSH_BYID | VSH_BYUUID | VSH_BYNAME, NULL);
 
-    if (!vshCmdHasOption(ctl, cmd, optname))
-        return NULL;
-
-    if (vshCommandOptString(cmd, optname, &n) <= 0)
-        return NULL;
-
-    vshDebug(ctl, VSH_ERR_INFO, "%s: found option <%s>: %s\n",
-             cmd->def->name, optname, n);
-
-    if (name)
-        *name = n;
-
     /* try it by ID */
     if (flags & VSH_BYID) {
-        if (virStrToLong_i(n, NULL, 10, &id) == 0 && id >= 0) {
-            vshDebug(ctl, VSH_ERR_DEBUG,
-                     "%s: <%s> seems like domain ID\n",
-                     cmd->def->name, optname);
+        if (virStrToLong_i(name, NULL, 10, &id) == 0 && id >= 0) {
+            vshDebug(ctl, VSH_ERR_DEBUG, "<domain> looks like ID\n");
             dom = virDomainLookupByID(ctl->conn, id);
         }
     }
     /* try it by UUID */
     if (!dom && (flags & VSH_BYUUID) &&
-        strlen(n) == VIR_UUID_STRING_BUFLEN-1) {
-        vshDebug(ctl, VSH_ERR_DEBUG, "%s: <%s> trying as domain UUID\n",
-                 cmd->def->name, optname);
-        dom = virDomainLookupByUUIDString(ctl->conn, n);
+        strlen(name) == VIR_UUID_STRING_BUFLEN-1) {
+        vshDebug(ctl, VSH_ERR_DEBUG, "<domain> trying as domain UUID\n");
+        dom = virDomainLookupByUUIDString(ctl->conn, name);
     }
     /* try it by NAME */
     if (!dom && (flags & VSH_BYNAME)) {
-        vshDebug(ctl, VSH_ERR_DEBUG, "%s: <%s> trying as domain NAME\n",
-                 cmd->def->name, optname);
-        dom = virDomainLookupByName(ctl->conn, n);
+        vshDebug(ctl, VSH_ERR_DEBUG, "<domain> trying as domain NAME\n");
+        dom = virDomainLookupByName(ctl->conn, name);
     }
 
     if (!dom)
-        vshError(ctl, _("failed to get domain '%s'"), n);
+        vshError(ctl, _("failed to get domain '%s'"), name);
 
     return dom;
 }
 
+virDomainPtr
+vshCommandOptDomainBy(vshControl *ctl, const vshCmd *cmd,
+                      const char **name, unsigned int flags)
+{
+    const char *n = NULL;
+    const char *optname = "domain";
+
+    if (!vshCmdHasOption(ctl, cmd, optname))
+        return NULL;
+
+    if (vshCommandOptString(cmd, optname, &n) <= 0)
+        return NULL;
+
+    vshDebug(ctl, VSH_ERR_INFO, "%s: found option <%s>: %s\n",
+             cmd->def->name, optname, n);
+
+    if (name)
+        *name = n;
+
+    return vshLookupDomainBy(ctl, n, flags);
+}
+
 static const char *
 vshDomainVcpuStateToString(int state)
 {
@@ -4810,6 +4815,10 @@ static const vshCmdOptDef opts_domjobinfo[] = {
      .flags = VSH_OFLAG_REQ,
      .help = N_("domain name, id or uuid")
     },
+    {.name = "completed",
+     .type = VSH_OT_BOOL,
+     .help = N_("return statistics of a recently completed job")
+    },
     {.name = NULL}
 };
 
@@ -4818,62 +4827,194 @@ cmdDomjobinfo(vshControl *ctl, const vshCmd *cmd)
 {
     virDomainJobInfo info;
     virDomainPtr dom;
-    bool ret = true;
+    bool ret = false;
+    const char *unit;
+    double val;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    unsigned long long value;
+    unsigned int flags = 0;
+    int rc;
 
     if (!(dom = vshCommandOptDomain(ctl, cmd, NULL)))
         return false;
 
-    if (virDomainGetJobInfo(dom, &info) == 0) {
-        const char *unit;
-        double val;
+    if (vshCommandOptBool(cmd, "completed"))
+        flags |= VIR_DOMAIN_JOB_STATS_COMPLETED;
 
-        vshPrint(ctl, "%-17s ", _("Job type:"));
-        switch (info.type) {
-        case VIR_DOMAIN_JOB_BOUNDED:
-            vshPrint(ctl, "%-12s\n", _("Bounded"));
-            break;
-
-        case VIR_DOMAIN_JOB_UNBOUNDED:
-            vshPrint(ctl, "%-12s\n", _("Unbounded"));
-            break;
+    memset(&info, 0, sizeof(info));
 
-        case VIR_DOMAIN_JOB_NONE:
-        default:
-            vshPrint(ctl, "%-12s\n", _("None"));
+    rc = virDomainGetJobStats(dom, &info.type, &params, &nparams, flags);
+    if (rc == 0) {
+        if (virTypedParamsGetULLong(params, nparams,
+                                    VIR_DOMAIN_JOB_TIME_ELAPSED,
+                                    &info.timeElapsed) < 0 ||
+            virTypedParamsGetULLong(params, nparams,
+                                    VIR_DOMAIN_JOB_TIME_REMAINING,
+                                    &info.timeRemaining) < 0 ||
+            virTypedParamsGetULLong(params, nparams,
+                                    VIR_DOMAIN_JOB_DATA_TOTAL,
+                                    &info.dataTotal) < 0 ||
+            virTypedParamsGetULLong(params, nparams,
+                                    VIR_DOMAIN_JOB_DATA_PROCESSED,
+                                    &info.dataProcessed) < 0 ||
+            virTypedParamsGetULLong(params, nparams,
+                                    VIR_DOMAIN_JOB_DATA_REMAINING,
+                                    &info.dataRemaining) < 0 ||
+            virTypedParamsGetULLong(params, nparams,
+                                    VIR_DOMAIN_JOB_MEMORY_TOTAL,
+                                    &info.memTotal) < 0 ||
+            virTypedParamsGetULLong(params, nparams,
+                                    VIR_DOMAIN_JOB_MEMORY_PROCESSED,
+                                    &info.memProcessed) < 0 ||
+            virTypedParamsGetULLong(params, nparams,
+                                    VIR_DOMAIN_JOB_MEMORY_REMAINING,
+                                    &info.memRemaining) < 0 ||
+            virTypedParamsGetULLong(params, nparams,
+                                    VIR_DOMAIN_JOB_DISK_TOTAL,
+                                    &info.fileTotal) < 0 ||
+            virTypedParamsGetULLong(params, nparams,
+                                    VIR_DOMAIN_JOB_DISK_PROCESSED,
+                                    &info.fileProcessed) < 0 ||
+            virTypedParamsGetULLong(params, nparams,
+                                    VIR_DOMAIN_JOB_DISK_REMAINING,
+                                    &info.fileRemaining) < 0)
             goto cleanup;
-        }
+    } else if (last_error && last_error->code == VIR_ERR_NO_SUPPORT &&
+               !flags) {
+        /* older server, fall back to the coarse job info */
+        vshResetLibvirtError();
+        rc = virDomainGetJobInfo(dom, &info);
+    }
+    if (rc < 0)
+        goto cleanup;
 
-        vshPrint(ctl, "%-17s %-12llu ms\n", _("Time elapsed:"), info.timeElapsed);
-        if (info.type == VIR_DOMAIN_JOB_BOUNDED)
-            vshPrint(ctl, "%-17s %-12llu ms\n", _("Time remaining:"), info.timeRemaining);
-        if (info.dataTotal || info.dataRemaining || info.dataProcessed) {
-            val = vshPrettyCapacity(info.dataProcessed, &unit);
-            vshPrint(ctl, "%-17s %-.3lf %s\n", _("Data processed:"), val, unit);
-            val = vshPrettyCapacity(info.dataRemaining, &unit);
-            vshPrint(ctl, "%-17s %-.3lf %s\n", _("Data remaining:"), val, unit);
-            val = vshPrettyCapacity(info.dataTotal, &unit);
-            vshPrint(ctl, "%-17s %-.3lf %s\n", _("Data total:"), val, unit);
-        }
-        if (info.memTotal || info.memRemaining || info.memProcessed) {
-            val = vshPrettyCapacity(info.memProcessed, &unit);
-            vshPrint(ctl, "%-17s %-.3lf %s\n", _("Memory processed:"), val, unit);
-            val = vshPrettyCapacity(info.memRemaining, &unit);
-            vshPrint(ctl, "%-17s %-.3lf %s\n", _("Memory remaining:"), val, unit);
-            val = vshPrettyCapacity(info.memTotal, &unit);
-            vshPrint(ctl, "%-17s %-.3lf %s\n", _("Memory total:"), val, unit);
-        }
-        if (info.fileTotal || info.fileRemaining || info.fileProcessed) {
-            val = vshPrettyCapacity(info.fileProcessed, &unit);
-            vshPrint(ctl, "%-17s %-.3lf %s\n", _("File processed:"), val, unit);
-            val = vshPrettyCapacity(info.fileRemaining, &unit);
-            vshPrint(ctl, "%-17s %-.3lf %s\n", _("File remaining:"), val, unit);
-            val = vshPrettyCapacity(info.fileTotal, &unit);
-            vshPrint(ctl, "%-17s %-.3lf %s\n", _("File total:"), val, unit);
-        }
-    } else {
-        ret = false;
+    vshPrint(ctl, "%-17s ", _("Job type:"));
+    switch (info.type) {
+    case VIR_DOMAIN_JOB_BOUNDED:
+        vshPrint(ctl, "%-12s\n", _("Bounded"));
+        break;
+
+    case VIR_DOMAIN_JOB_UNBOUNDED:
+        vshPrint(ctl, "%-12s\n", _("Unbounded"));
+        break;
+
+    case VIR_DOMAIN_JOB_COMPLETED:
+        vshPrint(ctl, "%-12s\n", _("Completed"));
+        break;
+
+    case VIR_DOMAIN_JOB_NONE:
+    default:
+        vshPrint(ctl, "%-12s\n", _("None"));
+        ret = true;
+        goto cleanup;
+    }
+
+    vshPrint(ctl, "%-17s %-12llu ms\n", _("Time elapsed:"), info.timeElapsed);
+    if (info.type == VIR_DOMAIN_JOB_BOUNDED)
+        vshPrint(ctl, "%-17s %-12llu ms\n", _("Time remaining:"), info.timeRemaining);
+    if (info.dataTotal || info.dataRemaining || info.dataProcessed) {
+        val = vshPrettyCapacity(info.dataProcessed, &unit);
+        vshPrint(ctl, "%-17s %-.3lf %s\n", _("Data processed:"), val, unit);
+        val = vshPrettyCapacity(info.dataRemaining, &unit);
+        vshPrint(ctl, "%-17s %-.3lf %s\n", _("Data remaining:"), val, unit);
+        val = vshPrettyCapacity(info.dataTotal, &unit);
+        vshPrint(ctl, "%-17s %-.3lf %s\n", _("Data total:"), val, unit);
+    }
+    if (info.memTotal || info.memRemaining || info.memProcessed) {
+        val = vshPrettyCapacity(info.memProcessed, &unit);
+        vshPrint(ctl, "%-17s %-.3lf %s\n", _("Memory processed:"), val, unit);
+        val = vshPrettyCapacity(info.memRemaining, &unit);
+        vshPrint(ctl, "%-17s %-.3lf %s\n", _("Memory remaining:"), val, unit);
+        val = vshPrettyCapacity(info.memTotal, &unit);
+        vshPrint(ctl, "%-17s %-.3lf %s\n", _("Memory total:"), val, unit);
+    }
+    if (info.fileTotal || info.fileRemaining || info.fileProcessed) {
+        val = vshPrettyCapacity(info.fileProcessed, &unit);
+        vshPrint(ctl, "%-17s %-.3lf %s\n", _("File processed:"), val, unit);
+        val = vshPrettyCapacity(info.fileRemaining, &unit);
+        vshPrint(ctl, "%-17s %-.3lf %s\n", _("File remaining:"), val, unit);
+        val = vshPrettyCapacity(info.fileTotal, &unit);
+        vshPrint(ctl, "%-17s %-.3lf %s\n", _("File total:"), val, unit);
+    }
+
+    /* The rest is only provided by virDomainGetJobStats */
+    if ((rc = virTypedParamsGetULLong(params, nparams,
+                                      VIR_DOMAIN_JOB_MEMORY_BPS,
+                                      &value)) < 0) {
+        goto cleanup;
+    } else if (rc) {
+        val = vshPrettyCapacity(value, &unit);
+        vshPrint(ctl, "%-17s %-.3lf %s/s\n", _("Memory bandwidth:"),
+                 val, unit);
+    }
+
+    if ((rc = virTypedParamsGetULLong(params, nparams,
+                                      VIR_DOMAIN_JOB_MEMORY_DIRTY_RATE,
+                                      &value)) < 0) {
+        goto cleanup;
+    } else if (rc) {
+        vshPrint(ctl, "%-17s %-12llu pages/s\n", _("Dirty rate:"), value);
+    }
+
+    if ((rc = virTypedParamsGetULLong(params, nparams,
+                                      VIR_DOMAIN_JOB_MEMORY_ITERATION,
+                                      &value)) < 0) {
+        goto cleanup;
+    } else if (rc) {
+        vshPrint(ctl, "%-17s %-12llu\n", _("Iteration:"), value);
+    }
+
+    if ((rc = virTypedParamsGetULLong(params, nparams,
+                                      VIR_DOMAIN_JOB_MEMORY_CONSTANT,
+                                      &value)) < 0) {
+        goto cleanup;
+    } else if (rc) {
+        vshPrint(ctl, "%-17s %-12llu\n", _("Constant pages:"), value);
+    }
+
+    if ((rc = virTypedParamsGetULLong(params, nparams,
+                                      VIR_DOMAIN_JOB_MEMORY_NORMAL,
+                                      &value)) < 0) {
+        goto cleanup;
+    } else if (rc) {
+        vshPrint(ctl, "%-17s %-12llu\n", _("Normal pages:"), value);
+    }
+
+    if ((rc = virTypedParamsGetULLong(params, nparams,
+                                      VIR_DOMAIN_JOB_MEMORY_NORMAL_BYTES,
+                                      &value)) < 0) {
+        goto cleanup;
+    } else if (rc) {
+        val = vshPrettyCapacity(value, &unit);
+        vshPrint(ctl, "%-17s %-.3lf %s\n", _("Normal data:"), val, unit);
+    }
+
+    if ((rc = virTypedParamsGetULLong(params, nparams,
+                                      VIR_DOMAIN_JOB_DOWNTIME,
+                                      &value)) < 0) {
+        goto cleanup;
+    } else if (rc) {
+        if (info.type == VIR_DOMAIN_JOB_COMPLETED)
+            vshPrint(ctl, "%-17s %-12llu ms\n",
+                     _("Total downtime:"), value);
+        else
+            vshPrint(ctl, "%-17s %-12llu ms\n",
+                     _("Expected downtime:"), value);
     }
+
+    if ((rc = virTypedParamsGetULLong(params, nparams,
+                                      VIR_DOMAIN_JOB_SETUP_TIME,
+                                      &value)) < 0) {
+        goto cleanup;
+    } else if (rc) {
+        vshPrint(ctl, "%-17s %-12llu ms\n", _("Setup time:"), value);
+    }
+
+    ret = true;
+
 cleanup:
+    virTypedParamsFree(params, nparams);
     virDomainFree(dom);
     return ret;
 }
@@ -8128,6 +8269,21 @@ static const vshCmdOptDef opts_migrate[] = {
      .flags = 0,
      .help = N_("force migration even if it may be unsafe")
     },
+    {.name = "compressed",
+     .type = VSH_OT_BOOL,
+     .flags = 0,
+     .help = N_("compress data of tunnelled migration")
+    },
+    {.name = "parallel",
+     .type = VSH_OT_BOOL,
+     .flags = 0,
+     .help = N_("send data of tunnelled migration over several connections")
+    },
+    {.name = "auto-converge",
+     .type = VSH_OT_BOOL,
+     .flags = 0,
+     .help = N_("raise speed and downtime until migration converges")
+    },
     {.name = "verbose",
      .type = VSH_OT_BOOL,
      .flags = 0,
@@ -8229,6 +8385,15 @@ doMigrate(void *opaque)
     if (vshCommandOptBool(cmd, "unsafe"))
         flags |= VIR_MIGRATE_UNSAFE;
 
+    if (vshCommandOptBool(cmd, "compressed"))
+        flags |= VIR_MIGRATE_COMPRESSED;
+
+    if (vshCommandOptBool(cmd, "parallel"))
+        flags |= VIR_MIGRATE_PARALLEL;
+
+    if (vshCommandOptBool(cmd, "auto-converge"))
+        flags |= VIR_MIGRATE_AUTO_CONVERGE;
+
     if (vshCommandOptBool(cmd, "offline")) {
         flags |= VIR_MIGRATE_OFFLINE;
     }
@@ -662,6 +662,45 @@ cmdURI(vshControl *ctl, const vshCmd *cmd ATTRIBUTE_UNUSED)
     return true;
 }
 
+/*
+ * "rpcstats" command
+ */
+static const vshCmdInfo info_rpcstats[] = {
+    {"help", N_("show daemon RPC statistics")},
+    {"desc", N_("Display per-procedure call statistics collected by the "
+                "daemon.")},
+    {NULL, NULL}
+};
+
+static bool
+cmdRPCStats(vshControl *ctl, const vshCmd *cmd ATTRIBUTE_UNUSED)
+{
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    char *value;
+    size_t i;
+    bool ret = false;
+
+    if (virConnectGetRPCStats(ctl->conn, &params, &nparams, 0) < 0) {
+        vshError(ctl, "%s", _("Unable to get RPC statistics"));
+        return false;
+    }
+
+    for (i = 0; i < nparams; i++) {
+        if (!(value = vshGetTypedParamValue(ctl, params + i)))
+            goto cleanup;
+
+        vshPrint(ctl, "%s=%s\n", params[i].field, value);
+        VIR_FREE(value);
+    }
+
+    ret = true;
+
+cleanup:
+    virTypedParamsFree(params, nparams);
+    return ret;
+}
+
 /*
  * "version" command
  */
@@ -893,6 +932,7 @@ const vshCmdDef hostAndHypervisorCmds[] = {
     {"nodeinfo", cmdNodeinfo, NULL, info_nodeinfo, 0},
     {"nodememstats", cmdNodeMemStats, opts_node_memstats, info_nodememstats, 0},
     {"nodesuspend", cmdNodeSuspend, opts_node_suspend, info_nodesuspend, 0},
+    {"rpcstats", cmdRPCStats, NULL, info_rpcstats, 0},
     {"sysinfo", cmdSysinfo, NULL, info_sysinfo, 0},
     {"uri", cmdURI, NULL, info_uri, 0},
     {"version", cmdVersion, opts_version, info_version, 0},